@@ -112,6 +112,30 @@ std::vector<AdvancedOptionsPage::AdvancedOption> AdvancedOptionsPage::Initialize
 	option.description = {};
 	advancedOptions.push_back(option);
 
+	option.id = AdvancedOptionId::PrefetchFolders;
+	option.name =
+		ResourceHelper::LoadString(m_resourceInstance, IDS_ADVANCED_OPTION_PREFETCH_FOLDERS_NAME);
+	option.type = AdvancedOptionType::Boolean;
+	option.description = ResourceHelper::LoadString(m_resourceInstance,
+		IDS_ADVANCED_OPTION_PREFETCH_FOLDERS_DESCRIPTION);
+	advancedOptions.push_back(option);
+
+	option.id = AdvancedOptionId::DisablePrefetchingNetworkRemovable;
+	option.name = ResourceHelper::LoadString(m_resourceInstance,
+		IDS_ADVANCED_OPTION_DISABLE_PREFETCHING_NETWORK_REMOVABLE_NAME);
+	option.type = AdvancedOptionType::Boolean;
+	option.description = ResourceHelper::LoadString(m_resourceInstance,
+		IDS_ADVANCED_OPTION_DISABLE_PREFETCHING_NETWORK_REMOVABLE_DESCRIPTION);
+	advancedOptions.push_back(option);
+
+	option.id = AdvancedOptionId::StoreThumbnailsOnDisk;
+	option.name = ResourceHelper::LoadString(m_resourceInstance,
+		IDS_ADVANCED_OPTION_STORE_THUMBNAILS_ON_DISK_NAME);
+	option.type = AdvancedOptionType::Boolean;
+	option.description = ResourceHelper::LoadString(m_resourceInstance,
+		IDS_ADVANCED_OPTION_STORE_THUMBNAILS_ON_DISK_DESCRIPTION);
+	advancedOptions.push_back(option);
+
 	return advancedOptions;
 }
 
@@ -163,6 +187,15 @@ bool AdvancedOptionsPage::GetBooleanConfigValue(AdvancedOptionId id)
 	case AdvancedOptionId::QuickAccessInTreeView:
 		return m_config->showQuickAccessInTreeView.get();
 
+	case AdvancedOptionId::PrefetchFolders:
+		return m_config->prefetchFolders;
+
+	case AdvancedOptionId::DisablePrefetchingNetworkRemovable:
+		return m_config->disablePrefetchingNetworkRemovable;
+
+	case AdvancedOptionId::StoreThumbnailsOnDisk:
+		return m_config->storeThumbnailsOnDisk;
+
 	default:
 		DCHECK(false);
 		break;
@@ -191,6 +224,18 @@ void AdvancedOptionsPage::SetBooleanConfigValue(AdvancedOptionId id, bool value)
 		m_config->showQuickAccessInTreeView = value;
 		break;
 
+	case AdvancedOptionId::PrefetchFolders:
+		m_config->prefetchFolders = value;
+		break;
+
+	case AdvancedOptionId::DisablePrefetchingNetworkRemovable:
+		m_config->disablePrefetchingNetworkRemovable = value;
+		break;
+
+	case AdvancedOptionId::StoreThumbnailsOnDisk:
+		m_config->storeThumbnailsOnDisk = value;
+		break;
+
 	default:
 		DCHECK(false);
 		break;
@@ -26,7 +26,10 @@ private:
 		CheckSystemIsPinnedToNameSpaceTree,
 		OpenTabsInForeground,
 		GoUpOnDoubleClick,
-		QuickAccessInTreeView
+		QuickAccessInTreeView,
+		PrefetchFolders,
+		DisablePrefetchingNetworkRemovable,
+		StoreThumbnailsOnDisk
 	};
 
 	enum class AdvancedOptionType
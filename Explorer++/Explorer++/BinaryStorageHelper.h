@@ -0,0 +1,86 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// Helpers shared by the classes that store data in the binary session store. Each block of data
+// starts with a format version. If the version doesn't match, the data is ignored, rather than
+// being interpreted using the wrong layout.
+namespace BinaryStorageHelper
+{
+
+template <typename SaveFunction>
+std::string Serialize(uint32_t formatVersion, SaveFunction saveFunction)
+{
+	std::ostringstream stream;
+
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		archive(formatVersion);
+		saveFunction(archive);
+	}
+
+	return stream.str();
+}
+
+template <typename T, typename LoadFunction>
+std::optional<T> Deserialize(const std::string &data, uint32_t formatVersion,
+	LoadFunction loadFunction)
+{
+	std::istringstream stream(data);
+
+	try
+	{
+		cereal::BinaryInputArchive archive(stream);
+
+		uint32_t version;
+		archive(version);
+
+		if (version != formatVersion)
+		{
+			return std::nullopt;
+		}
+
+		return loadFunction(archive);
+	}
+	catch (const std::exception &)
+	{
+		// This will be thrown if the data is truncated, or if it contains an invalid value. In
+		// either case, none of the data can be used.
+		return std::nullopt;
+	}
+}
+
+// Better enums can't be default constructed, so they can't be loaded directly by cereal.
+template <typename Archive, typename T>
+void SaveBetterEnum(Archive &archive, T value)
+{
+	archive(value._to_integral());
+}
+
+template <typename T, typename Archive>
+T LoadBetterEnum(Archive &archive)
+{
+	typename T::_integral value;
+	archive(value);
+
+	auto result = T::_from_integral_nothrow(value);
+
+	if (!result)
+	{
+		throw cereal::Exception("Invalid enum value");
+	}
+
+	return *result;
+}
+
+}
@@ -0,0 +1,202 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Bookmarks/BookmarkBinaryStorage.h"
+#include "BinaryStorageHelper.h"
+#include "Bookmarks/BookmarkItem.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <cereal/types/string.hpp>
+
+namespace
+{
+
+// This should be incremented whenever the layout below changes.
+const uint32_t FORMAT_VERSION = 1;
+
+struct PermanentFolderData
+{
+	FILETIME dateCreated;
+	FILETIME dateModified;
+	BookmarkItems children;
+};
+
+struct BookmarkTreeData
+{
+	PermanentFolderData bookmarksToolbarFolder;
+	PermanentFolderData bookmarksMenuFolder;
+	PermanentFolderData otherBookmarksFolder;
+};
+
+FILETIME LoadDate(cereal::BinaryInputArchive &archive)
+{
+	FILETIME date;
+	archive(date.dwLowDateTime, date.dwHighDateTime);
+	return date;
+}
+
+void SaveDate(cereal::BinaryOutputArchive &archive, const FILETIME &date)
+{
+	archive(date.dwLowDateTime, date.dwHighDateTime);
+}
+
+BookmarkItems LoadBookmarkChildren(cereal::BinaryInputArchive &archive);
+
+std::unique_ptr<BookmarkItem> LoadBookmarkItem(cereal::BinaryInputArchive &archive)
+{
+	uint32_t type;
+	std::wstring guid;
+	std::wstring name;
+	archive(type, guid, name);
+
+	std::unique_ptr<BookmarkItem> bookmarkItem;
+
+	if (type == static_cast<uint32_t>(BookmarkItem::Type::Bookmark))
+	{
+		std::wstring location;
+		archive(location);
+
+		bookmarkItem = std::make_unique<BookmarkItem>(guid, name, location);
+	}
+	else if (type == static_cast<uint32_t>(BookmarkItem::Type::Folder))
+	{
+		bookmarkItem = std::make_unique<BookmarkItem>(guid, name, std::nullopt);
+
+		for (auto &child : LoadBookmarkChildren(archive))
+		{
+			bookmarkItem->AddChild(std::move(child));
+		}
+	}
+	else
+	{
+		throw cereal::Exception("Invalid bookmark type");
+	}
+
+	// Adding children updates the modification date, so the dates are only set once the children
+	// have been added.
+	bookmarkItem->SetDateCreated(LoadDate(archive));
+	bookmarkItem->SetDateModified(LoadDate(archive));
+
+	return bookmarkItem;
+}
+
+BookmarkItems LoadBookmarkChildren(cereal::BinaryInputArchive &archive)
+{
+	uint32_t numChildren;
+	archive(numChildren);
+
+	BookmarkItems children;
+
+	for (uint32_t i = 0; i < numChildren; i++)
+	{
+		children.push_back(LoadBookmarkItem(archive));
+	}
+
+	return children;
+}
+
+PermanentFolderData LoadPermanentFolder(cereal::BinaryInputArchive &archive)
+{
+	PermanentFolderData permanentFolder;
+	permanentFolder.dateCreated = LoadDate(archive);
+	permanentFolder.dateModified = LoadDate(archive);
+	permanentFolder.children = LoadBookmarkChildren(archive);
+	return permanentFolder;
+}
+
+void ApplyPermanentFolder(BookmarkTree *bookmarkTree, BookmarkItem *bookmarkItem,
+	PermanentFolderData &permanentFolder)
+{
+	size_t index = 0;
+
+	for (auto &child : permanentFolder.children)
+	{
+		bookmarkTree->AddBookmarkItem(bookmarkItem, std::move(child), index);
+		index++;
+	}
+
+	bookmarkItem->SetDateCreated(permanentFolder.dateCreated);
+	bookmarkItem->SetDateModified(permanentFolder.dateModified);
+}
+
+void SaveBookmarkChildren(cereal::BinaryOutputArchive &archive,
+	const BookmarkItem *parentBookmarkItem);
+
+void SaveBookmarkItem(cereal::BinaryOutputArchive &archive, const BookmarkItem *bookmarkItem)
+{
+	archive(static_cast<uint32_t>(bookmarkItem->GetType()), bookmarkItem->GetGUID(),
+		bookmarkItem->GetName());
+
+	if (bookmarkItem->IsBookmark())
+	{
+		archive(bookmarkItem->GetLocation());
+	}
+	else
+	{
+		SaveBookmarkChildren(archive, bookmarkItem);
+	}
+
+	SaveDate(archive, bookmarkItem->GetDateCreated());
+	SaveDate(archive, bookmarkItem->GetDateModified());
+}
+
+void SaveBookmarkChildren(cereal::BinaryOutputArchive &archive,
+	const BookmarkItem *parentBookmarkItem)
+{
+	archive(static_cast<uint32_t>(parentBookmarkItem->GetChildren().size()));
+
+	for (const auto &child : parentBookmarkItem->GetChildren())
+	{
+		SaveBookmarkItem(archive, child.get());
+	}
+}
+
+void SavePermanentFolder(cereal::BinaryOutputArchive &archive, const BookmarkItem *bookmarkItem)
+{
+	SaveDate(archive, bookmarkItem->GetDateCreated());
+	SaveDate(archive, bookmarkItem->GetDateModified());
+	SaveBookmarkChildren(archive, bookmarkItem);
+}
+
+}
+
+bool BookmarkBinaryStorage::Load(const std::string &data, BookmarkTree *bookmarkTree)
+{
+	// The items are loaded into a separate structure first, so that nothing is added to the tree
+	// if only part of the data can be read.
+	auto treeData = BinaryStorageHelper::Deserialize<BookmarkTreeData>(data, FORMAT_VERSION,
+		[](cereal::BinaryInputArchive &archive)
+		{
+			BookmarkTreeData treeData;
+			treeData.bookmarksToolbarFolder = LoadPermanentFolder(archive);
+			treeData.bookmarksMenuFolder = LoadPermanentFolder(archive);
+			treeData.otherBookmarksFolder = LoadPermanentFolder(archive);
+			return treeData;
+		});
+
+	if (!treeData)
+	{
+		return false;
+	}
+
+	ApplyPermanentFolder(bookmarkTree, bookmarkTree->GetBookmarksToolbarFolder(),
+		treeData->bookmarksToolbarFolder);
+	ApplyPermanentFolder(bookmarkTree, bookmarkTree->GetBookmarksMenuFolder(),
+		treeData->bookmarksMenuFolder);
+	ApplyPermanentFolder(bookmarkTree, bookmarkTree->GetOtherBookmarksFolder(),
+		treeData->otherBookmarksFolder);
+
+	return true;
+}
+
+std::string BookmarkBinaryStorage::Save(BookmarkTree *bookmarkTree)
+{
+	return BinaryStorageHelper::Serialize(FORMAT_VERSION,
+		[bookmarkTree](cereal::BinaryOutputArchive &archive)
+		{
+			SavePermanentFolder(archive, bookmarkTree->GetBookmarksToolbarFolder());
+			SavePermanentFolder(archive, bookmarkTree->GetBookmarksMenuFolder());
+			SavePermanentFolder(archive, bookmarkTree->GetOtherBookmarksFolder());
+		});
+}
@@ -0,0 +1,17 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+
+class BookmarkTree;
+
+namespace BookmarkBinaryStorage
+{
+// The data is fully parsed before any bookmarks are added to the tree. If the data is invalid,
+// false will be returned and the tree will be left unchanged.
+bool Load(const std::string &data, BookmarkTree *bookmarkTree);
+std::string Save(BookmarkTree *bookmarkTree);
+}
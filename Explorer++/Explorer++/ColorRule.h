@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "../Helper/WildcardPattern.h"
+
 class ColorRule
 {
 public:
@@ -15,6 +17,7 @@ public:
 	std::wstring GetDescription() const;
 	void SetDescription(const std::wstring &description);
 	std::wstring GetFilterPattern() const;
+	const WildcardPattern &GetCompiledFilterPattern() const;
 	void SetFilterPattern(const std::wstring &filterPattern);
 	bool GetFilterPatternCaseInsensitive() const;
 	void SetFilterPatternCaseInsensitive(bool caseInsensitive);
@@ -29,6 +32,10 @@ private:
 	std::wstring m_description;
 	std::wstring m_filterPattern;
 	bool m_filterPatternCaseInsensitive;
+
+	// Color rules are checked against every item that's drawn, so the pattern is parsed once, when
+	// it's set.
+	WildcardPattern m_compiledFilterPattern;
 	DWORD m_filterAttributes;
 	COLORREF m_color;
 
@@ -0,0 +1,93 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ColumnBinaryStorage.h"
+#include "BinaryStorageHelper.h"
+#include "ShellBrowser/FolderSettings.h"
+
+namespace ColumnBinaryStorage
+{
+
+namespace
+{
+
+// This should be incremented whenever the layout below changes.
+const uint32_t FORMAT_VERSION = 1;
+
+std::vector<Column_t> LoadColumnSet(cereal::BinaryInputArchive &archive)
+{
+	uint32_t numColumns;
+	archive(numColumns);
+
+	std::vector<Column_t> columns;
+
+	for (uint32_t i = 0; i < numColumns; i++)
+	{
+		auto type = BinaryStorageHelper::LoadBetterEnum<ColumnType>(archive);
+
+		bool checked;
+		int32_t width;
+		archive(checked, width);
+
+		columns.push_back({ type, checked, width });
+	}
+
+	return columns;
+}
+
+void SaveColumnSet(cereal::BinaryOutputArchive &archive, const std::vector<Column_t> &columns)
+{
+	archive(static_cast<uint32_t>(columns.size()));
+
+	for (const auto &column : columns)
+	{
+		BinaryStorageHelper::SaveBetterEnum(archive, column.type);
+		archive(column.checked != FALSE, static_cast<int32_t>(column.width));
+	}
+}
+
+}
+
+std::optional<FolderColumns> Load(const std::string &data)
+{
+	return BinaryStorageHelper::Deserialize<FolderColumns>(data, FORMAT_VERSION,
+		[](cereal::BinaryInputArchive &archive)
+		{
+			FolderColumns folderColumns;
+			LoadAllColumnSets(archive, folderColumns);
+			return folderColumns;
+		});
+}
+
+std::string Save(const FolderColumns &folderColumns)
+{
+	return BinaryStorageHelper::Serialize(FORMAT_VERSION,
+		[&folderColumns](cereal::BinaryOutputArchive &archive)
+		{ SaveAllColumnSets(archive, folderColumns); });
+}
+
+void LoadAllColumnSets(cereal::BinaryInputArchive &archive, FolderColumns &folderColumns)
+{
+	folderColumns.realFolderColumns = LoadColumnSet(archive);
+	folderColumns.myComputerColumns = LoadColumnSet(archive);
+	folderColumns.controlPanelColumns = LoadColumnSet(archive);
+	folderColumns.recycleBinColumns = LoadColumnSet(archive);
+	folderColumns.printersColumns = LoadColumnSet(archive);
+	folderColumns.networkConnectionsColumns = LoadColumnSet(archive);
+	folderColumns.myNetworkPlacesColumns = LoadColumnSet(archive);
+}
+
+void SaveAllColumnSets(cereal::BinaryOutputArchive &archive, const FolderColumns &folderColumns)
+{
+	SaveColumnSet(archive, folderColumns.realFolderColumns);
+	SaveColumnSet(archive, folderColumns.myComputerColumns);
+	SaveColumnSet(archive, folderColumns.controlPanelColumns);
+	SaveColumnSet(archive, folderColumns.recycleBinColumns);
+	SaveColumnSet(archive, folderColumns.printersColumns);
+	SaveColumnSet(archive, folderColumns.networkConnectionsColumns);
+	SaveColumnSet(archive, folderColumns.myNetworkPlacesColumns);
+}
+
+}
@@ -0,0 +1,23 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cereal/archives/binary.hpp>
+#include <optional>
+#include <string>
+
+struct FolderColumns;
+
+namespace ColumnBinaryStorage
+{
+
+std::optional<FolderColumns> Load(const std::string &data);
+std::string Save(const FolderColumns &folderColumns);
+
+// These are used when the columns are stored as part of some other data (e.g. a tab).
+void LoadAllColumnSets(cereal::BinaryInputArchive &archive, FolderColumns &folderColumns);
+void SaveAllColumnSets(cereal::BinaryOutputArchive &archive, const FolderColumns &folderColumns);
+
+}
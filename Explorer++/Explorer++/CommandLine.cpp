@@ -151,6 +151,16 @@ std::variant<CommandLine::Settings, CommandLine::ExitInfo> CommandLine::ProcessC
 		   "will be opened in a separate tab.")
 		->allow_extra_args(false);
 
+	app.add_option("--index-root", settings.indexRoots,
+		   "A directory to index, when the FileNameIndex feature is enabled. This option can be "
+		   "supplied multiple times.")
+		->allow_extra_args(false);
+
+	app.add_option("--background-task-threads", settings.backgroundTaskThreads,
+		   "The maximum number of background tasks used to retrieve icons, thumbnails and other "
+		   "item details that can run at once")
+		->check(CLI::Range(1, 64));
+
 	app.add_option("directories", settings.directories,
 		"Directories to open. Paths with spaces should be enclosed in double quotes (e.g. "
 		R"("C:\path with spaces").)");
@@ -20,6 +20,8 @@ struct Settings
 	std::wstring language;
 	bool createJumplistTab = false;
 	std::vector<std::wstring> filesToSelect;
+	std::vector<std::wstring> indexRoots;
+	std::optional<int> backgroundTaskThreads;
 	std::vector<std::wstring> directories;
 };
 
@@ -109,6 +109,13 @@ struct Config
 	bool checkPinnedToNamespaceTreeProperty = false;
 	ValueWrapper<bool> showQuickAccessInTreeView = true;
 
+	// Folder prefetching
+	bool prefetchFolders = true;
+	bool disablePrefetchingNetworkRemovable = true;
+
+	// Thumbnails
+	bool storeThumbnailsOnDisk = false;
+
 	// Display window
 	Gdiplus::Color displayWindowCentreColor = Gdiplus::Color(255, 255, 255);
 	Gdiplus::Color displayWindowSurroundColor = Gdiplus::Color(0, 94, 138);
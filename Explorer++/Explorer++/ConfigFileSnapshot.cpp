@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ConfigFileSnapshot.h"
+#include "../Helper/XMLSettings.h"
+#include <glog/logging.h>
+#include <wil/resource.h>
+
+std::unique_ptr<ConfigFileSnapshot> ConfigFileSnapshot::Load(const std::wstring &filePath)
+{
+	wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, 0, nullptr));
+
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	file.reset();
+
+	wil::com_ptr_nothrow<IXMLDOMDocument> document;
+	document.attach(XMLSettings::DomFromCOM());
+
+	if (document)
+	{
+		wil::unique_variant var(XMLSettings::VariantString(filePath.c_str()));
+		VARIANT_BOOL status = VARIANT_FALSE;
+		HRESULT hr = document->load(var, &status);
+
+		if (FAILED(hr) || status != VARIANT_TRUE)
+		{
+			LOG(WARNING) << "The config file could not be parsed, default settings will be used";
+
+			// A fresh document is used, so that no partially loaded content is read.
+			document.attach(XMLSettings::DomFromCOM());
+		}
+	}
+
+	// The constructor is private, so std::make_unique can't be used here.
+	return std::unique_ptr<ConfigFileSnapshot>(new ConfigFileSnapshot(std::move(document)));
+}
+
+ConfigFileSnapshot::ConfigFileSnapshot(wil::com_ptr_nothrow<IXMLDOMDocument> document) :
+	m_document(std::move(document))
+{
+}
+
+IXMLDOMDocument *ConfigFileSnapshot::GetDocument() const
+{
+	return m_document.get();
+}
@@ -0,0 +1,31 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <wil/com.h>
+#include <MsXml2.h>
+#include <memory>
+#include <string>
+
+// Holds the parsed contents of the config file. The file is parsed a single time during startup,
+// with each of the settings loaders then reading from the same document, rather than each loader
+// opening and parsing the file independently.
+class ConfigFileSnapshot : private boost::noncopyable
+{
+public:
+	// Returns null if the file doesn't exist, in which case settings should be loaded from the
+	// registry instead. If the file exists but can't be parsed, the snapshot will contain an empty
+	// document, so that the default settings are used.
+	static std::unique_ptr<ConfigFileSnapshot> Load(const std::wstring &filePath);
+
+	// This may return null if the XML DOM couldn't be created.
+	IXMLDOMDocument *GetDocument() const;
+
+private:
+	ConfigFileSnapshot(wil::com_ptr_nothrow<IXMLDOMDocument> document);
+
+	const wil::com_ptr_nothrow<IXMLDOMDocument> m_document;
+};
@@ -54,12 +54,18 @@ using ApplicationShuttingDownSignal = boost::signals2::signal<void()>;
 class AcceleratorManager;
 class CachedIcons;
 struct Config;
+class FileNameIndexService;
+class FolderEnumerationService;
+class FolderSizeService;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
+class PriorityTaskScheduler;
 class ShellBrowserImpl;
 class StatusBar;
 class TabContainer;
 class TabRestorer;
+class ThumbnailCache;
+class WorkStealingExecutor;
 
 /* Basic interface between Explorerplusplus
 and some of the other components (such as the
@@ -80,9 +86,22 @@ public:
 	virtual TabContainer *GetTabContainer() const = 0;
 	virtual TabRestorer *GetTabRestorer() const = 0;
 	virtual IDirectoryMonitor *GetDirectoryMonitor() const = 0;
+	virtual FileNameIndexService *GetFileNameIndexService() const = 0;
+	virtual FolderSizeService *GetFolderSizeService() const = 0;
+	virtual FolderEnumerationService *GetFolderEnumerationService() const = 0;
 
 	virtual IconResourceLoader *GetIconResourceLoader() const = 0;
 	virtual CachedIcons *GetCachedIcons() = 0;
+	virtual ThumbnailCache *GetThumbnailCache() = 0;
+
+	// Runs background work (e.g. folder enumeration) for the entire process, so that individual
+	// components don't need to own threads of their own.
+	virtual WorkStealingExecutor *GetBackgroundExecutor() = 0;
+
+	// Used to retrieve icons, thumbnails and other item details in the background. The scheduler
+	// is shared by all tabs and runs on the background executor, with a bounded number of tasks
+	// running at once.
+	virtual PriorityTaskScheduler *GetBackgroundTaskScheduler() = 0;
 
 	virtual HWND GetTreeView() const = 0;
 
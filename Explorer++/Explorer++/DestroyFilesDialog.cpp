@@ -12,6 +12,28 @@
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/XMLSettings.h"
+#include <algorithm>
+
+namespace
+{
+
+const int WM_APP_SETDESTROYPROGRESS = WM_APP + 1;
+const int WM_APP_DESTROYFINISHED = WM_APP + 2;
+
+// Progress is measured in bytes, which won't necessarily fit within the range of the progress bar,
+// so it's scaled to this range instead.
+const int PROGRESS_BAR_RANGE = 1000;
+
+DWORD WINAPI DestroyFilesThreadProc(LPVOID param)
+{
+	auto *destroyFiles = reinterpret_cast<DestroyFiles *>(param);
+	destroyFiles->Destroy();
+	destroyFiles->Release();
+
+	return 0;
+}
+
+}
 
 const TCHAR DestroyFilesDialogPersistentSettings::SETTINGS_KEY[] = _T("DestroyFiles");
 
@@ -19,8 +41,11 @@ const TCHAR DestroyFilesDialogPersistentSettings::SETTING_OVERWRITE_METHOD[] =
 	_T("OverwriteMethod");
 
 DestroyFilesDialog::DestroyFilesDialog(HINSTANCE resourceInstance, HWND hParent,
-	const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates) :
-	ThemedDialog(resourceInstance, IDD_DESTROYFILES, hParent, DialogSizingType::Both)
+	const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates,
+	WorkStealingExecutor *executor) :
+	ThemedDialog(resourceInstance, IDD_DESTROYFILES, hParent, DialogSizingType::Both),
+	m_executor(executor),
+	m_destroyFiles(nullptr)
 {
 	m_FullFilenameList = FullFilenameList;
 	m_bShowFriendlyDates = bShowFriendlyDates;
@@ -28,6 +53,15 @@ DestroyFilesDialog::DestroyFilesDialog(HINSTANCE resourceInstance, HWND hParent,
 	m_pdfdps = &DestroyFilesDialogPersistentSettings::GetInstance();
 }
 
+DestroyFilesDialog::~DestroyFilesDialog()
+{
+	if (m_destroyFiles != nullptr)
+	{
+		m_destroyFiles->StopDestroying();
+		m_destroyFiles->Release();
+	}
+}
+
 INT_PTR DestroyFilesDialog::OnInitDialog()
 {
 	m_icon.reset(LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_MAIN)));
@@ -140,6 +174,8 @@ std::vector<ResizableDialogControl> DestroyFilesDialog::GetResizableControls()
 		MovingType::Vertical, SizingType::None);
 	controls.emplace_back(GetDlgItem(m_hDlg, IDC_DESTROYFILES_STATIC_WARNING_MESSAGE),
 		MovingType::Vertical, SizingType::Horizontal);
+	controls.emplace_back(GetDlgItem(m_hDlg, IDC_DESTROYFILES_PROGRESS), MovingType::Vertical,
+		SizingType::Horizontal);
 	controls.emplace_back(GetDlgItem(m_hDlg, IDOK), MovingType::Both, SizingType::None);
 	controls.emplace_back(GetDlgItem(m_hDlg, IDCANCEL), MovingType::Both, SizingType::None);
 	return controls;
@@ -165,7 +201,25 @@ INT_PTR DestroyFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 INT_PTR DestroyFilesDialog::OnClose()
 {
-	EndDialog(m_hDlg, 0);
+	OnCancel();
+	return 0;
+}
+
+INT_PTR DestroyFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case WM_APP_SETDESTROYPROGRESS:
+		SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, wParam, 0);
+		break;
+
+	case WM_APP_DESTROYFINISHED:
+		OnDestroyFinished(wParam != 0);
+		break;
+	}
+
 	return 0;
 }
 
@@ -209,6 +263,15 @@ void DestroyFilesDialog::OnOk()
 
 void DestroyFilesDialog::OnCancel()
 {
+	if (m_destroyFiles != nullptr)
+	{
+		// The dialog will be closed once the files currently being overwritten have been
+		// finished with.
+		m_destroyFiles->StopDestroying();
+		EnableWindow(GetDlgItem(m_hDlg, IDCANCEL), FALSE);
+		return;
+	}
+
 	EndDialog(m_hDlg, 0);
 }
 
@@ -225,15 +288,105 @@ void DestroyFilesDialog::OnConfirmDestroy()
 		overwriteMethod = FileOperations::OverwriteMethod::ThreePass;
 	}
 
-	/* TODO: Perform in background thread. */
-	for (const auto &strFullFilename : m_FullFilenameList)
+	std::vector<std::wstring> paths(m_FullFilenameList.begin(), m_FullFilenameList.end());
+
+	m_destroyFiles = new DestroyFiles(m_hDlg, m_executor, std::move(paths),
+		FileOperations::GetOverwritePasses(overwriteMethod));
+
+	EnableWindow(GetDlgItem(m_hDlg, IDOK), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_ONEPASS), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_THREEPASS), FALSE);
+
+	auto stopText = ResourceHelper::LoadString(GetResourceInstance(), IDS_STOP);
+	SetDlgItemText(m_hDlg, IDCANCEL, stopText.c_str());
+
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETRANGE32, 0, PROGRESS_BAR_RANGE);
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, 0, 0);
+
+	// The reference added here is released by the background thread once it's finished.
+	m_destroyFiles->AddRef();
+
+	HANDLE thread = CreateThread(nullptr, 0, DestroyFilesThreadProc, m_destroyFiles, 0, nullptr);
+
+	if (!thread)
 	{
-		DeleteFileSecurely(strFullFilename, overwriteMethod);
+		m_destroyFiles->Release();
+		OnDestroyFinished(true);
+		return;
+	}
+
+	SetThreadPriority(thread, THREAD_PRIORITY_LOWEST);
+	CloseHandle(thread);
+}
+
+// Files that were destroyed before the operation was stopped can't be restored, so the result is
+// the same whether or not every file was processed.
+void DestroyFilesDialog::OnDestroyFinished(bool failed)
+{
+	assert(m_destroyFiles != nullptr);
+
+	m_destroyFiles->Release();
+	m_destroyFiles = nullptr;
+
+	if (failed)
+	{
+		auto failedText =
+			ResourceHelper::LoadString(GetResourceInstance(), IDS_DESTROY_FILES_FAILED);
+		MessageBox(m_hDlg, failedText.c_str(), NExplorerplusplus::APP_NAME,
+			MB_ICONWARNING | MB_SETFOREGROUND | MB_OK);
 	}
 
 	EndDialog(m_hDlg, 1);
 }
 
+DestroyFiles::DestroyFiles(HWND hDlg, WorkStealingExecutor *executor,
+	std::vector<std::wstring> paths, std::vector<SecureOverwriteEngine::Pattern> passes) :
+	m_hDlg(hDlg),
+	m_executor(executor),
+	m_paths(std::move(paths)),
+	m_passes(std::move(passes)),
+	m_stopDestroying(false),
+	m_progressPosition(0)
+{
+}
+
+void DestroyFiles::Destroy()
+{
+	SecureOverwriteEngine engine(m_executor);
+	HRESULT hr = engine.DestroyFiles(m_paths, m_passes, m_stopDestroying,
+		[this](const SecureOverwriteEngine::Progress &progress) { OnProgress(progress); });
+
+	// Stopping isn't treated as a failure, since it was requested by the user.
+	bool failed = FAILED(hr) && hr != E_ABORT;
+	PostMessage(m_hDlg, WM_APP_DESTROYFINISHED, failed, 0);
+}
+
+void DestroyFiles::StopDestroying()
+{
+	m_stopDestroying = true;
+}
+
+// A message is only posted when the position of the progress bar changes, so that the dialog
+// isn't flooded with messages when a large number of small blocks are written.
+void DestroyFiles::OnProgress(const SecureOverwriteEngine::Progress &progress)
+{
+	if (progress.totalBytes == 0)
+	{
+		return;
+	}
+
+	auto position = static_cast<int>((std::min)(progress.bytesOverwritten, progress.totalBytes)
+		* PROGRESS_BAR_RANGE / progress.totalBytes);
+
+	if (position == m_progressPosition)
+	{
+		return;
+	}
+
+	m_progressPosition = position;
+	PostMessage(m_hDlg, WM_APP_SETDESTROYPROGRESS, position, 0);
+}
+
 DestroyFilesDialogPersistentSettings::DestroyFilesDialogPersistentSettings() :
 	DialogSettings(SETTINGS_KEY)
 {
@@ -7,8 +7,15 @@
 #include "ThemedDialog.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/ReferenceCount.h"
 #include "../Helper/ResizableDialogHelper.h"
+#include "../Helper/SecureOverwriteEngine.h"
 #include <wil/resource.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+class WorkStealingExecutor;
 
 class DestroyFilesDialog;
 
@@ -38,16 +45,44 @@ private:
 	FileOperations::OverwriteMethod m_overwriteMethod;
 };
 
+// Destroys a set of files on a background thread, posting its progress back to the dialog. The
+// background thread holds its own reference, so the dialog can be closed before the operation has
+// finished.
+class DestroyFiles : public ReferenceCount
+{
+public:
+	DestroyFiles(HWND hDlg, WorkStealingExecutor *executor, std::vector<std::wstring> paths,
+		std::vector<SecureOverwriteEngine::Pattern> passes);
+
+	void Destroy();
+	void StopDestroying();
+
+private:
+	void OnProgress(const SecureOverwriteEngine::Progress &progress);
+
+	HWND m_hDlg;
+	WorkStealingExecutor *m_executor;
+
+	const std::vector<std::wstring> m_paths;
+	const std::vector<SecureOverwriteEngine::Pattern> m_passes;
+
+	std::atomic<bool> m_stopDestroying;
+	int m_progressPosition;
+};
+
 class DestroyFilesDialog : public ThemedDialog
 {
 public:
 	DestroyFilesDialog(HINSTANCE resourceInstance, HWND hParent,
-		const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates);
+		const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates,
+		WorkStealingExecutor *executor);
+	~DestroyFilesDialog();
 
 protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
 	INT_PTR OnClose() override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 private:
 	std::vector<ResizableDialogControl> GetResizableControls() override;
@@ -56,6 +91,7 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnConfirmDestroy();
+	void OnDestroyFinished(bool failed);
 
 	std::list<std::wstring> m_FullFilenameList;
 
@@ -64,4 +100,9 @@ private:
 	DestroyFilesDialogPersistentSettings *m_pdfdps;
 
 	BOOL m_bShowFriendlyDates;
+
+	WorkStealingExecutor *m_executor;
+
+	// Set while the files are being destroyed.
+	DestroyFiles *m_destroyFiles;
 };
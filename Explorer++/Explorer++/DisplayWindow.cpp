@@ -6,10 +6,10 @@
 #include "Explorer++.h"
 #include "Config.h"
 #include "DisplayWindow/DisplayWindow.h"
+#include "FolderSizeService.h"
 #include "MainResource.h"
 #include "ShellBrowser/ShellBrowserImpl.h"
 #include "TabContainer.h"
-#include "../Helper/FolderSize.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
@@ -121,56 +121,7 @@ void Explorerplusplus::UpdateDisplayWindowForOneFile(const Tab &tab)
 			if (((dwAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 				&& m_config->globalFolderSettings.showFolderSizes)
 			{
-				FolderSize_t *pfs = nullptr;
-				FolderSizeExtraInfo *pfsei = nullptr;
-				DWFolderSize displayWindowFolderSize;
-				TCHAR szDisplayText[256];
-				TCHAR szTotalSize[64];
-				TCHAR szCalculating[64];
-				DWORD threadId;
-
-				pfs = (FolderSize_t *) malloc(sizeof(FolderSize_t));
-
-				if (pfs != nullptr)
-				{
-					pfsei = (FolderSizeExtraInfo *) malloc(sizeof(FolderSizeExtraInfo));
-
-					if (pfsei != nullptr)
-					{
-						pfsei->pContainer = (void *) this;
-						pfsei->uId = m_iDWFolderSizeUniqueId;
-						pfs->pData = (LPVOID) pfsei;
-
-						pfs->pfnCallback = FolderSizeCallbackStub;
-
-						StringCchCopy(pfs->szPath, SIZEOF_ARRAY(pfs->szPath), fullItemName.c_str());
-
-						LoadString(m_resourceInstance, IDS_GENERAL_TOTALSIZE, szTotalSize,
-							SIZEOF_ARRAY(szTotalSize));
-						LoadString(m_resourceInstance, IDS_GENERAL_CALCULATING, szCalculating,
-							SIZEOF_ARRAY(szCalculating));
-						StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
-							szTotalSize, szCalculating);
-						DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
-
-						/* Maintain a global list of folder size operations. */
-						displayWindowFolderSize.uId = m_iDWFolderSizeUniqueId;
-						displayWindowFolderSize.iTabId =
-							GetActivePane()->GetTabContainer()->GetSelectedTab().GetId();
-						displayWindowFolderSize.bValid = TRUE;
-						m_DWFolderSizes.push_back(displayWindowFolderSize);
-
-						HANDLE hThread = CreateThread(nullptr, 0, Thread_CalculateFolderSize,
-							(LPVOID) pfs, 0, &threadId);
-						CloseHandle(hThread);
-
-						m_iDWFolderSizeUniqueId++;
-					}
-					else
-					{
-						free(pfs);
-					}
-				}
+				RequestDisplayWindowFolderSize(fullItemName);
 			}
 			else
 			{
@@ -389,3 +340,80 @@ void Explorerplusplus::UpdateDisplayWindowForMultipleFiles(const Tab &tab)
 
 	DisplayWindow_BufferText(m_hDisplayWindow, szTotalSize);
 }
+
+void Explorerplusplus::RequestDisplayWindowFolderSize(const std::wstring &path)
+{
+	auto cachedFolderInfo = m_folderSizeService->GetCachedFolderInfo(path);
+
+	if (cachedFolderInfo)
+	{
+		DisplayWindow_BufferText(m_hDisplayWindow,
+			GetDisplayWindowFolderSizeText(cachedFolderInfo->size, true).c_str());
+		return;
+	}
+
+	TCHAR szDisplayText[256];
+	TCHAR szTotalSize[64];
+	TCHAR szCalculating[64];
+	LoadString(m_resourceInstance, IDS_GENERAL_TOTALSIZE, szTotalSize, SIZEOF_ARRAY(szTotalSize));
+	LoadString(m_resourceInstance, IDS_GENERAL_CALCULATING, szCalculating,
+		SIZEOF_ARRAY(szCalculating));
+	StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"), szTotalSize,
+		szCalculating);
+	DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
+
+	// Both the partial and final results are queued back to the main thread. It's up to the main
+	// thread to determine whether the folder size should actually be shown.
+	int requestId = m_folderSizeService->RequestFolderInfo(path,
+		[hwnd = m_hContainer, id = m_iDWFolderSizeUniqueId](const FolderInfo &folderInfo,
+			bool complete)
+		{
+			auto completion = std::make_unique<DWFolderSizeCompletion>(
+				DWFolderSizeCompletion{ folderInfo.size, id, complete });
+
+			if (PostMessage(hwnd, WM_APP_FOLDERSIZECOMPLETED,
+					reinterpret_cast<WPARAM>(completion.get()), 0))
+			{
+				completion.release();
+			}
+		});
+
+	/* Maintain a global list of folder size operations. */
+	DWFolderSize displayWindowFolderSize;
+	displayWindowFolderSize.uId = m_iDWFolderSizeUniqueId;
+	displayWindowFolderSize.iTabId = GetActivePane()->GetTabContainer()->GetSelectedTab().GetId();
+	displayWindowFolderSize.requestId = requestId;
+	m_DWFolderSizes.push_back(displayWindowFolderSize);
+
+	m_iDWFolderSizeUniqueId++;
+}
+
+std::wstring Explorerplusplus::GetDisplayWindowFolderSizeText(std::uintmax_t folderSize,
+	bool complete)
+{
+	auto displayFormat = m_config->globalFolderSettings.forceSize
+		? m_config->globalFolderSettings.sizeDisplayFormat
+		: +SizeDisplayFormat::None;
+	auto folderSizeText = FormatSizeString(folderSize, displayFormat);
+
+	TCHAR szTotalSize[64];
+	LoadString(m_resourceInstance, IDS_GENERAL_TOTALSIZE, szTotalSize, SIZEOF_ARRAY(szTotalSize));
+
+	TCHAR szSizeString[128];
+
+	if (complete)
+	{
+		StringCchPrintf(szSizeString, SIZEOF_ARRAY(szSizeString), _T("%s: %s"), szTotalSize,
+			folderSizeText.c_str());
+	}
+	else
+	{
+		TCHAR szCalculating[64];
+		LoadString(m_resourceInstance, IDS_GENERAL_CALCULATING, szCalculating,
+			SIZEOF_ARRAY(szCalculating));
+		StringCchPrintf(szSizeString, SIZEOF_ARRAY(szSizeString), _T("%s: %s (%s)"), szTotalSize,
+			folderSizeText.c_str(), szCalculating);
+	}
+
+	return szSizeString;
+}
@@ -10,6 +10,10 @@
 #include "Config.h"
 #include "Explorer++_internal.h"
 #include "FeatureList.h"
+#include "FileNameIndexService.h"
+#include "FolderEnumerationService.h"
+#include "FolderPrefetcher.h"
+#include "FolderSizeService.h"
 #include "GlobalHistoryMenu.h"
 #include "HistoryServiceFactory.h"
 #include "MainFontSetter.h"
@@ -24,6 +28,7 @@
 #include "TabStorage.h"
 #include "ThemeWindowTracker.h"
 #include "UiTheming.h"
+#include "../Helper/SessionStore.h"
 #include "../Helper/WindowSubclassWrapper.h"
 #include "../Helper/iDirectoryMonitor.h"
 
@@ -38,13 +43,27 @@ Explorerplusplus::Explorerplusplus(HWND hwnd, InitializationData *initialization
 	m_acceleratorUpdater(initializationData->acceleratorManager),
 	m_pluginCommandManager(initializationData->acceleratorManager, ACCELERATOR_PLUGIN_START_ID,
 		ACCELERATOR_PLUGIN_END_ID),
-	m_iconFetcher(hwnd, &m_cachedIcons)
+	m_backgroundExecutor(GetNumBackgroundExecutorThreads(),
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
+		[]()
+		{
+			// Any COM objects a worker has held onto need to be released before its apartment is
+			// uninitialized.
+			ShellBrowserImpl::ReleaseThreadThumbnailResources();
+			CoUninitialize();
+		}),
+	m_backgroundTaskScheduler(&m_backgroundExecutor,
+		GetNumBackgroundTaskThreads(initializationData->commandLineSettings),
+		WorkStealingExecutor::Apartment::Required),
+	m_thumbnailStoreTaskGroup(&m_backgroundExecutor),
+	m_iconFetcher(hwnd, &m_cachedIcons, &m_backgroundTaskScheduler)
 {
 	m_resourceInstance = nullptr;
 
 	m_config = std::make_shared<Config>();
 	FeatureList::GetInstance()->InitializeFromCommandLine(*initializationData->commandLineSettings);
 
+	m_configSnapshot = initializationData->configSnapshot;
 	m_bSavePreferencesToXMLFile = FALSE;
 	m_bLanguageLoaded = false;
 	m_bShowTabBar = true;
@@ -62,7 +81,37 @@ Explorerplusplus::Explorerplusplus(HWND hwnd, InitializationData *initialization
 
 Explorerplusplus::~Explorerplusplus()
 {
+	// The prefetcher uses the background executor, along with several of the services below, so
+	// any pass that's running needs to be stopped first.
+	m_folderPrefetcher.reset();
+
 	m_pDirMon->Release();
+
+	// The directory monitor has now stopped, so the index and folder size services won't receive
+	// any further notifications.
+	m_fileNameIndexService.reset();
+	m_folderSizeService.reset();
+}
+
+int Explorerplusplus::GetNumBackgroundExecutorThreads()
+{
+	int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+	return std::clamp(numThreads, MIN_BACKGROUND_EXECUTOR_THREADS,
+		MAX_BACKGROUND_EXECUTOR_THREADS);
+}
+
+int Explorerplusplus::GetNumBackgroundTaskThreads(
+	const CommandLine::Settings *commandLineSettings)
+{
+	if (commandLineSettings->backgroundTaskThreads)
+	{
+		return *commandLineSettings->backgroundTaskThreads;
+	}
+
+	// Most of the background work is I/O bound, so there's little benefit to using a large number
+	// of threads, even on machines that have a large number of cores.
+	int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+	return std::clamp(numThreads, 1, DEFAULT_MAX_BACKGROUND_TASK_THREADS);
 }
 
 BrowserCommandController *Explorerplusplus::GetCommandController()
@@ -10,6 +10,7 @@
 #include "BrowserWindow.h"
 #include "CommandLine.h"
 #include "CoreInterface.h"
+#include "FrequentLocationsService.h"
 #include "IconFetcherImpl.h"
 #include "Literals.h"
 #include "MainToolbarStorage.h"
@@ -26,7 +27,10 @@
 #include "../Helper/ClipboardHelper.h"
 #include "../Helper/DropHandler.h"
 #include "../Helper/FileActionHandler.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include "../Helper/WorkStealingExecutor.h"
 #include "../Helper/ShellContextMenu.h"
+#include "../Helper/ThumbnailCache.h"
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
 #include <optional>
@@ -40,13 +44,19 @@ class AddressBar;
 class BookmarksMainMenu;
 class BookmarksToolbar;
 struct Config;
+class ConfigFileSnapshot;
 class DrivesToolbar;
+class FileNameIndexService;
+class FolderEnumerationService;
+class FolderPrefetcher;
+class FolderSizeService;
 class GlobalHistoryMenu;
 class HolderWindow;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
 class ILoadSave;
 class LoadSaveRegistry;
+class LoadSaveSession;
 class LoadSaveXML;
 class MainFontSetter;
 class MainMenuSubMenuView;
@@ -54,6 +64,7 @@ class MainToolbar;
 class MainWindow;
 struct NavigateParams;
 struct RebarBandStorageInfo;
+class SessionStore;
 class ShellBrowserImpl;
 class ShellTreeView;
 class TabContainer;
@@ -85,6 +96,7 @@ class Explorerplusplus :
 	public TabNavigationInterface
 {
 	friend LoadSaveRegistry;
+	friend LoadSaveSession;
 	friend LoadSaveXML;
 
 public:
@@ -92,6 +104,9 @@ public:
 	{
 		CommandLine::Settings *commandLineSettings = nullptr;
 		AcceleratorManager *acceleratorManager = nullptr;
+
+		// If this is null, settings will be loaded from the registry.
+		const ConfigFileSnapshot *configSnapshot = nullptr;
 	};
 
 	Explorerplusplus(HWND hwnd, InitializationData *initializationData);
@@ -143,6 +158,21 @@ private:
 	// shared between various components in the application.
 	static const int MAX_CACHED_ICONS = 1000;
 
+	// Thumbnails are much larger than icons, so the thumbnail cache is limited by the amount of
+	// memory it uses. The file that thumbnails are stored in is also limited in size.
+	static const size_t MAX_THUMBNAIL_CACHE_MEMORY = 64 * 1024 * 1024;
+	static const uint64_t MAX_THUMBNAIL_STORE_SIZE = 256 * 1024 * 1024;
+
+	// The bounds on the number of threads in the process-wide background executor. The lower bound
+	// ensures that a few tasks that block for a long time (e.g. enumerating a folder on a slow
+	// network share) can't starve everything else.
+	static const int MIN_BACKGROUND_EXECUTOR_THREADS = 4;
+	static const int MAX_BACKGROUND_EXECUTOR_THREADS = 16;
+
+	// The default upper limit on the number of item tasks (e.g. retrieving icons and thumbnails)
+	// that can run at once. This can be overridden on the command line.
+	static const int DEFAULT_MAX_BACKGROUND_TASK_THREADS = 4;
+
 	static inline constexpr COLORREF TAB_BAR_DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
 
 	// When changing the font size, it will be decreased/increased by this amount.
@@ -157,22 +187,18 @@ private:
 
 	struct DWFolderSizeCompletion
 	{
-		ULARGE_INTEGER liFolderSize;
+		std::uintmax_t folderSize;
 		int uId;
-		int iTabId;
+
+		// Set once the calculation has finished. Until then, the size is a partial result.
+		bool complete;
 	};
 
 	struct DWFolderSize
 	{
 		int uId;
 		int iTabId;
-		BOOL bValid;
-	};
-
-	struct FolderSizeExtraInfo
-	{
-		void *pContainer;
-		int uId;
+		int requestId;
 	};
 
 	struct InternalRebarBandInfo
@@ -199,6 +225,9 @@ private:
 		Increase
 	};
 
+	static int GetNumBackgroundExecutorThreads();
+	static int GetNumBackgroundTaskThreads(const CommandLine::Settings *commandLineSettings);
+
 	LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam);
 
 	static LRESULT CALLBACK ListViewProcStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
@@ -374,7 +403,6 @@ private:
 	void LoadAllSettings();
 	void ValidateLoadedSettings();
 	void ApplyDisplayWindowPosition();
-	void TestConfigFile();
 
 	/* Registry settings. */
 	LONG LoadGenericSettingsFromRegistry();
@@ -485,6 +513,8 @@ private:
 	void UpdateDisplayWindowForZeroFiles(const Tab &tab);
 	void UpdateDisplayWindowForOneFile(const Tab &tab);
 	void UpdateDisplayWindowForMultipleFiles(const Tab &tab);
+	void RequestDisplayWindowFolderSize(const std::wstring &path);
+	std::wstring GetDisplayWindowFolderSizeText(std::uintmax_t folderSize, bool complete);
 
 	/* Columns. */
 	void CopyColumnInfoToClipboard();
@@ -499,8 +529,14 @@ private:
 	TabRestorer *GetTabRestorer() const override;
 	HWND GetTreeView() const override;
 	IDirectoryMonitor *GetDirectoryMonitor() const override;
+	FileNameIndexService *GetFileNameIndexService() const override;
+	FolderSizeService *GetFolderSizeService() const override;
+	FolderEnumerationService *GetFolderEnumerationService() const override;
 	IconResourceLoader *GetIconResourceLoader() const override;
 	CachedIcons *GetCachedIcons() override;
+	ThumbnailCache *GetThumbnailCache() override;
+	WorkStealingExecutor *GetBackgroundExecutor() override;
+	PriorityTaskScheduler *GetBackgroundTaskScheduler() override;
 	BOOL GetSavePreferencesToXmlFile() const override;
 	void SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile) override;
 	void FocusChanged() override;
@@ -552,11 +588,6 @@ private:
 	void StopDirectoryMonitoringForTab(const Tab &tab);
 	int DetermineListViewObjectIndex(HWND hListView);
 
-	static void FolderSizeCallbackStub(int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize,
-		LPVOID pData);
-	void FolderSizeCallback(FolderSizeExtraInfo *pfsei, int nFolders, int nFiles,
-		PULARGE_INTEGER lTotalFolderSize);
-
 	HWND m_hContainer;
 	const CommandLine::Settings *const m_commandLineSettings;
 	AcceleratorManager *const m_acceleratorManager;
@@ -572,6 +603,13 @@ private:
 	wil::unique_himagelist m_tabWindowToolbarImageList;
 
 	IDirectoryMonitor *m_pDirMon;
+	std::unique_ptr<FileNameIndexService> m_fileNameIndexService;
+	std::unique_ptr<FolderSizeService> m_folderSizeService;
+	std::unique_ptr<FolderEnumerationService> m_folderEnumerationService;
+
+	// Tracks the folders that are visited most often, so that they can be prefetched.
+	FrequentLocationsService m_frequentLocationsService;
+	std::unique_ptr<FolderPrefetcher> m_folderPrefetcher;
 
 	HINSTANCE m_resourceInstance;
 
@@ -583,6 +621,7 @@ private:
 	ULONG m_SHChangeNotifyID;
 
 	/* Initialization. */
+	const ConfigFileSnapshot *m_configSnapshot;
 	BOOL m_bLoadSettingsFromXML;
 	bool m_applicationInitialized = false;
 	ApplicationInitializedSignal m_applicationInitializedSignal;
@@ -593,6 +632,7 @@ private:
 	std::unique_ptr<IconResourceLoader> m_iconResourceLoader;
 
 	CachedIcons m_cachedIcons;
+	std::unique_ptr<ThumbnailCache> m_thumbnailCache;
 
 	wil::com_ptr_nothrow<IImageList> m_mainMenuSystemImageList;
 	std::vector<wil::unique_hbitmap> m_mainMenuImages;
@@ -643,6 +683,9 @@ private:
 	std::shared_ptr<Config> m_config;
 	BOOL m_bSavePreferencesToXMLFile;
 
+	// Only set if the binary session store is enabled and could be opened.
+	std::unique_ptr<SessionStore> m_sessionStore;
+
 	bool m_themeValueLoadedFromXml = false;
 	bool m_groupSortDirectionGlobalLoadedFromXml = false;
 
@@ -655,6 +698,14 @@ private:
 	std::unique_ptr<BookmarksMainMenu> m_bookmarksMainMenu;
 	BookmarksToolbar *m_bookmarksToolbar;
 
+	// These need to be declared before any of the objects that queue tasks on them, so that they're
+	// destroyed after them.
+	WorkStealingExecutor m_backgroundExecutor;
+	PriorityTaskScheduler m_backgroundTaskScheduler;
+
+	// Opens the thumbnail store in the background, since that involves scanning the whole file.
+	WorkStealingExecutor::TaskGroup m_thumbnailStoreTaskGroup;
+
 	// IconFetcher retrieves file icons in a background thread. A queue of requests is maintained
 	// and that queue is cleared when the instance is destroyed. However, any current request that's
 	// running in the background thread will continue to run and the main thread will wait for it to
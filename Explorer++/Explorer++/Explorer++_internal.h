@@ -47,5 +47,3 @@ enum ExitCode
 	EXIT_CODE_NORMAL_CRASH_HANDLER,
 	EXIT_CODE_ERROR
 };
-
-BOOL TestConfigFileInternal(void);
@@ -12,6 +12,20 @@ BETTER_ENUM(Feature, int,
 	Plugins,
 
 	// When enabled, the quick access folder in the treeview will be automatically updated.
-	AutomaticQuickAccessUpdates
+	AutomaticQuickAccessUpdates,
+
+	// When enabled, the listview in each tab will be created in owner data (virtual) mode. In that
+	// mode, the listview doesn't store any per-item data itself, which allows very large folders
+	// to be shown. Grouping isn't supported in this mode.
+	OwnerDataListView,
+
+	// When enabled, the directories passed via --index-root will be indexed and kept up to date,
+	// allowing searches within them to be performed without walking the file system.
+	FileNameIndex,
+
+	// When enabled, tabs (including their history), bookmarks and default columns will be saved to
+	// a binary session store, which only writes the sections that have changed. The config
+	// file/registry is still written, so that it can be used to export those settings.
+	BinarySessionStore
 )
 // clang-format on
@@ -0,0 +1,433 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileNameIndexService.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ProcessHelper.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include <filesystem>
+#include <format>
+
+namespace
+{
+
+const WCHAR INDEX_DIRECTORY_NAME[] = L"FileNameIndex";
+
+bool ArePathsEqual(std::wstring_view path1, std::wstring_view path2)
+{
+	return CompareStringOrdinal(path1.data(), static_cast<int>(path1.size()), path2.data(),
+			   static_cast<int>(path2.size()), TRUE)
+		== CSTR_EQUAL;
+}
+
+}
+
+FileNameIndexService::FileNameIndexService(const std::vector<std::wstring> &rootPaths,
+	IDirectoryMonitor *directoryMonitor, WorkStealingExecutor *executor) :
+	m_directoryMonitor(directoryMonitor),
+	m_taskGroup(executor)
+{
+	for (const auto &rootPath : rootPaths)
+	{
+		auto root = std::make_unique<IndexedRoot>();
+		root->service = this;
+		root->path = rootPath;
+		root->indexFilePath = GetIndexFilePath(rootPath);
+
+		// Any changes that occur between now and the point at which the index is built will be
+		// recorded and replayed.
+		root->rebuilding = true;
+
+		// Without notifications, the index would quickly become out of date, so a root that can't
+		// be watched isn't indexed.
+		if (!WatchRoot(*root))
+		{
+			continue;
+		}
+
+		m_taskGroup.Submit([this, rootPtr = root.get()]() { LoadAndRebuildIndex(*rootPtr); });
+
+		m_roots.push_back(std::move(root));
+	}
+}
+
+// Note that the directory monitor is expected to have been stopped before this is called, so no
+// further notifications will be received.
+FileNameIndexService::~FileNameIndexService()
+{
+	// Any index that's currently being built will stop early. Indexes that haven't started being
+	// rebuilt yet don't need to be, since the existing index file will be retained.
+	m_stop = true;
+	m_taskGroup.Cancel();
+	m_taskGroup.WaitForRunningTasks();
+
+	for (auto &root : m_roots)
+	{
+		std::scoped_lock lock(root->mutex);
+
+		if (root->index)
+		{
+			root->index->Save(root->indexFilePath);
+		}
+	}
+}
+
+std::wstring FileNameIndexService::GetIndexFilePath(const std::wstring &rootPath)
+{
+	TCHAR indexDirectory[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), indexDirectory, SIZEOF_ARRAY(indexDirectory));
+	PathRemoveFileSpec(indexDirectory);
+	PathAppend(indexDirectory, INDEX_DIRECTORY_NAME);
+
+	// Since the root path is stored within the index file, it doesn't matter if two roots happen
+	// to generate the same file name. The root will be checked when the file is loaded.
+	std::wstring upperCaseRootPath = rootPath;
+	CharUpperBuff(upperCaseRootPath.data(), static_cast<DWORD>(upperCaseRootPath.size()));
+
+	return std::format(L"{}\\{:016x}.idx", indexDirectory,
+		std::hash<std::wstring>{}(upperCaseRootPath));
+}
+
+bool FileNameIndexService::WatchRoot(IndexedRoot &root)
+{
+	auto *watchContext = static_cast<WatchContext *>(malloc(sizeof(WatchContext)));
+
+	if (!watchContext)
+	{
+		return false;
+	}
+
+	watchContext->root = &root;
+
+	// The directory monitor will free the context if the directory can't be watched.
+	auto dirMonitorId = m_directoryMonitor->WatchDirectory(root.path.c_str(),
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE
+			| FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_ATTRIBUTES,
+		OnDirectoryAltered, TRUE, watchContext);
+
+	return dirMonitorId.has_value();
+}
+
+void FileNameIndexService::LoadAndRebuildIndex(IndexedRoot &root)
+{
+	auto loadedIndex = FileNameIndex::Load(root.indexFilePath);
+
+	// The root path stored in the index has been normalized, so the configured path needs to be
+	// normalized in the same way before the two can be compared.
+	if (loadedIndex
+		&& ArePathsEqual(loadedIndex->GetRootPath(), FileNameIndex(root.path).GetRootPath()))
+	{
+		std::scoped_lock lock(root.mutex);
+
+		for (const auto &change : root.changesDuringRebuild)
+		{
+			ApplyChange(*loadedIndex, change);
+		}
+
+		if (root.watched)
+		{
+			root.index = std::move(loadedIndex);
+		}
+	}
+
+	RebuildIndex(root);
+}
+
+void FileNameIndexService::RebuildIndex(IndexedRoot &root)
+{
+	auto builtIndex = FileNameIndex::Build(root.path, &m_stop);
+
+	std::scoped_lock lock(root.mutex);
+
+	if (m_stop || !root.watched)
+	{
+		// The built index is incomplete (or can't be kept up to date), so it's discarded. The
+		// existing index (if any) will be saved again, since it has been kept up to date.
+		root.rebuilding = false;
+		root.rebuildPending = false;
+		root.changesDuringRebuild.clear();
+		return;
+	}
+
+	if (root.rebuildPending)
+	{
+		// Changes continue to be recorded while the index is built again.
+		root.rebuildPending = false;
+		m_taskGroup.Submit([this, &root]() { RebuildIndex(root); });
+		return;
+	}
+
+	for (const auto &change : root.changesDuringRebuild)
+	{
+		ApplyChange(*builtIndex, change);
+	}
+
+	root.changesDuringRebuild.clear();
+	root.rebuilding = false;
+	root.watchRestarted = false;
+	root.index = std::move(builtIndex);
+
+	CreateDirectory(std::filesystem::path(root.indexFilePath).parent_path().c_str(), nullptr);
+	root.index->Save(root.indexFilePath);
+}
+
+// Must be called with the root's mutex held.
+void FileNameIndexService::ScheduleRebuild(IndexedRoot &root)
+{
+	if (root.rebuilding)
+	{
+		root.rebuildPending = true;
+		return;
+	}
+
+	root.rebuilding = true;
+	m_taskGroup.Submit([this, &root]() { RebuildIndex(root); });
+}
+
+void FileNameIndexService::RestartWatch(IndexedRoot &root)
+{
+	if (m_stop)
+	{
+		return;
+	}
+
+	{
+		// This is set before the root is watched again, since the new watch could stop
+		// immediately.
+		std::scoped_lock lock(root.mutex);
+		root.watchRestarted = true;
+	}
+
+	// The root may have been removed, or may be on a drive that's no longer available.
+	bool watched = WatchRoot(root);
+
+	std::scoped_lock lock(root.mutex);
+
+	if (!watched)
+	{
+		StopIndexingRoot(root);
+		return;
+	}
+
+	if (!root.watched)
+	{
+		return;
+	}
+
+	// Any changes made while the root wasn't being watched will be picked up by the rebuild.
+	ScheduleRebuild(root);
+}
+
+// Must be called with the root's mutex held. Searches within the root will fall back to the file
+// system from this point on.
+void FileNameIndexService::StopIndexingRoot(IndexedRoot &root)
+{
+	root.watched = false;
+	root.index.reset();
+	root.pendingChanges.clear();
+}
+
+void FileNameIndexService::OnDirectoryAltered(const TCHAR *fileName, DWORD action, void *data)
+{
+	auto *watchContext = static_cast<WatchContext *>(data);
+	auto *root = watchContext->root;
+	root->service->OnChange(*root, action, fileName);
+}
+
+// This is called on the directory monitor thread. Reading the details of an item (or walking an
+// added directory) can be slow, so that's left to a task on the executor. That way, the root's
+// mutex is only held briefly here and searches aren't held up.
+void FileNameIndexService::OnChange(IndexedRoot &root, DWORD action,
+	const std::wstring &relativePath)
+{
+	std::scoped_lock lock(root.mutex);
+
+	if (!root.watched)
+	{
+		return;
+	}
+
+	if (action == DIRECTORY_MONITOR_ACTION_OVERFLOW)
+	{
+		// There's no way of knowing which items were changed, so the index has to be rebuilt.
+		root.pendingRenameOldPath.clear();
+		ScheduleRebuild(root);
+		return;
+	}
+	else if (action == DIRECTORY_MONITOR_ACTION_STOPPED)
+	{
+		// If the watch has already been restarted and has stopped again before the index could be
+		// rebuilt, it's unlikely that the root can be kept up to date.
+		if (root.watchRestarted)
+		{
+			StopIndexingRoot(root);
+			return;
+		}
+
+		root.pendingRenameOldPath.clear();
+		m_taskGroup.Submit([this, &root]() { RestartWatch(root); });
+		return;
+	}
+
+	Change change;
+
+	if (action == FILE_ACTION_RENAMED_OLD_NAME)
+	{
+		root.pendingRenameOldPath = relativePath;
+		return;
+	}
+	else if (action == FILE_ACTION_RENAMED_NEW_NAME)
+	{
+		change = { action, std::exchange(root.pendingRenameOldPath, {}), relativePath };
+	}
+	else
+	{
+		change = { action, relativePath, {} };
+	}
+
+	root.pendingChanges.push_back(change);
+
+	if (root.processingChanges)
+	{
+		return;
+	}
+
+	root.processingChanges = true;
+	m_taskGroup.Submit([this, &root]() { ProcessPendingChanges(root); });
+}
+
+// Changes are processed in the order they were received. Only one task processes the changes for
+// a root at any one time, which ensures that order is maintained.
+void FileNameIndexService::ProcessPendingChanges(IndexedRoot &root)
+{
+	while (!m_stop)
+	{
+		std::vector<Change> changes;
+
+		{
+			std::scoped_lock lock(root.mutex);
+
+			if (root.pendingChanges.empty())
+			{
+				root.processingChanges = false;
+				return;
+			}
+
+			changes = std::exchange(root.pendingChanges, {});
+		}
+
+		std::vector<ResolvedChange> resolvedChanges;
+		resolvedChanges.reserve(changes.size());
+
+		for (const auto &change : changes)
+		{
+			resolvedChanges.push_back(ResolveChange(root, change));
+		}
+
+		std::scoped_lock lock(root.mutex);
+
+		for (const auto &resolvedChange : resolvedChanges)
+		{
+			if (root.rebuilding)
+			{
+				root.changesDuringRebuild.push_back(resolvedChange);
+			}
+
+			if (root.index)
+			{
+				ApplyChange(*root.index, resolvedChange);
+			}
+		}
+	}
+}
+
+FileNameIndexService::ResolvedChange FileNameIndexService::ResolveChange(const IndexedRoot &root,
+	const Change &change)
+{
+	ResolvedChange resolvedChange;
+	resolvedChange.change = change;
+
+	if (change.action != FILE_ACTION_ADDED && change.action != FILE_ACTION_MODIFIED)
+	{
+		return resolvedChange;
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	auto fullPath = std::filesystem::path(root.path) / change.relativePath;
+	BOOL res = GetFileAttributesEx(fullPath.c_str(), GetFileExInfoStandard, &attributeData);
+
+	if (!res)
+	{
+		// The item may have already been removed again, in which case there will be a subsequent
+		// notification.
+		return resolvedChange;
+	}
+
+	FileNameIndex::ItemData itemData;
+	itemData.size =
+		(static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+	itemData.lastWriteTime =
+		(static_cast<uint64_t>(attributeData.ftLastWriteTime.dwHighDateTime) << 32)
+		| attributeData.ftLastWriteTime.dwLowDateTime;
+	itemData.attributes = attributeData.dwFileAttributes;
+	resolvedChange.itemData = itemData;
+
+	if (change.action == FILE_ACTION_ADDED
+		&& WI_IsFlagSet(itemData.attributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		resolvedChange.directoryContents = FileNameIndex::Build(fullPath.native(), &m_stop);
+	}
+
+	return resolvedChange;
+}
+
+void FileNameIndexService::ApplyChange(FileNameIndex &index, const ResolvedChange &resolvedChange)
+{
+	const auto &change = resolvedChange.change;
+
+	switch (change.action)
+	{
+	case FILE_ACTION_ADDED:
+	case FILE_ACTION_MODIFIED:
+		if (!resolvedChange.itemData)
+		{
+			break;
+		}
+
+		index.AddOrUpdateItem(change.relativePath, *resolvedChange.itemData);
+
+		if (resolvedChange.directoryContents)
+		{
+			index.AddDirectoryContents(change.relativePath, *resolvedChange.directoryContents);
+		}
+		break;
+
+	case FILE_ACTION_REMOVED:
+		index.RemoveItem(change.relativePath);
+		break;
+
+	case FILE_ACTION_RENAMED_NEW_NAME:
+		index.RenameItem(change.relativePath, change.newRelativePath);
+		break;
+	}
+}
+
+std::optional<std::vector<FileNameIndex::Item>> FileNameIndexService::FindItems(
+	std::wstring_view directory, const FileNameIndex::MatchFunction &matchFunction)
+{
+	for (auto &root : m_roots)
+	{
+		std::scoped_lock lock(root->mutex);
+
+		if (!root->index || !root->index->CoversPath(directory))
+		{
+			continue;
+		}
+
+		return root->index->FindItems(directory, matchFunction);
+	}
+
+	return std::nullopt;
+}
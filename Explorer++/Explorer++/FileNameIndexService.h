@@ -0,0 +1,123 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/FileNameIndex.h"
+#include "../Helper/WorkStealingExecutor.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+__interface IDirectoryMonitor;
+
+// Maintains a FileNameIndex for each of a set of root directories. Each index is loaded from disk
+// at startup (so that it can be queried immediately) and then rebuilt in the background, since
+// changes may have been made while the application wasn't running. Once an index is available, it's
+// kept up to date by watching the root directory for changes.
+//
+// If the directory monitor drops notifications (e.g. because a large number of changes were made at
+// once), the index is rebuilt. If the root stops being watched and can't be watched again, its
+// index is discarded.
+class FileNameIndexService
+{
+public:
+	FileNameIndexService(const std::vector<std::wstring> &rootPaths,
+		IDirectoryMonitor *directoryMonitor, WorkStealingExecutor *executor);
+	~FileNameIndexService();
+
+	// Searches the index covering the specified directory. Returns std::nullopt if there is no such
+	// index, or if it hasn't been loaded/built yet, in which case the caller should fall back to
+	// searching the file system.
+	std::optional<std::vector<FileNameIndex::Item>> FindItems(std::wstring_view directory,
+		const FileNameIndex::MatchFunction &matchFunction);
+
+private:
+	struct Change
+	{
+		DWORD action;
+		std::wstring relativePath;
+
+		// Only used for renames.
+		std::wstring newRelativePath;
+	};
+
+	// A change, along with any details that had to be read from the file system in order to apply
+	// it. Those details are read before the root's mutex is locked, so that applying the change
+	// only takes a short amount of time.
+	struct ResolvedChange
+	{
+		Change change;
+
+		// Only set for items that were added or modified and could still be found.
+		std::optional<FileNameIndex::ItemData> itemData;
+
+		// Only set when a directory is added, since it may have been moved in from outside the
+		// root, in which case no notifications will be sent for its contents.
+		std::shared_ptr<const FileNameIndex> directoryContents;
+	};
+
+	struct IndexedRoot
+	{
+		FileNameIndexService *service = nullptr;
+		std::wstring path;
+		std::wstring indexFilePath;
+
+		std::mutex mutex;
+		std::unique_ptr<FileNameIndex> index;
+
+		// Changes are queued here by the directory monitor callback and then processed on the
+		// executor.
+		std::vector<Change> pendingChanges;
+		bool processingChanges = false;
+
+		// Changes that arrive while the index is being rebuilt are recorded here and applied to the
+		// new index once it's ready.
+		bool rebuilding = false;
+		std::vector<ResolvedChange> changesDuringRebuild;
+
+		// Set if notifications are lost while the index is being rebuilt, in which case the index
+		// that's being built may not reflect those changes and has to be built again.
+		bool rebuildPending = false;
+
+		// Set once the root has been watched again, after the original watch stopped. If the
+		// watch stops again before the index has been rebuilt, the root is no longer indexed.
+		bool watchRestarted = false;
+		bool watched = true;
+
+		// The old name from a FILE_ACTION_RENAMED_OLD_NAME notification. The corresponding
+		// FILE_ACTION_RENAMED_NEW_NAME notification is expected to follow immediately.
+		std::wstring pendingRenameOldPath;
+	};
+
+	// Passed to the directory monitor, which frees it using free().
+	struct WatchContext
+	{
+		IndexedRoot *root;
+	};
+
+	static std::wstring GetIndexFilePath(const std::wstring &rootPath);
+	static void OnDirectoryAltered(const TCHAR *fileName, DWORD action, void *data);
+
+	bool WatchRoot(IndexedRoot &root);
+	void LoadAndRebuildIndex(IndexedRoot &root);
+	void RebuildIndex(IndexedRoot &root);
+	void ScheduleRebuild(IndexedRoot &root);
+	void RestartWatch(IndexedRoot &root);
+	void StopIndexingRoot(IndexedRoot &root);
+	void OnChange(IndexedRoot &root, DWORD action, const std::wstring &relativePath);
+	void ProcessPendingChanges(IndexedRoot &root);
+	ResolvedChange ResolveChange(const IndexedRoot &root, const Change &change);
+	static void ApplyChange(FileNameIndex &index, const ResolvedChange &resolvedChange);
+
+	IDirectoryMonitor *const m_directoryMonitor;
+	std::vector<std::unique_ptr<IndexedRoot>> m_roots;
+	std::atomic<bool> m_stop = false;
+
+	// Declared last, since the indexing tasks use the members above.
+	WorkStealingExecutor::TaskGroup m_taskGroup;
+};
@@ -0,0 +1,220 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderEnumerationService.h"
+#include "../Helper/ShellHelper.h"
+#include <algorithm>
+
+FolderEnumerationService::FolderEnumerationService(HWND hwnd) :
+	m_cache(MAX_MEMORY_USAGE),
+	m_shellChangeWatcher(hwnd,
+		std::bind_front(&FolderEnumerationService::ProcessShellChangeNotifications, this))
+{
+	unique_pidl_absolute rootPidl;
+	HRESULT hr = GetRootPidl(wil::out_param(rootPidl));
+
+	if (SUCCEEDED(hr))
+	{
+		// Monitoring a folder won't detect changes to its ancestors. If one of the ancestors is
+		// renamed or deleted, the folder may later be replaced by an entirely different folder
+		// with the same path. So, as in ShellBrowserImpl, these changes are monitored globally.
+		m_shellChangeWatcher.StartWatching(rootPidl.get(),
+			SHCNE_RENAMEFOLDER | SHCNE_RMDIR | SHCNE_UPDATEDIR, true);
+	}
+}
+
+std::optional<FolderEnumerationService::EnumerationTicket>
+FolderEnumerationService::StartEnumeration(PCIDLIST_ABSOLUTE pidl, EnumerationType type)
+{
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	// The folder is monitored before the generation is retrieved, so that any change made after
+	// the enumeration has started will be detected.
+	bool cacheable = WatchFolder(pidl, path, type);
+
+	return EnumerationTicket{ pidl, path, m_cache.GetGeneration(), cacheable };
+}
+
+std::shared_ptr<const FolderEnumerationService::ItemList> FolderEnumerationService::GetCachedItems(
+	const EnumerationTicket &ticket, Contents contents)
+{
+	return m_cache.Get(ticket.pidl.Raw(), ticket.path, contents);
+}
+
+std::shared_ptr<const FolderEnumerationService::ItemList> FolderEnumerationService::GetCachedItems(
+	PCIDLIST_ABSOLUTE pidl, Contents contents)
+{
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return m_cache.Get(pidl, path, contents);
+}
+
+void FolderEnumerationService::CacheItems(const EnumerationTicket &ticket, Contents contents,
+	ItemList items)
+{
+	if (!ticket.cacheable)
+	{
+		return;
+	}
+
+	m_cache.Insert(ticket.pidl.Raw(), ticket.path, contents, std::move(items), ticket.generation);
+}
+
+void FolderEnumerationService::InvalidateFolder(const std::wstring &path)
+{
+	m_cache.InvalidateFolder(path);
+}
+
+void FolderEnumerationService::InvalidateTree(const std::wstring &path)
+{
+	m_cache.InvalidateTree(path);
+}
+
+bool FolderEnumerationService::WatchFolder(PCIDLIST_ABSOLUTE pidl, const std::wstring &path,
+	EnumerationType type)
+{
+	if (auto itr = FindWatchedFolder(m_watchedFolders, pidl); itr != m_watchedFolders.end())
+	{
+		// Prefetching a folder doesn't count as a use of it, so a folder that's prefetched
+		// repeatedly won't be kept around at the expense of the folders that are actually shown.
+		if (type == EnumerationType::Normal)
+		{
+			m_watchedFolders.splice(m_watchedFolders.begin(), m_watchedFolders, itr);
+		}
+
+		return true;
+	}
+
+	if (auto itr = FindWatchedFolder(m_prefetchedFolders, pidl); itr != m_prefetchedFolders.end())
+	{
+		if (type == EnumerationType::Normal)
+		{
+			m_watchedFolders.splice(m_watchedFolders.begin(), m_prefetchedFolders, itr);
+			RemoveExcessWatchedFolders(m_watchedFolders, MAX_WATCHED_FOLDERS);
+		}
+		else
+		{
+			m_prefetchedFolders.splice(m_prefetchedFolders.begin(), m_prefetchedFolders, itr);
+		}
+
+		return true;
+	}
+
+	ULONG changeNotifyId = m_shellChangeWatcher.StartWatching(pidl,
+		SHCNE_ATTRIBUTES | SHCNE_CREATE | SHCNE_DELETE | SHCNE_MKDIR | SHCNE_RENAMEFOLDER
+			| SHCNE_RENAMEITEM | SHCNE_RMDIR | SHCNE_UPDATEDIR | SHCNE_UPDATEITEM | SHCNE_DRIVEADD
+			| SHCNE_DRIVEREMOVED);
+
+	if (changeNotifyId == 0)
+	{
+		return false;
+	}
+
+	if (type == EnumerationType::Normal)
+	{
+		m_watchedFolders.push_front({ pidl, path, changeNotifyId });
+		RemoveExcessWatchedFolders(m_watchedFolders, MAX_WATCHED_FOLDERS);
+	}
+	else
+	{
+		m_prefetchedFolders.push_front({ pidl, path, changeNotifyId });
+		RemoveExcessWatchedFolders(m_prefetchedFolders, MAX_PREFETCHED_FOLDERS);
+	}
+
+	return true;
+}
+
+// As with the cache, folders are identified by their pidl, since the folders that share a path
+// aren't necessarily the same.
+std::list<FolderEnumerationService::WatchedFolder>::iterator
+FolderEnumerationService::FindWatchedFolder(std::list<WatchedFolder> &watchedFolders,
+	PCIDLIST_ABSOLUTE pidl)
+{
+	return std::find_if(watchedFolders.begin(), watchedFolders.end(),
+		[pidl](const WatchedFolder &watchedFolder)
+		{ return ArePidlsEquivalent(pidl, watchedFolder.pidl.Raw()); });
+}
+
+void FolderEnumerationService::RemoveExcessWatchedFolders(std::list<WatchedFolder> &watchedFolders,
+	size_t maxFolders)
+{
+	while (watchedFolders.size() > maxFolders)
+	{
+		const auto &leastRecentlyUsed = watchedFolders.back();
+		m_shellChangeWatcher.StopWatching(leastRecentlyUsed.changeNotifyId);
+
+		// Changes to the folder will no longer be detected, so any entry for it can't be kept.
+		// Entries are only invalidated by path, so this will also drop the entry for any other
+		// folder that shares the path, though that entry will simply be recreated when needed.
+		m_cache.InvalidateFolder(leastRecentlyUsed.path);
+
+		watchedFolders.pop_back();
+	}
+}
+
+void FolderEnumerationService::ProcessShellChangeNotifications(
+	const std::vector<ShellChangeNotification> &shellChangeNotifications)
+{
+	for (const auto &change : shellChangeNotifications)
+	{
+		if (change.pidl1)
+		{
+			InvalidateForChangedItem(change.pidl1.get());
+		}
+
+		if (change.pidl2)
+		{
+			InvalidateForChangedItem(change.pidl2.get());
+		}
+	}
+}
+
+// The item that's changed may be a folder, in which case the entries for it (and for any of its
+// descendants) are out of date. The items in its parent folder have also changed.
+void FolderEnumerationService::InvalidateForChangedItem(PCIDLIST_ABSOLUTE pidl)
+{
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		// There's no way of determining which entries are affected.
+		m_cache.InvalidateAll();
+		return;
+	}
+
+	m_cache.InvalidateTree(path);
+
+	unique_pidl_absolute parentPidl(ILCloneFull(pidl));
+
+	if (!ILRemoveLastID(parentPidl.get()))
+	{
+		// The item is the root of the namespace, so there's no parent folder.
+		return;
+	}
+
+	std::wstring parentPath;
+	hr = GetDisplayName(parentPidl.get(), SHGDN_FORPARSING, parentPath);
+
+	if (FAILED(hr))
+	{
+		m_cache.InvalidateAll();
+		return;
+	}
+
+	m_cache.InvalidateFolder(parentPath);
+}
@@ -0,0 +1,105 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellChangeWatcher.h"
+#include "../Helper/FolderEnumerationCache.h"
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Shares the results of folder enumerations between the listview in each tab and the treeview, so
+// that a folder that's already been enumerated in one place can be shown in another (e.g. when
+// opening a new tab to the same folder, or when the treeview expands to the folder shown in the
+// listview) without going back to the shell.
+//
+// Each folder that's cached is monitored for changes, so that its entry can be removed as soon as
+// it's out of date. Only a limited number of folders are monitored at once. Once that limit is
+// reached, the least recently used folder stops being monitored and its entry is dropped. If a
+// folder can't be monitored at all, its items aren't cached.
+//
+// Folders that are only being prefetched are monitored separately, with their own, smaller,
+// limit. That way, prefetching can never cause one of the folders that's actually shown (e.g. in a
+// tab) to stop being monitored. A prefetched folder moves over to the main set of monitored
+// folders once it's enumerated normally.
+class FolderEnumerationService
+{
+public:
+	using Contents = FolderEnumerationCache::Contents;
+	using ItemList = FolderEnumerationCache::ItemList;
+
+	enum class EnumerationType
+	{
+		Normal,
+
+		// The folder isn't being shown anywhere yet, it's being enumerated in advance.
+		Prefetch
+	};
+
+	// Identifies a folder that's about to be enumerated.
+	struct EnumerationTicket
+	{
+		PidlAbsolute pidl;
+
+		// Only used to detect changes to the folder. Different folders can share a path, so the
+		// pidl identifies the folder itself.
+		std::wstring path;
+
+		uint64_t generation;
+
+		// False if the folder couldn't be monitored, in which case the results of the enumeration
+		// won't be cached.
+		bool cacheable;
+	};
+
+	// The window is used to receive change notifications.
+	explicit FolderEnumerationService(HWND hwnd);
+
+	// This should be called on the UI thread, before the folder is enumerated. It starts monitoring
+	// the folder, if it's not already being monitored. Returns std::nullopt if the folder's path
+	// couldn't be retrieved. Folders that are being prefetched should pass
+	// EnumerationType::Prefetch.
+	std::optional<EnumerationTicket> StartEnumeration(PCIDLIST_ABSOLUTE pidl,
+		EnumerationType type = EnumerationType::Normal);
+
+	// The methods below can be called from any thread.
+	std::shared_ptr<const ItemList> GetCachedItems(const EnumerationTicket &ticket,
+		Contents contents);
+	std::shared_ptr<const ItemList> GetCachedItems(PCIDLIST_ABSOLUTE pidl, Contents contents);
+	void CacheItems(const EnumerationTicket &ticket, Contents contents, ItemList items);
+
+	// Used when a change has been detected by some other means (e.g. by a directory monitor).
+	void InvalidateFolder(const std::wstring &path);
+	void InvalidateTree(const std::wstring &path);
+
+private:
+	static const size_t MAX_MEMORY_USAGE = 32 * 1024 * 1024;
+	static const size_t MAX_WATCHED_FOLDERS = 64;
+	static const size_t MAX_PREFETCHED_FOLDERS = 16;
+
+	struct WatchedFolder
+	{
+		PidlAbsolute pidl;
+		std::wstring path;
+		ULONG changeNotifyId;
+	};
+
+	void ProcessShellChangeNotifications(
+		const std::vector<ShellChangeNotification> &shellChangeNotifications);
+	void InvalidateForChangedItem(PCIDLIST_ABSOLUTE pidl);
+	bool WatchFolder(PCIDLIST_ABSOLUTE pidl, const std::wstring &path, EnumerationType type);
+	static std::list<WatchedFolder>::iterator FindWatchedFolder(
+		std::list<WatchedFolder> &watchedFolders, PCIDLIST_ABSOLUTE pidl);
+	void RemoveExcessWatchedFolders(std::list<WatchedFolder> &watchedFolders, size_t maxFolders);
+
+	FolderEnumerationCache m_cache;
+	ShellChangeWatcher m_shellChangeWatcher;
+
+	// Both of these are ordered from most to least recently used.
+	std::list<WatchedFolder> m_watchedFolders;
+	std::list<WatchedFolder> m_prefetchedFolders;
+};
@@ -0,0 +1,462 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderPrefetcher.h"
+#include "Config.h"
+#include "FrequentLocationsService.h"
+#include "HistoryService.h"
+#include "IconFetcherImpl.h"
+#include "ShellBrowser/ShellBrowserImpl.h"
+#include "../Helper/ShellHelper.h"
+#include "../Helper/WindowSubclassWrapper.h"
+#include <wil/common.h>
+#include <wil/resource.h>
+#include <algorithm>
+
+FolderPrefetcher::FolderPrefetcher(HWND hwnd, const Config *config,
+	const FrequentLocationsService *frequentLocationsService,
+	const HistoryService *historyService, FolderEnumerationService *folderEnumerationService,
+	CachedIcons *cachedIcons, WorkStealingExecutor *executor) :
+	m_hwnd(hwnd),
+	m_config(config),
+	m_frequentLocationsService(frequentLocationsService),
+	m_historyService(historyService),
+	m_folderEnumerationService(folderEnumerationService),
+	m_cachedIcons(cachedIcons),
+	m_timerManager(hwnd),
+	m_idleTimer(&m_timerManager),
+	m_taskGroup(executor)
+{
+	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(hwnd,
+		std::bind_front(&FolderPrefetcher::WindowSubclass, this)));
+}
+
+FolderPrefetcher::~FolderPrefetcher()
+{
+	// Any pass that's running will stop as soon as it sees this, which means that destroying the
+	// task group won't have to wait for the pass to run to completion.
+	CancelPass();
+}
+
+LRESULT FolderPrefetcher::WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+	case WM_APP_PREFETCHED_ICONS_READY:
+		ProcessPrefetchedIcons();
+		return 0;
+
+	case WM_APP_PREFETCH_CANDIDATES_READY:
+		OnCandidatesReady();
+		return 0;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+void FolderPrefetcher::OnFolderChanged(const PidlAbsolute &currentFolder, bool showHidden)
+{
+	CancelPass();
+
+	if (!m_config->prefetchFolders)
+	{
+		return;
+	}
+
+	m_currentFolder = currentFolder;
+	m_showHidden = showHidden;
+
+	m_idleTimer.Start(IDLE_DELAY, std::bind_front(&FolderPrefetcher::OnIdleTimer, this));
+}
+
+void FolderPrefetcher::CancelPass()
+{
+	m_idleTimer.Stop();
+
+	if (m_passCancelled)
+	{
+		*m_passCancelled = true;
+		m_passCancelled.reset();
+	}
+
+	m_taskGroup.Cancel();
+}
+
+void FolderPrefetcher::OnIdleTimer()
+{
+	// The timer only indicates that there hasn't been a navigation recently. If the user has
+	// interacted with the application in the meantime, the pass is delayed until there's been no
+	// input for the full delay.
+	LASTINPUTINFO lastInputInfo = {};
+	lastInputInfo.cbSize = sizeof(lastInputInfo);
+
+	if (GetLastInputInfo(&lastInputInfo))
+	{
+		std::chrono::milliseconds idleTime(GetTickCount() - lastInputInfo.dwTime);
+
+		if (idleTime < IDLE_DELAY)
+		{
+			m_idleTimer.Start(IDLE_DELAY - idleTime,
+				std::bind_front(&FolderPrefetcher::OnIdleTimer, this));
+			return;
+		}
+	}
+
+	StartPass();
+}
+
+// Only the locations themselves are retrieved here, since the services they come from are only
+// used on this thread. Everything else needed to choose the folders (e.g. retrieving their paths
+// and checking the type of drive they're on) can be slow, so is done in the background.
+void FolderPrefetcher::StartPass()
+{
+	PassLocations passLocations;
+	passLocations.currentFolder = m_currentFolder;
+	passLocations.showHidden = m_showHidden;
+	passLocations.excludeNetworkRemovable = m_config->disablePrefetchingNetworkRemovable;
+
+	for (const auto &visit : m_frequentLocationsService->GetVisits())
+	{
+		if (passLocations.frequentLocations.size() == MAX_FREQUENT_LOCATIONS)
+		{
+			break;
+		}
+
+		passLocations.frequentLocations.push_back(visit.GetLocation());
+	}
+
+	for (const auto &historyItem : m_historyService->GetHistoryItems())
+	{
+		if (passLocations.recentLocations.size() == MAX_RECENT_LOCATIONS)
+		{
+			break;
+		}
+
+		passLocations.recentLocations.push_back(historyItem);
+	}
+
+	m_passCancelled = std::make_shared<std::atomic<bool>>(false);
+
+	m_taskGroup.Submit(
+		[this, passLocations = std::move(passLocations), cancelled = m_passCancelled]()
+		{ FindCandidatesAsync(passLocations, cancelled); },
+		WorkStealingExecutor::Apartment::Required);
+}
+
+// Runs on a background thread.
+void FolderPrefetcher::FindCandidatesAsync(const PassLocations &passLocations,
+	std::shared_ptr<std::atomic<bool>> cancelled)
+{
+	auto candidates = GetCandidateFolders(passLocations);
+
+	if (*cancelled || candidates.empty())
+	{
+		return;
+	}
+
+	{
+		std::scoped_lock lock(m_candidatesMutex);
+		m_candidates = PrefetchCandidates{ std::move(cancelled), std::move(candidates),
+			passLocations.showHidden };
+	}
+
+	PostMessage(m_hwnd, WM_APP_PREFETCH_CANDIDATES_READY, 0, 0);
+}
+
+void FolderPrefetcher::OnCandidatesReady()
+{
+	std::optional<PrefetchCandidates> candidates;
+
+	{
+		std::scoped_lock lock(m_candidatesMutex);
+		candidates = std::move(m_candidates);
+		m_candidates.reset();
+	}
+
+	// The pass may have been abandoned while the candidates were being chosen.
+	if (!candidates || *candidates->cancelled)
+	{
+		return;
+	}
+
+	std::vector<PrefetchFolder> folders;
+
+	for (const auto &pidl : candidates->folders)
+	{
+		// Starting the enumeration here means that the folder will be monitored for changes. That
+		// has to happen on this thread, before the folder is enumerated.
+		auto ticket = m_folderEnumerationService->StartEnumeration(pidl.Raw(),
+			FolderEnumerationService::EnumerationType::Prefetch);
+
+		if (!ticket || !ticket->cacheable)
+		{
+			continue;
+		}
+
+		folders.push_back({ pidl, *ticket });
+	}
+
+	if (folders.empty())
+	{
+		return;
+	}
+
+	m_taskGroup.Submit(
+		[this, folders = std::move(folders), showHidden = candidates->showHidden,
+			cancelled = candidates->cancelled]()
+		{ PrefetchFoldersAsync(folders, showHidden, *cancelled); },
+		WorkStealingExecutor::Apartment::Required);
+}
+
+// Returns the folders that should be prefetched, in order of priority. Folders that have already
+// been cached, or that shouldn't be prefetched, are excluded. Runs on a background thread.
+std::vector<PidlAbsolute> FolderPrefetcher::GetCandidateFolders(
+	const PassLocations &passLocations) const
+{
+	std::vector<PidlAbsolute> locations = passLocations.frequentLocations;
+
+	unique_pidl_absolute parent(ILCloneFull(passLocations.currentFolder.Raw()));
+
+	if (ILRemoveLastID(parent.get()))
+	{
+		locations.emplace_back(parent.get());
+	}
+
+	auto subfolders = GetSubfolders(passLocations.currentFolder, passLocations.showHidden);
+	locations.insert(locations.end(), subfolders.begin(), subfolders.end());
+
+	locations.insert(locations.end(), passLocations.recentLocations.begin(),
+		passLocations.recentLocations.end());
+
+	std::wstring currentFolderPath;
+	GetDisplayName(passLocations.currentFolder.Raw(), SHGDN_FORPARSING, currentFolderPath);
+
+	std::vector<std::wstring> seenPaths = { currentFolderPath };
+	std::vector<PidlAbsolute> candidates;
+
+	for (const auto &location : locations)
+	{
+		if (candidates.size() == MAX_FOLDERS_PER_PASS)
+		{
+			break;
+		}
+
+		std::wstring path;
+		HRESULT hr = GetDisplayName(location.Raw(), SHGDN_FORPARSING, path);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		bool seen = std::any_of(seenPaths.begin(), seenPaths.end(),
+			[&path](const std::wstring &seenPath) {
+				return CompareStringOrdinal(path.c_str(), -1, seenPath.c_str(), -1, TRUE)
+					== CSTR_EQUAL;
+			});
+
+		if (seen)
+		{
+			continue;
+		}
+
+		seenPaths.push_back(path);
+
+		if (!ShouldPrefetch(path, passLocations.excludeNetworkRemovable)
+			|| m_folderEnumerationService->GetCachedItems(location.Raw(),
+				ShellBrowserImpl::GetEnumerationContents(passLocations.showHidden)))
+		{
+			continue;
+		}
+
+		candidates.push_back(location);
+	}
+
+	return candidates;
+}
+
+// The subfolders of the current folder are taken from the cache, since the current folder will
+// generally have just been enumerated. The most recently modified subfolders are assumed to be the
+// ones most likely to be opened next.
+std::vector<PidlAbsolute> FolderPrefetcher::GetSubfolders(const PidlAbsolute &currentFolder,
+	bool showHidden) const
+{
+	auto contents = FolderEnumerationService::Contents::Folders
+		| FolderEnumerationService::Contents::Details;
+
+	if (showHidden)
+	{
+		WI_SetFlag(contents, FolderEnumerationService::Contents::IncludeHidden);
+	}
+
+	auto cachedItems = m_folderEnumerationService->GetCachedItems(currentFolder.Raw(), contents);
+
+	if (!cachedItems)
+	{
+		return {};
+	}
+
+	std::vector<const FolderEnumerationCache::Item *> subfolders;
+
+	for (const auto &item : *cachedItems)
+	{
+		if (FolderEnumerationCache::IsIncluded(item, FolderEnumerationService::Contents::Folders)
+			&& item.findData)
+		{
+			subfolders.push_back(&item);
+		}
+	}
+
+	size_t numSubfolders = std::min(subfolders.size(), MAX_SUBFOLDERS);
+	std::partial_sort(subfolders.begin(), subfolders.begin() + numSubfolders, subfolders.end(),
+		[](const FolderEnumerationCache::Item *item1, const FolderEnumerationCache::Item *item2) {
+			return CompareFileTime(&item1->findData->ftLastWriteTime,
+					   &item2->findData->ftLastWriteTime)
+				> 0;
+		});
+
+	std::vector<PidlAbsolute> subfolderPidls;
+
+	for (size_t i = 0; i < numSubfolders; i++)
+	{
+		unique_pidl_absolute pidl(ILCombine(currentFolder.Raw(), subfolders[i]->pidl.Raw()));
+		subfolderPidls.emplace_back(pidl.get());
+	}
+
+	return subfolderPidls;
+}
+
+bool FolderPrefetcher::ShouldPrefetch(const std::wstring &path, bool excludeNetworkRemovable)
+{
+	bool networkPath = PathIsUNC(path.c_str());
+
+	// Only filesystem folders, which have either a drive-based or UNC path, are prefetched.
+	if (!networkPath && PathGetDriveNumber(path.c_str()) == -1)
+	{
+		return false;
+	}
+
+	if (!excludeNetworkRemovable)
+	{
+		return true;
+	}
+
+	if (networkPath)
+	{
+		return false;
+	}
+
+	std::wstring root = path.substr(0, 3);
+	UINT driveType = GetDriveType(root.c_str());
+
+	return driveType != DRIVE_REMOTE && driveType != DRIVE_REMOVABLE && driveType != DRIVE_CDROM;
+}
+
+// Runs on a background thread.
+void FolderPrefetcher::PrefetchFoldersAsync(const std::vector<PrefetchFolder> &folders,
+	bool showHidden, const std::atomic<bool> &cancelled)
+{
+	// Background mode lowers the CPU, I/O and memory priority of the thread, so that the pass
+	// interferes as little as possible with anything else that's running.
+	bool backgroundMode = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+	auto endBackgroundMode = wil::scope_exit(
+		[backgroundMode]
+		{
+			if (backgroundMode)
+			{
+				SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+			}
+		});
+
+	auto deadline = std::chrono::steady_clock::now() + MAX_PASS_DURATION;
+	std::function<bool()> shouldContinue = [&cancelled, deadline]()
+	{ return !cancelled && std::chrono::steady_clock::now() < deadline; };
+
+	for (const auto &folder : folders)
+	{
+		if (!shouldContinue())
+		{
+			break;
+		}
+
+		HRESULT hr = ShellBrowserImpl::CacheFolderItems(folder.pidl.Raw(), showHidden,
+			m_folderEnumerationService, folder.ticket, MAX_ITEMS_PER_FOLDER, shouldContinue);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		PrefetchIconsAsync(folder, showHidden, shouldContinue);
+	}
+}
+
+// Runs on a background thread.
+void FolderPrefetcher::PrefetchIconsAsync(const PrefetchFolder &folder, bool showHidden,
+	const std::function<bool()> &shouldContinue)
+{
+	// The items may not have been cached (e.g. if the folder changed while it was being
+	// enumerated), in which case there's nothing to do here.
+	auto cachedItems = m_folderEnumerationService->GetCachedItems(folder.ticket,
+		ShellBrowserImpl::GetEnumerationContents(showHidden));
+
+	if (!cachedItems)
+	{
+		return;
+	}
+
+	std::vector<CachedIcon> icons;
+
+	for (const auto &item : *cachedItems)
+	{
+		if (icons.size() == MAX_ICONS_PER_FOLDER || !shouldContinue())
+		{
+			break;
+		}
+
+		unique_pidl_absolute pidl(ILCombine(folder.pidl.Raw(), item.pidl.Raw()));
+		auto iconIndex = IconFetcherImpl::FindIconAsync(pidl.get());
+
+		if (iconIndex)
+		{
+			icons.push_back({ item.parsingName, *iconIndex });
+		}
+	}
+
+	if (icons.empty())
+	{
+		return;
+	}
+
+	{
+		std::scoped_lock lock(m_prefetchedIconsMutex);
+		m_prefetchedIcons.insert(m_prefetchedIcons.end(), std::make_move_iterator(icons.begin()),
+			std::make_move_iterator(icons.end()));
+	}
+
+	PostMessage(m_hwnd, WM_APP_PREFETCHED_ICONS_READY, 0, 0);
+}
+
+void FolderPrefetcher::ProcessPrefetchedIcons()
+{
+	std::vector<CachedIcon> prefetchedIcons;
+
+	{
+		std::scoped_lock lock(m_prefetchedIconsMutex);
+		prefetchedIcons = std::move(m_prefetchedIcons);
+		m_prefetchedIcons.clear();
+	}
+
+	for (const auto &icon : prefetchedIcons)
+	{
+		// Icons that are already cached are left as-is, so that prefetching doesn't change the
+		// order in which existing icons will be evicted.
+		if (m_cachedIcons->findByPath(icon.filePath) == m_cachedIcons->end())
+		{
+			m_cachedIcons->insert(icon);
+		}
+	}
+}
@@ -0,0 +1,137 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FolderEnumerationService.h"
+#include "OneShotTimer.h"
+#include "OneShotTimerManager.h"
+#include "../Helper/CachedIcons.h"
+#include "../Helper/PidlHelper.h"
+#include "../Helper/WorkStealingExecutor.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct Config;
+class FrequentLocationsService;
+class HistoryService;
+class WindowSubclassWrapper;
+
+// Warms the enumeration and icon caches for the folders that are likely to be navigated to next,
+// so that navigating to them is close to instant. Once the application has been idle for a short
+// period after a navigation, the most frequently and most recently visited folders, along with the
+// parent and subfolders of the current folder, are enumerated in the background.
+//
+// The amount of work done is strictly limited. Each pass only covers a small number of folders,
+// stops once a time limit has been reached and runs in background mode, which lowers the CPU and
+// I/O priority of the thread. Apart from starting to monitor the chosen folders, which has to be
+// done on the UI thread, all of the work (including choosing the folders) is done in the
+// background. A pass is abandoned as soon as another navigation occurs. Large
+// folders aren't cached and only filesystem folders are prefetched, since enumerating a virtual
+// folder can have side effects (e.g. it may result in a prompt for credentials).
+class FolderPrefetcher
+{
+public:
+	FolderPrefetcher(HWND hwnd, const Config *config,
+		const FrequentLocationsService *frequentLocationsService,
+		const HistoryService *historyService, FolderEnumerationService *folderEnumerationService,
+		CachedIcons *cachedIcons, WorkStealingExecutor *executor);
+	~FolderPrefetcher();
+
+	// Should be called whenever the folder shown in the active tab changes. Any pass that's in
+	// progress is abandoned and a new pass is scheduled, based around the new folder.
+	void OnFolderChanged(const PidlAbsolute &currentFolder, bool showHidden);
+
+private:
+	// As with IconFetcherImpl, the window passed to the constructor is subclassed, so a value at
+	// the end of the WM_APP range is used to try to avoid clashing with other messages.
+	static const UINT WM_APP_PREFETCHED_ICONS_READY = 0xBFFE;
+	static const UINT WM_APP_PREFETCH_CANDIDATES_READY = 0xBFFD;
+
+	static constexpr std::chrono::milliseconds IDLE_DELAY{ 2000 };
+	static constexpr std::chrono::milliseconds MAX_PASS_DURATION{ 3000 };
+
+	static constexpr size_t MAX_FREQUENT_LOCATIONS = 8;
+	static constexpr size_t MAX_RECENT_LOCATIONS = 4;
+	static constexpr size_t MAX_SUBFOLDERS = 4;
+	static constexpr size_t MAX_FOLDERS_PER_PASS = 16;
+	static constexpr size_t MAX_ITEMS_PER_FOLDER = 5000;
+
+	// Only the icons for the first few items in each folder are retrieved, since those are the
+	// items that will be initially visible. This also ensures that a prefetch pass can't displace
+	// a significant portion of the icon cache.
+	static constexpr size_t MAX_ICONS_PER_FOLDER = 32;
+
+	// The locations that are retrieved on the UI thread when a pass starts. The candidates are then
+	// chosen from these in the background.
+	struct PassLocations
+	{
+		PidlAbsolute currentFolder;
+		std::vector<PidlAbsolute> frequentLocations;
+		std::vector<PidlAbsolute> recentLocations;
+		bool showHidden;
+		bool excludeNetworkRemovable;
+	};
+
+	struct PrefetchCandidates
+	{
+		std::shared_ptr<std::atomic<bool>> cancelled;
+		std::vector<PidlAbsolute> folders;
+		bool showHidden;
+	};
+
+	struct PrefetchFolder
+	{
+		PidlAbsolute pidl;
+		FolderEnumerationService::EnumerationTicket ticket;
+	};
+
+	LRESULT WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	void CancelPass();
+	void OnIdleTimer();
+	void StartPass();
+	void FindCandidatesAsync(const PassLocations &passLocations,
+		std::shared_ptr<std::atomic<bool>> cancelled);
+	std::vector<PidlAbsolute> GetCandidateFolders(const PassLocations &passLocations) const;
+	std::vector<PidlAbsolute> GetSubfolders(const PidlAbsolute &currentFolder,
+		bool showHidden) const;
+	static bool ShouldPrefetch(const std::wstring &path, bool excludeNetworkRemovable);
+	void OnCandidatesReady();
+	void PrefetchFoldersAsync(const std::vector<PrefetchFolder> &folders, bool showHidden,
+		const std::atomic<bool> &cancelled);
+	void PrefetchIconsAsync(const PrefetchFolder &folder, bool showHidden,
+		const std::function<bool()> &shouldContinue);
+	void ProcessPrefetchedIcons();
+
+	const HWND m_hwnd;
+	const Config *const m_config;
+	const FrequentLocationsService *const m_frequentLocationsService;
+	const HistoryService *const m_historyService;
+	FolderEnumerationService *const m_folderEnumerationService;
+	CachedIcons *const m_cachedIcons;
+	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+
+	OneShotTimerManager m_timerManager;
+	OneShotTimer m_idleTimer;
+
+	PidlAbsolute m_currentFolder;
+	bool m_showHidden = false;
+	std::shared_ptr<std::atomic<bool>> m_passCancelled;
+
+	std::mutex m_candidatesMutex;
+	std::optional<PrefetchCandidates> m_candidates;
+
+	std::mutex m_prefetchedIconsMutex;
+	std::vector<CachedIcon> m_prefetchedIcons;
+
+	// Declared last, since prefetch passes use the members above.
+	WorkStealingExecutor::TaskGroup m_taskGroup;
+};
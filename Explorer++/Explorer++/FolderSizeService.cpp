@@ -0,0 +1,330 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderSizeService.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include <filesystem>
+
+FolderSizeService::FolderSizeService(IDirectoryMonitor *directoryMonitor,
+	WorkStealingExecutor *executor) :
+	m_directoryMonitor(directoryMonitor),
+	m_executor(executor),
+	m_cache(MAX_CACHED_FOLDERS),
+	m_taskGroup(executor)
+{
+}
+
+// Note that the directory monitor is expected to have been stopped before this is called, so no
+// further notifications will be received.
+FolderSizeService::~FolderSizeService()
+{
+	// Any calculation that's currently running will stop early.
+	m_stop = true;
+
+	{
+		std::scoped_lock lock(m_requestMutex);
+
+		for (auto &[requestId, stop] : m_requestStopFlags)
+		{
+			*stop = true;
+		}
+	}
+
+	m_taskGroup.Cancel();
+	m_taskGroup.WaitForRunningTasks();
+}
+
+std::optional<FolderInfo> FolderSizeService::GetCachedFolderInfo(const std::wstring &path)
+{
+	return m_cache.Get(path);
+}
+
+std::optional<FolderInfo> FolderSizeService::GetLastKnownFolderInfo(const std::wstring &path)
+{
+	return m_cache.Get(path, true);
+}
+
+std::optional<FolderInfo> FolderSizeService::CalculateFolderInfo(const std::wstring &path,
+	const FolderSizeProgressCallback &progressCallback)
+{
+	return CalculateFolderInfo(path, &m_stop, progressCallback);
+}
+
+std::optional<FolderInfo> FolderSizeService::CalculateFolderInfo(const std::wstring &path,
+	const std::atomic<bool> *stop, const FolderSizeProgressCallback &progressCallback)
+{
+	// Without a watch, there would be no way of knowing when the cached sizes were out of date.
+	bool watched = WatchFolder(path);
+
+	return ::CalculateFolderInfo(path, m_executor, watched ? &m_cache : nullptr, stop,
+		progressCallback);
+}
+
+int FolderSizeService::RequestFolderInfo(const std::wstring &path, ResultCallback callback)
+{
+	auto stop = std::make_shared<std::atomic<bool>>(false);
+	int requestId;
+
+	{
+		std::scoped_lock lock(m_requestMutex);
+
+		requestId = m_requestIdCounter++;
+		m_requestStopFlags.emplace(requestId, stop);
+
+		// The flag for each request is separate, so this needs to be checked here, in case this
+		// instance is being destroyed.
+		*stop = m_stop.load();
+	}
+
+	m_taskGroup.Submit(
+		[this, requestId, path, stop, callback = std::move(callback)]()
+		{
+			auto folderInfo = CalculateFolderInfo(path, stop.get(),
+				[&callback, &stop](const FolderInfo &partialFolderInfo)
+				{
+					if (!*stop)
+					{
+						callback(partialFolderInfo, false);
+					}
+				});
+
+			if (folderInfo && !*stop)
+			{
+				callback(*folderInfo, true);
+			}
+
+			RemoveRequest(requestId);
+		});
+
+	return requestId;
+}
+
+void FolderSizeService::CancelRequest(int requestId)
+{
+	std::scoped_lock lock(m_requestMutex);
+
+	auto itr = m_requestStopFlags.find(requestId);
+
+	if (itr == m_requestStopFlags.end())
+	{
+		return;
+	}
+
+	*itr->second = true;
+	m_requestStopFlags.erase(itr);
+}
+
+void FolderSizeService::RemoveRequest(int requestId)
+{
+	std::scoped_lock lock(m_requestMutex);
+	m_requestStopFlags.erase(requestId);
+}
+
+bool FolderSizeService::WatchFolder(const std::wstring &path)
+{
+	std::scoped_lock lock(m_watchMutex);
+
+	for (auto itr = m_watchedFolders.begin(); itr != m_watchedFolders.end(); ++itr)
+	{
+		if (IsPathWithinDirectory(path, itr->path))
+		{
+			m_watchedFolders.splice(m_watchedFolders.begin(), m_watchedFolders, itr);
+			return true;
+		}
+	}
+
+	// Only the folder itself is watched recursively, so that changes elsewhere within the parent
+	// (which may be very large, such as the root of a drive) don't have to be processed. Renaming
+	// or deleting the folder is detected by a separate watch on the parent.
+	int watchId = m_watchIdCounter++;
+	auto dirMonitorId = StartWatch(path, watchId,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE, true,
+		OnFolderAltered);
+
+	if (!dirMonitorId)
+	{
+		return false;
+	}
+
+	WatchedFolder watchedFolder = { watchId, path, *dirMonitorId, std::nullopt };
+
+	std::filesystem::path folderPath(path);
+
+	if (folderPath.has_relative_path())
+	{
+		auto parentPath = folderPath.parent_path().wstring();
+
+		if (!AddParentWatch(parentPath))
+		{
+			m_directoryMonitor->StopDirectoryMonitor(watchedFolder.dirMonitorId);
+			return false;
+		}
+
+		watchedFolder.parentPath = parentPath;
+	}
+
+	m_watchedFolders.push_front(watchedFolder);
+
+	if (m_watchedFolders.size() > MAX_WATCHED_FOLDERS)
+	{
+		RemoveWatch(m_watchedFolders.back());
+		m_watchedFolders.pop_back();
+	}
+
+	return true;
+}
+
+bool FolderSizeService::AddParentWatch(const std::wstring &parentPath)
+{
+	auto itr = m_watchedParents.find(parentPath);
+
+	if (itr != m_watchedParents.end())
+	{
+		itr->second.refCount++;
+		return true;
+	}
+
+	int watchId = m_watchIdCounter++;
+	auto dirMonitorId =
+		StartWatch(parentPath, watchId, FILE_NOTIFY_CHANGE_DIR_NAME, false, OnParentAltered);
+
+	if (!dirMonitorId)
+	{
+		return false;
+	}
+
+	m_watchedParents.emplace(parentPath, WatchedParent{ watchId, *dirMonitorId, 1 });
+	return true;
+}
+
+void FolderSizeService::RemoveWatch(const WatchedFolder &watchedFolder)
+{
+	m_directoryMonitor->StopDirectoryMonitor(watchedFolder.dirMonitorId);
+
+	// The sizes within the folder can no longer be kept up to date. They're retained, since the
+	// folders in the current directory may have more watched folders between them than can be
+	// watched at once, and sorting by size would otherwise lose the sizes that were calculated
+	// first.
+	m_cache.MarkTreeStale(watchedFolder.path);
+
+	if (!watchedFolder.parentPath)
+	{
+		return;
+	}
+
+	auto itr = m_watchedParents.find(*watchedFolder.parentPath);
+
+	if (itr != m_watchedParents.end() && --itr->second.refCount == 0)
+	{
+		m_directoryMonitor->StopDirectoryMonitor(itr->second.dirMonitorId);
+		m_watchedParents.erase(itr);
+	}
+}
+
+std::optional<int> FolderSizeService::StartWatch(const std::wstring &path, int watchId,
+	UINT watchFlags, bool watchSubtree, void (*callback)(const TCHAR *, DWORD, void *))
+{
+	auto *watchContext = static_cast<WatchContext *>(malloc(sizeof(WatchContext)));
+
+	if (!watchContext)
+	{
+		return std::nullopt;
+	}
+
+	watchContext->service = this;
+	watchContext->watchId = watchId;
+
+	// The directory monitor will free the context if the directory can't be watched.
+	return m_directoryMonitor->WatchDirectory(path.c_str(), watchFlags, callback, watchSubtree,
+		watchContext);
+}
+
+bool FolderSizeService::IsPathWithinDirectory(std::wstring_view path,
+	std::wstring_view directory)
+{
+	if (directory.ends_with(L'\\'))
+	{
+		directory.remove_suffix(1);
+	}
+
+	if (path.size() < directory.size()
+		|| CompareStringOrdinal(path.data(), static_cast<int>(directory.size()), directory.data(),
+			   static_cast<int>(directory.size()), TRUE)
+			!= CSTR_EQUAL)
+	{
+		return false;
+	}
+
+	return path.size() == directory.size() || path[directory.size()] == L'\\';
+}
+
+void FolderSizeService::OnFolderAltered(const TCHAR *fileName, DWORD action, void *data)
+{
+	auto *watchContext = static_cast<WatchContext *>(data);
+	watchContext->service->OnFolderChange(watchContext->watchId, action, fileName);
+}
+
+void FolderSizeService::OnParentAltered(const TCHAR *fileName, DWORD action, void *data)
+{
+	UNREFERENCED_PARAMETER(action);
+
+	auto *watchContext = static_cast<WatchContext *>(data);
+	watchContext->service->OnParentChange(watchContext->watchId, fileName);
+}
+
+void FolderSizeService::OnFolderChange(int watchId, DWORD action, const std::wstring &relativePath)
+{
+	std::wstring fullPath;
+
+	{
+		std::scoped_lock lock(m_watchMutex);
+
+		auto itr = std::find_if(m_watchedFolders.begin(), m_watchedFolders.end(),
+			[watchId](const WatchedFolder &watchedFolder) { return watchedFolder.id == watchId; });
+
+		if (itr == m_watchedFolders.end())
+		{
+			// The watch has since been removed.
+			return;
+		}
+
+		fullPath = (std::filesystem::path(itr->path) / relativePath).wstring();
+	}
+
+	// A modification can only change the size of the item, whereas an item that's been added,
+	// removed or renamed may have been a directory, in which case any sizes cached for its
+	// descendants are no longer valid.
+	if (action == FILE_ACTION_MODIFIED)
+	{
+		m_cache.InvalidatePath(fullPath);
+	}
+	else
+	{
+		m_cache.InvalidateTree(fullPath);
+	}
+}
+
+// Only name changes are reported for the parent, so each change means that a folder within it has
+// been added, removed or renamed.
+void FolderSizeService::OnParentChange(int watchId, const std::wstring &relativePath)
+{
+	std::wstring fullPath;
+
+	{
+		std::scoped_lock lock(m_watchMutex);
+
+		auto itr = std::find_if(m_watchedParents.begin(), m_watchedParents.end(),
+			[watchId](const auto &entry) { return entry.second.id == watchId; });
+
+		if (itr == m_watchedParents.end())
+		{
+			return;
+		}
+
+		fullPath = (std::filesystem::path(itr->first) / relativePath).wstring();
+	}
+
+	m_cache.InvalidateTree(fullPath);
+}
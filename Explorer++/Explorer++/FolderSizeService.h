@@ -0,0 +1,132 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/FolderSize.h"
+#include "../Helper/WorkStealingExecutor.h"
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+__interface IDirectoryMonitor;
+
+// Calculates folder sizes in the background and caches them, so that the size column, sorting by
+// size and the display window all share the same results. Before a size is calculated, the folder
+// is watched (recursively) for changes and each change invalidates the cached sizes it affects.
+// The parent directory is also watched, though only for name changes, so that renaming or deleting
+// the folder is detected. Since the folders in a particular directory are typically all shown
+// together, they'll generally share the parent watch.
+//
+// Only a limited number of folders are watched at once. Once that limit is reached, the least
+// recently used watch is removed and the sizes it was keeping up to date are marked as stale.
+// Stale sizes are still used when sorting (so that sorting a folder with many subfolders doesn't
+// lose sizes), but are recalculated whenever a size is requested. If a folder can't be watched,
+// sizes within it are still calculated, but aren't cached.
+//
+// Note that if the directory monitor drops notifications (e.g. because a large number of changes
+// were made at once), cached sizes may be out of date until they're next invalidated.
+class FolderSizeService
+{
+public:
+	// Invoked with the totals found so far while the size is being calculated, then once more with
+	// the final totals (in which case complete will be true).
+	using ResultCallback = std::function<void(const FolderInfo &folderInfo, bool complete)>;
+
+	FolderSizeService(IDirectoryMonitor *directoryMonitor, WorkStealingExecutor *executor);
+	~FolderSizeService();
+
+	// Returns the size of the folder, if it's been calculated and is still valid. This doesn't
+	// block, so it can be called from the UI thread.
+	std::optional<FolderInfo> GetCachedFolderInfo(const std::wstring &path);
+
+	// As above, but may also return a size that's no longer being kept up to date. This is only
+	// suitable where an approximate size is acceptable (e.g. when sorting).
+	std::optional<FolderInfo> GetLastKnownFolderInfo(const std::wstring &path);
+
+	// Calculates the size of the folder on the calling thread, using cached sizes where they're
+	// available. This can take a significant amount of time, so it should only be called from a
+	// background thread.
+	std::optional<FolderInfo> CalculateFolderInfo(const std::wstring &path,
+		const FolderSizeProgressCallback &progressCallback = nullptr);
+
+	// Calculates the size of the folder in the background. The callback is invoked on a
+	// background thread and won't be invoked once this instance has been destroyed, or once the
+	// request has been cancelled. Returns an ID that can be passed to CancelRequest().
+	int RequestFolderInfo(const std::wstring &path, ResultCallback callback);
+
+	// Stops the calculation for the specified request. A callback that's already running may still
+	// complete, so results received after this call should be ignored by the caller.
+	void CancelRequest(int requestId);
+
+private:
+	static const size_t MAX_CACHED_FOLDERS = 10000;
+	static const size_t MAX_WATCHED_FOLDERS = 64;
+
+	struct WatchedFolder
+	{
+		int id;
+		std::wstring path;
+		int dirMonitorId;
+
+		// The parent directory, if the folder has one. The watch on the parent is shared between
+		// all the watched folders it contains.
+		std::optional<std::wstring> parentPath;
+	};
+
+	struct WatchedParent
+	{
+		int id;
+		int dirMonitorId;
+		int refCount;
+	};
+
+	// Passed to the directory monitor, which takes ownership of it (and frees it using free()).
+	// Since notifications may still be delivered briefly after a watch has been removed, the watch
+	// is referenced by ID.
+	struct WatchContext
+	{
+		FolderSizeService *service;
+		int watchId;
+	};
+
+	static void OnFolderAltered(const TCHAR *fileName, DWORD action, void *data);
+	static void OnParentAltered(const TCHAR *fileName, DWORD action, void *data);
+	static bool IsPathWithinDirectory(std::wstring_view path, std::wstring_view directory);
+
+	std::optional<FolderInfo> CalculateFolderInfo(const std::wstring &path,
+		const std::atomic<bool> *stop, const FolderSizeProgressCallback &progressCallback);
+	bool WatchFolder(const std::wstring &path);
+	bool AddParentWatch(const std::wstring &parentPath);
+	void RemoveWatch(const WatchedFolder &watchedFolder);
+	std::optional<int> StartWatch(const std::wstring &path, int watchId, UINT watchFlags,
+		bool watchSubtree, void (*callback)(const TCHAR *, DWORD, void *));
+	void OnFolderChange(int watchId, DWORD action, const std::wstring &relativePath);
+	void OnParentChange(int watchId, const std::wstring &relativePath);
+	void RemoveRequest(int requestId);
+
+	IDirectoryMonitor *const m_directoryMonitor;
+	WorkStealingExecutor *const m_executor;
+	FolderSizeCache m_cache;
+	std::atomic<bool> m_stop = false;
+
+	std::mutex m_watchMutex;
+
+	// Ordered from most to least recently used.
+	std::list<WatchedFolder> m_watchedFolders;
+	std::unordered_map<std::wstring, WatchedParent> m_watchedParents;
+	int m_watchIdCounter = 0;
+
+	std::mutex m_requestMutex;
+	std::unordered_map<int, std::shared_ptr<std::atomic<bool>>> m_requestStopFlags;
+	int m_requestIdCounter = 0;
+
+	// Declared last, since the size calculations use the members above.
+	WorkStealingExecutor::TaskGroup m_taskGroup;
+};
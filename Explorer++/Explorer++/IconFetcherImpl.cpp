@@ -5,13 +5,14 @@
 #include "stdafx.h"
 #include "IconFetcherImpl.h"
 #include "../Helper/CachedIcons.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/WindowSubclassWrapper.h"
 
-IconFetcherImpl::IconFetcherImpl(HWND hwnd, CachedIcons *cachedIcons) :
+IconFetcherImpl::IconFetcherImpl(HWND hwnd, CachedIcons *cachedIcons,
+	PriorityTaskScheduler *taskScheduler) :
 	m_hwnd(hwnd),
 	m_cachedIcons(cachedIcons),
-	m_iconThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_taskScheduler(taskScheduler),
 	m_iconResultIDCounter(0)
 {
 	FAIL_FAST_IF_FAILED(GetDefaultFileIconIndex(m_defaultFileIconIndex));
@@ -23,7 +24,8 @@ IconFetcherImpl::IconFetcherImpl(HWND hwnd, CachedIcons *cachedIcons) :
 
 IconFetcherImpl::~IconFetcherImpl()
 {
-	m_iconThreadPool.clear_queue();
+	// The tasks reference this instance, so any that are running need to finish first.
+	m_taskScheduler->CancelTasks(this, true);
 }
 
 LRESULT IconFetcherImpl::WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -43,11 +45,9 @@ void IconFetcherImpl::QueueIconTask(std::wstring_view path, Callback callback)
 {
 	int iconResultID = m_iconResultIDCounter++;
 
-	auto iconResult = m_iconThreadPool.push(
-		[this, iconResultID, copiedPath = std::wstring(path)](int id) -> std::optional<IconResult>
+	auto iconResult = m_taskScheduler->QueueTask(this, iconResultID, ICON_TASK_PRIORITY,
+		[this, iconResultID, copiedPath = std::wstring(path)]() -> std::optional<IconResult>
 		{
-			UNREFERENCED_PARAMETER(id);
-
 			// SHGetFileInfo will fail for non-filesystem paths that are passed in
 			// as strings. For example, attempting to retrieve the icon for the
 			// recycle bin will fail if you pass the parsing path (i.e.
@@ -81,7 +81,7 @@ void IconFetcherImpl::QueueIconTask(std::wstring_view path, Callback callback)
 
 	FutureResult futureResult;
 	futureResult.callback = callback;
-	futureResult.iconResult = std::move(iconResult);
+	futureResult.iconResult = std::move(*iconResult);
 	m_iconResults.insert({ iconResultID, std::move(futureResult) });
 }
 
@@ -92,11 +92,9 @@ void IconFetcherImpl::QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback)
 	BasicItemInfo basicItemInfo;
 	basicItemInfo.pidl.reset(ILCloneFull(pidl));
 
-	auto iconResult = m_iconThreadPool.push(
-		[this, iconResultID, basicItemInfo](int id) -> std::optional<IconResult>
+	auto iconResult = m_taskScheduler->QueueTask(this, iconResultID, ICON_TASK_PRIORITY,
+		[this, iconResultID, basicItemInfo]() -> std::optional<IconResult>
 		{
-			UNREFERENCED_PARAMETER(id);
-
 			auto iconIndex = FindIconAsync(basicItemInfo.pidl.get());
 
 			if (!iconIndex)
@@ -122,7 +120,7 @@ void IconFetcherImpl::QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback)
 
 	FutureResult futureResult;
 	futureResult.callback = callback;
-	futureResult.iconResult = std::move(iconResult);
+	futureResult.iconResult = std::move(*iconResult);
 	m_iconResults.insert({ iconResultID, std::move(futureResult) });
 }
 
@@ -172,7 +170,7 @@ void IconFetcherImpl::ProcessIconResult(int iconResultId)
 
 void IconFetcherImpl::ClearQueue()
 {
-	m_iconThreadPool.clear_queue();
+	m_taskScheduler->CancelTasks(this);
 	m_iconResults.clear();
 }
 
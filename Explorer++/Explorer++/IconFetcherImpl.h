@@ -6,17 +6,17 @@
 
 #include "IconFetcher.h"
 #include "../Helper/ShellHelper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <future>
 #include <unordered_map>
 
 class CachedIcons;
+class PriorityTaskScheduler;
 class WindowSubclassWrapper;
 
 class IconFetcherImpl : public IconFetcher
 {
 public:
-	IconFetcherImpl(HWND hwnd, CachedIcons *cachedIcons);
+	IconFetcherImpl(HWND hwnd, CachedIcons *cachedIcons, PriorityTaskScheduler *taskScheduler);
 	~IconFetcherImpl();
 
 	void QueueIconTask(std::wstring_view path, Callback callback) override;
@@ -26,6 +26,8 @@ public:
 		DefaultIconType defaultIconType) const override;
 	std::optional<int> GetCachedIconIndex(const std::wstring &itemPath) const override;
 
+	static std::optional<int> FindIconAsync(PCIDLIST_ABSOLUTE pidl);
+
 private:
 	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
 	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
@@ -33,6 +35,11 @@ private:
 	// value in the range will be used.
 	static const UINT WM_APP_ICON_RESULT_READY = 0xBFFF;
 
+	// Icons requested through this class are generally shown in menus and toolbars that are
+	// already visible, so the requests are run in the same order as requests for visible items in
+	// the listview.
+	static const int ICON_TASK_PRIORITY = 0;
+
 	struct BasicItemInfo
 	{
 		BasicItemInfo() = default;
@@ -59,7 +66,6 @@ private:
 
 	LRESULT WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-	static std::optional<int> FindIconAsync(PCIDLIST_ABSOLUTE pidl);
 	void ProcessIconResult(int iconResultId);
 
 	const HWND m_hwnd;
@@ -68,7 +74,7 @@ private:
 	int m_defaultFileIconIndex;
 	int m_defaultFolderIconIndex;
 
-	ctpl::thread_pool m_iconThreadPool;
+	PriorityTaskScheduler *const m_taskScheduler;
 	std::unordered_map<int, FutureResult> m_iconResults;
 	int m_iconResultIDCounter;
 	std::function<void(int data)> m_callback;
@@ -13,6 +13,12 @@
 #include "DarkModeHelper.h"
 #include "DisplayWindow/DisplayWindow.h"
 #include "Explorer++_internal.h"
+#include "FeatureList.h"
+#include "FileNameIndexService.h"
+#include "FolderEnumerationService.h"
+#include "FolderPrefetcher.h"
+#include "FolderSizeService.h"
+#include "HistoryServiceFactory.h"
 #include "LoadSaveInterface.h"
 #include "MainResource.h"
 #include "MainToolbar.h"
@@ -28,8 +34,27 @@
 #include "ThemeWindowTracker.h"
 #include "UiTheming.h"
 #include "ViewModeHelper.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ProcessHelper.h"
+#include "../Helper/ThumbnailStore.h"
 #include "../Helper/iDirectoryMonitor.h"
 
+namespace
+{
+
+const WCHAR THUMBNAIL_STORE_FILE_NAME[] = L"ThumbnailCache.dat";
+
+std::wstring GetThumbnailStorePath()
+{
+	TCHAR storePath[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), storePath, SIZEOF_ARRAY(storePath));
+	PathRemoveFileSpec(storePath);
+	PathAppend(storePath, THUMBNAIL_STORE_FILE_NAME);
+	return storePath;
+}
+
+}
+
 /*
  * Main window creation.
  *
@@ -63,6 +88,38 @@ void Explorerplusplus::OnCreate()
 
 	CreateDirectoryMonitor(&m_pDirMon);
 
+	if (FeatureList::GetInstance()->IsEnabled(Feature::FileNameIndex)
+		&& !m_commandLineSettings->indexRoots.empty())
+	{
+		m_fileNameIndexService = std::make_unique<FileNameIndexService>(
+			m_commandLineSettings->indexRoots, m_pDirMon, &m_backgroundExecutor);
+	}
+
+	m_folderSizeService = std::make_unique<FolderSizeService>(m_pDirMon, &m_backgroundExecutor);
+	m_folderEnumerationService = std::make_unique<FolderEnumerationService>(m_hContainer);
+	m_folderPrefetcher = std::make_unique<FolderPrefetcher>(m_hContainer, m_config.get(),
+		&m_frequentLocationsService, HistoryServiceFactory::GetInstance()->GetHistoryService(),
+		m_folderEnumerationService.get(), &m_cachedIcons, &m_backgroundExecutor);
+
+	m_thumbnailCache = std::make_unique<ThumbnailCache>(MAX_THUMBNAIL_CACHE_MEMORY, nullptr);
+
+	// As with the file name index, thumbnails are stored alongside the executable. Until the store
+	// has been opened, or if it can't be opened (e.g. because another instance is already using
+	// it), thumbnails will only be cached in memory.
+	if (m_config->storeThumbnailsOnDisk)
+	{
+		m_thumbnailStoreTaskGroup.Submit(
+			[thumbnailCache = m_thumbnailCache.get(), storePath = GetThumbnailStorePath()]()
+			{
+				auto thumbnailStore = ThumbnailStore::Open(storePath, MAX_THUMBNAIL_STORE_SIZE);
+
+				if (thumbnailStore)
+				{
+					thumbnailCache->SetStore(std::move(thumbnailStore));
+				}
+			});
+	}
+
 	CreateStatusBar();
 	CreateMainRebarAndChildren();
 	InitializeDisplayWindow();
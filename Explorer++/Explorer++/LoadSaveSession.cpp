@@ -0,0 +1,181 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "LoadSaveSession.h"
+// clang-format off
+#include "Explorer++.h"
+// clang-format on
+#include "Bookmarks/BookmarkBinaryStorage.h"
+#include "Bookmarks/BookmarkTreeFactory.h"
+#include "ColumnBinaryStorage.h"
+#include "Config.h"
+#include "TabBinaryStorage.h"
+#include "TabStorage.h"
+#include "../Helper/SessionStore.h"
+#include <glog/logging.h>
+
+namespace
+{
+
+// These values are stored in the session store and shouldn't be changed.
+enum class SessionSection : uint32_t
+{
+	Tabs = 1,
+	Bookmarks = 2,
+	DefaultColumns = 3
+};
+
+const std::string *GetSection(SessionStore *sessionStore, SessionSection section)
+{
+	return sessionStore->GetSection(static_cast<uint32_t>(section));
+}
+
+void SetSection(SessionStore *sessionStore, SessionSection section, std::string data)
+{
+	sessionStore->SetSection(static_cast<uint32_t>(section), std::move(data));
+}
+
+}
+
+LoadSaveSession::LoadSaveSession(Explorerplusplus *pContainer, SessionStore *sessionStore,
+	std::unique_ptr<ILoadSave> configLoadSave) :
+	m_pContainer(pContainer),
+	m_sessionStore(sessionStore),
+	m_configLoadSave(std::move(configLoadSave))
+{
+}
+
+LoadSaveSession::~LoadSaveSession()
+{
+	// This will only write the sections that have changed since they were last saved. If nothing
+	// has changed, nothing will be written.
+	if (!m_sessionStore->Commit())
+	{
+		LOG(WARNING) << "Failed to write session store";
+	}
+}
+
+void LoadSaveSession::LoadGenericSettings()
+{
+	m_configLoadSave->LoadGenericSettings();
+}
+
+void LoadSaveSession::LoadBookmarks()
+{
+	auto *bookmarkTree = BookmarkTreeFactory::GetInstance()->GetBookmarkTree();
+	const auto *data = GetSection(m_sessionStore, SessionSection::Bookmarks);
+
+	if (data && BookmarkBinaryStorage::Load(*data, bookmarkTree))
+	{
+		return;
+	}
+
+	m_configLoadSave->LoadBookmarks();
+}
+
+void LoadSaveSession::LoadPreviousTabs()
+{
+	const auto *data = GetSection(m_sessionStore, SessionSection::Tabs);
+
+	if (data)
+	{
+		auto tabs = TabBinaryStorage::Load(*data);
+
+		if (tabs)
+		{
+			m_pContainer->m_loadedTabs = std::move(*tabs);
+			return;
+		}
+	}
+
+	m_configLoadSave->LoadPreviousTabs();
+}
+
+void LoadSaveSession::LoadDefaultColumns()
+{
+	const auto *data = GetSection(m_sessionStore, SessionSection::DefaultColumns);
+
+	if (data)
+	{
+		auto folderColumns = ColumnBinaryStorage::Load(*data);
+
+		if (folderColumns)
+		{
+			m_pContainer->m_config->globalFolderSettings.folderColumns = std::move(*folderColumns);
+			return;
+		}
+	}
+
+	m_configLoadSave->LoadDefaultColumns();
+}
+
+void LoadSaveSession::LoadApplicationToolbar()
+{
+	m_configLoadSave->LoadApplicationToolbar();
+}
+
+void LoadSaveSession::LoadMainRebarInformation()
+{
+	m_configLoadSave->LoadMainRebarInformation();
+}
+
+void LoadSaveSession::LoadColorRules()
+{
+	m_configLoadSave->LoadColorRules();
+}
+
+void LoadSaveSession::LoadDialogStates()
+{
+	m_configLoadSave->LoadDialogStates();
+}
+
+void LoadSaveSession::SaveGenericSettings()
+{
+	m_configLoadSave->SaveGenericSettings();
+}
+
+void LoadSaveSession::SaveBookmarks()
+{
+	m_configLoadSave->SaveBookmarks();
+
+	SetSection(m_sessionStore, SessionSection::Bookmarks,
+		BookmarkBinaryStorage::Save(BookmarkTreeFactory::GetInstance()->GetBookmarkTree()));
+}
+
+void LoadSaveSession::SaveTabs()
+{
+	m_configLoadSave->SaveTabs();
+
+	SetSection(m_sessionStore, SessionSection::Tabs,
+		TabBinaryStorage::Save(m_pContainer->GetTabListStorageData()));
+}
+
+void LoadSaveSession::SaveDefaultColumns()
+{
+	m_configLoadSave->SaveDefaultColumns();
+
+	SetSection(m_sessionStore, SessionSection::DefaultColumns,
+		ColumnBinaryStorage::Save(m_pContainer->m_config->globalFolderSettings.folderColumns));
+}
+
+void LoadSaveSession::SaveApplicationToolbar()
+{
+	m_configLoadSave->SaveApplicationToolbar();
+}
+
+void LoadSaveSession::SaveMainRebarInformation()
+{
+	m_configLoadSave->SaveMainRebarInformation();
+}
+
+void LoadSaveSession::SaveColorRules()
+{
+	m_configLoadSave->SaveColorRules();
+}
+
+void LoadSaveSession::SaveDialogStates()
+{
+	m_configLoadSave->SaveDialogStates();
+}
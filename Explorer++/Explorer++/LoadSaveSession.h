@@ -0,0 +1,50 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "LoadSaveInterface.h"
+#include <memory>
+
+class Explorerplusplus;
+class SessionStore;
+
+// Loads and saves tabs, bookmarks and the default columns using the binary session store. All other
+// settings are handled by the config file/registry implementation this wraps.
+//
+// If one of the sections above isn't present in the store (e.g. because this is the first time the
+// store has been used), it's imported from the config file/registry instead. Those sections are
+// also still saved to the config file/registry, so that they remain available as an export.
+class LoadSaveSession : public ILoadSave
+{
+public:
+	LoadSaveSession(Explorerplusplus *pContainer, SessionStore *sessionStore,
+		std::unique_ptr<ILoadSave> configLoadSave);
+	~LoadSaveSession();
+
+	/* Loading functions. */
+	void LoadGenericSettings() override;
+	void LoadBookmarks() override;
+	void LoadPreviousTabs() override;
+	void LoadDefaultColumns() override;
+	void LoadApplicationToolbar() override;
+	void LoadMainRebarInformation() override;
+	void LoadColorRules() override;
+	void LoadDialogStates() override;
+
+	/* Saving functions. */
+	void SaveGenericSettings() override;
+	void SaveBookmarks() override;
+	void SaveTabs() override;
+	void SaveDefaultColumns() override;
+	void SaveApplicationToolbar() override;
+	void SaveMainRebarInformation() override;
+	void SaveColorRules() override;
+	void SaveDialogStates() override;
+
+private:
+	Explorerplusplus *m_pContainer;
+	SessionStore *m_sessionStore;
+	const std::unique_ptr<ILoadSave> m_configLoadSave;
+};
@@ -21,52 +21,23 @@
 #include <wil/com.h>
 #include <wil/resource.h>
 
-LoadSaveXML::LoadSaveXML(Explorerplusplus *pContainer, BOOL bLoad) :
+LoadSaveXML::LoadSaveXML(Explorerplusplus *pContainer, IXMLDOMDocument *xmlDocument) :
 	m_pContainer(pContainer),
-	m_bLoad(bLoad)
+	m_bLoad(TRUE),
+	m_pXMLDom(xmlDocument)
 {
-	if (bLoad)
-	{
-		/* Initialize the load environment (namely,
-		load the configuration file). */
-		InitializeLoadEnvironment();
-	}
-	else
-	{
-		/* Initialize the save environment. */
-		InitializeSaveEnvironment();
-	}
 }
 
-LoadSaveXML::~LoadSaveXML()
+LoadSaveXML::LoadSaveXML(Explorerplusplus *pContainer) : m_pContainer(pContainer), m_bLoad(FALSE)
 {
-	if (!m_bLoad)
-	{
-		ReleaseSaveEnvironment();
-	}
+	InitializeSaveEnvironment();
 }
 
-void LoadSaveXML::InitializeLoadEnvironment()
+LoadSaveXML::~LoadSaveXML()
 {
-	m_pXMLDom.attach(XMLSettings::DomFromCOM());
-
-	if (!m_pXMLDom)
-	{
-		return;
-	}
-
-	TCHAR szConfigFile[MAX_PATH];
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	wil::unique_variant var(XMLSettings::VariantString(NExplorerplusplus::XML_FILENAME));
-	VARIANT_BOOL status;
-	m_pXMLDom->load(var, &status);
-
-	if (status != VARIANT_TRUE)
+	if (!m_bLoad)
 	{
-		return;
+		ReleaseSaveEnvironment();
 	}
 }
 
@@ -14,7 +14,12 @@ class Explorerplusplus;
 class LoadSaveXML : public ILoadSave
 {
 public:
-	LoadSaveXML(Explorerplusplus *pContainer, BOOL bLoad);
+	// Loads settings from a config file that's already been parsed.
+	LoadSaveXML(Explorerplusplus *pContainer, IXMLDOMDocument *xmlDocument);
+
+	// Saves settings to the config file.
+	explicit LoadSaveXML(Explorerplusplus *pContainer);
+
 	~LoadSaveXML();
 
 	/* Loading functions. */
@@ -38,8 +43,6 @@ public:
 	void SaveDialogStates() override;
 
 private:
-	void InitializeLoadEnvironment();
-	void ReleaseLoadEnvironment();
 	void InitializeSaveEnvironment();
 	void ReleaseSaveEnvironment();
 
@@ -91,7 +91,7 @@ void Explorerplusplus::OnDestroyFiles()
 	}
 
 	DestroyFilesDialog destroyFilesDialog(m_resourceInstance, m_hContainer, fullFilenameList,
-		m_config->globalFolderSettings.showFriendlyDates);
+		m_config->globalFolderSettings.showFriendlyDates, GetBackgroundExecutor());
 	destroyFilesDialog.ShowModalDialog();
 }
 
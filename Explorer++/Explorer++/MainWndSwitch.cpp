@@ -36,6 +36,7 @@
 #include "TabRestorerMenu.h"
 #include "../Helper/BulkClipboardWriter.h"
 #include "../Helper/Controls.h"
+#include "../Helper/FileTypeNameCache.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
@@ -170,60 +171,50 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd, UINT Msg, WPARAM w
 		OnDisplayWindowResized(wParam);
 		break;
 
+	case WM_APP_ASSOCCHANGED:
+		// The type names shown for items are determined by the file associations.
+		FileTypeNameCache::GetInstance().Clear();
+
 		// See https://github.com/derceg/explorerplusplus/issues/169.
-		/*case WM_APP_ASSOCCHANGED:
-			OnAssocChanged();
-			break;*/
+		// OnAssocChanged();
+		break;
 
 	case WM_APP_FOLDERSIZECOMPLETED:
 	{
-		DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
-		TCHAR szSizeString[64];
-		TCHAR szTotalSize[64];
+		std::unique_ptr<DWFolderSizeCompletion> completion(
+			reinterpret_cast<DWFolderSizeCompletion *>(wParam));
 		BOOL bValid = FALSE;
 
-		pDWFolderSizeCompletion = (DWFolderSizeCompletion *) wParam;
-
-		std::list<DWFolderSize>::iterator itr;
-
 		/* First, make sure we should still display the
 		results (we won't if the listview selection has
 		changed, or this folder size was calculated for
 		a tab other than the current one). */
-		for (itr = m_DWFolderSizes.begin(); itr != m_DWFolderSizes.end(); itr++)
+		auto itr = std::find_if(m_DWFolderSizes.begin(), m_DWFolderSizes.end(),
+			[&completion](const DWFolderSize &folderSize)
+			{ return folderSize.uId == completion->uId; });
+
+		if (itr != m_DWFolderSizes.end())
 		{
-			if (itr->uId == pDWFolderSizeCompletion->uId)
+			if (itr->iTabId == GetActivePane()->GetTabContainer()->GetSelectedTab().GetId())
 			{
-				if (itr->iTabId == GetActivePane()->GetTabContainer()->GetSelectedTab().GetId())
-				{
-					bValid = itr->bValid;
-				}
+				bValid = TRUE;
+			}
 
+			// Partial results will be followed by further results for the same request.
+			if (completion->complete)
+			{
 				m_DWFolderSizes.erase(itr);
-
-				break;
 			}
 		}
 
 		if (bValid)
 		{
-			auto displayFormat = m_config->globalFolderSettings.forceSize
-				? m_config->globalFolderSettings.sizeDisplayFormat
-				: +SizeDisplayFormat::None;
 			auto folderSizeText =
-				FormatSizeString(pDWFolderSizeCompletion->liFolderSize.QuadPart, displayFormat);
-
-			LoadString(m_resourceInstance, IDS_GENERAL_TOTALSIZE, szTotalSize,
-				SIZEOF_ARRAY(szTotalSize));
-
-			StringCchPrintf(szSizeString, SIZEOF_ARRAY(szSizeString), _T("%s: %s"), szTotalSize,
-				folderSizeText.c_str());
+				GetDisplayWindowFolderSizeText(completion->folderSize, completion->complete);
 
 			/* TODO: The line index should be stored in some other (variable) way. */
-			DisplayWindow_SetLine(m_hDisplayWindow, FOLDER_SIZE_LINE_INDEX, szSizeString);
+			DisplayWindow_SetLine(m_hDisplayWindow, FOLDER_SIZE_LINE_INDEX, folderSizeText.c_str());
 		}
-
-		free(pDWFolderSizeCompletion);
 	}
 	break;
 
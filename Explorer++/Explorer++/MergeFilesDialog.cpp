@@ -9,6 +9,7 @@
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "../Helper/FileCopyEngine.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
 #include "../Helper/ListViewHelper.h"
@@ -17,15 +18,19 @@
 #include "../Helper/StringHelper.h"
 #include "../Helper/WindowHelper.h"
 #include <wil/resource.h>
+#include <limits>
 #include <regex>
 
 namespace NMergeFilesDialog
 {
-const int WM_APP_SETTOTALMERGECOUNT = WM_APP + 1;
-const int WM_APP_SETCURRENTMERGECOUNT = WM_APP + 2;
+const int WM_APP_SETMERGEPROGRESS = WM_APP + 2;
 const int WM_APP_MERGINGFINISHED = WM_APP + 3;
 const int WM_APP_OUTPUTFILEINVALID = WM_APP + 4;
 
+// Progress is measured in bytes, which won't necessarily fit within the range of the progress bar,
+// so it's scaled to this range instead.
+const int PROGRESS_BAR_RANGE = 1000;
+
 DWORD WINAPI MergeFilesThread(LPVOID pParam);
 }
 
@@ -259,11 +264,7 @@ INT_PTR MergeFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPar
 
 	switch (uMsg)
 	{
-	case NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT:
+	case NMergeFilesDialog::WM_APP_SETMERGEPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
@@ -319,6 +320,8 @@ void MergeFilesDialog::OnOk()
 
 		m_pMergeFiles = new MergeFiles(m_hDlg, outputFileName, m_FullFilenameList);
 
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0,
+			NMergeFilesDialog::PROGRESS_BAR_RANGE);
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
@@ -455,6 +458,7 @@ MergeFiles::MergeFiles(HWND hDlg, const std::wstring &strOutputFilename,
 	m_FullFilenameList = FullFilenameList;
 
 	m_bstopMerging = false;
+	m_progressPosition = 0;
 
 	InitializeCriticalSection(&m_csStop);
 }
@@ -466,67 +470,97 @@ MergeFiles::~MergeFiles()
 
 void MergeFiles::StartMerging()
 {
-	LARGE_INTEGER lMergeFileSize;
-	int nFilesMerged = 1;
-	bool bStop = false;
+	wil::unique_hfile outputFile(CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0,
+		nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr));
 
-	HANDLE hOutputFile = CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-	if (hOutputFile == INVALID_HANDLE_VALUE)
+	if (!outputFile)
 	{
 		PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID, 0, 0);
 		return;
 	}
 
-	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT,
-		static_cast<WPARAM>(m_FullFilenameList.size()), 0);
+	uint64_t totalBytes = 0;
 
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		if (bStop)
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (GetFileAttributesEx(strFullFilename.c_str(), GetFileExInfoStandard, &attributeData))
 		{
-			break;
+			totalBytes += (static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32)
+				| attributeData.nFileSizeLow;
 		}
+	}
 
-		HANDLE hInputFile = CreateFile(strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-			nullptr, OPEN_EXISTING, 0, nullptr);
+	// Each file is copied in chunks, so the amount of memory used is the same, regardless of how
+	// large the files are.
+	FileCopyEngine copyEngine;
+	uint64_t outputOffset = 0;
 
-		if (hInputFile != INVALID_HANDLE_VALUE)
+	for (const auto &strFullFilename : m_FullFilenameList)
+	{
+		wil::unique_hfile inputFile(CreateFile(strFullFilename.c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+		if (!inputFile)
 		{
-			GetFileSizeEx(hInputFile, &lMergeFileSize);
+			continue;
+		}
 
-			if (lMergeFileSize.QuadPart != 0)
+		uint64_t bytesCopied;
+		HRESULT hr = copyEngine.Copy(inputFile.get(), 0, outputFile.get(), outputOffset,
+			(std::numeric_limits<uint64_t>::max)(),
+			[this, outputOffset, totalBytes](uint64_t fileBytesCopied)
 			{
-				auto buffer = std::make_unique<char[]>(lMergeFileSize.LowPart);
+				UpdateProgress(outputOffset + fileBytesCopied, totalBytes);
+				return !IsStopRequested();
+			},
+			bytesCopied);
 
-				DWORD dwNumberOfBytesRead;
-				ReadFile(hInputFile, reinterpret_cast<LPVOID>(buffer.get()),
-					static_cast<DWORD>(lMergeFileSize.LowPart), &dwNumberOfBytesRead, nullptr);
+		outputOffset += bytesCopied;
 
-				DWORD dwNumberOfBytesWritten;
-				WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(buffer.get()), dwNumberOfBytesRead,
-					&dwNumberOfBytesWritten, nullptr);
-			}
+		// If one of the files can't be read in full (or the output can't be written to), the
+		// merged file would be incomplete, so there's no point continuing.
+		if (FAILED(hr) || IsStopRequested())
+		{
+			break;
+		}
+	}
+
+	outputFile.reset();
 
-			CloseHandle(hInputFile);
+	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0, 0);
+}
 
-			PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT, nFilesMerged, 0);
+bool MergeFiles::IsStopRequested()
+{
+	EnterCriticalSection(&m_csStop);
+	bool stop = m_bstopMerging;
+	LeaveCriticalSection(&m_csStop);
 
-			nFilesMerged++;
+	return stop;
+}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bstopMerging)
-			{
-				bStop = true;
-			}
-			LeaveCriticalSection(&m_csStop);
-		}
+// A message is only posted when the position of the progress bar actually changes, so that the
+// dialog isn't flooded with messages when a large number of small chunks are copied.
+void MergeFiles::UpdateProgress(uint64_t bytesMerged, uint64_t totalBytes)
+{
+	if (totalBytes == 0)
+	{
+		return;
 	}
 
-	CloseHandle(hOutputFile);
+	auto position = static_cast<int>(
+		(std::min)(bytesMerged, totalBytes) * NMergeFilesDialog::PROGRESS_BAR_RANGE / totalBytes);
 
-	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0, 0);
+	if (position == m_progressPosition)
+	{
+		return;
+	}
+
+	m_progressPosition = position;
+	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETMERGEPROGRESS, position, 0);
 }
 
 void MergeFiles::StopMerging()
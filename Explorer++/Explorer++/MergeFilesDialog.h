@@ -39,6 +39,9 @@ public:
 	void StopMerging();
 
 private:
+	bool IsStopRequested();
+	void UpdateProgress(uint64_t bytesMerged, uint64_t totalBytes);
+
 	HWND m_hDlg;
 
 	std::wstring m_strOutputFilename;
@@ -46,6 +49,8 @@ private:
 
 	CRITICAL_SECTION m_csStop;
 	bool m_bstopMerging;
+
+	int m_progressPosition;
 };
 
 class MergeFilesDialog : public ThemedDialog
@@ -7,10 +7,13 @@
 #include "AddressBar.h"
 #include "ColorRule.h"
 #include "Config.h"
+#include "ConfigFileSnapshot.h"
 #include "DarkModeHelper.h"
 #include "Explorer++_internal.h"
+#include "FeatureList.h"
 #include "HolderWindow.h"
 #include "LoadSaveRegistry.h"
+#include "LoadSaveSession.h"
 #include "LoadSaveXml.h"
 #include "MainResource.h"
 #include "MainToolbar.h"
@@ -20,6 +23,7 @@
 #include "ShellBrowser/ShellNavigationController.h"
 #include "ShellBrowser/ViewModes.h"
 #include "ShellTreeView/ShellTreeView.h"
+#include "StartupPhaseTimer.h"
 #include "SystemFontHelper.h"
 #include "TabContainer.h"
 #include "ToolbarHelper.h"
@@ -32,6 +36,7 @@
 #include "../Helper/MenuHelper.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/SessionStore.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/iDirectoryMonitor.h"
@@ -40,45 +45,28 @@
 #include <wil/resource.h>
 #include <algorithm>
 
-void Explorerplusplus::TestConfigFile()
+namespace
 {
-	m_bLoadSettingsFromXML = TestConfigFileInternal();
-}
-
-BOOL TestConfigFileInternal()
-{
-	HANDLE hConfigFile;
-	TCHAR szConfigFile[MAX_PATH];
-	BOOL bLoadSettingsFromXML = FALSE;
 
-	/* To ensure the configuration file is loaded from the same directory
-	as the executable, determine the fully qualified path of the executable,
-	then save the configuration file in that directory. */
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
+const WCHAR SESSION_STORE_FILE_NAME[] = L"Session.dat";
 
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	hConfigFile =
-		CreateFile(szConfigFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
-
-	if (hConfigFile != INVALID_HANDLE_VALUE)
-	{
-		bLoadSettingsFromXML = TRUE;
-
-		CloseHandle(hConfigFile);
-	}
+std::wstring GetSessionStorePath()
+{
+	TCHAR storePath[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), storePath, SIZEOF_ARRAY(storePath));
+	PathRemoveFileSpec(storePath);
+	PathAppend(storePath, SESSION_STORE_FILE_NAME);
+	return storePath;
+}
 
-	return bLoadSettingsFromXML;
 }
 
 void Explorerplusplus::LoadAllSettings()
 {
-	/* Tests for the existence of the configuration
-	file. If the file is present, a flag is set
-	indicating that the config file should be used
-	to load settings. */
-	TestConfigFile();
+	/* The config file is parsed before the main window
+	is created. If the file is present, settings are
+	loaded from it. */
+	m_bLoadSettingsFromXML = (m_configSnapshot != nullptr);
 
 	std::unique_ptr<ILoadSave> loadSave;
 
@@ -88,7 +76,7 @@ void Explorerplusplus::LoadAllSettings()
 	methods to be different. */
 	if (m_bLoadSettingsFromXML)
 	{
-		loadSave = std::make_unique<LoadSaveXML>(this, TRUE);
+		loadSave = std::make_unique<LoadSaveXML>(this, m_configSnapshot->GetDocument());
 
 		/* When loading from the config file, also
 		set the option to save back to it on exit. */
@@ -99,16 +87,44 @@ void Explorerplusplus::LoadAllSettings()
 		loadSave = std::make_unique<LoadSaveRegistry>(this);
 	}
 
-	loadSave->LoadBookmarks();
-	loadSave->LoadGenericSettings();
-	loadSave->LoadPreviousTabs();
-	loadSave->LoadDefaultColumns();
-	loadSave->LoadApplicationToolbar();
-	loadSave->LoadMainRebarInformation();
-	loadSave->LoadColorRules();
-	loadSave->LoadDialogStates();
+	if (FeatureList::GetInstance()->IsEnabled(Feature::BinarySessionStore))
+	{
+		StartupPhaseTimer timer("Open session store");
+
+		// As with the thumbnail store, the session store is kept alongside the executable. If it
+		// can't be opened (e.g. because another instance is already using it), settings will only
+		// be loaded from and saved to the config file/registry.
+		m_sessionStore = SessionStore::Open(GetSessionStorePath());
+
+		if (m_sessionStore)
+		{
+			loadSave = std::make_unique<LoadSaveSession>(this, m_sessionStore.get(),
+				std::move(loadSave));
+		}
+	}
+
+	const std::pair<std::string_view, void (ILoadSave::*)()> loadPhases[] = {
+		{ "Load bookmarks", &ILoadSave::LoadBookmarks },
+		{ "Load generic settings", &ILoadSave::LoadGenericSettings },
+		{ "Load previous tabs", &ILoadSave::LoadPreviousTabs },
+		{ "Load default columns", &ILoadSave::LoadDefaultColumns },
+		{ "Load application toolbar", &ILoadSave::LoadApplicationToolbar },
+		{ "Load main rebar information", &ILoadSave::LoadMainRebarInformation },
+		{ "Load color rules", &ILoadSave::LoadColorRules },
+		{ "Load dialog states", &ILoadSave::LoadDialogStates }
+	};
+
+	for (const auto &[phaseName, loadFunction] : loadPhases)
+	{
+		StartupPhaseTimer timer(phaseName);
+		(loadSave.get()->*loadFunction)();
+	}
 
 	ValidateLoadedSettings();
+
+	// The snapshot is owned by WinMain and is only guaranteed to be valid while the main window is
+	// being created.
+	m_configSnapshot = nullptr;
 }
 
 void Explorerplusplus::OpenItem(const std::wstring &itemPath,
@@ -1086,13 +1102,19 @@ void Explorerplusplus::SaveAllSettings()
 
 	if (m_bSavePreferencesToXMLFile)
 	{
-		loadSave = std::make_unique<LoadSaveXML>(this, FALSE);
+		loadSave = std::make_unique<LoadSaveXML>(this);
 	}
 	else
 	{
 		loadSave = std::make_unique<LoadSaveRegistry>(this);
 	}
 
+	if (m_sessionStore)
+	{
+		loadSave =
+			std::make_unique<LoadSaveSession>(this, m_sessionStore.get(), std::move(loadSave));
+	}
+
 	loadSave->SaveGenericSettings();
 	loadSave->SaveTabs();
 	loadSave->SaveDefaultColumns();
@@ -1153,6 +1175,31 @@ IDirectoryMonitor *Explorerplusplus::GetDirectoryMonitor() const
 	return m_pDirMon;
 }
 
+FileNameIndexService *Explorerplusplus::GetFileNameIndexService() const
+{
+	return m_fileNameIndexService.get();
+}
+
+FolderSizeService *Explorerplusplus::GetFolderSizeService() const
+{
+	return m_folderSizeService.get();
+}
+
+FolderEnumerationService *Explorerplusplus::GetFolderEnumerationService() const
+{
+	return m_folderEnumerationService.get();
+}
+
+WorkStealingExecutor *Explorerplusplus::GetBackgroundExecutor()
+{
+	return &m_backgroundExecutor;
+}
+
+PriorityTaskScheduler *Explorerplusplus::GetBackgroundTaskScheduler()
+{
+	return &m_backgroundTaskScheduler;
+}
+
 IconResourceLoader *Explorerplusplus::GetIconResourceLoader() const
 {
 	return m_iconResourceLoader.get();
@@ -1163,6 +1210,11 @@ CachedIcons *Explorerplusplus::GetCachedIcons()
 	return &m_cachedIcons;
 }
 
+ThumbnailCache *Explorerplusplus::GetThumbnailCache()
+{
+	return m_thumbnailCache.get();
+}
+
 BOOL Explorerplusplus::GetSavePreferencesToXmlFile() const
 {
 	return m_bSavePreferencesToXMLFile;
@@ -178,6 +178,11 @@ LONG Explorerplusplus::SaveGenericSettingsToRegistry()
 			m_config->checkPinnedToNamespaceTreeProperty);
 		RegistrySettings::SaveDword(hSettingsKey, _T("ShowQuickAccessInTreeView"),
 			m_config->showQuickAccessInTreeView.get());
+		RegistrySettings::SaveDword(hSettingsKey, _T("PrefetchFolders"), m_config->prefetchFolders);
+		RegistrySettings::SaveDword(hSettingsKey, _T("DisablePrefetchingNetworkRemovable"),
+			m_config->disablePrefetchingNetworkRemovable);
+		RegistrySettings::SaveDword(hSettingsKey, _T("StoreThumbnailsOnDisk"),
+			m_config->storeThumbnailsOnDisk);
 		RegistrySettings::SaveDword(hSettingsKey, _T("Theme"), m_config->theme.get());
 
 		RegistrySettings::SaveString(hSettingsKey, _T("NewTabDirectory"),
@@ -400,6 +405,12 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 			_T("CheckPinnedToNamespaceTreeProperty"), m_config->checkPinnedToNamespaceTreeProperty);
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("ShowQuickAccessInTreeView"),
 			m_config->showQuickAccessInTreeView);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("PrefetchFolders"),
+			m_config->prefetchFolders);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey,
+			_T("DisablePrefetchingNetworkRemovable"), m_config->disablePrefetchingNetworkRemovable);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("StoreThumbnailsOnDisk"),
+			m_config->storeThumbnailsOnDisk);
 
 		auto theme = m_config->theme.get();
 		RegistrySettings::ReadBetterEnumValue(hSettingsKey, _T("Theme"), theme);
@@ -7,6 +7,7 @@
 #include "BrowserWindow.h"
 #include "CoreInterface.h"
 #include "DialogConstants.h"
+#include "FileNameIndexService.h"
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
@@ -23,11 +24,13 @@
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
+#include <filesystem>
 #include <regex>
+#include <thread>
 
 namespace NSearchDialog
 {
-const int WM_APP_SEARCHITEMFOUND = WM_APP + 1;
+const int WM_APP_SEARCHRESULTSAVAILABLE = WM_APP + 1;
 const int WM_APP_SEARCHFINISHED = WM_APP + 2;
 const int WM_APP_SEARCHCHANGEDDIRECTORY = WM_APP + 3;
 const int WM_APP_REGULAREXPRESSIONINVALID = WM_APP + 4;
@@ -342,7 +345,8 @@ void SearchDialog::StartSearching()
 	}
 
 	m_pSearch = new Search(m_hDlg, szBaseDirectory, szSearchPattern, dwAttributes,
-		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders);
+		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders,
+		m_coreInterface->GetFileNameIndexService(), m_coreInterface->GetBackgroundExecutor());
 	m_pSearch->AddRef();
 
 	/* Save the search directory and search pattern (only if they are not
@@ -638,6 +642,13 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 {
 	switch (pnmhdr->code)
 	{
+	case LVN_GETDISPINFO:
+		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
+		{
+			OnSearchResultsGetDisplayInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		}
+		break;
+
 	case NM_DBLCLK:
 		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
 		{
@@ -772,6 +783,26 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 	return 0;
 }
 
+void SearchDialog::OnSearchResultsGetDisplayInfo(NMLVDISPINFO *dispInfo)
+{
+	if (WI_IsFlagClear(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		return;
+	}
+
+	auto itr = m_SearchItemsMapInternal.find(static_cast<int>(dispInfo->item.lParam));
+	CHECK(itr != m_SearchItemsMapInternal.end());
+
+	SHFILEINFO shfi;
+	DWORD_PTR res =
+		SHGetFileInfo(itr->second.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+
+	dispInfo->item.iImage = res ? shfi.iIcon : 0;
+
+	// The icon won't change, so there's no need for the listview to request it again.
+	WI_SetFlag(dispInfo->item.mask, LVIF_DI_SETITEM);
+}
+
 INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
@@ -780,28 +811,22 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	add it onto the list of current items, which will be processed
 	in batch. This is done to stop this message from blocking the
 	main GUI (also see http://www.flounder.com/iocompletion.htm). */
-	case NSearchDialog::WM_APP_SEARCHITEMFOUND:
-	{
-		m_AwaitingSearchItems.push_back(reinterpret_cast<PIDLIST_ABSOLUTE>(wParam));
-
-		if (m_bSetSearchTimer)
-		{
-			SetTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED,
-				nullptr);
-
-			m_bSetSearchTimer = FALSE;
-		}
-	}
-	break;
+	case NSearchDialog::WM_APP_SEARCHRESULTSAVAILABLE:
+		RetrieveSearchResults();
+		break;
 
 	case NSearchDialog::WM_APP_SEARCHFINISHED:
 	{
 		TCHAR szStatus[512];
 
+		// The search finished message is sent, so may be processed before a results message that
+		// was posted earlier. Any results that haven't been retrieved yet are retrieved here.
+		RetrieveSearchResults();
+
 		if (!m_bStopSearching)
 		{
-			int iFoldersFound = LOWORD(lParam);
-			int iFilesFound = HIWORD(lParam);
+			int iFoldersFound = static_cast<int>(wParam);
+			int iFilesFound = static_cast<int>(lParam);
 
 			TCHAR szTemp[128];
 			LoadString(GetResourceInstance(), IDS_SEARCH_FINISHED_MESSAGE, szTemp,
@@ -829,14 +854,17 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 	case NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY:
 	{
-		TCHAR szStatus[512];
-		TCHAR *pszDirectory = nullptr;
+		if (!m_pSearch)
+		{
+			break;
+		}
 
-		pszDirectory = reinterpret_cast<TCHAR *>(wParam);
+		TCHAR szStatus[512];
+		auto directory = m_pSearch->GetLastSearchedDirectory();
 
 		TCHAR szTemp[64];
 		LoadString(GetResourceInstance(), IDS_SEARCHING, szTemp, SIZEOF_ARRAY(szTemp));
-		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, pszDirectory);
+		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, directory.c_str());
 		SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
 	}
 	break;
@@ -870,6 +898,31 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+void SearchDialog::RetrieveSearchResults()
+{
+	if (!m_pSearch)
+	{
+		return;
+	}
+
+	auto results = m_pSearch->TakeResults();
+
+	if (results.empty())
+	{
+		return;
+	}
+
+	m_AwaitingSearchItems.insert(m_AwaitingSearchItems.end(),
+		std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+
+	if (m_bSetSearchTimer)
+	{
+		SetTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED, nullptr);
+
+		m_bSetSearchTimer = FALSE;
+	}
+}
+
 INT_PTR SearchDialog::OnTimer(int iTimerID)
 {
 	if (iTimerID != SEARCH_PROCESSITEMS_TIMER_ID)
@@ -884,44 +937,33 @@ INT_PTR SearchDialog::OnTimer(int iTimerID)
 		min(static_cast<int>(m_AwaitingSearchItems.size()), SEARCH_MAX_ITEMS_BATCH_PROCESS);
 	int i = 0;
 
-	auto itr = m_AwaitingSearchItems.begin();
-
 	while (i < nItems)
 	{
 		LVITEM lvItem;
-		SHFILEINFO shfi;
 		int iIndex;
 
-		PIDLIST_ABSOLUTE pidl = *itr;
-
-		std::wstring fullFileName;
-		GetDisplayName(pidl, SHGDN_FORPARSING, fullFileName);
+		std::wstring fullFileName = std::move(m_AwaitingSearchItems.front());
+		m_AwaitingSearchItems.pop_front();
 
-		TCHAR directory[MAX_PATH];
-		StringCchCopy(directory, std::size(directory), fullFileName.c_str());
-		PathRemoveFileSpec(directory);
-
-		std::wstring fileName;
-		GetDisplayName(pidl, SHGDN_INFOLDER | SHGDN_FORPARSING, fileName);
-
-		SHGetFileInfo((LPCWSTR) pidl, 0, &shfi, sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
+		std::filesystem::path path(fullFileName);
+		std::wstring fileName = path.filename();
+		std::wstring directory = path.parent_path();
 
 		m_SearchItemsMapInternal.insert(
 			std::unordered_map<int, std::wstring>::value_type(m_iInternalIndex, fullFileName));
 
+		// The icon is only retrieved once the item is actually shown. Retrieving it requires the
+		// path to be parsed, which is comparatively expensive and unnecessary for items that are
+		// never scrolled into view.
 		lvItem.mask = LVIF_IMAGE | LVIF_TEXT | LVIF_PARAM;
 		lvItem.pszText = fileName.data();
 		lvItem.iItem = nListViewItems + i;
 		lvItem.iSubItem = 0;
-		lvItem.iImage = shfi.iIcon;
+		lvItem.iImage = I_IMAGECALLBACK;
 		lvItem.lParam = m_iInternalIndex++;
 		iIndex = ListView_InsertItem(hListView, &lvItem);
 
-		ListView_SetItemText(hListView, iIndex, 1, directory);
-
-		CoTaskMemFree(pidl);
-
-		itr = m_AwaitingSearchItems.erase(itr);
+		ListView_SetItemText(hListView, iIndex, 1, directory.data());
 
 		i++;
 	}
@@ -956,7 +998,11 @@ DWORD WINAPI NSearchDialog::SearchThread(LPVOID pParam)
 }
 
 Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders)
+	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+	FileNameIndexService *fileNameIndexService, WorkStealingExecutor *executor) :
+	m_fileNameIndexService(fileNameIndexService),
+	m_wildcardPattern(szPattern, !bCaseInsensitive),
+	m_taskGroup(executor)
 {
 	m_hDlg = hDlg;
 	m_dwAttributes = dwAttributes;
@@ -966,21 +1012,10 @@ Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttr
 
 	StringCchCopy(m_szBaseDirectory, std::size(m_szBaseDirectory), szBaseDirectory);
 	StringCchCopy(m_szSearchPattern, std::size(m_szSearchPattern), szPattern);
-
-	InitializeCriticalSection(&m_csStop);
-	m_bStopSearching = FALSE;
-}
-
-Search::~Search()
-{
-	DeleteCriticalSection(&m_csStop);
 }
 
 void Search::StartSearching()
 {
-	m_iFoldersFound = 0;
-	m_iFilesFound = 0;
-
 	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0 && m_bUseRegularExpressions)
 	{
 		try
@@ -998,163 +1033,265 @@ void Search::StartSearching()
 		{
 			SendMessage(m_hDlg, NSearchDialog::WM_APP_REGULAREXPRESSIONINVALID, 0, 0);
 
+			Release();
+
 			return;
 		}
 	}
 
-	SearchDirectory(m_szBaseDirectory);
+	if (!SearchIndex())
+	{
+		QueueDirectory(m_szBaseDirectory);
 
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, 0,
-		MAKELPARAM(m_iFoldersFound, m_iFilesFound));
+		std::unique_lock lock(m_pendingDirectoriesMutex);
+		m_pendingDirectoriesCondition.wait(lock, [this] { return m_numPendingDirectories == 0; });
+	}
+
+	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, m_iFoldersFound.load(),
+		m_iFilesFound.load());
 
 	Release();
 }
 
-void Search::SearchDirectory(const TCHAR *szDirectory)
+// Returns false if the search couldn't be performed using an index.
+bool Search::SearchIndex()
 {
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY,
-		reinterpret_cast<WPARAM>(szDirectory), 0);
+	// An index always covers an entire directory tree, so it's only useful when subfolders are
+	// being searched.
+	if (!m_fileNameIndexService || !m_bSearchSubFolders)
+	{
+		return false;
+	}
 
-	std::list<std::wstring> subFolderList;
+	auto items = m_fileNameIndexService->FindItems(m_szBaseDirectory,
+		[this](std::wstring_view name, const FileNameIndex::ItemData &itemData)
+		{ return DoesItemMatch(name, itemData.attributes); });
 
-	SearchDirectoryInternal(szDirectory, &subFolderList);
+	if (!items)
+	{
+		return false;
+	}
 
-	bool bStop = false;
+	std::vector<std::wstring> results;
 
-	EnterCriticalSection(&m_csStop);
-	if (m_bStopSearching)
+	for (auto &item : *items)
 	{
-		bStop = true;
+		if (m_stopSearching)
+		{
+			break;
+		}
+
+		if (WI_IsFlagSet(item.data.attributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			m_iFoldersFound++;
+		}
+		else
+		{
+			m_iFilesFound++;
+		}
+
+		results.push_back(std::move(item.path));
+
+		if (results.size() >= RESULT_BATCH_SIZE)
+		{
+			AddResults(std::move(results));
+			results.clear();
+		}
 	}
-	LeaveCriticalSection(&m_csStop);
 
-	if (bStop)
+	if (!results.empty())
 	{
-		return;
+		AddResults(std::move(results));
 	}
 
-	if (m_bSearchSubFolders)
+	return true;
+}
+
+void Search::QueueDirectory(const std::wstring &directory)
+{
 	{
-		for (const auto &strSubFolder : subFolderList)
+		std::scoped_lock lock(m_pendingDirectoriesMutex);
+		m_numPendingDirectories++;
+	}
+
+	m_taskGroup.Submit(
+		[this, directory]()
 		{
-			SearchDirectory(strSubFolder.c_str());
-		}
+			SearchDirectory(directory);
+			OnDirectoryFinished();
+		});
+}
+
+void Search::OnDirectoryFinished()
+{
+	std::scoped_lock lock(m_pendingDirectoriesMutex);
+	m_numPendingDirectories--;
+
+	if (m_numPendingDirectories == 0)
+	{
+		m_pendingDirectoriesCondition.notify_all();
 	}
 }
 
-/* Can't recurse, as it would overflow the stack. */
-void Search::SearchDirectoryInternal(const TCHAR *szSearchDirectory,
-	std::list<std::wstring> *pSubFolderList)
+void Search::SearchDirectory(const std::wstring &directory)
 {
-	assert(szSearchDirectory != nullptr);
-	assert(pSubFolderList != nullptr);
+	if (m_stopSearching)
+	{
+		return;
+	}
 
-	WIN32_FIND_DATA wfd;
-	TCHAR szSearchTerm[MAX_PATH];
+	UpdateLastSearchedDirectory(directory);
 
-	PathCombine(szSearchTerm, szSearchDirectory, _T("*"));
+	std::wstring directoryPrefix = directory;
 
-	HANDLE hFindFile = FindFirstFile(szSearchTerm, &wfd);
+	if (!directoryPrefix.empty() && directoryPrefix.back() != '\\')
+	{
+		directoryPrefix += '\\';
+	}
+
+	// The short name of each item isn't used, so there's no need to retrieve it. Large fetches
+	// reduce the number of calls made to the file system when enumerating large directories.
+	WIN32_FIND_DATA wfd;
+	wil::unique_hfind findFile(FindFirstFileEx((directoryPrefix + L"*").c_str(), FindExInfoBasic,
+		&wfd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
 
-	if (hFindFile != INVALID_HANDLE_VALUE)
+	if (!findFile)
 	{
-		bool bStop = false;
+		return;
+	}
 
-		while (FindNextFile(hFindFile, &wfd) != 0 && !bStop)
+	std::vector<std::wstring> results;
+
+	do
+	{
+		if (m_stopSearching)
 		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
+			break;
+		}
 
-				/* Only match against the filename if it's not empty. */
-				if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
-				{
-					if (m_bUseRegularExpressions)
-					{
-						if (std::regex_match(wfd.cFileName, m_rxPattern))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-					else
-					{
-						if (CheckWildcardMatch(m_szSearchPattern, wfd.cFileName,
-								!m_bCaseInsensitive))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-				}
-				else
-				{
-					/* No filename constraint, so all filenames match. */
-					bMatchFileName = TRUE;
-				}
+		if (lstrcmp(wfd.cFileName, _T(".")) == 0 || lstrcmp(wfd.cFileName, _T("..")) == 0)
+		{
+			continue;
+		}
 
-				if (m_dwAttributes != 0)
-				{
-					if ((wfd.dwFileAttributes & m_dwAttributes) == m_dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
+		bool isFolder = WI_IsFlagSet(wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+		std::wstring fullFileName = directoryPrefix + wfd.cFileName;
 
-				BOOL bItemMatch = bMatchFileName && bMatchAttributes;
+		if (isFolder && m_bSearchSubFolders)
+		{
+			QueueDirectory(fullFileName);
+		}
 
-				if (bItemMatch)
-				{
-					if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						== FILE_ATTRIBUTE_DIRECTORY)
-					{
-						m_iFoldersFound++;
-					}
-					else
-					{
-						m_iFilesFound++;
-					}
+		if (!DoesItemMatch(wfd.cFileName, wfd.dwFileAttributes))
+		{
+			continue;
+		}
 
-					TCHAR szFullFileName[MAX_PATH];
-					PathCombine(szFullFileName, szSearchDirectory, wfd.cFileName);
+		if (isFolder)
+		{
+			m_iFoldersFound++;
+		}
+		else
+		{
+			m_iFilesFound++;
+		}
 
-					unique_pidl_absolute pidl;
-					SHParseDisplayName(szFullFileName, nullptr, wil::out_param(pidl), 0, nullptr);
+		results.push_back(std::move(fullFileName));
 
-					PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMFOUND,
-						reinterpret_cast<WPARAM>(ILCloneFull(pidl.get())), 0);
-				}
+		if (results.size() >= RESULT_BATCH_SIZE)
+		{
+			AddResults(std::move(results));
+			results.clear();
+		}
+	} while (FindNextFile(findFile.get(), &wfd));
 
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					TCHAR szSubFolder[MAX_PATH];
+	if (!results.empty())
+	{
+		AddResults(std::move(results));
+	}
+}
 
-					PathCombine(szSubFolder, szSearchDirectory, wfd.cFileName);
+bool Search::DoesItemMatch(std::wstring_view fileName, DWORD attributes) const
+{
+	/* Only match against the filename if it's not empty. */
+	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
+	{
+		bool matchedFileName;
 
-					pSubFolderList->push_back(szSubFolder);
-				}
-			}
+		if (m_bUseRegularExpressions)
+		{
+			matchedFileName = std::regex_match(fileName.begin(), fileName.end(), m_rxPattern);
+		}
+		else
+		{
+			matchedFileName = m_wildcardPattern.Matches(fileName);
+		}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bStopSearching)
-			{
-				bStop = true;
-			}
-			LeaveCriticalSection(&m_csStop);
+		if (!matchedFileName)
+		{
+			return false;
 		}
+	}
+
+	if (m_dwAttributes != 0 && (attributes & m_dwAttributes) != m_dwAttributes)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void Search::AddResults(std::vector<std::wstring> &&results)
+{
+	std::scoped_lock lock(m_resultsMutex);
 
-		FindClose(hFindFile);
+	m_pendingResults.insert(m_pendingResults.end(), std::make_move_iterator(results.begin()),
+		std::make_move_iterator(results.end()));
+
+	// Only a single notification is outstanding at any one time. Any results added before the
+	// dialog responds will be retrieved along with the results that triggered the notification.
+	if (!m_resultsNotificationPending)
+	{
+		PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHRESULTSAVAILABLE, 0, 0);
+		m_resultsNotificationPending = true;
 	}
 }
 
+std::vector<std::wstring> Search::TakeResults()
+{
+	std::scoped_lock lock(m_resultsMutex);
+	m_resultsNotificationPending = false;
+	return std::exchange(m_pendingResults, {});
+}
+
+void Search::UpdateLastSearchedDirectory(const std::wstring &directory)
+{
+	ULONGLONG now = GetTickCount64();
+	ULONGLONG lastUpdateTime = m_lastStatusUpdateTime;
+
+	if ((now - lastUpdateTime) < STATUS_UPDATE_INTERVAL
+		|| !m_lastStatusUpdateTime.compare_exchange_strong(lastUpdateTime, now))
+	{
+		return;
+	}
+
+	{
+		std::scoped_lock lock(m_resultsMutex);
+		m_lastSearchedDirectory = directory;
+	}
+
+	PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY, 0, 0);
+}
+
+std::wstring Search::GetLastSearchedDirectory()
+{
+	std::scoped_lock lock(m_resultsMutex);
+	return m_lastSearchedDirectory;
+}
+
 void Search::StopSearching()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSearching = TRUE;
-	LeaveCriticalSection(&m_csStop);
+	m_stopSearching = true;
 }
 
 void SearchDialog::SaveState()
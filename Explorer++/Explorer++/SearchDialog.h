@@ -8,10 +8,16 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/ReferenceCount.h"
 #include "../Helper/ShellContextMenu.h"
+#include "../Helper/WildcardPattern.h"
+#include "../Helper/WorkStealingExecutor.h"
 #include <boost/circular_buffer.hpp>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <unordered_map>
@@ -19,6 +25,7 @@
 
 class BrowserWindow;
 class CoreInterface;
+class FileNameIndexService;
 class SearchDialog;
 class TabContainer;
 
@@ -100,20 +107,41 @@ private:
 	int m_iColumnWidth2;
 };
 
+// Searches a directory tree for items matching a pattern. Each directory is searched as a separate
+// task on a pool of worker threads, with the subdirectories found being queued as further tasks.
+// Matching items are returned as full paths, in batches. Rather than sending a message for each
+// result, the dialog is notified when results are available and retrieves everything that has
+// accumulated since the last notification.
+//
+// If subfolders are being searched and the base directory is covered by a file name index, the
+// index will be searched instead of the file system.
 class Search : public ReferenceCount
 {
 public:
 	Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders);
-	~Search();
+		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+		FileNameIndexService *fileNameIndexService, WorkStealingExecutor *executor);
 
 	void StartSearching();
 	void StopSearching();
 
+	std::vector<std::wstring> TakeResults();
+	std::wstring GetLastSearchedDirectory();
+
 private:
-	void SearchDirectory(const TCHAR *szDirectory);
-	void SearchDirectoryInternal(const TCHAR *szSearchDirectory,
-		std::list<std::wstring> *pSubFolderList);
+	// The number of results a worker will accumulate before making them available to the dialog.
+	static const size_t RESULT_BATCH_SIZE = 100;
+
+	// The minimum amount of time between updates to the directory shown in the dialog.
+	static const ULONGLONG STATUS_UPDATE_INTERVAL = 100;
+
+	bool SearchIndex();
+	void QueueDirectory(const std::wstring &directory);
+	void SearchDirectory(const std::wstring &directory);
+	void OnDirectoryFinished();
+	bool DoesItemMatch(std::wstring_view fileName, DWORD attributes) const;
+	void AddResults(std::vector<std::wstring> &&results);
+	void UpdateLastSearchedDirectory(const std::wstring &directory);
 
 	HWND m_hDlg;
 
@@ -123,14 +151,31 @@ private:
 	BOOL m_bUseRegularExpressions;
 	BOOL m_bCaseInsensitive;
 	BOOL m_bSearchSubFolders;
+	FileNameIndexService *const m_fileNameIndexService;
 
 	std::wregex m_rxPattern;
+	WildcardPattern m_wildcardPattern;
 
-	CRITICAL_SECTION m_csStop;
-	BOOL m_bStopSearching;
+	std::atomic<bool> m_stopSearching = false;
+
+	std::atomic<int> m_iFoldersFound = 0;
+	std::atomic<int> m_iFilesFound = 0;
+
+	// The number of directories that have been queued, but not yet fully searched. The search is
+	// complete once this reaches 0.
+	std::mutex m_pendingDirectoriesMutex;
+	std::condition_variable m_pendingDirectoriesCondition;
+	int m_numPendingDirectories = 0;
+
+	std::mutex m_resultsMutex;
+	std::vector<std::wstring> m_pendingResults;
+	bool m_resultsNotificationPending = false;
+	std::wstring m_lastSearchedDirectory;
+	std::atomic<ULONGLONG> m_lastStatusUpdateTime = 0;
 
-	int m_iFoldersFound;
-	int m_iFilesFound;
+	// Each directory is searched in a separate task on the shared background executor. Declared
+	// last, since those tasks use the members above.
+	WorkStealingExecutor::TaskGroup m_taskGroup;
 };
 
 class SearchDialog : public ThemedDialog, private ShellContextMenuHandler
@@ -170,6 +215,8 @@ private:
 	void OnSearch();
 	void StartSearching();
 	void StopSearching();
+	void RetrieveSearchResults();
+	void OnSearchResultsGetDisplayInfo(NMLVDISPINFO *dispInfo);
 	void SaveEntry(int comboBoxId, boost::circular_buffer<std::wstring> &buffer);
 	void UpdateListViewHeader();
 
@@ -194,7 +241,7 @@ private:
 	Search *m_pSearch = nullptr;
 
 	/* Listview item information. */
-	std::list<PIDLIST_ABSOLUTE> m_AwaitingSearchItems;
+	std::deque<std::wstring> m_AwaitingSearchItems;
 	std::unordered_map<int, std::wstring> m_SearchItemsMapInternal;
 	int m_iInternalIndex;
 	int m_iPreviousSelectedColumn;
@@ -0,0 +1,271 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellBrowserImpl.h"
+#include "ItemData.h"
+#include "ViewModes.h"
+#include <algorithm>
+
+uint64_t ShellBrowserImpl::GetBackgroundTaskId(BackgroundTaskType type, int value)
+{
+	return (static_cast<uint64_t>(type) << 32) | static_cast<uint32_t>(value);
+}
+
+// Returns the range of items that are currently visible, as [first, last). Items are assumed to be
+// laid out in index order, which isn't the case when items are shown in groups, so std::nullopt is
+// returned in that case.
+std::optional<std::pair<int, int>> ShellBrowserImpl::GetVisibleItemRange() const
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0 || ListView_IsGroupViewEnabled(m_hListView))
+	{
+		return std::nullopt;
+	}
+
+	if (m_folderSettings.viewMode == +ViewMode::Details
+		|| m_folderSettings.viewMode == +ViewMode::List)
+	{
+		int topIndex = ListView_GetTopIndex(m_hListView);
+
+		// The count doesn't include a partially visible item at the end of the view, so one extra
+		// item is included.
+		return std::make_pair(topIndex,
+			std::min(topIndex + ListView_GetCountPerPage(m_hListView) + 1, numItems));
+	}
+
+	// In the remaining views, items are arranged in rows, so the first visible item is the first
+	// item that ends below the top of the view and the last visible item is the one before the
+	// first item that starts below the bottom of the view.
+	RECT clientRect;
+	GetClientRect(m_hListView, &clientRect);
+
+	auto findFirstItem = [this, numItems](auto predicate)
+	{
+		int low = 0;
+		int high = numItems;
+
+		while (low < high)
+		{
+			int mid = low + (high - low) / 2;
+
+			RECT itemRect;
+			ListView_GetItemRect(m_hListView, mid, &itemRect, LVIR_BOUNDS);
+
+			if (predicate(itemRect))
+			{
+				high = mid;
+			}
+			else
+			{
+				low = mid + 1;
+			}
+		}
+
+		return low;
+	};
+
+	int first = findFirstItem([](const RECT &itemRect) { return itemRect.bottom > 0; });
+	int last = findFirstItem(
+		[&clientRect](const RECT &itemRect) { return itemRect.top >= clientRect.bottom; });
+
+	return std::make_pair(first, std::max(first, last));
+}
+
+// Returns the priority that background tasks for items in and around the visible area should
+// have, keyed by the internal index of each item. Visible items come first, in the order they
+// appear, followed by the items within a page of the visible area. Tasks for any other item can
+// be cancelled, since they'll be requested again if the item is scrolled back into view.
+std::optional<std::unordered_map<int, PriorityTaskScheduler::Priority>>
+ShellBrowserImpl::GetItemTaskPriorities() const
+{
+	auto visibleRange = GetVisibleItemRange();
+
+	if (!visibleRange || visibleRange->first == visibleRange->second)
+	{
+		return std::nullopt;
+	}
+
+	auto [first, last] = *visibleRange;
+	int numVisibleItems = last - first;
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::unordered_map<int, PriorityTaskScheduler::Priority> priorities;
+
+	for (int i = std::max(first - numVisibleItems, 0);
+		 i < std::min(last + numVisibleItems, numItems); i++)
+	{
+		PriorityTaskScheduler::Priority priority;
+
+		if (i < first)
+		{
+			priority = numVisibleItems + (first - i);
+		}
+		else if (i < last)
+		{
+			priority = i - first;
+		}
+		else
+		{
+			priority = numVisibleItems + (i - last) + 1;
+		}
+
+		priorities.insert({ GetItemInternalIndex(i), priority });
+	}
+
+	return priorities;
+}
+
+// Called once the listview has been scrolled. Tasks for items that are now visible are moved to
+// the front of the queue, while tasks for items that have been scrolled well out of view are
+// cancelled.
+void ShellBrowserImpl::UpdateTaskPriorities()
+{
+	auto itemPriorities = GetItemTaskPriorities();
+
+	if (!itemPriorities)
+	{
+		return;
+	}
+
+	auto getItemPriority =
+		[&itemPriorities](int internalIndex) -> std::optional<PriorityTaskScheduler::Priority>
+	{
+		auto itr = itemPriorities->find(internalIndex);
+
+		if (itr == itemPriorities->end())
+		{
+			return std::nullopt;
+		}
+
+		return itr->second;
+	};
+
+	auto cancelledTaskIds = m_taskScheduler->UpdatePriorities(this,
+		[this, &getItemPriority](uint64_t id, PriorityTaskScheduler::Priority currentPriority)
+			-> std::optional<PriorityTaskScheduler::Priority>
+		{
+			auto type = static_cast<BackgroundTaskType>(id >> 32);
+			int value = static_cast<int>(id & 0xFFFFFFFF);
+
+			switch (type)
+			{
+			case BackgroundTaskType::ColumnBatch:
+			{
+				auto itr = m_columnResults.find(value);
+
+				if (itr == m_columnResults.end())
+				{
+					return currentPriority;
+				}
+
+				// A batch is only cancelled if none of its items are near the visible area.
+				std::optional<PriorityTaskScheduler::Priority> batchPriority;
+
+				for (const auto &column : itr->second.columns)
+				{
+					auto itemPriority = getItemPriority(column.itemInternalIndex);
+
+					if (itemPriority && (!batchPriority || *itemPriority < *batchPriority))
+					{
+						batchPriority = itemPriority;
+					}
+				}
+
+				return batchPriority;
+			}
+
+			case BackgroundTaskType::Icon:
+			case BackgroundTaskType::Thumbnail:
+				return getItemPriority(value);
+
+			default:
+				return currentPriority;
+			}
+		});
+
+	std::unordered_set<int> itemsWithCancelledImages;
+
+	for (auto id : cancelledTaskIds)
+	{
+		auto type = static_cast<BackgroundTaskType>(id >> 32);
+		int value = static_cast<int>(id & 0xFFFFFFFF);
+
+		if (type == BackgroundTaskType::ColumnBatch)
+		{
+			CancelColumnBatch(value);
+		}
+		else
+		{
+			itemsWithCancelledImages.insert(value);
+		}
+	}
+
+	if (itemsWithCancelledImages.empty())
+	{
+		return;
+	}
+
+	auto isCancelled = [&itemsWithCancelledImages](const auto &entry)
+	{ return itemsWithCancelledImages.contains(entry.second.itemInternalIndex); };
+	std::erase_if(m_iconResults, isCancelled);
+	std::erase_if(m_thumbnailResults, isCancelled);
+
+	InvalidateItemImages(itemsWithCancelledImages);
+}
+
+void ShellBrowserImpl::CancelBackgroundTasks(BackgroundTaskType type)
+{
+	m_taskScheduler->UpdatePriorities(this,
+		[type](uint64_t id, PriorityTaskScheduler::Priority currentPriority)
+			-> std::optional<PriorityTaskScheduler::Priority>
+		{
+			if (static_cast<BackgroundTaskType>(id >> 32) == type)
+			{
+				return std::nullopt;
+			}
+
+			return currentPriority;
+		});
+}
+
+// Resets the image for each of the specified items, so that it will be requested again the next
+// time the item is shown. Note that the set is modified by this method.
+void ShellBrowserImpl::InvalidateItemImages(std::unordered_set<int> &internalIndexes)
+{
+	if (m_ownerData)
+	{
+		for (int internalIndex : internalIndexes)
+		{
+			auto itr = m_itemInfoMap.find(internalIndex);
+
+			if (itr != m_itemInfoMap.end())
+			{
+				itr->second.imageIndex.reset();
+			}
+		}
+
+		return;
+	}
+
+	// The position of each item isn't tracked outside of owner data mode, so the items are found in
+	// a single pass through the listview, rather than searching for each item individually.
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	for (int i = 0; i < numItems && !internalIndexes.empty(); i++)
+	{
+		if (internalIndexes.erase(GetItemInternalIndex(i)) == 0)
+		{
+			continue;
+		}
+
+		LVITEM lvItem;
+		lvItem.mask = LVIF_IMAGE;
+		lvItem.iItem = i;
+		lvItem.iSubItem = 0;
+		lvItem.iImage = I_IMAGECALLBACK;
+		ListView_SetItem(m_hListView, &lvItem);
+	}
+}
@@ -15,6 +15,7 @@
 #include "ShellView.h"
 #include "ViewModes.h"
 #include "WebBrowserApp.h"
+#include "../Helper/FileTypeNameCache.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
@@ -32,8 +33,7 @@ HRESULT ShellBrowserImpl::Navigate(NavigateParams &navigateParams)
 
 	m_navigationStartedSignal(navigateParams);
 
-	std::vector<ItemInfo_t> items;
-	HRESULT hr = PerformEnumeration(navigateParams, items);
+	HRESULT hr = PerformEnumeration(navigateParams);
 
 	if (FAILED(hr))
 	{
@@ -41,7 +41,9 @@ HRESULT ShellBrowserImpl::Navigate(NavigateParams &navigateParams)
 		return hr;
 	}
 
-	OnEnumerationCompleted(std::move(items), navigateParams);
+	// The items in the folder will be enumerated in the background. The navigation will be
+	// completed once all the items have been retrieved.
+	StartEnumeration(navigateParams);
 
 	return hr;
 }
@@ -69,16 +71,18 @@ void ShellBrowserImpl::PrepareToChangeFolders()
 
 void ShellBrowserImpl::ClearPendingResults()
 {
-	m_columnThreadPool.clear_queue();
+	CancelEnumeration();
+
+	m_taskScheduler->CancelTasks(this);
 	m_columnResults.clear();
+	m_iconResults.clear();
+	m_thumbnailResults.clear();
+	m_infoTipResults.clear();
 
 	m_iconFetcher->ClearQueue();
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
-
-	m_infoTipsThreadPool.clear_queue();
-	m_infoTipResults.clear();
+	m_pendingColumnText.clear();
+	m_pendingColumnRequests.clear();
 }
 
 void ShellBrowserImpl::ResetFolderState()
@@ -93,6 +97,16 @@ void ShellBrowserImpl::ResetFolderState()
 	LeaveCriticalSection(&m_csDirectoryAltered);
 
 	m_itemInfoMap.clear();
+	m_itemLookupIndex.Clear();
+
+	m_itemStore.Clear();
+	m_ownerDataItems.clear();
+	m_ownerDataPositions.clear();
+	m_itemPositionHints.clear();
+	m_columnTextCache.Clear();
+	m_pendingColumnText.clear();
+	m_pendingColumnRequests.clear();
+	m_columnTextGenerations.clear();
 
 	m_renamedItemOldPidl.reset();
 }
@@ -110,8 +124,7 @@ void ShellBrowserImpl::StoreCurrentlySelectedItems()
 	entry->SetSelectedItems(selectedItems);
 }
 
-HRESULT ShellBrowserImpl::PerformEnumeration(NavigateParams &navigateParams,
-	std::vector<ShellBrowserImpl::ItemInfo_t> &items)
+HRESULT ShellBrowserImpl::PerformEnumeration(NavigateParams &navigateParams)
 {
 	// Note that although standard shortcuts (.lnk files) are currently handled outside this class,
 	// symlinks and virtual link objects aren't, so they will be handled here.
@@ -142,8 +155,20 @@ HRESULT ShellBrowserImpl::PerformEnumeration(NavigateParams &navigateParams,
 	std::wstring parsingPath;
 	RETURN_IF_FAILED(GetDisplayName(parent.get(), child, SHGDN_FORPARSING, parsingPath));
 
-	RETURN_IF_FAILED(
-		EnumerateFolder(navigateParams.pidl.Raw(), m_hOwner, m_folderSettings.showHidden, items));
+	// The enumeration itself happens asynchronously, so the only thing that's checked here is that
+	// the folder can be bound to. If that's not possible, there's no point in changing folders.
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	RETURN_IF_FAILED(BindToIdl(navigateParams.pidl.Raw(), IID_PPV_ARGS(&shellFolder)));
+
+	// When the current folder is navigated to again (e.g. when it's refreshed), the items should
+	// be retrieved from the folder itself, rather than from the cache.
+	if (m_bFolderVisited
+		&& CompareStringOrdinal(m_directoryState.directory.c_str(), -1, parsingPath.c_str(), -1,
+			   TRUE)
+			== CSTR_EQUAL)
+	{
+		m_folderEnumerationService->InvalidateFolder(parsingPath);
+	}
 
 	PrepareToChangeFolders();
 
@@ -158,14 +183,173 @@ HRESULT ShellBrowserImpl::PerformEnumeration(NavigateParams &navigateParams,
 
 	NotifyShellOfNavigation(navigateParams.pidl.Raw());
 
+	// This is set here, rather than when the enumeration completes, so that the state for this
+	// folder will be reset if another navigation starts before the enumeration has finished.
+	m_bFolderVisited = TRUE;
+
 	m_navigationCommittedSignal(navigateParams);
 
 	return S_OK;
 }
 
-HRESULT ShellBrowserImpl::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, HWND owner,
-	bool showHidden, std::vector<ShellBrowserImpl::ItemInfo_t> &items)
+void ShellBrowserImpl::StartEnumeration(const NavigateParams &navigateParams)
+{
+	// Any previous enumeration should have been canceled when changing folders.
+	DCHECK(!m_enumerationResults);
+
+	m_enumerationResults = std::make_shared<EnumerationResults>(m_uniqueFolderId);
+	m_enumerationNavigateParams = navigateParams;
+
+	auto enumerationTicket =
+		m_folderEnumerationService->StartEnumeration(navigateParams.pidl.Raw());
+
+	m_enumerationTaskGroup.Submit(
+		[listView = m_hListView, owner = m_hOwner, pidlDirectory = navigateParams.pidl,
+			showHidden = m_folderSettings.showHidden,
+			folderEnumerationService = m_folderEnumerationService, enumerationTicket,
+			results = m_enumerationResults]()
+		{
+			EnumerateFolderAsync(listView, owner, pidlDirectory.Raw(), showHidden,
+				folderEnumerationService, enumerationTicket, results);
+		},
+		WorkStealingExecutor::Apartment::Required);
+}
+
+void ShellBrowserImpl::CancelEnumeration()
+{
+	if (!m_enumerationResults)
+	{
+		return;
+	}
+
+	// The background thread checks this flag after each item it retrieves, so it should stop
+	// shortly. Any batches that it has already posted will be ignored, since they will no longer
+	// match the current enumeration.
+	m_enumerationResults->cancelled = true;
+	m_enumerationResults.reset();
+	m_enumerationNavigateParams.reset();
+}
+
+// Runs on a background thread. Note that this method is static and only has access to the state
+// that's passed in, since the ShellBrowserImpl instance may be destroyed while the enumeration is
+// still running.
+void ShellBrowserImpl::EnumerateFolderAsync(HWND listView, HWND owner,
+	PCIDLIST_ABSOLUTE pidlDirectory, bool showHidden,
+	FolderEnumerationService *folderEnumerationService,
+	const std::optional<FolderEnumerationService::EnumerationTicket> &enumerationTicket,
+	std::shared_ptr<EnumerationResults> results)
+{
+	auto markFinished = wil::scope_exit(
+		[listView, &results]
+		{
+			{
+				std::scoped_lock lock(results->mutex);
+				results->finished = true;
+			}
+
+			PostMessage(listView, WM_APP_ENUMERATION_BATCH_READY, results->folderId, 0);
+		});
+
+	auto contents = GetEnumerationContents(showHidden);
+
+	if (enumerationTicket)
+	{
+		auto cachedItems = folderEnumerationService->GetCachedItems(*enumerationTicket, contents);
+
+		if (cachedItems)
+		{
+			AddCachedItemsAsync(listView, pidlDirectory, *cachedItems, contents, results);
+			return;
+		}
+	}
+
+	// If the folder can't be bound to or enumerated, there's nothing that can be done at this
+	// point (since the navigation has already been committed). The folder will simply be shown as
+	// empty.
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	ShellEnumerator::Flags flags = ShellEnumerator::Flags::Standard;
+
+	if (showHidden)
+	{
+		WI_SetFlag(flags, ShellEnumerator::Flags::IncludeHidden);
+	}
+
+	// The details retrieved for each item are also kept, so that they can be added to the cache
+	// once the enumeration has finished.
+	std::optional<FolderEnumerationService::ItemList> itemsToCache;
+
+	if (enumerationTicket && enumerationTicket->cacheable)
+	{
+		itemsToCache.emplace();
+	}
+
+	ShellEnumerator enumerator;
+	hr = enumerator.EnumerateDirectoryInBatches(shellFolder.get(), owner, flags,
+		ENUMERATION_BATCH_SIZE,
+		[listView, pidlDirectory, &shellFolder, &itemsToCache, &results](
+			std::vector<PidlChild> &&pidls)
+		{
+			std::vector<NewItemInfo_t> items;
+			items.reserve(pidls.size());
+
+			for (const auto &pidl : pidls)
+			{
+				if (results->cancelled)
+				{
+					return false;
+				}
+
+				auto itemDetails = GetItemDetails(shellFolder.get(), pidlDirectory, pidl.Raw());
+
+				if (!itemDetails)
+				{
+					continue;
+				}
+
+				items.push_back(GetItemInformation(pidlDirectory, *itemDetails));
+
+				if (itemsToCache)
+				{
+					itemsToCache->push_back(std::move(*itemDetails));
+				}
+			}
+
+			PrewarmTypeNames(items);
+
+			{
+				std::scoped_lock lock(results->mutex);
+				results->batches.push_back(std::move(items));
+			}
+
+			PostMessage(listView, WM_APP_ENUMERATION_BATCH_READY, results->folderId, 0);
+
+			return !results->cancelled;
+		});
+
+	if (SUCCEEDED(hr) && itemsToCache && !results->cancelled)
+	{
+		folderEnumerationService->CacheItems(*enumerationTicket, contents,
+			std::move(*itemsToCache));
+	}
+}
+
+HRESULT ShellBrowserImpl::CacheFolderItems(PCIDLIST_ABSOLUTE pidlDirectory, bool showHidden,
+	FolderEnumerationService *folderEnumerationService,
+	const FolderEnumerationService::EnumerationTicket &enumerationTicket, size_t maxItems,
+	const std::function<bool()> &shouldContinue)
 {
+	if (!enumerationTicket.cacheable)
+	{
+		return E_FAIL;
+	}
+
 	wil::com_ptr_nothrow<IShellFolder> shellFolder;
 	RETURN_IF_FAILED(BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder)));
 
@@ -176,21 +360,179 @@ HRESULT ShellBrowserImpl::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, HWND
 		WI_SetFlag(flags, ShellEnumerator::Flags::IncludeHidden);
 	}
 
+	FolderEnumerationService::ItemList itemsToCache;
+	bool stopped = false;
+
+	// No window is passed to the enumerator, since nothing is being shown and no UI should be
+	// displayed as a result of the enumeration.
 	ShellEnumerator enumerator;
-	std::vector<PidlChild> outputPidls;
-	RETURN_IF_FAILED(enumerator.EnumerateDirectory(shellFolder.get(), owner, flags, outputPidls));
+	RETURN_IF_FAILED(enumerator.EnumerateDirectoryInBatches(shellFolder.get(), nullptr, flags,
+		ENUMERATION_BATCH_SIZE,
+		[pidlDirectory, maxItems, &shouldContinue, &shellFolder, &itemsToCache, &stopped](
+			std::vector<PidlChild> &&pidls)
+		{
+			for (const auto &pidl : pidls)
+			{
+				if (itemsToCache.size() == maxItems || !shouldContinue())
+				{
+					stopped = true;
+					return false;
+				}
+
+				auto itemDetails = GetItemDetails(shellFolder.get(), pidlDirectory, pidl.Raw());
+
+				if (itemDetails)
+				{
+					itemsToCache.push_back(std::move(*itemDetails));
+				}
+			}
+
+			return true;
+		}));
 
-	for (const auto &pidl : outputPidls)
+	if (stopped)
 	{
-		auto item = GetItemInformation(shellFolder.get(), pidlDirectory, pidl.Raw());
+		return E_ABORT;
+	}
+
+	folderEnumerationService->CacheItems(enumerationTicket, GetEnumerationContents(showHidden),
+		std::move(itemsToCache));
+
+	return S_OK;
+}
+
+// These are the contents that are retrieved when navigating to a folder.
+FolderEnumerationService::Contents ShellBrowserImpl::GetEnumerationContents(bool showHidden)
+{
+	auto contents = FolderEnumerationService::Contents::Folders
+		| FolderEnumerationService::Contents::NonFolders
+		| FolderEnumerationService::Contents::Details;
+
+	if (showHidden)
+	{
+		WI_SetFlag(contents, FolderEnumerationService::Contents::IncludeHidden);
+	}
+
+	return contents;
+}
+
+// Runs on a background thread. The cached items are passed back in batches, exactly as they would
+// be if the folder was being enumerated, so that the rest of the navigation proceeds in the same
+// way.
+void ShellBrowserImpl::AddCachedItemsAsync(HWND listView, PCIDLIST_ABSOLUTE pidlDirectory,
+	const FolderEnumerationService::ItemList &cachedItems,
+	FolderEnumerationService::Contents contents, std::shared_ptr<EnumerationResults> results)
+{
+	std::vector<NewItemInfo_t> items;
+
+	auto postBatch = [listView, &items, &results]()
+	{
+		PrewarmTypeNames(items);
 
-		if (item)
 		{
-			items.push_back(std::move(*item));
+			std::scoped_lock lock(results->mutex);
+			results->batches.push_back(std::move(items));
+		}
+
+		PostMessage(listView, WM_APP_ENUMERATION_BATCH_READY, results->folderId, 0);
+
+		items.clear();
+	};
+
+	for (const auto &cachedItem : cachedItems)
+	{
+		if (results->cancelled)
+		{
+			return;
+		}
+
+		if (!FolderEnumerationCache::IsIncluded(cachedItem, contents))
+		{
+			continue;
+		}
+
+		items.push_back(GetItemInformation(pidlDirectory, cachedItem));
+
+		if (items.size() == ENUMERATION_BATCH_SIZE)
+		{
+			postBatch();
 		}
 	}
 
-	return S_OK;
+	if (!items.empty())
+	{
+		postBatch();
+	}
+}
+
+// Runs on a background thread. Retrieving the type names here means that, whether the type column
+// is shown, or the items are sorted or grouped by type, the type names will already be available
+// when they're needed on the UI thread. Since type names are shared between items, there will
+// only be a small number of names to retrieve for most folders.
+void ShellBrowserImpl::PrewarmTypeNames(const std::vector<NewItemInfo_t> &items)
+{
+	std::vector<FileTypeNameCache::Item> typeNameItems;
+	typeNameItems.reserve(items.size());
+
+	for (const auto &item : items)
+	{
+		typeNameItems.push_back(
+			{ item.itemInfo.pidlComplete.get(), item.isFindDataValid ? &item.wfd : nullptr });
+	}
+
+	FileTypeNameCache::GetInstance().Prewarm(typeNameItems);
+}
+
+void ShellBrowserImpl::ProcessEnumerationBatches(int folderId)
+{
+	if (!m_enumerationResults || m_enumerationResults->folderId != folderId)
+	{
+		// These results are from a previous enumeration and can be ignored.
+		return;
+	}
+
+	std::vector<std::vector<NewItemInfo_t>> batches;
+	bool finished;
+
+	{
+		std::scoped_lock lock(m_enumerationResults->mutex);
+		batches = std::move(m_enumerationResults->batches);
+		m_enumerationResults->batches.clear();
+		finished = m_enumerationResults->finished;
+	}
+
+	for (auto &batch : batches)
+	{
+		OnEnumerationBatchReceived(std::move(batch));
+	}
+
+	if (finished)
+	{
+		auto navigateParams = *m_enumerationNavigateParams;
+
+		m_enumerationResults.reset();
+		m_enumerationNavigateParams.reset();
+
+		OnEnumerationCompleted(navigateParams);
+	}
+}
+
+void ShellBrowserImpl::OnEnumerationBatchReceived(std::vector<NewItemInfo_t> &&items)
+{
+	for (auto &item : items)
+	{
+		AddItemInternal(-1, std::move(item), FALSE);
+	}
+
+	/* Stop the list view from redrawing itself each time is inserted.
+	Redrawing will be allowed once all items have being inserted.
+	(reduces lag when a large number of items are going to be inserted). */
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	InsertAwaitingItems();
+
+	/* Allow the listview to redraw itself once again. */
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 }
 
 void ShellBrowserImpl::NotifyShellOfNavigation(PCIDLIST_ABSOLUTE pidl)
@@ -337,10 +679,17 @@ std::optional<int> ShellBrowserImpl::AddItemInternal(IShellFolder *shellFolder,
 	return AddItemInternal(itemIndex, std::move(*itemInfo), setPosition);
 }
 
-int ShellBrowserImpl::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition)
+int ShellBrowserImpl::AddItemInternal(int itemIndex, NewItemInfo_t newItemInfo, BOOL setPosition)
 {
 	int itemId = GenerateUniqueItemId();
-	m_itemInfoMap.insert({ itemId, std::move(itemInfo) });
+
+	// Item IDs are allocated sequentially from 0 for each folder, which is the same scheme the
+	// item store uses, so the ID can be used to directly index into the store.
+	auto storeIndex = m_itemStore.Add(GetItemStoreDetails(newItemInfo));
+	DCHECK_EQ(storeIndex, static_cast<ItemStore::Index>(itemId));
+
+	m_itemInfoMap.insert({ itemId, std::move(newItemInfo.itemInfo) });
+	AddItemToLookupIndex(itemId);
 
 	AwaitingAdd_t awaitingAdd;
 
@@ -363,27 +712,35 @@ int ShellBrowserImpl::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL s
 	return itemId;
 }
 
-std::optional<ShellBrowserImpl::ItemInfo_t> ShellBrowserImpl::GetItemInformation(
+std::optional<ShellBrowserImpl::NewItemInfo_t> ShellBrowserImpl::GetItemInformation(
 	IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
 {
-	ItemInfo_t itemInfo;
+	auto itemDetails = GetItemDetails(shellFolder, pidlDirectory, pidlChild);
 
-	unique_pidl_absolute pidlItem(ILCombine(pidlDirectory, pidlChild));
+	if (!itemDetails)
+	{
+		return std::nullopt;
+	}
 
-	itemInfo.pidlComplete.reset(ILCloneFull(pidlItem.get()));
-	itemInfo.pridl.reset(ILCloneChild(pidlChild));
+	return GetItemInformation(pidlDirectory, *itemDetails);
+}
 
-	std::wstring parsingName;
-	HRESULT hr = GetDisplayName(shellFolder, pidlChild, SHGDN_FORPARSING, parsingName);
+// Retrieves everything about the item that requires a call into the shell. The details returned
+// here are what's stored in the enumeration cache.
+std::optional<FolderEnumerationCache::Item> ShellBrowserImpl::GetItemDetails(
+	IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
+{
+	FolderEnumerationCache::Item item;
+	item.pidl = pidlChild;
+
+	HRESULT hr = GetDisplayName(shellFolder, pidlChild, SHGDN_FORPARSING, item.parsingName);
 
 	if (FAILED(hr))
 	{
 		return std::nullopt;
 	}
 
-	itemInfo.parsingName = parsingName;
-
-	ULONG attributes = SFGAO_FOLDER | SFGAO_FILESYSTEM;
+	ULONG attributes = SFGAO_FOLDER | SFGAO_FILESYSTEM | SFGAO_HIDDEN | SFGAO_SYSTEM;
 	PCITEMID_CHILD items[] = { pidlChild };
 	hr = shellFolder->GetAttributesOf(1, items, &attributes);
 
@@ -392,6 +749,8 @@ std::optional<ShellBrowserImpl::ItemInfo_t> ShellBrowserImpl::GetItemInformation
 		return std::nullopt;
 	}
 
+	item.attributes = attributes;
+
 	SHGDNF displayNameFlags = SHGDN_INFOLDER;
 
 	unique_pidl_absolute recycleBinPidl;
@@ -412,61 +771,97 @@ std::optional<ShellBrowserImpl::ItemInfo_t> ShellBrowserImpl::GetItemInformation
 		WI_SetFlag(displayNameFlags, SHGDN_FORPARSING);
 	}
 
-	std::wstring displayName;
-	hr = GetDisplayName(shellFolder, pidlChild, displayNameFlags, displayName);
+	hr = GetDisplayName(shellFolder, pidlChild, displayNameFlags, item.displayName);
 
 	if (FAILED(hr))
 	{
 		return std::nullopt;
 	}
 
-	itemInfo.displayName = displayName;
-
-	std::wstring editingName;
-	hr = GetDisplayName(shellFolder, pidlChild, SHGDN_INFOLDER | SHGDN_FOREDITING, editingName);
+	hr = GetDisplayName(shellFolder, pidlChild, SHGDN_INFOLDER | SHGDN_FOREDITING,
+		item.editingName);
 
 	if (FAILED(hr))
 	{
 		return std::nullopt;
 	}
 
-	itemInfo.editingName = editingName;
+	WIN32_FIND_DATA wfd;
+	hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
 
-	if (PathIsRoot(parsingName.c_str()))
+	if (FAILED(hr))
 	{
-		itemInfo.bDrive = TRUE;
-		StringCchCopy(itemInfo.szDrive, SIZEOF_ARRAY(itemInfo.szDrive), parsingName.c_str());
+		hr = ExtractFindDataUsingPropertyStore(shellFolder, pidlChild, wfd);
 	}
-	else
+
+	if (SUCCEEDED(hr))
 	{
-		itemInfo.bDrive = FALSE;
+		item.findData = wfd;
 	}
 
-	WIN32_FIND_DATA wfd;
-	hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
+	return item;
+}
 
-	if (FAILED(hr))
+// Builds the full set of information for an item from its details. This doesn't call into the
+// shell, so is cheap enough to be used for every item in a cached folder.
+ShellBrowserImpl::NewItemInfo_t ShellBrowserImpl::GetItemInformation(
+	PCIDLIST_ABSOLUTE pidlDirectory, const FolderEnumerationCache::Item &item)
+{
+	NewItemInfo_t newItemInfo;
+	newItemInfo.displayName = item.displayName;
+
+	auto &itemInfo = newItemInfo.itemInfo;
+	itemInfo.pidlComplete.reset(ILCombine(pidlDirectory, item.pidl.Raw()));
+	itemInfo.pridl.reset(ILCloneChild(item.pidl.Raw()));
+	itemInfo.parsingName = item.parsingName;
+	itemInfo.editingName = item.editingName;
+
+	if (PathIsRoot(item.parsingName.c_str()))
 	{
-		hr = ExtractFindDataUsingPropertyStore(shellFolder, pidlChild, wfd);
+		itemInfo.bDrive = TRUE;
+		StringCchCopy(itemInfo.szDrive, SIZEOF_ARRAY(itemInfo.szDrive), item.parsingName.c_str());
+	}
+	else
+	{
+		itemInfo.bDrive = FALSE;
 	}
 
-	if (SUCCEEDED(hr))
+	if (item.findData)
 	{
-		itemInfo.wfd = wfd;
-		itemInfo.isFindDataValid = true;
+		newItemInfo.wfd = *item.findData;
+		newItemInfo.isFindDataValid = true;
 	}
 	else
 	{
-		StringCchCopy(itemInfo.wfd.cFileName, SIZEOF_ARRAY(itemInfo.wfd.cFileName),
-			displayName.c_str());
+		StringCchCopy(newItemInfo.wfd.cFileName, SIZEOF_ARRAY(newItemInfo.wfd.cFileName),
+			item.displayName.c_str());
 
-		if (WI_IsFlagSet(attributes, SFGAO_FOLDER))
+		if (WI_IsFlagSet(item.attributes, SFGAO_FOLDER))
 		{
-			WI_SetFlag(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+			WI_SetFlag(newItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
 		}
 	}
 
-	return std::move(itemInfo);
+	return newItemInfo;
+}
+
+ItemStore::ItemDetails ShellBrowserImpl::GetItemStoreDetails(const NewItemInfo_t &newItemInfo)
+{
+	const auto &wfd = newItemInfo.wfd;
+
+	ItemStore::ItemDetails details;
+	details.name = newItemInfo.displayName;
+	details.fileName = wfd.cFileName;
+	details.isFindDataValid = newItemInfo.isFindDataValid;
+	details.size = ULARGE_INTEGER{ { wfd.nFileSizeLow, wfd.nFileSizeHigh } }.QuadPart;
+	details.dateCreated = ULARGE_INTEGER{ { wfd.ftCreationTime.dwLowDateTime,
+		wfd.ftCreationTime.dwHighDateTime } }.QuadPart;
+	details.dateModified = ULARGE_INTEGER{ { wfd.ftLastWriteTime.dwLowDateTime,
+		wfd.ftLastWriteTime.dwHighDateTime } }.QuadPart;
+	details.dateAccessed = ULARGE_INTEGER{ { wfd.ftLastAccessTime.dwLowDateTime,
+		wfd.ftLastAccessTime.dwHighDateTime } }.QuadPart;
+	details.attributes = wfd.dwFileAttributes;
+	return details;
 }
 
 HRESULT ShellBrowserImpl::ExtractFindDataUsingPropertyStore(IShellFolder *shellFolder,
@@ -516,20 +911,12 @@ HRESULT ShellBrowserImpl::ExtractFindDataUsingPropertyStore(IShellFolder *shellF
 	return hr;
 }
 
-void ShellBrowserImpl::OnEnumerationCompleted(std::vector<ShellBrowserImpl::ItemInfo_t> &&items,
-	const NavigateParams &navigateParams)
+void ShellBrowserImpl::OnEnumerationCompleted(const NavigateParams &navigateParams)
 {
-	for (auto &item : items)
-	{
-		AddItemInternal(-1, std::move(item), FALSE);
-	}
-
-	/* Stop the list view from redrawing itself each time is inserted.
-	Redrawing will be allowed once all items have being inserted.
-	(reduces lag when a large number of items are going to be inserted). */
+	// Items are inserted in the order they're retrieved while the enumeration is in progress, so
+	// they only need to be sorted once all the items have been added.
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
-	InsertAwaitingItems();
 	SortFolder();
 
 	ListView_EnsureVisible(m_hListView, 0, FALSE);
@@ -540,6 +927,10 @@ void ShellBrowserImpl::OnEnumerationCompleted(std::vector<ShellBrowserImpl::Item
 	/* Set the focus back to the first item. */
 	ListView_SetItemState(m_hListView, 0, LVIS_FOCUSED, LVIS_FOCUSED);
 
+	// Any directory change notifications received while the enumeration was in progress will have
+	// been queued and can now be applied.
+	DirectoryAltered();
+
 	// A history entry should be created when the navigation is committed, so there should always be
 	// a current entry here, and that entry should be for the current navigation.
 	auto currentEntry = m_navigationController->GetCurrentEntry();
@@ -561,13 +952,17 @@ void ShellBrowserImpl::OnEnumerationCompleted(std::vector<ShellBrowserImpl::Item
 		StartDirectoryMonitoring(m_directoryState.pidlDirectory.get());
 	}
 
-	m_bFolderVisited = TRUE;
-
 	m_navigationCompletedSignal(navigateParams);
 }
 
 void ShellBrowserImpl::InsertAwaitingItems()
 {
+	if (m_ownerData)
+	{
+		InsertAwaitingItemsOwnerData();
+		return;
+	}
+
 	int nPrevItems = ListView_GetItemCount(m_hListView);
 
 	if (nPrevItems == 0 && m_directoryState.awaitingAddList.empty())
@@ -592,14 +987,14 @@ void ShellBrowserImpl::InsertAwaitingItems()
 
 	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
 	{
-		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
-
-		if (IsFileFiltered(itemInfo))
+		if (IsFileFiltered(awaitingItem.iItemInternal))
 		{
 			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
 			continue;
 		}
 
+		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
+
 		BasicItemInfo_t basicItemInfo = getBasicItemInfo(awaitingItem.iItemInternal);
 		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 
@@ -636,6 +1031,7 @@ void ShellBrowserImpl::InsertAwaitingItems()
 
 		/* Insert the item into the list view control. */
 		int iItemIndex = ListView_InsertItem(m_hListView, &lv);
+		m_itemPositionHints[awaitingItem.iItemInternal] = iItemIndex;
 
 		if (awaitingItem.bPosition && m_folderSettings.viewMode != +ViewMode::Details)
 		{
@@ -688,7 +1084,7 @@ void ShellBrowserImpl::InsertAwaitingItems()
 		}
 
 		/* If the file is marked as hidden, ghost it out. */
-		if (itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)
+		if (m_itemStore.GetAttributes(awaitingItem.iItemInternal) & FILE_ATTRIBUTE_HIDDEN)
 		{
 			ListView_SetItemState(m_hListView, iItemIndex, LVIS_CUT, LVIS_CUT);
 		}
@@ -696,11 +1092,7 @@ void ShellBrowserImpl::InsertAwaitingItems()
 		/* Add the current file's size to the running size of the current directory. */
 		/* A folder may or may not have 0 in its high file size member.
 		It should either be zeroed, or never counted. */
-		ULARGE_INTEGER ulFileSize;
-		ulFileSize.LowPart = itemInfo.wfd.nFileSizeLow;
-		ulFileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
-
-		m_directoryState.totalDirSize += ulFileSize.QuadPart;
+		m_directoryState.totalDirSize += m_itemStore.GetSize(awaitingItem.iItemInternal);
 
 		nAdded++;
 	}
@@ -721,21 +1113,21 @@ void ShellBrowserImpl::InsertAwaitingItems()
 	}
 }
 
-BOOL ShellBrowserImpl::IsFileFiltered(const ItemInfo_t &itemInfo) const
+BOOL ShellBrowserImpl::IsFileFiltered(int internalIndex) const
 {
 	BOOL bHideSystemFile = FALSE;
 	BOOL bFilenameFiltered = FALSE;
+	DWORD attributes = m_itemStore.GetAttributes(internalIndex);
 
 	if (m_folderSettings.applyFilter
-		&& ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
+		&& ((attributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
 	{
-		bFilenameFiltered = IsFilenameFiltered(itemInfo.displayName.c_str());
+		bFilenameFiltered = IsFilenameFiltered(m_itemStore.GetName(internalIndex).data());
 	}
 
 	if (m_config->globalFolderSettings.hideSystemFiles)
 	{
-		bHideSystemFile =
-			(itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
+		bHideSystemFile = (attributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
 	}
 
 	return bFilenameFiltered || bHideSystemFile;
@@ -743,9 +1135,6 @@ BOOL ShellBrowserImpl::IsFileFiltered(const ItemInfo_t &itemInfo) const
 
 void ShellBrowserImpl::RemoveItem(int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
-	LVFINDINFO lvfi;
-	int iItem;
 	int nItems;
 
 	if (iItemInternal == -1)
@@ -753,26 +1142,21 @@ void ShellBrowserImpl::RemoveItem(int iItemInternal)
 		return;
 	}
 
-	/* Take the file size of the removed file away from the total
-	directory size. */
-	ulFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
-
-	m_directoryState.totalDirSize -= ulFileSize.QuadPart;
-
 	/* Locate the item within the listview.
 	Could use filename, providing removed
 	items are always deleted before new
 	items are inserted. */
-	lvfi.flags = LVFI_PARAM;
-	lvfi.lParam = iItemInternal;
-	iItem = ListView_FindItem(m_hListView, -1, &lvfi);
+	auto iItem = LocateItemByInternalIndex(iItemInternal);
 
-	if (iItem != -1)
+	if (iItem && m_ownerData)
+	{
+		DeleteOwnerDataItem(*iItem);
+	}
+	else if (iItem)
 	{
 		if (m_folderSettings.showInGroups)
 		{
-			auto groupId = GetItemGroupId(iItem);
+			auto groupId = GetItemGroupId(*iItem);
 
 			if (groupId)
 			{
@@ -781,13 +1165,84 @@ void ShellBrowserImpl::RemoveItem(int iItemInternal)
 		}
 
 		/* Remove the item from the listview. */
-		ListView_DeleteItem(m_hListView, iItem);
+		ListView_DeleteItem(m_hListView, *iItem);
 	}
 
-	m_directoryState.filteredItemsList.erase(iItemInternal);
-	m_itemInfoMap.erase(iItemInternal);
+	RemoveItemDetails(iItemInternal);
 
 	nItems = ListView_GetItemCount(m_hListView);
+}
+
+void ShellBrowserImpl::RemoveItems(const std::vector<int> &internalIndexes)
+{
+	if (internalIndexes.empty())
+	{
+		return;
+	}
+
+	if (m_ownerData)
+	{
+		RemoveOwnerDataItems(internalIndexes);
+		return;
+	}
+
+	if (internalIndexes.size() == 1)
+	{
+		RemoveItem(internalIndexes[0]);
+		return;
+	}
+
+	// Deleting an item shifts every item after it, which invalidates their position hints. Locating
+	// each item individually could then require a search of the listview for every item.
+	// Instead, the positions of all the items are found in a single pass and the items are deleted
+	// from the highest position down, so that the positions still to be deleted don't change.
+	std::unordered_set<int> itemsToRemove(internalIndexes.begin(), internalIndexes.end());
+	std::vector<int> positions;
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	for (int i = 0; i < numItems && positions.size() < itemsToRemove.size(); i++)
+	{
+		if (itemsToRemove.contains(GetItemInternalIndex(i)))
+		{
+			positions.push_back(i);
+		}
+	}
+
+	for (auto itr = positions.rbegin(); itr != positions.rend(); ++itr)
+	{
+		if (m_folderSettings.showInGroups)
+		{
+			auto groupId = GetItemGroupId(*itr);
+
+			if (groupId)
+			{
+				OnItemRemovedFromGroup(*groupId);
+			}
+		}
+
+		ListView_DeleteItem(m_hListView, *itr);
+	}
+
+	// Filtered items aren't in the listview, but still have details stored.
+	for (int internalIndex : itemsToRemove)
+	{
+		RemoveItemDetails(internalIndex);
+	}
+}
+
+// Removes the stored details for an item that's no longer shown in the listview.
+void ShellBrowserImpl::RemoveItemDetails(int internalIndex)
+{
+	/* Take the file size of the removed file away from the total
+	directory size. */
+	m_directoryState.totalDirSize -= m_itemStore.GetSize(internalIndex);
+
+	m_itemStore.Remove(internalIndex);
+	m_directoryState.filteredItemsList.erase(internalIndex);
+	m_itemInfoMap.erase(internalIndex);
+	m_itemLookupIndex.RemoveItem(internalIndex);
+	m_itemPositionHints.erase(internalIndex);
+	m_columnTextGenerations.erase(internalIndex);
 
 	m_directoryState.numItems--;
 }
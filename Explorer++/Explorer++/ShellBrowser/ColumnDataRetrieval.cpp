@@ -6,10 +6,12 @@
 #include "ColumnDataRetrieval.h"
 #include "Columns.h"
 #include "FolderSettings.h"
+#include "FolderSizeService.h"
 #include "ItemData.h"
 #include "../Helper/DriveInfo.h"
+#include "../Helper/FileMetadata.h"
 #include "../Helper/FileOperations.h"
-#include "../Helper/FolderSize.h"
+#include "../Helper/FileTypeNameCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/StringHelper.h"
@@ -21,9 +23,150 @@
 
 BOOL GetPrinterStatusDescription(DWORD dwStatus, TCHAR *szStatus, size_t cchMax);
 
+namespace
+{
+
+std::wstring GetVersionInfoName(VersionInfoType versionInfoType)
+{
+	switch (versionInfoType)
+	{
+	case VersionInfoType::ProductName:
+		return L"ProductName";
+
+	case VersionInfoType::Company:
+		return L"CompanyName";
+
+	case VersionInfoType::Description:
+		return L"FileDescription";
+
+	case VersionInfoType::FileVersion:
+		return L"FileVersion";
+
+	case VersionInfoType::ProductVersion:
+		return L"ProductVersion";
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return EMPTY_STRING;
+}
+
+std::optional<std::wstring> FormatMediaAttribute(MediaMetadataType mediaMetadataType,
+	const MediaAttribute &attribute)
+{
+	TCHAR szOutput[512];
+
+	switch (mediaMetadataType)
+	{
+	case MediaMetadataType::Bitrate:
+	{
+		if (attribute.value.size() < sizeof(DWORD))
+		{
+			return std::nullopt;
+		}
+
+		DWORD bitRate = *(reinterpret_cast<const DWORD *>(attribute.value.data()));
+
+		if (bitRate > 1000)
+		{
+			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d kbps"), bitRate / 1000);
+		}
+		else
+		{
+			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d bps"), bitRate);
+		}
+	}
+	break;
+
+	case MediaMetadataType::Duration:
+	{
+		if (attribute.value.size() < sizeof(QWORD))
+		{
+			return std::nullopt;
+		}
+
+		auto *facet = new boost::posix_time::wtime_facet();
+		facet->time_duration_format(L"%H:%M:%S");
+
+		std::wstringstream dateStream;
+		dateStream.imbue(std::locale(dateStream.getloc(), facet));
+
+		/* Note that the duration itself is in 100-nanosecond units
+		(see http://msdn.microsoft.com/en-us/library/windows/desktop/dd798053(v=vs.85).aspx). */
+		boost::posix_time::time_duration duration = boost::posix_time::microseconds(
+			*(reinterpret_cast<const QWORD *>(attribute.value.data())) / 10);
+		dateStream << duration;
+
+		StringCchCopy(szOutput, std::size(szOutput), dateStream.str().c_str());
+	}
+	break;
+
+	case MediaMetadataType::Protected:
+		if (attribute.value.size() < sizeof(BOOL))
+		{
+			return std::nullopt;
+		}
+
+		if (*(reinterpret_cast<const BOOL *>(attribute.value.data())))
+		{
+			StringCchCopy(szOutput, std::size(szOutput), L"Yes");
+		}
+		else
+		{
+			StringCchCopy(szOutput, std::size(szOutput), L"No");
+		}
+		break;
+
+	case MediaMetadataType::Copyright:
+	case MediaMetadataType::Rating:
+	case MediaMetadataType::AlbumArtist:
+	case MediaMetadataType::AlbumTitle:
+	case MediaMetadataType::BeatsPerMinute:
+	case MediaMetadataType::Composer:
+	case MediaMetadataType::Conductor:
+	case MediaMetadataType::Director:
+	case MediaMetadataType::Genre:
+	case MediaMetadataType::Language:
+	case MediaMetadataType::BroadcastDate:
+	case MediaMetadataType::Channel:
+	case MediaMetadataType::StationName:
+	case MediaMetadataType::Mood:
+	case MediaMetadataType::ParentalRating:
+	case MediaMetadataType::ParentalRatingReason:
+	case MediaMetadataType::Period:
+	case MediaMetadataType::Producer:
+	case MediaMetadataType::Publisher:
+	case MediaMetadataType::Writer:
+	case MediaMetadataType::Year:
+	default:
+		// The value may not be null-terminated if the file is malformed, so the length is
+		// explicitly limited.
+		StringCchCopyN(szOutput, std::size(szOutput),
+			reinterpret_cast<const TCHAR *>(attribute.value.data()),
+			attribute.value.size() / sizeof(TCHAR));
+		break;
+	}
+
+	return szOutput;
+}
+
+}
+
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
 {
+	if (auto versionInfoType = GetColumnVersionInfoType(columnType))
+	{
+		return GetVersionColumnText(basicItemInfo, *versionInfoType);
+	}
+
+	if (auto mediaMetadataType = GetColumnMediaMetadataType(columnType))
+	{
+		return GetMediaMetadataColumnText(basicItemInfo, *mediaMetadataType);
+	}
+
 	switch (columnType)
 	{
 	case ColumnType::Name:
@@ -32,7 +175,7 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	case ColumnType::Type:
 		return GetTypeColumnText(basicItemInfo);
 	case ColumnType::Size:
-		return GetSizeColumnText(basicItemInfo, globalFolderSettings);
+		return GetSizeColumnText(basicItemInfo, globalFolderSettings, folderSizeService);
 
 	case ColumnType::DateModified:
 		return GetTimeColumnText(basicItemInfo, TimeType::Modified, globalFolderSettings);
@@ -50,17 +193,6 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	case ColumnType::Owner:
 		return GetOwnerColumnText(basicItemInfo);
 
-	case ColumnType::ProductName:
-		return GetVersionColumnText(basicItemInfo, VersionInfoType::ProductName);
-	case ColumnType::Company:
-		return GetVersionColumnText(basicItemInfo, VersionInfoType::Company);
-	case ColumnType::Description:
-		return GetVersionColumnText(basicItemInfo, VersionInfoType::Description);
-	case ColumnType::FileVersion:
-		return GetVersionColumnText(basicItemInfo, VersionInfoType::FileVersion);
-	case ColumnType::ProductVersion:
-		return GetVersionColumnText(basicItemInfo, VersionInfoType::ProductVersion);
-
 	case ColumnType::ShortcutTo:
 		return GetShortcutToColumnText(basicItemInfo);
 	case ColumnType::HardLinks:
@@ -125,55 +257,6 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	case ColumnType::NetworkAdaptorStatus:
 		return GetNetworkAdapterColumnText(basicItemInfo);
 
-	case ColumnType::MediaBitrate:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Bitrate);
-	case ColumnType::MediaCopyright:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Copyright);
-	case ColumnType::MediaDuration:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Duration);
-	case ColumnType::MediaProtected:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Protected);
-	case ColumnType::MediaRating:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Rating);
-	case ColumnType::MediaAlbumArtist:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::AlbumArtist);
-	case ColumnType::MediaAlbum:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::AlbumTitle);
-	case ColumnType::MediaBeatsPerMinute:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::BeatsPerMinute);
-	case ColumnType::MediaComposer:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Composer);
-	case ColumnType::MediaConductor:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Conductor);
-	case ColumnType::MediaDirector:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Director);
-	case ColumnType::MediaGenre:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Genre);
-	case ColumnType::MediaLanguage:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Language);
-	case ColumnType::MediaBroadcastDate:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::BroadcastDate);
-	case ColumnType::MediaChannel:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Channel);
-	case ColumnType::MediaStationName:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::StationName);
-	case ColumnType::MediaMood:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Mood);
-	case ColumnType::MediaParentalRating:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::ParentalRating);
-	case ColumnType::MediaParentalRatingReason:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::ParentalRatingReason);
-	case ColumnType::MediaPeriod:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Period);
-	case ColumnType::MediaProducer:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Producer);
-	case ColumnType::MediaPublisher:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Publisher);
-	case ColumnType::MediaWriter:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Writer);
-	case ColumnType::MediaYear:
-		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Year);
-
 	default:
 		assert(false);
 		break;
@@ -234,20 +317,19 @@ std::wstring ProcessItemFileName(const BasicItemInfo_t &itemInfo,
 
 std::wstring GetTypeColumnText(const BasicItemInfo_t &itemInfo)
 {
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPTSTR>(itemInfo.pidlComplete.get()), 0, &shfi,
-		sizeof(shfi), SHGFI_PIDL | SHGFI_TYPENAME);
+	auto typeName = FileTypeNameCache::GetInstance().GetTypeName(
+		{ itemInfo.pidlComplete.get(), itemInfo.isFindDataValid ? &itemInfo.wfd : nullptr });
 
-	if (res == 0)
+	if (!typeName)
 	{
 		return EMPTY_STRING;
 	}
 
-	return shfi.szTypeName;
+	return *typeName;
 }
 
 std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
 {
 	if (!itemInfo.isFindDataValid)
 	{
@@ -270,7 +352,7 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 		if (globalFolderSettings.showFolderSizes
 			&& !(globalFolderSettings.disableFolderSizesNetworkRemovable && bNetworkRemovable))
 		{
-			return GetFolderSizeColumnText(itemInfo, globalFolderSettings);
+			return GetFolderSizeColumnText(itemInfo, globalFolderSettings, folderSizeService);
 		}
 		else
 		{
@@ -284,20 +366,21 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 	return FormatSizeString(fileSize.QuadPart, displayFormat);
 }
 
+// Since this is called in the background, the size can simply be calculated here (if it hasn't
+// already been cached). Sorting by size then uses the cached value.
 std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
 {
-	auto folderInfo = GetFolderInfo(itemInfo.getFullPath());
+	auto folderInfo = folderSizeService->CalculateFolderInfo(itemInfo.getFullPath());
 
-	/* TODO: This should
-	be done some other way.
-	Shouldn't depend on
-	the internal index. */
-	// m_cachedFolderSizes.insert({internalIndex, totalFolderSize.QuadPart});
+	if (!folderInfo)
+	{
+		return EMPTY_STRING;
+	}
 
 	auto displayFormat = globalFolderSettings.forceSize ? globalFolderSettings.sizeDisplayFormat
 														: +SizeDisplayFormat::None;
-	return FormatSizeString(folderInfo.size, displayFormat);
+	return FormatSizeString(folderInfo->size, displayFormat);
 }
 
 std::wstring GetTimeColumnText(const BasicItemInfo_t &itemInfo, TimeType timeType,
@@ -425,7 +508,18 @@ std::wstring GetShortNameColumnText(const BasicItemInfo_t &itemInfo)
 std::wstring GetOwnerColumnText(const BasicItemInfo_t &itemInfo)
 {
 	TCHAR owner[512];
-	BOOL ret = GetFileOwner(itemInfo.getFullPath().c_str(), owner, SIZEOF_ARRAY(owner));
+	BOOL ret;
+
+	if (itemInfo.metadata && itemInfo.metadata->ownerRequested)
+	{
+		const auto &ownerSid = itemInfo.metadata->ownerSid;
+		ret = ownerSid
+			&& FormatUserName(const_cast<BYTE *>(ownerSid->data()), owner, SIZEOF_ARRAY(owner));
+	}
+	else
+	{
+		ret = GetFileOwner(itemInfo.getFullPath().c_str(), owner, SIZEOF_ARRAY(owner));
+	}
 
 	if (!ret)
 	{
@@ -467,8 +561,13 @@ HRESULT GetItemDetails(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
 
 HRESULT GetItemDetailsRawData(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, VARIANT *vt)
 {
-	wil::com_ptr_nothrow<IShellFolder2> pShellFolder;
-	HRESULT hr = SHBindToParent(itemInfo.pidlComplete.get(), IID_PPV_ARGS(&pShellFolder), nullptr);
+	wil::com_ptr_nothrow<IShellFolder2> pShellFolder = itemInfo.parentFolder;
+	HRESULT hr = S_OK;
+
+	if (!pShellFolder)
+	{
+		hr = SHBindToParent(itemInfo.pidlComplete.get(), IID_PPV_ARGS(&pShellFolder), nullptr);
+	}
 
 	if (SUCCEEDED(hr))
 	{
@@ -480,45 +579,30 @@ HRESULT GetItemDetailsRawData(const BasicItemInfo_t &itemInfo, const SHCOLUMNID
 
 std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoType versioninfoType)
 {
-	std::wstring versionInfoName;
+	return GetVersionInfoValue(itemInfo, versioninfoType).value_or(EMPTY_STRING);
+}
 
-	switch (versioninfoType)
+std::optional<std::wstring> GetVersionInfoValue(const BasicItemInfo_t &itemInfo,
+	VersionInfoType versionInfoType)
+{
+	if (itemInfo.metadata)
 	{
-	case VersionInfoType::ProductName:
-		versionInfoName = L"ProductName";
-		break;
+		auto itr = itemInfo.metadata->versionInfo.find(versionInfoType);
 
-	case VersionInfoType::Company:
-		versionInfoName = L"CompanyName";
-		break;
-
-	case VersionInfoType::Description:
-		versionInfoName = L"FileDescription";
-		break;
-
-	case VersionInfoType::FileVersion:
-		versionInfoName = L"FileVersion";
-		break;
-
-	case VersionInfoType::ProductVersion:
-		versionInfoName = L"ProductVersion";
-		break;
-
-	default:
-		assert(false);
-		break;
+		if (itr != itemInfo.metadata->versionInfo.end())
+		{
+			return itr->second;
+		}
 	}
 
-	TCHAR versionInfo[512];
-	BOOL versionInfoObtained = GetVersionInfoString(itemInfo.getFullPath().c_str(),
-		versionInfoName.c_str(), versionInfo, SIZEOF_ARRAY(versionInfo));
+	auto versionInfo = FileVersionInfo::Load(itemInfo.getFullPath());
 
-	if (!versionInfoObtained)
+	if (!versionInfo)
 	{
-		return EMPTY_STRING;
+		return std::nullopt;
 	}
 
-	return versionInfo;
+	return versionInfo->GetString(GetVersionInfoName(versionInfoType));
 }
 
 std::wstring GetShortcutToColumnText(const BasicItemInfo_t &itemInfo)
@@ -813,93 +897,28 @@ std::wstring GetNetworkAdapterColumnText(const BasicItemInfo_t &itemInfo)
 std::wstring GetMediaMetadataColumnText(const BasicItemInfo_t &itemInfo,
 	MediaMetadataType mediaMetadataType)
 {
-	const TCHAR *attributeName = GetMediaMetadataAttributeName(mediaMetadataType);
-
-	BYTE *tempBuffer = nullptr;
-	HRESULT hr = GetMediaMetadata(itemInfo.getFullPath().c_str(), attributeName, &tempBuffer);
-
-	if (!SUCCEEDED(hr))
-	{
-		return EMPTY_STRING;
-	}
-
-	TCHAR szOutput[512];
-
-	switch (mediaMetadataType)
-	{
-	case MediaMetadataType::Bitrate:
+	if (itemInfo.metadata)
 	{
-		DWORD bitRate = *(reinterpret_cast<DWORD *>(tempBuffer));
+		auto itr = itemInfo.metadata->mediaMetadata.find(mediaMetadataType);
 
-		if (bitRate > 1000)
+		if (itr != itemInfo.metadata->mediaMetadata.end())
 		{
-			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d kbps"), bitRate / 1000);
-		}
-		else
-		{
-			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d bps"), bitRate);
+			return itr->second.value_or(EMPTY_STRING);
 		}
 	}
-	break;
 
-	case MediaMetadataType::Duration:
-	{
-		auto *facet = new boost::posix_time::wtime_facet();
-		facet->time_duration_format(L"%H:%M:%S");
-
-		std::wstringstream dateStream;
-		dateStream.imbue(std::locale(dateStream.getloc(), facet));
-
-		/* Note that the duration itself is in 100-nanosecond units
-		(see http://msdn.microsoft.com/en-us/library/windows/desktop/dd798053(v=vs.85).aspx). */
-		boost::posix_time::time_duration duration =
-			boost::posix_time::microseconds(*(reinterpret_cast<QWORD *>(tempBuffer)) / 10);
-		dateStream << duration;
+	const TCHAR *attributeName = GetMediaMetadataAttributeName(mediaMetadataType);
+	auto attributes = MediaMetadataReader::GetInstance().ReadAttributes(itemInfo.getFullPath(),
+		{ attributeName });
 
-		StringCchCopy(szOutput, std::size(szOutput), dateStream.str().c_str());
-	}
-	break;
+	auto itr = attributes.find(attributeName);
 
-	case MediaMetadataType::Protected:
-		if (*(reinterpret_cast<BOOL *>(tempBuffer)))
-		{
-			StringCchCopy(szOutput, std::size(szOutput), L"Yes");
-		}
-		else
-		{
-			StringCchCopy(szOutput, std::size(szOutput), L"No");
-		}
-		break;
-
-	case MediaMetadataType::Copyright:
-	case MediaMetadataType::Rating:
-	case MediaMetadataType::AlbumArtist:
-	case MediaMetadataType::AlbumTitle:
-	case MediaMetadataType::BeatsPerMinute:
-	case MediaMetadataType::Composer:
-	case MediaMetadataType::Conductor:
-	case MediaMetadataType::Director:
-	case MediaMetadataType::Genre:
-	case MediaMetadataType::Language:
-	case MediaMetadataType::BroadcastDate:
-	case MediaMetadataType::Channel:
-	case MediaMetadataType::StationName:
-	case MediaMetadataType::Mood:
-	case MediaMetadataType::ParentalRating:
-	case MediaMetadataType::ParentalRatingReason:
-	case MediaMetadataType::Period:
-	case MediaMetadataType::Producer:
-	case MediaMetadataType::Publisher:
-	case MediaMetadataType::Writer:
-	case MediaMetadataType::Year:
-	default:
-		StringCchCopy(szOutput, std::size(szOutput), reinterpret_cast<TCHAR *>(tempBuffer));
-		break;
+	if (itr == attributes.end())
+	{
+		return EMPTY_STRING;
 	}
 
-	free(tempBuffer);
-
-	return szOutput;
+	return FormatMediaAttribute(mediaMetadataType, itr->second).value_or(EMPTY_STRING);
 }
 
 const TCHAR *GetMediaMetadataAttributeName(MediaMetadataType mediaMetadataType)
@@ -986,6 +1005,158 @@ const TCHAR *GetMediaMetadataAttributeName(MediaMetadataType mediaMetadataType)
 	return nullptr;
 }
 
+ItemMetadata ReadItemMetadata(const BasicItemInfo_t &itemInfo,
+	const std::vector<ColumnType> &columnTypes)
+{
+	std::vector<VersionInfoType> versionInfoTypes;
+	std::vector<MediaMetadataType> mediaMetadataTypes;
+	bool ownerRequested = false;
+
+	for (auto columnType : columnTypes)
+	{
+		if (columnType == ColumnType::Owner)
+		{
+			ownerRequested = true;
+		}
+		else if (auto versionInfoType = GetColumnVersionInfoType(columnType))
+		{
+			versionInfoTypes.push_back(*versionInfoType);
+		}
+		else if (auto mediaMetadataType = GetColumnMediaMetadataType(columnType))
+		{
+			mediaMetadataTypes.push_back(*mediaMetadataType);
+		}
+	}
+
+	ItemMetadata metadata;
+
+	if (versionInfoTypes.empty() && mediaMetadataTypes.empty() && !ownerRequested)
+	{
+		return metadata;
+	}
+
+	std::wstring fullPath = itemInfo.getFullPath();
+
+	if (ownerRequested)
+	{
+		metadata.ownerRequested = true;
+		metadata.ownerSid = GetFileOwnerSid(fullPath.c_str());
+	}
+
+	if (!versionInfoTypes.empty())
+	{
+		auto versionInfo = FileVersionInfo::Load(fullPath);
+
+		for (auto versionInfoType : versionInfoTypes)
+		{
+			metadata.versionInfo[versionInfoType] = versionInfo
+				? versionInfo->GetString(GetVersionInfoName(versionInfoType))
+				: std::nullopt;
+		}
+	}
+
+	if (!mediaMetadataTypes.empty())
+	{
+		std::vector<std::wstring> attributeNames;
+
+		for (auto mediaMetadataType : mediaMetadataTypes)
+		{
+			attributeNames.push_back(GetMediaMetadataAttributeName(mediaMetadataType));
+		}
+
+		auto attributes =
+			MediaMetadataReader::GetInstance().ReadAttributes(fullPath, attributeNames);
+
+		for (auto mediaMetadataType : mediaMetadataTypes)
+		{
+			auto itr = attributes.find(GetMediaMetadataAttributeName(mediaMetadataType));
+			metadata.mediaMetadata[mediaMetadataType] = itr != attributes.end()
+				? FormatMediaAttribute(mediaMetadataType, itr->second)
+				: std::nullopt;
+		}
+	}
+
+	return metadata;
+}
+
+std::optional<VersionInfoType> GetColumnVersionInfoType(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::ProductName:
+		return VersionInfoType::ProductName;
+	case ColumnType::Company:
+		return VersionInfoType::Company;
+	case ColumnType::Description:
+		return VersionInfoType::Description;
+	case ColumnType::FileVersion:
+		return VersionInfoType::FileVersion;
+	case ColumnType::ProductVersion:
+		return VersionInfoType::ProductVersion;
+
+	default:
+		return std::nullopt;
+	}
+}
+
+std::optional<MediaMetadataType> GetColumnMediaMetadataType(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::MediaBitrate:
+		return MediaMetadataType::Bitrate;
+	case ColumnType::MediaCopyright:
+		return MediaMetadataType::Copyright;
+	case ColumnType::MediaDuration:
+		return MediaMetadataType::Duration;
+	case ColumnType::MediaProtected:
+		return MediaMetadataType::Protected;
+	case ColumnType::MediaRating:
+		return MediaMetadataType::Rating;
+	case ColumnType::MediaAlbumArtist:
+		return MediaMetadataType::AlbumArtist;
+	case ColumnType::MediaAlbum:
+		return MediaMetadataType::AlbumTitle;
+	case ColumnType::MediaBeatsPerMinute:
+		return MediaMetadataType::BeatsPerMinute;
+	case ColumnType::MediaComposer:
+		return MediaMetadataType::Composer;
+	case ColumnType::MediaConductor:
+		return MediaMetadataType::Conductor;
+	case ColumnType::MediaDirector:
+		return MediaMetadataType::Director;
+	case ColumnType::MediaGenre:
+		return MediaMetadataType::Genre;
+	case ColumnType::MediaLanguage:
+		return MediaMetadataType::Language;
+	case ColumnType::MediaBroadcastDate:
+		return MediaMetadataType::BroadcastDate;
+	case ColumnType::MediaChannel:
+		return MediaMetadataType::Channel;
+	case ColumnType::MediaStationName:
+		return MediaMetadataType::StationName;
+	case ColumnType::MediaMood:
+		return MediaMetadataType::Mood;
+	case ColumnType::MediaParentalRating:
+		return MediaMetadataType::ParentalRating;
+	case ColumnType::MediaParentalRatingReason:
+		return MediaMetadataType::ParentalRatingReason;
+	case ColumnType::MediaPeriod:
+		return MediaMetadataType::Period;
+	case ColumnType::MediaProducer:
+		return MediaMetadataType::Producer;
+	case ColumnType::MediaPublisher:
+		return MediaMetadataType::Publisher;
+	case ColumnType::MediaWriter:
+		return MediaMetadataType::Writer;
+	case ColumnType::MediaYear:
+		return MediaMetadataType::Year;
+
+	default:
+		return std::nullopt;
+	}
+}
+
 std::wstring GetDriveSpaceColumnText(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	const GlobalFolderSettings &globalFolderSettings)
 {
@@ -5,9 +5,13 @@
 #pragma once
 
 #include "Columns.h"
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 struct BasicItemInfo_t;
+class FolderSizeService;
 struct GlobalFolderSettings;
 
 enum class TimeType
@@ -63,8 +67,23 @@ enum class MediaMetadataType
 	Year
 };
 
+// The version, media and owner metadata for an item. Reading any of these values requires the file
+// to be opened, so when several of the corresponding columns are shown, all the values are read at
+// once and then shared between the columns.
+struct ItemMetadata
+{
+	// Values that were requested, but couldn't be read, are stored as empty.
+	std::unordered_map<VersionInfoType, std::optional<std::wstring>> versionInfo;
+	std::unordered_map<MediaMetadataType, std::optional<std::wstring>> mediaMetadata;
+
+	// The owner is stored as a SID, so that the account names for a set of items can be looked up
+	// together, once the SIDs for all the items have been read.
+	bool ownerRequested = false;
+	std::optional<std::vector<BYTE>> ownerSid;
+};
+
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings);
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService);
 std::wstring GetNameColumnText(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
 std::wstring ProcessItemFileName(const BasicItemInfo_t &itemInfo,
@@ -85,6 +104,8 @@ HRESULT GetItemDetails(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
 HRESULT GetItemDetailsRawData(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
 	VARIANT *vt);
 std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoType versioninfoType);
+std::optional<std::wstring> GetVersionInfoValue(const BasicItemInfo_t &itemInfo,
+	VersionInfoType versionInfoType);
 std::wstring GetShortcutToColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetHardLinksColumnText(const BasicItemInfo_t &itemInfo);
 DWORD GetHardLinksColumnRawData(const BasicItemInfo_t &itemInfo);
@@ -98,11 +119,15 @@ std::wstring GetNetworkAdapterColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetMediaMetadataColumnText(const BasicItemInfo_t &itemInfo,
 	MediaMetadataType mediaMetadataType);
 const TCHAR *GetMediaMetadataAttributeName(MediaMetadataType mediaMetadataType);
+ItemMetadata ReadItemMetadata(const BasicItemInfo_t &itemInfo,
+	const std::vector<ColumnType> &columnTypes);
+std::optional<VersionInfoType> GetColumnVersionInfoType(ColumnType columnType);
+std::optional<MediaMetadataType> GetColumnMediaMetadataType(ColumnType columnType);
 std::wstring GetDriveSpaceColumnText(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	const GlobalFolderSettings &globalFolderSettings);
 BOOL GetDriveSpaceColumnRawData(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	ULARGE_INTEGER &DriveSpace);
 std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings);
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService);
 std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings);
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService);
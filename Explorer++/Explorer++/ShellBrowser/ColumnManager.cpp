@@ -12,50 +12,225 @@
 #include "ResourceHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/AccountNameCache.h"
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <list>
 
 void ShellBrowserImpl::QueueColumnTask(int itemInternalIndex, ColumnType columnType)
 {
-	int columnResultID = m_columnResultIDCounter++;
+	auto [itr, inserted] =
+		m_pendingColumnText.insert(GetColumnTextKey(itemInternalIndex, columnType));
+
+	if (!inserted)
+	{
+		// This column has already been requested for this item.
+		return;
+	}
+
+	m_pendingColumnRequests.emplace_back(itemInternalIndex, columnType);
+
+	// The listview requests text one item and column at a time, as it paints. Rather than starting
+	// a separate task for each request, the requests are collected and queued once the current
+	// paint has finished.
+	if (!m_columnRequestsQueuePending)
+	{
+		PostMessage(m_hListView, WM_APP_COLUMN_REQUESTS_PENDING, 0, 0);
+		m_columnRequestsQueuePending = true;
+	}
+}
+
+void ShellBrowserImpl::QueuePendingColumnRequests()
+{
+	m_columnRequestsQueuePending = false;
+
+	// Group the requests by item, so that all the columns for an item are retrieved together.
+	std::vector<std::pair<int, std::vector<ColumnType>>> itemRequests;
+	std::unordered_map<int, size_t> itemRequestIndexes;
+
+	for (const auto &[internalIndex, columnType] : m_pendingColumnRequests)
+	{
+		if (!m_itemInfoMap.contains(internalIndex))
+		{
+			// The item has been removed since the request was made.
+			m_pendingColumnText.erase(GetColumnTextKey(internalIndex, columnType));
+			continue;
+		}
+
+		auto [itr, inserted] = itemRequestIndexes.try_emplace(internalIndex, itemRequests.size());
+
+		if (inserted)
+		{
+			itemRequests.push_back({ internalIndex, {} });
+		}
+
+		itemRequests[itr->second].second.push_back(columnType);
+	}
+
+	m_pendingColumnRequests.clear();
+
+	if (itemRequests.empty())
+	{
+		return;
+	}
+
+	// Items that are currently visible are retrieved first, in the order they appear. The
+	// remaining items (e.g. those that have since been scrolled out of view) are retrieved in the
+	// order they were requested.
+	auto itemPriorities = GetItemTaskPriorities();
+	auto getPriority = [&itemPriorities](const auto &itemRequest)
+	{
+		if (!itemPriorities)
+		{
+			return PAINTED_ITEM_TASK_PRIORITY;
+		}
+
+		auto itr = itemPriorities->find(itemRequest.first);
+		return itr != itemPriorities->end() ? itr->second : INT_MAX;
+	};
+
+	std::stable_sort(itemRequests.begin(), itemRequests.end(),
+		[&getPriority](const auto &itemRequest1, const auto &itemRequest2)
+		{ return getPriority(itemRequest1) < getPriority(itemRequest2); });
 
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(itemInternalIndex);
 	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
 
-	auto result = m_columnThreadPool.push(
-		[listView = m_hListView, columnResultID, columnType, itemInternalIndex, basicItemInfo,
-			globalFolderSettings](int id)
+	for (size_t i = 0; i < itemRequests.size(); i += COLUMN_REQUEST_BATCH_SIZE)
+	{
+		size_t batchEnd = std::min(i + COLUMN_REQUEST_BATCH_SIZE, itemRequests.size());
+
+		std::vector<ColumnRequest> columnRequests;
+		columnRequests.reserve(batchEnd - i);
+
+		PendingColumnBatch columnBatch;
+
+		for (size_t j = i; j < batchEnd; j++)
 		{
-			UNREFERENCED_PARAMETER(id);
+			auto &[internalIndex, columnTypes] = itemRequests[j];
+			int generation = GetColumnTextGeneration(internalIndex);
 
-			return GetColumnTextAsync(listView, columnResultID, columnType, itemInternalIndex,
-				basicItemInfo, globalFolderSettings);
-		});
+			for (auto columnType : columnTypes)
+			{
+				columnBatch.columns.push_back({ internalIndex, columnType, generation });
+			}
+
+			columnRequests.push_back({ internalIndex, getBasicItemInfo(internalIndex),
+				std::move(columnTypes), generation });
+		}
 
-	// The function call above might finish before this line runs,
-	// but that doesn't matter, as the results won't be processed
-	// until a message posted to the main thread has been handled
-	// (which can only occur after this function has returned).
-	m_columnResults.insert({ columnResultID, std::move(result) });
+		int columnResultID = m_columnResultIDCounter++;
+
+		// The batch is made up of items in priority order, so the priority of the first item is the
+		// priority of the batch.
+		auto result = m_taskScheduler->QueueTask(this,
+			GetBackgroundTaskId(BackgroundTaskType::ColumnBatch, columnResultID),
+			getPriority(itemRequests[i]),
+			[listView = m_hListView, columnResultID, columnRequests = std::move(columnRequests),
+				globalFolderSettings, folderSizeService = m_folderSizeService]() mutable
+			{
+				return GetColumnTextAsync(listView, columnResultID, columnRequests,
+					globalFolderSettings, folderSizeService);
+			});
+
+		// Each batch has a unique ID, so the task will always be queued.
+		CHECK(result);
+
+		// The function call above might finish before this line runs,
+		// but that doesn't matter, as the results won't be processed
+		// until a message posted to the main thread has been handled
+		// (which can only occur after this function has returned).
+		columnBatch.result = std::move(*result);
+		m_columnResults.insert({ columnResultID, std::move(columnBatch) });
+	}
 }
 
-ShellBrowserImpl::ColumnResult_t ShellBrowserImpl::GetColumnTextAsync(HWND listView,
-	int columnResultId, ColumnType columnType, int internalIndex,
-	const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings)
+void ShellBrowserImpl::CancelColumnBatch(int columnResultId)
 {
-	std::wstring columnText = GetColumnText(columnType, basicItemInfo, globalFolderSettings);
+	auto itr = m_columnResults.find(columnResultId);
+
+	if (itr == m_columnResults.end())
+	{
+		return;
+	}
+
+	// The text for these columns will be requested again if the items are shown again. If an item
+	// has been invalidated since the batch was queued, its columns may have been requested again
+	// already, so are left pending.
+	for (const auto &column : itr->second.columns)
+	{
+		if (column.generation == GetColumnTextGeneration(column.itemInternalIndex))
+		{
+			m_pendingColumnText.erase(
+				GetColumnTextKey(column.itemInternalIndex, column.columnType));
+		}
+	}
+
+	m_columnResults.erase(itr);
+}
+
+std::vector<ShellBrowserImpl::ColumnResult_t> ShellBrowserImpl::GetColumnTextAsync(HWND listView,
+	int columnResultId, std::vector<ColumnRequest> &columnRequests,
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
+{
+	std::vector<ColumnResult_t> results;
+
+	// The items in a batch will generally all be in the same folder, in which case the folder only
+	// needs to be bound once, rather than once for every column of every item.
+	unique_pidl_absolute boundFolderPidl;
+	wil::com_ptr_nothrow<IShellFolder2> boundFolder;
+
+	std::vector<PSID> ownerSids;
+
+	for (auto &columnRequest : columnRequests)
+	{
+		auto &basicItemInfo = columnRequest.basicItemInfo;
+
+		if (!boundFolderPidl
+			|| !ILIsParent(boundFolderPidl.get(), basicItemInfo.pidlComplete.get(), TRUE))
+		{
+			boundFolderPidl.reset(ILCloneFull(basicItemInfo.pidlComplete.get()));
+			ILRemoveLastID(boundFolderPidl.get());
+
+			boundFolder.reset();
+			SHBindToParent(basicItemInfo.pidlComplete.get(), IID_PPV_ARGS(&boundFolder), nullptr);
+		}
+
+		basicItemInfo.parentFolder = boundFolder;
+
+		// Each of the version, media and owner columns requires the file to be opened, so the
+		// values for all the requested columns are read together.
+		basicItemInfo.metadata = std::make_shared<const ItemMetadata>(
+			ReadItemMetadata(basicItemInfo, columnRequest.columnTypes));
+
+		if (basicItemInfo.metadata->ownerSid)
+		{
+			ownerSids.push_back(const_cast<BYTE *>(basicItemInfo.metadata->ownerSid->data()));
+		}
+	}
+
+	// The account names for all the owners in the batch are looked up at once. Typically, only a
+	// few distinct accounts will own the items, so this will often be a single lookup, or no
+	// lookup at all, if the accounts have already been cached.
+	AccountNameCache::GetInstance().Prefetch(ownerSids);
+
+	for (const auto &columnRequest : columnRequests)
+	{
+		for (auto columnType : columnRequest.columnTypes)
+		{
+			auto columnText = GetColumnText(columnType, columnRequest.basicItemInfo,
+				globalFolderSettings, folderSizeService);
+			results.push_back({ columnRequest.itemInternalIndex, columnType,
+				std::move(columnText), columnRequest.generation });
+		}
+	}
 
 	// This message may be delivered before this function has returned.
 	// That doesn't actually matter, since the message handler will
 	// simply wait for the result to be returned.
 	PostMessage(listView, WM_APP_COLUMN_RESULT_READY, columnResultId, 0);
 
-	ColumnResult_t result;
-	result.itemInternalIndex = internalIndex;
-	result.columnType = columnType;
-	result.columnText = columnText;
-
-	return result;
+	return results;
 }
 
 void ShellBrowserImpl::ProcessColumnResult(int columnResultId)
@@ -68,34 +243,74 @@ void ShellBrowserImpl::ProcessColumnResult(int columnResultId)
 		return;
 	}
 
-	if (m_folderSettings.viewMode != +ViewMode::Details)
+	auto results = itr->second.result.get();
+	m_columnResults.erase(itr);
+
+	bool updateListView = (m_folderSettings.viewMode == +ViewMode::Details);
+	std::optional<int> previousInternalIndex;
+	std::optional<int> index;
+
+	for (auto &result : results)
 	{
-		return;
-	}
+		if (result.generation != GetColumnTextGeneration(result.itemInternalIndex))
+		{
+			// The item has changed since this text was retrieved. If the text is still needed, it
+			// will have been requested again.
+			continue;
+		}
 
-	auto result = itr->second.get();
+		auto key = GetColumnTextKey(result.itemInternalIndex, result.columnType);
+		m_pendingColumnText.erase(key);
 
-	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
+		// The results for each item are contiguous, so the item only needs to be located once.
+		bool isNewItem = (result.itemInternalIndex != previousInternalIndex);
+		previousInternalIndex = result.itemInternalIndex;
 
-	if (!index)
-	{
-		// This is a valid state. The item may simply have been deleted.
-		return;
-	}
+		if (!updateListView)
+		{
+			m_columnTextCache.Insert(key, std::move(result.columnText));
+			continue;
+		}
 
-	auto columnIndex = GetColumnIndexByType(result.columnType);
+		if (m_ownerData)
+		{
+			m_columnTextCache.Insert(key, std::move(result.columnText));
 
-	if (!columnIndex)
-	{
-		// This is also a valid state. The column may have been removed.
-		return;
+			if (isNewItem)
+			{
+				RedrawItemByInternalIndex(result.itemInternalIndex);
+			}
+
+			continue;
+		}
+
+		if (isNewItem)
+		{
+			index = LocateItemByInternalIndex(result.itemInternalIndex);
+		}
+
+		auto columnIndex = GetColumnIndexByType(result.columnType);
+
+		// Either of these may be empty. The item may have been deleted, or the column may have
+		// been removed. Either way, the text is still cached.
+		if (index && columnIndex)
+		{
+			ListView_SetItemText(m_hListView, *index, *columnIndex, result.columnText.data());
+		}
+
+		m_columnTextCache.Insert(key, std::move(result.columnText));
 	}
+}
 
-	auto columnText = std::make_unique<TCHAR[]>(result.columnText.size() + 1);
-	StringCchCopy(columnText.get(), result.columnText.size() + 1, result.columnText.c_str());
-	ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.get());
+uint64_t ShellBrowserImpl::GetColumnTextKey(int internalIndex, ColumnType columnType)
+{
+	return (static_cast<uint64_t>(internalIndex) << 32) | columnType._to_integral();
+}
 
-	m_columnResults.erase(itr);
+int ShellBrowserImpl::GetColumnTextGeneration(int internalIndex) const
+{
+	auto itr = m_columnTextGenerations.find(internalIndex);
+	return itr != m_columnTextGenerations.end() ? itr->second : 0;
 }
 
 std::optional<int> ShellBrowserImpl::GetColumnIndexByType(ColumnType columnType) const
@@ -13,6 +13,37 @@
 #include "../Helper/ShellHelper.h"
 #include <list>
 
+namespace
+{
+
+// Items are identified by their parsing names, since the pidls in different notifications for the
+// same item won't necessarily be identical. If the parsing name can't be retrieved, the bytes of
+// the child ID are used instead (prefixed with a character that can't appear in a parsing name),
+// which still allows repeated notifications for the same pidl to be combined.
+std::wstring GetItemChangeKey(PCIDLIST_ABSOLUTE simplePidl)
+{
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(simplePidl, SHGDN_FORPARSING, parsingName);
+
+	if (SUCCEEDED(hr))
+	{
+		return parsingName;
+	}
+
+	auto *child = ILFindLastID(simplePidl);
+	const auto *bytes = reinterpret_cast<const BYTE *>(child);
+	std::wstring key(1, '\0');
+
+	for (USHORT i = 0; i < child->mkid.cb; i++)
+	{
+		key += static_cast<wchar_t>(bytes[i]);
+	}
+
+	return key;
+}
+
+}
+
 void ShellBrowserImpl::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 {
 	// Shouldn't be monitoring the same directory with both directory modification notifications and
@@ -50,19 +81,23 @@ void ShellBrowserImpl::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 void ShellBrowserImpl::ProcessShellChangeNotifications(
 	const std::vector<ShellChangeNotification> &shellChangeNotifications)
 {
-	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	ItemChangeCoalescer coalescer;
 
 	for (const auto &change : shellChangeNotifications)
 	{
-		ProcessShellChangeNotification(change);
+		ProcessShellChangeNotification(change, coalescer);
 	}
 
-	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+	ApplyItemChanges(coalescer);
 
 	directoryModified.m_signal();
 }
 
-void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotification &change)
+// Changes to items within the current directory are passed to the coalescer, with the net result
+// being applied once all the notifications in the batch have been processed. Changes to the
+// directory itself are handled directly.
+void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotification &change,
+	ItemChangeCoalescer &coalescer)
 {
 	switch (change.event)
 	{
@@ -71,7 +106,7 @@ void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotificat
 	case SHCNE_CREATE:
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemAdded(change.pidl1.get());
+			coalescer.OnItemAdded(GetItemChangeKey(change.pidl1.get()), change.pidl1.get());
 		}
 		break;
 
@@ -80,7 +115,8 @@ void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotificat
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE)
 			&& ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), TRUE))
 		{
-			OnItemRenamed(change.pidl1.get(), change.pidl2.get());
+			coalescer.OnItemRenamed(GetItemChangeKey(change.pidl1.get()), change.pidl1.get(),
+				GetItemChangeKey(change.pidl2.get()), change.pidl2.get());
 		}
 		else if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
 		{
@@ -92,7 +128,7 @@ void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotificat
 	case SHCNE_UPDATEITEM:
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemModified(change.pidl1.get());
+			coalescer.OnItemModified(GetItemChangeKey(change.pidl1.get()), change.pidl1.get());
 		}
 		break;
 
@@ -126,7 +162,7 @@ void ShellBrowserImpl::ProcessShellChangeNotification(const ShellChangeNotificat
 		// item is actually a child of the current directory.
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemRemoved(change.pidl1.get());
+			coalescer.OnItemRemoved(GetItemChangeKey(change.pidl1.get()), change.pidl1.get());
 		}
 		else if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get())
 			|| ILIsParent(change.pidl1.get(), m_directoryState.pidlDirectory.get(), false))
@@ -145,7 +181,18 @@ void ShellBrowserImpl::DirectoryAltered()
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
 
-	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	// The directory is monitored from the point at which the navigation is committed, so
+	// notifications can arrive before the enumeration has delivered all of its items. An item
+	// that's removed may not have been inserted yet, while an item that's added may also be
+	// returned by the enumeration. The notifications are therefore left queued and applied once
+	// the enumeration has completed.
+	if (m_enumerationResults)
+	{
+		LeaveCriticalSection(&m_csDirectoryAltered);
+		return;
+	}
+
+	ItemChangeCoalescer coalescer;
 
 	// Note that directory change notifications are received asynchronously. That means that, in
 	// each of the cases below, it's not reasonable to assume that the file being referenced
@@ -178,10 +225,12 @@ void ShellBrowserImpl::DirectoryAltered()
 			continue;
 		}
 
+		std::wstring key = GetItemChangeKey(simplePidl.Raw());
+
 		switch (af.dwAction)
 		{
 		case FILE_ACTION_ADDED:
-			OnItemAdded(simplePidl.Raw());
+			coalescer.OnItemAdded(key, simplePidl);
 			break;
 
 		case FILE_ACTION_RENAMED_OLD_NAME:
@@ -190,22 +239,26 @@ void ShellBrowserImpl::DirectoryAltered()
 			break;
 
 		case FILE_ACTION_RENAMED_NEW_NAME:
-			OnItemRenamed(m_renamedItemOldPidl.get(), simplePidl.Raw());
+			if (m_renamedItemOldPidl)
+			{
+				coalescer.OnItemRenamed(GetItemChangeKey(m_renamedItemOldPidl.get()),
+					m_renamedItemOldPidl.get(), key, simplePidl);
+			}
 
 			m_renamedItemOldPidl.reset();
 			break;
 
 		case FILE_ACTION_MODIFIED:
-			OnItemModified(simplePidl.Raw());
+			coalescer.OnItemModified(key, simplePidl);
 			break;
 
 		case FILE_ACTION_REMOVED:
-			OnItemRemoved(simplePidl.Raw());
+			coalescer.OnItemRemoved(key, simplePidl);
 			break;
 		}
 	}
 
-	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+	ApplyItemChanges(coalescer);
 
 	directoryModified.m_signal();
 
@@ -242,58 +295,141 @@ void ShellBrowserImpl::FilesModified(DWORD Action, const TCHAR *FileName, int Ev
 	LeaveCriticalSection(&m_csDirectoryAltered);
 }
 
-void ShellBrowserImpl::OnItemAdded(PCIDLIST_ABSOLUTE simplePidl)
+// Applies the net set of changes to the view. Rather than each change triggering a re-sort, the
+// items that have been added or updated are merged into their sorted positions once all the
+// changes have been made. If the number of changes is large, relative to the size of the folder,
+// re-enumerating the folder is cheaper than applying the changes individually.
+void ShellBrowserImpl::ApplyItemChanges(const ItemChangeCoalescer &coalescer)
 {
-	auto existingItemInternalIndex = GetItemInternalIndexForPidl(simplePidl);
+	auto changes = coalescer.GetChanges();
 
-	// When adding an item, it makes no sense to add it if it already exists. If the item does
-	// exist, it's an indication of a programming error. That is, it's not expected that this would
-	// happen at all during normal use.
-	// Silently returning here is about the only thing that can be reasonably done and at least
-	// prevents duplicate items from being added.
-	if (existingItemInternalIndex)
+	if (changes.empty())
 	{
-		assert(false);
 		return;
 	}
 
-	unique_pidl_absolute pidlFull;
-	HRESULT hr = SimplePidlToFullPidl(simplePidl, wil::out_param(pidlFull));
+	InvalidateCachedItems(changes);
 
-	PCIDLIST_ABSOLUTE pidl;
+	if (changes.size() >= GetFullRefreshThreshold())
+	{
+		// As with SHCNE_UPDATEDIR notifications, it's not safe to refresh immediately, so a
+		// pending task is used.
+		AddTaskToPendingWorkQueue(
+			std::bind_front(&ShellBrowserImpl::RefreshDirectoryAfterUpdate, this));
+		return;
+	}
 
-	// The item being referenced may not exist at this point, so it's valid for SimplePidlToFullPidl
-	// to fail. In that case, the simple PIDL will be used instead. The issue with that is that the
-	// WIN32_FIND_DATA information cached in the simple PIDL won't be valid. However, that's likely
-	// ok.
-	// The reason for that is that if this item has been renamed or deleted, the notification for
-	// the rename/deletion is likely to be processed soon, so that there would be no practical
-	// chance for the user to notice that the item details are wrong.
-	if (SUCCEEDED(hr))
+	// Each item is located using its original details, before any changes are made, so that
+	// changes which depend on each other (e.g. two items swapping names) don't interfere.
+	std::vector<std::optional<int>> internalIndexes;
+	internalIndexes.reserve(changes.size());
+
+	for (const auto &change : changes)
 	{
-		pidl = pidlFull.get();
+		internalIndexes.push_back(change.originalItem
+				? GetItemInternalIndexForPidl(change.originalItem->Raw())
+				: std::nullopt);
 	}
-	else
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	std::unordered_set<int> itemsToPosition;
+	std::vector<int> removedItems;
+
+	for (size_t i = 0; i < changes.size(); i++)
 	{
-		pidl = simplePidl;
+		const auto &change = changes[i];
+		const auto &internalIndex = internalIndexes[i];
+
+		switch (change.type)
+		{
+		case ItemChangeCoalescer::ChangeType::Added:
+		{
+			// An item that was added while the folder was being enumerated may have been
+			// returned by the enumeration as well, in which case it's already present.
+			if (GetItemInternalIndexForPidl(change.currentItem->Raw()))
+			{
+				break;
+			}
+
+			auto itemId = AddNotifiedItem(change.currentItem->Raw());
+
+			if (itemId && m_config->globalFolderSettings.insertSorted)
+			{
+				itemsToPosition.insert(*itemId);
+			}
+		}
+		break;
+
+		case ItemChangeCoalescer::ChangeType::Removed:
+			if (internalIndex)
+			{
+				removedItems.push_back(*internalIndex);
+			}
+			break;
+
+		case ItemChangeCoalescer::ChangeType::Modified:
+		case ItemChangeCoalescer::ChangeType::Renamed:
+			if (internalIndex
+				&& UpdateNotifiedItem(*internalIndex, change.currentItem->Raw(),
+					change.type == ItemChangeCoalescer::ChangeType::Renamed))
+			{
+				itemsToPosition.insert(*internalIndex);
+			}
+			break;
+		}
+	}
+
+	// Removals are applied together, so that the view only has to be rebuilt once, rather than
+	// once per removed item.
+	RemoveItems(removedItems);
+
+	InsertAwaitingItems();
+
+	if (!itemsToPosition.empty())
+	{
+		MoveItemsToSortedPositions(itemsToPosition);
 	}
 
-	AddItem(pidl);
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 }
 
-void ShellBrowserImpl::AddItem(PCIDLIST_ABSOLUTE pidl)
+// The folder enumeration service monitors cached folders itself, but changes detected by the
+// directory monitor may not generate a matching shell notification, so the cached items are
+// invalidated here as well. A folder that's been removed or renamed also invalidates any cached
+// items within it.
+void ShellBrowserImpl::InvalidateCachedItems(
+	const std::vector<ItemChangeCoalescer::Change> &changes)
 {
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	PCITEMID_CHILD pidlChild = nullptr;
-	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
+	m_folderEnumerationService->InvalidateFolder(m_directoryState.directory);
 
-	if (FAILED(hr))
+	for (const auto &change : changes)
 	{
-		return;
+		if ((change.type != ItemChangeCoalescer::ChangeType::Removed
+				&& change.type != ItemChangeCoalescer::ChangeType::Renamed)
+			|| !change.originalItem)
+		{
+			continue;
+		}
+
+		std::wstring originalPath;
+		HRESULT hr = GetDisplayName(change.originalItem->Raw(), SHGDN_FORPARSING, originalPath);
+
+		if (SUCCEEDED(hr))
+		{
+			m_folderEnumerationService->InvalidateTree(originalPath);
+		}
 	}
+}
+
+size_t ShellBrowserImpl::GetFullRefreshThreshold() const
+{
+	return std::max(FULL_REFRESH_MIN_CHANGES, m_itemInfoMap.size() / FULL_REFRESH_FOLDER_FRACTION);
+}
 
-	auto itemId = AddItemInternal(shellFolder.get(), m_directoryState.pidlDirectory.get(),
-		pidlChild, -1, FALSE);
+void ShellBrowserImpl::OnItemAdded(PCIDLIST_ABSOLUTE simplePidl)
+{
+	auto itemId = AddNotifiedItem(simplePidl);
 
 	if (!itemId)
 	{
@@ -323,29 +459,89 @@ void ShellBrowserImpl::AddItem(PCIDLIST_ABSOLUTE pidl)
 	InsertAwaitingItems();
 }
 
-void ShellBrowserImpl::OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl)
+// Adds the item to the list of items awaiting insertion.
+std::optional<int> ShellBrowserImpl::AddNotifiedItem(PCIDLIST_ABSOLUTE simplePidl)
 {
-	auto internalIndex = GetItemInternalIndexForPidl(simplePidl);
+	auto existingItemInternalIndex = GetItemInternalIndexForPidl(simplePidl);
+
+	// When adding an item, it makes no sense to add it if it already exists. If the item does
+	// exist, it's an indication of a programming error. That is, it's not expected that this would
+	// happen at all during normal use.
+	// Silently returning here is about the only thing that can be reasonably done and at least
+	// prevents duplicate items from being added.
+	if (existingItemInternalIndex)
+	{
+		assert(false);
+		return std::nullopt;
+	}
+
+	unique_pidl_absolute pidlFull;
+	HRESULT hr = SimplePidlToFullPidl(simplePidl, wil::out_param(pidlFull));
+
+	PCIDLIST_ABSOLUTE pidl;
+
+	// The item being referenced may not exist at this point, so it's valid for SimplePidlToFullPidl
+	// to fail. In that case, the simple PIDL will be used instead. The issue with that is that the
+	// WIN32_FIND_DATA information cached in the simple PIDL won't be valid. However, that's likely
+	// ok.
+	// The reason for that is that if this item has been renamed or deleted, the notification for
+	// the rename/deletion is likely to be processed soon, so that there would be no practical
+	// chance for the user to notice that the item details are wrong.
+	if (SUCCEEDED(hr))
+	{
+		pidl = pidlFull.get();
+	}
+	else
+	{
+		pidl = simplePidl;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	PCITEMID_CHILD pidlChild = nullptr;
+	hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
 
-	if (internalIndex)
+	if (FAILED(hr))
 	{
-		RemoveItem(*internalIndex);
+		return std::nullopt;
 	}
+
+	return AddItemInternal(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild, -1,
+		FALSE);
 }
 
-void ShellBrowserImpl::OnItemModified(PCIDLIST_ABSOLUTE simplePidl)
+// Returns true if the item is shown and may need to be moved to a new sorted position.
+bool ShellBrowserImpl::UpdateNotifiedItem(int internalIndex, PCIDLIST_ABSOLUTE simplePidl,
+	bool renamed)
 {
+	// When an item is updated, the WIN32_FIND_DATA information cached in the pidl will be
+	// retrieved. As the simple pidl won't contain this information, it's important to convert the
+	// pidl to a full pidl here.
 	unique_pidl_absolute pidlFull;
 	HRESULT hr = SimplePidlToFullPidl(simplePidl, wil::out_param(pidlFull));
 
-	// SimplePidlToFullPidl may fail if this item no longer exists. However, there's nothing that
-	// can be done in that case. Leaving the previous details in place until the rename/deletion
-	// notification is received is ok and unlikely to actually be noticed by the user (since the
-	// rename/deletion notification is likely to be processed soon).
 	if (SUCCEEDED(hr))
 	{
-		UpdateItem(pidlFull.get());
+		return UpdateItemDetails(internalIndex, pidlFull.get());
 	}
+
+	// SimplePidlToFullPidl may fail if this item no longer exists. For a modification, there's
+	// nothing that can be done in that case. Leaving the previous details in place until the
+	// rename/deletion notification is received is ok and unlikely to actually be noticed by the
+	// user (since the rename/deletion notification is likely to be processed soon).
+	// For a rename, updating the item details anyway should be ok, for two reasons.
+	// The first is that, as when adding an item, the rename/deletion notification is likely to be
+	// received soon, so there's not much practical chance for the user to notice that the item has
+	// invalid details.
+	// The second is that even if there was enough time for the user to notice the details were
+	// invalid, they would also be invalid if the original details were left in place. That is,
+	// attempting to show information on the item, based on its previous name, is going to fail as
+	// well.
+	if (!renamed)
+	{
+		return false;
+	}
+
+	return UpdateItemDetails(internalIndex, simplePidl);
 }
 
 // Handles both renames and modifications, since they're effectively the same thing. When a rename
@@ -378,43 +574,72 @@ void ShellBrowserImpl::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE upda
 		currentPidl = updatedPidl;
 	}
 
+	if (!UpdateItemDetails(*internalIndex, currentPidl))
+	{
+		return;
+	}
+
+	if (m_ownerData)
+	{
+		SortFolderOwnerData();
+	}
+	else
+	{
+		SortListViewItems();
+	}
+}
+
+// Re-reads the details for the specified item. Returns true if the item is shown in the listview,
+// in which case it may need to be moved to a new sorted position (which is left to the caller).
+bool ShellBrowserImpl::UpdateItemDetails(int internalIndex, PCIDLIST_ABSOLUTE pidl)
+{
 	wil::com_ptr_nothrow<IShellFolder> shellFolder;
 	PCITEMID_CHILD pidlChild = nullptr;
-	HRESULT hr = SHBindToParent(currentPidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
 
 	if (FAILED(hr))
 	{
-		return;
+		return false;
 	}
 
-	auto itemInfo =
+	auto newItemInfo =
 		GetItemInformation(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
 
-	if (!itemInfo)
+	if (!newItemInfo)
 	{
-		return;
+		return false;
 	}
 
-	ULARGE_INTEGER oldFileSize = { m_itemInfoMap[*internalIndex].wfd.nFileSizeLow,
-		m_itemInfoMap[*internalIndex].wfd.nFileSizeHigh };
-	ULARGE_INTEGER newFileSize = { itemInfo->wfd.nFileSizeLow, itemInfo->wfd.nFileSizeHigh };
+	ULARGE_INTEGER oldFileSize;
+	oldFileSize.QuadPart = m_itemStore.GetSize(internalIndex);
+	ULARGE_INTEGER newFileSize = { newItemInfo->wfd.nFileSizeLow, newItemInfo->wfd.nFileSizeHigh };
 
 	m_directoryState.totalDirSize += newFileSize.QuadPart - oldFileSize.QuadPart;
 
-	m_itemInfoMap[*internalIndex] = std::move(*itemInfo);
-	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[*internalIndex];
+	if (m_ownerData)
+	{
+		// In owner data mode, the cut state is tracked alongside the rest of the item details,
+		// rather than by the listview, so needs to be carried over.
+		newItemInfo->itemInfo.cut = m_itemInfoMap[internalIndex].cut;
+	}
 
-	auto itemIndex = LocateItemByInternalIndex(*internalIndex);
+	m_itemStore.Update(internalIndex, GetItemStoreDetails(*newItemInfo));
+	m_itemInfoMap[internalIndex] = std::move(newItemInfo->itemInfo);
+
+	// The item may have been renamed, in which case the keys it can be found by will have changed.
+	AddItemToLookupIndex(internalIndex);
+
+	auto itemIndex = LocateItemByInternalIndex(internalIndex);
 
 	// Items may be filtered out of the listview, so it's valid for an item not to be found.
 	if (!itemIndex)
 	{
-		if (!IsFileFiltered(updatedItemInfo))
+		if (!IsFileFiltered(internalIndex))
 		{
-			UnfilterItem(*internalIndex);
+			UnfilterItem(internalIndex);
 		}
 
-		return;
+		return false;
 	}
 
 	UINT state = ListView_GetItemState(m_hListView, *itemIndex, LVIS_SELECTED);
@@ -424,14 +649,22 @@ void ShellBrowserImpl::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE upda
 		m_directoryState.fileSelectionSize += newFileSize.QuadPart - oldFileSize.QuadPart;
 	}
 
-	if (IsFileFiltered(updatedItemInfo))
+	if (IsFileFiltered(internalIndex))
 	{
-		RemoveFilteredItem(*itemIndex, *internalIndex);
-		return;
+		RemoveFilteredItem(*itemIndex, internalIndex);
+		return false;
 	}
 
 	InvalidateIconForItem(*itemIndex);
 
+	if (m_ownerData)
+	{
+		// Nothing is stored within the listview in owner data mode, so once the cached details
+		// have been invalidated, the item only needs to be moved to its new sorted position.
+		InvalidateAllColumnsForItem(*itemIndex);
+		return true;
+	}
+
 	if (m_folderSettings.viewMode == +ViewMode::Details)
 	{
 		InvalidateAllColumnsForItem(*itemIndex);
@@ -440,12 +673,12 @@ void ShellBrowserImpl::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE upda
 	{
 		// The display name can change, even if the parsing name is the same. For example, when the
 		// recycle bin is renamed, the parsing name remains the same.
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(*internalIndex);
+		BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
 		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 		ListView_SetItemText(m_hListView, *itemIndex, 0, filename.data());
 	}
 
-	if (WI_IsFlagSet(updatedItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	if (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN))
 	{
 		ListView_SetItemState(m_hListView, *itemIndex, LVIS_CUT, LVIS_CUT);
 	}
@@ -456,50 +689,37 @@ void ShellBrowserImpl::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE upda
 
 	if (m_folderSettings.showInGroups)
 	{
-		int groupId = DetermineItemGroup(*internalIndex);
+		int groupId = DetermineItemGroup(internalIndex);
 		InsertItemIntoGroup(*itemIndex, groupId);
 	}
 
-	// It's not safe to use itemIndex past this point.
-	ListView_SortItems(m_hListView, SortStub, this);
-	itemIndex.reset();
+	return true;
 }
 
-void ShellBrowserImpl::OnItemRenamed(PCIDLIST_ABSOLUTE simplePidlOld,
-	PCIDLIST_ABSOLUTE simplePidlNew)
+void ShellBrowserImpl::InvalidateAllColumnsForItem(int itemIndex)
 {
-	// When an item is updated, the WIN32_FIND_DATA information cached in the pidl will be
-	// retrieved. As the simple pidl won't contain this information, it's important to convert the
-	// pidl to a full pidl here.
-	unique_pidl_absolute pidlNewFull;
-	HRESULT hr = SimplePidlToFullPidl(simplePidlNew, wil::out_param(pidlNewFull));
+	int internalIndex = GetItemInternalIndex(itemIndex);
+	auto keyPrefix = static_cast<uint64_t>(internalIndex);
+	m_columnTextCache.RemoveIf([keyPrefix](uint64_t key, const std::wstring &text)
+		{
+			UNREFERENCED_PARAMETER(text);
+			return (key >> 32) == keyPrefix;
+		});
 
-	PCIDLIST_ABSOLUTE pidlNew;
+	// Any text that's currently being retrieved for the item will be out of date, so it will be
+	// discarded when it arrives and each column can be requested again straight away.
+	m_columnTextGenerations[internalIndex]++;
+	std::erase_if(m_pendingColumnText,
+		[keyPrefix](uint64_t key) { return (key >> 32) == keyPrefix; });
+	std::erase_if(m_pendingColumnRequests,
+		[internalIndex](const auto &request) { return request.first == internalIndex; });
 
-	// As with the above cases, it's valid for SimplePidlToFullPidl to fail, since the item may no
-	// longer exist with the new name. Updating the item details anyway should be ok, for two
-	// reasons.
-	// The first is that, as when adding an item, the rename/deletion notification is likely to be
-	// received soon, so there's not much practical chance for the user to notice that the item has
-	// invalid details.
-	// The second is that even if there was enough time for the user to notice the details were
-	// invalid, they would also be invalid if the original details were left in place. That is,
-	// attempting to show information on the item, based on its previous name, is going to fail as
-	// well.
-	if (SUCCEEDED(hr))
+	if (m_ownerData)
 	{
-		pidlNew = pidlNewFull.get();
-	}
-	else
-	{
-		pidlNew = simplePidlNew;
+		ListView_RedrawItems(m_hListView, itemIndex, itemIndex);
+		return;
 	}
 
-	UpdateItem(simplePidlOld, pidlNew);
-}
-
-void ShellBrowserImpl::InvalidateAllColumnsForItem(int itemIndex)
-{
 	if (m_folderSettings.viewMode != +ViewMode::Details)
 	{
 		return;
@@ -516,6 +736,13 @@ void ShellBrowserImpl::InvalidateAllColumnsForItem(int itemIndex)
 
 void ShellBrowserImpl::InvalidateIconForItem(int itemIndex)
 {
+	if (m_ownerData)
+	{
+		m_itemInfoMap.at(GetItemInternalIndex(itemIndex)).imageIndex.reset();
+		ListView_RedrawItems(m_hListView, itemIndex, itemIndex);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE;
 	lvItem.iItem = itemIndex;
@@ -36,14 +36,14 @@ int ShellBrowserImpl::GetDropTargetItem(const POINT &pt)
 		return -1;
 	}
 
-	auto &item = GetItemByIndex(index);
+	int internalIndex = GetItemInternalIndex(index);
+	const auto &item = m_itemInfoMap.at(internalIndex);
 
 	// Folders always act as drop targets. If a folder can't actually accept a drop, the drop should
 	// be marked as blocked. On the other hand, a file may accept a drop (e.g. it may be possible to
 	// drop an item on an executable). But if the file can't accept the drop, then the drop target
 	// should revert to the parent.
-	if (WI_IsFlagClear(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
-		&& !GetDropTargetForPidl(item.pidlComplete.get()))
+	if (!IsItemFolder(internalIndex) && !GetDropTargetForPidl(item.pidlComplete.get()))
 	{
 		return -1;
 	}
@@ -125,6 +125,13 @@ void ShellBrowserImpl::RepositionLocalFiles(const POINT *ppt)
 	POINT pt;
 	POINT ptOrigin;
 
+	// Items in an owner data listview are always shown in sorted order and can't be manually
+	// positioned.
+	if (m_ownerData)
+	{
+		return;
+	}
+
 	pt = *ppt;
 	ScreenToClient(m_hListView, &pt);
 
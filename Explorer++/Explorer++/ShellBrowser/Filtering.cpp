@@ -15,12 +15,28 @@ std::wstring ShellBrowserImpl::GetFilterText() const
 void ShellBrowserImpl::SetFilterText(std::wstring_view filter)
 {
 	m_folderSettings.filter = filter;
+	m_filterPattern = WildcardPattern(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
 
-	if (m_folderSettings.applyFilter)
+	if (!m_folderSettings.applyFilter)
 	{
-		UnfilterAllItems();
-		UpdateFiltering();
+		return;
 	}
+
+	// As a filter is typed, each new pattern will often be a refinement of the previous one, in
+	// which case none of the items that are currently filtered out can match and only the items
+	// that are shown need to be checked.
+	auto scope = FilterScope::AllItems;
+
+	if (m_appliedFilterPattern && m_filterPattern.IsRefinementOf(*m_appliedFilterPattern))
+	{
+		scope = FilterScope::ShownItems;
+	}
+	else if (m_appliedFilterPattern && m_appliedFilterPattern->IsRefinementOf(m_filterPattern))
+	{
+		scope = FilterScope::FilteredItems;
+	}
+
+	ApplyFilter(scope);
 }
 
 void ShellBrowserImpl::SetFilterApplied(bool filter)
@@ -37,7 +53,16 @@ bool ShellBrowserImpl::IsFilterApplied() const
 
 void ShellBrowserImpl::SetFilterCaseSensitive(bool filterCaseSensitive)
 {
+	if (filterCaseSensitive != m_folderSettings.filterCaseSensitive)
+	{
+		// Items added from this point will be checked using a pattern with a different case
+		// sensitivity, so the set of filtered items can't be updated incrementally the next time
+		// the filter changes.
+		m_appliedFilterPattern.reset();
+	}
+
 	m_folderSettings.filterCaseSensitive = filterCaseSensitive;
+	m_filterPattern = WildcardPattern(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
 }
 
 bool ShellBrowserImpl::GetFilterCaseSensitive() const
@@ -47,62 +72,185 @@ bool ShellBrowserImpl::GetFilterCaseSensitive() const
 
 void ShellBrowserImpl::UpdateFiltering()
 {
+	// Applying the filter can only hide items that are shown, while removing it can only show
+	// items that are hidden.
+	ApplyFilter(m_folderSettings.applyFilter ? FilterScope::ShownItems : FilterScope::FilteredItems);
+}
+
+// Rather than showing every item and then removing each item that doesn't match, the new state of
+// each item within the scope is determined up front and the view is then updated in a single pass.
+void ShellBrowserImpl::ApplyFilter(FilterScope scope)
+{
+	std::vector<int> items;
+	size_t numShownItems = 0;
+
+	if (scope != FilterScope::FilteredItems)
+	{
+		if (m_ownerData)
+		{
+			items = m_ownerDataItems;
+		}
+		else
+		{
+			int numItems = ListView_GetItemCount(m_hListView);
+			items.reserve(numItems);
+
+			for (int i = 0; i < numItems; i++)
+			{
+				items.push_back(GetItemInternalIndex(i));
+			}
+		}
+
+		numShownItems = items.size();
+	}
+
+	if (scope != FilterScope::ShownItems)
+	{
+		items.insert(items.end(), m_directoryState.filteredItemsList.begin(),
+			m_directoryState.filteredItemsList.end());
+	}
+
+	auto filteredBitmap = BuildFilteredItemBitmap(items);
+
+	auto isFiltered = [&filteredBitmap](size_t index)
+	{ return ((filteredBitmap[index / 64] >> (index % 64)) & 1) != 0; };
+
+	// Shown items are identified by their position, since that's what's needed to remove them.
+	std::vector<int> positionsToFilter;
+	std::vector<int> itemsToRestore;
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (i < numShownItems && isFiltered(i))
+		{
+			positionsToFilter.push_back(static_cast<int>(i));
+		}
+		else if (i >= numShownItems && !isFiltered(i))
+		{
+			itemsToRestore.push_back(items[i]);
+		}
+	}
+
 	if (m_folderSettings.applyFilter)
 	{
-		RemoveFilteredItems();
+		m_appliedFilterPattern = m_filterPattern;
 	}
 	else
 	{
-		UnfilterAllItems();
+		m_appliedFilterPattern.reset();
 	}
-}
 
-void ShellBrowserImpl::RemoveFilteredItems()
-{
-	if (!m_folderSettings.applyFilter)
+	if (positionsToFilter.empty() && itemsToRestore.empty())
 	{
 		return;
 	}
 
-	int nItems = ListView_GetItemCount(m_hListView);
-
-	for (int i = nItems - 1; i >= 0; i--)
+	if (m_ownerData)
+	{
+		ApplyFilterChangesOwnerData(positionsToFilter, itemsToRestore);
+	}
+	else
 	{
-		int internalIndex = GetItemInternalIndex(i);
+		ApplyFilterChanges(positionsToFilter, itemsToRestore);
+	}
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+}
+
+// Returns a bitmap with a bit set for each of the specified items that's filtered. Large folders
+// are split into chunks, which are checked in parallel.
+std::vector<uint64_t> ShellBrowserImpl::BuildFilteredItemBitmap(const std::vector<int> &items) const
+{
+	std::vector<uint64_t> filteredBitmap((items.size() + 63) / 64, 0);
+	size_t numChunks = (items.size() + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
 
-		if (!((m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY))
+	m_backgroundExecutor->ParallelFor(numChunks,
+		[this, &items, &filteredBitmap](size_t chunk)
 		{
-			if (IsFilenameFiltered(m_itemInfoMap.at(internalIndex).displayName.c_str()))
+			size_t start = chunk * FILTER_CHUNK_SIZE;
+			size_t end = std::min(start + FILTER_CHUNK_SIZE, items.size());
+
+			for (size_t i = start; i < end; i++)
 			{
-				RemoveFilteredItem(i, internalIndex);
+				if (IsItemFiltered(items[i]))
+				{
+					filteredBitmap[i / 64] |= uint64_t{ 1 } << (i % 64);
+				}
 			}
+		});
+
+	return filteredBitmap;
+}
+
+// Note that this may be called on multiple threads at once, so it should only read the item's
+// details.
+bool ShellBrowserImpl::IsItemFiltered(int internalIndex) const
+{
+	return IsFileFiltered(internalIndex);
+}
+
+// The positions to filter are expected to be in ascending order.
+void ShellBrowserImpl::ApplyFilterChanges(const std::vector<int> &positionsToFilter,
+	const std::vector<int> &itemsToRestore)
+{
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	// Removing items from the end first means that the positions of the other items to be removed
+	// aren't affected.
+	for (auto itr = positionsToFilter.rbegin(); itr != positionsToFilter.rend(); ++itr)
+	{
+		RemoveFilteredItem(*itr, GetItemInternalIndex(*itr));
+	}
+
+	if (!itemsToRestore.empty())
+	{
+		int numItems = ListView_GetItemCount(m_hListView);
+
+		for (int internalIndex : itemsToRestore)
+		{
+			m_directoryState.filteredItemsList.erase(internalIndex);
+
+			AwaitingAdd_t awaitingAdd;
+			awaitingAdd.iItem = numItems++;
+			awaitingAdd.bPosition = FALSE;
+			awaitingAdd.iAfter = -1;
+			awaitingAdd.iItemInternal = internalIndex;
+			m_directoryState.awaitingAddList.push_back(awaitingAdd);
 		}
+
+		// Sorting once, after all the items have been added, is much cheaper than determining the
+		// sorted position of each item individually.
+		InsertAwaitingItems();
+		SortFolder();
 	}
 
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 }
 
 void ShellBrowserImpl::RemoveFilteredItem(int iItem, int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
+	if (m_ownerData)
+	{
+		m_directoryState.totalDirSize -= m_itemStore.GetSize(iItemInternal);
+
+		// This will also update the selection details, if necessary.
+		DeleteOwnerDataItem(iItem);
 
-	const auto &item = m_itemInfoMap.at(iItemInternal);
+		m_directoryState.numItems--;
+
+		assert(m_directoryState.filteredItemsList.count(iItemInternal) == 0);
+		m_directoryState.filteredItemsList.insert(iItemInternal);
+		return;
+	}
 
 	if (ListView_GetItemState(m_hListView, iItem, LVIS_SELECTED) == LVIS_SELECTED)
 	{
-		ulFileSize.LowPart = item.wfd.nFileSizeLow;
-		ulFileSize.HighPart = item.wfd.nFileSizeHigh;
-
-		m_directoryState.fileSelectionSize -= ulFileSize.QuadPart;
+		m_directoryState.fileSelectionSize -= m_itemStore.GetSize(iItemInternal);
 	}
 
 	/* Take the file size of the removed file away from the total
 	directory size. */
-	ulFileSize.LowPart = item.wfd.nFileSizeLow;
-	ulFileSize.HighPart = item.wfd.nFileSizeHigh;
-
-	m_directoryState.totalDirSize -= ulFileSize.QuadPart;
+	m_directoryState.totalDirSize -= m_itemStore.GetSize(iItemInternal);
 
 	/* Remove the item from the m_hListView. */
 	ListView_DeleteItem(m_hListView, iItem);
@@ -115,8 +263,7 @@ void ShellBrowserImpl::RemoveFilteredItem(int iItem, int iItemInternal)
 
 BOOL ShellBrowserImpl::IsFilenameFiltered(const TCHAR *FileName) const
 {
-	if (CheckWildcardMatch(m_folderSettings.filter.c_str(), FileName,
-			m_folderSettings.filterCaseSensitive))
+	if (m_filterPattern.Matches(FileName))
 	{
 		return FALSE;
 	}
@@ -124,17 +271,6 @@ BOOL ShellBrowserImpl::IsFilenameFiltered(const TCHAR *FileName) const
 	return TRUE;
 }
 
-void ShellBrowserImpl::UnfilterAllItems()
-{
-	for (int internalIndex : m_directoryState.filteredItemsList)
-	{
-		RestoreFilteredItem(internalIndex);
-	}
-
-	m_directoryState.filteredItemsList.clear();
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
-}
-
 void ShellBrowserImpl::UnfilterItem(int internalIndex)
 {
 	assert(m_directoryState.filteredItemsList.count(internalIndex) == 1);
@@ -9,6 +9,7 @@
 #include "MainResource.h"
 #include "ResourceHelper.h"
 #include "SortModes.h"
+#include "../Helper/FileTypeNameCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
@@ -41,6 +42,12 @@ void ShellBrowserImpl::SetShowInGroups(bool showInGroups)
 		return;
 	}
 
+	// Owner data listviews don't support groups.
+	if (m_ownerData)
+	{
+		return;
+	}
+
 	m_folderSettings.showInGroups = showInGroups;
 
 	if (!showInGroups)
@@ -191,23 +198,23 @@ int ShellBrowserImpl::DetermineItemGroup(int iItemInternal)
 		break;
 
 	case SortMode::ProductName:
-		groupInfo = DetermineItemVersionGroup(basicItemInfo, _T("ProductName"));
+		groupInfo = DetermineItemVersionGroup(basicItemInfo, VersionInfoType::ProductName);
 		break;
 
 	case SortMode::Company:
-		groupInfo = DetermineItemVersionGroup(basicItemInfo, _T("CompanyName"));
+		groupInfo = DetermineItemVersionGroup(basicItemInfo, VersionInfoType::Company);
 		break;
 
 	case SortMode::Description:
-		groupInfo = DetermineItemVersionGroup(basicItemInfo, _T("FileDescription"));
+		groupInfo = DetermineItemVersionGroup(basicItemInfo, VersionInfoType::Description);
 		break;
 
 	case SortMode::FileVersion:
-		groupInfo = DetermineItemVersionGroup(basicItemInfo, _T("FileVersion"));
+		groupInfo = DetermineItemVersionGroup(basicItemInfo, VersionInfoType::FileVersion);
 		break;
 
 	case SortMode::ProductVersion:
-		groupInfo = DetermineItemVersionGroup(basicItemInfo, _T("ProductVersion"));
+		groupInfo = DetermineItemVersionGroup(basicItemInfo, VersionInfoType::ProductVersion);
 		break;
 
 	case SortMode::ShortcutTo:
@@ -440,16 +447,15 @@ std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemTotalS
 std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemTypeGroupVirtual(
 	const BasicItemInfo_t &itemInfo) const
 {
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo((LPTSTR) itemInfo.pidlComplete.get(), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_TYPENAME);
+	auto typeName = FileTypeNameCache::GetInstance().GetTypeName(
+		{ itemInfo.pidlComplete.get(), itemInfo.isFindDataValid ? &itemInfo.wfd : nullptr });
 
-	if (!res)
+	if (!typeName)
 	{
 		return std::nullopt;
 	}
 
-	return GroupInfo(shfi.szTypeName);
+	return GroupInfo(*typeName);
 }
 
 std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemDateGroup(
@@ -692,20 +698,16 @@ std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemOwnerG
 }
 
 std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemVersionGroup(
-	const BasicItemInfo_t &itemInfo, const TCHAR *szVersionType) const
+	const BasicItemInfo_t &itemInfo, VersionInfoType versionInfoType) const
 {
-	std::wstring fullFileName = itemInfo.getFullPath();
-
-	TCHAR szVersion[512];
-	BOOL bVersionInfoObtained = GetVersionInfoString(fullFileName.c_str(), szVersionType, szVersion,
-		static_cast<UINT>(std::size(szVersion)));
+	auto version = GetVersionInfoValue(itemInfo, versionInfoType);
 
-	if (!bVersionInfoObtained)
+	if (!version)
 	{
 		return std::nullopt;
 	}
 
-	return GroupInfo(szVersion);
+	return GroupInfo(*version);
 }
 
 std::optional<ShellBrowserImpl::GroupInfo> ShellBrowserImpl::DetermineItemCameraPropertyGroup(
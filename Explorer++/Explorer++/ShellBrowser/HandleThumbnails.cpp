@@ -6,6 +6,7 @@
 #include "ShellBrowserImpl.h"
 #include "ItemData.h"
 #include "ViewModes.h"
+#include "../Helper/ImageHelper.h"
 #include <wil/com.h>
 #include <thumbcache.h>
 #include <list>
@@ -13,6 +14,102 @@
 #define THUMBNAIL_TYPE_ICON 0
 #define THUMBNAIL_TYPE_EXTRACTED 1
 
+namespace
+{
+
+// Creating a thumbnail cache object is relatively expensive, so each worker thread creates a
+// single instance the first time it extracts a thumbnail and reuses it from then on. The object
+// belongs to the worker's apartment, which is why it's explicitly released (by
+// ShellBrowserImpl::ReleaseThreadThumbnailResources()) before the apartment is uninitialized.
+thread_local wil::com_ptr_nothrow<IThumbnailCache> g_threadThumbnailCache;
+
+// Converts the bitmap into a ThumbnailBitmap, premultiplying the alpha channel if necessary.
+std::optional<ThumbnailBitmap> SharedBitmapToThumbnailBitmap(ISharedBitmap *sharedBitmap)
+{
+	HBITMAP bitmap;
+	HRESULT hr = sharedBitmap->GetSharedBitmap(&bitmap);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	SIZE size;
+	hr = sharedBitmap->GetSize(&size);
+
+	if (FAILED(hr) || size.cx <= 0 || size.cy <= 0)
+	{
+		return std::nullopt;
+	}
+
+	WTS_ALPHATYPE alphaType;
+	hr = sharedBitmap->GetFormat(&alphaType);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	ThumbnailBitmap thumbnailBitmap;
+	thumbnailBitmap.width = size.cx;
+	thumbnailBitmap.height = size.cy;
+	thumbnailBitmap.pixels.resize(static_cast<size_t>(size.cx) * size.cy);
+
+	// A negative height results in the rows being returned top-down.
+	BITMAPINFO bitmapInfo;
+	ImageHelper::InitBitmapInfo(&bitmapInfo, sizeof(bitmapInfo), size.cx, -size.cy, 32);
+
+	wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+	int numLines = GetDIBits(hdc.get(), bitmap, 0, size.cy, thumbnailBitmap.pixels.data(),
+		&bitmapInfo, DIB_RGB_COLORS);
+
+	if (numLines != size.cy)
+	{
+		return std::nullopt;
+	}
+
+	for (auto &pixel : thumbnailBitmap.pixels)
+	{
+		if (alphaType != WTSAT_ARGB)
+		{
+			// The alpha channel isn't used, so the pixel is fully opaque.
+			pixel |= 0xFF000000;
+			continue;
+		}
+
+		uint32_t alpha = pixel >> 24;
+		auto premultiply = [alpha](uint32_t channel) { return ((channel * alpha) + 127) / 255; };
+
+		pixel = (alpha << 24) | (premultiply((pixel >> 16) & 0xFF) << 16)
+			| (premultiply((pixel >> 8) & 0xFF) << 8) | premultiply(pixel & 0xFF);
+	}
+
+	return thumbnailBitmap;
+}
+
+wil::unique_hbitmap ThumbnailBitmapToHBitmap(const ThumbnailBitmap &thumbnailBitmap)
+{
+	BITMAPINFO bitmapInfo;
+	ImageHelper::InitBitmapInfo(&bitmapInfo, sizeof(bitmapInfo), thumbnailBitmap.width,
+		-static_cast<LONG>(thumbnailBitmap.height), 32);
+
+	void *bits;
+	wil::unique_hbitmap bitmap(
+		CreateDIBSection(nullptr, &bitmapInfo, DIB_RGB_COLORS, &bits, nullptr, 0));
+
+	if (!bitmap)
+	{
+		return nullptr;
+	}
+
+	memcpy(bits, thumbnailBitmap.pixels.data(),
+		thumbnailBitmap.pixels.size() * sizeof(uint32_t));
+
+	return bitmap;
+}
+
+}
+
 void ShellBrowserImpl::SetupThumbnailsView(int shellImageListType)
 {
 	// This will be used in cases where the thumbnail hasn't been retrieved yet and the standard
@@ -31,7 +128,7 @@ void ShellBrowserImpl::SetupThumbnailsView(int shellImageListType)
 
 void ShellBrowserImpl::RemoveThumbnailsView()
 {
-	m_thumbnailThreadPool.clear_queue();
+	CancelBackgroundTasks(BackgroundTaskType::Thumbnail);
 	m_thumbnailResults.clear();
 
 	InvalidateAllItemImages();
@@ -44,6 +141,17 @@ void ShellBrowserImpl::RemoveThumbnailsView()
 
 void ShellBrowserImpl::InvalidateAllItemImages()
 {
+	if (m_ownerData)
+	{
+		for (auto &[internalIndex, itemInfo] : m_itemInfoMap)
+		{
+			itemInfo.imageIndex.reset();
+		}
+
+		InvalidateRect(m_hListView, nullptr, TRUE);
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -62,15 +170,26 @@ void ShellBrowserImpl::QueueThumbnailTask(int internalIndex)
 	int thumbnailResultID = m_thumbnailResultIDCounter++;
 
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
-
-	auto result = m_thumbnailThreadPool.push(
-		[listView = m_hListView, thumbnailResultID, internalIndex, basicItemInfo,
-			thumbnailSize = m_thumbnailItemWidth](int id) -> std::optional<ThumbnailResult_t>
+	std::wstring path = m_itemInfoMap.at(internalIndex).parsingName;
+	auto lastWriteTime =
+		GetThumbnailLastWriteTime(basicItemInfo.wfd, basicItemInfo.isFindDataValid);
+
+	auto result = m_taskScheduler->QueueTask(this,
+		GetBackgroundTaskId(BackgroundTaskType::Thumbnail, internalIndex),
+		PAINTED_ITEM_TASK_PRIORITY,
+		[listView = m_hListView, thumbnailResultID, internalIndex, basicItemInfo, path,
+			lastWriteTime, thumbnailSize = m_thumbnailItemWidth,
+			thumbnailCache = m_thumbnailCache]() -> std::optional<ThumbnailResult_t>
 		{
-			UNREFERENCED_PARAMETER(id);
+			auto thumbnail = GetThumbnail(basicItemInfo.pidlComplete.get(), path, lastWriteTime,
+				thumbnailSize, thumbnailCache);
+
+			if (!thumbnail)
+			{
+				return std::nullopt;
+			}
 
-			auto bitmap = GetThumbnail(basicItemInfo.pidlComplete.get(), thumbnailSize,
-				WTS_EXTRACT | WTS_SCALETOREQUESTEDSIZE);
+			auto bitmap = ThumbnailBitmapToHBitmap(*thumbnail);
 
 			if (!bitmap)
 			{
@@ -86,13 +205,37 @@ void ShellBrowserImpl::QueueThumbnailTask(int internalIndex)
 			return result;
 		});
 
-	m_thumbnailResults.insert({ thumbnailResultID, std::move(result) });
+	if (!result)
+	{
+		// A thumbnail for this item has already been requested.
+		return;
+	}
+
+	m_thumbnailResults.insert({ thumbnailResultID, { internalIndex, std::move(*result) } });
 }
 
-std::optional<int> ShellBrowserImpl::GetCachedThumbnailIndex(const ItemInfo_t &itemInfo)
+// This is called on the UI thread, while the listview is being painted, so only the in-memory cache
+// is checked. If the thumbnail isn't there, it will be retrieved by QueueThumbnailTask().
+std::optional<int> ShellBrowserImpl::GetCachedThumbnailIndex(int internalIndex)
 {
-	auto bitmap = GetThumbnail(itemInfo.pidlComplete.get(), m_thumbnailItemWidth,
-		WTS_INCACHEONLY | WTS_SCALETOREQUESTEDSIZE);
+	const auto &itemInfo = m_itemInfoMap.at(internalIndex);
+	auto lastWriteTime = GetThumbnailLastWriteTime(GetItemFindData(internalIndex),
+		m_itemStore.IsFindDataValid(internalIndex));
+
+	if (!lastWriteTime || itemInfo.parsingName.empty())
+	{
+		return std::nullopt;
+	}
+
+	auto thumbnail =
+		m_thumbnailCache->GetFromMemory(itemInfo.parsingName, *lastWriteTime, m_thumbnailItemWidth);
+
+	if (!thumbnail)
+	{
+		return std::nullopt;
+	}
+
+	auto bitmap = ThumbnailBitmapToHBitmap(*thumbnail);
 
 	if (!bitmap)
 	{
@@ -102,47 +245,96 @@ std::optional<int> ShellBrowserImpl::GetCachedThumbnailIndex(const ItemInfo_t &i
 	return GetExtractedThumbnail(bitmap.get());
 }
 
-wil::unique_hbitmap ShellBrowserImpl::GetThumbnail(PIDLIST_ABSOLUTE pidl, UINT thumbnailSize,
-	WTS_FLAGS flags)
+// Thumbnails are keyed by the item's path and last modified time, so that a thumbnail will never be
+// reused once an item has changed. Items that don't have both are always extracted.
+std::shared_ptr<const ThumbnailBitmap> ShellBrowserImpl::GetThumbnail(PCIDLIST_ABSOLUTE pidl,
+	const std::wstring &path, std::optional<uint64_t> lastWriteTime, UINT thumbnailSize,
+	ThumbnailCache *thumbnailCache)
 {
-	wil::com_ptr_nothrow<IShellItem> shellItem;
-	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
+	bool cacheable = lastWriteTime && !path.empty();
 
-	if (FAILED(hr))
+	if (cacheable)
+	{
+		auto cachedThumbnail = thumbnailCache->Get(path, *lastWriteTime, thumbnailSize);
+
+		if (cachedThumbnail)
+		{
+			return cachedThumbnail;
+		}
+	}
+
+	auto thumbnail = ExtractThumbnail(pidl, thumbnailSize);
+
+	if (!thumbnail)
 	{
 		return nullptr;
 	}
 
-	wil::com_ptr_nothrow<IThumbnailCache> thumbnailCache;
-	hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER,
-		IID_PPV_ARGS(&thumbnailCache));
+	if (!cacheable)
+	{
+		return std::make_shared<const ThumbnailBitmap>(std::move(*thumbnail));
+	}
+
+	return thumbnailCache->Insert(path, *lastWriteTime, thumbnailSize, std::move(*thumbnail));
+}
+
+std::optional<ThumbnailBitmap> ShellBrowserImpl::ExtractThumbnail(PCIDLIST_ABSOLUTE pidl,
+	UINT thumbnailSize)
+{
+	wil::com_ptr_nothrow<IShellItem> shellItem;
+	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
 
 	if (FAILED(hr))
 	{
-		return nullptr;
+		return std::nullopt;
+	}
+
+	if (!g_threadThumbnailCache)
+	{
+		hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(&g_threadThumbnailCache));
+
+		if (FAILED(hr))
+		{
+			return std::nullopt;
+		}
 	}
 
 	wil::com_ptr_nothrow<ISharedBitmap> sharedBitmap;
-	hr = thumbnailCache->GetThumbnail(shellItem.get(), thumbnailSize, flags, &sharedBitmap, nullptr,
-		nullptr);
+	hr = g_threadThumbnailCache->GetThumbnail(shellItem.get(), thumbnailSize,
+		WTS_EXTRACT | WTS_SCALETOREQUESTEDSIZE, &sharedBitmap, nullptr, nullptr);
 
 	if (FAILED(hr))
 	{
-		return nullptr;
+		return std::nullopt;
 	}
 
-	HBITMAP bitmap;
-	hr = sharedBitmap->GetSharedBitmap(&bitmap);
+	return SharedBitmapToThumbnailBitmap(sharedBitmap.get());
+}
 
-	if (FAILED(hr))
+std::optional<uint64_t> ShellBrowserImpl::GetThumbnailLastWriteTime(
+	const WIN32_FIND_DATA &findData, bool isFindDataValid)
+{
+	if (!isFindDataValid)
 	{
-		return nullptr;
+		return std::nullopt;
+	}
+
+	ULARGE_INTEGER lastWriteTime;
+	lastWriteTime.LowPart = findData.ftLastWriteTime.dwLowDateTime;
+	lastWriteTime.HighPart = findData.ftLastWriteTime.dwHighDateTime;
+
+	if (lastWriteTime.QuadPart == 0)
+	{
+		return std::nullopt;
 	}
 
-	// Note that the bitmap is copied here, since it's owned by the ISharedBitmap instance. As soon
-	// as that instance is destroyed, the bitmap will be destroyed.
-	return wil::unique_hbitmap(
-		reinterpret_cast<HBITMAP>(CopyImage(bitmap, IMAGE_BITMAP, 0, 0, LR_DEFAULTCOLOR)));
+	return lastWriteTime.QuadPart;
+}
+
+void ShellBrowserImpl::ReleaseThreadThumbnailResources()
+{
+	g_threadThumbnailCache.reset();
 }
 
 void ShellBrowserImpl::ProcessThumbnailResult(int thumbnailResultId)
@@ -159,7 +351,8 @@ void ShellBrowserImpl::ProcessThumbnailResult(int thumbnailResultId)
 		return;
 	}
 
-	auto result = itr->second.get();
+	auto result = itr->second.result.get();
+	m_thumbnailResults.erase(itr);
 
 	if (!result)
 	{
@@ -176,6 +369,13 @@ void ShellBrowserImpl::ProcessThumbnailResult(int thumbnailResultId)
 		return;
 	}
 
+	if (m_ownerData)
+	{
+		m_itemInfoMap.at(result->itemInternalIndex).imageIndex = imageIndex;
+		ListView_RedrawItems(m_hListView, *index, *index);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE;
 	lvItem.iItem = *index;
@@ -279,10 +479,13 @@ void ShellBrowserImpl::DrawThumbnailInternal(HDC hdcBacking, HBITMAP hThumbnailB
 	GetObject(hThumbnailBitmap, sizeof(BITMAP), &bm);
 
 	/* Now, draw the thumbnail bitmap (in its centered position)
-	directly on top of the new bitmap. */
-	BitBlt(hdcBacking, (m_thumbnailItemWidth - bm.bmWidth) / 2,
-		(m_thumbnailItemHeight - bm.bmHeight) / 2, m_thumbnailItemWidth, m_thumbnailItemHeight,
-		hdcThumbnail, 0, 0, SRCCOPY);
+	directly on top of the new bitmap. The thumbnail uses
+	premultiplied alpha, so any transparent areas will show
+	the listview background. */
+	BLENDFUNCTION blendFunction = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+	AlphaBlend(hdcBacking, (m_thumbnailItemWidth - bm.bmWidth) / 2,
+		(m_thumbnailItemHeight - bm.bmHeight) / 2, bm.bmWidth, bm.bmHeight, hdcThumbnail, 0, 0,
+		bm.bmWidth, bm.bmHeight, blendFunction);
 
 	SelectObject(hdcThumbnail, hThumbnailBitmapOld);
 	DeleteDC(hdcThumbnail);
@@ -6,7 +6,11 @@
 
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include <wil/com.h>
 #include <wil/resource.h>
+#include <memory>
+
+struct ItemMetadata;
 
 struct BasicItemInfo_t
 {
@@ -35,6 +39,17 @@ struct BasicItemInfo_t
 	TCHAR szDisplayName[MAX_PATH];
 	bool isRoot;
 
+	// The folder that contains this item. This is optional and can be set by code that retrieves
+	// details for a number of items in the same folder, so that the folder doesn't have to be
+	// bound to separately for each item. As the folder can only be used on the thread it was
+	// retrieved on, this isn't copied.
+	wil::com_ptr_nothrow<IShellFolder2> parentFolder;
+
+	// The version, media and owner metadata for this item. This is also optional and is set when
+	// several columns that are retrieved from this metadata are requested at the same time. Since
+	// the metadata only reflects the item at the time it was read, this isn't copied either.
+	std::shared_ptr<const ItemMetadata> metadata;
+
 	std::wstring getFullPath() const
 	{
 		std::wstring fullPath;
@@ -0,0 +1,232 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemStore.h"
+
+ItemStore::Index ItemStore::Add(const ItemDetails &details)
+{
+	Index index = m_valid.size();
+
+	m_nameOffsets.push_back(0);
+	m_nameLengths.push_back(0);
+	m_findDataValid.push_back(details.isFindDataValid);
+	m_sizes.push_back(details.size);
+	m_datesCreated.push_back(details.dateCreated);
+	m_datesModified.push_back(details.dateModified);
+	m_datesAccessed.push_back(details.dateAccessed);
+	m_attributes.push_back(details.attributes);
+	m_valid.push_back(true);
+
+	SetName(index, details.name);
+	SetFileName(index, details);
+
+	m_numItems++;
+
+	return index;
+}
+
+void ItemStore::Update(Index index, const ItemDetails &details)
+{
+	CHECK(IsValid(index));
+
+	m_findDataValid[index] = details.isFindDataValid;
+	m_sizes[index] = details.size;
+	m_datesCreated[index] = details.dateCreated;
+	m_datesModified[index] = details.dateModified;
+	m_datesAccessed[index] = details.dateAccessed;
+	m_attributes[index] = details.attributes;
+
+	if (details.name != GetName(index))
+	{
+		ReleaseName(index);
+		SetName(index, details.name);
+		CompactNamesIfNecessary();
+	}
+
+	SetFileName(index, details);
+}
+
+void ItemStore::UpdateName(Index index, std::wstring_view name)
+{
+	CHECK(IsValid(index));
+
+	if (name == GetName(index))
+	{
+		return;
+	}
+
+	if (!m_fileNames.contains(index))
+	{
+		m_fileNames[index] = GetName(index);
+	}
+	else if (m_fileNames[index] == name)
+	{
+		m_fileNames.erase(index);
+	}
+
+	ReleaseName(index);
+	SetName(index, name);
+	CompactNamesIfNecessary();
+}
+
+void ItemStore::Remove(Index index)
+{
+	CHECK(IsValid(index));
+
+	ReleaseName(index);
+	m_fileNames.erase(index);
+	m_valid[index] = false;
+	m_numItems--;
+
+	CompactNamesIfNecessary();
+}
+
+void ItemStore::Clear()
+{
+	m_nameBuffer.clear();
+	m_nameOffsets.clear();
+	m_nameLengths.clear();
+	m_fileNames.clear();
+	m_findDataValid.clear();
+	m_sizes.clear();
+	m_datesCreated.clear();
+	m_datesModified.clear();
+	m_datesAccessed.clear();
+	m_attributes.clear();
+	m_valid.clear();
+
+	m_numItems = 0;
+	m_unusedNameBufferSize = 0;
+}
+
+bool ItemStore::IsValid(Index index) const
+{
+	return index < m_valid.size() && m_valid[index];
+}
+
+size_t ItemStore::GetIndexCount() const
+{
+	return m_valid.size();
+}
+
+size_t ItemStore::GetNumItems() const
+{
+	return m_numItems;
+}
+
+std::wstring_view ItemStore::GetName(Index index) const
+{
+	DCHECK(IsValid(index));
+	return { m_nameBuffer.data() + m_nameOffsets[index], m_nameLengths[index] };
+}
+
+std::wstring_view ItemStore::GetFileName(Index index) const
+{
+	DCHECK(IsValid(index));
+
+	if (auto itr = m_fileNames.find(index); itr != m_fileNames.end())
+	{
+		return itr->second;
+	}
+
+	return GetName(index);
+}
+
+bool ItemStore::IsFindDataValid(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_findDataValid[index];
+}
+
+uint64_t ItemStore::GetSize(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_sizes[index];
+}
+
+uint64_t ItemStore::GetDateCreated(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_datesCreated[index];
+}
+
+uint64_t ItemStore::GetDateModified(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_datesModified[index];
+}
+
+uint64_t ItemStore::GetDateAccessed(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_datesAccessed[index];
+}
+
+uint32_t ItemStore::GetAttributes(Index index) const
+{
+	DCHECK(IsValid(index));
+	return m_attributes[index];
+}
+
+size_t ItemStore::GetUnusedNameBufferSize() const
+{
+	return m_unusedNameBufferSize;
+}
+
+void ItemStore::SetName(Index index, std::wstring_view name)
+{
+	m_nameOffsets[index] = static_cast<uint32_t>(m_nameBuffer.size());
+	m_nameLengths[index] = static_cast<uint32_t>(name.size());
+	m_nameBuffer.insert(m_nameBuffer.end(), name.begin(), name.end());
+	m_nameBuffer.push_back(L'\0');
+}
+
+void ItemStore::SetFileName(Index index, const ItemDetails &details)
+{
+	if (details.fileName.empty() || details.fileName == details.name)
+	{
+		m_fileNames.erase(index);
+		return;
+	}
+
+	m_fileNames[index] = details.fileName;
+}
+
+void ItemStore::ReleaseName(Index index)
+{
+	m_unusedNameBufferSize += m_nameLengths[index] + 1;
+	m_nameLengths[index] = 0;
+}
+
+// Names are only ever appended to the buffer, so renaming or removing items leaves gaps behind.
+// Once the gaps make up the majority of the buffer, the remaining names are copied into a new
+// buffer.
+void ItemStore::CompactNamesIfNecessary()
+{
+	if (m_unusedNameBufferSize < COMPACTION_THRESHOLD
+		|| m_unusedNameBufferSize < m_nameBuffer.size() / 2)
+	{
+		return;
+	}
+
+	std::vector<wchar_t> compactedBuffer;
+	compactedBuffer.reserve(m_nameBuffer.size() - m_unusedNameBufferSize);
+
+	for (Index index = 0; index < m_valid.size(); index++)
+	{
+		if (!m_valid[index])
+		{
+			m_nameOffsets[index] = 0;
+			continue;
+		}
+
+		auto start = m_nameBuffer.begin() + m_nameOffsets[index];
+		m_nameOffsets[index] = static_cast<uint32_t>(compactedBuffer.size());
+		compactedBuffer.insert(compactedBuffer.end(), start, start + m_nameLengths[index] + 1);
+	}
+
+	m_nameBuffer = std::move(compactedBuffer);
+	m_unusedNameBufferSize = 0;
+}
@@ -0,0 +1,108 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Stores the basic details of the items in a folder. Rather than allocating a separate structure
+// for each item, each detail is held in its own contiguous array, with every item's name stored in
+// a single shared character buffer. That keeps the per-item overhead small and means that
+// operations like sorting or filtering only touch the memory for the details they actually use.
+//
+// This is the only place the names and file details of the items are held. Other structures that
+// need those details should look them up here, using the item's index.
+//
+// Items are addressed by the index returned from Add(). Indexes are never reused while the store
+// is alive, so an index remains valid (or is reported as removed) until Clear() is called.
+class ItemStore : private boost::noncopyable
+{
+public:
+	using Index = size_t;
+
+	struct ItemDetails
+	{
+		std::wstring_view name;
+
+		// The name of the item in the filesystem. This is almost always the same as the name
+		// above, so it only needs to be set when it differs.
+		std::wstring_view fileName;
+
+		// Indicates whether the values below were retrieved from the item. If they weren't, only
+		// the directory attribute is meaningful.
+		bool isFindDataValid = false;
+
+		uint64_t size = 0;
+		uint64_t dateCreated = 0;
+		uint64_t dateModified = 0;
+		uint64_t dateAccessed = 0;
+		uint32_t attributes = 0;
+	};
+
+	Index Add(const ItemDetails &details);
+	void Update(Index index, const ItemDetails &details);
+
+	// Changes the name of an item, without changing its file name.
+	void UpdateName(Index index, std::wstring_view name);
+
+	void Remove(Index index);
+	void Clear();
+
+	bool IsValid(Index index) const;
+
+	// Returns the total number of indexes that have been handed out, including those for items that
+	// have since been removed.
+	size_t GetIndexCount() const;
+
+	size_t GetNumItems() const;
+
+	// Note that the views returned here are only valid until the next call to a non-const method.
+	// Each name is stored with a trailing null character, so the data() pointer of a view can be
+	// passed to functions that expect a null-terminated string.
+	std::wstring_view GetName(Index index) const;
+	std::wstring_view GetFileName(Index index) const;
+
+	bool IsFindDataValid(Index index) const;
+	uint64_t GetSize(Index index) const;
+	uint64_t GetDateCreated(Index index) const;
+	uint64_t GetDateModified(Index index) const;
+	uint64_t GetDateAccessed(Index index) const;
+	uint32_t GetAttributes(Index index) const;
+
+	// Returns the number of characters in the name buffer that are no longer referenced by any
+	// item.
+	size_t GetUnusedNameBufferSize() const;
+
+private:
+	// The name buffer won't be compacted until at least this many characters are unused.
+	static constexpr size_t COMPACTION_THRESHOLD = 64 * 1024;
+
+	void SetName(Index index, std::wstring_view name);
+	void SetFileName(Index index, const ItemDetails &details);
+	void ReleaseName(Index index);
+	void CompactNamesIfNecessary();
+
+	std::vector<wchar_t> m_nameBuffer;
+	std::vector<uint32_t> m_nameOffsets;
+	std::vector<uint32_t> m_nameLengths;
+
+	// Only contains entries for the items whose file name differs from their name.
+	std::unordered_map<Index, std::wstring> m_fileNames;
+
+	std::vector<bool> m_findDataValid;
+	std::vector<uint64_t> m_sizes;
+	std::vector<uint64_t> m_datesCreated;
+	std::vector<uint64_t> m_datesModified;
+	std::vector<uint64_t> m_datesAccessed;
+	std::vector<uint32_t> m_attributes;
+	std::vector<bool> m_valid;
+
+	size_t m_numItems = 0;
+	size_t m_unusedNameBufferSize = 0;
+};
@@ -7,7 +7,7 @@
 #include "ColorRuleModel.h"
 #include "ColorRuleModelFactory.h"
 #include "Config.h"
-#include "IconFetcher.h"
+#include "IconFetcherImpl.h"
 #include "ItemData.h"
 #include "ItemNameEditControl.h"
 #include "MainResource.h"
@@ -122,10 +122,18 @@ LRESULT ShellBrowserImpl::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPAR
 		ProcessColumnResult(static_cast<int>(wParam));
 		break;
 
+	case WM_APP_COLUMN_REQUESTS_PENDING:
+		QueuePendingColumnRequests();
+		break;
+
 	case WM_APP_THUMBNAIL_RESULT_READY:
 		ProcessThumbnailResult(static_cast<int>(wParam));
 		break;
 
+	case WM_APP_ICON_RESULT_READY:
+		ProcessIconResult(static_cast<int>(wParam));
+		break;
+
 	case WM_APP_INFO_TIP_READY:
 		ProcessInfoTipResult(static_cast<int>(wParam));
 		break;
@@ -133,6 +141,10 @@ LRESULT ShellBrowserImpl::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPAR
 	case WM_APP_PENDING_TASK_AVAILABLE:
 		OnPendingTaskAvailableMessage();
 		break;
+
+	case WM_APP_ENUMERATION_BATCH_READY:
+		ProcessEnumerationBatches(static_cast<int>(wParam));
+		break;
 	}
 
 	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
@@ -173,6 +185,13 @@ LRESULT ShellBrowserImpl::ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam
 				OnListViewItemChanged(reinterpret_cast<NMLISTVIEW *>(lParam));
 				break;
 
+			case LVN_ODSTATECHANGED:
+				OnOwnerDataStateChanged(reinterpret_cast<NMLVODSTATECHANGE *>(lParam));
+				break;
+
+			case LVN_ODFINDITEM:
+				return OnOwnerDataFindItem(reinterpret_cast<NMLVFINDITEM *>(lParam));
+
 			case LVN_KEYDOWN:
 				OnListViewKeyDown(reinterpret_cast<NMLVKEYDOWN *>(lParam));
 				break;
@@ -187,6 +206,10 @@ LRESULT ShellBrowserImpl::ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam
 			case LVN_ENDLABELEDIT:
 				return OnListViewEndLabelEdit(reinterpret_cast<NMLVDISPINFO *>(lParam));
 
+			case LVN_ENDSCROLL:
+				UpdateTaskPriorities();
+				break;
+
 			case LVN_DELETEALLITEMS:
 				// Respond to the notification in order to speed up calls to ListView_DeleteAllItems
 				// per http://www.verycomputer.com/5_0c959e6a4fd713e2_1.htm
@@ -271,9 +294,10 @@ void ShellBrowserImpl::OnListViewMButtonUp(const POINT *pt, UINT keysDown)
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = GetItemByIndex(m_middleButtonItem);
+	int internalIndex = GetItemInternalIndex(m_middleButtonItem);
+	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
 
-	if (!WI_IsAnyFlagSet(itemInfo.wfd.dwFileAttributes,
+	if (!WI_IsAnyFlagSet(m_itemStore.GetAttributes(internalIndex),
 			FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_ARCHIVE))
 	{
 		return;
@@ -352,6 +376,12 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 	pnmv = (NMLVDISPINFO *) lParam;
 	plvItem = &pnmv->item;
 
+	if (m_ownerData)
+	{
+		OnOwnerDataGetDisplayInfo(pnmv);
+		return;
+	}
+
 	int internalIndex = static_cast<int>(plvItem->lParam);
 
 	/* Construct an image here using the items
@@ -366,8 +396,7 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 	if (IsThumbnailsViewMode(m_folderSettings.viewMode)
 		&& (plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedThumbnailIndex = GetCachedThumbnailIndex(itemInfo);
+		auto cachedThumbnailIndex = GetCachedThumbnailIndex(internalIndex);
 
 		if (cachedThumbnailIndex)
 		{
@@ -376,12 +405,11 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 		else
 		{
 			plvItem->iImage = GetIconThumbnail(internalIndex);
+			QueueThumbnailTask(internalIndex);
 		}
 
 		plvItem->mask |= LVIF_DI_SETITEM;
 
-		QueueThumbnailTask(internalIndex);
-
 		return;
 	}
 
@@ -390,13 +418,23 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 		auto columnType = GetColumnTypeByIndex(plvItem->iSubItem);
 		CHECK(columnType);
 
-		QueueColumnTask(internalIndex, *columnType);
+		const std::wstring *text =
+			m_columnTextCache.Get(GetColumnTextKey(internalIndex, *columnType));
+
+		if (text)
+		{
+			StringCchCopy(plvItem->pszText, plvItem->cchTextMax, text->c_str());
+			plvItem->mask |= LVIF_DI_SETITEM;
+		}
+		else
+		{
+			QueueColumnTask(internalIndex, *columnType);
+		}
 	}
 
 	if ((plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedIconIndex = GetCachedIconIndex(itemInfo);
+		auto cachedIconIndex = GetCachedIconIndex(internalIndex);
 
 		if (cachedIconIndex)
 		{
@@ -419,8 +457,7 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 		}
 		else
 		{
-			if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY)
+			if (IsItemFolder(internalIndex))
 			{
 				plvItem->iImage = m_iFolderIcon;
 			}
@@ -430,16 +467,15 @@ void ShellBrowserImpl::OnListViewGetDisplayInfo(LPARAM lParam)
 			}
 		}
 
-		m_iconFetcher->QueueIconTask(itemInfo.pidlComplete.get(),
-			[this, internalIndex](int iconIndex) { ProcessIconResult(internalIndex, iconIndex); });
+		QueueIconTask(internalIndex);
 	}
 
 	plvItem->mask |= LVIF_DI_SETITEM;
 }
 
-std::optional<int> ShellBrowserImpl::GetCachedIconIndex(const ItemInfo_t &itemInfo)
+std::optional<int> ShellBrowserImpl::GetCachedIconIndex(int internalIndex)
 {
-	auto cachedItr = m_cachedIcons->findByPath(itemInfo.parsingName);
+	auto cachedItr = m_cachedIcons->findByPath(m_itemInfoMap.at(internalIndex).parsingName);
 
 	if (cachedItr == m_cachedIcons->end())
 	{
@@ -449,6 +485,67 @@ std::optional<int> ShellBrowserImpl::GetCachedIconIndex(const ItemInfo_t &itemIn
 	return cachedItr->iconIndex;
 }
 
+void ShellBrowserImpl::QueueIconTask(int internalIndex)
+{
+	int iconResultID = m_iconResultIDCounter++;
+
+	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+
+	auto result = m_taskScheduler->QueueTask(this,
+		GetBackgroundTaskId(BackgroundTaskType::Icon, internalIndex), PAINTED_ITEM_TASK_PRIORITY,
+		[listView = m_hListView, iconResultID, basicItemInfo]() -> std::optional<int>
+		{
+			auto iconIndex = IconFetcherImpl::FindIconAsync(basicItemInfo.pidlComplete.get());
+
+			if (!iconIndex)
+			{
+				return std::nullopt;
+			}
+
+			PostMessage(listView, WM_APP_ICON_RESULT_READY, iconResultID, 0);
+
+			return iconIndex;
+		});
+
+	if (!result)
+	{
+		// An icon for this item has already been requested.
+		return;
+	}
+
+	m_iconResults.insert({ iconResultID, { internalIndex, std::move(*result) } });
+}
+
+void ShellBrowserImpl::ProcessIconResult(int iconResultId)
+{
+	auto itr = m_iconResults.find(iconResultId);
+
+	if (itr == m_iconResults.end())
+	{
+		return;
+	}
+
+	int internalIndex = itr->second.itemInternalIndex;
+	auto iconIndex = itr->second.result.get();
+	m_iconResults.erase(itr);
+
+	if (!iconIndex)
+	{
+		return;
+	}
+
+	auto itemInfoItr = m_itemInfoMap.find(internalIndex);
+
+	if (itemInfoItr == m_itemInfoMap.end())
+	{
+		return;
+	}
+
+	m_cachedIcons->addOrUpdateFileIcon(itemInfoItr->second.parsingName, *iconIndex);
+
+	ProcessIconResult(internalIndex, *iconIndex);
+}
+
 void ShellBrowserImpl::ProcessIconResult(int internalIndex, int iconIndex)
 {
 	auto index = LocateItemByInternalIndex(internalIndex);
@@ -458,6 +555,15 @@ void ShellBrowserImpl::ProcessIconResult(int internalIndex, int iconIndex)
 		return;
 	}
 
+	if (m_ownerData)
+	{
+		auto &itemInfo = m_itemInfoMap.at(internalIndex);
+		itemInfo.imageIndex = iconIndex;
+		itemInfo.overlayIndex = iconIndex >> 24;
+		ListView_RedrawItems(m_hListView, *index, *index);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE | LVIF_STATE;
 	lvItem.iItem = *index;
@@ -483,6 +589,12 @@ LRESULT ShellBrowserImpl::OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip)
 
 BOOL ShellBrowserImpl::OnListViewGetEmptyMarkup(NMLVEMPTYMARKUP *emptyMarkup)
 {
+	if (m_enumerationResults)
+	{
+		// The folder is still being enumerated, so it's not known yet whether it's empty.
+		return FALSE;
+	}
+
 	emptyMarkup->dwFlags = EMF_CENTERED;
 
 	auto folderEmptyText =
@@ -500,12 +612,11 @@ void ShellBrowserImpl::QueueInfoTipTask(int internalIndex, const std::wstring &e
 	Config configCopy = *m_config;
 	bool virtualFolder = InVirtualFolder();
 
-	auto result = m_infoTipsThreadPool.push(
+	auto result = m_taskScheduler->QueueTask(this,
+		GetBackgroundTaskId(BackgroundTaskType::InfoTip, internalIndex), INFO_TIP_TASK_PRIORITY,
 		[this, infoTipResultId, internalIndex, basicItemInfo, configCopy, virtualFolder,
-			existingInfoTip](int id)
+			existingInfoTip]()
 		{
-			UNREFERENCED_PARAMETER(id);
-
 			auto result = GetInfoTipAsync(m_hListView, infoTipResultId, internalIndex,
 				basicItemInfo, configCopy, m_resourceInstance, virtualFolder);
 
@@ -521,7 +632,12 @@ void ShellBrowserImpl::QueueInfoTipTask(int internalIndex, const std::wstring &e
 			return result;
 		});
 
-	m_infoTipResults.insert({ infoTipResultId, std::move(result) });
+	if (!result)
+	{
+		return;
+	}
+
+	m_infoTipResults.insert({ infoTipResultId, std::move(*result) });
 }
 
 std::optional<ShellBrowserImpl::InfoTipResult> ShellBrowserImpl::GetInfoTipAsync(HWND listView,
@@ -626,6 +742,31 @@ void ShellBrowserImpl::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		return;
 	}
 
+	if (m_ownerData)
+	{
+		bool previouslySelected = WI_IsFlagSet(changeData->uOldState, LVIS_SELECTED);
+		bool currentlySelected = WI_IsFlagSet(changeData->uNewState, LVIS_SELECTED);
+
+		if (previouslySelected == currentlySelected)
+		{
+			return;
+		}
+
+		// An item of -1 indicates that the state of all items has changed (e.g. because all items
+		// have been selected or deselected).
+		if (changeData->iItem == -1)
+		{
+			RecalculateSelectionInfo();
+		}
+		else
+		{
+			UpdateFileSelectionInfo(GetItemInternalIndex(changeData->iItem), currentlySelected);
+		}
+
+		listViewSelectionChanged.m_signal();
+		return;
+	}
+
 	if (m_config->checkBoxSelection.get() && (LVIS_STATEIMAGEMASK & changeData->uNewState) != 0)
 	{
 		bool checked = ((changeData->uNewState & LVIS_STATEIMAGEMASK) >> 12) == 2;
@@ -662,11 +803,8 @@ void ShellBrowserImpl::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 	ULARGE_INTEGER ulFileSize;
 	BOOL isFolder;
 
-	isFolder = (m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		== FILE_ATTRIBUTE_DIRECTORY;
-
-	ulFileSize.LowPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeHigh;
+	isFolder = IsItemFolder(internalIndex);
+	ulFileSize.QuadPart = m_itemStore.GetSize(internalIndex);
 
 	if (selected)
 	{
@@ -780,6 +918,11 @@ ShellBrowserImpl::ItemInfo_t &ShellBrowserImpl::GetItemByIndex(int index)
 
 int ShellBrowserImpl::GetItemInternalIndex(int item) const
 {
+	if (m_ownerData)
+	{
+		return m_ownerDataItems.at(item);
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_PARAM;
 	lvItem.iItem = item;
@@ -792,11 +935,17 @@ int ShellBrowserImpl::GetItemInternalIndex(int item) const
 
 void ShellBrowserImpl::MarkItemAsCut(int item, bool cut)
 {
-	const auto &itemInfo = GetItemByIndex(item);
-
 	// If the file is hidden, prevent changes to its visibility state.
-	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	if (WI_IsFlagSet(m_itemStore.GetAttributes(GetItemInternalIndex(item)),
+			FILE_ATTRIBUTE_HIDDEN))
+	{
+		return;
+	}
+
+	if (m_ownerData)
 	{
+		GetItemByIndex(item).cut = cut;
+		ListView_RedrawItems(m_hListView, item, item);
 		return;
 	}
 
@@ -990,8 +1139,9 @@ void ShellBrowserImpl::SetFileAttributesForSelection()
 	{
 		NSetFileAttributesDialogExternal::SetFileAttributesInfo sfai;
 
-		const ItemInfo_t &item = GetItemByIndex(index);
-		sfai.wfd = item.wfd;
+		int internalIndex = GetItemInternalIndex(index);
+		const ItemInfo_t &item = m_itemInfoMap.at(internalIndex);
+		sfai.wfd = GetItemFindData(internalIndex);
 		StringCchCopy(sfai.szFullFileName, std::size(sfai.szFullFileName),
 			item.parsingName.c_str());
 
@@ -1119,7 +1269,9 @@ void ShellBrowserImpl::AutoSizeColumns()
 
 BOOL ShellBrowserImpl::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 {
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
+	const auto &item = m_itemInfoMap.at(internalIndex);
+	bool isFolder = IsItemFolder(internalIndex);
 
 	SFGAOF attributes = SFGAO_CANRENAME;
 	HRESULT hr = GetItemAttributes(item.pidlComplete.get(), &attributes);
@@ -1141,7 +1293,7 @@ BOOL ShellBrowserImpl::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	// - Extensions are shown in Explorer, but hidden in Explorer++ (since the editing name would
 	//   contain an extension). Note that this case is handled when editing is finished - if
 	//   extensions are hidden, the extension will be manually re-added when renaming an item.
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!isFolder)
 	{
 		std::wstring displayName = GetItemDisplayName(dispInfo->item.iItem);
 
@@ -1188,8 +1340,7 @@ BOOL ShellBrowserImpl::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 		SetWindowText(editControl, item.editingName.c_str());
 	}
 
-	ItemNameEditControl::CreateNew(editControl, m_acceleratorManager,
-		WI_IsFlagClear(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+	ItemNameEditControl::CreateNew(editControl, m_acceleratorManager, !isFolder);
 
 	return FALSE;
 }
@@ -1209,16 +1360,20 @@ BOOL ShellBrowserImpl::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 		return FALSE;
 	}
 
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
+	const auto &item = m_itemInfoMap.at(internalIndex);
+	bool isFolder = IsItemFolder(internalIndex);
 
 	if (newFilename == item.editingName)
 	{
 		return FALSE;
 	}
 
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!isFolder)
 	{
-		auto *extension = PathFindExtension(item.wfd.cFileName);
+		// The name returned by the store is null-terminated and remains valid until the store is
+		// modified, which won't happen until after the item has been renamed.
+		auto *extension = PathFindExtension(m_itemStore.GetFileName(internalIndex).data());
 
 		bool extensionHidden = !m_config->globalFolderSettings.showExtensions
 			|| (m_config->globalFolderSettings.hideLinkExtension
@@ -1254,8 +1409,7 @@ BOOL ShellBrowserImpl::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 	// extension would always be re-added by the shell.
 	// Therefore, if a file is being edited, the parsing name (which will always contain an
 	// extension) will be updated.
-	if (!m_directoryState.virtualFolder
-		&& !WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!m_directoryState.virtualFolder && !isFolder)
 	{
 		flags |= SHGDN_FORPARSING;
 	}
@@ -1307,8 +1461,8 @@ LRESULT ShellBrowserImpl::OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDra
 
 	case CDDS_ITEMPREPAINT:
 	{
-		const auto &itemInfo =
-			GetItemByIndex(static_cast<int>(listViewCustomDraw->nmcd.dwItemSpec));
+		int internalIndex =
+			GetItemInternalIndex(static_cast<int>(listViewCustomDraw->nmcd.dwItemSpec));
 
 		for (const auto &colorRule :
 			ColorRuleModelFactory::GetInstance()->GetColorRuleModel()->GetItems())
@@ -1316,11 +1470,11 @@ LRESULT ShellBrowserImpl::OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDra
 			bool matchedFileName = false;
 			bool matchedAttributes = false;
 
-			if (!colorRule->GetFilterPattern().empty())
+			const auto &filterPattern = colorRule->GetCompiledFilterPattern();
+
+			if (!filterPattern.GetPattern().empty())
 			{
-				if (CheckWildcardMatch(colorRule->GetFilterPattern().c_str(),
-						itemInfo.displayName.c_str(), !colorRule->GetFilterPatternCaseInsensitive())
-					== 1)
+				if (filterPattern.Matches(m_itemStore.GetName(internalIndex)))
 				{
 					matchedFileName = true;
 				}
@@ -1332,8 +1486,8 @@ LRESULT ShellBrowserImpl::OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDra
 
 			if (colorRule->GetFilterAttributes() != 0)
 			{
-				if (itemInfo.isFindDataValid
-					&& WI_IsAnyFlagSet(itemInfo.wfd.dwFileAttributes,
+				if (m_itemStore.IsFindDataValid(internalIndex)
+					&& WI_IsAnyFlagSet(m_itemStore.GetAttributes(internalIndex),
 						colorRule->GetFilterAttributes()))
 				{
 					matchedAttributes = true;
@@ -1370,6 +1524,11 @@ void ShellBrowserImpl::OnFullRowSelectUpdated(BOOL newValue)
 
 void ShellBrowserImpl::OnCheckBoxSelectionUpdated(BOOL newValue)
 {
+	if (m_ownerData)
+	{
+		return;
+	}
+
 	ListViewHelper::AddRemoveExtendedStyle(m_hListView, LVS_EX_CHECKBOXES, newValue);
 }
 
@@ -0,0 +1,510 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+// Contains the parts of ShellBrowserImpl that are specific to owner data mode. In that mode, the
+// listview only stores the number of items, along with the selection and focus state. Everything
+// else is provided on demand, via LVN_GETDISPINFO.
+
+#include "stdafx.h"
+#include "ShellBrowserImpl.h"
+#include "Config.h"
+#include "ColumnDataRetrieval.h"
+#include "ItemData.h"
+#include "ViewModes.h"
+#include "../Helper/ListViewHelper.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+void ShellBrowserImpl::InsertAwaitingItemsOwnerData()
+{
+	if (m_directoryState.awaitingAddList.empty())
+	{
+		m_directoryState.numItems = static_cast<int>(m_ownerDataItems.size());
+		return;
+	}
+
+	std::vector<int> itemsToSelect;
+	std::optional<int> itemToRename;
+	size_t firstChangedPosition = m_ownerDataItems.size();
+	int numPendingAppends = 0;
+
+	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
+	{
+		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
+
+		if (IsFileFiltered(awaitingItem.iItemInternal))
+		{
+			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
+			continue;
+		}
+
+		auto position = static_cast<size_t>(
+			std::clamp(awaitingItem.iItem, 0, static_cast<int>(m_ownerDataItems.size())));
+
+		if (position == m_ownerDataItems.size())
+		{
+			// Items added to the end of the list (which is what happens during enumeration) only
+			// require the item count to be updated, which can be done once, after all the items
+			// have been added.
+			m_ownerDataItems.push_back(awaitingItem.iItemInternal);
+			numPendingAppends++;
+		}
+		else
+		{
+			if (numPendingAppends > 0)
+			{
+				ListView_SetItemCountEx(m_hListView, m_ownerDataItems.size(),
+					LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+				numPendingAppends = 0;
+			}
+
+			m_ownerDataItems.insert(m_ownerDataItems.begin() + position,
+				awaitingItem.iItemInternal);
+
+			// Inserting an item (rather than simply changing the item count) results in the
+			// selection and focus state of subsequent items being shifted down.
+			LVITEM lvItem = {};
+			lvItem.iItem = static_cast<int>(position);
+			ListView_InsertItem(m_hListView, &lvItem);
+		}
+
+		firstChangedPosition = std::min(firstChangedPosition, position);
+
+		if (m_directoryState.queuedRenameItem
+			&& ArePidlsEquivalent(itemInfo.pidlComplete.get(),
+				m_directoryState.queuedRenameItem.get()))
+		{
+			itemToRename = awaitingItem.iItemInternal;
+		}
+
+		auto selectItr = std::find_if(m_directoryState.filesToSelect.begin(),
+			m_directoryState.filesToSelect.end(),
+			[&itemInfo](const auto &pidl)
+			{ return ArePidlsEquivalent(pidl.Raw(), itemInfo.pidlComplete.get()); });
+
+		if (selectItr != m_directoryState.filesToSelect.end())
+		{
+			itemsToSelect.push_back(awaitingItem.iItemInternal);
+			m_directoryState.filesToSelect.erase(selectItr);
+		}
+
+		m_directoryState.totalDirSize += m_itemStore.GetSize(awaitingItem.iItemInternal);
+	}
+
+	if (numPendingAppends > 0)
+	{
+		ListView_SetItemCountEx(m_hListView, m_ownerDataItems.size(),
+			LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+	}
+
+	for (size_t i = firstChangedPosition; i < m_ownerDataItems.size(); i++)
+	{
+		m_ownerDataPositions[m_ownerDataItems[i]] = static_cast<int>(i);
+	}
+
+	m_directoryState.numItems = static_cast<int>(m_ownerDataItems.size());
+	m_directoryState.awaitingAddList.clear();
+
+	for (int internalIndex : itemsToSelect)
+	{
+		int index = m_ownerDataPositions.at(internalIndex);
+		ListViewHelper::SelectItem(m_hListView, index, TRUE);
+
+		if (ListView_GetSelectedCount(m_hListView) == 1)
+		{
+			ListViewHelper::FocusItem(m_hListView, index, TRUE);
+			ListView_EnsureVisible(m_hListView, index, FALSE);
+		}
+	}
+
+	if (itemToRename)
+	{
+		m_directoryState.queuedRenameItem.reset();
+		ListView_EditLabel(m_hListView, m_ownerDataPositions.at(*itemToRename));
+	}
+}
+
+void ShellBrowserImpl::DeleteOwnerDataItem(int index)
+{
+	int internalIndex = m_ownerDataItems.at(index);
+	bool selected = WI_IsFlagSet(ListView_GetItemState(m_hListView, index, LVIS_SELECTED),
+		LVIS_SELECTED);
+
+	m_ownerDataItems.erase(m_ownerDataItems.begin() + index);
+	m_ownerDataPositions.erase(internalIndex);
+
+	for (size_t i = index; i < m_ownerDataItems.size(); i++)
+	{
+		m_ownerDataPositions[m_ownerDataItems[i]] = static_cast<int>(i);
+	}
+
+	ListView_DeleteItem(m_hListView, index);
+
+	// No selection change notification is sent when a selected item is deleted.
+	if (selected)
+	{
+		RecalculateSelectionInfo();
+	}
+}
+
+// Removing items one at a time would shift every later position each time, so the remaining items
+// are instead collected and set in one go.
+void ShellBrowserImpl::RemoveOwnerDataItems(const std::vector<int> &internalIndexes)
+{
+	std::unordered_set<int> removedItems(internalIndexes.begin(), internalIndexes.end());
+
+	auto selectedItems = GetSelectedItemInternalIndexes();
+	bool anyRemovedItemSelected = std::any_of(selectedItems.begin(), selectedItems.end(),
+		[&removedItems](int internalIndex) { return removedItems.contains(internalIndex); });
+
+	std::vector<int> items;
+	items.reserve(m_ownerDataItems.size());
+	std::copy_if(m_ownerDataItems.begin(), m_ownerDataItems.end(), std::back_inserter(items),
+		[&removedItems](int internalIndex) { return !removedItems.contains(internalIndex); });
+
+	SetOwnerDataItems(std::move(items));
+
+	// The details are only removed once the listview no longer references the items, since the
+	// selection changes made above can still look them up.
+	for (int internalIndex : removedItems)
+	{
+		RemoveItemDetails(internalIndex);
+	}
+
+	// No selection change notification is sent when a selected item is deleted.
+	if (anyRemovedItemSelected)
+	{
+		RecalculateSelectionInfo();
+	}
+}
+
+// Replaces the full set of items shown in the listview. Since the listview tracks the selection and
+// focus by position, the selection and focus are captured beforehand and reapplied to the same
+// items once they've been moved to their new positions.
+void ShellBrowserImpl::SetOwnerDataItems(std::vector<int> &&items)
+{
+	auto selectedItems = GetSelectedItemInternalIndexes();
+	bool allItemsSelected =
+		!selectedItems.empty() && selectedItems.size() == m_ownerDataItems.size();
+
+	std::optional<int> focusedItem;
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedIndex != -1)
+	{
+		focusedItem = GetItemInternalIndex(focusedIndex);
+	}
+
+	if (!selectedItems.empty())
+	{
+		ListViewHelper::SelectAllItems(m_hListView, FALSE);
+	}
+
+	m_ownerDataItems = std::move(items);
+
+	m_ownerDataPositions.clear();
+	m_ownerDataPositions.reserve(m_ownerDataItems.size());
+
+	for (size_t i = 0; i < m_ownerDataItems.size(); i++)
+	{
+		m_ownerDataPositions[m_ownerDataItems[i]] = static_cast<int>(i);
+	}
+
+	ListView_SetItemCountEx(m_hListView, m_ownerDataItems.size(), LVSICF_NOSCROLL);
+
+	if (allItemsSelected && selectedItems.size() == m_ownerDataItems.size())
+	{
+		ListViewHelper::SelectAllItems(m_hListView, TRUE);
+	}
+	else
+	{
+		for (int internalIndex : selectedItems)
+		{
+			auto index = LocateItemByInternalIndex(internalIndex);
+
+			if (index)
+			{
+				ListViewHelper::SelectItem(m_hListView, *index, TRUE);
+			}
+		}
+	}
+
+	if (focusedItem)
+	{
+		auto index = LocateItemByInternalIndex(*focusedItem);
+
+		if (index)
+		{
+			ListViewHelper::FocusItem(m_hListView, *index, TRUE);
+		}
+	}
+}
+
+void ShellBrowserImpl::SortFolderOwnerData()
+{
+	std::vector<int> items = m_ownerDataItems;
+	SortItems(items);
+	SetOwnerDataItems(std::move(items));
+}
+
+// The listview doesn't own the items in owner data mode, so the new set of items can be built
+// directly and then set in one go. The positions to filter are expected to be in ascending order.
+void ShellBrowserImpl::ApplyFilterChangesOwnerData(const std::vector<int> &positionsToFilter,
+	const std::vector<int> &itemsToRestore)
+{
+	std::vector<int> items;
+	items.reserve(m_ownerDataItems.size() - positionsToFilter.size() + itemsToRestore.size());
+
+	auto nextPositionToFilter = positionsToFilter.begin();
+
+	for (size_t i = 0; i < m_ownerDataItems.size(); i++)
+	{
+		int internalIndex = m_ownerDataItems[i];
+
+		if (nextPositionToFilter != positionsToFilter.end()
+			&& *nextPositionToFilter == static_cast<int>(i))
+		{
+			m_directoryState.totalDirSize -= m_itemStore.GetSize(internalIndex);
+
+			assert(m_directoryState.filteredItemsList.count(internalIndex) == 0);
+			m_directoryState.filteredItemsList.insert(internalIndex);
+
+			++nextPositionToFilter;
+			continue;
+		}
+
+		items.push_back(internalIndex);
+	}
+
+	// Rather than inserting each restored item at its sorted position individually, all the items
+	// are added in one go and the complete set of items is then sorted.
+	for (int internalIndex : itemsToRestore)
+	{
+		m_directoryState.filteredItemsList.erase(internalIndex);
+		m_directoryState.totalDirSize += m_itemStore.GetSize(internalIndex);
+		items.push_back(internalIndex);
+	}
+
+	if (!itemsToRestore.empty())
+	{
+		SortItems(items);
+	}
+
+	m_directoryState.numItems = static_cast<int>(items.size());
+	SetOwnerDataItems(std::move(items));
+}
+
+void ShellBrowserImpl::OnOwnerDataGetDisplayInfo(NMLVDISPINFO *dispInfo)
+{
+	LVITEM *item = &dispInfo->item;
+
+	if (item->iItem < 0 || item->iItem >= static_cast<int>(m_ownerDataItems.size()))
+	{
+		return;
+	}
+
+	int internalIndex = m_ownerDataItems[item->iItem];
+	auto &itemInfo = m_itemInfoMap.at(internalIndex);
+
+	if (WI_IsFlagSet(item->mask, LVIF_TEXT))
+	{
+		ColumnType columnType = ColumnType::Name;
+
+		if (m_folderSettings.viewMode == +ViewMode::Details)
+		{
+			auto columnTypeForIndex = GetColumnTypeByIndex(item->iSubItem);
+			CHECK(columnTypeForIndex);
+			columnType = *columnTypeForIndex;
+		}
+
+		auto key = GetColumnTextKey(internalIndex, columnType);
+		const std::wstring *text = m_columnTextCache.Get(key);
+
+		// The name is always shown immediately. Other columns are retrieved in the background, the
+		// same as they are when the listview isn't in owner data mode.
+		if (!text && columnType == +ColumnType::Name)
+		{
+			BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+			m_columnTextCache.Insert(key,
+				ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings));
+			text = m_columnTextCache.Get(key);
+		}
+		else if (!text)
+		{
+			QueueColumnTask(internalIndex, columnType);
+		}
+
+		StringCchCopy(item->pszText, item->cchTextMax, text ? text->c_str() : L"");
+	}
+
+	bool thumbnailsMode = IsThumbnailsViewMode(m_folderSettings.viewMode);
+
+	if (WI_IsFlagSet(item->mask, LVIF_IMAGE))
+	{
+		// As the listview doesn't store the image for each item, the image index is cached, so
+		// that the icon/thumbnail is only retrieved once per item.
+		if (!itemInfo.imageIndex && thumbnailsMode)
+		{
+			auto cachedThumbnailIndex = GetCachedThumbnailIndex(internalIndex);
+
+			if (cachedThumbnailIndex)
+			{
+				itemInfo.imageIndex = *cachedThumbnailIndex;
+			}
+			else
+			{
+				itemInfo.imageIndex = GetIconThumbnail(internalIndex);
+				QueueThumbnailTask(internalIndex);
+			}
+		}
+		else if (!itemInfo.imageIndex)
+		{
+			auto cachedIconIndex = GetCachedIconIndex(internalIndex);
+
+			if (cachedIconIndex)
+			{
+				// See the comment in OnListViewGetDisplayInfo() for why the upper bits are masked
+				// out here.
+				itemInfo.imageIndex = (*cachedIconIndex & 0x0FFF);
+			}
+			else if (IsItemFolder(internalIndex))
+			{
+				itemInfo.imageIndex = m_iFolderIcon;
+			}
+			else
+			{
+				itemInfo.imageIndex = m_iFileIcon;
+			}
+
+			QueueIconTask(internalIndex);
+		}
+
+		item->iImage = *itemInfo.imageIndex;
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_STATE))
+	{
+		item->state = 0;
+
+		// Hidden items are always ghosted, the same as cut items.
+		if (itemInfo.cut
+			|| WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN))
+		{
+			item->state |= LVIS_CUT;
+		}
+
+		if (!thumbnailsMode)
+		{
+			item->state |= INDEXTOOVERLAYMASK(itemInfo.overlayIndex);
+		}
+	}
+}
+
+void ShellBrowserImpl::OnOwnerDataStateChanged(const NMLVODSTATECHANGE *stateChange)
+{
+	// This notification is sent when the state of a range of items changes (e.g. when a range of
+	// items is selected using shift+click). The notification doesn't indicate which items in the
+	// range actually changed state, so the selection information is rebuilt.
+	if (WI_IsFlagClear(stateChange->uOldState ^ stateChange->uNewState, LVIS_SELECTED))
+	{
+		return;
+	}
+
+	RecalculateSelectionInfo();
+
+	listViewSelectionChanged.m_signal();
+}
+
+// Used for keyboard navigation (i.e. typing the start of an item's name).
+int ShellBrowserImpl::OnOwnerDataFindItem(const NMLVFINDITEM *findItem)
+{
+	const LVFINDINFO &findInfo = findItem->lvfi;
+
+	if (WI_AreAllFlagsClear(findInfo.flags, LVFI_STRING | LVFI_PARTIAL) || !findInfo.psz)
+	{
+		return -1;
+	}
+
+	std::wstring_view searchText = findInfo.psz;
+	bool partial = WI_IsFlagSet(findInfo.flags, LVFI_PARTIAL);
+	bool wrap = WI_IsFlagSet(findInfo.flags, LVFI_WRAP);
+	int numItems = static_cast<int>(m_ownerDataItems.size());
+	int start = std::clamp(findItem->iStart, 0, numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int index = start + i;
+
+		if (index >= numItems)
+		{
+			if (!wrap)
+			{
+				break;
+			}
+
+			index -= numItems;
+		}
+
+		auto name = m_itemStore.GetName(m_ownerDataItems[index]);
+
+		if (partial)
+		{
+			if (name.size() < searchText.size())
+			{
+				continue;
+			}
+
+			name = name.substr(0, searchText.size());
+		}
+
+		if (CompareStringOrdinal(name.data(), static_cast<int>(name.size()), searchText.data(),
+				static_cast<int>(searchText.size()), TRUE)
+			== CSTR_EQUAL)
+		{
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+void ShellBrowserImpl::RecalculateSelectionInfo()
+{
+	m_directoryState.numFilesSelected = 0;
+	m_directoryState.numFoldersSelected = 0;
+	m_directoryState.fileSelectionSize = 0;
+
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		UpdateFileSelectionInfo(GetItemInternalIndex(item), TRUE);
+	}
+}
+
+void ShellBrowserImpl::RedrawItemByInternalIndex(int internalIndex)
+{
+	auto index = LocateItemByInternalIndex(internalIndex);
+
+	if (!index)
+	{
+		return;
+	}
+
+	ListView_RedrawItems(m_hListView, *index, *index);
+}
+
+std::vector<int> ShellBrowserImpl::GetSelectedItemInternalIndexes() const
+{
+	std::vector<int> selectedItems;
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		selectedItems.push_back(GetItemInternalIndex(item));
+	}
+
+	return selectedItems;
+}
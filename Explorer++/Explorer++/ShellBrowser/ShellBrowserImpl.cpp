@@ -9,6 +9,7 @@
 #include "ColorRuleModelFactory.h"
 #include "Config.h"
 #include "CoreInterface.h"
+#include "FeatureList.h"
 #include "FolderView.h"
 #include "IconFetcherImpl.h"
 #include "ItemData.h"
@@ -19,6 +20,7 @@
 #include "ShellBrowserEmbedder.h"
 #include "ShellBrowserHelper.h"
 #include "ShellNavigationController.h"
+#include "SortHelper.h"
 #include "SortModes.h"
 #include "ThemeManager.h"
 #include "ViewModeHelper.h"
@@ -35,6 +37,16 @@
 
 void CALLBACK TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
 
+namespace
+{
+
+std::string_view GetItemIdBytes(PCUITEMID_CHILD pidlChild)
+{
+	return { reinterpret_cast<const char *>(pidlChild), pidlChild->mkid.cb };
+}
+
+}
+
 std::shared_ptr<ShellBrowserImpl> ShellBrowserImpl::CreateNew(HWND hOwner,
 	ShellBrowserEmbedder *embedder, CoreInterface *coreInterface,
 	TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
@@ -51,16 +63,27 @@ std::shared_ptr<ShellBrowserImpl> ShellBrowserImpl::CreateFromPreserved(HWND hOw
 	const PreservedFolderState &preservedFolderState)
 {
 	return std::shared_ptr<ShellBrowserImpl>(new ShellBrowserImpl(hOwner, embedder, coreInterface,
-		tabNavigation, fileActionHandler, history, currentEntry, preservedFolderState));
+		tabNavigation, fileActionHandler, history, currentEntry,
+		preservedFolderState.folderSettings, nullptr));
+}
+
+std::shared_ptr<ShellBrowserImpl> ShellBrowserImpl::CreateWithHistory(HWND hOwner,
+	ShellBrowserEmbedder *embedder, CoreInterface *coreInterface,
+	TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
+	const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
+	const FolderSettings &folderSettings, const FolderColumns *initialColumns)
+{
+	return std::shared_ptr<ShellBrowserImpl>(new ShellBrowserImpl(hOwner, embedder, coreInterface,
+		tabNavigation, fileActionHandler, history, currentEntry, folderSettings, initialColumns));
 }
 
 ShellBrowserImpl::ShellBrowserImpl(HWND hOwner, ShellBrowserEmbedder *embedder,
 	CoreInterface *coreInterface, TabNavigationInterface *tabNavigation,
 	FileActionHandler *fileActionHandler,
 	const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
-	const PreservedFolderState &preservedFolderState) :
+	const FolderSettings &folderSettings, const FolderColumns *initialColumns) :
 	ShellBrowserImpl(hOwner, embedder, coreInterface, tabNavigation, fileActionHandler,
-		preservedFolderState.folderSettings, nullptr)
+		folderSettings, initialColumns)
 {
 	m_navigationController = std::make_unique<ShellNavigationController>(this, tabNavigation,
 		m_iconFetcher.get(), history, currentEntry);
@@ -70,29 +93,33 @@ ShellBrowserImpl::ShellBrowserImpl(HWND hOwner, ShellBrowserEmbedder *embedder,
 	CoreInterface *coreInterface, TabNavigationInterface *tabNavigation,
 	FileActionHandler *fileActionHandler, const FolderSettings &folderSettings,
 	const FolderColumns *initialColumns) :
-	ShellDropTargetWindow(CreateListView(hOwner)),
+	ShellDropTargetWindow(CreateListView(hOwner,
+		FeatureList::GetInstance()->IsEnabled(Feature::OwnerDataListView))),
 	m_hListView(GetHWND()),
 	m_hOwner(hOwner),
+	m_ownerData(WI_IsFlagSet(GetWindowLongPtr(GetHWND(), GWL_STYLE), LVS_OWNERDATA)),
 	m_tabNavigation(tabNavigation),
 	m_fileActionHandler(fileActionHandler),
 	m_fontSetter(GetHWND(), coreInterface->GetConfig()),
 	m_tooltipFontSetter(reinterpret_cast<HWND>(SendMessage(GetHWND(), LVM_GETTOOLTIPS, 0, 0)),
 		coreInterface->GetConfig()),
-	m_columnThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_taskScheduler(coreInterface->GetBackgroundTaskScheduler()),
 	m_columnResultIDCounter(0),
+	m_columnTextCache(COLUMN_TEXT_CACHE_SIZE),
 	m_cachedIcons(coreInterface->GetCachedIcons()),
 	m_iconResourceLoader(coreInterface->GetIconResourceLoader()),
-	m_thumbnailThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
 	m_thumbnailResultIDCounter(0),
-	m_infoTipsThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_thumbnailCache(coreInterface->GetThumbnailCache()),
 	m_infoTipResultIDCounter(0),
+	m_backgroundExecutor(coreInterface->GetBackgroundExecutor()),
+	m_folderSizeService(coreInterface->GetFolderSizeService()),
+	m_folderEnumerationService(coreInterface->GetFolderEnumerationService()),
+	m_enumerationTaskGroup(m_backgroundExecutor),
 	m_resourceInstance(coreInterface->GetResourceInstance()),
 	m_acceleratorManager(coreInterface->GetAcceleratorManager()),
 	m_config(coreInterface->GetConfig()),
 	m_folderSettings(folderSettings),
+	m_filterPattern(folderSettings.filter, folderSettings.filterCaseSensitive),
 	m_shellChangeWatcher(GetHWND(),
 		std::bind_front(&ShellBrowserImpl::ProcessShellChangeNotifications, this)),
 	m_shellWindowRegistered(false),
@@ -101,8 +128,15 @@ ShellBrowserImpl::ShellBrowserImpl(HWND hOwner, ShellBrowserEmbedder *embedder,
 			: coreInterface->GetConfig()->globalFolderSettings.folderColumns),
 	m_draggedDataObject(nullptr)
 {
+	// Owner data listviews don't support groups.
+	if (m_ownerData)
+	{
+		m_folderSettings.showInGroups = false;
+	}
+
 	InitializeListView();
-	m_iconFetcher = std::make_unique<IconFetcherImpl>(m_hListView, m_cachedIcons);
+	m_iconFetcher =
+		std::make_unique<IconFetcherImpl>(m_hListView, m_cachedIcons, m_taskScheduler);
 	m_navigationController =
 		std::make_unique<ShellNavigationController>(this, tabNavigation, m_iconFetcher.get());
 
@@ -143,23 +177,33 @@ ShellBrowserImpl::~ShellBrowserImpl()
 
 	DestroyWindow(m_hListView);
 
-	m_columnThreadPool.clear_queue();
-	m_thumbnailThreadPool.clear_queue();
-	m_infoTipsThreadPool.clear_queue();
+	CancelEnumeration();
+
+	m_enumerationTaskGroup.Cancel();
+
+	// Some of the tasks reference this instance, so any that are running need to finish before
+	// this instance is destroyed.
+	m_taskScheduler->CancelTasks(this, true);
 
 	DeleteCriticalSection(&m_csDirectoryAltered);
 }
 
-HWND ShellBrowserImpl::CreateListView(HWND parent)
+HWND ShellBrowserImpl::CreateListView(HWND parent, bool ownerData)
 {
 	// Note that the only reason LVS_REPORT is specified here is so that the listview header theme
 	// can be set immediately when in dark mode. Without this style, ListView_GetHeader() will
 	// return NULL. The actual view mode set here doesn't matter, since it will be updated when
 	// navigating to a folder.
-	return ::CreateListView(parent,
-		WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT | LVS_EDITLABELS
-			| LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
-			| LVS_ALIGNTOP);
+	DWORD style = WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT
+		| LVS_EDITLABELS | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
+		| LVS_ALIGNTOP;
+
+	if (ownerData)
+	{
+		style |= LVS_OWNERDATA;
+	}
+
+	return ::CreateListView(parent, style);
 }
 
 void ShellBrowserImpl::InitializeListView()
@@ -174,7 +218,9 @@ void ShellBrowserImpl::InitializeListView()
 	m_connections.push_back(m_config->useFullRowSelect.addObserver(
 		std::bind_front(&ShellBrowserImpl::OnFullRowSelectUpdated, this)));
 
-	if (m_config->checkBoxSelection.get())
+	// The check state for each item would have to be tracked separately in owner data mode, so
+	// check box selection isn't supported in that mode.
+	if (m_config->checkBoxSelection.get() && !m_ownerData)
 	{
 		dwExtendedStyle |= LVS_EX_CHECKBOXES;
 	}
@@ -184,6 +230,14 @@ void ShellBrowserImpl::InitializeListView()
 
 	ListView_SetExtendedListViewStyle(m_hListView, dwExtendedStyle);
 
+	if (m_ownerData)
+	{
+		// The listview doesn't store the state of individual items in owner data mode (other than
+		// the selection and focus state), so the cut and overlay states are provided by the
+		// LVN_GETDISPINFO handler.
+		ListView_SetCallbackMask(m_hListView, LVIS_CUT | LVIS_OVERLAYMASK);
+	}
+
 	ListViewHelper::SetAutoArrange(m_hListView, m_folderSettings.autoArrange);
 	ListViewHelper::SetGridlines(m_hListView, m_config->globalFolderSettings.showGridlines.get());
 
@@ -394,8 +448,10 @@ void ShellBrowserImpl::SetViewModeInternal(ViewMode viewMode)
 
 	if (viewMode != +ViewMode::Details)
 	{
-		m_columnThreadPool.clear_queue();
+		CancelBackgroundTasks(BackgroundTaskType::ColumnBatch);
 		m_columnResults.clear();
+		m_pendingColumnText.clear();
+		m_pendingColumnRequests.clear();
 	}
 
 	if (viewMode != +ViewMode::Details && viewMode != +ViewMode::Tiles)
@@ -431,6 +487,13 @@ void ShellBrowserImpl::SetViewModeInternal(ViewMode viewMode)
 
 void ShellBrowserImpl::SetFirstColumnTextToCallback()
 {
+	// In owner data mode, the item text is always retrieved via LVN_GETDISPINFO.
+	if (m_ownerData)
+	{
+		ListView_RedrawItems(m_hListView, 0, ListView_GetItemCount(m_hListView) - 1);
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -441,6 +504,12 @@ void ShellBrowserImpl::SetFirstColumnTextToCallback()
 
 void ShellBrowserImpl::SetFirstColumnTextToFilename()
 {
+	if (m_ownerData)
+	{
+		ListView_RedrawItems(m_hListView, 0, ListView_GetItemCount(m_hListView) - 1);
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -552,7 +621,7 @@ int ShellBrowserImpl::GetId() const
 
 std::wstring ShellBrowserImpl::GetItemName(int index) const
 {
-	return GetItemByIndex(index).wfd.cFileName;
+	return std::wstring(m_itemStore.GetFileName(GetItemInternalIndex(index)));
 }
 
 // Returns the name of the item as it's shown to the user. Note that this name may not be unique.
@@ -619,33 +688,25 @@ void ShellBrowserImpl::SelectItems(const std::vector<PidlAbsolute> &pidls)
 
 int ShellBrowserImpl::LocateFileItemIndex(const TCHAR *szFileName) const
 {
-	LV_FINDINFO lvFind;
-	int iItem;
-	int iInternalIndex;
-
-	iInternalIndex = LocateFileItemInternalIndex(szFileName);
+	int iInternalIndex = LocateFileItemInternalIndex(szFileName);
 
-	if (iInternalIndex != -1)
+	if (iInternalIndex == -1)
 	{
-		lvFind.flags = LVFI_PARAM;
-		lvFind.lParam = iInternalIndex;
-		iItem = ListView_FindItem(m_hListView, -1, &lvFind);
-
-		return iItem;
+		return -1;
 	}
 
-	return -1;
+	return LocateItemByInternalIndex(iInternalIndex).value_or(-1);
 }
 
 int ShellBrowserImpl::LocateFileItemInternalIndex(const TCHAR *szFileName) const
 {
 	for (int i = 0; i < m_directoryState.numItems; i++)
 	{
-		const auto &item = GetItemByIndex(i);
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (lstrcmp(item.wfd.cFileName, szFileName) == 0)
+		if (lstrcmp(m_itemStore.GetFileName(internalIndex).data(), szFileName) == 0)
 		{
-			return GetItemInternalIndex(i);
+			return internalIndex;
 		}
 	}
 
@@ -666,9 +727,34 @@ std::optional<int> ShellBrowserImpl::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl)
 
 std::optional<int> ShellBrowserImpl::GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
 {
+	auto isMatch = [this, pidl](int internalIndex)
+	{ return ArePidlsEquivalent(pidl, m_itemInfoMap.at(internalIndex).pidlComplete.get()); };
+
+	if (!ILIsEmpty(pidl))
+	{
+		auto internalIndex =
+			m_itemLookupIndex.FindItemById(GetItemIdBytes(ILFindLastID(pidl)), isMatch);
+
+		if (internalIndex)
+		{
+			return internalIndex;
+		}
+	}
+
+	// Change notifications generally use simple pidls, which contain different data to the pidls
+	// that are stored for each item, so the ID lookup above will often fail. The parsing name
+	// should be the same, however.
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	if (SUCCEEDED(hr))
+	{
+		return m_itemLookupIndex.FindItemByParsingName(parsingName, isMatch);
+	}
+
+	// Without a parsing name, there's no choice but to compare the pidl against every item.
 	auto itr = std::find_if(m_itemInfoMap.begin(), m_itemInfoMap.end(),
-		[pidl](const auto &pair)
-		{ return ArePidlsEquivalent(pidl, pair.second.pidlComplete.get()); });
+		[&isMatch](const auto &pair) { return isMatch(pair.first); });
 
 	if (itr == m_itemInfoMap.end())
 	{
@@ -680,6 +766,33 @@ std::optional<int> ShellBrowserImpl::GetItemInternalIndexForPidl(PCIDLIST_ABSOLU
 
 std::optional<int> ShellBrowserImpl::LocateItemByInternalIndex(int internalIndex) const
 {
+	if (m_ownerData)
+	{
+		auto itr = m_ownerDataPositions.find(internalIndex);
+
+		if (itr == m_ownerDataPositions.end())
+		{
+			return std::nullopt;
+		}
+
+		return itr->second;
+	}
+
+	auto hintItr = m_itemPositionHints.find(internalIndex);
+
+	if (hintItr != m_itemPositionHints.end())
+	{
+		LVITEM lvItem;
+		lvItem.mask = LVIF_PARAM;
+		lvItem.iItem = hintItr->second;
+		lvItem.iSubItem = 0;
+
+		if (ListView_GetItem(m_hListView, &lvItem) && lvItem.lParam == internalIndex)
+		{
+			return hintItr->second;
+		}
+	}
+
 	LVFINDINFO lvfi;
 	lvfi.flags = LVFI_PARAM;
 	lvfi.lParam = internalIndex;
@@ -687,15 +800,59 @@ std::optional<int> ShellBrowserImpl::LocateItemByInternalIndex(int internalIndex
 
 	if (item == -1)
 	{
+		m_itemPositionHints.erase(internalIndex);
 		return std::nullopt;
 	}
 
+	m_itemPositionHints[internalIndex] = item;
+
 	return item;
 }
 
+void ShellBrowserImpl::AddItemToLookupIndex(int internalIndex)
+{
+	const auto &itemInfo = m_itemInfoMap.at(internalIndex);
+	m_itemLookupIndex.AddOrUpdateItem(internalIndex, GetItemIdBytes(itemInfo.pridl.get()),
+		itemInfo.parsingName);
+}
+
 WIN32_FIND_DATA ShellBrowserImpl::GetItemFileFindData(int index) const
 {
-	return GetItemByIndex(index).wfd;
+	return GetItemFindData(GetItemInternalIndex(index));
+}
+
+// Rebuilds the find data for an item from the details held in the item store. The short name and
+// reserved fields aren't stored, so will always be empty.
+WIN32_FIND_DATA ShellBrowserImpl::GetItemFindData(int internalIndex) const
+{
+	WIN32_FIND_DATA wfd = {};
+	wfd.dwFileAttributes = m_itemStore.GetAttributes(internalIndex);
+
+	auto setFileTime = [](FILETIME &fileTime, uint64_t value)
+	{
+		ULARGE_INTEGER time;
+		time.QuadPart = value;
+		fileTime = { time.LowPart, time.HighPart };
+	};
+
+	setFileTime(wfd.ftCreationTime, m_itemStore.GetDateCreated(internalIndex));
+	setFileTime(wfd.ftLastAccessTime, m_itemStore.GetDateAccessed(internalIndex));
+	setFileTime(wfd.ftLastWriteTime, m_itemStore.GetDateModified(internalIndex));
+
+	ULARGE_INTEGER size;
+	size.QuadPart = m_itemStore.GetSize(internalIndex);
+	wfd.nFileSizeLow = size.LowPart;
+	wfd.nFileSizeHigh = size.HighPart;
+
+	StringCchCopy(wfd.cFileName, std::size(wfd.cFileName),
+		m_itemStore.GetFileName(internalIndex).data());
+
+	return wfd;
+}
+
+bool ShellBrowserImpl::IsItemFolder(int internalIndex) const
+{
+	return WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_DIRECTORY);
 }
 
 unique_pidl_absolute ShellBrowserImpl::GetItemCompleteIdl(int index) const
@@ -766,29 +923,19 @@ int ShellBrowserImpl::GenerateUniqueItemId()
 
 int ShellBrowserImpl::DetermineItemSortedPosition(LPARAM lParam) const
 {
-	LVITEM lvItem;
-	BOOL bItem;
 	int res = 1;
 	int nItems = 0;
 	int i = 0;
 
 	nItems = ListView_GetItemCount(m_hListView);
 
+	SortKey itemSortKey = GetItemSortKey(static_cast<int>(lParam));
+	bool sortFoldersFirst = ShouldSortFoldersFirst();
+
 	while (res > 0 && i < nItems)
 	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		bItem = ListView_GetItem(m_hListView, &lvItem);
-
-		if (bItem)
-		{
-			res = Sort(static_cast<int>(lParam), static_cast<int>(lvItem.lParam));
-		}
-		else
-		{
-			res = 0;
-		}
+		res = CompareSortKeys(itemSortKey, GetItemSortKey(GetItemInternalIndex(i)),
+			sortFoldersFirst);
 
 		i++;
 	}
@@ -1066,16 +1213,13 @@ void ShellBrowserImpl::UpdateDriveIcon(const TCHAR *szDrive)
 	{
 		for (i = 0; i < m_directoryState.numItems; i++)
 		{
-			lvItem.mask = LVIF_PARAM;
-			lvItem.iItem = i;
-			lvItem.iSubItem = 0;
-			ListView_GetItem(m_hListView, &lvItem);
+			int internalIndex = GetItemInternalIndex(i);
 
 			if (ArePidlsEquivalent(pidlDrive.get(),
-					m_itemInfoMap.at((int) lvItem.lParam).pidlComplete.get()))
+					m_itemInfoMap.at(internalIndex).pidlComplete.get()))
 			{
 				iItem = i;
-				iItemInternal = (int) lvItem.lParam;
+				iItemInternal = internalIndex;
 
 				break;
 			}
@@ -1086,7 +1230,14 @@ void ShellBrowserImpl::UpdateDriveIcon(const TCHAR *szDrive)
 	{
 		SHGetFileInfo(szDrive, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
 
-		m_itemInfoMap.at(iItemInternal).displayName = displayName;
+		m_itemStore.UpdateName(iItemInternal, displayName);
+
+		if (m_ownerData)
+		{
+			m_itemInfoMap.at(iItemInternal).imageIndex = shfi.iIcon;
+			InvalidateAllColumnsForItem(iItem);
+			return;
+		}
 
 		/* Update the drives icon and display name. */
 		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
@@ -1100,22 +1251,18 @@ void ShellBrowserImpl::UpdateDriveIcon(const TCHAR *szDrive)
 
 void ShellBrowserImpl::RemoveDrive(const TCHAR *szDrive)
 {
-	LVITEM lvItem;
 	int iItemInternal = -1;
 	int i = 0;
 
 	for (i = 0; i < m_directoryState.numItems; i++)
 	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		ListView_GetItem(m_hListView, &lvItem);
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (m_itemInfoMap.at((int) lvItem.lParam).bDrive)
+		if (m_itemInfoMap.at(internalIndex).bDrive)
 		{
-			if (lstrcmp(szDrive, m_itemInfoMap.at((int) lvItem.lParam).szDrive) == 0)
+			if (lstrcmp(szDrive, m_itemInfoMap.at(internalIndex).szDrive) == 0)
 			{
-				iItemInternal = (int) lvItem.lParam;
+				iItemInternal = internalIndex;
 				break;
 			}
 		}
@@ -1139,10 +1286,10 @@ BasicItemInfo_t ShellBrowserImpl::getBasicItemInfo(int internalIndex) const
 	BasicItemInfo_t basicItemInfo;
 	basicItemInfo.pidlComplete.reset(ILCloneFull(itemInfo.pidlComplete.get()));
 	basicItemInfo.pridl.reset(ILCloneChild(itemInfo.pridl.get()));
-	basicItemInfo.wfd = itemInfo.wfd;
-	basicItemInfo.isFindDataValid = itemInfo.isFindDataValid;
+	basicItemInfo.wfd = GetItemFindData(internalIndex);
+	basicItemInfo.isFindDataValid = m_itemStore.IsFindDataValid(internalIndex);
 	StringCchCopy(basicItemInfo.szDisplayName, std::size(basicItemInfo.szDisplayName),
-		itemInfo.displayName.c_str());
+		m_itemStore.GetName(internalIndex).data());
 	basicItemInfo.isRoot = itemInfo.bDrive;
 
 	return basicItemInfo;
@@ -7,7 +7,10 @@
 #include "ClipboardOperations.h"
 #include "ColumnDataRetrieval.h"
 #include "Columns.h"
+#include "FolderEnumerationService.h"
 #include "FolderSettings.h"
+#include "ItemData.h"
+#include "ItemStore.h"
 #include "MainFontSetter.h"
 #include "ServiceProvider.h"
 #include "ShellBrowser.h"
@@ -15,10 +18,16 @@
 #include "SignalWrapper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/ChangeCoalescer.h"
+#include "../Helper/ItemLookupIndex.h"
+#include "../Helper/LruCache.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/ThumbnailCache.h"
+#include "../Helper/WildcardPattern.h"
 #include "../Helper/WinRTBaseWrapper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
+#include "../Helper/WorkStealingExecutor.h"
 #include <boost/core/noncopyable.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
@@ -27,8 +36,10 @@
 #include <wil/com.h>
 #include <wil/resource.h>
 #include <thumbcache.h>
+#include <atomic>
 #include <future>
 #include <list>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <unordered_set>
@@ -37,15 +48,16 @@
 #define WM_USER_FILESADDED (WM_APP + 51)
 
 class AcceleratorManager;
-struct BasicItemInfo_t;
 class CachedIcons;
 struct Config;
 class CoreInterface;
 class FileActionHandler;
+class FolderSizeService;
 class IconFetcher;
 class IconResourceLoader;
 struct PreservedFolderState;
 struct PreservedHistoryEntry;
+struct SortKey;
 class ShellBrowserEmbedder;
 class ShellNavigationController;
 class TabNavigationInterface;
@@ -75,6 +87,13 @@ public:
 		const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
 		const PreservedFolderState &preservedFolderState);
 
+	// Used when restoring a tab with its history from a previous session.
+	static std::shared_ptr<ShellBrowserImpl> CreateWithHistory(HWND hOwner,
+		ShellBrowserEmbedder *embedder, CoreInterface *coreInterface,
+		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
+		const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
+		const FolderSettings &folderSettings, const FolderColumns *initialColumns);
+
 	~ShellBrowserImpl();
 
 	HWND GetListView() const;
@@ -190,6 +209,21 @@ public:
 	void OnDeviceChange(UINT eventType, LONG_PTR eventData);
 	void AutoSizeColumns();
 
+	// Enumerates the folder and adds its items to the enumeration cache, in the same form that a
+	// navigation to the folder would, without showing anything. This allows the cache to be warmed
+	// ahead of a likely navigation and should only be called from a background thread. Nothing is
+	// cached if the folder contains more than maxItems items, or if shouldContinue returns false
+	// before the enumeration has finished.
+	static HRESULT CacheFolderItems(PCIDLIST_ABSOLUTE pidlDirectory, bool showHidden,
+		FolderEnumerationService *folderEnumerationService,
+		const FolderEnumerationService::EnumerationTicket &enumerationTicket, size_t maxItems,
+		const std::function<bool()> &shouldContinue);
+	static FolderEnumerationService::Contents GetEnumerationContents(bool showHidden);
+
+	// Thumbnails are extracted on worker threads, each of which holds onto its own thumbnail cache
+	// object. This should be called on a worker before its COM apartment is uninitialized.
+	static void ReleaseThreadThumbnailResources();
+
 	// Signals
 	SignalWrapper<ShellBrowserImpl, void()> directoryModified;
 	SignalWrapper<ShellBrowserImpl, void()> listViewSelectionChanged;
@@ -198,14 +232,16 @@ public:
 private:
 	using PendingWorkQueueTask = std::function<void()>;
 
+	// Items are identified by their parsing names when coalescing changes.
+	using ItemChangeCoalescer = ChangeCoalescer<std::wstring, PidlAbsolute>;
+
+	// The display name and find data for each item are held in m_itemStore, so aren't part of
+	// this structure.
 	struct ItemInfo_t
 	{
 		unique_pidl_absolute pidlComplete;
 		unique_pidl_child pridl;
-		WIN32_FIND_DATA wfd;
-		bool isFindDataValid;
 		std::wstring parsingName;
-		std::wstring displayName;
 		std::wstring editingName;
 		int iIcon;
 
@@ -220,11 +256,28 @@ private:
 		when items need to be rearranged). */
 		int iRelativeSort;
 
-		ItemInfo_t() : wfd({}), isFindDataValid(false), iIcon(0), bDrive(FALSE)
+		// The fields below are only used when the listview is in owner data mode. In that mode,
+		// the listview doesn't store anything for individual items, so the image and cut state
+		// that would normally be set on the listview item are tracked here instead.
+		std::optional<int> imageIndex;
+		int overlayIndex = 0;
+		bool cut = false;
+
+		ItemInfo_t() : iIcon(0), bDrive(FALSE)
 		{
 		}
 	};
 
+	// Holds everything about an item that's yet to be added. When the item is added, the display
+	// name and find data are moved into m_itemStore and the rest into m_itemInfoMap.
+	struct NewItemInfo_t
+	{
+		ItemInfo_t itemInfo;
+		std::wstring displayName;
+		WIN32_FIND_DATA wfd = {};
+		bool isFindDataValid = false;
+	};
+
 	struct AlteredFile_t
 	{
 		TCHAR szFileName[MAX_PATH];
@@ -252,11 +305,21 @@ private:
 		POINT DropPoint;
 	};
 
+	// The columns requested for a single item. All the columns for an item are retrieved together.
+	struct ColumnRequest
+	{
+		int itemInternalIndex;
+		BasicItemInfo_t basicItemInfo;
+		std::vector<ColumnType> columnTypes;
+		int generation;
+	};
+
 	struct ColumnResult_t
 	{
 		int itemInternalIndex;
 		ColumnType columnType;
 		std::wstring columnText;
+		int generation;
 	};
 
 	struct ThumbnailResult_t
@@ -271,6 +334,27 @@ private:
 		std::wstring infoTip;
 	};
 
+	// Items are enumerated on a background thread and passed back to the UI thread in batches. This
+	// object is shared between the two threads. Access to the batches and the finished flag must be
+	// synchronized via the mutex.
+	struct EnumerationResults
+	{
+		// The value of m_uniqueFolderId for the navigation that started this enumeration.
+		const int folderId;
+
+		// Set by the UI thread when the enumeration is no longer needed (e.g. because a different
+		// navigation has started).
+		std::atomic<bool> cancelled = false;
+
+		std::mutex mutex;
+		std::vector<std::vector<NewItemInfo_t>> batches;
+		bool finished = false;
+
+		explicit EnumerationResults(int folderId) : folderId(folderId)
+		{
+		}
+	};
+
 	struct GroupInfo
 	{
 		std::wstring name;
@@ -341,9 +425,6 @@ private:
 		uint64_t totalDirSize;
 		uint64_t fileSelectionSize;
 
-		/* Cached folder size data. */
-		mutable std::unordered_map<int, ULONGLONG> cachedFolderSizes;
-
 		// Thumbnails
 		// The first imagelist will be used to retrieve item icons in thumbnails mode.
 		HIMAGELIST thumbnailsShellImageList = nullptr;
@@ -386,38 +467,137 @@ private:
 	static const UINT WM_APP_THUMBNAIL_RESULT_READY = WM_APP + 151;
 	static const UINT WM_APP_INFO_TIP_READY = WM_APP + 152;
 	static const UINT WM_APP_PENDING_TASK_AVAILABLE = WM_APP + 153;
+	static const UINT WM_APP_ENUMERATION_BATCH_READY = WM_APP + 154;
+	static const UINT WM_APP_COLUMN_REQUESTS_PENDING = WM_APP + 155;
+	static const UINT WM_APP_ICON_RESULT_READY = WM_APP + 156;
+
+	// The number of items that will be passed from the enumeration thread to the UI thread at once.
+	static const size_t ENUMERATION_BATCH_SIZE = 256;
+
+	// The maximum number of column text entries cached for the current folder.
+	static const size_t COLUMN_TEXT_CACHE_SIZE = 20000;
+
+	// The maximum number of items whose columns will be retrieved within a single task.
+	static const size_t COLUMN_REQUEST_BATCH_SIZE = 32;
+
+	// Info tips are only requested for the item under the cursor, so they're retrieved ahead of any
+	// other work.
+	static const PriorityTaskScheduler::Priority INFO_TIP_TASK_PRIORITY = -1;
+
+	// The priority used for tasks that are queued as items are painted. Requests are made in the
+	// order items are painted, so tasks with the same priority will be run in that order.
+	static const PriorityTaskScheduler::Priority PAINTED_ITEM_TASK_PRIORITY = 0;
+
+	// The number of items checked against the filter within a single chunk, when the filter
+	// changes. This is a multiple of 64, so that each chunk writes to a separate set of words in
+	// the result bitmap.
+	static const size_t FILTER_CHUNK_SIZE = 4096;
+
+	// Once the net number of changes in a batch of change notifications reaches the larger of
+	// these two values (the second being a fraction of the number of items in the folder), the
+	// folder is refreshed, rather than each change being applied.
+	static const size_t FULL_REFRESH_MIN_CHANGES = 1000;
+	static const size_t FULL_REFRESH_FOLDER_FRACTION = 4;
+
+	// Each background task queued by this class is identified by its type (stored in the upper 32
+	// bits of the task ID) and a value specific to that type. For the per-item tasks, the value is
+	// the internal index of the item, so that multiple requests for the same item only result in a
+	// single task.
+	enum class BackgroundTaskType : uint32_t
+	{
+		ColumnBatch,
+		Icon,
+		Thumbnail,
+		InfoTip
+	};
+
+	template <typename T>
+	struct PendingItemResult
+	{
+		int itemInternalIndex;
+		std::future<T> result;
+	};
+
+	struct PendingColumn
+	{
+		int itemInternalIndex;
+		ColumnType columnType;
+		int generation;
+	};
+
+	struct PendingColumnBatch
+	{
+		std::vector<PendingColumn> columns;
+		std::future<std::vector<ColumnResult_t>> result;
+	};
+
+	// The items that need to be checked when the filter changes.
+	enum class FilterScope
+	{
+		// Sufficient when the filter has become more restrictive.
+		ShownItems,
+
+		// Sufficient when the filter has become less restrictive.
+		FilteredItems,
+
+		AllItems
+	};
 
 	ShellBrowserImpl(HWND hOwner, ShellBrowserEmbedder *embedder, CoreInterface *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
-		const PreservedFolderState &preservedFolderState);
+		const FolderSettings &folderSettings, const FolderColumns *initialColumns);
 	ShellBrowserImpl(HWND hOwner, ShellBrowserEmbedder *embedder, CoreInterface *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const FolderSettings &folderSettings, const FolderColumns *initialColumns);
 
-	static HWND CreateListView(HWND parent);
+	static HWND CreateListView(HWND parent, bool ownerData);
 	void InitializeListView();
 	int GenerateUniqueItemId();
 	void MarkItemAsCut(int item, bool cut);
 	void VerifySortMode();
 
 	/* Browsing support. */
-	HRESULT PerformEnumeration(NavigateParams &navigateParams, std::vector<ItemInfo_t> &items);
-	static HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, HWND owner, bool showHidden,
-		std::vector<ItemInfo_t> &items);
-	static std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
+	HRESULT PerformEnumeration(NavigateParams &navigateParams);
+	void StartEnumeration(const NavigateParams &navigateParams);
+	void CancelEnumeration();
+	static void EnumerateFolderAsync(HWND listView, HWND owner, PCIDLIST_ABSOLUTE pidlDirectory,
+		bool showHidden, FolderEnumerationService *folderEnumerationService,
+		const std::optional<FolderEnumerationService::EnumerationTicket> &enumerationTicket,
+		std::shared_ptr<EnumerationResults> results);
+	static void AddCachedItemsAsync(HWND listView, PCIDLIST_ABSOLUTE pidlDirectory,
+		const FolderEnumerationService::ItemList &cachedItems,
+		FolderEnumerationService::Contents contents, std::shared_ptr<EnumerationResults> results);
+	void ProcessEnumerationBatches(int folderId);
+	void OnEnumerationBatchReceived(std::vector<NewItemInfo_t> &&items);
+	static std::optional<NewItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
+		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static std::optional<FolderEnumerationCache::Item> GetItemDetails(IShellFolder *shellFolder,
 		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static NewItemInfo_t GetItemInformation(PCIDLIST_ABSOLUTE pidlDirectory,
+		const FolderEnumerationCache::Item &item);
+	static void PrewarmTypeNames(const std::vector<NewItemInfo_t> &items);
 	void PrepareToChangeFolders();
 	void ClearPendingResults();
+
+	/* Background tasks. */
+	static uint64_t GetBackgroundTaskId(BackgroundTaskType type, int value);
+	std::optional<std::pair<int, int>> GetVisibleItemRange() const;
+	std::optional<std::unordered_map<int, PriorityTaskScheduler::Priority>> GetItemTaskPriorities()
+		const;
+	void UpdateTaskPriorities();
+	void CancelBackgroundTasks(BackgroundTaskType type);
+	void CancelColumnBatch(int columnResultId);
+	void InvalidateItemImages(std::unordered_set<int> &internalIndexes);
 	void ResetFolderState();
 	void StoreCurrentlySelectedItems();
-	void OnEnumerationCompleted(std::vector<ItemInfo_t> &&items,
-		const NavigateParams &navigateParams);
+	void OnEnumerationCompleted(const NavigateParams &navigateParams);
 	void InsertAwaitingItems();
-	BOOL IsFileFiltered(const ItemInfo_t &itemInfo) const;
+	BOOL IsFileFiltered(int internalIndex) const;
 	std::optional<int> AddItemInternal(IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory,
 		PCITEMID_CHILD pidlChild, int itemIndex, BOOL setPosition);
-	int AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition);
+	int AddItemInternal(int itemIndex, NewItemInfo_t newItemInfo, BOOL setPosition);
+	static ItemStore::ItemDetails GetItemStoreDetails(const NewItemInfo_t &newItemInfo);
 	static HRESULT ExtractFindDataUsingPropertyStore(IShellFolder *shellFolder,
 		PCITEMID_CHILD pidlChild, WIN32_FIND_DATA &output);
 	void SetViewModeInternal(ViewMode viewMode);
@@ -432,8 +612,6 @@ private:
 	LRESULT ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 	LRESULT ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-	static int CALLBACK SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-
 	/* Message handlers. */
 	void ColumnClicked(int iClickedColumn);
 
@@ -485,27 +663,43 @@ private:
 	const ItemInfo_t &GetItemByIndex(int index) const;
 	ItemInfo_t &GetItemByIndex(int index);
 	int GetItemInternalIndex(int item) const;
+	WIN32_FIND_DATA GetItemFindData(int internalIndex) const;
+	bool IsItemFolder(int internalIndex) const;
 
 	BasicItemInfo_t getBasicItemInfo(int internalIndex) const;
 
 	/* Sorting. */
 	void SortFolder();
-	int CALLBACK Sort(int InternalIndex1, int InternalIndex2) const;
+	void SortListViewItems();
+	std::vector<int> GetShownItems() const;
+	void SetListViewItemOrder(const std::vector<int> &items);
+	void MoveItemsToSortedPositions(const std::unordered_set<int> &itemsToMove);
+	std::vector<int> MergeSortedItems(const std::vector<int> &sortedItems,
+		std::vector<int> newItems) const;
+	void SortItems(std::vector<int> &items) const;
+	std::vector<size_t> GetSortedOrder(const std::vector<SortKey> &keys) const;
+	SortKey GetItemSortKey(int internalIndex) const;
+	bool ShouldSortFoldersFirst() const;
+	int CompareSortKeys(const SortKey &key1, const SortKey &key2, bool sortFoldersFirst) const;
+	int Sort(int InternalIndex1, int InternalIndex2) const;
 
 	/* Listview column support. */
 	void AddFirstColumn();
 	void SetUpListViewColumns();
 	void DeleteAllColumns();
 	void QueueColumnTask(int itemInternalIndex, ColumnType columnType);
-	static ColumnResult_t GetColumnTextAsync(HWND listView, int columnResultId,
-		ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-		const GlobalFolderSettings &globalFolderSettings);
+	void QueuePendingColumnRequests();
+	static std::vector<ColumnResult_t> GetColumnTextAsync(HWND listView, int columnResultId,
+		std::vector<ColumnRequest> &columnRequests,
+		const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService);
 	void InsertColumn(ColumnType columnType, int columnIndex, int width);
 	void SetActiveColumnSet();
 	void GetColumnInternal(ColumnType columnType, Column_t *pci) const;
 	Column_t GetFirstCheckedColumn();
 	void SaveColumnWidths();
 	void ProcessColumnResult(int columnResultId);
+	static uint64_t GetColumnTextKey(int internalIndex, ColumnType columnType);
+	int GetColumnTextGeneration(int internalIndex) const;
 	std::optional<int> GetColumnIndexByType(ColumnType columnType) const;
 	std::optional<ColumnType> GetColumnTypeByIndex(int index) const;
 
@@ -517,14 +711,19 @@ private:
 	void StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl);
 	void ProcessShellChangeNotifications(
 		const std::vector<ShellChangeNotification> &shellChangeNotifications);
-	void ProcessShellChangeNotification(const ShellChangeNotification &change);
+	void ProcessShellChangeNotification(const ShellChangeNotification &change,
+		ItemChangeCoalescer &coalescer);
+	void ApplyItemChanges(const ItemChangeCoalescer &coalescer);
+	void InvalidateCachedItems(const std::vector<ItemChangeCoalescer::Change> &changes);
+	size_t GetFullRefreshThreshold() const;
 	void OnItemAdded(PCIDLIST_ABSOLUTE simplePidl);
-	void AddItem(PCIDLIST_ABSOLUTE pidl);
+	std::optional<int> AddNotifiedItem(PCIDLIST_ABSOLUTE simplePidl);
 	void RemoveItem(int iItemInternal);
-	void OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl);
-	void OnItemModified(PCIDLIST_ABSOLUTE simplePidl);
+	void RemoveItems(const std::vector<int> &internalIndexes);
+	void RemoveItemDetails(int internalIndex);
+	bool UpdateNotifiedItem(int internalIndex, PCIDLIST_ABSOLUTE simplePidl, bool renamed);
 	void UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedPidl = nullptr);
-	void OnItemRenamed(PCIDLIST_ABSOLUTE simplePidlOld, PCIDLIST_ABSOLUTE simplePidlNew);
+	bool UpdateItemDetails(int internalIndex, PCIDLIST_ABSOLUTE pidl);
 	void InvalidateAllColumnsForItem(int itemIndex);
 	void InvalidateIconForItem(int itemIndex);
 	int DetermineItemSortedPosition(LPARAM lParam) const;
@@ -540,10 +739,13 @@ private:
 
 	/* Filtering support. */
 	void UpdateFiltering();
-	void RemoveFilteredItems();
+	void ApplyFilter(FilterScope scope);
+	std::vector<uint64_t> BuildFilteredItemBitmap(const std::vector<int> &items) const;
+	bool IsItemFiltered(int internalIndex) const;
+	void ApplyFilterChanges(const std::vector<int> &positionsToFilter,
+		const std::vector<int> &itemsToRestore);
 	void RemoveFilteredItem(int iItem, int iItemInternal);
 	BOOL IsFilenameFiltered(const TCHAR *FileName) const;
-	void UnfilterAllItems();
 	void UnfilterItem(int internalIndex);
 	void RestoreFilteredItem(int internalIndex);
 
@@ -566,7 +768,7 @@ private:
 	std::optional<GroupInfo> DetermineItemAttributeGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemOwnerGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemVersionGroup(const BasicItemInfo_t &itemInfo,
-		const TCHAR *szVersionType) const;
+		VersionInfoType versionInfoType) const;
 	std::optional<GroupInfo> DetermineItemCameraPropertyGroup(const BasicItemInfo_t &itemInfo,
 		PROPID PropertyId) const;
 	std::optional<GroupInfo> DetermineItemExtensionGroup(const BasicItemInfo_t &itemInfo) const;
@@ -587,14 +789,21 @@ private:
 	std::optional<int> GetItemGroupId(int index);
 
 	/* Listview icons. */
+	void QueueIconTask(int internalIndex);
+	void ProcessIconResult(int iconResultId);
 	void ProcessIconResult(int internalIndex, int iconIndex);
-	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
+	std::optional<int> GetCachedIconIndex(int internalIndex);
 
 	/* Thumbnails view. */
 	void QueueThumbnailTask(int internalIndex);
-	std::optional<int> GetCachedThumbnailIndex(const ItemInfo_t &itemInfo);
-	static wil::unique_hbitmap GetThumbnail(PIDLIST_ABSOLUTE pidl, UINT thumbnailSize,
-		WTS_FLAGS flags);
+	std::optional<int> GetCachedThumbnailIndex(int internalIndex);
+	static std::shared_ptr<const ThumbnailBitmap> GetThumbnail(PCIDLIST_ABSOLUTE pidl,
+		const std::wstring &path, std::optional<uint64_t> lastWriteTime, UINT thumbnailSize,
+		ThumbnailCache *thumbnailCache);
+	static std::optional<ThumbnailBitmap> ExtractThumbnail(PCIDLIST_ABSOLUTE pidl,
+		UINT thumbnailSize);
+	static std::optional<uint64_t> GetThumbnailLastWriteTime(const WIN32_FIND_DATA &findData,
+		bool isFindDataValid);
 	void ProcessThumbnailResult(int thumbnailResultId);
 	void SetupThumbnailsView(int shellImageListType);
 	void RemoveThumbnailsView();
@@ -610,6 +819,21 @@ private:
 	void SetTileViewInfo();
 	void SetTileViewItemInfo(int iItem, int iItemInternal);
 
+	/* Owner data support. */
+	void InsertAwaitingItemsOwnerData();
+	void DeleteOwnerDataItem(int index);
+	void RemoveOwnerDataItems(const std::vector<int> &internalIndexes);
+	void SetOwnerDataItems(std::vector<int> &&items);
+	void SortFolderOwnerData();
+	void ApplyFilterChangesOwnerData(const std::vector<int> &positionsToFilter,
+		const std::vector<int> &itemsToRestore);
+	void OnOwnerDataGetDisplayInfo(NMLVDISPINFO *dispInfo);
+	void OnOwnerDataStateChanged(const NMLVODSTATECHANGE *stateChange);
+	int OnOwnerDataFindItem(const NMLVFINDITEM *findItem);
+	void RecalculateSelectionInfo();
+	void RedrawItemByInternalIndex(int internalIndex);
+	std::vector<int> GetSelectedItemInternalIndexes() const;
+
 	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject);
 	void OnClipboardUpdate();
 	void RestoreStateOfCutItems();
@@ -634,11 +858,30 @@ private:
 	std::optional<int> GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
 	std::optional<int> GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
 	std::optional<int> LocateItemByInternalIndex(int internalIndex) const;
+	void AddItemToLookupIndex(int internalIndex);
 	void ApplyHeaderSortArrow();
 
 	HWND m_hListView;
 	HWND m_hOwner;
 
+	// Holds the display name and find data for every item, in either mode. Internal indexes are
+	// allocated in the same way as store indexes, so an item's internal index is also its index
+	// in the store.
+	ItemStore m_itemStore;
+
+	// Set when the listview was created with LVS_OWNERDATA. In that case, the listview only knows
+	// how many items there are. The internal index of the item shown at each position is stored
+	// in m_ownerDataItems.
+	const bool m_ownerData;
+	std::vector<int> m_ownerDataItems;
+	std::unordered_map<int, int> m_ownerDataPositions;
+
+	// When not in owner data mode, this holds the last known position of each item. Since items
+	// move whenever other items are inserted, removed or sorted, each position is only a hint and
+	// is checked before being used. Modifications and renames, which are the bulk of most change
+	// notification bursts, don't move items, so the hints remain valid in that case.
+	mutable std::unordered_map<int, int> m_itemPositionHints;
+
 	std::vector<std::unique_ptr<ShellBrowserHelperBase>> m_helpers;
 
 	NavigationStartedSignal m_navigationStartedSignal;
@@ -666,23 +909,68 @@ private:
 	as display name. */
 	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
 
-	ctpl::thread_pool m_columnThreadPool;
-	std::unordered_map<int, std::future<ColumnResult_t>> m_columnResults;
+	// Allows an item in m_itemInfoMap to be found from its pidl, which is needed each time a change
+	// notification is processed.
+	ItemLookupIndex m_itemLookupIndex;
+
+	// Icons, thumbnails, column text and info tips are all retrieved using this scheduler, which is
+	// shared with the other tabs.
+	PriorityTaskScheduler *const m_taskScheduler;
+
+	std::unordered_map<int, PendingColumnBatch> m_columnResults;
 	int m_columnResultIDCounter;
 
+	// Column text that has been retrieved for items in the current folder. This allows the text to
+	// be reused when the listview asks for it again (e.g. after the items have been sorted, or a
+	// column has been removed and re-added). Only the text for the items that have most recently
+	// been shown is retained, which keeps the memory used bounded, regardless of the number of
+	// items in the folder.
+	LruCache<uint64_t, std::wstring> m_columnTextCache;
+
+	// Columns that have been requested, but not yet retrieved. Requests are collected as the
+	// listview paints and queued together once it's finished.
+	std::unordered_set<uint64_t> m_pendingColumnText;
+	std::vector<std::pair<int, ColumnType>> m_pendingColumnRequests;
+
+	// Incremented each time the columns for an item are invalidated. Text that was being retrieved
+	// when that happened is out of date and is discarded when it arrives. Items that have never
+	// been invalidated aren't included.
+	std::unordered_map<int, int> m_columnTextGenerations;
+	bool m_columnRequestsQueuePending = false;
+
 	std::unique_ptr<IconFetcher> m_iconFetcher;
 	CachedIcons *m_cachedIcons;
+	std::unordered_map<int, PendingItemResult<std::optional<int>>> m_iconResults;
+	int m_iconResultIDCounter = 0;
 
 	IconResourceLoader *m_iconResourceLoader;
 
-	ctpl::thread_pool m_thumbnailThreadPool;
-	std::unordered_map<int, std::future<std::optional<ThumbnailResult_t>>> m_thumbnailResults;
+	std::unordered_map<int, PendingItemResult<std::optional<ThumbnailResult_t>>>
+		m_thumbnailResults;
 	int m_thumbnailResultIDCounter;
 
-	ctpl::thread_pool m_infoTipsThreadPool;
+	// Thumbnails are shared with the other tabs, so that a thumbnail only has to be extracted
+	// once, even if the item is shown in several tabs, or at several sizes.
+	ThumbnailCache *const m_thumbnailCache;
+
 	std::unordered_map<int, std::future<std::optional<InfoTipResult>>> m_infoTipResults;
 	int m_infoTipResultIDCounter;
 
+	WorkStealingExecutor *const m_backgroundExecutor;
+
+	// Folder sizes are shared with the other tabs (and the display window).
+	FolderSizeService *const m_folderSizeService;
+
+	// The items in each folder are shared with the other tabs (and the treeview), so that a folder
+	// that's already been enumerated doesn't need to be enumerated again.
+	FolderEnumerationService *const m_folderEnumerationService;
+
+	// Enumeration tasks run on the shared background executor. They only reference the state that's
+	// passed to them, not this instance.
+	WorkStealingExecutor::TaskGroup m_enumerationTaskGroup;
+	std::shared_ptr<EnumerationResults> m_enumerationResults;
+	std::optional<NavigateParams> m_enumerationNavigateParams;
+
 	/* Internal state. */
 	const HINSTANCE m_resourceInstance;
 	AcceleratorManager *const m_acceleratorManager;
@@ -700,6 +988,15 @@ private:
 	const Config *m_config;
 	FolderSettings m_folderSettings;
 
+	// A compiled version of the filter in m_folderSettings. This is used when checking whether
+	// each item is filtered, so that the filter doesn't need to be parsed for every item.
+	WildcardPattern m_filterPattern;
+
+	// The pattern that the items currently filtered out were checked against. This allows a change
+	// to the filter to be applied incrementally, when the new pattern is a refinement of this one
+	// (or vice versa). It's reset whenever that can no longer be relied upon.
+	std::optional<WildcardPattern> m_appliedFilterPattern;
+
 	/* ID. */
 	std::optional<int> m_ID;
 
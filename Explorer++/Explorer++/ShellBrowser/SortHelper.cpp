@@ -4,236 +4,151 @@
 
 #include "stdafx.h"
 #include "SortHelper.h"
+#include "FolderSizeService.h"
 #include "ItemData.h"
 #include <wil/common.h>
+#include <propkey.h>
 #include <propvarutil.h>
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const GlobalFolderSettings &globalFolderSettings)
+namespace
 {
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
-	{
-		return -1;
-	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		return 1;
-	}
-	else if (itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		/* If the items been compared are both drives,
-		sort by drive letter, rather than display name. */
-		if (globalFolderSettings.useNaturalSortOrder)
-		{
-			return StrCmpLogicalW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
-		else
-		{
-			return StrCmpIW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
-	}
 
-	std::wstring name1 = GetNameColumnText(itemInfo1, globalFolderSettings);
-	std::wstring name2 = GetNameColumnText(itemInfo2, globalFolderSettings);
+uint64_t FileTimeToNumber(const FILETIME &fileTime)
+{
+	return ULARGE_INTEGER{ { fileTime.dwLowDateTime, fileTime.dwHighDateTime } }.QuadPart;
+}
 
-	if (globalFolderSettings.useNaturalSortOrder)
-	{
-		return StrCmpLogicalW(name1.c_str(), name2.c_str());
-	}
-	else
+void SetNameSortKey(SortKey &key, const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings)
+{
+	key.textComparison = globalFolderSettings.useNaturalSortOrder
+		? SortKeyTextComparison::Natural
+		: SortKeyTextComparison::CaseInsensitive;
+
+	// Drives are always sorted before other items and are sorted by drive letter, rather than
+	// display name.
+	if (itemInfo.isRoot)
 	{
-		return StrCmpIW(name1.c_str(), name2.c_str());
+		key.rank = 0;
+		key.text = itemInfo.getFullPath();
+		return;
 	}
+
+	key.rank = 1;
+	key.text = GetNameColumnText(itemInfo, globalFolderSettings);
 }
 
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+void SetSizeSortKey(SortKey &key, const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
 {
-	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
+	if (!itemInfo.isFindDataValid)
 	{
-		return -1;
-	}
-	else if (itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
-	{
-		return 1;
-	}
-	else if (!itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
-	{
-		return 0;
+		key.rank = 0;
+		return;
 	}
 
-	bool isFolder1 = WI_IsFlagSet(itemInfo1.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-	bool isFolder2 = WI_IsFlagSet(itemInfo2.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	key.rank = 1;
 
-	ULONGLONG size1;
-	ULONGLONG size2;
-
-	if (isFolder1 && isFolder2)
+	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
 	{
-		// Temporarily disabled.
-		/*auto itr1 = m_cachedFolderSizes.find(InternalIndex1);
-		auto itr2 = m_cachedFolderSizes.find(InternalIndex2);
+		key.number = 0;
 
-		if (itr1 == m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 0;
-		}
-		else if (itr1 != m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
+		if (globalFolderSettings.showFolderSizes && folderSizeService)
 		{
-			return 1;
-		}
-		else if (itr1 == m_cachedFolderSizes.end() && itr2 != m_cachedFolderSizes.end())
-		{
-			return -1;
-		}
-
-		size1 = itr1->second;
-		size2 = itr2->second;*/
+			auto folderInfo = folderSizeService->GetLastKnownFolderInfo(itemInfo.getFullPath());
 
-		size1 = 0;
-		size2 = 0;
-	}
-	else
-	{
-		// Both items are files (as opposed to folders).
-		ULARGE_INTEGER fileSize1 = { itemInfo1.wfd.nFileSizeLow, itemInfo1.wfd.nFileSizeHigh };
-		ULARGE_INTEGER fileSize2 = { itemInfo2.wfd.nFileSizeLow, itemInfo2.wfd.nFileSizeHigh };
-
-		size1 = fileSize1.QuadPart;
-		size2 = fileSize2.QuadPart;
-	}
+			if (folderInfo)
+			{
+				key.number = folderInfo->size;
+			}
+		}
 
-	if (size1 > size2)
-	{
-		return 1;
-	}
-	else if (size1 < size2)
-	{
-		return -1;
+		return;
 	}
 
-	return 0;
+	key.number =
+		ULARGE_INTEGER{ { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh } }.QuadPart;
 }
 
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+void SetTypeSortKey(SortKey &key, const BasicItemInfo_t &itemInfo)
 {
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
-	{
-		return -1;
-	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		return 1;
-	}
-
-	std::wstring type1 = GetTypeColumnText(itemInfo1);
-	std::wstring type2 = GetTypeColumnText(itemInfo2);
-
-	return StrCmpLogicalW(type1.c_str(), type2.c_str());
+	key.rank = itemInfo.isRoot ? 0 : 1;
+	key.text = GetTypeColumnText(itemInfo);
 }
 
-int SortByDate(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	DateType dateType)
+void SetDateSortKey(SortKey &key, const BasicItemInfo_t &itemInfo, DateType dateType)
 {
-	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
+	if (!itemInfo.isFindDataValid)
 	{
-		return -1;
-	}
-	else if (itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
-	{
-		return 1;
-	}
-	else if (!itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
-	{
-		return 0;
+		key.rank = 0;
+		return;
 	}
 
+	key.rank = 1;
+
 	switch (dateType)
 	{
 	case DateType::Created:
-		return CompareFileTime(&itemInfo1.wfd.ftCreationTime, &itemInfo2.wfd.ftCreationTime);
+		key.number = FileTimeToNumber(itemInfo.wfd.ftCreationTime);
+		break;
 
 	case DateType::Modified:
-		return CompareFileTime(&itemInfo1.wfd.ftLastWriteTime, &itemInfo2.wfd.ftLastWriteTime);
+		key.number = FileTimeToNumber(itemInfo.wfd.ftLastWriteTime);
+		break;
 
 	case DateType::Accessed:
-		return CompareFileTime(&itemInfo1.wfd.ftLastAccessTime, &itemInfo2.wfd.ftLastAccessTime);
+		key.number = FileTimeToNumber(itemInfo.wfd.ftLastAccessTime);
+		break;
 
 	default:
 		assert(false);
 		break;
 	}
-
-	return 0;
 }
 
-int SortByTotalSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	bool TotalSize)
+void SetTotalSizeSortKey(SortKey &key, const BasicItemInfo_t &itemInfo, bool totalSize)
 {
-	ULARGE_INTEGER driveSpace1;
-	BOOL res1 = GetDriveSpaceColumnRawData(itemInfo1, TotalSize, driveSpace1);
+	ULARGE_INTEGER driveSpace;
+	BOOL res = GetDriveSpaceColumnRawData(itemInfo, totalSize, driveSpace);
 
-	ULARGE_INTEGER driveSpace2;
-	BOOL res2 = GetDriveSpaceColumnRawData(itemInfo2, TotalSize, driveSpace2);
-
-	if (res1 && !res2)
-	{
-		return 1;
-	}
-	else if (!res1 && res2)
+	if (!res)
 	{
-		return -1;
-	}
-	else if (!res1 && !res2)
-	{
-		return 0;
+		key.rank = 0;
+		return;
 	}
 
-	if (driveSpace1.QuadPart > driveSpace2.QuadPart)
-	{
-		return 1;
-	}
-	else if (driveSpace1.QuadPart < driveSpace2.QuadPart)
+	key.rank = 1;
+	key.number = driveSpace.QuadPart;
+}
+
+void SetRealSizeSortKey(SortKey &key, const BasicItemInfo_t &itemInfo)
+{
+	ULARGE_INTEGER realFileSize;
+	bool res = GetRealSizeColumnRawData(itemInfo, realFileSize);
+
+	if (!res)
 	{
-		return -1;
+		key.rank = 0;
+		return;
 	}
 
-	return 0;
+	key.rank = 1;
+	key.number = realFileSize.QuadPart;
 }
 
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+void SetItemDetailsSortKey(SortKey &key, const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid)
 {
-	std::wstring attributeString1 = GetAttributeColumnText(itemInfo1);
-	std::wstring attributeString2 = GetAttributeColumnText(itemInfo2);
-
-	return StrCmpLogicalW(attributeString1.c_str(), attributeString2.c_str());
+	HRESULT hr = GetItemDetailsRawData(itemInfo, pscid, &key.variant);
+	key.variantValid = SUCCEEDED(hr);
 }
 
-int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+int CompareNumbers(uint64_t number1, uint64_t number2)
 {
-	ULARGE_INTEGER realFileSize1;
-	bool res1 = GetRealSizeColumnRawData(itemInfo1, realFileSize1);
-
-	ULARGE_INTEGER realFileSize2;
-	bool res2 = GetRealSizeColumnRawData(itemInfo2, realFileSize2);
-
-	if (res1 && !res2)
-	{
-		return 1;
-	}
-	else if (!res1 && res2)
-	{
-		return -1;
-	}
-	else if (!res1 && !res2)
-	{
-		return 0;
-	}
-
-	if (realFileSize1.QuadPart > realFileSize2.QuadPart)
+	if (number1 > number2)
 	{
 		return 1;
 	}
-	else if (realFileSize1.QuadPart < realFileSize2.QuadPart)
+	else if (number1 < number2)
 	{
 		return -1;
 	}
@@ -241,131 +156,310 @@ int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &item
 	return 0;
 }
 
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring shortName1 = GetShortNameColumnText(itemInfo1);
-	std::wstring shortName2 = GetShortNameColumnText(itemInfo2);
-
-	return StrCmpLogicalW(shortName1.c_str(), shortName2.c_str());
 }
 
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+SortKey GetSortKey(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService)
 {
-	std::wstring owner1 = GetOwnerColumnText(itemInfo1);
-	std::wstring owner2 = GetOwnerColumnText(itemInfo2);
+	SortKey key;
+	key.isFolder = WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	key.displayName = itemInfo.szDisplayName;
 
-	return StrCmpLogicalW(owner1.c_str(), owner2.c_str());
-}
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		SetNameSortKey(key, itemInfo, globalFolderSettings);
+		break;
 
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType)
-{
-	std::wstring versionInfo1 = GetVersionColumnText(itemInfo1, versionInfoType);
-	std::wstring versionInfo2 = GetVersionColumnText(itemInfo2, versionInfoType);
+	case SortMode::Type:
+		SetTypeSortKey(key, itemInfo);
+		break;
 
-	return StrCmpLogicalW(versionInfo1.c_str(), versionInfo2.c_str());
-}
+	case SortMode::Size:
+		SetSizeSortKey(key, itemInfo, globalFolderSettings, folderSizeService);
+		break;
 
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring resolvedLinkPath1 = GetShortcutToColumnText(itemInfo1);
-	std::wstring resolvedLinkPath2 = GetShortcutToColumnText(itemInfo2);
+	case SortMode::DateModified:
+		SetDateSortKey(key, itemInfo, DateType::Modified);
+		break;
 
-	return StrCmpLogicalW(resolvedLinkPath1.c_str(), resolvedLinkPath2.c_str());
-}
+	case SortMode::TotalSize:
+		SetTotalSizeSortKey(key, itemInfo, true);
+		break;
 
-int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	DWORD numHardLinks1 = GetHardLinksColumnRawData(itemInfo1);
-	DWORD numHardLinks2 = GetHardLinksColumnRawData(itemInfo2);
+	case SortMode::FreeSpace:
+		SetTotalSizeSortKey(key, itemInfo, false);
+		break;
 
-	return numHardLinks1 - numHardLinks2;
-}
+	case SortMode::DateDeleted:
+		SetItemDetailsSortKey(key, itemInfo, &SCID_DATE_DELETED);
+		break;
 
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring extension1 = GetExtensionColumnText(itemInfo1);
-	std::wstring extension2 = GetExtensionColumnText(itemInfo2);
+	case SortMode::OriginalLocation:
+		SetItemDetailsSortKey(key, itemInfo, &SCID_ORIGINAL_LOCATION);
+		break;
 
-	return StrCmpLogicalW(extension1.c_str(), extension2.c_str());
-}
+	case SortMode::Attributes:
+		key.text = GetAttributeColumnText(itemInfo);
+		break;
 
-int SortByItemDetails(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const SHCOLUMNID *pscid)
-{
-	VARIANT vt1;
-	HRESULT hr1 = GetItemDetailsRawData(itemInfo1, pscid, &vt1);
+	case SortMode::RealSize:
+		SetRealSizeSortKey(key, itemInfo);
+		break;
 
-	VARIANT vt2;
-	HRESULT hr2 = GetItemDetailsRawData(itemInfo2, pscid, &vt2);
+	case SortMode::ShortName:
+		key.text = GetShortNameColumnText(itemInfo);
+		break;
 
-	int ret = 0;
+	case SortMode::Owner:
+		key.text = GetOwnerColumnText(itemInfo);
+		break;
 
-	if (SUCCEEDED(hr1) && SUCCEEDED(hr2) && vt1.vt == vt2.vt)
-	{
-		ret = VariantCompare(vt1, vt2);
-	}
+	case SortMode::ProductName:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductName);
+		break;
 
-	if (SUCCEEDED(hr1))
-	{
-		VariantClear(&vt1);
-	}
+	case SortMode::Company:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Company);
+		break;
 
-	if (SUCCEEDED(hr2))
-	{
-		VariantClear(&vt2);
-	}
+	case SortMode::Description:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Description);
+		break;
 
-	return ret;
-}
+	case SortMode::FileVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::FileVersion);
+		break;
 
-int SortByImageProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PROPID PropertyId)
-{
-	std::wstring imageProperty1 = GetImageColumnText(itemInfo1, PropertyId);
-	std::wstring imageProperty2 = GetImageColumnText(itemInfo2, PropertyId);
+	case SortMode::ProductVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductVersion);
+		break;
 
-	return StrCmpLogicalW(imageProperty1.c_str(), imageProperty2.c_str());
-}
+	case SortMode::ShortcutTo:
+		key.text = GetShortcutToColumnText(itemInfo);
+		break;
 
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring comments1 = GetControlPanelCommentsColumnText(itemInfo1);
-	std::wstring comments2 = GetControlPanelCommentsColumnText(itemInfo2);
+	case SortMode::HardLinks:
+		key.number = GetHardLinksColumnRawData(itemInfo);
+		break;
 
-	return StrCmpLogicalW(comments1.c_str(), comments2.c_str());
-}
+	case SortMode::Extension:
+		key.text = GetExtensionColumnText(itemInfo);
+		break;
 
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring fileSystemName1 = GetFileSystemColumnText(itemInfo1);
-	std::wstring fileSystemName2 = GetFileSystemColumnText(itemInfo2);
+	case SortMode::Created:
+		SetDateSortKey(key, itemInfo, DateType::Created);
+		break;
 
-	return StrCmpLogicalW(fileSystemName1.c_str(), fileSystemName2.c_str());
-}
+	case SortMode::Accessed:
+		SetDateSortKey(key, itemInfo, DateType::Accessed);
+		break;
 
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType)
-{
-	std::wstring printerInformation1 = GetPrinterColumnText(itemInfo1, printerInformationType);
-	std::wstring printerInformation2 = GetPrinterColumnText(itemInfo2, printerInformationType);
+	case SortMode::Title:
+		SetItemDetailsSortKey(key, itemInfo, &PKEY_Title);
+		break;
 
-	return StrCmpLogicalW(printerInformation1.c_str(), printerInformation2.c_str());
-}
+	case SortMode::Subject:
+		SetItemDetailsSortKey(key, itemInfo, &PKEY_Subject);
+		break;
 
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring status1 = GetNetworkAdapterColumnText(itemInfo1);
-	std::wstring status2 = GetNetworkAdapterColumnText(itemInfo2);
+	case SortMode::Authors:
+		SetItemDetailsSortKey(key, itemInfo, &PKEY_Author);
+		break;
+
+	case SortMode::Keywords:
+		SetItemDetailsSortKey(key, itemInfo, &PKEY_Keywords);
+		break;
+
+	case SortMode::Comments:
+		SetItemDetailsSortKey(key, itemInfo, &PKEY_Comment);
+		break;
+
+	case SortMode::CameraModel:
+		key.text = GetImageColumnText(itemInfo, PropertyTagEquipModel);
+		break;
+
+	case SortMode::DateTaken:
+		key.text = GetImageColumnText(itemInfo, PropertyTagDateTime);
+		break;
+
+	case SortMode::Width:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageWidth);
+		break;
+
+	case SortMode::Height:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageHeight);
+		break;
+
+	case SortMode::VirtualComments:
+		key.text = GetControlPanelCommentsColumnText(itemInfo);
+		break;
+
+	case SortMode::FileSystem:
+		key.text = GetFileSystemColumnText(itemInfo);
+		break;
+
+	case SortMode::NumPrinterDocuments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::NumJobs);
+		break;
+
+	case SortMode::PrinterStatus:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Status);
+		break;
+
+	case SortMode::PrinterComments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Comments);
+		break;
+
+	case SortMode::PrinterLocation:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Location);
+		break;
+
+	case SortMode::NetworkAdapterStatus:
+		key.text = GetNetworkAdapterColumnText(itemInfo);
+		break;
+
+	case SortMode::MediaBitrate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Bitrate);
+		break;
+
+	case SortMode::MediaCopyright:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Copyright);
+		break;
+
+	case SortMode::MediaDuration:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Duration);
+		break;
+
+	case SortMode::MediaProtected:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Protected);
+		break;
+
+	case SortMode::MediaRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Rating);
+		break;
+
+	case SortMode::MediaAlbumArtist:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumArtist);
+		break;
 
-	return StrCmpLogicalW(status1.c_str(), status2.c_str());
+	case SortMode::MediaAlbum:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumTitle);
+		break;
+
+	case SortMode::MediaBeatsPerMinute:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BeatsPerMinute);
+		break;
+
+	case SortMode::MediaComposer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Composer);
+		break;
+
+	case SortMode::MediaConductor:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Conductor);
+		break;
+
+	case SortMode::MediaDirector:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Director);
+		break;
+
+	case SortMode::MediaGenre:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Genre);
+		break;
+
+	case SortMode::MediaLanguage:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Language);
+		break;
+
+	case SortMode::MediaBroadcastDate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BroadcastDate);
+		break;
+
+	case SortMode::MediaChannel:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Channel);
+		break;
+
+	case SortMode::MediaStationName:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::StationName);
+		break;
+
+	case SortMode::MediaMood:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Mood);
+		break;
+
+	case SortMode::MediaParentalRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRating);
+		break;
+
+	case SortMode::MediaParentalRatingReason:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRatingReason);
+		break;
+
+	case SortMode::MediaPeriod:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Period);
+		break;
+
+	case SortMode::MediaProducer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Producer);
+		break;
+
+	case SortMode::MediaPublisher:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Publisher);
+		break;
+
+	case SortMode::MediaWriter:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Writer);
+		break;
+
+	case SortMode::MediaYear:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Year);
+		break;
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return key;
 }
 
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType)
+int CompareSortKeyValues(const SortKey &key1, const SortKey &key2)
 {
-	std::wstring mediaMetadata1 = GetMediaMetadataColumnText(itemInfo1, mediaMetadataType);
-	std::wstring mediaMetadata2 = GetMediaMetadataColumnText(itemInfo2, mediaMetadataType);
+	if (key1.rank != key2.rank)
+	{
+		return key1.rank < key2.rank ? -1 : 1;
+	}
+
+	int comparisonResult = CompareNumbers(key1.number, key2.number);
+
+	if (comparisonResult != 0)
+	{
+		return comparisonResult;
+	}
 
-	return StrCmpLogicalW(mediaMetadata1.c_str(), mediaMetadata2.c_str());
+	if (!key1.text.empty() || !key2.text.empty())
+	{
+		if (key1.textComparison == SortKeyTextComparison::CaseInsensitive)
+		{
+			comparisonResult = StrCmpIW(key1.text.c_str(), key2.text.c_str());
+		}
+		else
+		{
+			comparisonResult = StrCmpLogicalW(key1.text.c_str(), key2.text.c_str());
+		}
+
+		if (comparisonResult != 0)
+		{
+			return comparisonResult;
+		}
+	}
+
+	// Property values of different types can't be meaningfully compared, so they're treated as
+	// being equal.
+	if (key1.variantValid && key2.variantValid && key1.variant.vt == key2.variant.vt)
+	{
+		return VariantCompare(key1.variant, key2.variant);
+	}
+
+	return 0;
 }
@@ -6,8 +6,12 @@
 
 #include "ColumnDataRetrieval.h"
 #include "FolderSettings.h"
+#include "SortModes.h"
+#include <wil/resource.h>
+#include <string>
 
 struct BasicItemInfo_t;
+class FolderSizeService;
 
 enum class DateType
 {
@@ -16,31 +20,50 @@ enum class DateType
 	Accessed
 };
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const GlobalFolderSettings &globalFolderSettings);
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByDate(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	DateType dateType);
-int SortByTotalSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	bool TotalSize);
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType);
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByItemDetails(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const SHCOLUMNID *pscid);
-int SortByImageProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PROPID PropertyId);
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType);
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType);
+enum class SortKeyTextComparison
+{
+	// Compares strings using StrCmpLogicalW (i.e. numbers within the strings are compared by
+	// value).
+	Natural,
+
+	// Compares strings using StrCmpIW.
+	CaseInsensitive
+};
+
+// The value that an item is sorted on, for a particular sort mode. Retrieving that value can be
+// expensive (e.g. it may involve building a display string, or reading from the file), so it's
+// retrieved once per item, before sorting. Comparing two keys is then cheap and doesn't require any
+// memory to be allocated.
+struct SortKey
+{
+	SortKey() = default;
+	SortKey(SortKey &&) = default;
+	SortKey &operator=(SortKey &&) = default;
+
+	bool isFolder = false;
+
+	// Keys are ordered by rank before anything else. That's used to place items without a value
+	// (e.g. items without valid find data, when sorting by size) before items that have a value.
+	int rank = 0;
+
+	uint64_t number = 0;
+
+	std::wstring text;
+	SortKeyTextComparison textComparison = SortKeyTextComparison::Natural;
+
+	// Only set when sorting on an item details property.
+	wil::unique_variant variant;
+	bool variantValid = false;
+
+	// Items with equal values are sub-sorted by their display names.
+	std::wstring displayName;
+};
+
+// Folder sizes are only retrieved from the cache (since they can take a long time to calculate), so
+// a folder whose size hasn't been calculated yet is treated as being empty.
+SortKey GetSortKey(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings, FolderSizeService *folderSizeService);
+
+// Compares the sort values of two keys. Whether each item is a folder and the item display names
+// aren't taken into account here.
+int CompareSortKeyValues(const SortKey &key1, const SortKey &key2);
@@ -9,13 +9,34 @@
 #include "SortHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
-#include <propkey.h>
-#include <cassert>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <optional>
+
+namespace
+{
+
+// Used to move the items in the listview into an order that's already been determined. The sort
+// parameter is a vector mapping each item's internal index to its position.
+int CALLBACK SortByPositionStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+{
+	const auto *positions = reinterpret_cast<const std::vector<int> *>(lParamSort);
+	return (*positions)[lParam1] - (*positions)[lParam2];
+}
+
+}
 
 void ShellBrowserImpl::SortFolder()
 {
-	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(this),
-		reinterpret_cast<LPARAM>(SortStub));
+	if (m_ownerData)
+	{
+		SortFolderOwnerData();
+	}
+	else
+	{
+		SortListViewItems();
+	}
 
 	if (m_folderSettings.viewMode == +ViewMode::Details)
 	{
@@ -23,337 +44,234 @@ void ShellBrowserImpl::SortFolder()
 	}
 }
 
-int CALLBACK ShellBrowserImpl::SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+// The listview owns its items, so there's no way of directly setting the order they're shown in.
+// Instead, the final order is determined first, with LVM_SORTITEMS then used to move each item
+// into place. As each comparison the listview makes is then a simple lookup, that's cheap.
+void ShellBrowserImpl::SortListViewItems()
 {
-	auto *pShellBrowser = reinterpret_cast<ShellBrowserImpl *>(lParamSort);
-	return pShellBrowser->Sort(static_cast<int>(lParam1), static_cast<int>(lParam2));
+	auto items = GetShownItems();
+	SortItems(items);
+	SetListViewItemOrder(items);
 }
 
-/* Also see NBookmarkHelper::Sort. */
-int CALLBACK ShellBrowserImpl::Sort(int InternalIndex1, int InternalIndex2) const
+// Returns the internal index of each item in the listview, in the order in which the items are
+// currently shown.
+std::vector<int> ShellBrowserImpl::GetShownItems() const
 {
-	int comparisonResult = 0;
+	if (m_ownerData)
+	{
+		return m_ownerDataItems;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::vector<int> items;
+	items.reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		items.push_back(GetItemInternalIndex(i));
+	}
+
+	return items;
+}
+
+void ShellBrowserImpl::SetListViewItemOrder(const std::vector<int> &items)
+{
+	// Internal indexes are allocated sequentially for each folder, so they can be used to index
+	// into a vector directly.
+	std::vector<int> positions(m_directoryState.itemIDCounter);
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		positions[items[i]] = static_cast<int>(i);
+	}
+
+	ListView_SortItems(m_hListView, SortByPositionStub, reinterpret_cast<LPARAM>(&positions));
+}
 
-	BasicItemInfo_t basicItemInfo1 = getBasicItemInfo(InternalIndex1);
-	BasicItemInfo_t basicItemInfo2 = getBasicItemInfo(InternalIndex2);
-
-	bool isFolder1 = ((basicItemInfo1.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
-	bool isFolder2 = ((basicItemInfo2.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
-
-	/* Folders will by default be sorted separately from files,
-	except in the recycle bin. */
-	if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && isFolder1 && !isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+// Moves each of the specified items (which should all be shown) to its sorted position. The
+// remaining items are already in sorted order, so the specified items are sorted on their own and
+// then merged in, which avoids having to retrieve the sort key for every item in the folder.
+void ShellBrowserImpl::MoveItemsToSortedPositions(const std::unordered_set<int> &itemsToMove)
+{
+	// Unless new items are inserted in their sorted positions, there may be items that have been
+	// appended to the end of the view, in which case the view as a whole isn't sorted and merging
+	// isn't possible.
+	if (!m_config->globalFolderSettings.insertSorted)
 	{
-		comparisonResult = -1;
+		if (m_ownerData)
+		{
+			SortFolderOwnerData();
+		}
+		else
+		{
+			SortListViewItems();
+		}
+
+		return;
 	}
-	else if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && !isFolder1 && isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+
+	std::vector<int> sortedItems;
+	std::vector<int> newItems;
+
+	for (int internalIndex : GetShownItems())
 	{
-		comparisonResult = 1;
+		if (itemsToMove.contains(internalIndex))
+		{
+			newItems.push_back(internalIndex);
+		}
+		else
+		{
+			sortedItems.push_back(internalIndex);
+		}
+	}
+
+	auto mergedItems = MergeSortedItems(sortedItems, std::move(newItems));
+
+	if (m_ownerData)
+	{
+		SetOwnerDataItems(std::move(mergedItems));
 	}
 	else
 	{
-		switch (m_folderSettings.sortMode)
+		SetListViewItemOrder(mergedItems);
+	}
+}
+
+// Merges a set of unsorted items into a set of sorted items. The position of each new item is
+// found with a binary search, so sort keys are only retrieved for the new items and the items
+// they're compared against. Each key is retrieved at most once, with the keys for the sorted
+// items being cached as they're needed.
+std::vector<int> ShellBrowserImpl::MergeSortedItems(const std::vector<int> &sortedItems,
+	std::vector<int> newItems) const
+{
+	std::vector<SortKey> newItemKeys;
+	newItemKeys.reserve(newItems.size());
+
+	for (int internalIndex : newItems)
+	{
+		newItemKeys.push_back(GetItemSortKey(internalIndex));
+	}
+
+	bool sortFoldersFirst = ShouldSortFoldersFirst();
+
+	std::vector<std::optional<SortKey>> sortedItemKeys(sortedItems.size());
+
+	auto getSortedItemKey = [this, &sortedItems, &sortedItemKeys](size_t index) -> const SortKey &
+	{
+		if (!sortedItemKeys[index])
+		{
+			sortedItemKeys[index] = GetItemSortKey(sortedItems[index]);
+		}
+
+		return *sortedItemKeys[index];
+	};
+
+	std::vector<int> mergedItems;
+	mergedItems.reserve(sortedItems.size() + newItems.size());
+
+	size_t remainingStart = 0;
+
+	for (size_t newItemIndex : GetSortedOrder(newItemKeys))
+	{
+		const SortKey &newItemKey = newItemKeys[newItemIndex];
+
+		// Finds the first sorted item that should be shown after the new item.
+		size_t low = remainingStart;
+		size_t high = sortedItems.size();
+
+		while (low < high)
 		{
-		case SortMode::Name:
-			comparisonResult =
-				SortByName(basicItemInfo1, basicItemInfo2, m_config->globalFolderSettings);
-			break;
-
-		case SortMode::Type:
-			comparisonResult = SortByType(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Size:
-			comparisonResult = SortBySize(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::DateModified:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Modified);
-			break;
-
-		case SortMode::TotalSize:
-			comparisonResult = SortByTotalSize(basicItemInfo1, basicItemInfo2, TRUE);
-			break;
-
-		case SortMode::FreeSpace:
-			comparisonResult = SortByTotalSize(basicItemInfo1, basicItemInfo2, FALSE);
-			break;
-
-		case SortMode::DateDeleted:
-			comparisonResult =
-				SortByItemDetails(basicItemInfo1, basicItemInfo2, &SCID_DATE_DELETED);
-			break;
-
-		case SortMode::OriginalLocation:
-			comparisonResult =
-				SortByItemDetails(basicItemInfo1, basicItemInfo2, &SCID_ORIGINAL_LOCATION);
-			break;
-
-		case SortMode::Attributes:
-			comparisonResult = SortByAttributes(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::RealSize:
-			comparisonResult = SortByRealSize(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::ShortName:
-			comparisonResult = SortByShortName(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Owner:
-			comparisonResult = SortByOwner(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::ProductName:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductName);
-			break;
-
-		case SortMode::Company:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Company);
-			break;
-
-		case SortMode::Description:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Description);
-			break;
-
-		case SortMode::FileVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::FileVersion);
-			break;
-
-		case SortMode::ProductVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductVersion);
-			break;
-
-		case SortMode::ShortcutTo:
-			comparisonResult = SortByShortcutTo(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::HardLinks:
-			comparisonResult = SortByHardlinks(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Extension:
-			comparisonResult = SortByExtension(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Created:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Created);
-			break;
-
-		case SortMode::Accessed:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Accessed);
-			break;
-
-		case SortMode::Title:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Title);
-			break;
-
-		case SortMode::Subject:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Subject);
-			break;
-
-		case SortMode::Authors:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Author);
-			break;
-
-		case SortMode::Keywords:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Keywords);
-			break;
-
-		case SortMode::Comments:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Comment);
-			break;
-
-		case SortMode::CameraModel:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagEquipModel);
-			break;
-
-		case SortMode::DateTaken:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagDateTime);
-			break;
-
-		case SortMode::Width:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageWidth);
-			break;
-
-		case SortMode::Height:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageHeight);
-			break;
-
-		case SortMode::VirtualComments:
-			comparisonResult = SortByVirtualComments(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::FileSystem:
-			comparisonResult = SortByFileSystem(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::NumPrinterDocuments:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::NumJobs);
-			break;
-
-		case SortMode::PrinterStatus:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Status);
-			break;
-
-		case SortMode::PrinterComments:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Comments);
-			break;
-
-		case SortMode::PrinterLocation:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Location);
-			break;
-
-		case SortMode::NetworkAdapterStatus:
-			comparisonResult = SortByNetworkAdapterStatus(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::MediaBitrate:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Bitrate);
-			break;
-
-		case SortMode::MediaCopyright:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Copyright);
-			break;
-
-		case SortMode::MediaDuration:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Duration);
-			break;
-
-		case SortMode::MediaProtected:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Protected);
-			break;
-
-		case SortMode::MediaRating:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Rating);
-			break;
-
-		case SortMode::MediaAlbumArtist:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumArtist);
-			break;
-
-		case SortMode::MediaAlbum:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumTitle);
-			break;
-
-		case SortMode::MediaBeatsPerMinute:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::BeatsPerMinute);
-			break;
-
-		case SortMode::MediaComposer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Composer);
-			break;
-
-		case SortMode::MediaConductor:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Conductor);
-			break;
-
-		case SortMode::MediaDirector:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Director);
-			break;
-
-		case SortMode::MediaGenre:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Genre);
-			break;
-
-		case SortMode::MediaLanguage:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Language);
-			break;
-
-		case SortMode::MediaBroadcastDate:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::BroadcastDate);
-			break;
-
-		case SortMode::MediaChannel:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Channel);
-			break;
-
-		case SortMode::MediaStationName:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::StationName);
-			break;
-
-		case SortMode::MediaMood:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Mood);
-			break;
-
-		case SortMode::MediaParentalRating:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::ParentalRating);
-			break;
-
-		case SortMode::MediaParentalRatingReason:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::ParentalRatingReason);
-			break;
-
-		case SortMode::MediaPeriod:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Period);
-			break;
-
-		case SortMode::MediaProducer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Producer);
-			break;
-
-		case SortMode::MediaPublisher:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Publisher);
-			break;
-
-		case SortMode::MediaWriter:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Writer);
-			break;
-
-		case SortMode::MediaYear:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Year);
-			break;
-
-		default:
-			assert(false);
-			break;
+			size_t mid = low + (high - low) / 2;
+
+			if (CompareSortKeys(newItemKey, getSortedItemKey(mid), sortFoldersFirst) < 0)
+			{
+				high = mid;
+			}
+			else
+			{
+				low = mid + 1;
+			}
 		}
+
+		mergedItems.insert(mergedItems.end(), sortedItems.begin() + remainingStart,
+			sortedItems.begin() + low);
+		mergedItems.push_back(newItems[newItemIndex]);
+		remainingStart = low;
+	}
+
+	mergedItems.insert(mergedItems.end(), sortedItems.begin() + remainingStart, sortedItems.end());
+
+	return mergedItems;
+}
+
+// Sorts the provided set of items (each of which is identified by its internal index). Retrieving
+// the value an item is sorted on can be expensive, so a key is generated for each item up front.
+void ShellBrowserImpl::SortItems(std::vector<int> &items) const
+{
+	std::vector<SortKey> keys;
+	keys.reserve(items.size());
+
+	for (int internalIndex : items)
+	{
+		keys.push_back(GetItemSortKey(internalIndex));
+	}
+
+	std::vector<int> sortedItems;
+	sortedItems.reserve(items.size());
+
+	for (size_t index : GetSortedOrder(keys))
+	{
+		sortedItems.push_back(items[index]);
+	}
+
+	items = std::move(sortedItems);
+}
+
+// Returns the indexes of the provided keys, in sorted order. The keys are sorted in parallel, with
+// each comparison being a cheap operation that doesn't allocate.
+std::vector<size_t> ShellBrowserImpl::GetSortedOrder(const std::vector<SortKey> &keys) const
+{
+	bool sortFoldersFirst = ShouldSortFoldersFirst();
+
+	std::vector<size_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::stable_sort(std::execution::par, order.begin(), order.end(),
+		[this, &keys, sortFoldersFirst](size_t index1, size_t index2)
+		{ return CompareSortKeys(keys[index1], keys[index2], sortFoldersFirst) < 0; });
+
+	return order;
+}
+
+SortKey ShellBrowserImpl::GetItemSortKey(int internalIndex) const
+{
+	return GetSortKey(getBasicItemInfo(internalIndex), m_folderSettings.sortMode,
+		m_config->globalFolderSettings, m_folderSizeService);
+}
+
+/* Folders will by default be sorted separately from files,
+except in the recycle bin. */
+bool ShellBrowserImpl::ShouldSortFoldersFirst() const
+{
+	return !m_config->globalFolderSettings.displayMixedFilesAndFolders
+		&& !CompareVirtualFolders(CSIDL_BITBUCKET);
+}
+
+/* Also see NBookmarkHelper::Sort. */
+int ShellBrowserImpl::CompareSortKeys(const SortKey &key1, const SortKey &key2,
+	bool sortFoldersFirst) const
+{
+	int comparisonResult = 0;
+
+	if (sortFoldersFirst && key1.isFolder != key2.isFolder)
+	{
+		comparisonResult = key1.isFolder ? -1 : 1;
+	}
+	else
+	{
+		comparisonResult = CompareSortKeyValues(key1, key2);
 	}
 
 	if (comparisonResult == 0)
@@ -362,12 +280,11 @@ int CALLBACK ShellBrowserImpl::Sort(int InternalIndex1, int InternalIndex2) cons
 		by their display names. */
 		if (m_config->globalFolderSettings.useNaturalSortOrder)
 		{
-			comparisonResult =
-				StrCmpLogicalW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+			comparisonResult = StrCmpLogicalW(key1.displayName.c_str(), key2.displayName.c_str());
 		}
 		else
 		{
-			comparisonResult = StrCmpIW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+			comparisonResult = StrCmpIW(key1.displayName.c_str(), key2.displayName.c_str());
 		}
 	}
 
@@ -378,3 +295,9 @@ int CALLBACK ShellBrowserImpl::Sort(int InternalIndex1, int InternalIndex2) cons
 
 	return comparisonResult;
 }
+
+int ShellBrowserImpl::Sort(int InternalIndex1, int InternalIndex2) const
+{
+	return CompareSortKeys(GetItemSortKey(InternalIndex1), GetItemSortKey(InternalIndex2),
+		ShouldSortFoldersFirst());
+}
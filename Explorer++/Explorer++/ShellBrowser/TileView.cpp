@@ -35,6 +35,13 @@ void ShellBrowserImpl::SetTileViewInfo()
 	int nItems;
 	int i = 0;
 
+	// Tile subitem information is stored by the listview for each item, which isn't possible in
+	// owner data mode. Only the name will be shown.
+	if (m_ownerData)
+	{
+		return;
+	}
+
 	nItems = ListView_GetItemCount(m_hListView);
 
 	for (i = 0; i < nItems; i++)
@@ -72,16 +79,13 @@ void ShellBrowserImpl::SetTileViewItemInfo(int iItem, int iItemInternal)
 
 	ListView_SetItemText(m_hListView, iItem, 1, shfi.szTypeName);
 
-	if ((m_itemInfoMap.at(iItemInternal).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		!= FILE_ATTRIBUTE_DIRECTORY)
+	if (!IsItemFolder(iItemInternal))
 	{
-		ULARGE_INTEGER fileSize = { m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow,
-			m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh };
-
 		auto displayFormat = m_config->globalFolderSettings.forceSize
 			? m_config->globalFolderSettings.sizeDisplayFormat
 			: +SizeDisplayFormat::None;
-		std::wstring fileSizeText = FormatSizeString(fileSize.QuadPart, displayFormat);
+		std::wstring fileSizeText =
+			FormatSizeString(m_itemStore.GetSize(iItemInternal), displayFormat);
 		ListView_SetItemText(m_hListView, iItem, 2, fileSizeText.data());
 	}
 }
@@ -10,28 +10,79 @@
 HRESULT ShellEnumerator::EnumerateDirectory(IShellFolder *shellFolder, HWND embedder, Flags flags,
 	std::vector<PidlChild> &outputItems)
 {
-	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
+	wil::com_ptr_nothrow<IEnumIDList> enumerator;
+	HRESULT hr = StartEnumeration(shellFolder, embedder, flags, enumerator);
 
-	if (WI_IsFlagSet(flags, Flags::IncludeHidden))
+	if (FAILED(hr) || !enumerator)
 	{
-		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+		return hr;
+	}
+
+	ULONG numFetched = 1;
+	unique_pidl_child pidlItem;
+
+	while (enumerator->Next(1, wil::out_param(pidlItem), &numFetched) == S_OK && (numFetched == 1))
+	{
+		outputItems.emplace_back(pidlItem.get());
 	}
 
+	return S_OK;
+}
+
+HRESULT ShellEnumerator::EnumerateDirectoryInBatches(IShellFolder *shellFolder, HWND embedder,
+	Flags flags, size_t batchSize, BatchCallback callback)
+{
+	DCHECK_GT(batchSize, 0u);
+
 	wil::com_ptr_nothrow<IEnumIDList> enumerator;
-	HRESULT hr = shellFolder->EnumObjects(embedder, enumFlags, &enumerator);
+	HRESULT hr = StartEnumeration(shellFolder, embedder, flags, enumerator);
 
 	if (FAILED(hr) || !enumerator)
 	{
 		return hr;
 	}
 
+	std::vector<PidlChild> batch;
+	batch.reserve(batchSize);
+
 	ULONG numFetched = 1;
 	unique_pidl_child pidlItem;
 
+	// Note that items are still retrieved one at a time here. Although IEnumIDList::Next() allows
+	// multiple items to be requested at once, not all shell folders support that.
 	while (enumerator->Next(1, wil::out_param(pidlItem), &numFetched) == S_OK && (numFetched == 1))
 	{
-		outputItems.emplace_back(pidlItem.get());
+		batch.emplace_back(pidlItem.get());
+
+		if (batch.size() == batchSize)
+		{
+			if (!callback(std::move(batch)))
+			{
+				return S_OK;
+			}
+
+			batch.clear();
+			batch.reserve(batchSize);
+		}
+	}
+
+	if (!batch.empty())
+	{
+		callback(std::move(batch));
 	}
 
 	return S_OK;
 }
+
+HRESULT ShellEnumerator::StartEnumeration(IShellFolder *shellFolder, HWND embedder, Flags flags,
+	wil::com_ptr_nothrow<IEnumIDList> &enumerator)
+{
+	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
+
+	if (WI_IsFlagSet(flags, Flags::IncludeHidden))
+	{
+		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+	}
+
+	return shellFolder->EnumObjects(embedder, enumFlags, &enumerator);
+}
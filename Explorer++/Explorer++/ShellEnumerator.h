@@ -5,7 +5,9 @@
 #pragma once
 
 #include "../Helper/PidlHelper.h"
+#include <wil/com.h>
 #include <shobjidl_core.h>
+#include <functional>
 #include <vector>
 
 class ShellEnumerator
@@ -20,8 +22,22 @@ public:
 		IncludeHidden = 1 << 0
 	};
 
+	// Called with each batch of items that's retrieved. If the callback returns false, the
+	// enumeration will be stopped.
+	using BatchCallback = std::function<bool(std::vector<PidlChild> &&batch)>;
+
 	HRESULT EnumerateDirectory(IShellFolder *shellFolder, HWND embedder, Flags flags,
 		std::vector<PidlChild> &outputItems);
+
+	// Enumerates the directory, passing the items found to the callback in batches of (at most)
+	// batchSize items. This allows the caller to start processing items before the enumeration has
+	// finished, which is useful for large folders.
+	HRESULT EnumerateDirectoryInBatches(IShellFolder *shellFolder, HWND embedder, Flags flags,
+		size_t batchSize, BatchCallback callback);
+
+private:
+	static HRESULT StartEnumeration(IShellFolder *shellFolder, HWND embedder, Flags flags,
+		wil::com_ptr_nothrow<IEnumIDList> &enumerator);
 };
 
 DEFINE_ENUM_FLAG_OPERATORS(ShellEnumerator::Flags);
@@ -89,6 +89,11 @@ void ShellTreeView::ProcessShellChangeNotifications(
 
 void ShellTreeView::ProcessShellChangeNotification(const ShellChangeNotification &change)
 {
+	if (QueueChangeForPendingEnumeration(change))
+	{
+		return;
+	}
+
 	switch (change.event)
 	{
 	case SHCNE_DRIVEADD:
@@ -115,6 +120,86 @@ void ShellTreeView::ProcessShellChangeNotification(const ShellChangeNotification
 	}
 }
 
+// While a folder is being enumerated, its children can't be updated in place, since they haven't
+// been added yet. Any changes to them are therefore held until the enumeration has finished.
+// Dropping them instead would mean that a change made after the folder's contents were retrieved
+// (but before they were shown) would be lost.
+bool ShellTreeView::QueueChangeForPendingEnumeration(const ShellChangeNotification &change)
+{
+	if (change.event == SHCNE_UPDATEDIR || !change.pidl1)
+	{
+		return false;
+	}
+
+	// An item that's been renamed may also have been moved into a folder that's being enumerated.
+	auto *pendingEnumeration = GetPendingEnumerationForParent(change.pidl1.get());
+
+	if (!pendingEnumeration && change.event == SHCNE_RENAMEFOLDER && change.pidl2)
+	{
+		pendingEnumeration = GetPendingEnumerationForParent(change.pidl2.get());
+	}
+
+	if (!pendingEnumeration)
+	{
+		return false;
+	}
+
+	pendingEnumeration->queuedChanges.emplace_back(change.event, change.pidl1.get(),
+		change.pidl2.get());
+	return true;
+}
+
+ShellTreeView::PendingEnumeration *ShellTreeView::GetPendingEnumerationForParent(
+	PCIDLIST_ABSOLUTE simplePidl)
+{
+	if (m_pendingEnumerations.empty())
+	{
+		return nullptr;
+	}
+
+	unique_pidl_absolute parent(ILCloneFull(simplePidl));
+
+	if (!ILRemoveLastID(parent.get()))
+	{
+		return nullptr;
+	}
+
+	auto parentItem = LocateExistingItem(parent.get());
+
+	if (!parentItem)
+	{
+		return nullptr;
+	}
+
+	auto itr = std::find_if(m_pendingEnumerations.begin(), m_pendingEnumerations.end(),
+		[nodeId = GetNodeFromTreeViewItem(parentItem)->GetId()](const auto &entry)
+		{ return entry.second.nodeId == nodeId; });
+
+	if (itr == m_pendingEnumerations.end())
+	{
+		return nullptr;
+	}
+
+	return &itr->second;
+}
+
+// The enumeration results may or may not reflect each of the queued changes, depending on when
+// the folder's contents were retrieved. Items that are already present aren't added again, while
+// removals and renames are simply ignored if the original item isn't present.
+void ShellTreeView::ApplyQueuedChanges(const std::vector<ShellChangeNotification> &queuedChanges)
+{
+	for (const auto &change : queuedChanges)
+	{
+		if ((change.event == SHCNE_MKDIR || change.event == SHCNE_DRIVEADD)
+			&& LocateExistingItem(change.pidl1.get()))
+		{
+			continue;
+		}
+
+		ProcessShellChangeNotification(change);
+	}
+}
+
 void ShellTreeView::OnItemAdded(PCIDLIST_ABSOLUTE simplePidl)
 {
 	auto existingItem = LocateExistingItem(simplePidl);
@@ -256,6 +341,7 @@ void ShellTreeView::OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl)
 void ShellTreeView::RemoveItem(HTREEITEM item)
 {
 	auto *node = GetNodeFromTreeViewItem(item);
+	CancelEnumerationsForNodeAndChildren(node);
 	StopDirectoryMonitoringForNodeAndChildren(node);
 
 	auto parent = TreeView_GetParent(m_hTreeView, item);
@@ -329,6 +415,7 @@ void ShellTreeView::OnDirectoryUpdated(PCIDLIST_ABSOLUTE simplePidl)
 		selectedItemPidl = selectedNode->GetFullPidl();
 	}
 
+	CancelEnumerationsForNodeAndChildren(quickAccessRootNode);
 	StopDirectoryMonitoringForNodeAndChildren(quickAccessRootNode);
 	quickAccessRootNode->RemoveAllChildren();
 
@@ -338,15 +425,12 @@ void ShellTreeView::OnDirectoryUpdated(PCIDLIST_ABSOLUTE simplePidl)
 	SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND,
 		reinterpret_cast<LPARAM>(m_quickAccessRootItem));
 
-	if (selectedItemPidl)
+	// The quick access folder is enumerated asynchronously, so the previously selected item will
+	// be reselected once it's been added back. Note that the item might not exist anymore (e.g. if
+	// the selection was a pinned item that has been unpinned), in which case the selection won't be
+	// changed. A selection that's already pending takes priority.
+	if (selectedItemPidl && !m_pendingSelectionPidl)
 	{
-		auto previouslySelectedItem = LocateExistingItem(selectedItemPidl.get());
-
-		// The previously selected item might not exist anymore (e.g. if the selection was a pinned
-		// item that has been unpinned).
-		if (previouslySelectedItem)
-		{
-			TreeView_SelectItem(m_hTreeView, previouslySelectedItem);
-		}
+		SelectItemAsync(selectedItemPidl.get());
 	}
 }
@@ -21,7 +21,8 @@ HTREEITEM ShellTreeView::GetDropTargetItem(const POINT &pt)
 	hitTestInfo.pt = ptClient;
 	HTREEITEM item = TreeView_HitTest(m_hTreeView, &hitTestInfo);
 
-	if (!item)
+	// Nothing can be dropped on the placeholder item.
+	if (!item || IsPlaceholderItem(item))
 	{
 		return nullptr;
 	}
@@ -58,12 +58,12 @@ ShellTreeView::ShellTreeView(HWND hParent, BrowserWindow *browserWindow,
 	m_config(coreInterface->GetConfig()),
 	m_fileActionHandler(fileActionHandler),
 	m_fontSetter(GetHWND(), coreInterface->GetConfig()),
-	m_iconThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_iconTaskGroup(coreInterface->GetBackgroundExecutor()),
 	m_iconResultIDCounter(0),
-	m_subfoldersThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_subfoldersTaskGroup(coreInterface->GetBackgroundExecutor()),
 	m_subfoldersResultIDCounter(0),
+	m_folderEnumerationService(coreInterface->GetFolderEnumerationService()),
+	m_enumerationTaskGroup(coreInterface->GetBackgroundExecutor()),
 	m_cachedIcons(cachedIcons),
 	m_dropExpandItem(nullptr),
 	m_shellChangeWatcher(GetHWND(),
@@ -154,7 +154,17 @@ HWND ShellTreeView::CreateTreeView(HWND parent)
 
 ShellTreeView::~ShellTreeView()
 {
-	m_iconThreadPool.clear_queue();
+	m_iconTaskGroup.Cancel();
+	m_subfoldersTaskGroup.Cancel();
+
+	// Any enumerations that are still running will stop at the next item, rather than enumerating
+	// the rest of the folder.
+	m_enumerationTaskGroup.Cancel();
+
+	for (auto &[enumerationResultId, pendingEnumeration] : m_pendingEnumerations)
+	{
+		*pendingEnumeration.cancelled = true;
+	}
 }
 
 void ShellTreeView::OnApplicationShuttingDown()
@@ -287,6 +297,10 @@ LRESULT ShellTreeView::TreeViewProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 		ProcessSubfoldersResult(static_cast<int>(wParam));
 		break;
 
+	case WM_APP_ENUMERATION_RESULT_READY:
+		ProcessEnumerationResult(static_cast<int>(wParam));
+		break;
+
 	case WM_DESTROY:
 		RemoveClipboardFormatListener(m_hTreeView);
 		break;
@@ -345,6 +359,9 @@ LRESULT ShellTreeView::ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM
 			case TVN_ENDLABELEDIT:
 				return OnEndLabelEdit(reinterpret_cast<NMTVDISPINFO *>(lParam));
 
+			case TVN_SELCHANGING:
+				return OnSelectionChanging(reinterpret_cast<NMTREEVIEW *>(lParam));
+
 			case TVN_SELCHANGED:
 				OnSelectionChanged(reinterpret_cast<NMTREEVIEW *>(lParam));
 				break;
@@ -513,14 +530,13 @@ void ShellTreeView::QueueIconTask(HTREEITEM treeItem)
 
 	int iconResultID = m_iconResultIDCounter++;
 
-	auto result = m_iconThreadPool.push(
-		[this, iconResultID, nodeId = node->GetId(), treeItem, basicItemInfo](int id)
+	auto result = m_iconTaskGroup.Submit(
+		[treeView = m_hTreeView, iconResultID, nodeId = node->GetId(), treeItem, basicItemInfo]()
 		{
-			UNREFERENCED_PARAMETER(id);
-
-			return FindIconAsync(m_hTreeView, iconResultID, nodeId, treeItem,
+			return FindIconAsync(treeView, iconResultID, nodeId, treeItem,
 				basicItemInfo.pidl.get());
-		});
+		},
+		WorkStealingExecutor::Apartment::Required);
 
 	m_iconResults.insert({ iconResultID, std::move(result) });
 }
@@ -601,21 +617,42 @@ void ShellTreeView::QueueSubfoldersTask(HTREEITEM item)
 
 	int subfoldersResultID = m_subfoldersResultIDCounter++;
 
-	auto result = m_subfoldersThreadPool.push(
-		[this, subfoldersResultID, item, basicItemInfo](int id)
+	auto result = m_subfoldersTaskGroup.Submit(
+		[treeView = m_hTreeView, subfoldersResultID, item, basicItemInfo,
+			folderEnumerationService = m_folderEnumerationService,
+			showHidden = (m_bShowHidden != FALSE)]()
 		{
-			UNREFERENCED_PARAMETER(id);
-
-			return CheckSubfoldersAsync(m_hTreeView, subfoldersResultID, item,
-				basicItemInfo.pidl.get());
-		});
+			return CheckSubfoldersAsync(treeView, subfoldersResultID, item,
+				basicItemInfo.pidl.get(), folderEnumerationService, showHidden);
+		},
+		WorkStealingExecutor::Apartment::Required);
 
 	m_subfoldersResults.insert({ subfoldersResultID, std::move(result) });
 }
 
 std::optional<ShellTreeView::SubfoldersResult> ShellTreeView::CheckSubfoldersAsync(HWND treeView,
-	int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl)
+	int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl,
+	FolderEnumerationService *folderEnumerationService, bool showHidden)
 {
+	// If the folder has already been enumerated, the answer is already known.
+	auto cachedItems =
+		folderEnumerationService->GetCachedItems(pidl, GetEnumerationContents(showHidden));
+
+	if (cachedItems)
+	{
+		PostMessage(treeView, WM_APP_SUBFOLDERS_RESULT_READY, subfoldersResultId, 0);
+
+		SubfoldersResult result;
+		result.item = item;
+		result.hasSubfolder = std::any_of(cachedItems->begin(), cachedItems->end(),
+			[](const FolderEnumerationCache::Item &cachedItem) {
+				return FolderEnumerationCache::IsIncluded(cachedItem,
+					FolderEnumerationCache::Contents::Folders);
+			});
+
+		return result;
+	}
+
 	wil::com_ptr_nothrow<IShellFolder> pShellFolder;
 	PCITEMID_CHILD pidlRelative;
 	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&pShellFolder), &pidlRelative);
@@ -674,6 +711,343 @@ void ShellTreeView::ProcessSubfoldersResult(int subfoldersResultId)
 	TreeView_SetItem(m_hTreeView, &tvItem);
 }
 
+void ShellTreeView::QueueEnumerationTask(HTREEITEM item)
+{
+	ShellTreeNode *node = GetNodeFromTreeViewItem(item);
+
+	if (IsEnumerationPending(node))
+	{
+		return;
+	}
+
+	AddPlaceholderItem(item);
+
+	// Monitoring starts before the enumeration, so that changes made after the folder's contents
+	// have been retrieved are picked up. Those changes are queued until the enumeration finishes.
+	if (node->GetChangeNotifyId() == 0)
+	{
+		StartDirectoryMonitoringForNode(node);
+	}
+
+	BasicItemInfo basicItemInfo;
+	basicItemInfo.pidl = node->GetFullPidl();
+
+	EnumerationOptions options;
+	options.showHidden = (m_bShowHidden != FALSE);
+	options.checkPinnedToNamespaceTree = m_config->checkPinnedToNamespaceTreeProperty;
+	options.hideSystemFiles = m_config->globalFolderSettings.hideSystemFiles;
+
+	auto enumerationTicket = m_folderEnumerationService->StartEnumeration(basicItemInfo.pidl.get());
+
+	auto cancelled = std::make_shared<std::atomic<bool>>(false);
+	int enumerationResultID = m_enumerationResultIDCounter++;
+
+	auto result = m_enumerationTaskGroup.Submit(
+		[treeView = m_hTreeView, enumerationResultID, basicItemInfo, options,
+			folderEnumerationService = m_folderEnumerationService, enumerationTicket, cancelled]()
+		{
+			return EnumerateFolderAsync(treeView, enumerationResultID, basicItemInfo.pidl.get(),
+				options, folderEnumerationService, enumerationTicket, *cancelled);
+		},
+		WorkStealingExecutor::Apartment::Required);
+
+	m_pendingEnumerations.insert({ enumerationResultID,
+		{ node->GetId(), item, std::move(cancelled), std::move(result) } });
+}
+
+std::optional<std::vector<unique_pidl_child>> ShellTreeView::EnumerateFolderAsync(HWND treeView,
+	int enumerationResultId, PCIDLIST_ABSOLUTE pidlDirectory, const EnumerationOptions &options,
+	FolderEnumerationService *folderEnumerationService,
+	const std::optional<FolderEnumerationService::EnumerationTicket> &enumerationTicket,
+	const std::atomic<bool> &cancelled)
+{
+	// The result is always posted back, even if the enumeration fails, so that the placeholder item
+	// can be removed.
+	auto postResult = wil::scope_exit(
+		[treeView, enumerationResultId]()
+		{ PostMessage(treeView, WM_APP_ENUMERATION_RESULT_READY, enumerationResultId, 0); });
+
+	auto contents = GetEnumerationContents(options.showHidden);
+	std::shared_ptr<const FolderEnumerationService::ItemList> cachedItems;
+
+	if (enumerationTicket)
+	{
+		cachedItems = folderEnumerationService->GetCachedItems(*enumerationTicket, contents);
+	}
+
+	// If the items are cached, the folder only needs to be bound to if the pinned property has to
+	// be checked.
+	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
+
+	if (!cachedItems || options.checkPinnedToNamespaceTree)
+	{
+		HRESULT hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder2));
+
+		if (FAILED(hr))
+		{
+			return std::nullopt;
+		}
+	}
+
+	std::vector<unique_pidl_child> items;
+
+	if (cachedItems)
+	{
+		for (const auto &cachedItem : *cachedItems)
+		{
+			if (cancelled)
+			{
+				return std::nullopt;
+			}
+
+			if (FolderEnumerationCache::IsIncluded(cachedItem, contents)
+				&& ShouldShowItem(shellFolder2.get(), cachedItem.pidl.Raw(), cachedItem.attributes,
+					options))
+			{
+				items.emplace_back(ILCloneChild(cachedItem.pidl.Raw()));
+			}
+		}
+
+		return items;
+	}
+
+	SHCONTF enumFlags = SHCONTF_FOLDERS;
+
+	if (options.showHidden)
+	{
+		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
+	}
+
+	wil::com_ptr_nothrow<IEnumIDList> pEnumIDList;
+	HRESULT hr = shellFolder2->EnumObjects(nullptr, enumFlags, &pEnumIDList);
+
+	if (FAILED(hr) || !pEnumIDList)
+	{
+		return std::nullopt;
+	}
+
+	std::optional<FolderEnumerationService::ItemList> itemsToCache;
+
+	if (enumerationTicket && enumerationTicket->cacheable)
+	{
+		itemsToCache.emplace();
+	}
+
+	unique_pidl_child pidlItem;
+	ULONG uFetched = 1;
+
+	while (pEnumIDList->Next(1, wil::out_param(pidlItem), &uFetched) == S_OK && (uFetched == 1))
+	{
+		if (cancelled)
+		{
+			return std::nullopt;
+		}
+
+		PCITEMID_CHILD child = pidlItem.get();
+		SFGAOF attributes = SFGAO_FOLDER | SFGAO_HIDDEN | SFGAO_SYSTEM;
+		hr = shellFolder2->GetAttributesOf(1, &child, &attributes);
+
+		if (FAILED(hr))
+		{
+			// Without the attributes, the item can't be cached. It's also not possible to tell
+			// whether it's a system item, so it's only shown if system items are shown.
+			itemsToCache.reset();
+			attributes = options.hideSystemFiles ? SFGAO_SYSTEM : 0;
+		}
+
+		if (itemsToCache)
+		{
+			// Only folders were requested, so the item is treated as a folder, regardless of the
+			// attributes that were returned.
+			itemsToCache->push_back({ child, attributes | SFGAO_FOLDER });
+		}
+
+		if (ShouldShowItem(shellFolder2.get(), child, attributes, options))
+		{
+			items.push_back(std::move(pidlItem));
+		}
+	}
+
+	if (itemsToCache)
+	{
+		folderEnumerationService->CacheItems(*enumerationTicket, contents,
+			std::move(*itemsToCache));
+	}
+
+	return items;
+}
+
+FolderEnumerationService::Contents ShellTreeView::GetEnumerationContents(bool showHidden)
+{
+	auto contents = FolderEnumerationService::Contents::Folders;
+
+	if (showHidden)
+	{
+		WI_SetFlag(contents, FolderEnumerationService::Contents::IncludeHidden);
+	}
+
+	return contents;
+}
+
+bool ShellTreeView::ShouldShowItem(IShellFolder2 *shellFolder, PCITEMID_CHILD child,
+	SFGAOF attributes, const EnumerationOptions &options)
+{
+	if (options.checkPinnedToNamespaceTree)
+	{
+		BOOL showItem =
+			GetBooleanVariant(shellFolder, child, &PKEY_IsPinnedToNameSpaceTree, TRUE);
+
+		if (!showItem)
+		{
+			return false;
+		}
+	}
+
+	if (options.hideSystemFiles && WI_IsFlagSet(attributes, SFGAO_SYSTEM))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void ShellTreeView::ProcessEnumerationResult(int enumerationResultId)
+{
+	auto itr = m_pendingEnumerations.find(enumerationResultId);
+
+	// The enumeration will have been cancelled if the folder was collapsed or removed in the
+	// meantime.
+	if (itr == m_pendingEnumerations.end())
+	{
+		return;
+	}
+
+	// Continuing a pending selection below can start another enumeration, so the entry is removed
+	// up front.
+	auto pendingEnumeration = std::move(itr->second);
+	m_pendingEnumerations.erase(itr);
+
+	auto result = pendingEnumeration.result.get();
+
+	auto *node = GetNodeById(pendingEnumeration.nodeId);
+
+	if (!node)
+	{
+		return;
+	}
+
+	HTREEITEM item = pendingEnumeration.treeItem;
+
+	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
+
+	RemovePlaceholderItem(item);
+
+	if (result)
+	{
+		auto pidlDirectory = node->GetFullPidl();
+
+		for (const auto &child : *result)
+		{
+			unique_pidl_absolute pidlItem(ILCombine(pidlDirectory.get(), child.get()));
+			AddItem(item, pidlItem.get());
+		}
+
+		SortChildren(item);
+
+		ApplyQueuedChanges(pendingEnumeration.queuedChanges);
+	}
+
+	if (!TreeView_GetChild(m_hTreeView, item))
+	{
+		TVITEM tvItem;
+		tvItem.mask = TVIF_HANDLE | TVIF_CHILDREN;
+		tvItem.hItem = item;
+		tvItem.cChildren = 0;
+		TreeView_SetItem(m_hTreeView, &tvItem);
+	}
+
+	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
+
+	if (!result)
+	{
+		StopDirectoryMonitoringForNode(node);
+	}
+
+	if (m_pendingSelectionPidl)
+	{
+		ContinueSelectingItem();
+	}
+}
+
+bool ShellTreeView::IsEnumerationPending(const ShellTreeNode *node) const
+{
+	return std::any_of(m_pendingEnumerations.begin(), m_pendingEnumerations.end(),
+		[nodeId = node->GetId()](const auto &entry) { return entry.second.nodeId == nodeId; });
+}
+
+void ShellTreeView::CancelEnumerationsForNodeAndChildren(const ShellTreeNode *node)
+{
+	std::erase_if(m_pendingEnumerations,
+		[nodeId = node->GetId()](const auto &entry)
+		{
+			if (entry.second.nodeId != nodeId)
+			{
+				return false;
+			}
+
+			*entry.second.cancelled = true;
+			return true;
+		});
+
+	for (const auto &child : node->GetChildren())
+	{
+		CancelEnumerationsForNodeAndChildren(child.get());
+	}
+}
+
+// The placeholder item is shown underneath a folder while it's being enumerated. It doesn't have an
+// associated node, which is how it's distinguished from other items.
+void ShellTreeView::AddPlaceholderItem(HTREEITEM parent)
+{
+	auto text = ResourceHelper::LoadString(m_coreInterface->GetResourceInstance(),
+		IDS_SHELLTREEVIEW_LOADING);
+
+	TVINSERTSTRUCT tvInsertData = {};
+	tvInsertData.hParent = parent;
+	tvInsertData.hInsertAfter = TVI_FIRST;
+	tvInsertData.itemex.mask =
+		TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
+	tvInsertData.itemex.pszText = text.data();
+	tvInsertData.itemex.iImage = I_IMAGENONE;
+	tvInsertData.itemex.iSelectedImage = I_IMAGENONE;
+	tvInsertData.itemex.lParam = 0;
+	tvInsertData.itemex.cChildren = 0;
+
+	[[maybe_unused]] auto item = TreeView_InsertItem(m_hTreeView, &tvInsertData);
+	assert(item);
+}
+
+void ShellTreeView::RemovePlaceholderItem(HTREEITEM parent)
+{
+	auto child = TreeView_GetChild(m_hTreeView, parent);
+
+	if (child && IsPlaceholderItem(child))
+	{
+		TreeView_DeleteItem(m_hTreeView, child);
+	}
+}
+
+bool ShellTreeView::IsPlaceholderItem(HTREEITEM item) const
+{
+	return GetNodeFromTreeViewItem(item) == nullptr;
+}
+
+bool ShellTreeView::OnSelectionChanging(const NMTREEVIEW *eventInfo)
+{
+	// The placeholder item doesn't represent a folder, so it can't be selected.
+	return eventInfo->itemNew.hItem && IsPlaceholderItem(eventInfo->itemNew.hItem);
+}
+
 void ShellTreeView::OnSelectionChanged(const NMTREEVIEW *eventInfo)
 {
 	if (!m_applicationInitializationFinished)
@@ -750,7 +1124,7 @@ void ShellTreeView::OnItemExpanding(const NMTREEVIEW *nmtv)
 
 	if (nmtv->action == TVE_EXPAND)
 	{
-		ExpandDirectory(parentItem);
+		QueueEnumerationTask(parentItem);
 	}
 	else
 	{
@@ -774,6 +1148,16 @@ void ShellTreeView::OnItemExpanding(const NMTREEVIEW *nmtv)
 		}
 
 		ShellTreeNode *parentNode = GetNodeFromTreeViewItem(parentItem);
+
+		// If a pending selection was going to expand this folder, it's dropped, since the folder
+		// has explicitly been collapsed.
+		if (m_pendingSelectionPidl
+			&& ILIsParent(parentNode->GetFullPidl().get(), m_pendingSelectionPidl.get(), FALSE))
+		{
+			m_pendingSelectionPidl.reset();
+		}
+
+		CancelEnumerationsForNodeAndChildren(parentNode);
 		StopDirectoryMonitoringForNodeAndChildren(parentNode);
 		parentNode->RemoveAllChildren();
 
@@ -911,83 +1295,6 @@ int CALLBACK ShellTreeView::CompareItems(LPARAM lParam1, LPARAM lParam2)
 	}
 }
 
-HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
-{
-	auto pidlDirectory = GetNodePidl(hParent);
-
-	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
-	HRESULT hr = BindToIdl(pidlDirectory.get(), IID_PPV_ARGS(&shellFolder2));
-
-	if (FAILED(hr))
-	{
-		return hr;
-	}
-
-	SHCONTF enumFlags = SHCONTF_FOLDERS;
-
-	if (m_bShowHidden)
-	{
-		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
-	}
-
-	wil::com_ptr_nothrow<IEnumIDList> pEnumIDList;
-	hr = shellFolder2->EnumObjects(nullptr, enumFlags, &pEnumIDList);
-
-	if (FAILED(hr) || !pEnumIDList)
-	{
-		return hr;
-	}
-
-	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
-
-	std::vector<unique_pidl_absolute> items;
-
-	unique_pidl_child pidlItem;
-	ULONG uFetched = 1;
-
-	while (pEnumIDList->Next(1, wil::out_param(pidlItem), &uFetched) == S_OK && (uFetched == 1))
-	{
-		if (m_config->checkPinnedToNamespaceTreeProperty)
-		{
-			BOOL showItem = GetBooleanVariant(shellFolder2.get(), pidlItem.get(),
-				&PKEY_IsPinnedToNameSpaceTree, TRUE);
-
-			if (!showItem)
-			{
-				continue;
-			}
-		}
-
-		if (m_config->globalFolderSettings.hideSystemFiles)
-		{
-			PCITEMID_CHILD child = pidlItem.get();
-			SFGAOF attributes = SFGAO_SYSTEM;
-			hr = shellFolder2->GetAttributesOf(1, &child, &attributes);
-
-			if (FAILED(hr) || (WI_IsFlagSet(attributes, SFGAO_SYSTEM)))
-			{
-				continue;
-			}
-		}
-
-		items.emplace_back(ILCombine(pidlDirectory.get(), pidlItem.get()));
-	}
-
-	for (const auto &item : items)
-	{
-		AddItem(hParent, item.get());
-	}
-
-	SortChildren(hParent);
-
-	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
-
-	ShellTreeNode *parentNode = GetNodeFromTreeViewItem(hParent);
-	StartDirectoryMonitoringForNode(parentNode);
-
-	return hr;
-}
-
 HTREEITEM ShellTreeView::AddItem(HTREEITEM parent, PCIDLIST_ABSOLUTE pidl, HTREEITEM insertAfter)
 {
 	wil::com_ptr_nothrow<IShellItem2> shellItem;
@@ -1114,62 +1421,39 @@ ShellTreeNode *ShellTreeView::GetNodeByIdRecursive(ShellTreeNode *node, int id)
 	return nullptr;
 }
 
-HTREEITEM ShellTreeView::LocateItem(PCIDLIST_ABSOLUTE pidlDirectory)
+// Only items that are already in the tree will be found; no folders will be expanded. If the
+// item isn't found and closestAncestor is provided, it will be set to the deepest item in the tree
+// that's an ancestor of the specified pidl (if there is one).
+HTREEITEM ShellTreeView::LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory,
+	HTREEITEM *closestAncestor)
 {
-	return LocateItemInternal(pidlDirectory, FALSE);
-}
-
-HTREEITEM ShellTreeView::LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory)
-{
-	return LocateItemInternal(pidlDirectory, TRUE);
-}
-
-HTREEITEM ShellTreeView::LocateItemInternal(PCIDLIST_ABSOLUTE pidlDirectory,
-	BOOL bOnlyLocateExistingItem)
-{
-	HTREEITEM hRoot;
-	HTREEITEM hItem;
-	TVITEMEX item;
-	BOOL bFound = FALSE;
+	HTREEITEM hItem = TreeView_GetRoot(m_hTreeView);
 
-	/* Get the root of the tree (root of namespace). */
-	hRoot = TreeView_GetRoot(m_hTreeView);
-	hItem = hRoot;
+	/* Look through each item, once an ancestor is
+	found, look through it's children. */
+	while (hItem != nullptr)
+	{
+		auto *node = GetNodeFromTreeViewItem(hItem);
 
-	item.mask = TVIF_PARAM | TVIF_HANDLE;
-	item.hItem = hItem;
-	TreeView_GetItem(m_hTreeView, &item);
+		// The placeholder item is only shown while the parent folder is being enumerated, in which
+		// case, none of the parent's children are in the tree yet.
+		if (!node)
+		{
+			return nullptr;
+		}
 
-	/* Keep searching until the specified item
-	is found or it is found the item does not
-	exist in the treeview.
-	Look through each item, once an ancestor is
-	found, look through it's children, expanding
-	the parent node if necessary. */
-	while (!bFound && hItem != nullptr)
-	{
-		auto *node = reinterpret_cast<ShellTreeNode *>(item.lParam);
 		auto currentPidl = node->GetFullPidl();
 
 		if (ArePidlsEquivalent(currentPidl.get(), pidlDirectory))
 		{
-			bFound = TRUE;
-
-			break;
+			return hItem;
 		}
 
 		if (ILIsParent(currentPidl.get(), pidlDirectory, FALSE))
 		{
-			if ((TreeView_GetChild(m_hTreeView, hItem)) == nullptr)
+			if (closestAncestor)
 			{
-				if (bOnlyLocateExistingItem)
-				{
-					return nullptr;
-				}
-				else
-				{
-					SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, (LPARAM) hItem);
-				}
+				*closestAncestor = hItem;
 			}
 
 			hItem = TreeView_GetChild(m_hTreeView, hItem);
@@ -1178,13 +1462,9 @@ HTREEITEM ShellTreeView::LocateItemInternal(PCIDLIST_ABSOLUTE pidlDirectory,
 		{
 			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
 		}
-
-		item.mask = TVIF_PARAM | TVIF_HANDLE;
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
 	}
 
-	return hItem;
+	return nullptr;
 }
 
 void ShellTreeView::OnMiddleButtonDown(const POINT *pt)
@@ -1194,7 +1474,7 @@ void ShellTreeView::OnMiddleButtonDown(const POINT *pt)
 
 	TreeView_HitTest(m_hTreeView, &hitTestInfo);
 
-	if (hitTestInfo.flags != LVHT_NOWHERE)
+	if (hitTestInfo.flags != LVHT_NOWHERE && !IsPlaceholderItem(hitTestInfo.hItem))
 	{
 		m_middleButtonItem = hitTestInfo.hItem;
 	}
@@ -1265,59 +1545,45 @@ void ShellTreeView::RefreshAllIcons()
 
 void ShellTreeView::RefreshAllIconsInternal(HTREEITEM hFirstSibling)
 {
-	HTREEITEM hNextSibling;
-	HTREEITEM hChild;
-	TVITEM tvItem;
-	SHFILEINFO shfi;
-
-	hNextSibling = TreeView_GetNextSibling(m_hTreeView, hFirstSibling);
-
-	tvItem.mask = TVIF_HANDLE | TVIF_PARAM;
-	tvItem.hItem = hFirstSibling;
-	TreeView_GetItem(m_hTreeView, &tvItem);
-
-	const ShellTreeNode *node = reinterpret_cast<ShellTreeNode *>(tvItem.lParam);
-	SHGetFileInfo(reinterpret_cast<LPCTSTR>(node->GetFullPidl().get()), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_SYSICONINDEX);
-
-	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-	tvItem.hItem = hFirstSibling;
-	tvItem.iImage = shfi.iIcon;
-	tvItem.iSelectedImage = shfi.iIcon;
-	TreeView_SetItem(m_hTreeView, &tvItem);
-
-	hChild = TreeView_GetChild(m_hTreeView, hFirstSibling);
-
-	if (hChild != nullptr)
-		RefreshAllIconsInternal(hChild);
-
-	while (hNextSibling != nullptr)
+	for (HTREEITEM item = hFirstSibling; item != nullptr;
+		 item = TreeView_GetNextSibling(m_hTreeView, item))
 	{
-		tvItem.mask = TVIF_HANDLE | TVIF_PARAM;
-		tvItem.hItem = hNextSibling;
-		TreeView_GetItem(m_hTreeView, &tvItem);
+		const ShellTreeNode *node = GetNodeFromTreeViewItem(item);
 
-		const ShellTreeNode *nextNode = reinterpret_cast<ShellTreeNode *>(tvItem.lParam);
-		SHGetFileInfo(reinterpret_cast<LPCTSTR>(nextNode->GetFullPidl().get()), 0, &shfi,
+		// The placeholder item doesn't have an icon.
+		if (!node)
+		{
+			continue;
+		}
+
+		SHFILEINFO shfi;
+		SHGetFileInfo(reinterpret_cast<LPCTSTR>(node->GetFullPidl().get()), 0, &shfi,
 			sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
 
+		TVITEM tvItem;
 		tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-		tvItem.hItem = hNextSibling;
+		tvItem.hItem = item;
 		tvItem.iImage = shfi.iIcon;
 		tvItem.iSelectedImage = shfi.iIcon;
 		TreeView_SetItem(m_hTreeView, &tvItem);
 
-		hChild = TreeView_GetChild(m_hTreeView, hNextSibling);
+		HTREEITEM child = TreeView_GetChild(m_hTreeView, item);
 
-		if (hChild != nullptr)
-			RefreshAllIconsInternal(hChild);
-
-		hNextSibling = TreeView_GetNextSibling(m_hTreeView, hNextSibling);
+		if (child != nullptr)
+		{
+			RefreshAllIconsInternal(child);
+		}
 	}
 }
 
 HRESULT ShellTreeView::OnBeginDrag(const ShellTreeNode *node)
 {
+	// The placeholder item can't be dragged.
+	if (!node)
+	{
+		return E_FAIL;
+	}
+
 	wil::com_ptr_nothrow<IDataObject> dataObject;
 	auto pidl = node->GetFullPidl();
 	std::vector<PCIDLIST_ABSOLUTE> items = { pidl.get() };
@@ -1473,7 +1739,7 @@ void ShellTreeView::OnShowContextMenu(const POINT &ptScreen)
 		hitTestInfo.pt = ptClient;
 		auto item = TreeView_HitTest(m_hTreeView, &hitTestInfo);
 
-		if (!item)
+		if (!item || IsPlaceholderItem(item))
 		{
 			return;
 		}
@@ -1611,30 +1877,63 @@ void ShellTreeView::UpdateSelection()
 	}
 
 	auto *selectedShellBrowser = GetSelectedShellBrowser();
+	SelectItemAsync(selectedShellBrowser->GetDirectoryIdl().get());
+}
+
+// Locating a folder in the treeview requires each of its parent folders to be expanded and those
+// folders can take a significant amount of time to enumerate (e.g. the Network folder, which
+// contains UNC paths, can take 30 seconds). Therefore, each parent is expanded asynchronously and
+// the search continues once the enumeration of that parent has finished. A later call replaces
+// any selection that's still pending.
+void ShellTreeView::SelectItemAsync(PCIDLIST_ABSOLUTE pidl)
+{
+	m_pendingSelectionPidl.reset(ILCloneFull(pidl));
+	ContinueSelectingItem();
+}
 
-	// When locating a folder in the treeview, each of the parent folders has to be enumerated. UNC
-	// paths are contained within the Network folder and that folder can take a significant amount
-	// of time to enumerate (e.g. 30 seconds).
-	// Therefore, locating a UNC path can take a non-trivial amount of time, as the Network folder
-	// will have to be enumerated first. As that work is all done on the main thread, the
-	// application will hang while the enumeration completes, something that's especially noticeable
-	// on startup.
-	// Note that mapped drives don't have that specific issue, as they're contained within the This
-	// PC folder. However, there is still the general problem that each parent folder has to be
-	// enumerated and all the work is done on the main thread.
-	if (PathIsUNC(selectedShellBrowser->GetDirectory().c_str()))
+void ShellTreeView::ContinueSelectingItem()
+{
+	HTREEITEM closestAncestor = nullptr;
+	HTREEITEM item = LocateExistingItem(m_pendingSelectionPidl.get(), &closestAncestor);
+
+	if (item)
 	{
+		m_pendingSelectionPidl.reset();
+		TreeView_SelectItem(m_hTreeView, item);
 		return;
 	}
 
-	HTREEITEM item = LocateItem(selectedShellBrowser->GetDirectoryIdl().get());
+	if (!closestAncestor)
+	{
+		m_pendingSelectionPidl.reset();
+		return;
+	}
 
-	if (!item)
+	const ShellTreeNode *ancestorNode = GetNodeFromTreeViewItem(closestAncestor);
+
+	// The search will continue once the ancestor has been enumerated.
+	if (IsEnumerationPending(ancestorNode))
 	{
 		return;
 	}
 
-	TreeView_SelectItem(m_hTreeView, item);
+	// If the ancestor has already been expanded, the next folder in the path doesn't exist (or
+	// isn't being shown).
+	if (TreeView_GetChild(m_hTreeView, closestAncestor)
+		|| WI_IsFlagSet(TreeView_GetItemState(m_hTreeView, closestAncestor, TVIS_EXPANDED),
+			TVIS_EXPANDED))
+	{
+		m_pendingSelectionPidl.reset();
+		return;
+	}
+
+	TreeView_Expand(m_hTreeView, closestAncestor, TVE_EXPAND);
+
+	// The item won't be expanded if it's known not to have any subfolders.
+	if (!IsEnumerationPending(ancestorNode))
+	{
+		m_pendingSelectionPidl.reset();
+	}
 }
 
 void ShellTreeView::CopySelectedItemToClipboard(bool copy)
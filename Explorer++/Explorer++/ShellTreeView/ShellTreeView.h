@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "FolderEnumerationService.h"
 #include "MainFontSetter.h"
 #include "ShellChangeWatcher.h"
 #include "SignalWrapper.h"
@@ -12,10 +13,12 @@
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowSubclassWrapper.h"
+#include "../Helper/WorkStealingExecutor.h"
 #include "../Helper/iDirectoryMonitor.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/signals2.hpp>
 #include <wil/com.h>
+#include <atomic>
+#include <memory>
 #include <optional>
 
 class BrowserWindow;
@@ -62,6 +65,7 @@ public:
 private:
 	static const UINT WM_APP_ICON_RESULT_READY = WM_APP + 1;
 	static const UINT WM_APP_SUBFOLDERS_RESULT_READY = WM_APP + 2;
+	static const UINT WM_APP_ENUMERATION_RESULT_READY = WM_APP + 3;
 
 	static const UINT DROP_EXPAND_TIMER_ID = 1;
 	static const UINT DROP_EXPAND_TIMER_TIMEOUT = 800;
@@ -101,6 +105,26 @@ private:
 		bool hasSubfolder;
 	};
 
+	// The settings that determine which of the items in a folder are shown.
+	struct EnumerationOptions
+	{
+		bool showHidden;
+		bool checkPinnedToNamespaceTree;
+		bool hideSystemFiles;
+	};
+
+	// Tracks the enumeration of a folder that's being expanded. The results are empty if the
+	// enumeration failed. Changes to the folder's children that are received in the meantime are
+	// queued and only applied once the results have been added.
+	struct PendingEnumeration
+	{
+		int nodeId;
+		HTREEITEM treeItem;
+		std::shared_ptr<std::atomic<bool>> cancelled;
+		std::future<std::optional<std::vector<unique_pidl_child>>> result;
+		std::vector<ShellChangeNotification> queuedChanges;
+	};
+
 	// Maintains information about an item that was cut or copied within the treeview.
 	class CutCopiedItemManager
 	{
@@ -142,10 +166,10 @@ private:
 	void AddShellNamespaceRootItem();
 	HTREEITEM AddRootItem(PCIDLIST_ABSOLUTE pidl, HTREEITEM insertAfter = TVI_LAST);
 	void OnShowQuickAccessUpdated(bool newValue);
-	HRESULT ExpandDirectory(HTREEITEM hParent);
 	HTREEITEM AddItem(HTREEITEM parent, PCIDLIST_ABSOLUTE pidl, HTREEITEM insertAfter = TVI_LAST);
 	void SortChildren(HTREEITEM parent);
 	void OnGetDisplayInfo(NMTVDISPINFO *pnmtvdi);
+	bool OnSelectionChanging(const NMTREEVIEW *eventInfo);
 	void OnSelectionChanged(const NMTREEVIEW *eventInfo);
 	void OnSelectionChangedTimer();
 	void HandleSelectionChanged(const NMTREEVIEW *eventInfo);
@@ -157,6 +181,8 @@ private:
 	bool OnEndLabelEdit(const NMTVDISPINFO *dispInfo);
 	void OnShowContextMenu(const POINT &ptScreen);
 	void UpdateSelection();
+	void SelectItemAsync(PCIDLIST_ABSOLUTE pidl);
+	void ContinueSelectingItem();
 
 	void CopyItemToClipboard(HTREEITEM treeItem, bool copy);
 	void OnClipboardUpdate();
@@ -173,6 +199,9 @@ private:
 	void ProcessShellChangeNotifications(
 		const std::vector<ShellChangeNotification> &shellChangeNotifications);
 	void ProcessShellChangeNotification(const ShellChangeNotification &change);
+	bool QueueChangeForPendingEnumeration(const ShellChangeNotification &change);
+	PendingEnumeration *GetPendingEnumerationForParent(PCIDLIST_ABSOLUTE simplePidl);
+	void ApplyQueuedChanges(const std::vector<ShellChangeNotification> &queuedChanges);
 	void OnItemAdded(PCIDLIST_ABSOLUTE simplePidl);
 	void OnItemUpdated(PCIDLIST_ABSOLUTE simplePidl, PCIDLIST_ABSOLUTE simpleUpdatedPidl);
 	void OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl);
@@ -188,9 +217,27 @@ private:
 
 	void QueueSubfoldersTask(HTREEITEM item);
 	static std::optional<SubfoldersResult> CheckSubfoldersAsync(HWND treeView,
-		int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl);
+		int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl,
+		FolderEnumerationService *folderEnumerationService, bool showHidden);
 	void ProcessSubfoldersResult(int subfoldersResultId);
 
+	/* Folder enumeration. */
+	void QueueEnumerationTask(HTREEITEM item);
+	static std::optional<std::vector<unique_pidl_child>> EnumerateFolderAsync(HWND treeView,
+		int enumerationResultId, PCIDLIST_ABSOLUTE pidlDirectory,
+		const EnumerationOptions &options, FolderEnumerationService *folderEnumerationService,
+		const std::optional<FolderEnumerationService::EnumerationTicket> &enumerationTicket,
+		const std::atomic<bool> &cancelled);
+	static FolderEnumerationService::Contents GetEnumerationContents(bool showHidden);
+	static bool ShouldShowItem(IShellFolder2 *shellFolder, PCITEMID_CHILD child,
+		SFGAOF attributes, const EnumerationOptions &options);
+	void ProcessEnumerationResult(int enumerationResultId);
+	bool IsEnumerationPending(const ShellTreeNode *node) const;
+	void CancelEnumerationsForNodeAndChildren(const ShellTreeNode *node);
+	void AddPlaceholderItem(HTREEITEM parent);
+	void RemovePlaceholderItem(HTREEITEM parent);
+	bool IsPlaceholderItem(HTREEITEM item) const;
+
 	ShellTreeNode *GetNodeFromTreeViewItem(HTREEITEM item) const;
 	ShellTreeNode *GetNodeById(int id) const;
 	ShellTreeNode *GetNodeByIdRecursive(ShellTreeNode *node, int id) const;
@@ -212,9 +259,8 @@ private:
 	/* Icon refresh. */
 	void RefreshAllIconsInternal(HTREEITEM hFirstSibling);
 
-	HTREEITEM LocateItem(PCIDLIST_ABSOLUTE pidlDirectory);
-	HTREEITEM LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory);
-	HTREEITEM LocateItemInternal(PCIDLIST_ABSOLUTE pidlDirectory, BOOL bOnlyLocateExistingItem);
+	HTREEITEM LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory,
+		HTREEITEM *closestAncestor = nullptr);
 
 	void OnCutItemChanged(HTREEITEM previousCutItem, HTREEITEM newCutItem);
 	bool ShouldGhostItem(HTREEITEM item);
@@ -242,14 +288,29 @@ private:
 	// be set. Once the treeview font is set, the same font will be applied to the tooltip control.
 	MainFontSetter m_fontSetter;
 
-	ctpl::thread_pool m_iconThreadPool;
+	// Icon and subfolder tasks run on the shared background executor.
+	WorkStealingExecutor::TaskGroup m_iconTaskGroup;
 	std::unordered_map<int, std::future<std::optional<IconResult>>> m_iconResults;
 	int m_iconResultIDCounter;
 
-	ctpl::thread_pool m_subfoldersThreadPool;
+	WorkStealingExecutor::TaskGroup m_subfoldersTaskGroup;
 	std::unordered_map<int, std::future<std::optional<SubfoldersResult>>> m_subfoldersResults;
 	int m_subfoldersResultIDCounter;
 
+	// Folders are enumerated in the background when they're expanded, with a placeholder item
+	// shown underneath them until the enumeration has finished. The results are shared with the
+	// listview, so a folder that's already been enumerated there doesn't need to be enumerated
+	// again.
+	FolderEnumerationService *const m_folderEnumerationService;
+	WorkStealingExecutor::TaskGroup m_enumerationTaskGroup;
+	std::unordered_map<int, PendingEnumeration> m_pendingEnumerations;
+	int m_enumerationResultIDCounter = 0;
+
+	// The folder that will be selected once it's been added to the tree. Each of its parent
+	// folders is expanded in turn, with each expansion starting once the enumeration of the
+	// previous one has finished.
+	unique_pidl_absolute m_pendingSelectionPidl;
+
 	// Contains information about each node stored in the tree. Only root nodes are stored directly
 	// in this vector; child nodes are stored underneath their parent node.
 	std::vector<std::unique_ptr<ShellTreeNode>> m_nodes;
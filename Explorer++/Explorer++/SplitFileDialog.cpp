@@ -21,14 +21,18 @@
 
 namespace NSplitFileDialog
 {
-const int WM_APP_SETTOTALSPLITCOUNT = WM_APP + 1;
-const int WM_APP_SETCURRENTSPLITCOUNT = WM_APP + 2;
+const int WM_APP_SETSPLITPROGRESS = WM_APP + 2;
 const int WM_APP_SPLITFINISHED = WM_APP + 3;
 const int WM_APP_INPUTFILEINVALID = WM_APP + 4;
 
 const TCHAR COUNTER_PATTERN[] = _T("/N");
 
+// Progress is measured in bytes, which won't necessarily fit within the range of the progress bar,
+// so it's scaled to this range instead.
+const int PROGRESS_BAR_RANGE = 1000;
+
 DWORD WINAPI SplitFileThreadProcStub(LPVOID pParam);
+std::wstring FormatTime(uint64_t seconds);
 }
 
 const TCHAR SplitFileDialogPersistentSettings::SETTINGS_KEY[] = _T("SplitFile");
@@ -164,16 +168,42 @@ INT_PTR SplitFileDialog::OnTimer(int iTimerID)
 	{
 		m_uElapsedTime++;
 
-		/* Update the elapsed time display (form is hh:mm:ss). */
-		TCHAR szElapsedTime[9];
-		StringCchPrintf(szElapsedTime, SIZEOF_ARRAY(szElapsedTime), _T("%02d:%02d:%02d"),
-			m_uElapsedTime / 3600, (m_uElapsedTime / 60) % 60, m_uElapsedTime % 60);
-		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_ELAPSEDTIME, szElapsedTime);
+		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_ELAPSEDTIME,
+			NSplitFileDialog::FormatTime(m_uElapsedTime).c_str());
+
+		UpdateProgressDetails();
 	}
 
 	return 0;
 }
 
+void SplitFileDialog::UpdateProgressDetails()
+{
+	if (m_pSplitFile == nullptr)
+	{
+		return;
+	}
+
+	auto progress = m_pSplitFile->GetLatestProgress();
+
+	if (!progress || !progress->remainingTime)
+	{
+		return;
+	}
+
+	auto speedText = FormatSizeString(static_cast<uint64_t>(progress->bytesPerSecond));
+	auto remainingTimeText = NSplitFileDialog::FormatTime(progress->remainingTime->count());
+
+	TCHAR szTemp[64];
+	LoadString(GetResourceInstance(), IDS_SPLITFILEDIALOG_PROGRESSDETAILS, szTemp,
+		SIZEOF_ARRAY(szTemp));
+
+	TCHAR szProgressDetails[128];
+	StringCchPrintf(szProgressDetails, SIZEOF_ARRAY(szProgressDetails), szTemp,
+		speedText.c_str(), remainingTimeText.c_str());
+	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_PROGRESSDETAILS, szProgressDetails);
+}
+
 INT_PTR SplitFileDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 {
 	UNREFERENCED_PARAMETER(lParam);
@@ -269,16 +299,12 @@ INT_PTR SplitFileDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPara
 
 	switch (uMsg)
 	{
-	case NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT:
+	case NSplitFileDialog::WM_APP_SETSPLITPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
 	case NSplitFileDialog::WM_APP_SPLITFINISHED:
-		OnSplitFinished();
+		OnSplitFinished(wParam != 0);
 		break;
 
 	case NSplitFileDialog::WM_APP_INPUTFILEINVALID:
@@ -369,7 +395,7 @@ void SplitFileDialog::OnOk()
 		BOOL bTranslated;
 		UINT uSplitSize = GetDlgItemInt(m_hDlg, IDC_SPLIT_EDIT_SIZE, &bTranslated, FALSE);
 
-		if (!bTranslated)
+		if (!bTranslated || uSplitSize == 0)
 		{
 			TCHAR szTemp[128];
 
@@ -384,6 +410,10 @@ void SplitFileDialog::OnOk()
 			return;
 		}
 
+		// Parts are copied in fixed-size chunks, so their size isn't limited by the amount of
+		// memory that's available.
+		uint64_t splitSize = uSplitSize;
+
 		HWND hComboBox = GetDlgItem(m_hDlg, IDC_SPLIT_COMBOBOX_SIZES);
 		int iCurSel = static_cast<int>(SendMessage(hComboBox, CB_GETCURSEL, 0, 0));
 
@@ -399,21 +429,21 @@ void SplitFileDialog::OnOk()
 				break;
 
 			case SizeType::KB:
-				uSplitSize *= KB;
+				splitSize *= KB;
 				break;
 
 			case SizeType::MB:
-				uSplitSize *= MB;
+				splitSize *= MB;
 				break;
 
 			case SizeType::GB:
-				uSplitSize *= GB;
+				splitSize *= GB;
 				break;
 			}
 		}
 
-		m_pSplitFile = new SplitFile(m_hDlg, m_strFullFilename, strOutputFilename,
-			strOutputDirectory, uSplitSize);
+		m_pSplitFile = new SplitFile(m_hDlg, m_coreInterface->GetBackgroundExecutor(),
+			m_strFullFilename, strOutputFilename, strOutputDirectory, splitSize);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
 
@@ -429,6 +459,11 @@ void SplitFileDialog::OnOk()
 		LoadString(GetResourceInstance(), IDS_SPLITFILEDIALOG_SPLITTING, szTemp,
 			SIZEOF_ARRAY(szTemp));
 		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
+		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_PROGRESSDETAILS, EMPTY_STRING);
+
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0,
+			NSplitFileDialog::PROGRESS_BAR_RANGE);
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, 0, 0);
 
 		HANDLE hThread = CreateThread(nullptr, 0, NSplitFileDialog::SplitFileThreadProcStub,
 			reinterpret_cast<LPVOID>(m_pSplitFile), 0, nullptr);
@@ -483,11 +518,16 @@ void SplitFileDialog::OnChangeOutputDirectory()
 	SetDlgItemText(m_hDlg, IDC_SPLIT_EDIT_OUTPUT, parsingName.c_str());
 }
 
-void SplitFileDialog::OnSplitFinished()
+void SplitFileDialog::OnSplitFinished(bool failed)
 {
 	TCHAR szTemp[64];
 
-	if (!m_bStopSplitting)
+	if (failed)
+	{
+		LoadString(GetResourceInstance(), IDS_SPLITFILEDIALOG_SPLITFAILED, szTemp,
+			SIZEOF_ARRAY(szTemp));
+	}
+	else if (!m_bStopSplitting)
 	{
 		LoadString(GetResourceInstance(), IDS_SPLITFILEDIALOG_FINISHED, szTemp,
 			SIZEOF_ARRAY(szTemp));
@@ -499,6 +539,7 @@ void SplitFileDialog::OnSplitFinished()
 	}
 
 	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
+	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_PROGRESSDETAILS, EMPTY_STRING);
 
 	assert(m_pSplitFile != nullptr);
 
@@ -517,6 +558,15 @@ void SplitFileDialog::OnSplitFinished()
 	SetDlgItemText(m_hDlg, IDOK, m_szOk);
 }
 
+// Formats a number of seconds as hh:mm:ss.
+std::wstring NSplitFileDialog::FormatTime(uint64_t seconds)
+{
+	TCHAR szTime[32];
+	StringCchPrintf(szTime, SIZEOF_ARRAY(szTime), _T("%02llu:%02llu:%02llu"), seconds / 3600,
+		(seconds / 60) % 60, seconds % 60);
+	return szTime;
+}
+
 DWORD WINAPI NSplitFileDialog::SplitFileThreadProcStub(LPVOID pParam)
 {
 	assert(pParam != nullptr);
@@ -527,101 +577,61 @@ DWORD WINAPI NSplitFileDialog::SplitFileThreadProcStub(LPVOID pParam)
 	return 0;
 }
 
-SplitFile::SplitFile(HWND hDlg, const std::wstring &strFullFilename,
-	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory, UINT uSplitSize)
-{
-	m_hDlg = hDlg;
-	m_strFullFilename = strFullFilename;
-	m_strOutputFilename = strOutputFilename;
-	m_strOutputDirectory = strOutputDirectory;
-	m_uSplitSize = uSplitSize;
-
-	m_bStopSplitting = false;
-
-	InitializeCriticalSection(&m_csStop);
-}
-
-SplitFile::~SplitFile()
+SplitFile::SplitFile(HWND hDlg, WorkStealingExecutor *executor,
+	const std::wstring &strFullFilename, const std::wstring &strOutputFilename,
+	const std::wstring &strOutputDirectory, uint64_t splitSize) :
+	m_hDlg(hDlg),
+	m_executor(executor),
+	m_strFullFilename(strFullFilename),
+	m_strOutputFilename(strOutputFilename),
+	m_strOutputDirectory(strOutputDirectory),
+	m_splitSize(splitSize),
+	m_stopSplitting(false),
+	m_progressPosition(0)
 {
-	DeleteCriticalSection(&m_csStop);
 }
 
 void SplitFile::Split()
 {
-	HANDLE hInputFile = CreateFile(m_strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-		nullptr, OPEN_EXISTING, 0, nullptr);
+	wil::unique_hfile inputFile(CreateFile(m_strFullFilename.c_str(), GENERIC_READ,
+		FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr));
 
-	if (hInputFile == INVALID_HANDLE_VALUE)
+	if (!inputFile)
 	{
 		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_INPUTFILEINVALID, 0, 0);
 		return;
 	}
 
+	HRESULT hr;
 	LARGE_INTEGER lFileSize;
-	GetFileSizeEx(hInputFile, &lFileSize);
 
-	LONGLONG nSplits = lFileSize.QuadPart / m_uSplitSize;
-
-	if ((lFileSize.QuadPart % m_uSplitSize) != 0)
+	if (GetFileSizeEx(inputFile.get(), &lFileSize))
 	{
-		nSplits++;
+		// The parts are written concurrently, on the background executor. If they're the same as
+		// the parts from an earlier split that was stopped, the earlier split will be resumed.
+		FileSplitter splitter(m_executor);
+		hr = splitter.Split(
+			inputFile.get(), lFileSize.QuadPart, m_splitSize,
+			[this](int partNumber)
+			{
+				std::wstring partPath;
+				ProcessFilename(partNumber, partPath);
+				return partPath;
+			},
+			m_stopSplitting,
+			[this](const FileSplitter::Progress &progress) { OnProgress(progress); });
 	}
-
-	PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT, static_cast<WPARAM>(nSplits),
-		0);
-
-	SplitInternal(hInputFile, lFileSize);
-
-	CloseHandle(hInputFile);
-
-	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, 0, 0);
-}
-
-void SplitFile::SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize)
-{
-	LARGE_INTEGER lRunningSplitSize = { 0 };
-
-	char *pBuffer = new char[m_uSplitSize];
-	bool bStop = false;
-	int nSplitsMade = 1;
-
-	while (lRunningSplitSize.QuadPart < lFileSize.QuadPart && !bStop)
+	else
 	{
-		DWORD dwNumberOfBytesRead;
-		ReadFile(hInputFile, reinterpret_cast<LPVOID>(pBuffer), m_uSplitSize, &dwNumberOfBytesRead,
-			nullptr);
-
-		std::wstring strOutputFullFilename;
-		ProcessFilename(nSplitsMade, strOutputFullFilename);
-
-		HANDLE hOutputFile = CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-		if (hOutputFile != INVALID_HANDLE_VALUE)
-		{
-			DWORD dwNumberOfBytesWritten;
-			WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(pBuffer), dwNumberOfBytesRead,
-				&dwNumberOfBytesWritten, nullptr);
-
-			CloseHandle(hOutputFile);
-		}
-
-		/* TODO: Wait for a set period of time before sending message
-		(so as not to block the GUI). */
-		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT, nSplitsMade, 0);
-
-		lRunningSplitSize.QuadPart += dwNumberOfBytesRead;
-		nSplitsMade++;
-
-		EnterCriticalSection(&m_csStop);
-		if (m_bStopSplitting)
-		{
-			bStop = true;
-		}
-		LeaveCriticalSection(&m_csStop);
+		hr = HRESULT_FROM_WIN32(GetLastError());
 	}
 
-	delete[] pBuffer;
+	inputFile.reset();
+
+	// A split that was stopped can be resumed later, so that isn't treated as a failure.
+	bool failed = FAILED(hr) && hr != E_ABORT;
+	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, failed, 0);
 }
 
 void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename)
@@ -638,9 +648,40 @@ void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFile
 
 void SplitFile::StopSplitting()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSplitting = true;
-	LeaveCriticalSection(&m_csStop);
+	m_stopSplitting = true;
+}
+
+std::optional<FileSplitter::Progress> SplitFile::GetLatestProgress()
+{
+	std::scoped_lock lock(m_progressMutex);
+	return m_latestProgress;
+}
+
+// The throughput and remaining time are shown each time the elapsed time is updated. However, a
+// message is posted whenever the position of the progress bar changes, so that the progress bar
+// is kept up to date.
+void SplitFile::OnProgress(const FileSplitter::Progress &progress)
+{
+	{
+		std::scoped_lock lock(m_progressMutex);
+		m_latestProgress = progress;
+	}
+
+	if (progress.totalBytes == 0)
+	{
+		return;
+	}
+
+	auto position = static_cast<int>((std::min)(progress.bytesSplit, progress.totalBytes)
+		* NSplitFileDialog::PROGRESS_BAR_RANGE / progress.totalBytes);
+
+	if (position == m_progressPosition)
+	{
+		return;
+	}
+
+	m_progressPosition = position;
+	PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETSPLITPROGRESS, position, 0);
 }
 
 SplitFileDialogPersistentSettings::SplitFileDialogPersistentSettings() :
@@ -6,12 +6,17 @@
 
 #include "ThemedDialog.h"
 #include "../Helper/DialogSettings.h"
+#include "../Helper/FileSplitter.h"
 #include "../Helper/ReferenceCount.h"
+#include <atomic>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
 class CoreInterface;
 class SplitFileDialog;
+class WorkStealingExecutor;
 
 class SplitFileDialogPersistentSettings : public DialogSettings
 {
@@ -44,26 +49,34 @@ private:
 class SplitFile : public ReferenceCount
 {
 public:
-	SplitFile(HWND hDlg, const std::wstring &strFullFilename, const std::wstring &strOutputFilename,
-		const std::wstring &strOutputDirectory, UINT uSplitSize);
-	~SplitFile();
+	SplitFile(HWND hDlg, WorkStealingExecutor *executor, const std::wstring &strFullFilename,
+		const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory,
+		uint64_t splitSize);
 
 	void Split();
 	void StopSplitting();
 
+	// Returns the most recent progress reported by the splitter. This can be called from any
+	// thread.
+	std::optional<FileSplitter::Progress> GetLatestProgress();
+
 private:
-	void SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize);
 	void ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename);
+	void OnProgress(const FileSplitter::Progress &progress);
 
 	HWND m_hDlg;
+	WorkStealingExecutor *m_executor;
 
 	std::wstring m_strFullFilename;
 	std::wstring m_strOutputFilename;
 	std::wstring m_strOutputDirectory;
-	UINT m_uSplitSize;
+	uint64_t m_splitSize;
 
-	CRITICAL_SECTION m_csStop;
-	bool m_bStopSplitting;
+	std::atomic<bool> m_stopSplitting;
+
+	std::mutex m_progressMutex;
+	std::optional<FileSplitter::Progress> m_latestProgress;
+	int m_progressPosition;
 };
 
 class SplitFileDialog : public ThemedDialog
@@ -114,7 +127,8 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnChangeOutputDirectory();
-	void OnSplitFinished();
+	void OnSplitFinished(bool failed);
+	void UpdateProgressDetails();
 
 	CoreInterface *m_coreInterface;
 
@@ -0,0 +1,22 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "StartupPhaseTimer.h"
+#include <glog/logging.h>
+
+StartupPhaseTimer::StartupPhaseTimer(std::string_view phaseName) :
+	m_phaseName(phaseName),
+	m_startTime(std::chrono::steady_clock::now())
+{
+}
+
+StartupPhaseTimer::~StartupPhaseTimer()
+{
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - m_startTime);
+
+	LOG(INFO) << "Startup phase \"" << m_phaseName << "\" took " << (duration.count() / 1000.0)
+			  << " ms";
+}
@@ -0,0 +1,23 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+// Logs how long a phase of startup took, once the timer goes out of scope. This makes it possible
+// to see which part of startup is responsible for any slowdown.
+class StartupPhaseTimer : private boost::noncopyable
+{
+public:
+	explicit StartupPhaseTimer(std::string_view phaseName);
+	~StartupPhaseTimer();
+
+private:
+	const std::string m_phaseName;
+	const std::chrono::steady_clock::time_point m_startTime;
+};
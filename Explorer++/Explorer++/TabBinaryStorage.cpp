@@ -0,0 +1,243 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TabBinaryStorage.h"
+#include "BinaryStorageHelper.h"
+#include "ColumnBinaryStorage.h"
+#include "TabStorage.h"
+#include <cereal/types/string.hpp>
+
+namespace TabBinaryStorage
+{
+
+namespace
+{
+
+// This should be incremented whenever the layout below changes.
+const uint32_t FORMAT_VERSION = 1;
+
+// The pidl is stored as a single block of bytes. That's significantly cheaper than resolving it to
+// a path when saving and then parsing the path when loading. An empty block indicates that there's
+// no pidl.
+PidlAbsolute LoadPidl(cereal::BinaryInputArchive &archive)
+{
+	std::string pidlData;
+	archive(pidlData);
+
+	if (pidlData.empty())
+	{
+		return {};
+	}
+
+	auto *pidl = reinterpret_cast<PCIDLIST_ABSOLUTE>(pidlData.data());
+
+	if (!IDListContainerIsConsistent(pidl, static_cast<UINT>(pidlData.size())))
+	{
+		throw cereal::Exception("Invalid pidl");
+	}
+
+	return pidl;
+}
+
+void SavePidl(cereal::BinaryOutputArchive &archive, const PidlAbsolute &pidl)
+{
+	if (!pidl.HasValue())
+	{
+		archive(std::string());
+		return;
+	}
+
+	archive(std::string(reinterpret_cast<const char *>(pidl.Raw()), ILGetSize(pidl.Raw())));
+}
+
+template <typename T, typename Archive>
+std::optional<T> LoadOptional(Archive &archive)
+{
+	bool hasValue;
+	archive(hasValue);
+
+	if (!hasValue)
+	{
+		return std::nullopt;
+	}
+
+	T value;
+	archive(value);
+	return value;
+}
+
+template <typename Archive, typename T>
+void SaveOptional(Archive &archive, const std::optional<T> &value)
+{
+	archive(value.has_value());
+
+	if (value)
+	{
+		archive(*value);
+	}
+}
+
+TabSettings LoadTabSettings(cereal::BinaryInputArchive &archive)
+{
+	TabSettings tabSettings;
+	tabSettings.name = LoadOptional<std::wstring>(archive);
+
+	auto lockState = LoadOptional<uint32_t>(archive);
+
+	if (lockState)
+	{
+		if (*lockState > static_cast<uint32_t>(Tab::LockState::AddressLocked))
+		{
+			throw cereal::Exception("Invalid lock state");
+		}
+
+		tabSettings.lockState = static_cast<Tab::LockState>(*lockState);
+	}
+
+	return tabSettings;
+}
+
+void SaveTabSettings(cereal::BinaryOutputArchive &archive, const TabSettings &tabSettings)
+{
+	SaveOptional(archive, tabSettings.name);
+
+	std::optional<uint32_t> lockState;
+
+	if (tabSettings.lockState)
+	{
+		lockState = static_cast<uint32_t>(*tabSettings.lockState);
+	}
+
+	SaveOptional(archive, lockState);
+}
+
+FolderSettings LoadFolderSettings(cereal::BinaryInputArchive &archive)
+{
+	FolderSettings folderSettings;
+	folderSettings.sortMode = BinaryStorageHelper::LoadBetterEnum<SortMode>(archive);
+	folderSettings.groupMode = BinaryStorageHelper::LoadBetterEnum<SortMode>(archive);
+	folderSettings.viewMode = BinaryStorageHelper::LoadBetterEnum<ViewMode>(archive);
+	folderSettings.sortDirection = BinaryStorageHelper::LoadBetterEnum<SortDirection>(archive);
+	folderSettings.groupSortDirection =
+		BinaryStorageHelper::LoadBetterEnum<SortDirection>(archive);
+	archive(folderSettings.autoArrange, folderSettings.showInGroups, folderSettings.showHidden,
+		folderSettings.applyFilter, folderSettings.filterCaseSensitive, folderSettings.filter);
+	return folderSettings;
+}
+
+void SaveFolderSettings(cereal::BinaryOutputArchive &archive, const FolderSettings &folderSettings)
+{
+	BinaryStorageHelper::SaveBetterEnum(archive, folderSettings.sortMode);
+	BinaryStorageHelper::SaveBetterEnum(archive, folderSettings.groupMode);
+	BinaryStorageHelper::SaveBetterEnum(archive, folderSettings.viewMode);
+	BinaryStorageHelper::SaveBetterEnum(archive, folderSettings.sortDirection);
+	BinaryStorageHelper::SaveBetterEnum(archive, folderSettings.groupSortDirection);
+	archive(folderSettings.autoArrange, folderSettings.showInGroups, folderSettings.showHidden,
+		folderSettings.applyFilter, folderSettings.filterCaseSensitive, folderSettings.filter);
+}
+
+void LoadHistory(cereal::BinaryInputArchive &archive, TabStorageData &tab)
+{
+	uint32_t numEntries;
+	int32_t currentEntry;
+	archive(numEntries, currentEntry);
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		HistoryEntryStorageData entry;
+		entry.pidl = LoadPidl(archive);
+		archive(entry.displayName, entry.fullPathForDisplay);
+
+		if (!entry.pidl.HasValue())
+		{
+			throw cereal::Exception("Missing history entry pidl");
+		}
+
+		tab.history.push_back(std::move(entry));
+	}
+
+	if (tab.history.empty())
+	{
+		return;
+	}
+
+	if (currentEntry < 0 || static_cast<uint32_t>(currentEntry) >= tab.history.size())
+	{
+		throw cereal::Exception("Invalid current history entry");
+	}
+
+	tab.currentHistoryEntry = currentEntry;
+}
+
+void SaveHistory(cereal::BinaryOutputArchive &archive, const TabStorageData &tab)
+{
+	archive(static_cast<uint32_t>(tab.history.size()),
+		static_cast<int32_t>(tab.currentHistoryEntry));
+
+	for (const auto &entry : tab.history)
+	{
+		SavePidl(archive, entry.pidl);
+		archive(entry.displayName, entry.fullPathForDisplay);
+	}
+}
+
+TabStorageData LoadTab(cereal::BinaryInputArchive &archive)
+{
+	TabStorageData tab;
+	tab.pidl = LoadPidl(archive);
+	archive(tab.directory);
+	tab.tabSettings = LoadTabSettings(archive);
+	tab.folderSettings = LoadFolderSettings(archive);
+	ColumnBinaryStorage::LoadAllColumnSets(archive, tab.columns);
+	LoadHistory(archive, tab);
+	return tab;
+}
+
+void SaveTab(cereal::BinaryOutputArchive &archive, const TabStorageData &tab)
+{
+	SavePidl(archive, tab.pidl);
+	archive(tab.directory);
+	SaveTabSettings(archive, tab.tabSettings);
+	SaveFolderSettings(archive, tab.folderSettings);
+	ColumnBinaryStorage::SaveAllColumnSets(archive, tab.columns);
+	SaveHistory(archive, tab);
+}
+
+}
+
+std::optional<std::vector<TabStorageData>> Load(const std::string &data)
+{
+	return BinaryStorageHelper::Deserialize<std::vector<TabStorageData>>(data, FORMAT_VERSION,
+		[](cereal::BinaryInputArchive &archive)
+		{
+			uint32_t numTabs;
+			archive(numTabs);
+
+			std::vector<TabStorageData> tabs;
+
+			for (uint32_t i = 0; i < numTabs; i++)
+			{
+				tabs.push_back(LoadTab(archive));
+			}
+
+			return tabs;
+		});
+}
+
+std::string Save(const std::vector<TabStorageData> &tabs)
+{
+	return BinaryStorageHelper::Serialize(FORMAT_VERSION,
+		[&tabs](cereal::BinaryOutputArchive &archive)
+		{
+			archive(static_cast<uint32_t>(tabs.size()));
+
+			for (const auto &tab : tabs)
+			{
+				SaveTab(archive, tab);
+			}
+		});
+}
+
+}
@@ -0,0 +1,20 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct TabStorageData;
+
+namespace TabBinaryStorage
+{
+
+// Returns std::nullopt if the data is invalid, in which case none of the tabs will be loaded.
+std::optional<std::vector<TabStorageData>> Load(const std::string &data);
+std::string Save(const std::vector<TabStorageData> &tabs);
+
+}
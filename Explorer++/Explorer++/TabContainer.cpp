@@ -64,7 +64,7 @@ TabContainer::TabContainer(HWND parent, ShellBrowserEmbedder *embedder,
 	m_fontSetter(m_hwnd, config.get(), GetDefaultSystemFontForDefaultDpi()),
 	m_tooltipFontSetter(TabCtrl_GetToolTips(m_hwnd), config.get()),
 	m_timerManager(m_hwnd),
-	m_iconFetcher(m_hwnd, cachedIcons),
+	m_iconFetcher(m_hwnd, cachedIcons, coreInterface->GetBackgroundTaskScheduler()),
 	m_cachedIcons(cachedIcons),
 	m_tabNavigation(tabNavigation),
 	m_coreInterface(coreInterface),
@@ -901,6 +901,35 @@ Tab &TabContainer::CreateNewTab(const PreservedTab &preservedTab)
 	return SetUpNewTab(tab, navigateParams, tabSettings);
 }
 
+Tab &TabContainer::CreateNewTab(
+	const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
+	const TabSettings &tabSettings, const FolderSettings &folderSettings,
+	const FolderColumns *initialColumns)
+{
+	auto shellBrowser = ShellBrowserImpl::CreateWithHistory(m_coreInterface->GetMainWindow(),
+		m_embedder, m_coreInterface, m_tabNavigation, m_fileActionHandler, history, currentEntry,
+		folderSettings, initialColumns);
+	auto tabTemp = std::make_unique<Tab>(shellBrowser);
+	auto item = m_tabs.insert({ tabTemp->GetId(), std::move(tabTemp) });
+
+	Tab &tab = *item.first->second;
+
+	if (tabSettings.lockState)
+	{
+		tab.SetLockState(*tabSettings.lockState);
+	}
+
+	if (tabSettings.name)
+	{
+		tab.SetCustomName(*tabSettings.name);
+	}
+
+	PreservedHistoryEntry *entry = history.at(currentEntry).get();
+	auto navigateParams =
+		NavigateParams::Normal(entry->pidl.Raw(), HistoryEntryType::ReplaceCurrentEntry);
+	return SetUpNewTab(tab, navigateParams, tabSettings);
+}
+
 Tab &TabContainer::CreateNewTab(NavigateParams &navigateParams, const TabSettings &tabSettings,
 	const FolderSettings *folderSettings, const FolderColumns *initialColumns)
 {
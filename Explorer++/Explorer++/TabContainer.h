@@ -28,6 +28,7 @@ struct Config;
 class CoreInterface;
 class FileActionHandler;
 struct NavigateParams;
+struct PreservedHistoryEntry;
 struct PreservedTab;
 class ShellBrowserEmbedder;
 
@@ -91,6 +92,11 @@ public:
 		const FolderSettings *folderSettings = nullptr,
 		const FolderColumns *initialColumns = nullptr);
 	Tab &CreateNewTab(const PreservedTab &preservedTab);
+
+	// Creates a tab with the specified history. The tab will be navigated to the current entry.
+	Tab &CreateNewTab(const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history,
+		int currentEntry, const TabSettings &tabSettings, const FolderSettings &folderSettings,
+		const FolderColumns *initialColumns);
 	Tab &CreateNewTab(NavigateParams &navigateParams, const TabSettings &tabSettings = {},
 		const FolderSettings *folderSettings = nullptr,
 		const FolderColumns *initialColumns = nullptr);
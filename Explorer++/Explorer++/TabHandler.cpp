@@ -6,11 +6,16 @@
 #include "Explorer++.h"
 #include "Bookmarks/BookmarkTreeFactory.h"
 #include "Config.h"
+#include "FolderPrefetcher.h"
+#include "FolderSizeService.h"
 #include "LoadSaveInterface.h"
 #include "MainMenuSubMenuView.h"
 #include "MainResource.h"
 #include "MenuRanges.h"
+#include "ShellBrowser/HistoryEntry.h"
+#include "ShellBrowser/PreservedHistoryEntry.h"
 #include "ShellBrowser/ShellBrowserImpl.h"
+#include "ShellBrowser/ShellNavigationController.h"
 #include "TabContainer.h"
 #include "TabRestorer.h"
 #include "TabRestorerMenu.h"
@@ -94,11 +99,14 @@ boost::signals2::connection Explorerplusplus::AddTabsInitializedObserver(
 
 void Explorerplusplus::OnNavigationCommitted(const Tab &tab, const NavigateParams &navigateParams)
 {
-	UNREFERENCED_PARAMETER(navigateParams);
+	m_frequentLocationsService.RegisterLocationVisit(navigateParams.pidl);
 
 	if (GetActivePane()->GetTabContainer()->IsTabSelected(tab))
 	{
 		UpdateWindowStates(tab);
+
+		m_folderPrefetcher->OnFolderChanged(navigateParams.pidl,
+			tab.GetShellBrowser()->GetShowHidden());
 	}
 
 	StopDirectoryMonitoringForTab(tab);
@@ -173,7 +181,20 @@ void Explorerplusplus::RestorePreviousTabs()
 	{
 		loadedTab.tabSettings.index = index;
 
-		if (loadedTab.pidl.HasValue())
+		if (!loadedTab.history.empty())
+		{
+			std::vector<std::unique_ptr<PreservedHistoryEntry>> history;
+
+			for (const auto &entry : loadedTab.history)
+			{
+				HistoryEntry historyEntry(entry.pidl, entry.displayName, entry.fullPathForDisplay);
+				history.push_back(std::make_unique<PreservedHistoryEntry>(historyEntry));
+			}
+
+			GetActivePane()->GetTabContainer()->CreateNewTab(history, loadedTab.currentHistoryEntry,
+				loadedTab.tabSettings, loadedTab.folderSettings, &loadedTab.columns);
+		}
+		else if (loadedTab.pidl.HasValue())
 		{
 			auto navigateParams = NavigateParams::Normal(loadedTab.pidl.Raw());
 			GetActivePane()->GetTabContainer()->CreateNewTab(navigateParams, loadedTab.tabSettings,
@@ -324,17 +345,22 @@ void Explorerplusplus::HideTabBar()
 
 void Explorerplusplus::OnTabListViewSelectionChanged(const Tab &tab)
 {
-	/* The selection for this tab has changed, so invalidate any
+	/* The selection for this tab has changed, so cancel any
 	folder size calculations that are occurring for this tab
 	(applies only to folder sizes that will be shown in the display
-	window). */
-	for (auto &item : m_DWFolderSizes)
-	{
-		if (item.iTabId == tab.GetId())
+	window). Any results that have already been queued will be
+	ignored, since the calculation will no longer be found. */
+	std::erase_if(m_DWFolderSizes,
+		[this, &tab](const DWFolderSize &folderSize)
 		{
-			item.bValid = FALSE;
-		}
-	}
+			if (folderSize.iTabId != tab.GetId())
+			{
+				return false;
+			}
+
+			m_folderSizeService->CancelRequest(folderSize.requestId);
+			return true;
+		});
 
 	if (GetActivePane()->GetTabContainer()->IsTabSelected(tab))
 	{
@@ -370,6 +396,17 @@ std::vector<TabStorageData> Explorerplusplus::GetTabListStorageData()
 		tabStorageData.folderSettings = tab.GetShellBrowser()->GetFolderSettings();
 		tabStorageData.columns = tab.GetShellBrowser()->ExportAllColumns();
 
+		const auto *navigationController = tab.GetShellBrowser()->GetNavigationController();
+
+		for (int i = 0; i < navigationController->GetNumHistoryEntries(); i++)
+		{
+			const auto *entry = navigationController->GetEntryAtIndex(i);
+			tabStorageData.history.push_back(
+				{ entry->GetPidl(), entry->GetDisplayName(), entry->GetFullPathForDisplay() });
+		}
+
+		tabStorageData.currentHistoryEntry = navigationController->GetCurrentIndex();
+
 		TabSettings tabSettings;
 
 		if (tab.GetUseCustomName())
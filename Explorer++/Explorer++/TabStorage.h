@@ -7,15 +7,31 @@
 #include "ShellBrowser/FolderSettings.h"
 #include "TabContainer.h"
 #include "../Helper/PidlHelper.h"
+#include <vector>
+
+struct HistoryEntryStorageData
+{
+	PidlAbsolute pidl;
+	std::wstring displayName;
+	std::wstring fullPathForDisplay;
+
+	// This is only used in tests.
+	bool operator==(const HistoryEntryStorageData &) const = default;
+};
 
 struct TabStorageData
 {
-	// Currently, the pidl is used when persisting data to the registry. The directory is used when
-	// persisting data to the config file.
+	// Currently, the pidl is used when persisting data to the registry and to the binary session
+	// store. The directory is used when persisting data to the config file.
 	PidlAbsolute pidl;
 	std::wstring directory;
 
 	TabSettings tabSettings;
 	FolderSettings folderSettings;
 	FolderColumns columns;
+
+	// The navigation history is only persisted to the binary session store. If there's no history,
+	// the tab will simply be opened in the directory above.
+	std::vector<HistoryEntryStorageData> history;
+	int currentHistoryEntry = 0;
 };
@@ -10,12 +10,14 @@
 #include "Explorer++.h"
 #include "AcceleratorManager.h"
 #include "CommandLine.h"
+#include "ConfigFileSnapshot.h"
 #include "Console.h"
 #include "CrashHandlerHelper.h"
 #include "Explorer++_internal.h"
 #include "MainResource.h"
 #include "ModelessDialogs.h"
 #include "RegistrySettings.h"
+#include "StartupPhaseTimer.h"
 #include "XMLSettings.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ProcessHelper.h"
@@ -34,6 +36,7 @@
 
 ATOM RegisterMainWindowClass(HINSTANCE hInstance);
 void InitializeLocale();
+std::wstring GetConfigFilePath();
 
 DWORD dwControlClasses = ICC_BAR_CLASSES | ICC_COOL_CLASSES | ICC_LISTVIEW_CLASSES
 	| ICC_USEREX_CLASSES | ICC_STANDARD_CLASSES | ICC_LINK_CLASS;
@@ -173,14 +176,20 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 			}
 		});
 
-	BOOL bAllowMultipleInstances = TRUE;
-	BOOL bLoadSettingsFromXML;
+	// The config file (if any) is parsed once here and the resulting document is then used by all
+	// of the settings loaders that run during startup.
+	std::unique_ptr<ConfigFileSnapshot> configSnapshot;
 
-	bLoadSettingsFromXML = TestConfigFileInternal();
+	{
+		StartupPhaseTimer timer("Parse config file");
+		configSnapshot = ConfigFileSnapshot::Load(GetConfigFilePath());
+	}
 
-	if (bLoadSettingsFromXML)
+	BOOL bAllowMultipleInstances = TRUE;
+
+	if (configSnapshot)
 	{
-		bAllowMultipleInstances = LoadAllowMultipleInstancesFromXML();
+		bAllowMultipleInstances = LoadAllowMultipleInstancesFromXML(configSnapshot->GetDocument());
 	}
 	else
 	{
@@ -258,12 +267,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	Explorerplusplus::InitializationData initializationData;
 	initializationData.commandLineSettings = &commandLineSettings;
 	initializationData.acceleratorManager = &acceleratorManager;
+	initializationData.configSnapshot = configSnapshot.get();
+
+	HWND hwnd;
 
-	/* Create the main window. This window will act as a
-	container for all child windows created. */
-	HWND hwnd = CreateWindow(NExplorerplusplus::CLASS_NAME, NExplorerplusplus::APP_NAME,
-		WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, nullptr,
-		nullptr, hInstance, &initializationData);
+	{
+		StartupPhaseTimer timer("Create main window");
+
+		/* Create the main window. This window will act as a
+		container for all child windows created. */
+		hwnd = CreateWindow(NExplorerplusplus::CLASS_NAME, NExplorerplusplus::APP_NAME,
+			WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
+			nullptr, nullptr, hInstance, &initializationData);
+	}
 
 	if (hwnd == nullptr)
 	{
@@ -276,15 +292,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	WINDOWPLACEMENT wndpl;
 	BOOL bWindowPosLoaded = FALSE;
 
-	if (bLoadSettingsFromXML)
+	if (configSnapshot)
 	{
-		bWindowPosLoaded = LoadWindowPositionFromXML(&wndpl);
+		bWindowPosLoaded = LoadWindowPositionFromXML(configSnapshot->GetDocument(), &wndpl);
 	}
 	else
 	{
 		bWindowPosLoaded = LoadWindowPositionFromRegistry(&wndpl);
 	}
 
+	// All of the settings have now been read, so there's no need to hold onto the parsed document.
+	configSnapshot.reset();
+
 	if (bWindowPosLoaded)
 	{
 		// When shown in its normal size, the window for the application should at least be on
@@ -369,3 +388,15 @@ void InitializeLocale()
 	boost::locale::generator gen;
 	std::locale::global(gen(""));
 }
+
+/* To ensure the configuration file is loaded from the same directory
+as the executable, determine the fully qualified path of the executable,
+then look for the configuration file in that directory. */
+std::wstring GetConfigFilePath()
+{
+	TCHAR szConfigFile[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
+	PathRemoveFileSpec(szConfigFile);
+	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
+	return szConfigFile;
+}
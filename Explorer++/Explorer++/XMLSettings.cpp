@@ -30,7 +30,6 @@
 #include "TabStorage.h"
 #include "TabXmlStorage.h"
 #include "../Helper/Macros.h"
-#include "../Helper/ProcessHelper.h"
 #include "../Helper/XMLSettings.h"
 #include <wil/com.h>
 #include <wil/resource.h>
@@ -116,6 +115,9 @@ will need to be changed correspondingly. */
 #define HASH_GROUP_SORT_DIRECTION_GLOBAL 790225996
 #define HASH_GO_UP_ON_DOUBLE_CLICK 1809284638
 #define HASH_MAIN_FONT 3006124449
+#define HASH_PREFETCH_FOLDERS 1677112581
+#define HASH_DISABLE_PREFETCHING_NETWORK_REMOVABLE 3170392463
+#define HASH_STORE_THUMBNAILS_ON_DISK 1571568209
 
 struct ColumnXMLSaveData
 {
@@ -125,30 +127,13 @@ struct ColumnXMLSaveData
 
 unsigned long hash_setting(unsigned char *str);
 
-BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl)
+BOOL LoadWindowPositionFromXML(IXMLDOMDocument *pXMLDom, WINDOWPLACEMENT *pwndpl)
 {
-	wil::com_ptr_nothrow<IXMLDOMDocument> pXMLDom;
-	pXMLDom.attach(XMLSettings::DomFromCOM());
-
 	if (!pXMLDom)
 	{
 		return FALSE;
 	}
 
-	TCHAR szConfigFile[MAX_PATH];
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	wil::unique_variant var(XMLSettings::VariantString(szConfigFile));
-	VARIANT_BOOL status;
-	pXMLDom->load(var, &status);
-
-	if (status != VARIANT_TRUE)
-	{
-		return FALSE;
-	}
-
 	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
 	auto bstr = wil::make_bstr_nothrow(L"//WindowPosition/*");
 	pXMLDom->selectNodes(bstr.get(), &pNodes);
@@ -238,32 +223,15 @@ BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl)
 	return TRUE;
 }
 
-BOOL LoadAllowMultipleInstancesFromXML()
+BOOL LoadAllowMultipleInstancesFromXML(IXMLDOMDocument *pXMLDom)
 {
 	BOOL bAllowMultipleInstances = TRUE;
 
-	wil::com_ptr_nothrow<IXMLDOMDocument> pXMLDom;
-	pXMLDom.attach(XMLSettings::DomFromCOM());
-
 	if (!pXMLDom)
 	{
 		return bAllowMultipleInstances;
 	}
 
-	TCHAR szConfigFile[MAX_PATH];
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	VARIANT_BOOL status;
-	wil::unique_variant var(XMLSettings::VariantString(szConfigFile));
-	pXMLDom->load(var, &status);
-
-	if (status != VARIANT_TRUE)
-	{
-		return bAllowMultipleInstances;
-	}
-
 	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
 	auto bstr = wil::make_bstr_nothrow(L"//Settings/*");
 	pXMLDom->selectNodes(bstr.get(), &pNodes);
@@ -653,6 +621,19 @@ void Explorerplusplus::SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDO
 		_T("ShowQuickAccessInTreeView"),
 		XMLSettings::EncodeBoolValue(m_config->showQuickAccessInTreeView.get()));
 
+	XMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	XMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("PrefetchFolders"),
+		XMLSettings::EncodeBoolValue(m_config->prefetchFolders));
+
+	XMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	XMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("DisablePrefetchingNetworkRemovable"),
+		XMLSettings::EncodeBoolValue(m_config->disablePrefetchingNetworkRemovable));
+
+	XMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	XMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("StoreThumbnailsOnDisk"),
+		XMLSettings::EncodeBoolValue(m_config->storeThumbnailsOnDisk));
+
 	XMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
 	XMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("Theme"),
 		XMLSettings::EncodeIntValue(m_config->theme.get()));
@@ -1230,6 +1211,18 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 		m_config->goUpOnDoubleClick = XMLSettings::DecodeBoolValue(wszValue);
 		break;
 
+	case HASH_PREFETCH_FOLDERS:
+		m_config->prefetchFolders = XMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_DISABLE_PREFETCHING_NETWORK_REMOVABLE:
+		m_config->disablePrefetchingNetworkRemovable = XMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_STORE_THUMBNAILS_ON_DISK:
+		m_config->storeThumbnailsOnDisk = XMLSettings::DecodeBoolValue(wszValue);
+		break;
+
 	case HASH_MAIN_FONT:
 	{
 		auto mainFont = LoadCustomFontFromXml(pNode);
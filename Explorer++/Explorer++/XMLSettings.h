@@ -5,6 +5,7 @@
 #pragma once
 
 #include <Windows.h>
+#include <MsXml2.h>
 
-BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl);
-BOOL LoadAllowMultipleInstancesFromXML(void);
+BOOL LoadWindowPositionFromXML(IXMLDOMDocument *pXMLDom, WINDOWPLACEMENT *pwndpl);
+BOOL LoadAllowMultipleInstancesFromXML(IXMLDOMDocument *pXMLDom);
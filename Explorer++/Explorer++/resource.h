@@ -442,6 +442,8 @@
 #define IDC_OPTIONS_FONT_RESET_TO_DEFAULT 1371
 #define IDC_OPTIONS_FONT_SAMPLE         1372
 #define IDC_OPTIONS_MAIN_FONT           1373
+#define IDC_SPLIT_STATIC_PROGRESSDETAILS 1374
+#define IDC_DESTROYFILES_PROGRESS       1375
 #define IDS_COLUMN_DESCRIPTION_NAME     2000
 #define IDS_COLUMN_DESCRIPTION_TYPE     2001
 #define IDS_COLUMN_DESCRIPTION_SIZE     2002
@@ -681,6 +683,16 @@
 #define IDS_GENERAL_TOTALFILESIZE       8215
 #define IDS_GENERAL_CALCULATING         8216
 #define IDS_TAB_CLOSE_TIP               8217
+#define IDS_SPLITFILEDIALOG_PROGRESSDETAILS 8218
+#define IDS_SPLITFILEDIALOG_SPLITFAILED 8219
+#define IDS_SHELLTREEVIEW_LOADING       8220
+#define IDS_ADVANCED_OPTION_PREFETCH_FOLDERS_NAME 8221
+#define IDS_ADVANCED_OPTION_PREFETCH_FOLDERS_DESCRIPTION 8222
+#define IDS_ADVANCED_OPTION_DISABLE_PREFETCHING_NETWORK_REMOVABLE_NAME 8223
+#define IDS_ADVANCED_OPTION_DISABLE_PREFETCHING_NETWORK_REMOVABLE_DESCRIPTION 8224
+#define IDS_ADVANCED_OPTION_STORE_THUMBNAILS_ON_DISK_NAME 8225
+#define IDS_ADVANCED_OPTION_STORE_THUMBNAILS_ON_DISK_DESCRIPTION 8226
+#define IDS_DESTROY_FILES_FAILED        8227
 #define IDM_FILE_NEWTAB                 40056
 #define IDM_FILE_CLOSETAB               40057
 #define IDM_FILE_OPENCOMMANDPROMPT      40059
@@ -1021,7 +1033,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        404
 #define _APS_NEXT_COMMAND_VALUE         40553
-#define _APS_NEXT_CONTROL_VALUE         1374
+#define _APS_NEXT_CONTROL_VALUE         1376
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -30,7 +30,6 @@
 #include "../Helper/DisableUnaligned.h"
 
 // Third-party Header Files:
-#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/memory.hpp>
 #include <cereal/types/string.hpp>
@@ -106,11 +105,17 @@
 
 // C++ Header Files:
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <queue>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <vector>
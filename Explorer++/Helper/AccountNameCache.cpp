@@ -0,0 +1,215 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "AccountNameCache.h"
+#include <wil/resource.h>
+#include <ntsecapi.h>
+#include <set>
+
+AccountNameCache &AccountNameCache::GetInstance()
+{
+	static AccountNameCache accountNameCache(&AccountNameCache::LookupAccountNames,
+		[] { return std::chrono::steady_clock::now(); });
+	return accountNameCache;
+}
+
+AccountNameCache::AccountNameCache(AccountLookup lookup, Clock clock) :
+	m_lookup(std::move(lookup)),
+	m_clock(std::move(clock))
+{
+}
+
+std::optional<std::wstring> AccountNameCache::GetAccountName(PSID sid)
+{
+	auto key = GetSidKey(sid);
+
+	if (!key)
+	{
+		return std::nullopt;
+	}
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		const auto *entry = FindEntry(*key, m_clock());
+
+		if (entry)
+		{
+			m_stats.hits++;
+			return entry->accountName;
+		}
+
+		m_stats.misses++;
+	}
+
+	// The lock isn't held during the lookup, since that may take some time. If another thread
+	// looks up the same SID in the meantime, the result will simply be cached twice.
+	auto accountNames = m_lookup({ sid });
+	auto accountName = !accountNames.empty() ? accountNames[0] : std::nullopt;
+
+	InsertEntries({ *key }, { accountName });
+
+	return accountName;
+}
+
+void AccountNameCache::Prefetch(const std::vector<PSID> &sids)
+{
+	std::vector<PSID> missingSids;
+	std::vector<SidKey> missingKeys;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto now = m_clock();
+		std::set<SidKey> seenKeys;
+
+		for (auto sid : sids)
+		{
+			auto key = GetSidKey(sid);
+
+			if (!key || FindEntry(*key, now) || !seenKeys.insert(*key).second)
+			{
+				continue;
+			}
+
+			missingSids.push_back(sid);
+			missingKeys.push_back(std::move(*key));
+		}
+
+		m_stats.misses += missingKeys.size();
+	}
+
+	if (missingSids.empty())
+	{
+		return;
+	}
+
+	InsertEntries(missingKeys, m_lookup(missingSids));
+}
+
+AccountNameCache::Stats AccountNameCache::GetStats() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_stats;
+}
+
+// Should be called with the mutex held.
+const AccountNameCache::Entry *AccountNameCache::FindEntry(const SidKey &key,
+	std::chrono::steady_clock::time_point now) const
+{
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end() || itr->second.expiryTime <= now)
+	{
+		return nullptr;
+	}
+
+	return &itr->second;
+}
+
+void AccountNameCache::InsertEntries(const std::vector<SidKey> &keys,
+	const std::vector<std::optional<std::wstring>> &accountNames)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto now = m_clock();
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		// If the lookup didn't return a result for the SID, it's treated as being unresolved.
+		auto accountName = i < accountNames.size() ? accountNames[i] : std::nullopt;
+
+		std::chrono::steady_clock::duration lifetime = RESOLVED_ENTRY_LIFETIME;
+
+		if (!accountName)
+		{
+			lifetime = UNRESOLVED_ENTRY_LIFETIME;
+		}
+
+		m_entries.insert_or_assign(keys[i], Entry{ std::move(accountName), now + lifetime });
+	}
+}
+
+std::optional<AccountNameCache::SidKey> AccountNameCache::GetSidKey(PSID sid)
+{
+	if (!sid || !IsValidSid(sid))
+	{
+		return std::nullopt;
+	}
+
+	const auto *sidBytes = static_cast<const BYTE *>(sid);
+	return SidKey(sidBytes, sidBytes + GetLengthSid(sid));
+}
+
+// Unlike LookupAccountSid(), LsaLookupSids() can resolve any number of SIDs at once, which means
+// that a set of SIDs that all need to be resolved by a domain controller can be looked up in a
+// single round trip.
+std::vector<std::optional<std::wstring>> AccountNameCache::LookupAccountNames(
+	const std::vector<PSID> &sids)
+{
+	std::vector<std::optional<std::wstring>> accountNames(sids.size());
+
+	LSA_OBJECT_ATTRIBUTES objectAttributes = {};
+	LSA_HANDLE policy;
+	NTSTATUS status = LsaOpenPolicy(nullptr, &objectAttributes, POLICY_LOOKUP_NAMES, &policy);
+
+	if (status < 0)
+	{
+		return accountNames;
+	}
+
+	auto closePolicy = wil::scope_exit([policy] { LsaClose(policy); });
+
+	PLSA_REFERENCED_DOMAIN_LIST domains = nullptr;
+	PLSA_TRANSLATED_NAME names = nullptr;
+	status = LsaLookupSids(policy, static_cast<ULONG>(sids.size()),
+		const_cast<PSID *>(sids.data()), &domains, &names);
+
+	// The output buffers can be allocated even if the call fails.
+	auto freeBuffers = wil::scope_exit(
+		[domains, names]
+		{
+			if (domains)
+			{
+				LsaFreeMemory(domains);
+			}
+
+			if (names)
+			{
+				LsaFreeMemory(names);
+			}
+		});
+
+	// Note that a positive status here indicates that only some of the SIDs could be resolved.
+	if (status < 0)
+	{
+		return accountNames;
+	}
+
+	for (size_t i = 0; i < sids.size(); i++)
+	{
+		const auto &name = names[i];
+
+		if (name.Use == SidTypeInvalid || name.Use == SidTypeUnknown)
+		{
+			continue;
+		}
+
+		// Some accounts (e.g. Everyone) don't belong to a domain, in which case the domain name is
+		// left empty, as it is when the account is looked up via LookupAccountSid().
+		std::wstring domainName;
+
+		if (name.DomainIndex >= 0 && static_cast<ULONG>(name.DomainIndex) < domains->Entries)
+		{
+			const auto &domain = domains->Domains[name.DomainIndex].Name;
+			domainName.assign(domain.Buffer, domain.Length / sizeof(WCHAR));
+		}
+
+		accountNames[i] =
+			domainName + L"\\" + std::wstring(name.Name.Buffer, name.Name.Length / sizeof(WCHAR));
+	}
+
+	return accountNames;
+}
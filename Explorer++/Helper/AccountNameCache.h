@@ -0,0 +1,82 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Maps SIDs to account names (in the form "DOMAIN\user"). Looking up an account can require a
+// round trip to a domain controller, yet the files in a folder are typically owned by only a
+// handful of accounts. Caching the names means that each account only needs to be looked up
+// once, rather than once for every file.
+//
+// SIDs that can't be resolved (e.g. because the account has been deleted, or the domain controller
+// can't be reached) are cached as well, so that they aren't repeatedly looked up. Entries expire
+// after a period of time, so that renamed accounts will eventually be picked up. Unresolved
+// entries expire sooner, since the failure may only be temporary.
+//
+// This class is thread-safe.
+class AccountNameCache : private boost::noncopyable
+{
+public:
+	// Looks up the account names for a set of SIDs. The returned vector should contain an entry
+	// for each SID, which should be empty if the SID couldn't be resolved.
+	using AccountLookup =
+		std::function<std::vector<std::optional<std::wstring>>(const std::vector<PSID> &sids)>;
+	using Clock = std::function<std::chrono::steady_clock::time_point()>;
+
+	struct Stats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+	};
+
+	static constexpr std::chrono::hours RESOLVED_ENTRY_LIFETIME = std::chrono::hours(1);
+	static constexpr std::chrono::minutes UNRESOLVED_ENTRY_LIFETIME = std::chrono::minutes(5);
+
+	static AccountNameCache &GetInstance();
+
+	AccountNameCache(AccountLookup lookup, Clock clock);
+
+	// Returns the account name for the SID, or an empty value if the SID couldn't be resolved.
+	std::optional<std::wstring> GetAccountName(PSID sid);
+
+	// Looks up all the SIDs that aren't already cached with a single call, so that callers that
+	// are about to request the names for a set of items (e.g. the owners for a batch of files)
+	// only have to wait on a single lookup.
+	void Prefetch(const std::vector<PSID> &sids);
+
+	Stats GetStats() const;
+
+private:
+	using SidKey = std::vector<BYTE>;
+
+	struct Entry
+	{
+		std::optional<std::wstring> accountName;
+		std::chrono::steady_clock::time_point expiryTime;
+	};
+
+	const Entry *FindEntry(const SidKey &key, std::chrono::steady_clock::time_point now) const;
+	void InsertEntries(const std::vector<SidKey> &keys,
+		const std::vector<std::optional<std::wstring>> &accountNames);
+	static std::optional<SidKey> GetSidKey(PSID sid);
+	static std::vector<std::optional<std::wstring>> LookupAccountNames(
+		const std::vector<PSID> &sids);
+
+	const AccountLookup m_lookup;
+	const Clock m_clock;
+
+	mutable std::mutex m_mutex;
+	std::map<SidKey, Entry> m_entries;
+	Stats m_stats;
+};
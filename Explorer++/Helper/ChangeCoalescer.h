@@ -0,0 +1,243 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Reduces a sequence of change events to the net set of changes, so that each item is only updated
+// once, however many events were received for it. For example, an item that's created and then
+// deleted results in no change, an item that's modified several times results in a single
+// modification and a chain of renames results in a single rename from the original name to the
+// final one.
+//
+// Each item is identified by a key, which is expected to be unique at any given point in time. Item
+// is the data that's needed to apply a change (e.g. a pidl). For removals, modifications and
+// renames, the original item is the one that was passed in with the first event for that item,
+// allowing the item to be located using the details it had before any of the changes.
+template <class Key, class Item, class Hash = std::hash<Key>>
+class ChangeCoalescer
+{
+public:
+	enum class ChangeType
+	{
+		Added,
+		Removed,
+		Modified,
+		Renamed
+	};
+
+	struct Change
+	{
+		ChangeType type;
+
+		// Set for removals, modifications and renames.
+		std::optional<Item> originalItem;
+
+		// Set for additions, modifications and renames.
+		std::optional<Item> currentItem;
+	};
+
+	void OnItemAdded(const Key &key, const Item &item)
+	{
+		m_numEvents++;
+
+		auto *entry = FindEntry(key);
+
+		if (!entry)
+		{
+			AddEntry(key, std::nullopt, std::nullopt, item);
+			return;
+		}
+
+		// If the item already existed, it's been replaced, which is treated as a modification.
+		entry->currentItem = item;
+		entry->modified = true;
+	}
+
+	void OnItemRemoved(const Key &key, const Item &item)
+	{
+		m_numEvents++;
+
+		auto *entry = FindEntry(key);
+
+		if (!entry)
+		{
+			AddEntry(key, key, item, std::nullopt);
+			return;
+		}
+
+		entry->currentItem.reset();
+	}
+
+	void OnItemModified(const Key &key, const Item &item)
+	{
+		m_numEvents++;
+
+		auto *entry = FindEntry(key);
+
+		if (!entry)
+		{
+			auto &newEntry = AddEntry(key, key, item, item);
+			newEntry.modified = true;
+			return;
+		}
+
+		// A modification to an item that's been removed can't be applied.
+		if (!entry->currentItem)
+		{
+			return;
+		}
+
+		entry->currentItem = item;
+		entry->modified = true;
+	}
+
+	void OnItemRenamed(const Key &oldKey, const Item &oldItem, const Key &newKey,
+		const Item &newItem)
+	{
+		if (oldKey == newKey)
+		{
+			OnItemModified(newKey, newItem);
+			return;
+		}
+
+		auto *oldEntry = FindEntry(oldKey);
+
+		if (oldEntry && !oldEntry->currentItem)
+		{
+			// The item no longer exists under its old name, so all that's known is that an item
+			// now exists with the new name.
+			OnItemAdded(newKey, newItem);
+			return;
+		}
+
+		m_numEvents++;
+
+		if (!oldEntry)
+		{
+			AddEntry(oldKey, oldKey, oldItem, oldItem);
+		}
+
+		auto oldItr = m_currentEntries.find(oldKey);
+		size_t entryIndex = oldItr->second;
+		m_currentEntries.erase(oldItr);
+
+		// Any item that currently has the new name is replaced. Its entry is kept (so that the
+		// removal of the original item can be reported), but can no longer be found by key.
+		auto newItr = m_currentEntries.find(newKey);
+
+		if (newItr != m_currentEntries.end())
+		{
+			m_entries[newItr->second].currentItem.reset();
+			m_currentEntries.erase(newItr);
+		}
+
+		auto &entry = m_entries[entryIndex];
+		entry.currentKey = newKey;
+		entry.currentItem = newItem;
+		m_currentEntries.emplace(newKey, entryIndex);
+	}
+
+	// Returns the net changes. Removals are listed first, followed by renames, modifications and,
+	// finally, additions.
+	std::vector<Change> GetChanges() const
+	{
+		std::vector<Change> removals;
+		std::vector<Change> renames;
+		std::vector<Change> modifications;
+		std::vector<Change> additions;
+
+		for (const auto &entry : m_entries)
+		{
+			if (entry.originalKey && !entry.currentItem)
+			{
+				removals.push_back({ ChangeType::Removed, entry.originalItem, std::nullopt });
+			}
+			else if (entry.originalKey && *entry.originalKey != entry.currentKey)
+			{
+				renames.push_back({ ChangeType::Renamed, entry.originalItem, entry.currentItem });
+			}
+			else if (entry.originalKey && entry.modified)
+			{
+				modifications.push_back(
+					{ ChangeType::Modified, entry.originalItem, entry.currentItem });
+			}
+			else if (!entry.originalKey && entry.currentItem)
+			{
+				additions.push_back({ ChangeType::Added, std::nullopt, entry.currentItem });
+			}
+		}
+
+		std::vector<Change> changes = std::move(removals);
+		changes.insert(changes.end(), renames.begin(), renames.end());
+		changes.insert(changes.end(), modifications.begin(), modifications.end());
+		changes.insert(changes.end(), additions.begin(), additions.end());
+		return changes;
+	}
+
+	// The number of events that have been passed in, before coalescing.
+	size_t GetNumEvents() const
+	{
+		return m_numEvents;
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+		m_currentEntries.clear();
+		m_numEvents = 0;
+	}
+
+private:
+	struct Entry
+	{
+		// Only set if the item existed before the first event for it was received.
+		std::optional<Key> originalKey;
+		std::optional<Item> originalItem;
+
+		Key currentKey;
+
+		// Only set if the item exists after the most recent event for it.
+		std::optional<Item> currentItem;
+
+		bool modified = false;
+	};
+
+	Entry *FindEntry(const Key &key)
+	{
+		auto itr = m_currentEntries.find(key);
+
+		if (itr == m_currentEntries.end())
+		{
+			return nullptr;
+		}
+
+		return &m_entries[itr->second];
+	}
+
+	Entry &AddEntry(const Key &key, std::optional<Key> originalKey,
+		std::optional<Item> originalItem, std::optional<Item> currentItem)
+	{
+		Entry entry;
+		entry.originalKey = std::move(originalKey);
+		entry.originalItem = std::move(originalItem);
+		entry.currentKey = key;
+		entry.currentItem = std::move(currentItem);
+
+		m_entries.push_back(std::move(entry));
+		m_currentEntries.emplace(key, m_entries.size() - 1);
+
+		return m_entries.back();
+	}
+
+	// Entries are stored in the order in which the items were first seen. Entries for items that
+	// have been replaced by a rename remain here, but are removed from the key map.
+	std::vector<Entry> m_entries;
+	std::unordered_map<Key, size_t, Hash> m_currentEntries;
+	size_t m_numEvents = 0;
+};
@@ -0,0 +1,267 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileCopyEngine.h"
+#include <algorithm>
+#include <cstddef>
+
+FileCopyEngine::FileCopyEngine(DWORD chunkSize) : m_chunkSize(chunkSize)
+{
+	assert(chunkSize > 0);
+}
+
+DWORD FileCopyEngine::GetChunkSize() const
+{
+	return m_chunkSize;
+}
+
+HRESULT FileCopyEngine::Copy(HANDLE source, uint64_t sourceOffset, HANDLE destination,
+	uint64_t destinationOffset, uint64_t numBytes, const ProgressCallback &progressCallback,
+	uint64_t &bytesCopied)
+{
+	bytesCopied = 0;
+
+	HRESULT hr = AllocateBuffers();
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Reading past the end of the file is handled below, but knowing the size up front means that
+	// the final (empty) read can usually be avoided.
+	LARGE_INTEGER sourceSize;
+
+	if (GetFileSizeEx(source, &sourceSize))
+	{
+		auto remainingSize = static_cast<uint64_t>(sourceSize.QuadPart);
+		remainingSize = (sourceOffset < remainingSize) ? remainingSize - sourceOffset : 0;
+		numBytes = (std::min)(numBytes, remainingSize);
+	}
+
+	if (numBytes == 0)
+	{
+		return S_OK;
+	}
+
+	uint64_t bytesRead = 0;
+	size_t current = 0;
+
+	hr = StartOperation(m_slots[current], Operation::Read, source, sourceOffset,
+		static_cast<DWORD>((std::min)(numBytes, static_cast<uint64_t>(m_chunkSize))));
+
+	// At the start of each iteration, the current slot holds the most recent read (if any) and the
+	// other slot holds the most recent write (if any). Once both have finished, the next read is
+	// started in the slot that was used for writing, while the data that was just read is written
+	// out.
+	while (SUCCEEDED(hr))
+	{
+		Slot &readSlot = m_slots[current];
+		Slot &writeSlot = m_slots[1 - current];
+
+		if (readSlot.operation == Operation::None && writeSlot.operation == Operation::None)
+		{
+			break;
+		}
+
+		DWORD chunkBytesRead = 0;
+
+		if (readSlot.operation == Operation::Read)
+		{
+			hr = FinishOperation(readSlot, chunkBytesRead);
+
+			if (FAILED(hr))
+			{
+				break;
+			}
+		}
+
+		if (writeSlot.operation == Operation::Write)
+		{
+			DWORD expectedBytesWritten = writeSlot.size;
+			DWORD chunkBytesWritten;
+			hr = FinishOperation(writeSlot, chunkBytesWritten);
+
+			if (FAILED(hr))
+			{
+				break;
+			}
+
+			bytesCopied += chunkBytesWritten;
+
+			if (chunkBytesWritten != expectedBytesWritten)
+			{
+				hr = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+				break;
+			}
+
+			if (progressCallback && !progressCallback(bytesCopied))
+			{
+				hr = E_ABORT;
+				break;
+			}
+		}
+
+		if (chunkBytesRead == 0)
+		{
+			// Either there's nothing left to read, or the file has been truncated. Either way,
+			// the only thing left to do is to wait for the final write to finish.
+			continue;
+		}
+
+		uint64_t chunkOffset = bytesRead;
+		bytesRead += chunkBytesRead;
+
+		// A short read means that the end of the file has been reached.
+		if (chunkBytesRead == readSlot.size && bytesRead < numBytes)
+		{
+			hr = StartOperation(writeSlot, Operation::Read, source, sourceOffset + bytesRead,
+				static_cast<DWORD>(
+					(std::min)(numBytes - bytesRead, static_cast<uint64_t>(m_chunkSize))));
+
+			if (FAILED(hr))
+			{
+				break;
+			}
+		}
+
+		hr = StartOperation(readSlot, Operation::Write, destination,
+			destinationOffset + chunkOffset, chunkBytesRead);
+
+		current = 1 - current;
+	}
+
+	// The buffers can't be reused until any operation that's still outstanding has finished.
+	for (auto &slot : m_slots)
+	{
+		CancelOperation(slot);
+	}
+
+	return hr;
+}
+
+HRESULT FileCopyEngine::AllocateBuffers()
+{
+	if (m_bufferMemory)
+	{
+		return S_OK;
+	}
+
+	for (auto &slot : m_slots)
+	{
+		if (!slot.event.try_create(wil::EventOptions::ManualReset, nullptr))
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+	}
+
+	auto bufferMemory =
+		ParallelIoHelper::AllocateAlignedBuffer(static_cast<SIZE_T>(m_chunkSize) * m_slots.size());
+
+	if (!bufferMemory)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].buffer = static_cast<std::byte *>(bufferMemory.get()) + (i * m_chunkSize);
+	}
+
+	m_bufferMemory = std::move(bufferMemory);
+
+	return S_OK;
+}
+
+HRESULT FileCopyEngine::StartOperation(Slot &slot, Operation operation, HANDLE file,
+	uint64_t offset, DWORD size)
+{
+	assert(slot.operation == Operation::None);
+
+	slot.overlapped = {};
+	slot.overlapped.Offset = static_cast<DWORD>(offset);
+	slot.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	slot.overlapped.hEvent = slot.event.get();
+	slot.file = file;
+	slot.size = size;
+	slot.endOfFile = false;
+
+	BOOL res;
+
+	if (operation == Operation::Read)
+	{
+		res = ReadFile(file, slot.buffer, size, nullptr, &slot.overlapped);
+	}
+	else
+	{
+		res = WriteFile(file, slot.buffer, size, nullptr, &slot.overlapped);
+	}
+
+	if (!res)
+	{
+		DWORD error = GetLastError();
+
+		if (operation == Operation::Read && error == ERROR_HANDLE_EOF)
+		{
+			slot.endOfFile = true;
+		}
+		else if (error != ERROR_IO_PENDING)
+		{
+			return HRESULT_FROM_WIN32(error);
+		}
+	}
+
+	slot.operation = operation;
+
+	return S_OK;
+}
+
+HRESULT FileCopyEngine::FinishOperation(Slot &slot, DWORD &bytesTransferred)
+{
+	assert(slot.operation != Operation::None);
+
+	bytesTransferred = 0;
+
+	Operation operation = slot.operation;
+	slot.operation = Operation::None;
+
+	if (slot.endOfFile)
+	{
+		return S_OK;
+	}
+
+	if (!GetOverlappedResult(slot.file, &slot.overlapped, &bytesTransferred, TRUE))
+	{
+		DWORD error = GetLastError();
+
+		if (operation == Operation::Read && error == ERROR_HANDLE_EOF)
+		{
+			bytesTransferred = 0;
+			return S_OK;
+		}
+
+		return HRESULT_FROM_WIN32(error);
+	}
+
+	return S_OK;
+}
+
+void FileCopyEngine::CancelOperation(Slot &slot)
+{
+	if (slot.operation == Operation::None)
+	{
+		return;
+	}
+
+	if (!slot.endOfFile)
+	{
+		CancelIoEx(slot.file, &slot.overlapped);
+
+		DWORD bytesTransferred;
+		GetOverlappedResult(slot.file, &slot.overlapped, &bytesTransferred, TRUE);
+	}
+
+	slot.operation = Operation::None;
+}
@@ -0,0 +1,73 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ParallelIoHelper.h"
+#include <wil/resource.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+
+// Copies data between files in fixed-size chunks, so that the amount of memory used doesn't depend
+// on the size of the files involved. Two buffers are used, so that the next chunk can be read while
+// the previous one is being written out. That overlap is only possible if the files were opened
+// with FILE_FLAG_OVERLAPPED. Otherwise, each read and write will simply complete before the call
+// that started it returns.
+//
+// The buffers are page-aligned and are allocated the first time they're needed, then reused for
+// each subsequent copy, so a single instance can be used to copy a series of files. An instance
+// should only be used from one thread at a time.
+class FileCopyEngine
+{
+public:
+	// Invoked each time a chunk has been written, with the number of bytes copied so far during the
+	// current copy. Returning false stops the copy.
+	using ProgressCallback = std::function<bool(uint64_t bytesCopied)>;
+
+	static const DWORD DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+	explicit FileCopyEngine(DWORD chunkSize = DEFAULT_CHUNK_SIZE);
+
+	// Copies up to numBytes from the source file (starting at sourceOffset) to the destination
+	// file (starting at destinationOffset). If the end of the source file is reached first, the
+	// copy will finish early. In every case, bytesCopied is set to the number of bytes that were
+	// written to the destination. Returns E_ABORT if the copy was stopped by the progress callback.
+	HRESULT Copy(HANDLE source, uint64_t sourceOffset, HANDLE destination,
+		uint64_t destinationOffset, uint64_t numBytes, const ProgressCallback &progressCallback,
+		uint64_t &bytesCopied);
+
+	DWORD GetChunkSize() const;
+
+private:
+	enum class Operation
+	{
+		None,
+		Read,
+		Write
+	};
+
+	struct Slot
+	{
+		void *buffer = nullptr;
+		wil::unique_event_nothrow event;
+		OVERLAPPED overlapped = {};
+		Operation operation = Operation::None;
+		HANDLE file = nullptr;
+		DWORD size = 0;
+
+		// Set if a read failed immediately because the offset was past the end of the file.
+		bool endOfFile = false;
+	};
+
+	HRESULT AllocateBuffers();
+	static HRESULT StartOperation(Slot &slot, Operation operation, HANDLE file, uint64_t offset,
+		DWORD size);
+	static HRESULT FinishOperation(Slot &slot, DWORD &bytesTransferred);
+	static void CancelOperation(Slot &slot);
+
+	const DWORD m_chunkSize;
+	ParallelIoHelper::AlignedBuffer m_bufferMemory;
+	std::array<Slot, 2> m_slots;
+};
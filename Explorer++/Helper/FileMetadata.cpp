@@ -0,0 +1,158 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileMetadata.h"
+#include <wil/com.h>
+
+std::optional<FileVersionInfo> FileVersionInfo::Load(const std::wstring &filePath)
+{
+	DWORD size = GetFileVersionInfoSize(filePath.c_str(), nullptr);
+
+	if (size == 0)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<std::byte> block(size);
+	BOOL res = GetFileVersionInfo(filePath.c_str(), 0, size, block.data());
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	LangAndCodePage *translations;
+	UINT translationsSize;
+	res = VerQueryValue(block.data(), L"\\VarFileInfo\\Translation",
+		reinterpret_cast<LPVOID *>(&translations), &translationsSize);
+
+	if (!res || translationsSize < sizeof(LangAndCodePage))
+	{
+		return std::nullopt;
+	}
+
+	std::vector<LangAndCodePage> translationsCopy(translations,
+		translations + (translationsSize / sizeof(LangAndCodePage)));
+
+	return FileVersionInfo(std::move(block), std::move(translationsCopy));
+}
+
+FileVersionInfo::FileVersionInfo(std::vector<std::byte> block,
+	std::vector<LangAndCodePage> translations) :
+	m_block(std::move(block)),
+	m_translations(std::move(translations))
+{
+}
+
+std::optional<std::wstring> FileVersionInfo::GetString(const std::wstring &name) const
+{
+	LANGID userLangId = GetUserDefaultLangID();
+
+	for (const auto &translation : m_translations)
+	{
+		// If the primary language matches the user's language, the strings in this table are in
+		// the user's language. A language of 0 indicates that the strings are language-neutral.
+		if ((translation.wLanguage & 0xFF) != (userLangId & 0xFF) && translation.wLanguage != 0)
+		{
+			continue;
+		}
+
+		WCHAR subBlock[64];
+		StringCchPrintf(subBlock, std::size(subBlock), L"\\StringFileInfo\\%04X%04X\\%s",
+			translation.wLanguage, translation.wCodePage, name.c_str());
+
+		WCHAR *value;
+		UINT valueLength;
+		BOOL res = VerQueryValue(m_block.data(), subBlock, reinterpret_cast<LPVOID *>(&value),
+			&valueLength);
+
+		if (res && valueLength > 0)
+		{
+			return value;
+		}
+	}
+
+	return std::nullopt;
+}
+
+MediaMetadataReader &MediaMetadataReader::GetInstance()
+{
+	static MediaMetadataReader mediaMetadataReader;
+	return mediaMetadataReader;
+}
+
+MediaMetadataReader::MediaMetadataReader() : m_wmvCore(LoadLibrary(L"wmvcore.dll"))
+{
+	if (m_wmvCore)
+	{
+		m_createEditor = reinterpret_cast<WMCreateEditorProc>(
+			GetProcAddress(m_wmvCore.get(), "WMCreateEditor"));
+	}
+}
+
+std::unordered_map<std::wstring, MediaAttribute> MediaMetadataReader::ReadAttributes(
+	const std::wstring &filePath, const std::vector<std::wstring> &attributeNames) const
+{
+	std::unordered_map<std::wstring, MediaAttribute> attributes;
+
+	if (!m_createEditor || attributeNames.empty())
+	{
+		return attributes;
+	}
+
+	wil::com_ptr_nothrow<IWMMetadataEditor> editor;
+	HRESULT hr = m_createEditor(&editor);
+
+	if (FAILED(hr))
+	{
+		return attributes;
+	}
+
+	hr = editor->Open(filePath.c_str());
+
+	if (FAILED(hr))
+	{
+		return attributes;
+	}
+
+	auto closeEditor = wil::scope_exit([&editor] { editor->Close(); });
+
+	auto headerInfo = editor.try_query<IWMHeaderInfo>();
+
+	if (!headerInfo)
+	{
+		return attributes;
+	}
+
+	for (const auto &attributeName : attributeNames)
+	{
+		// Any stream. Should be zero for MP3 files.
+		WORD streamNum = 0;
+		WMT_ATTR_DATATYPE type;
+		WORD length;
+		hr = headerInfo->GetAttributeByName(&streamNum, attributeName.c_str(), &type, nullptr,
+			&length);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		MediaAttribute attribute;
+		attribute.value.resize(length);
+		hr = headerInfo->GetAttributeByName(&streamNum, attributeName.c_str(), &attribute.type,
+			attribute.value.data(), &length);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		attribute.value.resize(length);
+		attributes.insert({ attributeName, std::move(attribute) });
+	}
+
+	return attributes;
+}
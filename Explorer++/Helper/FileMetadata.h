@@ -0,0 +1,63 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Helper.h"
+#include <boost/core/noncopyable.hpp>
+#include <wil/resource.h>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The version resource of a file. The resource is read from the file once, after which any number
+// of values can be retrieved from it.
+class FileVersionInfo
+{
+public:
+	static std::optional<FileVersionInfo> Load(const std::wstring &filePath);
+
+	// Returns the named value (e.g. "CompanyName") from the string table that matches the user's
+	// language, or the language-neutral string table.
+	std::optional<std::wstring> GetString(const std::wstring &name) const;
+
+private:
+	FileVersionInfo(std::vector<std::byte> block, std::vector<LangAndCodePage> translations);
+
+	std::vector<std::byte> m_block;
+	std::vector<LangAndCodePage> m_translations;
+};
+
+// A single attribute from the header of a media file. The format of the value depends on the type
+// (e.g. WMT_TYPE_STRING values are null-terminated strings).
+struct MediaAttribute
+{
+	WMT_ATTR_DATATYPE type;
+	std::vector<BYTE> value;
+};
+
+// Reads attributes from media files using the Windows Media Format SDK. wmvcore.dll is only
+// loaded once, rather than each time a file is read, and all the requested attributes are read
+// with the file opened a single time.
+//
+// This class is thread-safe.
+class MediaMetadataReader : private boost::noncopyable
+{
+public:
+	static MediaMetadataReader &GetInstance();
+
+	// Only the attributes that could be read are returned.
+	std::unordered_map<std::wstring, MediaAttribute> ReadAttributes(const std::wstring &filePath,
+		const std::vector<std::wstring> &attributeNames) const;
+
+private:
+	using WMCreateEditorProc = HRESULT(WINAPI *)(IWMMetadataEditor **);
+
+	MediaMetadataReader();
+
+	wil::unique_hmodule m_wmvCore;
+	WMCreateEditorProc m_createEditor = nullptr;
+};
@@ -0,0 +1,843 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileNameIndex.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+namespace
+{
+
+bool AreNamesEqual(std::wstring_view name1, std::wstring_view name2)
+{
+	return CompareStringOrdinal(name1.data(), static_cast<int>(name1.size()), name2.data(),
+			   static_cast<int>(name2.size()), TRUE)
+		== CSTR_EQUAL;
+}
+
+std::wstring FoldName(std::wstring_view name)
+{
+	std::wstring foldedName(name);
+
+	if (!foldedName.empty())
+	{
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, name.data(),
+			static_cast<int>(name.size()), foldedName.data(), static_cast<int>(foldedName.size()),
+			nullptr, nullptr, 0);
+	}
+
+	return foldedName;
+}
+
+bool IsDriveRoot(std::wstring_view path)
+{
+	return path.size() == 3 && path[1] == ':' && path[2] == '\\';
+}
+
+std::wstring_view RemoveTrailingSeparator(std::wstring_view path)
+{
+	if (path.size() > 1 && path.back() == '\\' && !IsDriveRoot(path))
+	{
+		path.remove_suffix(1);
+	}
+
+	return path;
+}
+
+std::wstring AppendSeparator(std::wstring_view path)
+{
+	std::wstring pathWithSeparator(path);
+
+	if (!pathWithSeparator.empty() && pathWithSeparator.back() != '\\')
+	{
+		pathWithSeparator += '\\';
+	}
+
+	return pathWithSeparator;
+}
+
+bool WriteToFile(HANDLE file, const void *data, size_t size)
+{
+	auto *currentData = static_cast<const std::byte *>(data);
+
+	while (size > 0)
+	{
+		auto chunkSize = static_cast<DWORD>(std::min<size_t>(size, 0x10000000));
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(file, currentData, chunkSize, &numBytesWritten, nullptr);
+
+		if (!res || numBytesWritten != chunkSize)
+		{
+			return false;
+		}
+
+		currentData += chunkSize;
+		size -= chunkSize;
+	}
+
+	return true;
+}
+
+}
+
+FileNameIndex::FileNameIndex(std::wstring_view rootPath) :
+	m_rootPath(RemoveTrailingSeparator(rootPath))
+{
+}
+
+std::unique_ptr<FileNameIndex> FileNameIndex::Build(std::wstring_view rootPath,
+	const std::atomic<bool> *stop)
+{
+	auto index = std::make_unique<FileNameIndex>(rootPath);
+	index->IndexDirectoryContents(ROOT_INDEX, index->m_rootPath, stop);
+	return index;
+}
+
+std::unique_ptr<FileNameIndex> FileNameIndex::Load(const std::wstring &filePath)
+{
+	wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	BOOL res = GetFileSizeEx(file.get(), &fileSize);
+
+	if (!res || static_cast<uint64_t>(fileSize.QuadPart) < sizeof(FileHeader))
+	{
+		return nullptr;
+	}
+
+	wil::unique_handle mapping(
+		CreateFileMapping(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping)
+	{
+		return nullptr;
+	}
+
+	wil::unique_mapview_ptr<std::byte> view(
+		static_cast<std::byte *>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+
+	if (!view)
+	{
+		return nullptr;
+	}
+
+	FileHeader header;
+	memcpy(&header, view.get(), sizeof(header));
+
+	if (header.signature != FILE_SIGNATURE || header.version != FILE_VERSION)
+	{
+		return nullptr;
+	}
+
+	uint64_t expectedSize = sizeof(FileHeader) + (header.rootPathLength * sizeof(wchar_t))
+		+ (static_cast<uint64_t>(header.numEntries) * sizeof(Entry))
+		+ (header.namesLength * sizeof(wchar_t));
+
+	if (static_cast<uint64_t>(fileSize.QuadPart) != expectedSize)
+	{
+		return nullptr;
+	}
+
+	const std::byte *current = view.get() + sizeof(FileHeader);
+
+	std::wstring rootPath(header.rootPathLength, '\0');
+	memcpy(rootPath.data(), current, header.rootPathLength * sizeof(wchar_t));
+	current += header.rootPathLength * sizeof(wchar_t);
+
+	auto index = std::make_unique<FileNameIndex>(rootPath);
+
+	index->m_entries.resize(header.numEntries);
+	memcpy(index->m_entries.data(), current, header.numEntries * sizeof(Entry));
+	current += header.numEntries * sizeof(Entry);
+
+	index->m_names.resize(static_cast<size_t>(header.namesLength));
+	memcpy(index->m_names.data(), current,
+		static_cast<size_t>(header.namesLength) * sizeof(wchar_t));
+
+	// Entries are written out so that parents always appear before their children. Checking that
+	// here means that the rest of the class can rely on there being no cycles.
+	for (uint32_t i = 0; i < header.numEntries; i++)
+	{
+		const auto &entry = index->m_entries[i];
+
+		if ((entry.parent != ROOT_INDEX && entry.parent >= i)
+			|| (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength) > header.namesLength
+			|| entry.attributes == REMOVED_ATTRIBUTES)
+		{
+			return nullptr;
+		}
+	}
+
+	return index;
+}
+
+bool FileNameIndex::Save(const std::wstring &filePath) const
+{
+	const uint32_t unassignedIndex = UINT32_MAX;
+
+	// Removed entries are dropped and the remaining entries are ordered so that each parent is
+	// written out before any of its children. Entries can appear before their parent when a
+	// directory is moved into a directory that was created after it.
+	std::vector<uint32_t> newIndexes(m_entries.size(), unassignedIndex);
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> chain;
+
+	for (uint32_t i = 0; i < m_entries.size(); i++)
+	{
+		if (IsRemoved(i) || newIndexes[i] != unassignedIndex)
+		{
+			continue;
+		}
+
+		chain.clear();
+
+		for (uint32_t current = i; current != ROOT_INDEX && newIndexes[current] == unassignedIndex;
+			 current = m_entries[current].parent)
+		{
+			chain.push_back(current);
+		}
+
+		for (auto itr = chain.rbegin(); itr != chain.rend(); ++itr)
+		{
+			newIndexes[*itr] = static_cast<uint32_t>(order.size());
+			order.push_back(*itr);
+		}
+	}
+
+	std::vector<Entry> entries;
+	entries.reserve(order.size());
+	std::wstring names;
+
+	for (auto index : order)
+	{
+		Entry entry = m_entries[index];
+
+		if (entry.parent != ROOT_INDEX)
+		{
+			entry.parent = newIndexes[entry.parent];
+		}
+
+		auto name = GetEntryName(entry);
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		names.append(name);
+
+		entries.push_back(entry);
+	}
+
+	FileHeader header;
+	header.signature = FILE_SIGNATURE;
+	header.version = FILE_VERSION;
+	header.rootPathLength = static_cast<uint32_t>(m_rootPath.size());
+	header.numEntries = static_cast<uint32_t>(entries.size());
+	header.namesLength = names.size();
+
+	// The index is written to a temporary file first, so that an existing index won't be left in
+	// a partially written state if writing fails.
+	std::wstring tempFilePath = filePath + L".tmp";
+
+	{
+		wil::unique_hfile file(CreateFile(tempFilePath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+		if (!file)
+		{
+			return false;
+		}
+
+		if (!WriteToFile(file.get(), &header, sizeof(header))
+			|| !WriteToFile(file.get(), m_rootPath.data(), m_rootPath.size() * sizeof(wchar_t))
+			|| !WriteToFile(file.get(), entries.data(), entries.size() * sizeof(Entry))
+			|| !WriteToFile(file.get(), names.data(), names.size() * sizeof(wchar_t)))
+		{
+			file.reset();
+			DeleteFile(tempFilePath.c_str());
+			return false;
+		}
+	}
+
+	return MoveFileEx(tempFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+const std::wstring &FileNameIndex::GetRootPath() const
+{
+	return m_rootPath;
+}
+
+bool FileNameIndex::CoversPath(std::wstring_view path) const
+{
+	return GetRelativePath(path).has_value();
+}
+
+size_t FileNameIndex::GetNumItems() const
+{
+	return static_cast<size_t>(std::count_if(m_entries.begin(), m_entries.end(),
+		[](const Entry &entry) { return entry.attributes != REMOVED_ATTRIBUTES; }));
+}
+
+bool FileNameIndex::AddOrUpdateItem(std::wstring_view relativePath, const ItemData &itemData)
+{
+	std::wstring_view name;
+	auto parent = FindParentOfPath(relativePath, name);
+
+	if (!parent || name.empty())
+	{
+		return false;
+	}
+
+	auto existingIndex = FindChild(*parent, name);
+
+	if (existingIndex)
+	{
+		auto &entry = m_entries[*existingIndex];
+		entry.size = itemData.size;
+		entry.lastWriteTime = itemData.lastWriteTime;
+		entry.attributes = itemData.attributes;
+		return true;
+	}
+
+	AddEntry(*parent, name, itemData);
+
+	return true;
+}
+
+bool FileNameIndex::RemoveItem(std::wstring_view relativePath)
+{
+	auto index = FindEntry(relativePath);
+
+	if (!index || *index == ROOT_INDEX)
+	{
+		return false;
+	}
+
+	MarkRemoved(*index);
+
+	return true;
+}
+
+bool FileNameIndex::RenameItem(std::wstring_view oldRelativePath,
+	std::wstring_view newRelativePath)
+{
+	auto index = FindEntry(oldRelativePath);
+
+	if (!index || *index == ROOT_INDEX)
+	{
+		return false;
+	}
+
+	std::wstring_view newName;
+	auto newParent = FindParentOfPath(newRelativePath, newName);
+
+	if (!newParent || newName.empty())
+	{
+		return false;
+	}
+
+	// An item can be renamed over an existing item (e.g. when using MoveFileEx() with
+	// MOVEFILE_REPLACE_EXISTING), in which case the existing item is replaced.
+	auto existingIndex = FindChild(*newParent, newName);
+
+	if (existingIndex && *existingIndex != *index)
+	{
+		MarkRemoved(*existingIndex);
+	}
+
+	RemoveFromChildLookup(*index);
+
+	auto &entry = m_entries[*index];
+	entry.parent = *newParent;
+	SetEntryName(entry, newName);
+
+	AddToChildLookup(*index);
+
+	return true;
+}
+
+bool FileNameIndex::AddDirectoryContents(std::wstring_view relativePath,
+	const FileNameIndex &contents)
+{
+	auto directoryIndex = FindEntry(relativePath);
+
+	if (!directoryIndex)
+	{
+		return false;
+	}
+
+	if (*directoryIndex != ROOT_INDEX
+		&& WI_IsFlagClear(m_entries[*directoryIndex].attributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return false;
+	}
+
+	EnsureChildLookupBuilt();
+
+	// Maps each entry in the supplied index to the corresponding entry in this index. Since the
+	// supplied index is expected to have been built from scratch, each parent appears before its
+	// children.
+	std::vector<std::optional<uint32_t>> mappedIndexes(contents.m_entries.size());
+
+	for (uint32_t i = 0; i < contents.m_entries.size(); i++)
+	{
+		const auto &entry = contents.m_entries[i];
+
+		if (contents.IsRemoved(i))
+		{
+			continue;
+		}
+
+		std::optional<uint32_t> parent = *directoryIndex;
+
+		if (entry.parent != ROOT_INDEX)
+		{
+			parent = mappedIndexes[entry.parent];
+		}
+
+		if (!parent)
+		{
+			continue;
+		}
+
+		ItemData itemData = { entry.size, entry.lastWriteTime, entry.attributes };
+		auto name = contents.GetEntryName(entry);
+		auto existingIndex = FindChild(*parent, name);
+
+		if (existingIndex)
+		{
+			auto &existingEntry = m_entries[*existingIndex];
+			existingEntry.size = itemData.size;
+			existingEntry.lastWriteTime = itemData.lastWriteTime;
+			existingEntry.attributes = itemData.attributes;
+			mappedIndexes[i] = existingIndex;
+		}
+		else
+		{
+			mappedIndexes[i] = AddEntry(*parent, name, itemData);
+		}
+	}
+
+	return true;
+}
+
+void FileNameIndex::IndexDirectoryContents(uint32_t directoryIndex,
+	const std::wstring &directoryPath, const std::atomic<bool> *stop)
+{
+	std::vector<std::pair<uint32_t, std::wstring>> pendingDirectories;
+	pendingDirectories.emplace_back(directoryIndex, directoryPath);
+
+	while (!pendingDirectories.empty())
+	{
+		if (stop && *stop)
+		{
+			return;
+		}
+
+		auto [parent, path] = std::move(pendingDirectories.back());
+		pendingDirectories.pop_back();
+
+		auto pathWithSeparator = AppendSeparator(path);
+
+		WIN32_FIND_DATA findData;
+		wil::unique_hfind findFile(FindFirstFileEx((pathWithSeparator + L"*").c_str(),
+			FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr,
+			FIND_FIRST_EX_LARGE_FETCH));
+
+		if (!findFile)
+		{
+			continue;
+		}
+
+		do
+		{
+			if (lstrcmp(findData.cFileName, L".") == 0 || lstrcmp(findData.cFileName, L"..") == 0)
+			{
+				continue;
+			}
+
+			// The index is being built from scratch, so there's no need to check for existing
+			// items.
+			auto index = AddEntry(parent, findData.cFileName, ItemDataFromFindData(findData));
+
+			// Reparse points (e.g. junctions) aren't followed, since they can create cycles.
+			// ReadDirectoryChangesW doesn't follow them either, so the contents couldn't be kept
+			// up to date.
+			if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+				&& WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				pendingDirectories.emplace_back(index, pathWithSeparator + findData.cFileName);
+			}
+		} while (FindNextFile(findFile.get(), &findData));
+	}
+}
+
+std::optional<std::vector<FileNameIndex::Item>> FileNameIndex::FindItems(
+	std::wstring_view directory, const MatchFunction &matchFunction) const
+{
+	auto relativePath = GetRelativePath(directory);
+
+	if (!relativePath)
+	{
+		return std::nullopt;
+	}
+
+	auto directoryIndex = FindEntry(*relativePath);
+
+	if (!directoryIndex)
+	{
+		return std::nullopt;
+	}
+
+	// The entries are split into fixed-size chunks, with each chunk matched independently. That
+	// allows the work to be spread across all available cores.
+	const size_t chunkSize = 16384;
+	size_t numChunks = (m_entries.size() + chunkSize - 1) / chunkSize;
+
+	std::vector<size_t> chunks(numChunks);
+	std::iota(chunks.begin(), chunks.end(), 0);
+
+	std::vector<std::vector<uint32_t>> chunkMatches(numChunks);
+
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+		[this, &matchFunction, &chunkMatches, directoryIndex = *directoryIndex](size_t chunk)
+		{
+			size_t start = chunk * chunkSize;
+			size_t end = std::min(start + chunkSize, m_entries.size());
+
+			for (size_t i = start; i < end; i++)
+			{
+				const auto &entry = m_entries[i];
+
+				if (entry.attributes == REMOVED_ATTRIBUTES)
+				{
+					continue;
+				}
+
+				ItemData itemData = { entry.size, entry.lastWriteTime, entry.attributes };
+
+				if (!matchFunction(GetEntryName(entry), itemData))
+				{
+					continue;
+				}
+
+				if (directoryIndex != ROOT_INDEX
+					&& !IsDescendantOf(static_cast<uint32_t>(i), directoryIndex))
+				{
+					continue;
+				}
+
+				chunkMatches[chunk].push_back(static_cast<uint32_t>(i));
+			}
+		});
+
+	std::vector<Item> items;
+
+	for (const auto &matches : chunkMatches)
+	{
+		for (auto index : matches)
+		{
+			const auto &entry = m_entries[index];
+			items.push_back(
+				{ BuildPath(index), { entry.size, entry.lastWriteTime, entry.attributes } });
+		}
+	}
+
+	return items;
+}
+
+FileNameIndex::ItemData FileNameIndex::ItemDataFromFindData(const WIN32_FIND_DATA &findData)
+{
+	ItemData itemData;
+	itemData.size = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+	itemData.lastWriteTime =
+		(static_cast<uint64_t>(findData.ftLastWriteTime.dwHighDateTime) << 32)
+		| findData.ftLastWriteTime.dwLowDateTime;
+	itemData.attributes = findData.dwFileAttributes;
+	return itemData;
+}
+
+uint32_t FileNameIndex::AddEntry(uint32_t parent, std::wstring_view name,
+	const ItemData &itemData)
+{
+	CHECK_LT(m_entries.size(), ROOT_INDEX);
+
+	Entry entry;
+	entry.parent = parent;
+	entry.attributes = itemData.attributes;
+	entry.size = itemData.size;
+	entry.lastWriteTime = itemData.lastWriteTime;
+	SetEntryName(entry, name);
+
+	auto index = static_cast<uint32_t>(m_entries.size());
+	m_entries.push_back(entry);
+
+	if (m_childLookupBuilt)
+	{
+		AddToChildLookup(index);
+	}
+
+	return index;
+}
+
+void FileNameIndex::SetEntryName(Entry &entry, std::wstring_view name)
+{
+	CHECK_LE(m_names.size() + name.size(), UINT32_MAX);
+
+	// When an item is renamed, its previous name is left in the pool. That space is reclaimed when
+	// the index is saved.
+	entry.nameOffset = static_cast<uint32_t>(m_names.size());
+	entry.nameLength = static_cast<uint32_t>(name.size());
+	m_names.append(name);
+}
+
+std::wstring_view FileNameIndex::GetEntryName(const Entry &entry) const
+{
+	return std::wstring_view(m_names).substr(entry.nameOffset, entry.nameLength);
+}
+
+bool FileNameIndex::IsRemoved(uint32_t index) const
+{
+	return m_entries[index].attributes == REMOVED_ATTRIBUTES;
+}
+
+void FileNameIndex::MarkRemoved(uint32_t index)
+{
+	EnsureChildLookupBuilt();
+
+	std::vector<uint32_t> pendingItems = { index };
+
+	while (!pendingItems.empty())
+	{
+		auto current = pendingItems.back();
+		pendingItems.pop_back();
+
+		RemoveFromChildLookup(current);
+		m_entries[current].attributes = REMOVED_ATTRIBUTES;
+
+		// Only the items being removed are visited, since the children of each removed directory
+		// are taken directly from the lookup.
+		auto childrenItr = m_childrenByParent.find(current);
+
+		if (childrenItr == m_childrenByParent.end())
+		{
+			continue;
+		}
+
+		auto children = std::move(childrenItr->second);
+		m_childrenByParent.erase(childrenItr);
+
+		pendingItems.insert(pendingItems.end(), children.begin(), children.end());
+	}
+}
+
+bool FileNameIndex::IsDescendantOf(uint32_t index, uint32_t ancestorIndex) const
+{
+	for (uint32_t current = m_entries[index].parent; current != ROOT_INDEX;
+		 current = m_entries[current].parent)
+	{
+		if (current == ancestorIndex)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::wstring FileNameIndex::BuildPath(uint32_t index) const
+{
+	std::vector<std::wstring_view> names;
+
+	for (uint32_t current = index; current != ROOT_INDEX; current = m_entries[current].parent)
+	{
+		names.push_back(GetEntryName(m_entries[current]));
+	}
+
+	std::wstring path = m_rootPath;
+
+	for (auto itr = names.rbegin(); itr != names.rend(); ++itr)
+	{
+		if (path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path.append(*itr);
+	}
+
+	return path;
+}
+
+std::optional<uint32_t> FileNameIndex::FindEntry(std::wstring_view relativePath) const
+{
+	uint32_t current = ROOT_INDEX;
+	size_t start = 0;
+
+	while (start < relativePath.size())
+	{
+		size_t end = relativePath.find('\\', start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = relativePath.size();
+		}
+
+		auto component = relativePath.substr(start, end - start);
+		start = end + 1;
+
+		if (component.empty())
+		{
+			continue;
+		}
+
+		auto child = FindChild(current, component);
+
+		if (!child)
+		{
+			return std::nullopt;
+		}
+
+		current = *child;
+	}
+
+	return current;
+}
+
+std::optional<uint32_t> FileNameIndex::FindChild(uint32_t parent, std::wstring_view name) const
+{
+	EnsureChildLookupBuilt();
+
+	auto [begin, end] = m_childLookup.equal_range(HashChild(parent, name));
+
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		const auto &entry = m_entries[itr->second];
+
+		if (entry.parent == parent && entry.attributes != REMOVED_ATTRIBUTES
+			&& AreNamesEqual(GetEntryName(entry), name))
+		{
+			return itr->second;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::optional<uint32_t> FileNameIndex::FindParentOfPath(std::wstring_view relativePath,
+	std::wstring_view &name) const
+{
+	relativePath = RemoveTrailingSeparator(relativePath);
+
+	auto separatorPosition = relativePath.rfind('\\');
+
+	if (separatorPosition == std::wstring_view::npos)
+	{
+		name = relativePath;
+		return ROOT_INDEX;
+	}
+
+	name = relativePath.substr(separatorPosition + 1);
+
+	auto parent = FindEntry(relativePath.substr(0, separatorPosition));
+
+	if (!parent
+		|| (*parent != ROOT_INDEX
+			&& WI_IsFlagClear(m_entries[*parent].attributes, FILE_ATTRIBUTE_DIRECTORY)))
+	{
+		return std::nullopt;
+	}
+
+	return parent;
+}
+
+std::optional<std::wstring_view> FileNameIndex::GetRelativePath(std::wstring_view path) const
+{
+	path = RemoveTrailingSeparator(path);
+
+	if (AreNamesEqual(path, m_rootPath))
+	{
+		return std::wstring_view();
+	}
+
+	auto prefix = AppendSeparator(m_rootPath);
+
+	if (path.size() <= prefix.size() || !AreNamesEqual(path.substr(0, prefix.size()), prefix))
+	{
+		return std::nullopt;
+	}
+
+	return path.substr(prefix.size());
+}
+
+void FileNameIndex::EnsureChildLookupBuilt() const
+{
+	if (m_childLookupBuilt)
+	{
+		return;
+	}
+
+	m_childLookup.reserve(m_entries.size());
+
+	for (uint32_t i = 0; i < m_entries.size(); i++)
+	{
+		if (!IsRemoved(i))
+		{
+			AddToChildLookup(i);
+		}
+	}
+
+	m_childLookupBuilt = true;
+}
+
+void FileNameIndex::AddToChildLookup(uint32_t index) const
+{
+	const auto &entry = m_entries[index];
+	m_childLookup.emplace(HashChild(entry.parent, GetEntryName(entry)), index);
+	m_childrenByParent[entry.parent].insert(index);
+}
+
+void FileNameIndex::RemoveFromChildLookup(uint32_t index) const
+{
+	if (!m_childLookupBuilt)
+	{
+		return;
+	}
+
+	const auto &entry = m_entries[index];
+	auto [begin, end] = m_childLookup.equal_range(HashChild(entry.parent, GetEntryName(entry)));
+
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		if (itr->second == index)
+		{
+			m_childLookup.erase(itr);
+			break;
+		}
+	}
+
+	// The children of a removed directory will already have been detached from it.
+	auto childrenItr = m_childrenByParent.find(entry.parent);
+
+	if (childrenItr != m_childrenByParent.end())
+	{
+		childrenItr->second.erase(index);
+
+		if (childrenItr->second.empty())
+		{
+			m_childrenByParent.erase(childrenItr);
+		}
+	}
+}
+
+size_t FileNameIndex::HashChild(uint32_t parent, std::wstring_view name)
+{
+	size_t hash = std::hash<std::wstring>()(FoldName(name));
+	return hash ^ (std::hash<uint32_t>()(parent) + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+}
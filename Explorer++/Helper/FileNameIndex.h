@@ -0,0 +1,145 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// A compact index of the items within a directory tree, allowing the items to be searched without
+// having to walk the file system.
+//
+// Paths are stored as a tree. Each item stores a reference to its parent, along with its own name,
+// so the path of a directory is only stored once, regardless of how many items it contains. All
+// names are stored in a single string pool. On disk, the index consists of a fixed-size header,
+// followed by the item array and the name pool, allowing the file to be mapped directly into
+// memory when loading.
+//
+// This class isn't thread-safe. Callers are responsible for synchronizing access.
+class FileNameIndex
+{
+public:
+	struct ItemData
+	{
+		uint64_t size = 0;
+		uint64_t lastWriteTime = 0;
+		uint32_t attributes = 0;
+	};
+
+	struct Item
+	{
+		std::wstring path;
+		ItemData data;
+	};
+
+	// Called with the name of each item. Calls may be made concurrently, from multiple threads.
+	using MatchFunction = std::function<bool(std::wstring_view name, const ItemData &itemData)>;
+
+	explicit FileNameIndex(std::wstring_view rootPath);
+
+	// Builds an index by walking the file system, starting from the specified root. If stop is set
+	// while the index is being built, the partial index that's been built will be returned.
+	static std::unique_ptr<FileNameIndex> Build(std::wstring_view rootPath,
+		const std::atomic<bool> *stop = nullptr);
+
+	static std::unique_ptr<FileNameIndex> Load(const std::wstring &filePath);
+	bool Save(const std::wstring &filePath) const;
+
+	const std::wstring &GetRootPath() const;
+	bool CoversPath(std::wstring_view path) const;
+	size_t GetNumItems() const;
+
+	// Each of the methods below takes a path relative to the root (which is the format used by
+	// ReadDirectoryChangesW). Each returns false if the parent of the item isn't in the index.
+	bool AddOrUpdateItem(std::wstring_view relativePath, const ItemData &itemData);
+	bool RemoveItem(std::wstring_view relativePath);
+	bool RenameItem(std::wstring_view oldRelativePath, std::wstring_view newRelativePath);
+
+	// Copies every item from the supplied index into the specified directory (which should already
+	// be in this index). This is used when a directory is moved into the indexed tree. The contents
+	// of the directory can be indexed separately, via Build(), without access to this index being
+	// blocked while the file system is walked.
+	bool AddDirectoryContents(std::wstring_view relativePath, const FileNameIndex &contents);
+
+	// Returns all the items within the specified directory (which may be the root or any directory
+	// within it) that are matched by the supplied function. The directory itself isn't included.
+	std::optional<std::vector<Item>> FindItems(std::wstring_view directory,
+		const MatchFunction &matchFunction) const;
+
+private:
+	// The parent index used for items that are directly within the root.
+	static constexpr uint32_t ROOT_INDEX = UINT32_MAX;
+
+	// Used to mark items that have been removed. These entries are skipped when searching and
+	// aren't written out when the index is saved.
+	static constexpr uint32_t REMOVED_ATTRIBUTES = UINT32_MAX;
+
+	static constexpr uint32_t FILE_SIGNATURE = 0x58494e46; // "FNIX"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+#pragma pack(push, 1)
+	struct FileHeader
+	{
+		uint32_t signature;
+		uint32_t version;
+		uint32_t rootPathLength;
+		uint32_t numEntries;
+		uint64_t namesLength;
+	};
+
+	struct Entry
+	{
+		uint32_t parent;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t attributes;
+		uint64_t size;
+		uint64_t lastWriteTime;
+	};
+#pragma pack(pop)
+
+	static ItemData ItemDataFromFindData(const WIN32_FIND_DATA &findData);
+
+	void IndexDirectoryContents(uint32_t directoryIndex, const std::wstring &directoryPath,
+		const std::atomic<bool> *stop);
+	uint32_t AddEntry(uint32_t parent, std::wstring_view name, const ItemData &itemData);
+	void SetEntryName(Entry &entry, std::wstring_view name);
+	std::wstring_view GetEntryName(const Entry &entry) const;
+	bool IsRemoved(uint32_t index) const;
+	void MarkRemoved(uint32_t index);
+	bool IsDescendantOf(uint32_t index, uint32_t ancestorIndex) const;
+	std::wstring BuildPath(uint32_t index) const;
+	std::wstring BuildPath(uint32_t directoryIndex, std::wstring_view name) const;
+
+	std::optional<uint32_t> FindEntry(std::wstring_view relativePath) const;
+	std::optional<uint32_t> FindChild(uint32_t parent, std::wstring_view name) const;
+	std::optional<uint32_t> FindParentOfPath(std::wstring_view relativePath,
+		std::wstring_view &name) const;
+	std::optional<std::wstring_view> GetRelativePath(std::wstring_view path) const;
+
+	// The child lookup table is only needed when the index is updated, so it's built on demand.
+	void EnsureChildLookupBuilt() const;
+	void AddToChildLookup(uint32_t index) const;
+	void RemoveFromChildLookup(uint32_t index) const;
+	static size_t HashChild(uint32_t parent, std::wstring_view name);
+
+	std::wstring m_rootPath;
+	std::vector<Entry> m_entries;
+	std::wstring m_names;
+
+	mutable std::unordered_multimap<size_t, uint32_t> m_childLookup;
+
+	// Maps each directory to its children, so that the contents of a directory can be removed
+	// without scanning every entry.
+	mutable std::unordered_map<uint32_t, std::unordered_set<uint32_t>> m_childrenByParent;
+	mutable bool m_childLookupBuilt = false;
+};
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "PidlHelper.h"
+#include "SecureOverwriteEngine.h"
 #include <list>
 #include <vector>
 
@@ -20,7 +21,8 @@ enum class OverwriteMethod
 HRESULT RenameFile(IShellItem *item, const std::wstring &newName);
 HRESULT DeleteFiles(HWND hwnd, const std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent,
 	bool silent);
-void DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
+HRESULT DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
+std::vector<SecureOverwriteEngine::Pattern> GetOverwritePasses(OverwriteMethod overwriteMethod);
 HRESULT CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
 	std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
 HRESULT CopyFiles(HWND hwnd, IShellItem *destinationFolder, std::vector<PCIDLIST_ABSOLUTE> &pidls,
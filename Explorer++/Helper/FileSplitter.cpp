@@ -0,0 +1,364 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileSplitter.h"
+#include <wil/resource.h>
+#include <algorithm>
+
+FileSplitter::FileSplitter(WorkStealingExecutor *executor, int maxConcurrentParts,
+	DWORD chunkSize) :
+	m_executor(executor),
+	m_maxConcurrentParts(maxConcurrentParts),
+	m_chunkSize(chunkSize)
+{
+	assert(maxConcurrentParts > 0);
+}
+
+HRESULT FileSplitter::Split(HANDLE inputFile, uint64_t fileSize, uint64_t partSize,
+	const PartPathGenerator &partPathGenerator, const std::atomic<bool> &stop,
+	const ProgressCallback &progressCallback)
+{
+	assert(partSize > 0);
+
+	uint64_t numParts = (fileSize / partSize) + ((fileSize % partSize) != 0 ? 1 : 0);
+
+	ResumeManifest manifest;
+	RETURN_IF_FAILED(BuildResumeManifest(inputFile, partSize, manifest));
+
+	std::wstring manifestPath = GetResumeManifestPath(partPathGenerator(1));
+	bool resuming = (ReadResumeManifest(manifestPath) == manifest);
+
+	if (!resuming)
+	{
+		// Without a matching manifest, there's no way of knowing where any existing parts came
+		// from, so they're never overwritten. This is checked up front, so that the manifest for
+		// an earlier split isn't replaced unless this split can go ahead.
+		for (uint64_t partIndex = 0; partIndex < numParts; partIndex++)
+		{
+			if (GetFileAttributes(partPathGenerator(static_cast<int>(partIndex + 1)).c_str())
+				!= INVALID_FILE_ATTRIBUTES)
+			{
+				return HRESULT_FROM_WIN32(ERROR_FILE_EXISTS);
+			}
+		}
+
+		RETURN_IF_FAILED(WriteResumeManifest(manifestPath, manifest));
+	}
+
+	SplitState state{ inputFile, fileSize, partSize, resuming, partPathGenerator, stop,
+		progressCallback, Clock::now() };
+
+	std::atomic<uint64_t> nextPart = 0;
+
+	// Each writer has its own copy engine (and buffers) and writes one part at a time, taking the
+	// next part that hasn't been started each time it finishes.
+	m_executor->ParallelFor(static_cast<size_t>(GetNumWriters(numParts)),
+		[this, &state, &nextPart, numParts](size_t index)
+		{
+			UNREFERENCED_PARAMETER(index);
+
+			FileCopyEngine copyEngine(m_chunkSize);
+
+			for (uint64_t partIndex = nextPart++; partIndex < numParts; partIndex = nextPart++)
+			{
+				if (state.stop || state.firstError.HasFailed())
+				{
+					break;
+				}
+
+				HRESULT hr = WritePart(copyEngine, state, static_cast<int>(partIndex));
+
+				if (FAILED(hr))
+				{
+					state.firstError.Record(hr);
+					break;
+				}
+
+				state.partsCompleted++;
+			}
+		});
+
+	ReportProgress(state, true);
+
+	if (state.firstError.HasFailed() && state.firstError.GetError() != E_ABORT)
+	{
+		return state.firstError.GetError();
+	}
+
+	if (state.partsCompleted < numParts)
+	{
+		return E_ABORT;
+	}
+
+	// The parts are all complete, so there's nothing left to resume.
+	DeleteFile(manifestPath.c_str());
+
+	return S_OK;
+}
+
+int FileSplitter::GetNumWriters(uint64_t numParts) const
+{
+	// The calling thread also writes parts, so this leaves at least one of the executor's threads
+	// free for other tasks.
+	int maxWriters = (std::max)(m_executor->GetNumThreads() - 1, 1);
+
+	return static_cast<int>(
+		(std::min)({ numParts, static_cast<uint64_t>(m_maxConcurrentParts),
+			static_cast<uint64_t>(maxWriters) }));
+}
+
+HRESULT FileSplitter::WritePart(FileCopyEngine &copyEngine, SplitState &state, int partIndex)
+{
+	uint64_t partOffset = static_cast<uint64_t>(partIndex) * state.partSize;
+	uint64_t partSize = (std::min)(state.partSize, state.fileSize - partOffset);
+
+	std::wstring partPath = state.partPathGenerator(partIndex + 1);
+
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+	if (GetFileAttributesEx(partPath.c_str(), GetFileExInfoStandard, &attributeData))
+	{
+		uint64_t existingSize = (static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32)
+			| attributeData.nFileSizeLow;
+
+		// Parts are only given their final name once they're complete, so this part was written
+		// during an earlier split.
+		if (state.resuming && existingSize == partSize)
+		{
+			state.bytesSplit += partSize;
+			state.bytesRecovered += partSize;
+			ReportProgress(state, false);
+			return S_OK;
+		}
+
+		return HRESULT_FROM_WIN32(ERROR_FILE_EXISTS);
+	}
+
+	std::wstring partialPartPath = GetPartialPartPath(partPath);
+
+	wil::unique_hfile outputFile(CreateFile(partialPartPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr));
+
+	if (!outputFile)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	LARGE_INTEGER existingSize;
+
+	if (!GetFileSizeEx(outputFile.get(), &existingSize))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// Data is written to each part in order, one chunk at a time, so everything up to the last
+	// complete chunk can be kept. Anything beyond that is discarded, since the write it came from
+	// may have been interrupted.
+	uint64_t resumeOffset = 0;
+
+	if (state.resuming)
+	{
+		resumeOffset = (std::min)(static_cast<uint64_t>(existingSize.QuadPart), partSize);
+		resumeOffset -= resumeOffset % copyEngine.GetChunkSize();
+	}
+
+	FILE_END_OF_FILE_INFO endOfFileInfo;
+	endOfFileInfo.EndOfFile.QuadPart = resumeOffset;
+
+	if (!SetFileInformationByHandle(outputFile.get(), FileEndOfFileInfo, &endOfFileInfo,
+			sizeof(endOfFileInfo)))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	state.bytesSplit += resumeOffset;
+	state.bytesRecovered += resumeOffset;
+
+	uint64_t previousBytesCopied = 0;
+	uint64_t bytesCopied;
+	HRESULT hr = copyEngine.Copy(state.inputFile, partOffset + resumeOffset, outputFile.get(),
+		resumeOffset, partSize - resumeOffset,
+		[&state, &previousBytesCopied](uint64_t partBytesCopied)
+		{
+			state.bytesSplit += partBytesCopied - previousBytesCopied;
+			previousBytesCopied = partBytesCopied;
+
+			ReportProgress(state, false);
+
+			return !state.stop && !state.firstError.HasFailed();
+		},
+		bytesCopied);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	if (bytesCopied != partSize - resumeOffset)
+	{
+		// The input file is shorter than it was when the split started.
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+	}
+
+	outputFile.reset();
+
+	// If a file has been created at the final path in the meantime, it won't be replaced.
+	if (!MoveFileEx(partialPartPath.c_str(), partPath.c_str(), 0))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	return S_OK;
+}
+
+void FileSplitter::ReportProgress(SplitState &state, bool force)
+{
+	if (!state.progressCallback)
+	{
+		return;
+	}
+
+	state.progressReporter.Report(force,
+		[&state]()
+		{
+			Progress progress;
+			progress.bytesSplit = state.bytesSplit;
+			progress.totalBytes = state.fileSize;
+			progress.bytesPerSecond = 0;
+
+			auto elapsed = std::chrono::duration<double>(Clock::now() - state.startTime);
+			uint64_t bytesWritten = progress.bytesSplit - state.bytesRecovered;
+
+			if (elapsed >= MIN_RATE_INTERVAL && bytesWritten > 0)
+			{
+				progress.bytesPerSecond = bytesWritten / elapsed.count();
+
+				uint64_t bytesRemaining = progress.totalBytes
+					- (std::min)(progress.bytesSplit, progress.totalBytes);
+				progress.remainingTime = std::chrono::seconds(
+					static_cast<long long>(bytesRemaining / progress.bytesPerSecond));
+			}
+
+			state.progressCallback(progress);
+		});
+}
+
+std::wstring FileSplitter::GetPartialPartPath(const std::wstring &partPath)
+{
+	return partPath + L".partial";
+}
+
+std::wstring FileSplitter::GetResumeManifestPath(const std::wstring &firstPartPath)
+{
+	return firstPartPath + L".manifest";
+}
+
+HRESULT FileSplitter::BuildResumeManifest(HANDLE inputFile, uint64_t partSize,
+	ResumeManifest &manifest)
+{
+	BY_HANDLE_FILE_INFORMATION fileInfo;
+
+	if (!GetFileInformationByHandle(inputFile, &fileInfo))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	manifest.fileSize =
+		(static_cast<uint64_t>(fileInfo.nFileSizeHigh) << 32) | fileInfo.nFileSizeLow;
+	manifest.lastWriteTime = (static_cast<uint64_t>(fileInfo.ftLastWriteTime.dwHighDateTime) << 32)
+		| fileInfo.ftLastWriteTime.dwLowDateTime;
+	manifest.partSize = partSize;
+
+	DWORD length = GetFinalPathNameByHandle(inputFile, nullptr, 0, FILE_NAME_NORMALIZED);
+
+	if (length == 0)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// The returned length includes the terminating null character.
+	manifest.inputPath.resize(length);
+	length = GetFinalPathNameByHandle(inputFile, manifest.inputPath.data(), length,
+		FILE_NAME_NORMALIZED);
+
+	if (length == 0 || length >= manifest.inputPath.size())
+	{
+		return E_FAIL;
+	}
+
+	manifest.inputPath.resize(length);
+
+	return S_OK;
+}
+
+std::optional<FileSplitter::ResumeManifest> FileSplitter::ReadResumeManifest(
+	const std::wstring &path)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	ManifestHeader header;
+	DWORD numBytesRead;
+
+	if (!ReadFile(file.get(), &header, sizeof(header), &numBytesRead, nullptr)
+		|| numBytesRead != sizeof(header) || header.signature != MANIFEST_SIGNATURE
+		|| header.version != MANIFEST_VERSION || header.inputPathLength > UNICODE_STRING_MAX_CHARS)
+	{
+		return std::nullopt;
+	}
+
+	ResumeManifest manifest;
+	manifest.fileSize = header.fileSize;
+	manifest.lastWriteTime = header.lastWriteTime;
+	manifest.partSize = header.partSize;
+	manifest.inputPath.resize(header.inputPathLength);
+
+	DWORD inputPathSize = header.inputPathLength * sizeof(wchar_t);
+
+	if (!ReadFile(file.get(), manifest.inputPath.data(), inputPathSize, &numBytesRead, nullptr)
+		|| numBytesRead != inputPathSize)
+	{
+		return std::nullopt;
+	}
+
+	return manifest;
+}
+
+HRESULT FileSplitter::WriteResumeManifest(const std::wstring &path,
+	const ResumeManifest &manifest)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	ManifestHeader header = {};
+	header.signature = MANIFEST_SIGNATURE;
+	header.version = MANIFEST_VERSION;
+	header.fileSize = manifest.fileSize;
+	header.lastWriteTime = manifest.lastWriteTime;
+	header.partSize = manifest.partSize;
+	header.inputPathLength = static_cast<uint32_t>(manifest.inputPath.size());
+
+	DWORD inputPathSize = header.inputPathLength * sizeof(wchar_t);
+	DWORD numBytesWritten;
+
+	if (!WriteFile(file.get(), &header, sizeof(header), &numBytesWritten, nullptr)
+		|| !WriteFile(file.get(), manifest.inputPath.data(), inputPathSize, &numBytesWritten,
+			nullptr))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,137 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FileCopyEngine.h"
+#include "ParallelIoHelper.h"
+#include "WorkStealingExecutor.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+// Splits a file into a series of parts, each of a fixed size (other than the last, which holds
+// whatever remains). Since the position of each part within the input file is known up front,
+// several parts are written at once, each through its own FileCopyEngine. The amount of memory
+// used is therefore bounded by the number of parts written concurrently, rather than by the size
+// of each part.
+//
+// Each part is written to a temporary file alongside its final path and is only renamed once it's
+// complete. If a split is stopped partway through, splitting the same file into the same parts
+// again will resume it: parts that were completed are left as they are and parts that were only
+// partially written are continued from where they stopped. A manifest describing the input file
+// (its path, size and modification time) and the part size is written alongside the first part
+// and removed once the split has finished. Existing parts are only reused if the manifest matches,
+// so a split won't be resumed if the input file has changed in the meantime.
+//
+// The writers run on the executor, but never on all of its threads, so that other background work
+// can still make progress while a large file is being split.
+class FileSplitter
+{
+public:
+	struct Progress
+	{
+		// Includes any data recovered from an earlier, incomplete split.
+		uint64_t bytesSplit;
+		uint64_t totalBytes;
+
+		// Only covers the data written during the current split.
+		double bytesPerSecond;
+
+		// Empty until the split has been running long enough for the rate to be meaningful.
+		std::optional<std::chrono::seconds> remainingTime;
+	};
+
+	// Invoked from the threads the parts are written on, though never from more than one thread
+	// at a time.
+	using ProgressCallback = std::function<void(const Progress &progress)>;
+
+	// Returns the full path of the part with the specified (one-based) number. This may be called
+	// from several threads at once.
+	using PartPathGenerator = std::function<std::wstring(int partNumber)>;
+
+	static const int DEFAULT_MAX_CONCURRENT_PARTS = 4;
+
+	FileSplitter(WorkStealingExecutor *executor,
+		int maxConcurrentParts = DEFAULT_MAX_CONCURRENT_PARTS,
+		DWORD chunkSize = FileCopyEngine::DEFAULT_CHUNK_SIZE);
+
+	// The input file should be opened with FILE_FLAG_OVERLAPPED, so that the parts can be read
+	// concurrently. Returns E_ABORT if the split was stopped. If a part already exists and can't
+	// be reused, it won't be overwritten and the split will fail.
+	HRESULT Split(HANDLE inputFile, uint64_t fileSize, uint64_t partSize,
+		const PartPathGenerator &partPathGenerator, const std::atomic<bool> &stop,
+		const ProgressCallback &progressCallback);
+
+	static std::wstring GetPartialPartPath(const std::wstring &partPath);
+	static std::wstring GetResumeManifestPath(const std::wstring &firstPartPath);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t MANIFEST_SIGNATURE = 0x4D505358;
+	static constexpr uint32_t MANIFEST_VERSION = 1;
+
+	struct ResumeManifest
+	{
+		std::wstring inputPath;
+		uint64_t fileSize;
+		uint64_t lastWriteTime;
+		uint64_t partSize;
+
+		bool operator==(const ResumeManifest &) const = default;
+	};
+
+	struct ManifestHeader
+	{
+		uint32_t signature;
+		uint32_t version;
+		uint64_t fileSize;
+		uint64_t lastWriteTime;
+		uint64_t partSize;
+		uint32_t inputPathLength;
+	};
+
+	// The rate is only estimated once the split has been running for at least this long.
+	static constexpr std::chrono::seconds MIN_RATE_INTERVAL = std::chrono::seconds(1);
+
+	struct SplitState
+	{
+		HANDLE inputFile;
+		uint64_t fileSize;
+		uint64_t partSize;
+
+		// True if the parts from an earlier split of the same input file can be reused.
+		bool resuming;
+
+		const PartPathGenerator &partPathGenerator;
+		const std::atomic<bool> &stop;
+		const ProgressCallback &progressCallback;
+		Clock::time_point startTime;
+
+		std::atomic<uint64_t> partsCompleted = 0;
+		std::atomic<uint64_t> bytesSplit = 0;
+		std::atomic<uint64_t> bytesRecovered = 0;
+		ParallelIoHelper::ProgressReporter progressReporter;
+
+		// Once one part has failed, the other parts will be stopped.
+		ParallelIoHelper::FirstError firstError;
+	};
+
+	static HRESULT BuildResumeManifest(HANDLE inputFile, uint64_t partSize,
+		ResumeManifest &manifest);
+	static std::optional<ResumeManifest> ReadResumeManifest(const std::wstring &path);
+	static HRESULT WriteResumeManifest(const std::wstring &path, const ResumeManifest &manifest);
+
+	int GetNumWriters(uint64_t numParts) const;
+	HRESULT WritePart(FileCopyEngine &copyEngine, SplitState &state, int partIndex);
+	static void ReportProgress(SplitState &state, bool force);
+
+	WorkStealingExecutor *const m_executor;
+	const int m_maxConcurrentParts;
+	const DWORD m_chunkSize;
+};
@@ -0,0 +1,179 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileTypeNameCache.h"
+#include <wil/common.h>
+#include <unordered_set>
+
+namespace
+{
+
+// Backslashes can't appear in file names, so this won't conflict with the key for any extension.
+const wchar_t FOLDER_KEY[] = L"\\";
+
+}
+
+FileTypeNameCache &FileTypeNameCache::GetInstance()
+{
+	static FileTypeNameCache fileTypeNameCache(&FileTypeNameCache::LookupTypeName);
+	return fileTypeNameCache;
+}
+
+FileTypeNameCache::FileTypeNameCache(TypeNameLookup lookup) : m_lookup(std::move(lookup))
+{
+}
+
+std::optional<std::wstring> FileTypeNameCache::GetTypeName(const Item &item)
+{
+	auto key = GetKey(item);
+
+	if (!key)
+	{
+		return m_lookup(item.pidl);
+	}
+
+	int generation;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_typeNames.find(*key);
+
+		if (itr != m_typeNames.end())
+		{
+			return itr->second;
+		}
+
+		generation = m_generation;
+	}
+
+	// The lock isn't held while the type name is retrieved, since that can take some time. That
+	// means another thread may retrieve the same type name in the meantime, which is harmless.
+	auto typeName = m_lookup(item.pidl);
+
+	if (typeName)
+	{
+		InsertTypeNames({ { std::move(*key), *typeName } }, generation);
+	}
+
+	return typeName;
+}
+
+void FileTypeNameCache::Prewarm(const std::vector<Item> &items)
+{
+	std::vector<std::pair<std::wstring, PCIDLIST_ABSOLUTE>> missingKeys;
+	int generation;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		std::unordered_set<std::wstring> seenKeys;
+
+		for (const auto &item : items)
+		{
+			auto key = GetKey(item);
+
+			if (!key || m_typeNames.contains(*key) || !seenKeys.insert(*key).second)
+			{
+				continue;
+			}
+
+			missingKeys.emplace_back(std::move(*key), item.pidl);
+		}
+
+		generation = m_generation;
+	}
+
+	std::vector<std::pair<std::wstring, std::wstring>> typeNames;
+
+	for (auto &[key, pidl] : missingKeys)
+	{
+		auto typeName = m_lookup(pidl);
+
+		if (typeName)
+		{
+			typeNames.emplace_back(std::move(key), std::move(*typeName));
+		}
+	}
+
+	InsertTypeNames(typeNames, generation);
+}
+
+void FileTypeNameCache::InsertTypeNames(
+	const std::vector<std::pair<std::wstring, std::wstring>> &typeNames, int generation)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (generation != m_generation)
+	{
+		return;
+	}
+
+	for (const auto &[key, typeName] : typeNames)
+	{
+		m_typeNames.insert({ key, typeName });
+	}
+}
+
+void FileTypeNameCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_typeNames.clear();
+	m_generation++;
+}
+
+size_t FileTypeNameCache::GetNumTypeNames() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_typeNames.size();
+}
+
+std::optional<std::wstring> FileTypeNameCache::GetKey(const Item &item)
+{
+	if (!item.findData)
+	{
+		return std::nullopt;
+	}
+
+	if (WI_IsFlagSet(item.findData->dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		// Folders with either of these attributes set can contain a desktop.ini file, which can
+		// change how the folder is presented.
+		if (WI_IsAnyFlagSet(item.findData->dwFileAttributes,
+				FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_SYSTEM))
+		{
+			return std::nullopt;
+		}
+
+		return FOLDER_KEY;
+	}
+
+	// Files without an extension all share the empty key.
+	std::wstring extension = PathFindExtension(item.findData->cFileName);
+
+	if (!extension.empty())
+	{
+		// Extensions are compared case-insensitively.
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, extension.data(),
+			static_cast<int>(extension.size()), extension.data(),
+			static_cast<int>(extension.size()), nullptr, nullptr, 0);
+	}
+
+	return extension;
+}
+
+std::optional<std::wstring> FileTypeNameCache::LookupTypeName(PCIDLIST_ABSOLUTE pidl)
+{
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_TYPENAME);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	return shfi.szTypeName;
+}
@@ -0,0 +1,75 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Holds the type names (e.g. "Text Document") that are shown for items. Retrieving a type name
+// from the shell is relatively expensive, yet every file with a particular extension will have
+// the same type name, as will every ordinary folder. So, rather than retrieving the type name for
+// each item, it's retrieved once per extension and shared.
+//
+// The type name of a .lnk or .exe file is also determined only by its extension ("Shortcut" and
+// "Application"), even though the icons of such files are item-specific. Folders that may be
+// customized (i.e. those marked read-only or system) and items that aren't in the filesystem can
+// have their own type names, so those are always retrieved directly.
+//
+// This class is thread-safe.
+class FileTypeNameCache : private boost::noncopyable
+{
+public:
+	// Retrieves the type name for a single item from the shell.
+	using TypeNameLookup = std::function<std::optional<std::wstring>(PCIDLIST_ABSOLUTE pidl)>;
+
+	// An item whose type name is requested. The find data should be null if the item isn't in the
+	// filesystem.
+	struct Item
+	{
+		PCIDLIST_ABSOLUTE pidl;
+		const WIN32_FIND_DATA *findData;
+	};
+
+	static FileTypeNameCache &GetInstance();
+
+	explicit FileTypeNameCache(TypeNameLookup lookup);
+
+	std::optional<std::wstring> GetTypeName(const Item &item);
+
+	// Retrieves the type name for each distinct extension in the set of items that hasn't already
+	// been cached. This is designed to be called on a background thread when a folder is
+	// enumerated, so that the type names don't have to be retrieved on the UI thread later on.
+	void Prewarm(const std::vector<Item> &items);
+
+	// Should be called when the file associations change, since the type names may have changed.
+	void Clear();
+
+	size_t GetNumTypeNames() const;
+
+	// Returns the key the type name for the item is cached under, or an empty value if the type
+	// name is specific to the item.
+	static std::optional<std::wstring> GetKey(const Item &item);
+
+private:
+	static std::optional<std::wstring> LookupTypeName(PCIDLIST_ABSOLUTE pidl);
+
+	void InsertTypeNames(const std::vector<std::pair<std::wstring, std::wstring>> &typeNames,
+		int generation);
+
+	const TypeNameLookup m_lookup;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::wstring, std::wstring> m_typeNames;
+
+	// Incremented each time the cache is cleared, so that a type name that was being retrieved at
+	// the time isn't added back afterwards.
+	int m_generation = 0;
+};
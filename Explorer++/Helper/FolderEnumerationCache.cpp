@@ -0,0 +1,259 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderEnumerationCache.h"
+#include <wil/common.h>
+
+namespace
+{
+
+const wchar_t PATH_SEPARATOR = L'\\';
+
+}
+
+FolderEnumerationCache::FolderEnumerationCache(size_t maxMemoryUsage) :
+	m_maxMemoryUsage(maxMemoryUsage)
+{
+}
+
+std::shared_ptr<const FolderEnumerationCache::ItemList> FolderEnumerationCache::Get(
+	PCIDLIST_ABSOLUTE pidl, std::wstring_view path, Contents contents)
+{
+	auto key = GetKey(pidl, path);
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end())
+	{
+		return nullptr;
+	}
+
+	const auto &entry = itr->second;
+
+	if (WI_IsFlagSet(entry.contents, Contents::IncludeHidden)
+			!= WI_IsFlagSet(contents, Contents::IncludeHidden)
+		|| !WI_AreAllFlagsSet(entry.contents, contents))
+	{
+		return nullptr;
+	}
+
+	m_usage.splice(m_usage.begin(), m_usage, entry.usageItr);
+	return entry.items;
+}
+
+bool FolderEnumerationCache::IsIncluded(const Item &item, Contents contents)
+{
+	if (WI_IsFlagSet(item.attributes, SFGAO_FOLDER))
+	{
+		return WI_IsFlagSet(contents, Contents::Folders);
+	}
+
+	return WI_IsFlagSet(contents, Contents::NonFolders);
+}
+
+uint64_t FolderEnumerationCache::GetGeneration() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_generation;
+}
+
+void FolderEnumerationCache::Insert(PCIDLIST_ABSOLUTE pidl, std::wstring_view path,
+	Contents contents, ItemList items, uint64_t generation)
+{
+	auto key = GetKey(pidl, path);
+	size_t memoryUsage = EstimateMemoryUsage(key, items);
+	auto sharedItems = std::make_shared<const ItemList>(std::move(items));
+
+	std::scoped_lock lock(m_mutex);
+
+	// Each invalidation increments the generation, so this is the number of invalidations that
+	// have been made since the folder was enumerated.
+	if (m_generation - generation > m_recentInvalidations.size())
+	{
+		return;
+	}
+
+	for (auto itr = m_recentInvalidations.rbegin();
+		 itr != m_recentInvalidations.rend() && itr->generation > generation; ++itr)
+	{
+		if (IsAffectedBy(key.first, *itr))
+		{
+			return;
+		}
+	}
+
+	if (auto itr = m_entries.find(key); itr != m_entries.end())
+	{
+		RemoveEntry(itr);
+	}
+
+	// A single folder that's larger than the entire cache isn't worth evicting everything else
+	// for.
+	if (memoryUsage > m_maxMemoryUsage)
+	{
+		return;
+	}
+
+	while (m_memoryUsage + memoryUsage > m_maxMemoryUsage)
+	{
+		RemoveEntry(m_entries.find(m_usage.back()));
+	}
+
+	m_usage.push_front(key);
+	m_entries.emplace(std::move(key),
+		Entry{ contents, std::move(sharedItems), memoryUsage, m_usage.begin() });
+	m_memoryUsage += memoryUsage;
+}
+
+void FolderEnumerationCache::InvalidateFolder(std::wstring_view path)
+{
+	Invalidate(GetPathKey(path), false);
+}
+
+void FolderEnumerationCache::InvalidateTree(std::wstring_view path)
+{
+	Invalidate(GetPathKey(path), true);
+}
+
+void FolderEnumerationCache::InvalidateAll()
+{
+	Invalidate({}, true);
+}
+
+void FolderEnumerationCache::Invalidate(std::wstring key, bool includeDescendants)
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_generation++;
+	m_recentInvalidations.push_back({ m_generation, key, includeDescendants });
+
+	if (m_recentInvalidations.size() > MAX_RECORDED_INVALIDATIONS)
+	{
+		m_recentInvalidations.pop_front();
+	}
+
+	if (key.empty())
+	{
+		m_entries.clear();
+		m_usage.clear();
+		m_memoryUsage = 0;
+		return;
+	}
+
+	RemoveEntries(key);
+
+	if (includeDescendants)
+	{
+		std::wstring descendantsStart = key + PATH_SEPARATOR;
+		std::wstring descendantsEnd = key + static_cast<wchar_t>(PATH_SEPARATOR + 1);
+
+		for (auto itr = m_entries.lower_bound({ descendantsStart, {} });
+			 itr != m_entries.end() && itr->first.first < descendantsEnd;)
+		{
+			RemoveEntry(itr++);
+		}
+	}
+}
+
+// Removes the entry for every folder with the specified path.
+void FolderEnumerationCache::RemoveEntries(std::wstring_view pathKey)
+{
+	for (auto itr = m_entries.lower_bound({ std::wstring(pathKey), {} });
+		 itr != m_entries.end() && itr->first.first == pathKey;)
+	{
+		RemoveEntry(itr++);
+	}
+}
+
+void FolderEnumerationCache::RemoveEntry(std::map<Key, Entry>::iterator itr)
+{
+	m_memoryUsage -= itr->second.memoryUsage;
+	m_usage.erase(itr->second.usageItr);
+	m_entries.erase(itr);
+}
+
+size_t FolderEnumerationCache::GetNumFolders() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t FolderEnumerationCache::GetMemoryUsage() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_memoryUsage;
+}
+
+// Pidls are compared by their binary contents. Two pidls that refer to the same folder can still
+// differ (e.g. if one was built from a path), but that only means the folder won't be shared
+// between them, whereas comparing them through the shell would require it to be called with the
+// lock held.
+FolderEnumerationCache::Key FolderEnumerationCache::GetKey(PCIDLIST_ABSOLUTE pidl,
+	std::wstring_view path)
+{
+	return { GetPathKey(path),
+		std::string(reinterpret_cast<const char *>(pidl), ILGetSize(pidl)) };
+}
+
+// Paths are compared case-insensitively and without any trailing separator.
+std::wstring FolderEnumerationCache::GetPathKey(std::wstring_view path)
+{
+	while (!path.empty() && path.back() == PATH_SEPARATOR)
+	{
+		path.remove_suffix(1);
+	}
+
+	std::wstring key(path);
+
+	if (!key.empty())
+	{
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, path.data(),
+			static_cast<int>(path.size()), key.data(), static_cast<int>(key.size()), nullptr,
+			nullptr, 0);
+	}
+
+	return key;
+}
+
+bool FolderEnumerationCache::IsAncestor(std::wstring_view ancestorKey, std::wstring_view key)
+{
+	return key.size() > ancestorKey.size() && key.starts_with(ancestorKey)
+		&& key[ancestorKey.size()] == PATH_SEPARATOR;
+}
+
+bool FolderEnumerationCache::IsAffectedBy(std::wstring_view key, const Invalidation &invalidation)
+{
+	if (invalidation.key.empty())
+	{
+		return true;
+	}
+
+	return key == invalidation.key
+		|| (invalidation.includesDescendants && IsAncestor(invalidation.key, key));
+}
+
+// This only needs to be approximate. It covers the items themselves, along with the memory
+// allocated for their pidls and names.
+size_t FolderEnumerationCache::EstimateMemoryUsage(const Key &key, const ItemList &items)
+{
+	size_t memoryUsage = sizeof(Entry) + (key.first.size() * 2 * sizeof(wchar_t))
+		+ (key.second.size() * 2) + (items.size() * sizeof(Item));
+
+	for (const auto &item : items)
+	{
+		if (item.pidl.HasValue())
+		{
+			memoryUsage += ILGetSize(item.pidl.Raw());
+		}
+
+		memoryUsage += item.parsingName.capacity() * sizeof(wchar_t);
+		memoryUsage += item.displayName.capacity() * sizeof(wchar_t);
+		memoryUsage += item.editingName.capacity() * sizeof(wchar_t);
+	}
+
+	return memoryUsage;
+}
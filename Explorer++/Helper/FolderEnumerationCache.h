@@ -0,0 +1,144 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "PidlHelper.h"
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Caches the items found when enumerating folders, so that a folder that's shown in several places
+// (e.g. in multiple tabs, or in both the listview and the treeview) only has to be enumerated once.
+// Entries are keyed by the absolute pidl of the folder. The parsing path isn't enough on its own,
+// since different folders can share a path (e.g. the root desktop folder and the desktop folder in
+// the user's profile), while containing different items. Once the estimated amount of memory used
+// by the cache exceeds the limit, the least recently used entries are evicted.
+//
+// It's up to the owner to invalidate entries as folders change. Changes are detected by path, so
+// each entry also records the parsing path of its folder. Invalidating a folder removes every
+// entry with that path. Invalidating a tree also removes the entries for each of the folder's
+// descendants, which is needed when a folder has been removed or renamed. As with
+// FolderSizeCache, the generation should be retrieved before a folder is enumerated and passed
+// back when inserting the results, so that results affected by a change made during the
+// enumeration are discarded.
+//
+// This class is thread-safe.
+class FolderEnumerationCache
+{
+public:
+	// Describes what was retrieved when a folder was enumerated.
+	enum class Contents
+	{
+		Folders = 1 << 0,
+		NonFolders = 1 << 1,
+
+		// Whether or not hidden items were included has to match exactly when looking up a folder.
+		// That's because the items that are hidden when this isn't set depend on the user's
+		// settings, so can't be determined from the item attributes.
+		IncludeHidden = 1 << 2,
+
+		// The names and find data for each item were retrieved.
+		Details = 1 << 3
+	};
+
+	struct Item
+	{
+		PidlChild pidl;
+
+		// Contains at least SFGAO_FOLDER, SFGAO_HIDDEN and SFGAO_SYSTEM.
+		SFGAOF attributes = 0;
+
+		// These are only set if the details were retrieved.
+		std::wstring parsingName;
+		std::wstring displayName;
+		std::wstring editingName;
+		std::optional<WIN32_FIND_DATA> findData;
+	};
+
+	using ItemList = std::vector<Item>;
+
+	explicit FolderEnumerationCache(size_t maxMemoryUsage);
+
+	// Returns the items in the folder, if the folder has been cached with (at least) the requested
+	// contents. The list may contain more items than were requested (e.g. files, when only
+	// folders were requested), so IsIncluded() should be used to filter it. The list is never
+	// modified once it's been added to the cache, so can be safely read from any thread.
+	std::shared_ptr<const ItemList> Get(PCIDLIST_ABSOLUTE pidl, std::wstring_view path,
+		Contents contents);
+
+	static bool IsIncluded(const Item &item, Contents contents);
+
+	uint64_t GetGeneration() const;
+
+	// Replaces any existing entry for the folder.
+	void Insert(PCIDLIST_ABSOLUTE pidl, std::wstring_view path, Contents contents, ItemList items,
+		uint64_t generation);
+
+	void InvalidateFolder(std::wstring_view path);
+	void InvalidateTree(std::wstring_view path);
+	void InvalidateAll();
+
+	size_t GetNumFolders() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	// If more invalidations than this have been made since an enumeration started, it's no longer
+	// possible to determine whether the result is affected, so the result is discarded.
+	static const size_t MAX_RECORDED_INVALIDATIONS = 1024;
+
+	// The path key comes first, so that the entries for a folder and for each of its descendants
+	// are contiguous. The pidl key then distinguishes between folders that share a path.
+	using Key = std::pair<std::wstring, std::string>;
+
+	struct Entry
+	{
+		Contents contents;
+		std::shared_ptr<const ItemList> items;
+		size_t memoryUsage;
+		std::list<Key>::iterator usageItr;
+	};
+
+	struct Invalidation
+	{
+		uint64_t generation;
+
+		// An empty key invalidates every folder.
+		std::wstring key;
+		bool includesDescendants;
+	};
+
+	static Key GetKey(PCIDLIST_ABSOLUTE pidl, std::wstring_view path);
+	static std::wstring GetPathKey(std::wstring_view path);
+	static bool IsAncestor(std::wstring_view ancestorKey, std::wstring_view key);
+	static bool IsAffectedBy(std::wstring_view key, const Invalidation &invalidation);
+	static size_t EstimateMemoryUsage(const Key &key, const ItemList &items);
+
+	void Invalidate(std::wstring key, bool includeDescendants);
+	void RemoveEntries(std::wstring_view pathKey);
+	void RemoveEntry(std::map<Key, Entry>::iterator itr);
+
+	const size_t m_maxMemoryUsage;
+	mutable std::mutex m_mutex;
+
+	std::map<Key, Entry> m_entries;
+
+	// The keys of the entries, from most to least recently used.
+	std::list<Key> m_usage;
+
+	size_t m_memoryUsage = 0;
+
+	uint64_t m_generation = 0;
+	std::deque<Invalidation> m_recentInvalidations;
+};
+
+DEFINE_ENUM_FLAG_OPERATORS(FolderEnumerationCache::Contents);
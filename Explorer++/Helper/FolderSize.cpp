@@ -5,62 +5,403 @@
 #include "stdafx.h"
 #include "FolderSize.h"
 #include <filesystem>
+#include <vector>
 
-FolderInfo GetFolderInfo(const std::wstring &path)
+namespace
+{
+
+const wchar_t PATH_SEPARATOR = std::filesystem::path::preferred_separator;
+
+// The sizes of the directory being calculated and of its descendants up to this many levels down
+// are cached. Caching every directory in a large tree would use a significant amount of memory,
+// while the directories near the top are the ones that are most likely to be shown next (e.g. when
+// navigating into one of the folders whose size is being shown).
+const int MAX_CACHED_DEPTH = 2;
+
+struct DirectoryEntry
+{
+	// Only retained once the directory has been enumerated if its size is going to be cached.
+	std::wstring path;
+
+	size_t parentIndex;
+	int depth;
+
+	// Initially, this only covers the items directly within the directory. The totals for each
+	// subdirectory are added once the entire tree has been enumerated.
+	FolderInfo folderInfo;
+
+	// Set if the totals were retrieved from the cache, in which case they already cover the
+	// entire subtree.
+	bool cached = false;
+};
+
+bool IsStopped(const std::atomic<bool> *stop)
+{
+	return stop && *stop;
+}
+
+void EnumerateDirectory(DirectoryEntry &directory, std::vector<std::wstring> &subdirectories,
+	const std::atomic<bool> *stop)
 {
-	FolderInfo folderInfo = {};
 	std::error_code error;
 
-	for (const auto &entry : std::filesystem::directory_iterator(path, error))
+	for (std::filesystem::directory_iterator itr(directory.path, error), end;
+		 !error && itr != end; itr.increment(error))
 	{
-		std::error_code typeErrorCode;
-		auto isDirectory = entry.is_directory(typeErrorCode);
+		if (IsStopped(stop))
+		{
+			return;
+		}
 
-		if (typeErrorCode)
+		std::error_code statusError;
+		auto status = itr->symlink_status(statusError);
+
+		if (statusError)
 		{
 			continue;
 		}
 
-		if (isDirectory)
+		if (std::filesystem::is_directory(status))
 		{
-			folderInfo.numFolders++;
+			directory.folderInfo.numFolders++;
+			subdirectories.push_back(itr->path().wstring());
+			continue;
+		}
+
+		bool isDirectoryLink = itr->is_directory(statusError);
 
-			FolderInfo subFolderInfo = GetFolderInfo(entry.path());
+		if (statusError)
+		{
+			continue;
+		}
 
-			folderInfo.size += subFolderInfo.size;
-			folderInfo.numFolders += subFolderInfo.numFolders;
-			folderInfo.numFiles += subFolderInfo.numFiles;
+		// A link may point to one of the directory's ancestors, so following it could result in
+		// the same items being counted over and over again.
+		if (isDirectoryLink)
+		{
+			directory.folderInfo.numFolders++;
+			continue;
 		}
-		else
+
+		std::error_code sizeError;
+		auto size = itr->file_size(sizeError);
+
+		// If the size can't be retrieved, the error will be ignored and the current file will
+		// effectively be skipped over.
+		if (!sizeError)
 		{
-			std::error_code sizeErrorCode;
-			const auto size = std::filesystem::file_size(entry.path(), sizeErrorCode);
+			directory.folderInfo.size += size;
+			directory.folderInfo.numFiles++;
+		}
+	}
+}
 
-			// If the size can't be retrieved, the error will be ignored and the current file will
-			// effectively be skipped over.
-			if (!sizeErrorCode)
-			{
-				folderInfo.size += size;
-				folderInfo.numFiles++;
-			}
+}
+
+FolderInfo &FolderInfo::operator+=(const FolderInfo &other)
+{
+	size += other.size;
+	numFolders += other.numFolders;
+	numFiles += other.numFiles;
+	return *this;
+}
+
+FolderSizeCache::FolderSizeCache(size_t maxSize) : m_maxSize(maxSize)
+{
+}
+
+std::optional<FolderInfo> FolderSizeCache::Get(std::wstring_view path, bool includeStale)
+{
+	auto key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end() || (itr->second.stale && !includeStale))
+	{
+		return std::nullopt;
+	}
+
+	m_usage.splice(m_usage.begin(), m_usage, itr->second.usageItr);
+	return itr->second.folderInfo;
+}
+
+uint64_t FolderSizeCache::GetGeneration() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_generation;
+}
+
+void FolderSizeCache::Insert(std::wstring_view path, const FolderInfo &folderInfo,
+	uint64_t generation)
+{
+	auto key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	// Each invalidation increments the generation, so this is the number of invalidations that
+	// have been made since the size was calculated.
+	if (m_generation - generation > m_recentInvalidations.size())
+	{
+		return;
+	}
+
+	for (auto itr = m_recentInvalidations.rbegin();
+		 itr != m_recentInvalidations.rend() && itr->generation > generation; ++itr)
+	{
+		if (IsAffectedBy(key, *itr))
+		{
+			return;
+		}
+	}
+
+	auto itr = m_entries.find(key);
+
+	if (itr != m_entries.end())
+	{
+		itr->second.folderInfo = folderInfo;
+		itr->second.stale = false;
+		m_usage.splice(m_usage.begin(), m_usage, itr->second.usageItr);
+		return;
+	}
+
+	if (m_entries.size() == m_maxSize)
+	{
+		RemoveEntry(m_entries.find(m_usage.back()));
+	}
+
+	m_usage.push_front(key);
+	m_entries.emplace(std::move(key), Entry{ folderInfo, m_usage.begin() });
+}
+
+void FolderSizeCache::InvalidatePath(std::wstring_view path)
+{
+	Invalidate(path, false);
+}
+
+void FolderSizeCache::InvalidateTree(std::wstring_view path)
+{
+	Invalidate(path, true);
+}
+
+void FolderSizeCache::Invalidate(std::wstring_view path, bool includeDescendants)
+{
+	auto key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	RecordInvalidation(key, includeDescendants);
+
+	if (auto itr = m_entries.find(key); itr != m_entries.end())
+	{
+		RemoveEntry(itr);
+	}
+
+	if (includeDescendants)
+	{
+		std::wstring descendantsStart = key + PATH_SEPARATOR;
+		std::wstring descendantsEnd = key + static_cast<wchar_t>(PATH_SEPARATOR + 1);
+
+		for (auto itr = m_entries.lower_bound(descendantsStart);
+			 itr != m_entries.end() && itr->first < descendantsEnd;)
+		{
+			m_usage.erase(itr->second.usageItr);
+			itr = m_entries.erase(itr);
 		}
 	}
 
-	return folderInfo;
+	for (auto separatorIndex = key.rfind(PATH_SEPARATOR); separatorIndex != std::wstring::npos;
+		 separatorIndex = (separatorIndex > 0) ? key.rfind(PATH_SEPARATOR, separatorIndex - 1)
+											   : std::wstring::npos)
+	{
+		if (auto itr = m_entries.find(key.substr(0, separatorIndex)); itr != m_entries.end())
+		{
+			RemoveEntry(itr);
+		}
+	}
+}
+
+void FolderSizeCache::MarkTreeStale(std::wstring_view path)
+{
+	auto key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	RecordInvalidation(key, true);
+
+	if (auto itr = m_entries.find(key); itr != m_entries.end())
+	{
+		itr->second.stale = true;
+	}
+
+	std::wstring descendantsStart = key + PATH_SEPARATOR;
+	std::wstring descendantsEnd = key + static_cast<wchar_t>(PATH_SEPARATOR + 1);
+
+	for (auto itr = m_entries.lower_bound(descendantsStart);
+		 itr != m_entries.end() && itr->first < descendantsEnd; ++itr)
+	{
+		itr->second.stale = true;
+	}
+}
+
+// Must be called with the mutex held.
+void FolderSizeCache::RecordInvalidation(const std::wstring &key, bool includeDescendants)
+{
+	m_generation++;
+	m_recentInvalidations.push_back({ m_generation, key, includeDescendants });
+
+	if (m_recentInvalidations.size() > MAX_RECORDED_INVALIDATIONS)
+	{
+		m_recentInvalidations.pop_front();
+	}
+}
+
+void FolderSizeCache::RemoveEntry(std::map<std::wstring, Entry>::iterator itr)
+{
+	m_usage.erase(itr->second.usageItr);
+	m_entries.erase(itr);
+}
+
+size_t FolderSizeCache::GetSize() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+// Paths are compared case-insensitively and without any trailing separator, so that, for example,
+// "C:\" is treated as the parent of "C:\Windows".
+std::wstring FolderSizeCache::GetKey(std::wstring_view path)
+{
+	while (!path.empty() && path.back() == PATH_SEPARATOR)
+	{
+		path.remove_suffix(1);
+	}
+
+	std::wstring key(path);
+
+	if (!key.empty())
+	{
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, path.data(),
+			static_cast<int>(path.size()), key.data(), static_cast<int>(key.size()), nullptr,
+			nullptr, 0);
+	}
+
+	return key;
+}
+
+bool FolderSizeCache::IsAncestor(std::wstring_view ancestorKey, std::wstring_view key)
+{
+	return key.size() > ancestorKey.size() && key.starts_with(ancestorKey)
+		&& key[ancestorKey.size()] == PATH_SEPARATOR;
+}
+
+bool FolderSizeCache::IsAffectedBy(std::wstring_view key, const Invalidation &invalidation)
+{
+	return key == invalidation.key || IsAncestor(key, invalidation.key)
+		|| (invalidation.includesDescendants && IsAncestor(invalidation.key, key));
 }
 
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter)
+std::optional<FolderInfo> CalculateFolderInfo(const std::wstring &path,
+	WorkStealingExecutor *executor, FolderSizeCache *cache, const std::atomic<bool> *stop,
+	const FolderSizeProgressCallback &progressCallback)
 {
-	FolderSize_t *pFolderSize = reinterpret_cast<FolderSize_t *>(lpParameter);
+	uint64_t generation = 0;
+
+	if (cache)
+	{
+		// This needs to be retrieved before anything is enumerated, so that any changes made during
+		// the calculation will be detected.
+		generation = cache->GetGeneration();
+
+		if (auto cachedFolderInfo = cache->Get(path))
+		{
+			return cachedFolderInfo;
+		}
+	}
+
+	// Directories are stored in breadth-first order, so each directory appears after its parent.
+	std::vector<DirectoryEntry> directories;
+	directories.push_back({ path, 0, 0, {} });
+
+	FolderInfo partialFolderInfo;
+	size_t levelStart = 0;
+
+	while (levelStart < directories.size())
+	{
+		size_t levelEnd = directories.size();
+		std::vector<std::vector<std::wstring>> subdirectories(levelEnd - levelStart);
+
+		executor->ParallelFor(levelEnd - levelStart,
+			[&directories, &subdirectories, levelStart, cache, stop](size_t index)
+			{
+				if (IsStopped(stop))
+				{
+					return;
+				}
+
+				auto &directory = directories[levelStart + index];
+
+				if (cache && directory.depth > 0)
+				{
+					if (auto cachedFolderInfo = cache->Get(directory.path))
+					{
+						directory.folderInfo = *cachedFolderInfo;
+						directory.cached = true;
+						return;
+					}
+				}
+
+				EnumerateDirectory(directory, subdirectories[index], stop);
+			});
+
+		if (IsStopped(stop))
+		{
+			return std::nullopt;
+		}
 
-	auto folderInfo = GetFolderInfo(pFolderSize->szPath);
+		for (size_t i = levelStart; i < levelEnd; i++)
+		{
+			partialFolderInfo += directories[i].folderInfo;
 
-	ULARGE_INTEGER size;
-	size.QuadPart = folderInfo.size;
+			int depth = directories[i].depth + 1;
 
-	pFolderSize->pfnCallback(folderInfo.numFolders, folderInfo.numFiles, &size, pFolderSize->pData);
+			for (auto &subdirectory : subdirectories[i - levelStart])
+			{
+				directories.push_back({ std::move(subdirectory), i, depth, {} });
+			}
 
-	free(pFolderSize);
+			if (!cache || directories[i].depth > MAX_CACHED_DEPTH)
+			{
+				std::wstring().swap(directories[i].path);
+			}
+		}
+
+		levelStart = levelEnd;
+
+		if (progressCallback && levelStart < directories.size())
+		{
+			progressCallback(partialFolderInfo);
+		}
+	}
+
+	// Working backwards means that, by the time a directory is reached, the totals for each of its
+	// subdirectories have already been added to it.
+	for (size_t i = directories.size() - 1; i > 0; i--)
+	{
+		const auto &directory = directories[i];
+		directories[directory.parentIndex].folderInfo += directory.folderInfo;
+
+		if (cache && !directory.cached && directory.depth <= MAX_CACHED_DEPTH)
+		{
+			cache->Insert(directory.path, directory.folderInfo, generation);
+		}
+	}
+
+	if (cache)
+	{
+		cache->Insert(path, directories[0].folderInfo, generation);
+	}
 
-	return 1;
+	return directories[0].folderInfo;
 }
@@ -4,20 +4,113 @@
 
 #pragma once
 
+#include "WorkStealingExecutor.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
 struct FolderInfo
 {
-	std::uintmax_t size;
-	int numFolders;
-	int numFiles;
-};
+	std::uintmax_t size = 0;
+	int numFolders = 0;
+	int numFiles = 0;
 
-FolderInfo GetFolderInfo(const std::wstring &path);
+	FolderInfo &operator+=(const FolderInfo &other);
+	bool operator==(const FolderInfo &) const = default;
+};
 
-typedef struct
+// Caches the sizes of directories, so that a size doesn't need to be recalculated each time it's
+// shown. It's up to the owner to invalidate entries as the file system changes. Invalidating a
+// path removes the entry for that path, along with the entries for each of its ancestors, since
+// their sizes include it. Invalidating a tree also removes the entries for each of the path's
+// descendants, which is needed when an item has been removed or renamed.
+//
+// Entries can also be marked as stale, when the owner can no longer detect changes to them. A
+// stale entry is only returned when explicitly requested, but is kept until it's invalidated,
+// evicted or replaced by a newly calculated size.
+//
+// A size can take a long time to calculate, so the directory may change while that's happening.
+// To account for that, the generation should be retrieved before the calculation starts and passed
+// back when inserting the result. Any result that's affected by an invalidation made in the
+// meantime is then discarded.
+//
+// This class is thread-safe.
+class FolderSizeCache
 {
-	TCHAR szPath[MAX_PATH];
-	LPVOID pData;
-	void (*pfnCallback)(int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData);
-} FolderSize_t;
+public:
+	explicit FolderSizeCache(size_t maxSize);
+
+	std::optional<FolderInfo> Get(std::wstring_view path, bool includeStale = false);
+	uint64_t GetGeneration() const;
+	void Insert(std::wstring_view path, const FolderInfo &folderInfo, uint64_t generation);
+	void InvalidatePath(std::wstring_view path);
+	void InvalidateTree(std::wstring_view path);
+
+	// Marks the entries for the path and its descendants as stale. Like an invalidation, this also
+	// causes any result that's being calculated for those paths to be discarded.
+	void MarkTreeStale(std::wstring_view path);
+	size_t GetSize() const;
+
+private:
+	// If more invalidations than this have been made since a calculation started, it's no longer
+	// possible to determine whether the result is affected, so the result is discarded.
+	static const size_t MAX_RECORDED_INVALIDATIONS = 1024;
+
+	struct Entry
+	{
+		FolderInfo folderInfo;
+		std::list<std::wstring>::iterator usageItr;
+		bool stale = false;
+	};
+
+	struct Invalidation
+	{
+		uint64_t generation;
+		std::wstring key;
+		bool includesDescendants;
+	};
+
+	static std::wstring GetKey(std::wstring_view path);
+	static bool IsAncestor(std::wstring_view ancestorKey, std::wstring_view key);
+	static bool IsAffectedBy(std::wstring_view key, const Invalidation &invalidation);
+
+	void Invalidate(std::wstring_view path, bool includeDescendants);
+	void RecordInvalidation(const std::wstring &key, bool includeDescendants);
+	void RemoveEntry(std::map<std::wstring, Entry>::iterator itr);
+
+	const size_t m_maxSize;
+	mutable std::mutex m_mutex;
+
+	// Entries are ordered by key, so that the descendants of a directory are contiguous.
+	std::map<std::wstring, Entry> m_entries;
+
+	// The keys of the entries, from most to least recently used.
+	std::list<std::wstring> m_usage;
+
+	uint64_t m_generation = 0;
+	std::deque<Invalidation> m_recentInvalidations;
+};
+
+using FolderSizeProgressCallback = std::function<void(const FolderInfo &partialFolderInfo)>;
 
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter);
+// Calculates the total size of a directory, along with the number of files and folders it contains.
+// Each level of the directory tree is enumerated in parallel on the executor. The calling thread
+// also takes part, so this can safely be called from a task that's running on the same executor.
+//
+// If a cache is provided, subdirectories that are already in the cache aren't enumerated again
+// and, once the calculation has finished, the sizes of the directory and of its descendants (up to
+// a few levels down) are added to the cache. The progress callback, if any, is invoked on the
+// calling thread each time a level of the tree has been enumerated, with the totals found so far.
+//
+// Links to other directories (e.g. symbolic links and junctions) are counted, but not followed.
+// Returns std::nullopt if the calculation was stopped.
+std::optional<FolderInfo> CalculateFolderInfo(const std::wstring &path,
+	WorkStealingExecutor *executor, FolderSizeCache *cache, const std::atomic<bool> *stop = nullptr,
+	const FolderSizeProgressCallback &progressCallback = nullptr);
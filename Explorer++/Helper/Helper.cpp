@@ -4,6 +4,8 @@
 
 #include "stdafx.h"
 #include "Helper.h"
+#include "AccountNameCache.h"
+#include "FileMetadata.h"
 #include "Macros.h"
 #include "ShellHelper.h"
 #include "TimeHelper.h"
@@ -21,15 +23,11 @@
 enum class VersionSubBlockType
 {
 	Root,
-	Translation,
-	StringTableValue
+	Translation
 };
 
 BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlockType,
-	WORD *pwLanguage, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS,
-	const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax);
-BOOL GetStringTableValue(void *pBlock, LangAndCodePage *plcp, UINT nItems,
-	const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax);
+	WORD *pwLanguage, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS);
 
 BOOL CreateFileTimeString(const FILETIME *utcFileTime, TCHAR *szBuffer, size_t cchMax,
 	BOOL bFriendlyDate)
@@ -231,49 +229,59 @@ std::wstring BuildFileAttributesString(DWORD fileAttributes)
 
 BOOL GetFileOwner(const TCHAR *szFile, TCHAR *szOwner, size_t cchMax)
 {
-	BOOL success = FALSE;
+	auto ownerSid = GetFileOwnerSid(szFile);
+
+	if (!ownerSid)
+	{
+		return FALSE;
+	}
 
+	return FormatUserName(ownerSid->data(), szOwner, cchMax);
+}
+
+// Returns a copy of the SID for the owner of the file. The owner can then be formatted via
+// FormatUserName().
+std::optional<std::vector<BYTE>> GetFileOwnerSid(const TCHAR *szFile)
+{
 	wil::unique_hfile file(CreateFile(szFile, READ_CONTROL, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
 		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
 
-	if (file)
+	if (!file)
 	{
-		PSID pSidOwner = nullptr;
-		PSECURITY_DESCRIPTOR pSD = nullptr;
-		DWORD dwRet = GetSecurityInfo(file.get(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
-			&pSidOwner, nullptr, nullptr, nullptr, &pSD);
+		return std::nullopt;
+	}
 
-		if (dwRet == ERROR_SUCCESS)
-		{
-			success = FormatUserName(pSidOwner, szOwner, cchMax);
-			LocalFree(pSD);
-		}
+	PSID pSidOwner = nullptr;
+	wil::unique_hlocal_security_descriptor securityDescriptor;
+	DWORD dwRet = GetSecurityInfo(file.get(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
+		&pSidOwner, nullptr, nullptr, nullptr, &securityDescriptor);
+
+	if (dwRet != ERROR_SUCCESS || !pSidOwner || !IsValidSid(pSidOwner))
+	{
+		return std::nullopt;
 	}
 
-	return success;
+	const auto *sidBytes = static_cast<const BYTE *>(pSidOwner);
+	return std::vector<BYTE>(sidBytes, sidBytes + GetLengthSid(pSidOwner));
 }
 
+// Account names are retrieved via AccountNameCache, so that each account only needs to be looked
+// up once, no matter how many files it owns.
 BOOL FormatUserName(PSID sid, TCHAR *userName, size_t cchMax)
 {
 	BOOL success = FALSE;
 
-	TCHAR accountName[512];
-	DWORD accountNameLength = SIZEOF_ARRAY(accountName);
-	TCHAR domainName[512];
-	DWORD domainNameLength = SIZEOF_ARRAY(domainName);
-	SID_NAME_USE eUse;
-	BOOL bRet = LookupAccountSid(nullptr, sid, accountName, &accountNameLength, domainName,
-		&domainNameLength, &eUse);
+	auto accountName = AccountNameCache::GetInstance().GetAccountName(sid);
 
-	if (bRet)
+	if (accountName)
 	{
-		StringCchPrintf(userName, cchMax, _T("%s\\%s"), domainName, accountName);
+		StringCchCopy(userName, cchMax, accountName->c_str());
 		success = TRUE;
 	}
 	else
 	{
 		LPTSTR stringSid;
-		bRet = ConvertSidToStringSid(sid, &stringSid);
+		BOOL bRet = ConvertSidToStringSid(sid, &stringSid);
 
 		if (bRet)
 		{
@@ -490,25 +498,39 @@ BOOL GetFileProductVersion(const TCHAR *szFullFileName, DWORD *pdwProductVersion
 	DWORD *pdwProductVersionMS)
 {
 	return GetFileVersionValue(szFullFileName, VersionSubBlockType::Root, nullptr,
-		pdwProductVersionLS, pdwProductVersionMS, nullptr, nullptr, 0);
+		pdwProductVersionLS, pdwProductVersionMS);
 }
 
 BOOL GetFileLanguage(const TCHAR *szFullFileName, WORD *pwLanguage)
 {
 	return GetFileVersionValue(szFullFileName, VersionSubBlockType::Translation, pwLanguage,
-		nullptr, nullptr, nullptr, nullptr, 0);
+		nullptr, nullptr);
 }
 
 BOOL GetVersionInfoString(const TCHAR *szFullFileName, const TCHAR *szVersionInfo,
 	TCHAR *szVersionBuffer, UINT cchMax)
 {
-	return GetFileVersionValue(szFullFileName, VersionSubBlockType::StringTableValue, nullptr,
-		nullptr, nullptr, szVersionInfo, szVersionBuffer, cchMax);
+	auto versionInfo = FileVersionInfo::Load(szFullFileName);
+
+	if (!versionInfo)
+	{
+		return FALSE;
+	}
+
+	auto value = versionInfo->GetString(szVersionInfo);
+
+	if (!value)
+	{
+		return FALSE;
+	}
+
+	StringCchCopy(szVersionBuffer, cchMax, value->c_str());
+
+	return TRUE;
 }
 
 BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlockType,
-	WORD *pwLanguage, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS,
-	const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax)
+	WORD *pwLanguage, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS)
 {
 	BOOL bSuccess = FALSE;
 	DWORD dwLen = GetFileVersionInfoSize(szFullFileName, nullptr);
@@ -536,8 +558,7 @@ BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlo
 					pBuffer = reinterpret_cast<LPVOID *>(&pvsffi);
 					uStructureSize = sizeof(VS_FIXEDFILEINFO);
 				}
-				else if (subBlockType == VersionSubBlockType::Translation
-					|| subBlockType == VersionSubBlockType::StringTableValue)
+				else if (subBlockType == VersionSubBlockType::Translation)
 				{
 					StringCchCopy(szSubBlock, std::size(szSubBlock),
 						_T("\\VarFileInfo\\Translation"));
@@ -561,11 +582,6 @@ BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlo
 					{
 						*pwLanguage = plcp[0].wLanguage;
 					}
-					else if (subBlockType == VersionSubBlockType::StringTableValue)
-					{
-						bSuccess = GetStringTableValue(pBlock, plcp, uLen / sizeof(LangAndCodePage),
-							szVersionInfo, szVersionBuffer, cchMax);
-					}
 				}
 			}
 
@@ -576,42 +592,6 @@ BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlo
 	return bSuccess;
 }
 
-BOOL GetStringTableValue(void *pBlock, LangAndCodePage *plcp, UINT nItems,
-	const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax)
-{
-	BOOL bSuccess = FALSE;
-	LANGID userLangId = GetUserDefaultLangID();
-
-	for (UINT i = 0; i < nItems; i++)
-	{
-		/* If the bottom eight bits of the language id's match, use this
-		version information (since this means that the version information
-		and the users default language are the same). Also use this version
-		information if the language is not specified (i.e. wLanguage is 0). */
-		if ((plcp[i].wLanguage & 0xFF) == (userLangId & 0xFF) || plcp[i].wLanguage == 0)
-		{
-			TCHAR szSubBlock[64];
-			StringCchPrintf(szSubBlock, SIZEOF_ARRAY(szSubBlock),
-				_T("\\StringFileInfo\\%04X%04X\\%s"), plcp[i].wLanguage, plcp[i].wCodePage,
-				szVersionInfo);
-
-			TCHAR *szBuffer;
-			UINT uLen;
-			BOOL bRet =
-				VerQueryValue(pBlock, szSubBlock, reinterpret_cast<LPVOID *>(&szBuffer), &uLen);
-
-			if (bRet && (uLen > 0))
-			{
-				StringCchCopy(szVersionBuffer, cchMax, szBuffer);
-				bSuccess = TRUE;
-				break;
-			}
-		}
-	}
-
-	return bSuccess;
-}
-
 HRESULT GetCPUBrandString(std::wstring &cpuBrand)
 {
 	// The code below is modeled very closely on the example WMI code provided in
@@ -651,70 +631,6 @@ HRESULT GetCPUBrandString(std::wstring &cpuBrand)
 	return S_OK;
 }
 
-HRESULT GetMediaMetadata(const TCHAR *szFileName, const TCHAR *szAttribute, BYTE **pszOutput)
-{
-	typedef HRESULT(WINAPI * WMCREATEEDITOR_PROC)(IWMMetadataEditor **);
-	WMCREATEEDITOR_PROC pWMCreateEditor = nullptr;
-	HMODULE hWMVCore;
-	IWMMetadataEditor *pEditor = nullptr;
-	IWMHeaderInfo *pWMHeaderInfo = nullptr;
-	HRESULT hr = E_FAIL;
-
-	hWMVCore = LoadLibrary(_T("wmvcore.dll"));
-
-	if (hWMVCore != nullptr)
-	{
-		pWMCreateEditor = (WMCREATEEDITOR_PROC) GetProcAddress(hWMVCore, "WMCreateEditor");
-
-		if (pWMCreateEditor != nullptr)
-		{
-			hr = pWMCreateEditor(&pEditor);
-
-			if (SUCCEEDED(hr))
-			{
-				hr = pEditor->Open(szFileName);
-
-				if (SUCCEEDED(hr))
-				{
-					hr = pEditor->QueryInterface(IID_PPV_ARGS(&pWMHeaderInfo));
-
-					if (SUCCEEDED(hr))
-					{
-						WORD wStreamNum;
-						WMT_ATTR_DATATYPE type;
-						WORD cbLength;
-
-						/* Any stream. Should be zero for MP3 files. */
-						wStreamNum = 0;
-
-						hr = pWMHeaderInfo->GetAttributeByName(&wStreamNum, szAttribute, &type,
-							nullptr, &cbLength);
-
-						if (SUCCEEDED(hr))
-						{
-							*pszOutput = (BYTE *) malloc(cbLength);
-
-							if (*pszOutput != nullptr)
-							{
-								hr = pWMHeaderInfo->GetAttributeByName(&wStreamNum, szAttribute,
-									&type, *pszOutput, &cbLength);
-							}
-						}
-
-						pWMHeaderInfo->Release();
-					}
-				}
-
-				pEditor->Release();
-			}
-		}
-
-		FreeLibrary(hWMVCore);
-	}
-
-	return hr;
-}
-
 void SetFORMATETC(FORMATETC *pftc, CLIPFORMAT cfFormat, DVTARGETDEVICE *ptd, DWORD dwAspect,
 	LONG lindex, DWORD tymed)
 {
@@ -9,6 +9,7 @@
 #include <windows.h>
 #include <optional>
 #include <string>
+#include <vector>
 
 struct LangAndCodePage
 {
@@ -35,9 +36,9 @@ BOOL GetFileSizeEx(const TCHAR *szFileName, PLARGE_INTEGER lpFileSize);
 BOOL CompareFileTypes(const TCHAR *pszFile1, const TCHAR *pszFile2);
 std::wstring BuildFileAttributesString(DWORD fileAttributes);
 BOOL GetFileOwner(const TCHAR *szFile, TCHAR *szOwner, size_t cchMax);
+std::optional<std::vector<BYTE>> GetFileOwnerSid(const TCHAR *szFile);
 DWORD GetNumFileHardLinks(const TCHAR *lpszFileName);
 BOOL ReadImageProperty(const TCHAR *lpszImage, PROPID propId, TCHAR *szProperty, int cchMax);
-HRESULT GetMediaMetadata(const TCHAR *szFileName, const TCHAR *szAttribute, BYTE **pszOutput);
 BOOL IsImage(const TCHAR *fileName);
 BOOL GetFileProductVersion(const TCHAR *szFullFileName, DWORD *pdwProductVersionLS,
 	DWORD *pdwProductVersionMS);
@@ -0,0 +1,105 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemLookupIndex.h"
+#include <string>
+
+void ItemLookupIndex::AddOrUpdateItem(int internalIndex, std::string_view id,
+	std::wstring_view parsingName)
+{
+	RemoveItem(internalIndex);
+
+	ItemKeys keys;
+	keys.idHash = std::hash<std::string_view>{}(id);
+	keys.parsingNameHash = HashParsingName(parsingName);
+
+	m_idMap.emplace(keys.idHash, internalIndex);
+	m_parsingNameMap.emplace(keys.parsingNameHash, internalIndex);
+	m_itemKeys.emplace(internalIndex, keys);
+}
+
+void ItemLookupIndex::RemoveItem(int internalIndex)
+{
+	auto itr = m_itemKeys.find(internalIndex);
+
+	if (itr == m_itemKeys.end())
+	{
+		return;
+	}
+
+	RemoveFromMap(m_idMap, itr->second.idHash, internalIndex);
+	RemoveFromMap(m_parsingNameMap, itr->second.parsingNameHash, internalIndex);
+	m_itemKeys.erase(itr);
+}
+
+void ItemLookupIndex::Clear()
+{
+	m_idMap.clear();
+	m_parsingNameMap.clear();
+	m_itemKeys.clear();
+}
+
+size_t ItemLookupIndex::GetNumItems() const
+{
+	return m_itemKeys.size();
+}
+
+std::optional<int> ItemLookupIndex::FindItemById(std::string_view id,
+	const MatchFunction &matchFunction) const
+{
+	return FindInMap(m_idMap, std::hash<std::string_view>{}(id), matchFunction);
+}
+
+std::optional<int> ItemLookupIndex::FindItemByParsingName(std::wstring_view parsingName,
+	const MatchFunction &matchFunction) const
+{
+	return FindInMap(m_parsingNameMap, HashParsingName(parsingName), matchFunction);
+}
+
+// Parsing names are folded before being hashed, so that a name that differs only in case from the
+// one an item was added with will still find the item.
+size_t ItemLookupIndex::HashParsingName(std::wstring_view parsingName)
+{
+	std::wstring foldedName(parsingName);
+
+	if (!foldedName.empty())
+	{
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, parsingName.data(),
+			static_cast<int>(parsingName.size()), foldedName.data(),
+			static_cast<int>(foldedName.size()), nullptr, nullptr, 0);
+	}
+
+	return std::hash<std::wstring>{}(foldedName);
+}
+
+void ItemLookupIndex::RemoveFromMap(HashMap &map, size_t hash, int internalIndex)
+{
+	auto [begin, end] = map.equal_range(hash);
+
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		if (itr->second == internalIndex)
+		{
+			map.erase(itr);
+			return;
+		}
+	}
+}
+
+std::optional<int> ItemLookupIndex::FindInMap(const HashMap &map, size_t hash,
+	const MatchFunction &matchFunction)
+{
+	auto [begin, end] = map.equal_range(hash);
+
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		if (matchFunction(itr->second))
+		{
+			return itr->second;
+		}
+	}
+
+	return std::nullopt;
+}
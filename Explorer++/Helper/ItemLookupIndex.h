@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// Allows the items in a folder to be found by either their ID (i.e. the bytes that make up the
+// child pidl) or their parsing name, without having to compare the target against every item.
+//
+// Only a hash of each key is stored, so a lookup can return items that don't actually match. Two
+// distinct items can also legitimately share a key (e.g. parsing names that differ only in case).
+// Each lookup therefore takes a function that's used to confirm whether a candidate item matches.
+//
+// This class isn't thread-safe. Callers are responsible for synchronizing access.
+class ItemLookupIndex
+{
+public:
+	using MatchFunction = std::function<bool(int internalIndex)>;
+
+	// If the item is already in the index, its keys will be replaced.
+	void AddOrUpdateItem(int internalIndex, std::string_view id, std::wstring_view parsingName);
+	void RemoveItem(int internalIndex);
+	void Clear();
+	size_t GetNumItems() const;
+
+	std::optional<int> FindItemById(std::string_view id, const MatchFunction &matchFunction) const;
+	std::optional<int> FindItemByParsingName(std::wstring_view parsingName,
+		const MatchFunction &matchFunction) const;
+
+private:
+	struct ItemKeys
+	{
+		size_t idHash;
+		size_t parsingNameHash;
+	};
+
+	using HashMap = std::unordered_multimap<size_t, int>;
+
+	static size_t HashParsingName(std::wstring_view parsingName);
+	static void RemoveFromMap(HashMap &map, size_t hash, int internalIndex);
+	static std::optional<int> FindInMap(const HashMap &map, size_t hash,
+		const MatchFunction &matchFunction);
+
+	HashMap m_idMap;
+	HashMap m_parsingNameMap;
+	std::unordered_map<int, ItemKeys> m_itemKeys;
+};
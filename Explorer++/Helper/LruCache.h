@@ -0,0 +1,117 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// A fixed-capacity map. Once the cache is full, adding a new entry will evict the entry that was
+// least recently added or retrieved.
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+class LruCache
+{
+public:
+	explicit LruCache(size_t maxSize) : m_maxSize(maxSize)
+	{
+		CHECK_GT(maxSize, 0U);
+	}
+
+	void Insert(const Key &key, Value value)
+	{
+		auto itr = m_entryMap.find(key);
+
+		if (itr != m_entryMap.end())
+		{
+			itr->second->second = std::move(value);
+			m_entries.splice(m_entries.begin(), m_entries, itr->second);
+			return;
+		}
+
+		if (m_entries.size() == m_maxSize)
+		{
+			m_entryMap.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+
+		m_entries.emplace_front(key, std::move(value));
+		m_entryMap.insert({ key, m_entries.begin() });
+	}
+
+	// Returns a pointer to the cached value, or nullptr if there's no value for the key. The
+	// pointer remains valid until the entry is evicted or removed.
+	Value *Get(const Key &key)
+	{
+		auto itr = m_entryMap.find(key);
+
+		if (itr == m_entryMap.end())
+		{
+			return nullptr;
+		}
+
+		m_entries.splice(m_entries.begin(), m_entries, itr->second);
+		return &itr->second->second;
+	}
+
+	bool Contains(const Key &key) const
+	{
+		return m_entryMap.contains(key);
+	}
+
+	void Remove(const Key &key)
+	{
+		auto itr = m_entryMap.find(key);
+
+		if (itr == m_entryMap.end())
+		{
+			return;
+		}
+
+		m_entries.erase(itr->second);
+		m_entryMap.erase(itr);
+	}
+
+	// Removes every entry for which the predicate returns true.
+	template <class Predicate>
+	void RemoveIf(Predicate predicate)
+	{
+		for (auto itr = m_entries.begin(); itr != m_entries.end();)
+		{
+			if (predicate(itr->first, itr->second))
+			{
+				m_entryMap.erase(itr->first);
+				itr = m_entries.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
+	}
+
+	void Clear()
+	{
+		m_entryMap.clear();
+		m_entries.clear();
+	}
+
+	size_t GetSize() const
+	{
+		return m_entries.size();
+	}
+
+	size_t GetMaxSize() const
+	{
+		return m_maxSize;
+	}
+
+private:
+	using EntryList = std::list<std::pair<Key, Value>>;
+
+	const size_t m_maxSize;
+	EntryList m_entries;
+	std::unordered_map<Key, typename EntryList::iterator, Hash, KeyEqual> m_entryMap;
+};
@@ -0,0 +1,95 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Helpers shared by the classes that write files from several threads at once (e.g.
+// FileCopyEngine, FileSplitter and SecureOverwriteEngine).
+namespace ParallelIoHelper
+{
+
+struct VirtualFreeDeleter
+{
+	void operator()(void *memory) const
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+	}
+};
+
+using AlignedBuffer = std::unique_ptr<void, VirtualFreeDeleter>;
+
+// VirtualAlloc() returns memory that's aligned to a page boundary, which satisfies the alignment
+// requirements for unbuffered I/O. Returns an empty buffer if the memory couldn't be allocated.
+inline AlignedBuffer AllocateAlignedBuffer(SIZE_T size)
+{
+	return AlignedBuffer(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+}
+
+// Keeps the first error reported by any of the threads taking part in an operation. Once one
+// thread has failed, the others will generally stop, so any later errors are of little interest.
+class FirstError
+{
+public:
+	void Record(HRESULT hr)
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (!m_failed)
+		{
+			m_error = hr;
+			m_failed = true;
+		}
+	}
+
+	// Can be checked without taking the lock, so that threads can stop as soon as possible.
+	bool HasFailed() const
+	{
+		return m_failed;
+	}
+
+	HRESULT GetError() const
+	{
+		std::scoped_lock lock(m_mutex);
+		return m_error;
+	}
+
+private:
+	mutable std::mutex m_mutex;
+	std::atomic<bool> m_failed = false;
+	HRESULT m_error = S_OK;
+};
+
+// Ensures that progress is only reported from one thread at a time.
+class ProgressReporter
+{
+public:
+	// If another thread is already reporting progress, there's no need to wait for it, since the
+	// totals will be reported again once the next block of data has been written. In that case,
+	// the report is skipped, unless force is true (e.g. for the final totals).
+	template <typename Function>
+	void Report(bool force, Function &&reportFunction)
+	{
+		std::unique_lock lock(m_mutex, std::defer_lock);
+
+		if (force)
+		{
+			lock.lock();
+		}
+		else if (!lock.try_lock())
+		{
+			return;
+		}
+
+		reportFunction();
+	}
+
+private:
+	std::mutex m_mutex;
+};
+
+}
@@ -0,0 +1,171 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PriorityTaskScheduler.h"
+
+PriorityTaskScheduler::PriorityTaskScheduler(WorkStealingExecutor *executor,
+	int maxConcurrentTasks, WorkStealingExecutor::Apartment apartment) :
+	m_maxConcurrentTasks(maxConcurrentTasks),
+	m_apartment(apartment),
+	m_runnerGroup(executor)
+{
+}
+
+// Any tasks that are still pending are discarded. Tasks that are currently running will be waited
+// on (when the runner group is destroyed).
+PriorityTaskScheduler::~PriorityTaskScheduler()
+{
+	std::scoped_lock lock(m_mutex);
+	m_stop = true;
+	m_pendingTasks.clear();
+	m_pendingTaskLookup.clear();
+}
+
+bool PriorityTaskScheduler::QueueTaskInternal(const void *owner, uint64_t id, Priority priority,
+	std::function<void()> task)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto existingItr = m_pendingTaskLookup.find({ owner, id });
+
+		if (existingItr != m_pendingTaskLookup.end())
+		{
+			if (priority < existingItr->second->priority)
+			{
+				SetPriority(existingItr->second, priority);
+			}
+
+			return false;
+		}
+
+		auto [itr, inserted] = m_pendingTasks.insert(
+			{ priority, m_sequenceNumber++, owner, id, std::move(task) });
+		m_pendingTaskLookup.insert({ { owner, id }, itr });
+
+		if (m_numActiveRunners >= m_maxConcurrentTasks)
+		{
+			// One of the existing runners will pick the task up.
+			return true;
+		}
+
+		m_numActiveRunners++;
+	}
+
+	m_runnerGroup.Submit([this]() { RunPendingTasks(); }, m_apartment);
+
+	return true;
+}
+
+std::vector<uint64_t> PriorityTaskScheduler::UpdatePriorities(const void *owner,
+	const PriorityFunction &priorityFunction)
+{
+	std::vector<uint64_t> cancelledIds;
+
+	std::scoped_lock lock(m_mutex);
+
+	// Updating the priority of a task moves it within the set, so the tasks to update are
+	// collected first.
+	std::vector<PendingTaskSet::iterator> ownerTasks;
+
+	for (auto itr = m_pendingTasks.begin(); itr != m_pendingTasks.end(); ++itr)
+	{
+		if (itr->owner == owner)
+		{
+			ownerTasks.push_back(itr);
+		}
+	}
+
+	for (auto &itr : ownerTasks)
+	{
+		auto updatedPriority = priorityFunction(itr->id, itr->priority);
+
+		if (!updatedPriority)
+		{
+			cancelledIds.push_back(itr->id);
+			m_pendingTaskLookup.erase({ owner, itr->id });
+			m_pendingTasks.erase(itr);
+			continue;
+		}
+
+		if (*updatedPriority != itr->priority)
+		{
+			auto &lookupItr = m_pendingTaskLookup.at({ owner, itr->id });
+			SetPriority(lookupItr, *updatedPriority);
+		}
+	}
+
+	return cancelledIds;
+}
+
+// Note that this updates the iterator that's passed in, since the task will be moved to a
+// different position within the set.
+void PriorityTaskScheduler::SetPriority(PendingTaskSet::iterator &itr, Priority priority)
+{
+	auto node = m_pendingTasks.extract(itr);
+	node.value().priority = priority;
+	itr = m_pendingTasks.insert(std::move(node)).position;
+}
+
+void PriorityTaskScheduler::CancelTasks(const void *owner, bool waitForRunningTasks)
+{
+	std::unique_lock lock(m_mutex);
+
+	std::erase_if(m_pendingTasks,
+		[this, owner](const PendingTask &pendingTask)
+		{
+			if (pendingTask.owner != owner)
+			{
+				return false;
+			}
+
+			m_pendingTaskLookup.erase({ owner, pendingTask.id });
+			return true;
+		});
+
+	if (waitForRunningTasks)
+	{
+		m_taskFinishedCondition.wait(lock,
+			[this, owner]() { return !m_numRunningTasks.contains(owner); });
+	}
+}
+
+int PriorityTaskScheduler::GetMaxConcurrentTasks() const
+{
+	return m_maxConcurrentTasks;
+}
+
+void PriorityTaskScheduler::RunPendingTasks()
+{
+	std::unique_lock lock(m_mutex);
+
+	while (!m_stop && !m_pendingTasks.empty())
+	{
+		auto node = m_pendingTasks.extract(m_pendingTasks.begin());
+		auto &pendingTask = node.value();
+		m_pendingTaskLookup.erase({ pendingTask.owner, pendingTask.id });
+		m_numRunningTasks[pendingTask.owner]++;
+
+		lock.unlock();
+		pendingTask.task();
+
+		// The task is destroyed before it's marked as finished, since the owner may be destroyed
+		// once CancelTasks() returns. This also ensures the task isn't destroyed with the lock
+		// held.
+		pendingTask.task = nullptr;
+		lock.lock();
+
+		auto runningItr = m_numRunningTasks.find(pendingTask.owner);
+
+		if (--runningItr->second == 0)
+		{
+			m_numRunningTasks.erase(runningItr);
+		}
+
+		m_taskFinishedCondition.notify_all();
+	}
+
+	m_numActiveRunners--;
+}
@@ -0,0 +1,144 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "WorkStealingExecutor.h"
+#include <boost/core/noncopyable.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Runs tasks on a WorkStealingExecutor, with at most a fixed number of tasks running at once. Unlike
+// a FIFO thread pool, pending tasks are run in priority order and can be re-prioritized or cancelled
+// after they've been queued. That allows work for items that are currently visible to be run before
+// work for items that aren't.
+//
+// Each task is identified by an owner and an ID (which only needs to be unique for that owner).
+// Queuing a task with the same owner and ID as a task that's still pending won't result in a
+// second task being queued. Instead, the priority of the existing task will be raised, if
+// necessary.
+class PriorityTaskScheduler : private boost::noncopyable
+{
+public:
+	// Tasks with lower values are run first. Tasks with the same priority are run in the order in
+	// which they were queued.
+	using Priority = int;
+
+	// Called for each pending task. Returning std::nullopt will cancel the task.
+	using PriorityFunction =
+		std::function<std::optional<Priority>(uint64_t id, Priority currentPriority)>;
+
+	PriorityTaskScheduler(WorkStealingExecutor *executor, int maxConcurrentTasks,
+		WorkStealingExecutor::Apartment apartment = WorkStealingExecutor::Apartment::NotRequired);
+	~PriorityTaskScheduler();
+
+	// Returns the future for the task, or std::nullopt if an identical task is already pending.
+	template <typename F>
+	std::optional<std::future<std::invoke_result_t<F>>> QueueTask(const void *owner, uint64_t id,
+		Priority priority, F &&f)
+	{
+		// The callable is moved into a local before being invoked, so that anything it captures is
+		// destroyed before the future becomes ready. Otherwise, the captures could outlive an owner
+		// that's destroyed as soon as the result is available.
+		// std::function requires the callable to be copyable, which isn't the case for
+		// std::packaged_task.
+		auto packagedTask = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+			[f = std::forward<F>(f)]() mutable
+			{
+				auto callable = std::move(f);
+				return callable();
+			});
+		auto future = packagedTask->get_future();
+
+		if (!QueueTaskInternal(owner, id, priority, [packagedTask]() { (*packagedTask)(); }))
+		{
+			return std::nullopt;
+		}
+
+		return future;
+	}
+
+	// Updates the priority of each pending task belonging to the specified owner. Returns the IDs
+	// of the tasks that were cancelled.
+	std::vector<uint64_t> UpdatePriorities(const void *owner,
+		const PriorityFunction &priorityFunction);
+
+	// Cancels all pending tasks belonging to the specified owner. If waitForRunningTasks is true,
+	// this will also wait for any of the owner's tasks that are currently running to finish. That
+	// should be done before the owner is destroyed, if the tasks reference it. Note that this
+	// shouldn't be called from within a task, if waiting for the owner's tasks to finish.
+	void CancelTasks(const void *owner, bool waitForRunningTasks = false);
+
+	int GetMaxConcurrentTasks() const;
+
+private:
+	struct PendingTask
+	{
+		Priority priority;
+
+		// Used to maintain FIFO order between tasks that have the same priority.
+		uint64_t sequenceNumber;
+
+		const void *owner;
+		uint64_t id;
+		std::function<void()> task;
+
+		bool operator<(const PendingTask &other) const
+		{
+			if (priority != other.priority)
+			{
+				return priority < other.priority;
+			}
+
+			return sequenceNumber < other.sequenceNumber;
+		}
+	};
+
+	struct TaskKey
+	{
+		const void *owner;
+		uint64_t id;
+
+		bool operator==(const TaskKey &) const = default;
+	};
+
+	struct TaskKeyHash
+	{
+		size_t operator()(const TaskKey &key) const
+		{
+			return std::hash<const void *>{}(key.owner) ^ (std::hash<uint64_t>{}(key.id) << 1);
+		}
+	};
+
+	using PendingTaskSet = std::set<PendingTask>;
+
+	bool QueueTaskInternal(const void *owner, uint64_t id, Priority priority,
+		std::function<void()> task);
+	void SetPriority(PendingTaskSet::iterator &itr, Priority priority);
+	void RunPendingTasks();
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_taskFinishedCondition;
+	PendingTaskSet m_pendingTasks;
+	std::unordered_map<TaskKey, PendingTaskSet::iterator, TaskKeyHash> m_pendingTaskLookup;
+	std::unordered_map<const void *, int> m_numRunningTasks;
+	uint64_t m_sequenceNumber = 0;
+	bool m_stop = false;
+
+	// Each runner is a task on the executor that runs pending tasks until there are none left.
+	const int m_maxConcurrentTasks;
+	int m_numActiveRunners = 0;
+	const WorkStealingExecutor::Apartment m_apartment;
+
+	WorkStealingExecutor::TaskGroup m_runnerGroup;
+};
@@ -0,0 +1,427 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SecureOverwriteEngine.h"
+#include "DriveInfo.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace
+{
+
+// xoshiro256** (see https://prng.di.unimi.it/). The random pass only needs to replace the original
+// data with something that doesn't follow a fixed pattern, so a fast, non-cryptographic generator,
+// seeded from the system once for each file, is sufficient.
+class RandomGenerator
+{
+public:
+	RandomGenerator()
+	{
+		std::random_device device;
+		uint64_t seed = (static_cast<uint64_t>(device()) << 32) | device();
+
+		// The state is expanded from the seed using splitmix64, as recommended by the authors of
+		// the generator. That ensures the state is never entirely zero.
+		for (auto &value : m_state)
+		{
+			seed += 0x9e3779b97f4a7c15;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+			value = z ^ (z >> 31);
+		}
+	}
+
+	void Fill(void *buffer, size_t size)
+	{
+		auto *output = static_cast<unsigned char *>(buffer);
+		size_t numWords = size / sizeof(uint64_t);
+
+		for (size_t i = 0; i < numWords; i++)
+		{
+			uint64_t value = Next();
+			std::memcpy(output + (i * sizeof(uint64_t)), &value, sizeof(value));
+		}
+
+		size_t remaining = size % sizeof(uint64_t);
+
+		if (remaining > 0)
+		{
+			uint64_t value = Next();
+			std::memcpy(output + (numWords * sizeof(uint64_t)), &value, remaining);
+		}
+	}
+
+private:
+	static uint64_t RotateLeft(uint64_t value, int shift)
+	{
+		return (value << shift) | (value >> (64 - shift));
+	}
+
+	uint64_t Next()
+	{
+		uint64_t result = RotateLeft(m_state[1] * 5, 7) * 9;
+		uint64_t t = m_state[1] << 17;
+
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = RotateLeft(m_state[3], 45);
+
+		return result;
+	}
+
+	uint64_t m_state[4];
+};
+
+}
+
+SecureOverwriteEngine::SecureOverwriteEngine(WorkStealingExecutor *executor, DWORD blockSize,
+	uint64_t ioBudget) :
+	m_executor(executor),
+	m_blockSize(blockSize),
+	m_ioBudget(ioBudget)
+{
+	assert(blockSize > 0);
+}
+
+DWORD SecureOverwriteEngine::GetBlockSize() const
+{
+	return m_blockSize;
+}
+
+HRESULT SecureOverwriteEngine::DestroyFiles(const std::vector<std::wstring> &paths,
+	const std::vector<Pattern> &passes, const std::atomic<bool> &stop,
+	const ProgressCallback &progressCallback)
+{
+	// The total is only used to report progress, so folders and files whose size can't be
+	// retrieved (which will most likely fail below) are simply left out of it.
+	uint64_t totalBytes = 0;
+
+	for (const auto &path : paths)
+	{
+		uint64_t overwriteSize;
+
+		if (SUCCEEDED(GetOverwriteSize(path, overwriteSize)))
+		{
+			totalBytes += overwriteSize * passes.size();
+		}
+	}
+
+	DestroyState state{ paths, passes, stop, progressCallback, totalBytes };
+
+	std::atomic<size_t> nextFile = 0;
+
+	// Each writer has its own block and overwrites one file at a time, taking the next file that
+	// hasn't been started each time it finishes.
+	auto writer = [this, &state, &nextFile](size_t index)
+	{
+		UNREFERENCED_PARAMETER(index);
+
+		BlockBuffer block;
+		HRESULT hr = AllocateBlock(block);
+
+		if (FAILED(hr))
+		{
+			state.firstError.Record(hr);
+			return;
+		}
+
+		for (size_t fileIndex = nextFile++; fileIndex < state.paths.size();
+			 fileIndex = nextFile++)
+		{
+			if (state.stop)
+			{
+				state.stopped = true;
+				break;
+			}
+
+			hr = DestroyFile(state, fileIndex, block.get());
+
+			if (hr == E_ABORT)
+			{
+				state.stopped = true;
+				break;
+			}
+			else if (FAILED(hr))
+			{
+				state.firstError.Record(hr);
+			}
+		}
+	};
+
+	uint64_t maxWriters = (std::max)(m_ioBudget / m_blockSize, static_cast<uint64_t>(1));
+	auto numWriters = static_cast<size_t>((std::min)(maxWriters,
+		static_cast<uint64_t>(paths.size())));
+
+	if (m_executor && numWriters > 1)
+	{
+		m_executor->ParallelFor(numWriters, writer);
+	}
+	else
+	{
+		writer(0);
+	}
+
+	ReportProgress(state, true);
+
+	if (state.firstError.HasFailed())
+	{
+		return state.firstError.GetError();
+	}
+
+	if (state.stopped)
+	{
+		return E_ABORT;
+	}
+
+	return S_OK;
+}
+
+HRESULT SecureOverwriteEngine::DestroyFile(DestroyState &state, size_t fileIndex,
+	void *block) const
+{
+	const std::wstring &path = state.paths[fileIndex];
+
+	DWORD attributes = GetFileAttributes(path.c_str());
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return S_OK;
+	}
+
+	uint64_t previousBytesOverwritten = 0;
+	HRESULT hr = OverwriteFile(path, state.passes, block,
+		[&state, &previousBytesOverwritten](uint64_t fileBytesOverwritten)
+		{
+			state.bytesOverwritten += fileBytesOverwritten - previousBytesOverwritten;
+			previousBytesOverwritten = fileBytesOverwritten;
+
+			ReportProgress(state, false);
+
+			return !state.stop;
+		});
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	if (!DeleteFile(path.c_str()))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	state.filesDestroyed++;
+	ReportProgress(state, false);
+
+	return S_OK;
+}
+
+HRESULT SecureOverwriteEngine::OverwriteFile(const std::wstring &path,
+	const std::vector<Pattern> &passes, const BlockCallback &blockCallback) const
+{
+	BlockBuffer block;
+	HRESULT hr = AllocateBlock(block);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return OverwriteFile(path, passes, block.get(), blockCallback);
+}
+
+HRESULT SecureOverwriteEngine::OverwriteFile(const std::wstring &path,
+	const std::vector<Pattern> &passes, void *block, const BlockCallback &blockCallback) const
+{
+	uint64_t overwriteSize;
+	bool clusterAligned;
+	HRESULT hr = GetOverwriteSize(path, overwriteSize, clusterAligned);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Unbuffered I/O requires every write to be a multiple of the sector size. That's guaranteed
+	// when the file is being overwritten up to the end of its last cluster, since the block size
+	// is also expected to be a multiple of the sector size. Otherwise, the writes go through the
+	// cache, with each pass being flushed before the next one starts.
+	DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH;
+
+	if (clusterAligned)
+	{
+		WI_SetFlag(flags, FILE_FLAG_NO_BUFFERING);
+	}
+
+	// No sharing is allowed, so that the file can't be opened while it's being overwritten.
+	wil::unique_hfile file(
+		CreateFile(path.c_str(), FILE_WRITE_DATA, 0, nullptr, OPEN_EXISTING, flags, nullptr));
+
+	if (!file)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	FILE_END_OF_FILE_INFO endOfFileInfo;
+	endOfFileInfo.EndOfFile.QuadPart = overwriteSize;
+
+	if (!SetFileInformationByHandle(file.get(), FileEndOfFileInfo, &endOfFileInfo,
+			sizeof(endOfFileInfo)))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	RandomGenerator randomGenerator;
+	uint64_t bytesOverwritten = 0;
+
+	for (auto pattern : passes)
+	{
+		if (pattern != Pattern::Random)
+		{
+			std::memset(block, pattern == Pattern::Ones ? 0xFF : 0x00, m_blockSize);
+		}
+
+		for (uint64_t offset = 0; offset < overwriteSize;)
+		{
+			auto size = static_cast<DWORD>(
+				(std::min)(overwriteSize - offset, static_cast<uint64_t>(m_blockSize)));
+
+			if (pattern == Pattern::Random)
+			{
+				randomGenerator.Fill(block, size);
+			}
+
+			// The file wasn't opened for overlapped I/O, so the write will complete before
+			// WriteFile() returns. The OVERLAPPED structure only supplies the offset.
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(offset);
+			overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD bytesWritten;
+
+			if (!WriteFile(file.get(), block, size, &bytesWritten, &overlapped))
+			{
+				return HRESULT_FROM_WIN32(GetLastError());
+			}
+
+			if (bytesWritten != size)
+			{
+				return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+			}
+
+			offset += size;
+			bytesOverwritten += size;
+
+			if (blockCallback && !blockCallback(bytesOverwritten))
+			{
+				return E_ABORT;
+			}
+		}
+
+		// Each pass needs to reach the disk before the next one starts. Otherwise, the passes could
+		// be combined in a write cache, with only the last one actually being written.
+		if (!FlushFileBuffers(file.get()))
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+	}
+
+	return S_OK;
+}
+
+HRESULT SecureOverwriteEngine::GetOverwriteSize(const std::wstring &path,
+	uint64_t &overwriteSize)
+{
+	bool clusterAligned;
+	return GetOverwriteSize(path, overwriteSize, clusterAligned);
+}
+
+HRESULT SecureOverwriteEngine::GetOverwriteSize(const std::wstring &path,
+	uint64_t &overwriteSize, bool &clusterAligned)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return HRESULT_FROM_WIN32(ERROR_DIRECTORY_NOT_SUPPORTED);
+	}
+
+	overwriteSize =
+		(static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+	clusterAligned = false;
+
+	TCHAR root[MAX_PATH];
+	HRESULT hr = StringCchCopy(root, std::size(root), path.c_str());
+
+	if (FAILED(hr) || !PathStripToRoot(root))
+	{
+		return S_OK;
+	}
+
+	DWORD clusterSize;
+
+	if (!GetClusterSize(root, &clusterSize) || clusterSize == 0)
+	{
+		return S_OK;
+	}
+
+	// The space allocated to the file extends to the end of its last cluster.
+	if ((overwriteSize % clusterSize) != 0)
+	{
+		overwriteSize += clusterSize - (overwriteSize % clusterSize);
+	}
+
+	clusterAligned = true;
+
+	return S_OK;
+}
+
+HRESULT SecureOverwriteEngine::AllocateBlock(BlockBuffer &block) const
+{
+	block = ParallelIoHelper::AllocateAlignedBuffer(m_blockSize);
+
+	if (!block)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	return S_OK;
+}
+
+void SecureOverwriteEngine::ReportProgress(DestroyState &state, bool force)
+{
+	if (!state.progressCallback)
+	{
+		return;
+	}
+
+	state.progressReporter.Report(force,
+		[&state]()
+		{
+			Progress progress;
+			progress.bytesOverwritten = state.bytesOverwritten;
+			progress.totalBytes = state.totalBytes;
+			progress.filesDestroyed = state.filesDestroyed;
+			progress.totalFiles = state.paths.size();
+
+			state.progressCallback(progress);
+		});
+}
@@ -0,0 +1,112 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ParallelIoHelper.h"
+#include "WorkStealingExecutor.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Overwrites the contents of files before deleting them, so that the original data can't be
+// recovered from the disk. Each file is overwritten in large blocks, from a page-aligned buffer,
+// and without going through the system cache where possible. The random pass is generated by a
+// fast, seeded generator one block at a time, rather than requesting each byte from the system
+// random number generator.
+//
+// When several files are destroyed at once, they're overwritten concurrently. The number of files
+// written at any one time is limited by the I/O budget: each file that's being written uses one
+// block, so the budget caps the amount of data that's in flight.
+class SecureOverwriteEngine
+{
+public:
+	enum class Pattern
+	{
+		Zeros,
+		Ones,
+		Random
+	};
+
+	struct Progress
+	{
+		// Both values cover every pass of every file.
+		uint64_t bytesOverwritten;
+		uint64_t totalBytes;
+
+		size_t filesDestroyed;
+		size_t totalFiles;
+	};
+
+	// Invoked from the threads the files are written on, though never from more than one thread
+	// at a time.
+	using ProgressCallback = std::function<void(const Progress &progress)>;
+
+	// Invoked each time a block has been written, with the number of bytes written so far across
+	// every pass. Returning false stops the overwrite.
+	using BlockCallback = std::function<bool(uint64_t bytesOverwritten)>;
+
+	static const DWORD DEFAULT_BLOCK_SIZE = 1024 * 1024;
+	static const uint64_t DEFAULT_IO_BUDGET = 4 * static_cast<uint64_t>(DEFAULT_BLOCK_SIZE);
+
+	// If no executor is provided, files will be destroyed one at a time, on the calling thread.
+	// The block size should be a multiple of the sector size of any disk that will be written to.
+	explicit SecureOverwriteEngine(WorkStealingExecutor *executor = nullptr,
+		DWORD blockSize = DEFAULT_BLOCK_SIZE, uint64_t ioBudget = DEFAULT_IO_BUDGET);
+
+	// Overwrites each file with every pass, in order, then deletes it. Folders are skipped. A
+	// failure with one file doesn't prevent the other files from being destroyed; the first error
+	// encountered is returned once every file has been processed. Returns E_ABORT if stopped.
+	HRESULT DestroyFiles(const std::vector<std::wstring> &paths, const std::vector<Pattern> &passes,
+		const std::atomic<bool> &stop, const ProgressCallback &progressCallback);
+
+	// Overwrites the file with every pass, in order, without deleting it. The file is extended to
+	// the end of its last cluster first, so that the slack space is overwritten as well.
+	HRESULT OverwriteFile(const std::wstring &path, const std::vector<Pattern> &passes,
+		const BlockCallback &blockCallback) const;
+
+	// Returns the number of bytes each pass will write for the specified file. That's the size of
+	// the file, rounded up to the end of its last cluster, if the cluster size can be determined.
+	// Fails if the path refers to a folder.
+	static HRESULT GetOverwriteSize(const std::wstring &path, uint64_t &overwriteSize);
+
+	DWORD GetBlockSize() const;
+
+private:
+	using BlockBuffer = ParallelIoHelper::AlignedBuffer;
+
+	struct DestroyState
+	{
+		const std::vector<std::wstring> &paths;
+		const std::vector<Pattern> &passes;
+		const std::atomic<bool> &stop;
+		const ProgressCallback &progressCallback;
+		uint64_t totalBytes;
+
+		std::atomic<uint64_t> bytesOverwritten = 0;
+		std::atomic<size_t> filesDestroyed = 0;
+		ParallelIoHelper::ProgressReporter progressReporter;
+
+		std::atomic<bool> stopped = false;
+
+		// A failure with one file doesn't stop the others, so this is only used to report the
+		// result once every file has been processed.
+		ParallelIoHelper::FirstError firstError;
+	};
+
+	static HRESULT GetOverwriteSize(const std::wstring &path, uint64_t &overwriteSize,
+		bool &clusterAligned);
+
+	HRESULT AllocateBlock(BlockBuffer &block) const;
+	HRESULT OverwriteFile(const std::wstring &path, const std::vector<Pattern> &passes,
+		void *block, const BlockCallback &blockCallback) const;
+	HRESULT DestroyFile(DestroyState &state, size_t fileIndex, void *block) const;
+	static void ReportProgress(DestroyState &state, bool force);
+
+	WorkStealingExecutor *const m_executor;
+	const DWORD m_blockSize;
+	const uint64_t m_ioBudget;
+};
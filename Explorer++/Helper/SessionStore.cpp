@@ -0,0 +1,389 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SessionStore.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+const WCHAR JOURNAL_FILE_SUFFIX[] = L".journal";
+const WCHAR TEMP_FILE_SUFFIX[] = L".tmp";
+
+// Neither file should ever come close to this size, so a file that's larger can't be valid.
+const uint64_t MAX_FILE_SIZE = 1024 * 1024 * 1024;
+
+bool ReadEntireFile(HANDLE file, std::string &contents)
+{
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > MAX_FILE_SIZE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER start = {};
+
+	if (!SetFilePointerEx(file, start, nullptr, FILE_BEGIN))
+	{
+		return false;
+	}
+
+	contents.resize(static_cast<size_t>(fileSize.QuadPart));
+
+	DWORD numBytesRead;
+	BOOL res = ReadFile(file, contents.data(), static_cast<DWORD>(contents.size()), &numBytesRead,
+		nullptr);
+
+	if (!res || numBytesRead != contents.size())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool WriteAt(HANDLE file, uint64_t offset, const std::string &data)
+{
+	if (data.size() > MAX_FILE_SIZE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(offset);
+
+	if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+	{
+		return false;
+	}
+
+	DWORD numBytesWritten;
+	BOOL res =
+		WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &numBytesWritten, nullptr);
+
+	return res && numBytesWritten == data.size();
+}
+
+}
+
+std::unique_ptr<SessionStore> SessionStore::Open(const std::wstring &filePath)
+{
+	wil::unique_hfile journal(CreateFile((filePath + JOURNAL_FILE_SUFFIX).c_str(),
+		GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!journal)
+	{
+		return nullptr;
+	}
+
+	// The constructor is private, so std::make_unique can't be used here.
+	std::unique_ptr<SessionStore> store(new SessionStore(filePath, std::move(journal)));
+
+	if (!store->Initialize())
+	{
+		return nullptr;
+	}
+
+	return store;
+}
+
+SessionStore::SessionStore(const std::wstring &filePath, wil::unique_hfile journal) :
+	m_filePath(filePath),
+	m_journal(std::move(journal))
+{
+}
+
+SessionStore::~SessionStore() = default;
+
+bool SessionStore::Initialize()
+{
+	LoadSnapshot();
+
+	if (!LoadJournal())
+	{
+		// The journal is either new, or was written against a different snapshot. Either way, there
+		// are no records in it that apply.
+		return ResetJournal();
+	}
+
+	return true;
+}
+
+// If the snapshot doesn't exist or is invalid, the store simply starts off empty.
+void SessionStore::LoadSnapshot()
+{
+	wil::unique_hfile snapshot(CreateFile(m_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!snapshot)
+	{
+		return;
+	}
+
+	std::string contents;
+
+	if (!ReadEntireFile(snapshot.get(), contents) || contents.size() < sizeof(FileHeader))
+	{
+		return;
+	}
+
+	FileHeader header;
+	memcpy(&header, contents.data(), sizeof(header));
+
+	if (header.signature != SNAPSHOT_SIGNATURE || header.version != FILE_VERSION)
+	{
+		return;
+	}
+
+	m_generation = header.generation;
+	ReadRecords(contents, sizeof(header), m_sections);
+}
+
+bool SessionStore::LoadJournal()
+{
+	std::string contents;
+
+	if (!ReadEntireFile(m_journal.get(), contents) || contents.size() < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, contents.data(), sizeof(header));
+
+	if (header.signature != JOURNAL_SIGNATURE || header.version != FILE_VERSION
+		|| header.generation != m_generation)
+	{
+		return false;
+	}
+
+	size_t validSize = ReadRecords(contents, sizeof(header), m_sections);
+
+	if (validSize < contents.size())
+	{
+		// The last save was interrupted. The incomplete record is removed, so that the next record
+		// can be appended after the last valid one.
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(validSize);
+
+		if (!SetFilePointerEx(m_journal.get(), position, nullptr, FILE_BEGIN)
+			|| !SetEndOfFile(m_journal.get()))
+		{
+			return false;
+		}
+	}
+
+	m_journalSize = validSize;
+
+	return true;
+}
+
+bool SessionStore::ResetJournal()
+{
+	FileHeader header = { JOURNAL_SIGNATURE, FILE_VERSION, m_generation };
+	std::string data(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	if (!WriteAt(m_journal.get(), 0, data) || !SetEndOfFile(m_journal.get())
+		|| !FlushFileBuffers(m_journal.get()))
+	{
+		m_journalStale = true;
+		return false;
+	}
+
+	m_journalSize = sizeof(header);
+	m_journalStale = false;
+
+	return true;
+}
+
+const std::string *SessionStore::GetSection(uint32_t id) const
+{
+	auto itr = m_sections.find(id);
+
+	if (itr == m_sections.end())
+	{
+		return nullptr;
+	}
+
+	return &itr->second;
+}
+
+void SessionStore::SetSection(uint32_t id, std::string data)
+{
+	// The size of each section is stored as a 32-bit value.
+	if (data.size() > std::numeric_limits<uint32_t>::max())
+	{
+		return;
+	}
+
+	auto itr = m_sections.find(id);
+
+	if (itr != m_sections.end() && itr->second == data)
+	{
+		return;
+	}
+
+	m_sections[id] = std::move(data);
+	m_changedSections.insert(id);
+}
+
+bool SessionStore::Commit()
+{
+	if (m_changedSections.empty())
+	{
+		return true;
+	}
+
+	std::string records;
+	uint64_t totalSectionSize = 0;
+
+	for (auto id : m_changedSections)
+	{
+		AppendRecord(records, id, m_sections.at(id));
+	}
+
+	for (const auto &section : m_sections)
+	{
+		totalSectionSize += sizeof(RecordHeader) + section.second.size();
+	}
+
+	if (m_journalStale
+		|| (m_journalSize + records.size()) > std::max(MIN_COMPACTION_SIZE, totalSectionSize * 2))
+	{
+		return Compact();
+	}
+
+	// Note that if the write only partially succeeds, the incomplete record will simply be
+	// overwritten by the next commit.
+	if (!WriteAt(m_journal.get(), m_journalSize, records) || !FlushFileBuffers(m_journal.get()))
+	{
+		return false;
+	}
+
+	m_journalSize += records.size();
+	m_changedSections.clear();
+
+	return true;
+}
+
+bool SessionStore::Compact()
+{
+	FileHeader header = { SNAPSHOT_SIGNATURE, FILE_VERSION, m_generation + 1 };
+	std::string contents(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	for (const auto &[id, data] : m_sections)
+	{
+		AppendRecord(contents, id, data);
+	}
+
+	// The snapshot is written to a separate file first and then moved into place, so that the
+	// existing snapshot is left intact if the write fails part way through.
+	auto tempFilePath = m_filePath + TEMP_FILE_SUFFIX;
+
+	{
+		wil::unique_hfile tempFile(CreateFile(tempFilePath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+		if (!tempFile)
+		{
+			return false;
+		}
+
+		if (!WriteAt(tempFile.get(), 0, contents) || !FlushFileBuffers(tempFile.get()))
+		{
+			tempFile.reset();
+			DeleteFile(tempFilePath.c_str());
+			return false;
+		}
+	}
+
+	if (!MoveFileEx(tempFilePath.c_str(), m_filePath.c_str(),
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFile(tempFilePath.c_str());
+		return false;
+	}
+
+	m_generation++;
+	m_changedSections.clear();
+
+	// The new snapshot contains everything, so the commit has succeeded, even if the journal can't
+	// be emptied. In that case, the next commit will write a new snapshot again.
+	ResetJournal();
+
+	return true;
+}
+
+uint64_t SessionStore::GetJournalSize() const
+{
+	return m_journalSize;
+}
+
+// Reads records until the end of the data is reached, or an invalid record is found. Returns the
+// offset just past the last valid record.
+size_t SessionStore::ReadRecords(const std::string &data, size_t offset,
+	std::map<uint32_t, std::string> &sections)
+{
+	while ((data.size() - offset) >= sizeof(RecordHeader))
+	{
+		RecordHeader record;
+		memcpy(&record, data.data() + offset, sizeof(record));
+
+		if (record.dataSize > (data.size() - offset - sizeof(record)))
+		{
+			break;
+		}
+
+		std::string sectionData = data.substr(offset + sizeof(record), record.dataSize);
+
+		if (CalculateChecksum(record.sectionId, sectionData) != record.checksum)
+		{
+			break;
+		}
+
+		sections[record.sectionId] = std::move(sectionData);
+		offset += sizeof(record) + record.dataSize;
+	}
+
+	return offset;
+}
+
+void SessionStore::AppendRecord(std::string &buffer, uint32_t id, const std::string &data)
+{
+	RecordHeader record = { id, static_cast<uint32_t>(data.size()),
+		CalculateChecksum(id, data) };
+	buffer.append(reinterpret_cast<const char *>(&record), sizeof(record));
+	buffer.append(data);
+}
+
+// The checksum only needs to detect records that were incompletely written, so a simple hash is
+// sufficient. This is FNV-1a, applied to 8 bytes at a time, rather than a single byte at a time,
+// which makes it significantly cheaper for large sections.
+uint64_t SessionStore::CalculateChecksum(uint32_t id, const std::string &data)
+{
+	const uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t PRIME = 1099511628211ULL;
+
+	uint64_t hash = OFFSET_BASIS;
+	hash = (hash ^ ((static_cast<uint64_t>(id) << 32) | data.size())) * PRIME;
+
+	size_t offset = 0;
+
+	for (; (data.size() - offset) >= sizeof(uint64_t); offset += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, data.data() + offset, sizeof(word));
+		hash = (hash ^ word) * PRIME;
+	}
+
+	for (; offset < data.size(); offset++)
+	{
+		hash = (hash ^ static_cast<unsigned char>(data[offset])) * PRIME;
+	}
+
+	return hash;
+}
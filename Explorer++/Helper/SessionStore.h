@@ -0,0 +1,105 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <wil/resource.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+// Persists a set of independent sections (e.g. the open tabs and the bookmarks) in a binary format.
+// The contents of each section are opaque to the store.
+//
+// The store consists of a snapshot file and a journal. A save only appends the sections that have
+// changed to the journal, so the cost of a save doesn't depend on the size of the sections that
+// haven't changed. Once the journal grows large enough, every section is written to a new snapshot,
+// which atomically replaces the existing one, and the journal is emptied.
+//
+// Each record is checksummed. If the application is terminated part way through a save, the
+// incomplete record will be discarded when the store is next opened, leaving the section with its
+// previous contents.
+//
+// The journal is opened exclusively, so only a single process can use the store at once. This
+// class isn't thread-safe.
+class SessionStore : private boost::noncopyable
+{
+public:
+	// Opens the store, creating it if necessary. The journal is stored alongside the snapshot.
+	// Returns null if the store can't be opened (e.g. because it's in use by another process).
+	static std::unique_ptr<SessionStore> Open(const std::wstring &filePath);
+
+	~SessionStore();
+
+	// Returns null if the section doesn't exist. The returned pointer is only valid until the
+	// section is next updated.
+	const std::string *GetSection(uint32_t id) const;
+
+	// Updates the section in memory. Nothing is written until Commit() is called. If the data is
+	// the same as the existing contents of the section, the section won't be written at all.
+	void SetSection(uint32_t id, std::string data);
+
+	// Writes each of the sections that have changed since the last commit. If this fails, the
+	// changes will be written during the next commit instead.
+	bool Commit();
+
+	uint64_t GetJournalSize() const;
+
+private:
+	static constexpr uint32_t SNAPSHOT_SIGNATURE = 0x53535358; // "XSSS"
+	static constexpr uint32_t JOURNAL_SIGNATURE = 0x4A535358; // "XSSJ"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	// The journal is compacted once it's larger than this, or larger than twice the total size of
+	// the sections, whichever is greater.
+	static constexpr uint64_t MIN_COMPACTION_SIZE = 1024 * 1024;
+
+#pragma pack(push, 1)
+	struct FileHeader
+	{
+		uint32_t signature;
+		uint32_t version;
+
+		// Incremented each time a new snapshot is written. Records in the journal only apply to the
+		// snapshot with the same generation. That way, if the application is terminated after a new
+		// snapshot has been written, but before the journal has been emptied, the journal will be
+		// ignored.
+		uint64_t generation;
+	};
+
+	struct RecordHeader
+	{
+		uint32_t sectionId;
+		uint32_t dataSize;
+		uint64_t checksum;
+	};
+#pragma pack(pop)
+
+	SessionStore(const std::wstring &filePath, wil::unique_hfile journal);
+
+	bool Initialize();
+	void LoadSnapshot();
+	bool LoadJournal();
+	bool ResetJournal();
+	bool Compact();
+	static size_t ReadRecords(const std::string &data, size_t offset,
+		std::map<uint32_t, std::string> &sections);
+	static void AppendRecord(std::string &buffer, uint32_t id, const std::string &data);
+	static uint64_t CalculateChecksum(uint32_t id, const std::string &data);
+
+	const std::wstring m_filePath;
+	const wil::unique_hfile m_journal;
+
+	std::map<uint32_t, std::string> m_sections;
+	std::set<uint32_t> m_changedSections;
+	uint64_t m_generation = 0;
+	uint64_t m_journalSize = 0;
+
+	// Set if the journal couldn't be emptied after a new snapshot was written. The journal can't be
+	// appended to in that case, since its records would be ignored.
+	bool m_journalStale = false;
+};
@@ -0,0 +1,266 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThumbnailCache.h"
+#include "ThumbnailStore.h"
+#include <algorithm>
+
+ThumbnailCache::ThumbnailCache(size_t maxMemoryUsage, std::unique_ptr<ThumbnailStore> store) :
+	m_maxMemoryUsage(maxMemoryUsage),
+	m_store(std::move(store))
+{
+}
+
+ThumbnailCache::~ThumbnailCache() = default;
+
+void ThumbnailCache::SetStore(std::unique_ptr<ThumbnailStore> store)
+{
+	std::scoped_lock lock(m_mutex);
+	m_store = std::move(store);
+}
+
+// The store is thread-safe, so it can be used once it's been retrieved, without the mutex being
+// held.
+std::shared_ptr<ThumbnailStore> ThumbnailCache::GetStore() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_store;
+}
+
+std::shared_ptr<const ThumbnailBitmap> ThumbnailCache::GetFromMemory(std::wstring_view path,
+	uint64_t lastWriteTime, uint32_t size)
+{
+	auto key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	uint32_t foundSize;
+	return FindInMemory(key, lastWriteTime, size, false, foundSize);
+}
+
+std::shared_ptr<const ThumbnailBitmap> ThumbnailCache::Get(std::wstring_view path,
+	uint64_t lastWriteTime, uint32_t size)
+{
+	auto key = GetKey(path);
+	std::shared_ptr<const ThumbnailBitmap> largerBitmap;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		uint32_t foundSize;
+		auto bitmap = FindInMemory(key, lastWriteTime, size, true, foundSize);
+
+		if (bitmap && foundSize == size)
+		{
+			return bitmap;
+		}
+
+		largerBitmap = bitmap;
+	}
+
+	if (auto store = GetStore())
+	{
+		auto storedThumbnail = store->Read(key, lastWriteTime, size);
+
+		if (storedThumbnail && storedThumbnail->size == size)
+		{
+			return InsertInMemory(key, lastWriteTime, size, std::move(storedThumbnail->bitmap));
+		}
+
+		if (!largerBitmap && storedThumbnail)
+		{
+			largerBitmap =
+				std::make_shared<const ThumbnailBitmap>(std::move(storedThumbnail->bitmap));
+		}
+	}
+
+	if (!largerBitmap)
+	{
+		return nullptr;
+	}
+
+	// The downscaled thumbnail can be cheaply generated again, so it's only held in memory.
+	return InsertInMemory(key, lastWriteTime, size, Downscale(*largerBitmap, size));
+}
+
+std::shared_ptr<const ThumbnailBitmap> ThumbnailCache::Insert(std::wstring_view path,
+	uint64_t lastWriteTime, uint32_t size, ThumbnailBitmap bitmap)
+{
+	auto key = GetKey(path);
+
+	if (auto store = GetStore())
+	{
+		store->Write(key, lastWriteTime, size, bitmap);
+	}
+
+	return InsertInMemory(key, lastWriteTime, size, std::move(bitmap));
+}
+
+// Returns the thumbnail of the requested size or, if allowLarger is set and there's no such
+// thumbnail, the smallest thumbnail that's larger. Should be called with the mutex held.
+std::shared_ptr<const ThumbnailBitmap> ThumbnailCache::FindInMemory(const std::wstring &path,
+	uint64_t lastWriteTime, uint32_t size, bool allowLarger, uint32_t &foundSize)
+{
+	auto itr = m_entries.lower_bound({ path, lastWriteTime, size });
+
+	if (itr == m_entries.end() || itr->first.path != path
+		|| itr->first.lastWriteTime != lastWriteTime || (itr->first.size != size && !allowLarger))
+	{
+		return nullptr;
+	}
+
+	m_usage.splice(m_usage.begin(), m_usage, itr->second.usageItr);
+
+	foundSize = itr->first.size;
+	return itr->second.bitmap;
+}
+
+std::shared_ptr<const ThumbnailBitmap> ThumbnailCache::InsertInMemory(const std::wstring &path,
+	uint64_t lastWriteTime, uint32_t size, ThumbnailBitmap bitmap)
+{
+	// The key is stored in both the map and the usage list.
+	size_t memoryUsage = ((sizeof(Key) + (path.size() * sizeof(wchar_t))) * 2) + sizeof(Entry)
+		+ sizeof(ThumbnailBitmap) + (bitmap.pixels.size() * sizeof(uint32_t));
+	auto sharedBitmap = std::make_shared<const ThumbnailBitmap>(std::move(bitmap));
+
+	std::scoped_lock lock(m_mutex);
+
+	// Any existing thumbnail of the same size is replaced, while thumbnails for other versions of
+	// the item will never be requested again.
+	for (auto itr = m_entries.lower_bound({ path, 0, 0 });
+		 itr != m_entries.end() && itr->first.path == path;)
+	{
+		if (itr->first.lastWriteTime != lastWriteTime || itr->first.size == size)
+		{
+			RemoveEntry(itr++);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+
+	// A single thumbnail that's larger than the entire cache isn't worth evicting everything else
+	// for.
+	if (memoryUsage > m_maxMemoryUsage)
+	{
+		return sharedBitmap;
+	}
+
+	while (m_memoryUsage + memoryUsage > m_maxMemoryUsage)
+	{
+		RemoveEntry(m_entries.find(m_usage.back()));
+	}
+
+	Key key = { path, lastWriteTime, size };
+	m_usage.push_front(key);
+	m_entries.emplace(std::move(key), Entry{ sharedBitmap, memoryUsage, m_usage.begin() });
+	m_memoryUsage += memoryUsage;
+
+	return sharedBitmap;
+}
+
+void ThumbnailCache::RemoveEntry(EntryMap::iterator itr)
+{
+	m_memoryUsage -= itr->second.memoryUsage;
+	m_usage.erase(itr->second.usageItr);
+	m_entries.erase(itr);
+}
+
+ThumbnailBitmap ThumbnailCache::Downscale(const ThumbnailBitmap &bitmap, uint32_t size)
+{
+	uint32_t longestSide = std::max(bitmap.width, bitmap.height);
+
+	if (longestSide <= size)
+	{
+		return bitmap;
+	}
+
+	auto scaleDimension = [size, longestSide](uint32_t dimension)
+	{
+		auto scaled = (static_cast<uint64_t>(dimension) * size + (longestSide / 2)) / longestSide;
+		return std::max(static_cast<uint32_t>(scaled), 1U);
+	};
+
+	ThumbnailBitmap scaledBitmap;
+	scaledBitmap.width = scaleDimension(bitmap.width);
+	scaledBitmap.height = scaleDimension(bitmap.height);
+	scaledBitmap.pixels.resize(static_cast<size_t>(scaledBitmap.width) * scaledBitmap.height);
+
+	// Each pixel in the scaled bitmap is the average of the block of source pixels it covers.
+	// Because the alpha is premultiplied, each of the channels can be averaged independently.
+	for (uint32_t y = 0; y < scaledBitmap.height; y++)
+	{
+		auto top = static_cast<uint32_t>(static_cast<uint64_t>(y) * bitmap.height
+			/ scaledBitmap.height);
+		auto bottom = std::max(static_cast<uint32_t>(static_cast<uint64_t>(y + 1) * bitmap.height
+								   / scaledBitmap.height),
+			top + 1);
+
+		for (uint32_t x = 0; x < scaledBitmap.width; x++)
+		{
+			auto left = static_cast<uint32_t>(static_cast<uint64_t>(x) * bitmap.width
+				/ scaledBitmap.width);
+			auto right = std::max(static_cast<uint32_t>(static_cast<uint64_t>(x + 1)
+									  * bitmap.width / scaledBitmap.width),
+				left + 1);
+
+			uint64_t channelTotals[4] = {};
+
+			for (uint32_t sourceY = top; sourceY < bottom; sourceY++)
+			{
+				for (uint32_t sourceX = left; sourceX < right; sourceX++)
+				{
+					uint32_t pixel = bitmap.pixels[(sourceY * bitmap.width) + sourceX];
+
+					for (int channel = 0; channel < 4; channel++)
+					{
+						channelTotals[channel] += (pixel >> (channel * 8)) & 0xFF;
+					}
+				}
+			}
+
+			uint64_t numPixels = static_cast<uint64_t>(bottom - top) * (right - left);
+			uint32_t scaledPixel = 0;
+
+			for (int channel = 0; channel < 4; channel++)
+			{
+				auto average = (channelTotals[channel] + (numPixels / 2)) / numPixels;
+				scaledPixel |= static_cast<uint32_t>(average) << (channel * 8);
+			}
+
+			scaledBitmap.pixels[(y * scaledBitmap.width) + x] = scaledPixel;
+		}
+	}
+
+	return scaledBitmap;
+}
+
+size_t ThumbnailCache::GetNumThumbnails() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t ThumbnailCache::GetMemoryUsage() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_memoryUsage;
+}
+
+// Paths are compared case-insensitively.
+std::wstring ThumbnailCache::GetKey(std::wstring_view path)
+{
+	std::wstring key(path);
+
+	if (!key.empty())
+	{
+		LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, path.data(),
+			static_cast<int>(path.size()), key.data(), static_cast<int>(key.size()), nullptr,
+			nullptr, 0);
+	}
+
+	return key;
+}
@@ -0,0 +1,108 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThumbnailStore;
+
+// A decoded thumbnail. The pixels are stored top-down, as 32-bit BGRA values with premultiplied
+// alpha. That's the format AlphaBlend() expects, so the thumbnail can be drawn without any further
+// conversion. Premultiplied values can also be averaged directly when the thumbnail is downscaled.
+struct ThumbnailBitmap
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint32_t> pixels;
+};
+
+// Holds thumbnails that have already been extracted, so that they don't need to be extracted again
+// when a folder is revisited, or when the thumbnail size changes. Thumbnails are keyed by the path
+// of the item, its last modified time and the requested size, so an entry will never be returned
+// for an item that's been modified since its thumbnail was extracted.
+//
+// Once the estimated amount of memory used exceeds the limit, the least recently used thumbnails
+// are evicted. If a store is provided, thumbnails are also written to it, which allows them to be
+// retrieved in later sessions. Opening a store involves scanning the file it uses, so the store can
+// be provided once it's ready, with only the in-memory cache being used until then.
+//
+// This class is thread-safe.
+class ThumbnailCache : private boost::noncopyable
+{
+public:
+	ThumbnailCache(size_t maxMemoryUsage, std::unique_ptr<ThumbnailStore> store);
+	~ThumbnailCache();
+
+	// Can be called from any thread, but should only be called if no store was passed to the
+	// constructor.
+	void SetStore(std::unique_ptr<ThumbnailStore> store);
+
+	// Only checks the in-memory cache and only returns a thumbnail of exactly the requested size,
+	// which means that this is cheap enough to call from the UI thread.
+	std::shared_ptr<const ThumbnailBitmap> GetFromMemory(std::wstring_view path,
+		uint64_t lastWriteTime, uint32_t size);
+
+	// Checks the in-memory cache, then the store. If there's no thumbnail of the requested size,
+	// but there is a larger one, the larger thumbnail will be downscaled, which is significantly
+	// cheaper than extracting the thumbnail again. As this can read from disk, it shouldn't be
+	// called from the UI thread.
+	std::shared_ptr<const ThumbnailBitmap> Get(std::wstring_view path, uint64_t lastWriteTime,
+		uint32_t size);
+
+	// Adds the thumbnail to the in-memory cache and to the store. Any thumbnails for an earlier
+	// version of the item are removed from the in-memory cache.
+	std::shared_ptr<const ThumbnailBitmap> Insert(std::wstring_view path, uint64_t lastWriteTime,
+		uint32_t size, ThumbnailBitmap bitmap);
+
+	// Scales the bitmap so that its longest side is no larger than the specified size. The aspect
+	// ratio is preserved. A bitmap that's already small enough is returned unchanged.
+	static ThumbnailBitmap Downscale(const ThumbnailBitmap &bitmap, uint32_t size);
+
+	size_t GetNumThumbnails() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Key
+	{
+		std::wstring path;
+		uint64_t lastWriteTime;
+		uint32_t size;
+
+		auto operator<=>(const Key &) const = default;
+	};
+
+	struct Entry
+	{
+		std::shared_ptr<const ThumbnailBitmap> bitmap;
+		size_t memoryUsage;
+		std::list<Key>::iterator usageItr;
+	};
+
+	using EntryMap = std::map<Key, Entry>;
+
+	std::shared_ptr<const ThumbnailBitmap> FindInMemory(const std::wstring &path,
+		uint64_t lastWriteTime, uint32_t size, bool allowLarger, uint32_t &foundSize);
+	std::shared_ptr<const ThumbnailBitmap> InsertInMemory(const std::wstring &path,
+		uint64_t lastWriteTime, uint32_t size, ThumbnailBitmap bitmap);
+	void RemoveEntry(EntryMap::iterator itr);
+	std::shared_ptr<ThumbnailStore> GetStore() const;
+	static std::wstring GetKey(std::wstring_view path);
+
+	const size_t m_maxMemoryUsage;
+
+	mutable std::mutex m_mutex;
+	std::shared_ptr<ThumbnailStore> m_store;
+	EntryMap m_entries;
+	std::list<Key> m_usage;
+	size_t m_memoryUsage = 0;
+};
@@ -0,0 +1,329 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThumbnailStore.h"
+#include <algorithm>
+
+namespace
+{
+
+// The maximum length of a path, including the \\?\ prefix.
+const size_t MAX_KEY_LENGTH = 32767;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+std::unique_ptr<ThumbnailStore> ThumbnailStore::Open(const std::wstring &filePath,
+	uint64_t maxFileSize)
+{
+	if (maxFileSize < sizeof(FileHeader))
+	{
+		return nullptr;
+	}
+
+	wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	// The constructor is private, so std::make_unique can't be used here.
+	std::unique_ptr<ThumbnailStore> store(new ThumbnailStore(std::move(file), maxFileSize));
+
+	if (!store->Initialize())
+	{
+		return nullptr;
+	}
+
+	return store;
+}
+
+ThumbnailStore::ThumbnailStore(wil::unique_hfile file, uint64_t maxFileSize) :
+	m_file(std::move(file)),
+	m_maxFileSize(maxFileSize)
+{
+}
+
+ThumbnailStore::~ThumbnailStore() = default;
+
+bool ThumbnailStore::Initialize()
+{
+	LARGE_INTEGER fileSize;
+	BOOL res = GetFileSizeEx(m_file.get(), &fileSize);
+
+	if (!res)
+	{
+		return false;
+	}
+
+	auto existingSize = static_cast<uint64_t>(fileSize.QuadPart);
+
+	if (existingSize < sizeof(FileHeader) || existingSize > m_maxFileSize)
+	{
+		// The file has either just been created, or can't be used, so the store is started again
+		// from scratch.
+		if (!MapFile(std::min(GROWTH_SIZE, m_maxFileSize)))
+		{
+			return false;
+		}
+
+		Reset();
+		return true;
+	}
+
+	if (!MapFile(existingSize))
+	{
+		return false;
+	}
+
+	const auto *header = GetHeader();
+
+	if (header->signature != FILE_SIGNATURE || header->version != FILE_VERSION
+		|| header->usedSize < sizeof(FileHeader) || header->usedSize > m_mappedSize)
+	{
+		Reset();
+		return true;
+	}
+
+	LoadIndex();
+
+	return true;
+}
+
+// Note that mapping a size that's larger than the file will extend the file. The existing view
+// is only replaced once the new view has been successfully created, so a failure here leaves the
+// store usable.
+bool ThumbnailStore::MapFile(uint64_t mappedSize)
+{
+	wil::unique_handle mapping(CreateFileMapping(m_file.get(), nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(mappedSize >> 32), static_cast<DWORD>(mappedSize), nullptr));
+
+	if (!mapping)
+	{
+		return false;
+	}
+
+	wil::unique_mapview_ptr<std::byte> view(static_cast<std::byte *>(
+		MapViewOfFile(mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0)));
+
+	if (!view)
+	{
+		return false;
+	}
+
+	m_view = std::move(view);
+	m_mapping = std::move(mapping);
+	m_mappedSize = mappedSize;
+
+	return true;
+}
+
+void ThumbnailStore::Reset()
+{
+	auto *header = GetHeader();
+	header->signature = FILE_SIGNATURE;
+	header->version = FILE_VERSION;
+	header->usedSize = sizeof(FileHeader);
+
+	m_index.clear();
+	m_numThumbnails = 0;
+}
+
+void ThumbnailStore::LoadIndex()
+{
+	auto *header = GetHeader();
+	uint64_t offset = sizeof(FileHeader);
+
+	while (offset < header->usedSize)
+	{
+		RecordHeader record;
+		bool valid = (offset + sizeof(record)) <= header->usedSize;
+
+		if (valid)
+		{
+			memcpy(&record, m_view.get() + offset, sizeof(record));
+
+			valid = record.keyLength > 0 && record.keyLength <= MAX_KEY_LENGTH
+				&& record.width > 0 && record.width <= MAX_DIMENSION && record.height > 0
+				&& record.height <= MAX_DIMENSION
+				&& record.recordSize
+					== GetRecordSize(record.keyLength, record.width, record.height)
+				&& (offset + record.recordSize) <= header->usedSize;
+		}
+
+		if (!valid)
+		{
+			// A record can only be invalid if the file has been damaged. The remaining records
+			// can't be located, so they're discarded.
+			header->usedSize = offset;
+			break;
+		}
+
+		std::wstring key(record.keyLength, '\0');
+		memcpy(key.data(), m_view.get() + offset + sizeof(record),
+			record.keyLength * sizeof(wchar_t));
+
+		AddToIndex(key, { record.lastWriteTime, record.size, offset });
+
+		offset += record.recordSize;
+	}
+}
+
+void ThumbnailStore::AddToIndex(const std::wstring &key, const IndexEntry &entry)
+{
+	auto &entries = m_index[key];
+
+	// Thumbnails for other versions of the item will never be requested again.
+	if (!entries.empty() && entries[0].lastWriteTime != entry.lastWriteTime)
+	{
+		m_numThumbnails -= entries.size();
+		entries.clear();
+	}
+
+	auto itr = std::find_if(entries.begin(), entries.end(),
+		[&entry](const IndexEntry &existingEntry) { return existingEntry.size == entry.size; });
+
+	if (itr != entries.end())
+	{
+		*itr = entry;
+		return;
+	}
+
+	entries.push_back(entry);
+	m_numThumbnails++;
+}
+
+std::optional<ThumbnailStore::StoredThumbnail> ThumbnailStore::Read(const std::wstring &key,
+	uint64_t lastWriteTime, uint32_t minSize)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_index.find(key);
+
+	if (itr == m_index.end())
+	{
+		return std::nullopt;
+	}
+
+	const IndexEntry *closestEntry = nullptr;
+
+	for (const auto &entry : itr->second)
+	{
+		if (entry.lastWriteTime == lastWriteTime && entry.size >= minSize
+			&& (!closestEntry || entry.size < closestEntry->size))
+		{
+			closestEntry = &entry;
+		}
+	}
+
+	if (!closestEntry)
+	{
+		return std::nullopt;
+	}
+
+	const std::byte *recordStart = m_view.get() + closestEntry->offset;
+
+	RecordHeader record;
+	memcpy(&record, recordStart, sizeof(record));
+
+	StoredThumbnail thumbnail;
+	thumbnail.size = record.size;
+	thumbnail.bitmap.width = record.width;
+	thumbnail.bitmap.height = record.height;
+	thumbnail.bitmap.pixels.resize(static_cast<size_t>(record.width) * record.height);
+
+	const std::byte *pixelsStart =
+		recordStart + sizeof(record) + AlignUp(record.keyLength * sizeof(wchar_t), 4);
+	memcpy(thumbnail.bitmap.pixels.data(), pixelsStart,
+		thumbnail.bitmap.pixels.size() * sizeof(uint32_t));
+
+	return thumbnail;
+}
+
+bool ThumbnailStore::Write(const std::wstring &key, uint64_t lastWriteTime, uint32_t size,
+	const ThumbnailBitmap &bitmap)
+{
+	if (key.empty() || key.size() > MAX_KEY_LENGTH || bitmap.width == 0
+		|| bitmap.width > MAX_DIMENSION || bitmap.height == 0 || bitmap.height > MAX_DIMENSION
+		|| bitmap.pixels.size() != static_cast<size_t>(bitmap.width) * bitmap.height)
+	{
+		return false;
+	}
+
+	uint64_t recordSize = GetRecordSize(key.size(), bitmap.width, bitmap.height);
+
+	if ((sizeof(FileHeader) + recordSize) > m_maxFileSize)
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	if ((GetHeader()->usedSize + recordSize) > m_maxFileSize)
+	{
+		Reset();
+	}
+
+	uint64_t offset = GetHeader()->usedSize;
+
+	if ((offset + recordSize) > m_mappedSize)
+	{
+		uint64_t newSize =
+			std::min(std::max(m_mappedSize + GROWTH_SIZE, offset + recordSize), m_maxFileSize);
+
+		if (!MapFile(newSize))
+		{
+			return false;
+		}
+	}
+
+	RecordHeader record = {};
+	record.recordSize = static_cast<uint32_t>(recordSize);
+	record.keyLength = static_cast<uint32_t>(key.size());
+	record.lastWriteTime = lastWriteTime;
+	record.size = size;
+	record.width = bitmap.width;
+	record.height = bitmap.height;
+
+	uint64_t keySize = key.size() * sizeof(wchar_t);
+	uint64_t alignedKeySize = AlignUp(keySize, 4);
+
+	std::byte *recordStart = m_view.get() + offset;
+	memcpy(recordStart, &record, sizeof(record));
+	memcpy(recordStart + sizeof(record), key.data(), keySize);
+	memset(recordStart + sizeof(record) + keySize, 0, alignedKeySize - keySize);
+	memcpy(recordStart + sizeof(record) + alignedKeySize, bitmap.pixels.data(),
+		bitmap.pixels.size() * sizeof(uint32_t));
+
+	// The record is only made visible once it's been completely written.
+	GetHeader()->usedSize = offset + recordSize;
+
+	AddToIndex(key, { lastWriteTime, size, offset });
+
+	return true;
+}
+
+size_t ThumbnailStore::GetNumThumbnails() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_numThumbnails;
+}
+
+ThumbnailStore::FileHeader *ThumbnailStore::GetHeader()
+{
+	return reinterpret_cast<FileHeader *>(m_view.get());
+}
+
+uint64_t ThumbnailStore::GetRecordSize(size_t keyLength, uint32_t width, uint32_t height)
+{
+	return sizeof(RecordHeader) + AlignUp(keyLength * sizeof(wchar_t), 4)
+		+ (static_cast<uint64_t>(width) * height * sizeof(uint32_t));
+}
@@ -0,0 +1,117 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ThumbnailCache.h"
+#include <boost/core/noncopyable.hpp>
+#include <wil/resource.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persists thumbnails to a file, so that they can be reused in later sessions. The file is
+// memory-mapped, which means that reading a thumbnail is only a copy out of the mapped view.
+//
+// Thumbnails are appended to the file, along with the key they were stored under. When the store
+// is opened, the records are scanned to rebuild the index. Once the file reaches its maximum size,
+// the store is cleared and filled again from scratch, which avoids having to compact the file.
+//
+// The file is opened exclusively, so only a single process can use the store at once. This class
+// is thread-safe.
+class ThumbnailStore : private boost::noncopyable
+{
+public:
+	struct StoredThumbnail
+	{
+		uint32_t size;
+		ThumbnailBitmap bitmap;
+	};
+
+	// Opens the store, creating the file if necessary. Returns null if the file can't be opened
+	// (e.g. because it's in use by another process).
+	static std::unique_ptr<ThumbnailStore> Open(const std::wstring &filePath,
+		uint64_t maxFileSize);
+
+	~ThumbnailStore();
+
+	// Returns the thumbnail with the smallest size that's at least as large as the requested size.
+	// The key is compared exactly, so any normalization should be done by the caller.
+	std::optional<StoredThumbnail> Read(const std::wstring &key, uint64_t lastWriteTime,
+		uint32_t minSize);
+
+	bool Write(const std::wstring &key, uint64_t lastWriteTime, uint32_t size,
+		const ThumbnailBitmap &bitmap);
+
+	size_t GetNumThumbnails() const;
+
+private:
+	static constexpr uint32_t FILE_SIGNATURE = 0x43485458; // "XTHC"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	// The file is extended in chunks of this size, so that it doesn't need to be remapped each
+	// time a thumbnail is written.
+	static constexpr uint64_t GROWTH_SIZE = 4 * 1024 * 1024;
+
+	// Thumbnails are never this large, so a record that claims to be must be corrupt.
+	static constexpr uint32_t MAX_DIMENSION = 4096;
+
+#pragma pack(push, 1)
+	struct FileHeader
+	{
+		uint32_t signature;
+		uint32_t version;
+
+		// The number of bytes (including this header) that contain valid records. This is only
+		// updated once a record has been completely written.
+		uint64_t usedSize;
+	};
+
+	struct RecordHeader
+	{
+		uint32_t recordSize;
+		uint32_t keyLength;
+		uint64_t lastWriteTime;
+		uint32_t size;
+		uint32_t width;
+		uint32_t height;
+		uint32_t reserved;
+	};
+#pragma pack(pop)
+
+	struct IndexEntry
+	{
+		uint64_t lastWriteTime;
+		uint32_t size;
+		uint64_t offset;
+	};
+
+	ThumbnailStore(wil::unique_hfile file, uint64_t maxFileSize);
+
+	bool Initialize();
+	bool MapFile(uint64_t mappedSize);
+	void Reset();
+	void LoadIndex();
+	void AddToIndex(const std::wstring &key, const IndexEntry &entry);
+	FileHeader *GetHeader();
+	static uint64_t GetRecordSize(size_t keyLength, uint32_t width, uint32_t height);
+
+	const wil::unique_hfile m_file;
+	const uint64_t m_maxFileSize;
+
+	mutable std::mutex m_mutex;
+	wil::unique_handle m_mapping;
+	wil::unique_mapview_ptr<std::byte> m_view;
+	uint64_t m_mappedSize = 0;
+
+	// Maps each key to the thumbnails stored for it. Only thumbnails for the most recently written
+	// version of the item are retained.
+	std::unordered_map<std::wstring, std::vector<IndexEntry>> m_index;
+	size_t m_numThumbnails = 0;
+};
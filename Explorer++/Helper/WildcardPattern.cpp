@@ -0,0 +1,356 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WildcardPattern.h"
+#include <algorithm>
+#include <array>
+#include <memory>
+
+namespace
+{
+
+using LowercaseTable = std::array<wchar_t, 0x10000>;
+
+// CheckWildcardMatch() converts each character to lowercase individually, using LCMapString().
+// Building a table containing the result for every character means that the same conversion can be
+// performed here with a simple lookup.
+std::unique_ptr<LowercaseTable> BuildLowercaseTable()
+{
+	auto table = std::make_unique<LowercaseTable>();
+
+	for (size_t i = 0; i < table->size(); i++)
+	{
+		auto character = static_cast<wchar_t>(i);
+		wchar_t lowercaseCharacter;
+		int res = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, &character, 1,
+			&lowercaseCharacter, 1);
+		(*table)[i] = (res == 1) ? lowercaseCharacter : character;
+	}
+
+	return table;
+}
+
+wchar_t ToLowercase(wchar_t character)
+{
+	static const auto table = BuildLowercaseTable();
+	return (*table)[character];
+}
+
+}
+
+WildcardPattern::WildcardPattern(std::wstring_view pattern, bool caseSensitive) :
+	m_pattern(pattern),
+	m_caseSensitive(caseSensitive)
+{
+	if (pattern.find(':') == std::wstring_view::npos)
+	{
+		m_subPatterns.push_back(ParseSubPattern(pattern, caseSensitive));
+		return;
+	}
+
+	// Matches the behavior of CheckWildcardMatch(). Empty patterns are skipped, while blanks
+	// surrounding each pattern are removed.
+	size_t start = 0;
+
+	while (start <= pattern.size())
+	{
+		size_t end = pattern.find(':', start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = pattern.size();
+		}
+
+		auto subPattern = pattern.substr(start, end - start);
+		start = end + 1;
+
+		if (subPattern.empty())
+		{
+			continue;
+		}
+
+		auto first = subPattern.find_first_not_of(' ');
+		auto last = subPattern.find_last_not_of(' ');
+		subPattern = (first == std::wstring_view::npos)
+			? std::wstring_view()
+			: subPattern.substr(first, last - first + 1);
+
+		m_subPatterns.push_back(ParseSubPattern(subPattern, caseSensitive));
+	}
+}
+
+WildcardPattern::SubPattern WildcardPattern::ParseSubPattern(std::wstring_view subPattern,
+	bool caseSensitive)
+{
+	SubPattern parsedSubPattern;
+	size_t start = 0;
+
+	while (true)
+	{
+		size_t end = subPattern.find('*', start);
+		auto segment = subPattern.substr(start,
+			(end == std::wstring_view::npos) ? std::wstring_view::npos : end - start);
+
+		std::wstring parsedSegment(segment);
+
+		if (!caseSensitive)
+		{
+			for (auto &character : parsedSegment)
+			{
+				character = ToLowercase(character);
+			}
+		}
+
+		parsedSubPattern.minLength += parsedSegment.size();
+		parsedSubPattern.segments.push_back(std::move(parsedSegment));
+
+		if (end == std::wstring_view::npos)
+		{
+			break;
+		}
+
+		start = end + 1;
+	}
+
+	return parsedSubPattern;
+}
+
+bool WildcardPattern::Matches(std::wstring_view text) const
+{
+	for (const auto &subPattern : m_subPatterns)
+	{
+		if (MatchesSubPattern(subPattern, text))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool WildcardPattern::MatchesSubPattern(const SubPattern &subPattern, std::wstring_view text) const
+{
+	const auto &segments = subPattern.segments;
+
+	if (segments.size() == 1)
+	{
+		return text.size() == segments[0].size() && SegmentMatchesAt(segments[0], text, 0);
+	}
+
+	if (text.size() < subPattern.minLength)
+	{
+		return false;
+	}
+
+	// The first and last segments are anchored, so can be checked directly. Since the text is at
+	// least as long as all the segments combined, the two segments won't overlap.
+	const auto &firstSegment = segments.front();
+	const auto &lastSegment = segments.back();
+	size_t lastSegmentPosition = text.size() - lastSegment.size();
+
+	if (!SegmentMatchesAt(firstSegment, text, 0)
+		|| !SegmentMatchesAt(lastSegment, text, lastSegmentPosition))
+	{
+		return false;
+	}
+
+	// Each of the remaining segments is preceded by a '*', so can appear anywhere after the
+	// previous segment. Matching each segment at the earliest possible position leaves the most
+	// room for the segments that follow, so no backtracking is needed.
+	size_t position = firstSegment.size();
+
+	for (size_t i = 1; i < segments.size() - 1; i++)
+	{
+		const auto &segment = segments[i];
+		bool found = false;
+
+		while (position + segment.size() <= lastSegmentPosition)
+		{
+			if (SegmentMatchesAt(segment, text, position))
+			{
+				found = true;
+				break;
+			}
+
+			position++;
+		}
+
+		if (!found)
+		{
+			return false;
+		}
+
+		position += segment.size();
+	}
+
+	return true;
+}
+
+bool WildcardPattern::SegmentMatchesAt(std::wstring_view segment, std::wstring_view text,
+	size_t position) const
+{
+	for (size_t i = 0; i < segment.size(); i++)
+	{
+		wchar_t patternCharacter = segment[i];
+
+		if (patternCharacter == '?')
+		{
+			continue;
+		}
+
+		wchar_t textCharacter = text[position + i];
+
+		if (!m_caseSensitive)
+		{
+			textCharacter = ToLowercase(textCharacter);
+		}
+
+		if (patternCharacter != textCharacter)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool WildcardPattern::IsRefinementOf(const WildcardPattern &other) const
+{
+	if (m_caseSensitive != other.m_caseSensitive)
+	{
+		return false;
+	}
+
+	// Each sub-pattern here needs to be covered by at least one of the other sub-patterns.
+	return std::ranges::all_of(m_subPatterns,
+		[&other](const SubPattern &subPattern)
+		{
+			return std::ranges::any_of(other.m_subPatterns,
+				[&subPattern](const SubPattern &otherSubPattern)
+				{ return IsSubPatternRefinementOf(subPattern, otherSubPattern); });
+		});
+}
+
+// This follows the same structure as MatchesSubPattern(), except that the other sub-pattern is
+// matched against the segments of this sub-pattern, rather than against a piece of text. Any text
+// matching this sub-pattern contains each of its segments, so if the other sub-pattern's segments
+// can be placed within them, the text will also match the other sub-pattern.
+bool WildcardPattern::IsSubPatternRefinementOf(const SubPattern &subPattern,
+	const SubPattern &otherSubPattern)
+{
+	const auto &segments = subPattern.segments;
+	const auto &otherSegments = otherSubPattern.segments;
+
+	if (otherSegments.size() == 1)
+	{
+		return segments.size() == 1 && segments[0].size() == otherSegments[0].size()
+			&& SegmentCoversAt(segments[0], otherSegments[0], 0);
+	}
+
+	const auto &firstSegment = segments.front();
+	const auto &lastSegment = segments.back();
+	const auto &otherFirstSegment = otherSegments.front();
+	const auto &otherLastSegment = otherSegments.back();
+
+	if (firstSegment.size() < otherFirstSegment.size()
+		|| lastSegment.size() < otherLastSegment.size())
+	{
+		return false;
+	}
+
+	// If there's only a single segment here, the anchored segments from the other sub-pattern both
+	// have to fit within it, without overlapping.
+	if (segments.size() == 1 && firstSegment.size() < otherSubPattern.minLength)
+	{
+		return false;
+	}
+
+	size_t lastSegmentPosition = lastSegment.size() - otherLastSegment.size();
+
+	if (!SegmentCoversAt(firstSegment, otherFirstSegment, 0)
+		|| !SegmentCoversAt(lastSegment, otherLastSegment, lastSegmentPosition))
+	{
+		return false;
+	}
+
+	// The remaining segments from the other sub-pattern are placed at the earliest possible
+	// position, in order, with each one falling entirely within a single segment here.
+	size_t segmentIndex = 0;
+	size_t position = otherFirstSegment.size();
+
+	for (size_t i = 1; i < otherSegments.size() - 1; i++)
+	{
+		const auto &otherSegment = otherSegments[i];
+		bool found = false;
+
+		while (!found && segmentIndex < segments.size())
+		{
+			const auto &segment = segments[segmentIndex];
+			size_t end =
+				(segmentIndex == segments.size() - 1) ? lastSegmentPosition : segment.size();
+
+			while (position + otherSegment.size() <= end)
+			{
+				if (SegmentCoversAt(segment, otherSegment, position))
+				{
+					found = true;
+					break;
+				}
+
+				position++;
+			}
+
+			if (!found)
+			{
+				segmentIndex++;
+				position = 0;
+			}
+		}
+
+		if (!found)
+		{
+			return false;
+		}
+
+		position += otherSegment.size();
+	}
+
+	return true;
+}
+
+// Returns true if any text matched by the segment (at the specified position) is also matched by
+// the other segment. A '?' in the other segment covers any character, while a '?' in the segment
+// itself can only be covered by another '?'. Both segments are expected to have already been
+// converted to lowercase, if necessary.
+bool WildcardPattern::SegmentCoversAt(std::wstring_view segment, std::wstring_view otherSegment,
+	size_t position)
+{
+	for (size_t i = 0; i < otherSegment.size(); i++)
+	{
+		wchar_t otherCharacter = otherSegment[i];
+
+		if (otherCharacter == '?')
+		{
+			continue;
+		}
+
+		if (segment[position + i] != otherCharacter)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const std::wstring &WildcardPattern::GetPattern() const
+{
+	return m_pattern;
+}
+
+bool WildcardPattern::IsCaseSensitive() const
+{
+	return m_caseSensitive;
+}
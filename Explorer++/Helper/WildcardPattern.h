@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A wildcard pattern that's parsed once, up front, so that it can be cheaply matched against a
+// large number of strings. Patterns use the same format as CheckWildcardMatch(): '*' matches any
+// sequence of characters, '?' matches any single character and multiple patterns can be provided
+// by separating them with ':' (e.g. "*.h: *.cpp").
+class WildcardPattern
+{
+public:
+	WildcardPattern(std::wstring_view pattern, bool caseSensitive);
+
+	bool Matches(std::wstring_view text) const;
+
+	// Returns true if every string that matches this pattern is guaranteed to also match the other
+	// pattern (e.g. "*.tx*" is a refinement of "*.t*"). This is conservative, so false may be
+	// returned in cases where this pattern is in fact a refinement. Patterns are only considered
+	// if they have the same case sensitivity.
+	bool IsRefinementOf(const WildcardPattern &other) const;
+
+	const std::wstring &GetPattern() const;
+	bool IsCaseSensitive() const;
+
+private:
+	// A single pattern (i.e. one of the patterns separated by ':'), split at each '*'. The first
+	// segment has to match at the start of the text and the last segment has to match at the end.
+	// Any segments in between can match anywhere, in order. If a pattern doesn't contain a '*', it
+	// will consist of a single segment that has to match the entire text.
+	struct SubPattern
+	{
+		std::vector<std::wstring> segments;
+		size_t minLength = 0;
+	};
+
+	static SubPattern ParseSubPattern(std::wstring_view subPattern, bool caseSensitive);
+	bool MatchesSubPattern(const SubPattern &subPattern, std::wstring_view text) const;
+	bool SegmentMatchesAt(std::wstring_view segment, std::wstring_view text, size_t position) const;
+	static bool IsSubPatternRefinementOf(const SubPattern &subPattern,
+		const SubPattern &otherSubPattern);
+	static bool SegmentCoversAt(std::wstring_view segment, std::wstring_view otherSegment,
+		size_t position);
+
+	std::wstring m_pattern;
+	bool m_caseSensitive;
+	std::vector<SubPattern> m_subPatterns;
+};
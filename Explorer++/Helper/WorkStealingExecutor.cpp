@@ -0,0 +1,274 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WorkStealingExecutor.h"
+#include <algorithm>
+
+namespace
+{
+
+// Allows a task submitted from a worker thread to be placed on that worker's own deque.
+thread_local const WorkStealingExecutor *g_currentExecutor = nullptr;
+thread_local int g_currentWorkerIndex = -1;
+
+}
+
+WorkStealingExecutor::TaskGroup::TaskGroup(WorkStealingExecutor *executor) :
+	m_executor(executor),
+	m_state(std::make_shared<GroupState>())
+{
+}
+
+WorkStealingExecutor::TaskGroup::~TaskGroup()
+{
+	Cancel();
+	WaitForRunningTasks();
+}
+
+void WorkStealingExecutor::TaskGroup::Cancel()
+{
+	// Cancelled tasks remain in the queues (holding a reference to the group state) and are
+	// discarded once a worker reaches them.
+	std::scoped_lock lock(m_state->mutex);
+	m_state->generation++;
+}
+
+void WorkStealingExecutor::TaskGroup::WaitForRunningTasks()
+{
+	std::unique_lock lock(m_state->mutex);
+	m_state->taskFinishedCondition.wait(lock, [this]() { return m_state->numRunningTasks == 0; });
+}
+
+WorkStealingExecutor::WorkStealingExecutor(int numThreads, std::function<void()> apartmentInit,
+	std::function<void()> apartmentUninit) :
+	m_apartmentInit(apartmentInit),
+	m_apartmentUninit(apartmentUninit)
+{
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	// The workers all need to exist before any of the threads start, since each thread can steal
+	// from any of the other workers.
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&WorkStealingExecutor::WorkerThread, this, i);
+	}
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+	{
+		std::scoped_lock lock(m_idleMutex);
+		m_stop = true;
+	}
+
+	m_taskAvailableCondition.notify_all();
+
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+int WorkStealingExecutor::GetNumThreads() const
+{
+	return static_cast<int>(m_threads.size());
+}
+
+void WorkStealingExecutor::ParallelFor(size_t count,
+	const std::function<void(size_t index)> &function)
+{
+	std::atomic<size_t> nextIndex = 0;
+
+	auto runRemaining = [&nextIndex, count, &function]()
+	{
+		size_t index;
+
+		while ((index = nextIndex++) < count)
+		{
+			function(index);
+		}
+	};
+
+	// Destroying the group will cancel any helpers that haven't started by the time the calling
+	// thread has run out of work, as well as waiting for any that are still running.
+	TaskGroup group(this);
+	size_t numHelpers =
+		(count > 0) ? std::min(count - 1, static_cast<size_t>(GetNumThreads())) : 0;
+
+	for (size_t i = 0; i < numHelpers; i++)
+	{
+		group.Submit(runRemaining);
+	}
+
+	runRemaining();
+}
+
+void WorkStealingExecutor::SubmitTask(const std::shared_ptr<GroupState> &group,
+	std::function<void()> function, Apartment apartment)
+{
+	Task task;
+	task.group = group;
+	task.apartment = apartment;
+	task.function = std::move(function);
+
+	{
+		std::scoped_lock lock(group->mutex);
+		task.generation = group->generation;
+	}
+
+	if (g_currentExecutor == this)
+	{
+		auto &worker = *m_workers[g_currentWorkerIndex];
+		std::scoped_lock lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	else
+	{
+		std::scoped_lock lock(m_sharedQueueMutex);
+		m_sharedQueue.push_back(std::move(task));
+	}
+
+	{
+		std::scoped_lock lock(m_idleMutex);
+		m_numQueuedTasks++;
+	}
+
+	m_taskAvailableCondition.notify_one();
+}
+
+void WorkStealingExecutor::WorkerThread(int workerIndex)
+{
+	g_currentExecutor = this;
+	g_currentWorkerIndex = workerIndex;
+
+	auto &worker = *m_workers[workerIndex];
+
+	while (true)
+	{
+		Task task;
+
+		if (TryGetTask(workerIndex, task))
+		{
+			RunTask(worker, task);
+			continue;
+		}
+
+		std::unique_lock lock(m_idleMutex);
+		m_taskAvailableCondition.wait(lock, [this]() { return m_stop || m_numQueuedTasks > 0; });
+
+		if (m_stop)
+		{
+			break;
+		}
+	}
+
+	if (worker.apartmentInitialized && m_apartmentUninit)
+	{
+		m_apartmentUninit();
+	}
+}
+
+bool WorkStealingExecutor::TryGetTask(int workerIndex, Task &task)
+{
+	auto takeTask = [this, &task](std::deque<Task> &tasks, bool fromBack)
+	{
+		if (tasks.empty())
+		{
+			return false;
+		}
+
+		if (fromBack)
+		{
+			task = std::move(tasks.back());
+			tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		m_numQueuedTasks--;
+		return true;
+	};
+
+	{
+		auto &worker = *m_workers[workerIndex];
+		std::scoped_lock lock(worker.mutex);
+
+		if (takeTask(worker.tasks, true))
+		{
+			return true;
+		}
+	}
+
+	{
+		std::scoped_lock lock(m_sharedQueueMutex);
+
+		if (takeTask(m_sharedQueue, false))
+		{
+			return true;
+		}
+	}
+
+	int numWorkers = static_cast<int>(m_workers.size());
+
+	for (int i = 1; i < numWorkers; i++)
+	{
+		auto &victim = *m_workers[(workerIndex + i) % numWorkers];
+		std::scoped_lock lock(victim.mutex);
+
+		if (takeTask(victim.tasks, false))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void WorkStealingExecutor::RunTask(Worker &worker, Task &task)
+{
+	auto &group = *task.group;
+
+	{
+		std::scoped_lock lock(group.mutex);
+
+		if (task.generation != group.generation)
+		{
+			// The group was cancelled after this task was submitted.
+			return;
+		}
+
+		group.numRunningTasks++;
+	}
+
+	if (task.apartment == Apartment::Required && !worker.apartmentInitialized)
+	{
+		if (m_apartmentInit)
+		{
+			m_apartmentInit();
+		}
+
+		worker.apartmentInitialized = true;
+	}
+
+	task.function();
+
+	// The function may hold references to objects that are only valid while the task is running
+	// (e.g. captured as part of a lambda), so it's destroyed before the task is marked as
+	// finished.
+	task.function = nullptr;
+
+	{
+		std::scoped_lock lock(group.mutex);
+		group.numRunningTasks--;
+	}
+
+	group.taskFinishedCondition.notify_all();
+}
@@ -0,0 +1,150 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/core/noncopyable.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A pool of worker threads that's intended to be shared by the entire process, so that individual
+// components (e.g. each tab) don't need to own threads of their own.
+//
+// Each worker has its own deque of tasks. Tasks submitted from within a worker (e.g. a directory
+// search task queuing a task for each subdirectory it finds) are pushed onto that worker's deque
+// and run most-recent-first, which keeps related work on the same thread. Tasks submitted from any
+// other thread are placed in a shared queue and run in the order they were submitted. A worker
+// that runs out of work of its own takes tasks from the shared queue, then steals the oldest tasks
+// from the other workers.
+class WorkStealingExecutor : private boost::noncopyable
+{
+private:
+	struct GroupState;
+
+public:
+	// Indicates whether a task needs the apartment initialization hook to have been run on the
+	// worker thread before the task starts (e.g. because the task uses COM).
+	enum class Apartment
+	{
+		NotRequired,
+		Required
+	};
+
+	// Tasks are always submitted as part of a group, which allows tasks to be cancelled together.
+	// Destroying a group cancels any of its tasks that haven't started yet and waits for any that
+	// are running to finish. A group should therefore be declared after anything its tasks
+	// reference, so that it's destroyed first. Note that a group shouldn't be cancelled and waited
+	// on from within one of its own tasks.
+	class TaskGroup : private boost::noncopyable
+	{
+	public:
+		explicit TaskGroup(WorkStealingExecutor *executor);
+		~TaskGroup();
+
+		template <typename F>
+		std::future<std::invoke_result_t<F>> Submit(F &&f,
+			Apartment apartment = Apartment::NotRequired)
+		{
+			// std::function requires the callable to be copyable, which isn't the case for
+			// std::packaged_task. Note that if the task is cancelled, the packaged task will be
+			// destroyed without being run, in which case the future will hold a
+			// std::future_error.
+			auto packagedTask =
+				std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+					std::forward<F>(f));
+			auto future = packagedTask->get_future();
+
+			m_executor->SubmitTask(m_state, [packagedTask]() { (*packagedTask)(); }, apartment);
+
+			return future;
+		}
+
+		// Tasks that have been submitted, but haven't started yet, won't be run. Tasks submitted
+		// after this call are unaffected.
+		void Cancel();
+
+		// Waits for any tasks in this group that are currently running to finish.
+		void WaitForRunningTasks();
+
+	private:
+		WorkStealingExecutor *const m_executor;
+		const std::shared_ptr<GroupState> m_state;
+	};
+
+	// The apartment hooks are run on a worker the first time it runs a task that requires an
+	// apartment and when the worker exits, respectively.
+	WorkStealingExecutor(int numThreads, std::function<void()> apartmentInit = nullptr,
+		std::function<void()> apartmentUninit = nullptr);
+
+	// Any tasks that are still queued are discarded. All task groups should have been destroyed
+	// before this is called.
+	~WorkStealingExecutor();
+
+	int GetNumThreads() const;
+
+	// Calls the function once for each index in [0, count), spreading the calls across the calling
+	// thread and any idle workers. Because the calling thread also takes part, this will finish even
+	// if every worker is busy. The function may be called from several threads at once. Returns
+	// once all the calls have completed.
+	void ParallelFor(size_t count, const std::function<void(size_t index)> &function);
+
+private:
+	struct GroupState
+	{
+		std::mutex mutex;
+		std::condition_variable taskFinishedCondition;
+
+		// Incremented each time the group is cancelled. A task only runs if the generation it was
+		// submitted in is still current.
+		uint64_t generation = 0;
+
+		int numRunningTasks = 0;
+	};
+
+	struct Task
+	{
+		std::shared_ptr<GroupState> group;
+		uint64_t generation;
+		Apartment apartment;
+		std::function<void()> function;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		bool apartmentInitialized = false;
+	};
+
+	void SubmitTask(const std::shared_ptr<GroupState> &group, std::function<void()> function,
+		Apartment apartment);
+	void WorkerThread(int workerIndex);
+	bool TryGetTask(int workerIndex, Task &task);
+	void RunTask(Worker &worker, Task &task);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	std::mutex m_sharedQueueMutex;
+	std::deque<Task> m_sharedQueue;
+
+	// Idle workers wait on this condition. The count covers the tasks in every queue.
+	std::mutex m_idleMutex;
+	std::condition_variable m_taskAvailableCondition;
+	std::atomic<int> m_numQueuedTasks = 0;
+	bool m_stop = false;
+
+	const std::function<void()> m_apartmentInit;
+	const std::function<void()> m_apartmentUninit;
+
+	std::vector<std::thread> m_threads;
+};
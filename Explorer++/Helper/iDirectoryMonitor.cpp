@@ -365,6 +365,31 @@ void CALLBACK DirectoryMonitor::CompletionRoutine(DWORD dwErrorCode, DWORD Numbe
 		Remove its entry from the queue. */
 		DeleteRequest((ULONG_PTR) pDirInfo);
 	}
+	else if (dwErrorCode == ERROR_SUCCESS || dwErrorCode == ERROR_NOTIFY_ENUM_DIR)
+	{
+		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
+
+		/* The changes didn't fit in the buffer, so they've
+		been discarded. The client needs to be told, since
+		it will otherwise be left out of date. */
+		pDirInfo->m_OnDirectoryAltered(_T(""), DIRECTORY_MONITOR_ACTION_OVERFLOW,
+			pDirInfo->m_pData);
+
+		free(pDirInfo->m_FileNotifyBuffer);
+
+		pDirInfo->m_FileNotifyBuffer = nullptr;
+
+		WatchDirectoryInternal((ULONG_PTR) pDirInfo);
+	}
+	else
+	{
+		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
+
+		/* The directory can no longer be watched (e.g.
+		because it has been removed). */
+		pDirInfo->m_OnDirectoryAltered(_T(""), DIRECTORY_MONITOR_ACTION_STOPPED,
+			pDirInfo->m_pData);
+	}
 }
 
 void DirectoryMonitor::DeleteRequest(ULONG_PTR dwParam)
@@ -9,6 +9,17 @@
 
 typedef void (*OnDirectoryAltered)(const TCHAR *szFileName, DWORD dwAction, void *pData);
 
+// In addition to the FILE_ACTION_* values, the callback can be passed one of the actions below. In
+// both cases, the file name will be empty.
+
+// Changes were made that couldn't be reported (e.g. because the notification buffer overflowed).
+// The directory continues to be watched.
+inline constexpr DWORD DIRECTORY_MONITOR_ACTION_OVERFLOW = 0x10000;
+
+// The directory can no longer be watched (e.g. because it was removed). No further notifications
+// will be sent.
+inline constexpr DWORD DIRECTORY_MONITOR_ACTION_STOPPED = 0x10001;
+
 /* Main exported interface. */
 __interface IDirectoryMonitor : IUnknown
 {
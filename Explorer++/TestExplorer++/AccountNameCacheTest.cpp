@@ -0,0 +1,157 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/AccountNameCache.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+// Builds a SID of the form S-1-5-<rid>.
+std::vector<BYTE> BuildSid(DWORD rid)
+{
+	std::vector<BYTE> sid = { SID_REVISION, 1, 0, 0, 0, 0, 0, 5 };
+	const auto *ridBytes = reinterpret_cast<const BYTE *>(&rid);
+	sid.insert(sid.end(), ridBytes, ridBytes + sizeof(rid));
+	return sid;
+}
+
+DWORD GetRid(PSID sid)
+{
+	DWORD rid;
+	memcpy(&rid, static_cast<const BYTE *>(sid) + 8, sizeof(rid));
+	return rid;
+}
+
+}
+
+class AccountNameCacheTest : public testing::Test
+{
+protected:
+	AccountNameCacheTest() :
+		m_cache(
+			[this](const std::vector<PSID> &sids)
+			{
+				m_numLookups++;
+				m_numSidsLookedUp += static_cast<int>(sids.size());
+
+				std::vector<std::optional<std::wstring>> accountNames;
+
+				for (auto sid : sids)
+				{
+					auto itr = m_accountNames.find(GetRid(sid));
+
+					if (itr == m_accountNames.end())
+					{
+						accountNames.push_back(std::nullopt);
+					}
+					else
+					{
+						accountNames.push_back(itr->second);
+					}
+				}
+
+				return accountNames;
+			},
+			[this] { return m_now; })
+	{
+	}
+
+	AccountNameCache m_cache;
+	std::unordered_map<DWORD, std::wstring> m_accountNames;
+	std::chrono::steady_clock::time_point m_now;
+	int m_numLookups = 0;
+	int m_numSidsLookedUp = 0;
+};
+
+TEST_F(AccountNameCacheTest, Cached)
+{
+	m_accountNames[1000] = L"DOMAIN\\user";
+	auto sid = BuildSid(1000);
+
+	EXPECT_EQ(m_cache.GetAccountName(sid.data()), L"DOMAIN\\user");
+	EXPECT_EQ(m_cache.GetAccountName(sid.data()), L"DOMAIN\\user");
+
+	// A separate copy of the same SID should also be found.
+	auto sidCopy = BuildSid(1000);
+	EXPECT_EQ(m_cache.GetAccountName(sidCopy.data()), L"DOMAIN\\user");
+
+	EXPECT_EQ(m_numLookups, 1);
+
+	auto stats = m_cache.GetStats();
+	EXPECT_EQ(stats.hits, 2U);
+	EXPECT_EQ(stats.misses, 1U);
+}
+
+TEST_F(AccountNameCacheTest, Unresolved)
+{
+	auto sid = BuildSid(1000);
+
+	EXPECT_EQ(m_cache.GetAccountName(sid.data()), std::nullopt);
+	EXPECT_EQ(m_cache.GetAccountName(sid.data()), std::nullopt);
+
+	// The failed lookup should have been cached.
+	EXPECT_EQ(m_numLookups, 1);
+}
+
+TEST_F(AccountNameCacheTest, Expiry)
+{
+	m_accountNames[1000] = L"DOMAIN\\user";
+	auto resolvedSid = BuildSid(1000);
+	auto unresolvedSid = BuildSid(1001);
+
+	EXPECT_EQ(m_cache.GetAccountName(resolvedSid.data()), L"DOMAIN\\user");
+	EXPECT_EQ(m_cache.GetAccountName(unresolvedSid.data()), std::nullopt);
+	EXPECT_EQ(m_numLookups, 2);
+
+	// Unresolved entries should expire first.
+	m_now += AccountNameCache::UNRESOLVED_ENTRY_LIFETIME;
+	m_accountNames[1001] = L"DOMAIN\\user2";
+	EXPECT_EQ(m_cache.GetAccountName(resolvedSid.data()), L"DOMAIN\\user");
+	EXPECT_EQ(m_cache.GetAccountName(unresolvedSid.data()), L"DOMAIN\\user2");
+	EXPECT_EQ(m_numLookups, 3);
+
+	m_now += AccountNameCache::RESOLVED_ENTRY_LIFETIME;
+	m_accountNames[1000] = L"DOMAIN\\renamed";
+	EXPECT_EQ(m_cache.GetAccountName(resolvedSid.data()), L"DOMAIN\\renamed");
+	EXPECT_EQ(m_numLookups, 4);
+}
+
+TEST_F(AccountNameCacheTest, Prefetch)
+{
+	m_accountNames[1000] = L"DOMAIN\\user1";
+	m_accountNames[1001] = L"DOMAIN\\user2";
+
+	auto sid1 = BuildSid(1000);
+	auto sid2 = BuildSid(1001);
+	auto sid3 = BuildSid(1000);
+	auto sid4 = BuildSid(1002);
+
+	m_cache.Prefetch({ sid1.data(), sid2.data(), sid3.data(), sid4.data() });
+
+	// All the distinct SIDs should have been resolved in a single lookup.
+	EXPECT_EQ(m_numLookups, 1);
+	EXPECT_EQ(m_numSidsLookedUp, 3);
+
+	EXPECT_EQ(m_cache.GetAccountName(sid1.data()), L"DOMAIN\\user1");
+	EXPECT_EQ(m_cache.GetAccountName(sid2.data()), L"DOMAIN\\user2");
+	EXPECT_EQ(m_cache.GetAccountName(sid4.data()), std::nullopt);
+	EXPECT_EQ(m_numLookups, 1);
+
+	// SIDs that are already cached shouldn't be looked up again.
+	m_cache.Prefetch({ sid1.data(), sid2.data() });
+	EXPECT_EQ(m_numLookups, 1);
+
+	auto stats = m_cache.GetStats();
+	EXPECT_EQ(stats.hits, 3U);
+	EXPECT_EQ(stats.misses, 3U);
+}
+
+TEST_F(AccountNameCacheTest, InvalidSid)
+{
+	std::vector<BYTE> invalidSid = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	EXPECT_EQ(m_cache.GetAccountName(invalidSid.data()), std::nullopt);
+	EXPECT_EQ(m_numLookups, 0);
+}
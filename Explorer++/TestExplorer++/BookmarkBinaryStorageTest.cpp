@@ -0,0 +1,42 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "Bookmarks/BookmarkBinaryStorage.h"
+#include "BookmarkStorageTestHelper.h"
+#include "Bookmarks/BookmarkItem.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(BookmarkBinaryStorageTest, SaveLoad)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	auto data = BookmarkBinaryStorage::Save(&referenceBookmarkTree);
+
+	BookmarkTree loadedBookmarkTree;
+	EXPECT_TRUE(BookmarkBinaryStorage::Load(data, &loadedBookmarkTree));
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &referenceBookmarkTree, true);
+}
+
+TEST(BookmarkBinaryStorageTest, InvalidData)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	auto data = BookmarkBinaryStorage::Save(&referenceBookmarkTree);
+
+	// Even though the first part of the data is valid, nothing should be added to the tree.
+	BookmarkTree loadedBookmarkTree;
+	EXPECT_FALSE(
+		BookmarkBinaryStorage::Load(data.substr(0, data.size() - 1), &loadedBookmarkTree));
+
+	EXPECT_TRUE(loadedBookmarkTree.GetBookmarksToolbarFolder()->GetChildren().empty());
+	EXPECT_TRUE(loadedBookmarkTree.GetBookmarksMenuFolder()->GetChildren().empty());
+	EXPECT_TRUE(loadedBookmarkTree.GetOtherBookmarksFolder()->GetChildren().empty());
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ChangeCoalescer.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace testing;
+
+namespace
+{
+
+// The item data here is simply the name of the item, with a suffix that's used to distinguish
+// between different versions of the same item.
+using TestCoalescer = ChangeCoalescer<std::wstring, std::wstring>;
+using ChangeType = TestCoalescer::ChangeType;
+
+struct ExpectedChange
+{
+	ChangeType type;
+	std::optional<std::wstring> originalItem;
+	std::optional<std::wstring> currentItem;
+};
+
+void ExpectChanges(const TestCoalescer &coalescer, const std::vector<ExpectedChange> &expected)
+{
+	auto changes = coalescer.GetChanges();
+	ASSERT_EQ(changes.size(), expected.size());
+
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		EXPECT_EQ(changes[i].type, expected[i].type);
+		EXPECT_EQ(changes[i].originalItem, expected[i].originalItem);
+		EXPECT_EQ(changes[i].currentItem, expected[i].currentItem);
+	}
+}
+
+}
+
+TEST(ChangeCoalescerTest, IndividualChanges)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemAdded(L"a", L"a1");
+	coalescer.OnItemRemoved(L"b", L"b1");
+	coalescer.OnItemModified(L"c", L"c2");
+	coalescer.OnItemRenamed(L"d", L"d1", L"e", L"e1");
+
+	EXPECT_EQ(coalescer.GetNumEvents(), 4u);
+
+	// Removals come first, then renames, modifications and additions.
+	ExpectChanges(coalescer,
+		{ { ChangeType::Removed, L"b1", std::nullopt }, { ChangeType::Renamed, L"d1", L"e1" },
+			{ ChangeType::Modified, L"c2", L"c2" }, { ChangeType::Added, std::nullopt, L"a1" } });
+}
+
+TEST(ChangeCoalescerTest, AddThenRemove)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemAdded(L"a", L"a1");
+	coalescer.OnItemModified(L"a", L"a2");
+	coalescer.OnItemRemoved(L"a", L"a2");
+
+	EXPECT_EQ(coalescer.GetNumEvents(), 3u);
+	ExpectChanges(coalescer, {});
+}
+
+TEST(ChangeCoalescerTest, RemoveThenAdd)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRemoved(L"a", L"a1");
+	coalescer.OnItemAdded(L"a", L"a2");
+
+	// The item existed beforehand and still exists, so it's been modified.
+	ExpectChanges(coalescer, { { ChangeType::Modified, L"a1", L"a2" } });
+}
+
+TEST(ChangeCoalescerTest, RepeatedModifications)
+{
+	TestCoalescer coalescer;
+
+	for (int i = 1; i <= 100; i++)
+	{
+		coalescer.OnItemModified(L"a", L"a" + std::to_wstring(i));
+	}
+
+	EXPECT_EQ(coalescer.GetNumEvents(), 100u);
+	ExpectChanges(coalescer, { { ChangeType::Modified, L"a1", L"a100" } });
+}
+
+TEST(ChangeCoalescerTest, AddThenModify)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemAdded(L"a", L"a1");
+	coalescer.OnItemModified(L"a", L"a2");
+
+	ExpectChanges(coalescer, { { ChangeType::Added, std::nullopt, L"a2" } });
+}
+
+TEST(ChangeCoalescerTest, RemoveThenModify)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRemoved(L"a", L"a1");
+	coalescer.OnItemModified(L"a", L"a2");
+
+	ExpectChanges(coalescer, { { ChangeType::Removed, L"a1", std::nullopt } });
+}
+
+TEST(ChangeCoalescerTest, RenameChain)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b1");
+	coalescer.OnItemModified(L"b", L"b2");
+	coalescer.OnItemRenamed(L"b", L"b2", L"c", L"c1");
+
+	ExpectChanges(coalescer, { { ChangeType::Renamed, L"a1", L"c1" } });
+}
+
+TEST(ChangeCoalescerTest, RenameBackToOriginalName)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b1");
+	coalescer.OnItemRenamed(L"b", L"b1", L"a", L"a2");
+
+	ExpectChanges(coalescer, {});
+
+	coalescer.OnItemModified(L"a", L"a3");
+	ExpectChanges(coalescer, { { ChangeType::Modified, L"a1", L"a3" } });
+}
+
+TEST(ChangeCoalescerTest, AddThenRename)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemAdded(L"a", L"a1");
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b1");
+
+	ExpectChanges(coalescer, { { ChangeType::Added, std::nullopt, L"b1" } });
+}
+
+TEST(ChangeCoalescerTest, RenameThenRemove)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b1");
+	coalescer.OnItemRemoved(L"b", L"b1");
+
+	// The original item is what needs to be removed.
+	ExpectChanges(coalescer, { { ChangeType::Removed, L"a1", std::nullopt } });
+}
+
+TEST(ChangeCoalescerTest, RenameOverExistingItem)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemModified(L"b", L"b1");
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b2");
+
+	ExpectChanges(coalescer,
+		{ { ChangeType::Removed, L"b1", std::nullopt }, { ChangeType::Renamed, L"a1", L"b2" } });
+}
+
+TEST(ChangeCoalescerTest, SwapNames)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRenamed(L"a", L"a1", L"tmp", L"tmp1");
+	coalescer.OnItemRenamed(L"b", L"b1", L"a", L"a2");
+	coalescer.OnItemRenamed(L"tmp", L"tmp1", L"b", L"b2");
+
+	// Each item is reported using its original details, so both renames can be resolved before
+	// either is applied.
+	ExpectChanges(coalescer,
+		{ { ChangeType::Renamed, L"a1", L"b2" }, { ChangeType::Renamed, L"b1", L"a2" } });
+}
+
+TEST(ChangeCoalescerTest, RenameRemovedItem)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemRemoved(L"a", L"a1");
+	coalescer.OnItemRenamed(L"a", L"a1", L"b", L"b1");
+
+	ExpectChanges(coalescer,
+		{ { ChangeType::Removed, L"a1", std::nullopt }, { ChangeType::Added, std::nullopt, L"b1" } });
+}
+
+TEST(ChangeCoalescerTest, Clear)
+{
+	TestCoalescer coalescer;
+	coalescer.OnItemAdded(L"a", L"a1");
+	coalescer.OnItemRemoved(L"b", L"b1");
+	coalescer.Clear();
+
+	EXPECT_EQ(coalescer.GetNumEvents(), 0u);
+	ExpectChanges(coalescer, {});
+}
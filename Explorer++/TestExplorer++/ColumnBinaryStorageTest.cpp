@@ -0,0 +1,30 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "ColumnBinaryStorage.h"
+#include "ColumnStorageTestHelper.h"
+#include "ShellBrowser/FolderSettings.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(ColumnBinaryStorageTest, SaveLoad)
+{
+	auto referenceColumns = BuildFolderColumnsLoadSaveReference();
+
+	auto data = ColumnBinaryStorage::Save(referenceColumns);
+	auto loadedColumns = ColumnBinaryStorage::Load(data);
+
+	ASSERT_TRUE(loadedColumns.has_value());
+	EXPECT_EQ(*loadedColumns, referenceColumns);
+}
+
+TEST(ColumnBinaryStorageTest, InvalidData)
+{
+	auto data = ColumnBinaryStorage::Save(BuildFolderColumnsLoadSaveReference());
+
+	EXPECT_FALSE(ColumnBinaryStorage::Load(data.substr(0, data.size() / 2)).has_value());
+	EXPECT_FALSE(ColumnBinaryStorage::Load("").has_value());
+}
@@ -0,0 +1,162 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/FileCopyEngine.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+using namespace testing;
+
+namespace
+{
+
+// Chosen so that each copy is split across a number of chunks, with a partial chunk at the end.
+const DWORD CHUNK_SIZE = 4096;
+const size_t FILE_SIZE = (CHUNK_SIZE * 5) + 123;
+
+const uint64_t COPY_ALL = (std::numeric_limits<uint64_t>::max)();
+
+}
+
+class FileCopyEngineTest : public TestWithParam<bool>
+{
+protected:
+	FileCopyEngineTest() :
+		m_rootDirectory(L"FileCopyEngineTest"),
+		m_rootPath(m_rootDirectory.GetPath()),
+		m_data(GenerateData(FILE_SIZE)),
+		m_engine(CHUNK_SIZE)
+	{
+		std::ofstream(m_rootPath / L"source", std::ios::binary) << m_data;
+	}
+
+	// The engine should work whether or not the files were opened for overlapped I/O.
+	DWORD GetFlags() const
+	{
+		return GetParam() ? FILE_FLAG_OVERLAPPED : 0;
+	}
+
+	wil::unique_hfile OpenSource() const
+	{
+		return wil::unique_hfile(CreateFile((m_rootPath / L"source").c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING, GetFlags(), nullptr));
+	}
+
+	wil::unique_hfile CreateDestination(const std::wstring &name) const
+	{
+		return wil::unique_hfile(CreateFile((m_rootPath / name).c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, GetFlags(), nullptr));
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_rootPath;
+	const std::string m_data;
+	FileCopyEngine m_engine;
+};
+
+TEST_P(FileCopyEngineTest, CopyEntireFile)
+{
+	auto source = OpenSource();
+	ASSERT_TRUE(source);
+
+	auto destination = CreateDestination(L"destination");
+	ASSERT_TRUE(destination);
+
+	std::vector<uint64_t> progress;
+	uint64_t bytesCopied;
+	HRESULT hr = m_engine.Copy(source.get(), 0, destination.get(), 0, COPY_ALL,
+		[&progress](uint64_t bytesCopiedSoFar)
+		{
+			progress.push_back(bytesCopiedSoFar);
+			return true;
+		},
+		bytesCopied);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(bytesCopied, FILE_SIZE);
+
+	// Progress is reported once for each chunk.
+	ASSERT_EQ(progress.size(), 6U);
+	EXPECT_EQ(progress[0], CHUNK_SIZE);
+	EXPECT_EQ(progress.back(), FILE_SIZE);
+
+	destination.reset();
+	EXPECT_EQ(ReadFileContents(m_rootPath / L"destination"), m_data);
+}
+
+TEST_P(FileCopyEngineTest, CopyRange)
+{
+	auto source = OpenSource();
+	ASSERT_TRUE(source);
+
+	auto destination = CreateDestination(L"destination");
+	ASSERT_TRUE(destination);
+
+	// Copy the data in two pieces, in reverse order, so that the second piece is written before
+	// the first.
+	const uint64_t splitPoint = CHUNK_SIZE + 100;
+
+	uint64_t bytesCopied;
+	HRESULT hr = m_engine.Copy(source.get(), splitPoint, destination.get(), splitPoint, COPY_ALL,
+		nullptr, bytesCopied);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(bytesCopied, FILE_SIZE - splitPoint);
+
+	hr = m_engine.Copy(source.get(), 0, destination.get(), 0, splitPoint, nullptr, bytesCopied);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(bytesCopied, splitPoint);
+
+	destination.reset();
+	EXPECT_EQ(ReadFileContents(m_rootPath / L"destination"), m_data);
+}
+
+TEST_P(FileCopyEngineTest, CopyPastEnd)
+{
+	auto source = OpenSource();
+	ASSERT_TRUE(source);
+
+	auto destination = CreateDestination(L"destination");
+	ASSERT_TRUE(destination);
+
+	uint64_t bytesCopied;
+	HRESULT hr = m_engine.Copy(source.get(), FILE_SIZE + 1, destination.get(), 0, COPY_ALL,
+		nullptr, bytesCopied);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(bytesCopied, 0U);
+}
+
+TEST_P(FileCopyEngineTest, Stop)
+{
+	auto source = OpenSource();
+	ASSERT_TRUE(source);
+
+	auto destination = CreateDestination(L"destination");
+	ASSERT_TRUE(destination);
+
+	uint64_t bytesCopied;
+	HRESULT hr = m_engine.Copy(source.get(), 0, destination.get(), 0, COPY_ALL,
+		[](uint64_t bytesCopiedSoFar) { return bytesCopiedSoFar < CHUNK_SIZE * 2; }, bytesCopied);
+	EXPECT_EQ(hr, E_ABORT);
+	EXPECT_EQ(bytesCopied, CHUNK_SIZE * 2);
+
+	destination.reset();
+	EXPECT_EQ(ReadFileContents(m_rootPath / L"destination"), m_data.substr(0, CHUNK_SIZE * 2));
+
+	// The engine can be reused once a copy has been stopped.
+	destination = CreateDestination(L"destination2");
+	ASSERT_TRUE(destination);
+
+	hr = m_engine.Copy(source.get(), 0, destination.get(), 0, COPY_ALL, nullptr, bytesCopied);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(bytesCopied, FILE_SIZE);
+
+	destination.reset();
+	EXPECT_EQ(ReadFileContents(m_rootPath / L"destination2"), m_data);
+}
+
+INSTANTIATE_TEST_SUITE_P(Overlapped, FileCopyEngineTest, Values(false, true));
@@ -0,0 +1,233 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/FileNameIndex.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+namespace
+{
+
+std::vector<std::wstring> GetSortedPaths(const std::vector<FileNameIndex::Item> &items)
+{
+	std::vector<std::wstring> paths;
+
+	for (const auto &item : items)
+	{
+		paths.push_back(item.path);
+	}
+
+	std::sort(paths.begin(), paths.end());
+
+	return paths;
+}
+
+bool MatchAll(std::wstring_view name, const FileNameIndex::ItemData &itemData)
+{
+	UNREFERENCED_PARAMETER(name);
+	UNREFERENCED_PARAMETER(itemData);
+
+	return true;
+}
+
+const FileNameIndex::ItemData FILE_DATA = { 0, 0, FILE_ATTRIBUTE_NORMAL };
+const FileNameIndex::ItemData DIRECTORY_DATA = { 0, 0, FILE_ATTRIBUTE_DIRECTORY };
+
+}
+
+class FileNameIndexTest : public Test
+{
+protected:
+	FileNameIndexTest() : m_index(L"C:\\Root")
+	{
+		m_index.AddOrUpdateItem(L"Documents", DIRECTORY_DATA);
+		m_index.AddOrUpdateItem(L"Documents\\report.docx", FILE_DATA);
+		m_index.AddOrUpdateItem(L"Documents\\Archive", DIRECTORY_DATA);
+		m_index.AddOrUpdateItem(L"Documents\\Archive\\old.txt", FILE_DATA);
+		m_index.AddOrUpdateItem(L"notes.txt", FILE_DATA);
+	}
+
+	FileNameIndex m_index;
+};
+
+TEST_F(FileNameIndexTest, FindItems)
+{
+	auto items = m_index.FindItems(L"C:\\Root", MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items),
+		(std::vector<std::wstring>{ L"C:\\Root\\Documents", L"C:\\Root\\Documents\\Archive",
+			L"C:\\Root\\Documents\\Archive\\old.txt", L"C:\\Root\\Documents\\report.docx",
+			L"C:\\Root\\notes.txt" }));
+
+	items = m_index.FindItems(L"c:\\root\\documents\\",
+		[](std::wstring_view name, const FileNameIndex::ItemData &itemData)
+		{
+			UNREFERENCED_PARAMETER(itemData);
+			return name.ends_with(L".txt");
+		});
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items),
+		(std::vector<std::wstring>{ L"C:\\Root\\Documents\\Archive\\old.txt" }));
+
+	EXPECT_FALSE(m_index.FindItems(L"C:\\Other", MatchAll));
+	EXPECT_FALSE(m_index.FindItems(L"C:\\Root\\Missing", MatchAll));
+}
+
+TEST_F(FileNameIndexTest, CoversPath)
+{
+	EXPECT_TRUE(m_index.CoversPath(L"C:\\Root"));
+	EXPECT_TRUE(m_index.CoversPath(L"c:\\ROOT\\Documents"));
+	EXPECT_FALSE(m_index.CoversPath(L"C:\\Root2"));
+	EXPECT_FALSE(m_index.CoversPath(L"C:\\"));
+}
+
+TEST_F(FileNameIndexTest, AddOrUpdate)
+{
+	EXPECT_EQ(m_index.GetNumItems(), 5U);
+
+	FileNameIndex::ItemData updatedData = { 100, 0, FILE_ATTRIBUTE_NORMAL };
+	EXPECT_TRUE(m_index.AddOrUpdateItem(L"NOTES.TXT", updatedData));
+	EXPECT_EQ(m_index.GetNumItems(), 5U);
+
+	auto items = m_index.FindItems(L"C:\\Root",
+		[](std::wstring_view name, const FileNameIndex::ItemData &itemData)
+		{
+			UNREFERENCED_PARAMETER(name);
+			return itemData.size == 100;
+		});
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items), (std::vector<std::wstring>{ L"C:\\Root\\notes.txt" }));
+
+	// The parent directory needs to be in the index.
+	EXPECT_FALSE(m_index.AddOrUpdateItem(L"Missing\\file.txt", FILE_DATA));
+	EXPECT_FALSE(m_index.AddOrUpdateItem(L"notes.txt\\file.txt", FILE_DATA));
+}
+
+TEST_F(FileNameIndexTest, Remove)
+{
+	EXPECT_TRUE(m_index.RemoveItem(L"Documents"));
+	EXPECT_EQ(m_index.GetNumItems(), 1U);
+
+	EXPECT_FALSE(m_index.RemoveItem(L"Documents\\report.docx"));
+
+	auto items = m_index.FindItems(L"C:\\Root", MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items), (std::vector<std::wstring>{ L"C:\\Root\\notes.txt" }));
+}
+
+TEST_F(FileNameIndexTest, RemoveMovedDirectory)
+{
+	// The moved directory (and its contents) will appear before its new parent in the index.
+	EXPECT_TRUE(m_index.AddOrUpdateItem(L"Backup", DIRECTORY_DATA));
+	EXPECT_TRUE(m_index.RenameItem(L"Documents", L"Backup\Documents"));
+
+	EXPECT_TRUE(m_index.RemoveItem(L"Backup"));
+	EXPECT_EQ(m_index.GetNumItems(), 1U);
+
+	auto items = m_index.FindItems(L"C:\Root", MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items), (std::vector<std::wstring>{ L"C:\Root\notes.txt" }));
+}
+
+TEST_F(FileNameIndexTest, Rename)
+{
+	EXPECT_TRUE(m_index.RenameItem(L"Documents\\Archive", L"Archive 2024"));
+
+	auto items = m_index.FindItems(L"C:\\Root\\Archive 2024", MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items),
+		(std::vector<std::wstring>{ L"C:\\Root\\Archive 2024\\old.txt" }));
+
+	// Renaming over an existing item should replace it.
+	EXPECT_TRUE(m_index.RenameItem(L"notes.txt", L"Archive 2024\\old.txt"));
+	EXPECT_EQ(m_index.GetNumItems(), 4U);
+}
+
+TEST_F(FileNameIndexTest, AddDirectoryContents)
+{
+	FileNameIndex contents(L"D:\\Downloads\\Photos");
+	contents.AddOrUpdateItem(L"2024", DIRECTORY_DATA);
+	contents.AddOrUpdateItem(L"2024\\beach.jpg", FILE_DATA);
+	contents.AddOrUpdateItem(L"2024\\removed.jpg", FILE_DATA);
+	contents.RemoveItem(L"2024\\removed.jpg");
+	contents.AddOrUpdateItem(L"cover.jpg", FILE_DATA);
+
+	m_index.AddOrUpdateItem(L"Photos", DIRECTORY_DATA);
+	EXPECT_TRUE(m_index.AddDirectoryContents(L"Photos", contents));
+
+	auto items = m_index.FindItems(L"C:\\Root\\Photos", MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items),
+		(std::vector<std::wstring>{ L"C:\\Root\\Photos\\2024",
+			L"C:\\Root\\Photos\\2024\\beach.jpg", L"C:\\Root\\Photos\\cover.jpg" }));
+
+	// Adding the same contents again should update the existing items, rather than duplicating
+	// them.
+	EXPECT_TRUE(m_index.AddDirectoryContents(L"Photos", contents));
+	EXPECT_EQ(m_index.GetNumItems(), 9U);
+
+	// The destination needs to be a directory that's in the index.
+	EXPECT_FALSE(m_index.AddDirectoryContents(L"Missing", contents));
+	EXPECT_FALSE(m_index.AddDirectoryContents(L"notes.txt", contents));
+}
+
+TEST_F(FileNameIndexTest, SaveAndLoad)
+{
+	// Moving a directory into one that was created later results in a child appearing before its
+	// parent internally, which saving should handle.
+	m_index.AddOrUpdateItem(L"Later", DIRECTORY_DATA);
+	m_index.RenameItem(L"Documents", L"Later\\Documents");
+	m_index.RemoveItem(L"notes.txt");
+
+	auto filePath = std::filesystem::temp_directory_path() / L"FileNameIndexTest.idx";
+	ASSERT_TRUE(m_index.Save(filePath.wstring()));
+
+	auto loadedIndex = FileNameIndex::Load(filePath.wstring());
+	std::filesystem::remove(filePath);
+	ASSERT_NE(loadedIndex, nullptr);
+
+	EXPECT_EQ(loadedIndex->GetRootPath(), L"C:\\Root");
+	EXPECT_EQ(loadedIndex->GetNumItems(), m_index.GetNumItems());
+
+	auto originalItems = m_index.FindItems(L"C:\\Root", MatchAll);
+	auto loadedItems = loadedIndex->FindItems(L"C:\\Root", MatchAll);
+	ASSERT_TRUE(originalItems);
+	ASSERT_TRUE(loadedItems);
+	EXPECT_EQ(GetSortedPaths(*loadedItems), GetSortedPaths(*originalItems));
+
+	// The loaded index should still be updatable.
+	EXPECT_TRUE(loadedIndex->AddOrUpdateItem(L"Later\\Documents\\new.txt", FILE_DATA));
+}
+
+TEST(FileNameIndexBuildTest, Build)
+{
+	auto rootPath = std::filesystem::temp_directory_path() / L"FileNameIndexBuildTest";
+	std::filesystem::remove_all(rootPath);
+	std::filesystem::create_directories(rootPath / L"Folder" / L"Subfolder");
+	std::ofstream(rootPath / L"Folder" / L"file1.txt") << "data";
+	std::ofstream(rootPath / L"Folder" / L"Subfolder" / L"file2.txt");
+
+	auto index = FileNameIndex::Build(rootPath.wstring());
+	ASSERT_NE(index, nullptr);
+
+	auto items = index->FindItems(rootPath.wstring(), MatchAll);
+	ASSERT_TRUE(items);
+	EXPECT_EQ(GetSortedPaths(*items),
+		(std::vector<std::wstring>{ (rootPath / L"Folder").wstring(),
+			(rootPath / L"Folder" / L"Subfolder").wstring(),
+			(rootPath / L"Folder" / L"Subfolder" / L"file2.txt").wstring(),
+			(rootPath / L"Folder" / L"file1.txt").wstring() }));
+
+	auto file = std::find_if(items->begin(), items->end(),
+		[](const FileNameIndex::Item &item) { return item.path.ends_with(L"file1.txt"); });
+	ASSERT_NE(file, items->end());
+	EXPECT_EQ(file->data.size, 4U);
+
+	std::filesystem::remove_all(rootPath);
+}
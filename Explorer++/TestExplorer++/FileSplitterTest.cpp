@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/FileSplitter.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+namespace
+{
+
+// Each part spans several chunks, with the last part being shorter than the others.
+const DWORD CHUNK_SIZE = 4096;
+const uint64_t PART_SIZE = (CHUNK_SIZE * 3) + 10;
+const uint64_t NUM_PARTS = 5;
+const uint64_t FILE_SIZE = (PART_SIZE * (NUM_PARTS - 1)) + 100;
+
+}
+
+class FileSplitterTest : public Test
+{
+protected:
+	FileSplitterTest() :
+		m_rootDirectory(L"FileSplitterTest"),
+		m_rootPath(m_rootDirectory.GetPath()),
+		m_data(GenerateData(FILE_SIZE)),
+		m_executor(3)
+	{
+		std::ofstream(m_rootPath / L"input", std::ios::binary) << m_data;
+	}
+
+	std::wstring GetPartPath(int partNumber) const
+	{
+		return (m_rootPath / (L"input.part" + std::to_wstring(partNumber))).wstring();
+	}
+
+	HRESULT Split(const std::atomic<bool> &stop,
+		const FileSplitter::ProgressCallback &progressCallback, int maxConcurrentParts = 4)
+	{
+		wil::unique_hfile inputFile(CreateFile((m_rootPath / L"input").c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr));
+
+		if (!inputFile)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		FileSplitter splitter(&m_executor, maxConcurrentParts, CHUNK_SIZE);
+		return splitter.Split(inputFile.get(), FILE_SIZE, PART_SIZE,
+			[this](int partNumber) { return GetPartPath(partNumber); }, stop, progressCallback);
+	}
+
+	void CheckParts() const
+	{
+		for (uint64_t i = 0; i < NUM_PARTS; i++)
+		{
+			EXPECT_EQ(ReadFileContents(GetPartPath(static_cast<int>(i + 1))),
+				m_data.substr(static_cast<size_t>(i * PART_SIZE), static_cast<size_t>(PART_SIZE)));
+		}
+
+		EXPECT_FALSE(std::filesystem::exists(GetPartPath(NUM_PARTS + 1)));
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_rootPath;
+	const std::string m_data;
+	WorkStealingExecutor m_executor;
+};
+
+TEST_F(FileSplitterTest, Split)
+{
+	std::atomic<bool> stop = false;
+	FileSplitter::Progress finalProgress = {};
+	HRESULT hr = Split(stop,
+		[&finalProgress](const FileSplitter::Progress &progress) { finalProgress = progress; });
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	CheckParts();
+	EXPECT_EQ(finalProgress.bytesSplit, FILE_SIZE);
+	EXPECT_EQ(finalProgress.totalBytes, FILE_SIZE);
+}
+
+TEST_F(FileSplitterTest, Resume)
+{
+	// Writing a single part at a time means that the first part will be complete and the second
+	// will be partially written when the split is stopped.
+	std::atomic<bool> stop = false;
+	HRESULT hr = Split(
+		stop,
+		[&stop](const FileSplitter::Progress &progress)
+		{
+			if (progress.bytesSplit >= CHUNK_SIZE * 4)
+			{
+				stop = true;
+			}
+		},
+		1);
+	ASSERT_EQ(hr, E_ABORT);
+	EXPECT_TRUE(std::filesystem::exists(GetPartPath(1)));
+	EXPECT_FALSE(std::filesystem::exists(GetPartPath(2)));
+	EXPECT_TRUE(std::filesystem::exists(FileSplitter::GetPartialPartPath(GetPartPath(2))));
+
+	stop = false;
+	std::optional<FileSplitter::Progress> firstProgress;
+	hr = Split(stop,
+		[&firstProgress](const FileSplitter::Progress &progress)
+		{
+			if (!firstProgress)
+			{
+				firstProgress = progress;
+			}
+		});
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	CheckParts();
+	EXPECT_FALSE(std::filesystem::exists(FileSplitter::GetPartialPartPath(GetPartPath(2))));
+	EXPECT_FALSE(std::filesystem::exists(FileSplitter::GetResumeManifestPath(GetPartPath(1))));
+
+	// The data written during the first split should have been kept.
+	ASSERT_TRUE(firstProgress);
+	EXPECT_GE(firstProgress->bytesSplit, PART_SIZE);
+}
+
+TEST_F(FileSplitterTest, ResumeAfterInputChanged)
+{
+	std::atomic<bool> stop = false;
+	HRESULT hr = Split(
+		stop,
+		[&stop](const FileSplitter::Progress &progress)
+		{
+			if (progress.bytesSplit >= CHUNK_SIZE * 4)
+			{
+				stop = true;
+			}
+		},
+		1);
+	ASSERT_EQ(hr, E_ABORT);
+	ASSERT_TRUE(std::filesystem::exists(GetPartPath(1)));
+	auto firstPart = ReadFileContents(GetPartPath(1));
+
+	auto inputPath = m_rootPath / L"input";
+	std::filesystem::last_write_time(inputPath,
+		std::filesystem::last_write_time(inputPath) + std::chrono::hours(1));
+
+	// The parts were written from a different version of the input file, so they can't be reused.
+	stop = false;
+	hr = Split(stop, nullptr);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_FILE_EXISTS));
+	EXPECT_EQ(ReadFileContents(GetPartPath(1)), firstPart);
+}
+
+TEST_F(FileSplitterTest, ExistingFile)
+{
+	std::ofstream(GetPartPath(3)) << "unrelated";
+
+	std::atomic<bool> stop = false;
+	HRESULT hr = Split(stop, nullptr);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_FILE_EXISTS));
+
+	// The existing file shouldn't have been overwritten.
+	EXPECT_EQ(ReadFileContents(GetPartPath(3)), "unrelated");
+}
@@ -0,0 +1,45 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include <fstream>
+#include <iterator>
+
+TemporaryDirectory::TemporaryDirectory(const std::wstring &name) :
+	m_path(std::filesystem::temp_directory_path() / name)
+{
+	// A previous run may not have been able to clean up.
+	std::filesystem::remove_all(m_path);
+	std::filesystem::create_directories(m_path);
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+	std::error_code error;
+	std::filesystem::remove_all(m_path, error);
+}
+
+const std::filesystem::path &TemporaryDirectory::GetPath() const
+{
+	return m_path;
+}
+
+std::string GenerateData(size_t size)
+{
+	std::string data(size, '\0');
+
+	for (size_t i = 0; i < size; i++)
+	{
+		data[i] = static_cast<char>((i * 31) % 251);
+	}
+
+	return data;
+}
+
+std::string ReadFileContents(const std::filesystem::path &path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(stream), {});
+}
@@ -0,0 +1,28 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// Creates an empty directory within the temp directory, which is removed (along with anything
+// written to it) when this object is destroyed.
+class TemporaryDirectory
+{
+public:
+	explicit TemporaryDirectory(const std::wstring &name);
+	~TemporaryDirectory();
+
+	const std::filesystem::path &GetPath() const;
+
+private:
+	const std::filesystem::path m_path;
+};
+
+// Returns a block of data that doesn't repeat over short distances, so that data written to the
+// wrong offset will be detected.
+std::string GenerateData(size_t size);
+
+std::string ReadFileContents(const std::filesystem::path &path);
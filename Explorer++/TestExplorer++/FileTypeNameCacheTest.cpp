@@ -0,0 +1,168 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/FileTypeNameCache.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+WIN32_FIND_DATA BuildFindData(const std::wstring &fileName, DWORD attributes)
+{
+	WIN32_FIND_DATA findData = {};
+	StringCchCopy(findData.cFileName, std::size(findData.cFileName), fileName.c_str());
+	findData.dwFileAttributes = attributes;
+	return findData;
+}
+
+}
+
+class FileTypeNameCacheTest : public testing::Test
+{
+protected:
+	FileTypeNameCacheTest() :
+		m_cache(
+			[this](PCIDLIST_ABSOLUTE pidl) -> std::optional<std::wstring>
+			{
+				m_numLookups++;
+
+				if (!pidl)
+				{
+					return std::nullopt;
+				}
+
+				return m_typeNames.at(pidl);
+			})
+	{
+	}
+
+	// The pidls are only used to identify the items here, so they don't need to point to valid
+	// item IDs.
+	PCIDLIST_ABSOLUTE AddItem(const std::wstring &typeName)
+	{
+		auto pidl = reinterpret_cast<PCIDLIST_ABSOLUTE>(m_typeNames.size() + 1);
+		m_typeNames[pidl] = typeName;
+		return pidl;
+	}
+
+	FileTypeNameCache m_cache;
+	std::unordered_map<PCIDLIST_ABSOLUTE, std::wstring> m_typeNames;
+	int m_numLookups = 0;
+};
+
+TEST_F(FileTypeNameCacheTest, SharedByExtension)
+{
+	auto findData1 = BuildFindData(L"file1.txt", FILE_ATTRIBUTE_NORMAL);
+	auto pidl1 = AddItem(L"Text Document");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl1, &findData1 }), L"Text Document");
+
+	// Extensions should be compared case-insensitively.
+	auto findData2 = BuildFindData(L"file2.TXT", FILE_ATTRIBUTE_NORMAL);
+	auto pidl2 = AddItem(L"Text Document");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl2, &findData2 }), L"Text Document");
+
+	EXPECT_EQ(m_numLookups, 1);
+	EXPECT_EQ(m_cache.GetNumTypeNames(), 1U);
+
+	auto findData3 = BuildFindData(L"file3", FILE_ATTRIBUTE_NORMAL);
+	auto pidl3 = AddItem(L"File");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl3, &findData3 }), L"File");
+
+	auto findData4 = BuildFindData(L"file4", FILE_ATTRIBUTE_NORMAL);
+	auto pidl4 = AddItem(L"File");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl4, &findData4 }), L"File");
+
+	EXPECT_EQ(m_numLookups, 2);
+}
+
+TEST_F(FileTypeNameCacheTest, Folders)
+{
+	auto findData1 = BuildFindData(L"folder1", FILE_ATTRIBUTE_DIRECTORY);
+	auto pidl1 = AddItem(L"File folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl1, &findData1 }), L"File folder");
+
+	// The extension of a folder shouldn't have any effect.
+	auto findData2 = BuildFindData(L"folder2.txt", FILE_ATTRIBUTE_DIRECTORY);
+	auto pidl2 = AddItem(L"File folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl2, &findData2 }), L"File folder");
+
+	EXPECT_EQ(m_numLookups, 1);
+
+	// A folder with a desktop.ini file can have its own type name, so it should always be looked
+	// up.
+	auto findData3 =
+		BuildFindData(L"folder3", FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_READONLY);
+	auto pidl3 = AddItem(L"Custom folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl3, &findData3 }), L"Custom folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl3, &findData3 }), L"Custom folder");
+
+	EXPECT_EQ(m_numLookups, 3);
+}
+
+TEST_F(FileTypeNameCacheTest, VirtualItems)
+{
+	auto pidl = AddItem(L"System Folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl, nullptr }), L"System Folder");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl, nullptr }), L"System Folder");
+
+	EXPECT_EQ(m_numLookups, 2);
+	EXPECT_EQ(m_cache.GetNumTypeNames(), 0U);
+}
+
+TEST_F(FileTypeNameCacheTest, FailedLookup)
+{
+	auto findData = BuildFindData(L"file.txt", FILE_ATTRIBUTE_NORMAL);
+	EXPECT_EQ(m_cache.GetTypeName({ nullptr, &findData }), std::nullopt);
+
+	// A failed lookup shouldn't be cached.
+	auto pidl = AddItem(L"Text Document");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl, &findData }), L"Text Document");
+	EXPECT_EQ(m_numLookups, 2);
+}
+
+TEST_F(FileTypeNameCacheTest, Prewarm)
+{
+	auto findData1 = BuildFindData(L"file1.txt", FILE_ATTRIBUTE_NORMAL);
+	auto pidl1 = AddItem(L"Text Document");
+	auto findData2 = BuildFindData(L"file2.txt", FILE_ATTRIBUTE_NORMAL);
+	auto pidl2 = AddItem(L"Text Document");
+	auto findData3 = BuildFindData(L"file3.lnk", FILE_ATTRIBUTE_NORMAL);
+	auto pidl3 = AddItem(L"Shortcut");
+	auto findData4 = BuildFindData(L"folder", FILE_ATTRIBUTE_DIRECTORY);
+	auto pidl4 = AddItem(L"File folder");
+	auto pidl5 = AddItem(L"System Folder");
+
+	m_cache.Prewarm({ { pidl1, &findData1 }, { pidl2, &findData2 }, { pidl3, &findData3 },
+		{ pidl4, &findData4 }, { pidl5, nullptr } });
+
+	// Only a single lookup should be performed for each distinct extension, while the virtual
+	// item should be skipped entirely.
+	EXPECT_EQ(m_numLookups, 3);
+	EXPECT_EQ(m_cache.GetNumTypeNames(), 3U);
+
+	EXPECT_EQ(m_cache.GetTypeName({ pidl2, &findData2 }), L"Text Document");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl3, &findData3 }), L"Shortcut");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl4, &findData4 }), L"File folder");
+	EXPECT_EQ(m_numLookups, 3);
+
+	// Extensions that have already been cached shouldn't be looked up again.
+	m_cache.Prewarm({ { pidl1, &findData1 }, { pidl3, &findData3 } });
+	EXPECT_EQ(m_numLookups, 3);
+}
+
+TEST_F(FileTypeNameCacheTest, Clear)
+{
+	auto findData = BuildFindData(L"file.txt", FILE_ATTRIBUTE_NORMAL);
+	auto pidl = AddItem(L"Text Document");
+	EXPECT_EQ(m_cache.GetTypeName({ pidl, &findData }), L"Text Document");
+
+	m_cache.Clear();
+	EXPECT_EQ(m_cache.GetNumTypeNames(), 0U);
+
+	// The associations may have changed, so the type name should be looked up again.
+	m_typeNames[pidl] = L"Updated Document";
+	EXPECT_EQ(m_cache.GetTypeName({ pidl, &findData }), L"Updated Document");
+	EXPECT_EQ(m_numLookups, 2);
+}
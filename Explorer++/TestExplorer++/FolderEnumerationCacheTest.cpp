@@ -0,0 +1,246 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/FolderEnumerationCache.h"
+#include "ShellTestHelper.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace
+{
+
+using Contents = FolderEnumerationCache::Contents;
+
+const Contents ALL_CONTENTS = Contents::Folders | Contents::NonFolders | Contents::Details;
+
+FolderEnumerationCache::Item MakeItem(const std::wstring &name, SFGAOF attributes)
+{
+	FolderEnumerationCache::Item item;
+	item.attributes = attributes;
+	item.parsingName = name;
+	item.displayName = name;
+	item.editingName = name;
+	return item;
+}
+
+FolderEnumerationCache::ItemList MakeItems()
+{
+	FolderEnumerationCache::ItemList items;
+	items.push_back(MakeItem(L"Folder", SFGAO_FOLDER));
+	items.push_back(MakeItem(L"file.txt", 0));
+	return items;
+}
+
+// Most of the tests use a single pidl for each path, which is built from the path itself.
+std::shared_ptr<const FolderEnumerationCache::ItemList> Get(FolderEnumerationCache &cache,
+	const std::wstring &path, Contents contents)
+{
+	return Get(cache, CreateSimplePidlForTest(path).Raw(), path, contents);
+}
+
+void Insert(FolderEnumerationCache &cache, const std::wstring &path, Contents contents,
+	FolderEnumerationCache::ItemList items, uint64_t generation)
+{
+	Insert(cache, CreateSimplePidlForTest(path).Raw(), path, contents, std::move(items),
+		generation);
+}
+
+}
+
+class FolderEnumerationCacheTest : public Test
+{
+protected:
+	FolderEnumerationCacheTest() : m_cache(1024 * 1024)
+	{
+		for (const auto *path : { L"C:\\Root", L"C:\\Root\\Folder", L"C:\\Root\\Folder\\Subfolder",
+				 L"C:\\Root\\Folder2" })
+		{
+			Insert(m_cache, path, ALL_CONTENTS, MakeItems(), m_cache.GetGeneration());
+		}
+	}
+
+	FolderEnumerationCache m_cache;
+};
+
+TEST_F(FolderEnumerationCacheTest, Get)
+{
+	EXPECT_EQ(m_cache.GetNumFolders(), 4U);
+
+	auto items = Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS);
+	ASSERT_NE(items, nullptr);
+	ASSERT_EQ(items->size(), 2U);
+	EXPECT_EQ((*items)[0].parsingName, L"Folder");
+	EXPECT_EQ((*items)[1].parsingName, L"file.txt");
+
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Missing", ALL_CONTENTS), nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, Contents)
+{
+	// A folder that was enumerated with everything can be used when only folders are needed.
+	auto items = Get(m_cache, L"C:\\Root", Contents::Folders);
+	ASSERT_NE(items, nullptr);
+	EXPECT_TRUE(FolderEnumerationCache::IsIncluded((*items)[0], Contents::Folders));
+	EXPECT_FALSE(FolderEnumerationCache::IsIncluded((*items)[1], Contents::Folders));
+
+	// Whether hidden items are included has to match exactly.
+	EXPECT_EQ(Get(m_cache, L"C:\\Root", Contents::Folders | Contents::IncludeHidden), nullptr);
+
+	Insert(m_cache, L"C:\\Root\\Folder2", Contents::Folders | Contents::IncludeHidden,
+		MakeItems(), m_cache.GetGeneration());
+
+	// The new entry should replace the existing one, so the details are no longer available.
+	EXPECT_NE(Get(m_cache, L"C:\\Root\\Folder2", Contents::Folders | Contents::IncludeHidden),
+		nullptr);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder2", Contents::Folders), nullptr);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder2",
+				  Contents::Folders | Contents::IncludeHidden | Contents::Details),
+		nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, InvalidateFolder)
+{
+	m_cache.InvalidateFolder(L"C:\\Root\\Folder");
+
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS), nullptr);
+
+	// Changing the items in a folder doesn't affect its parent or its subfolders.
+	EXPECT_NE(Get(m_cache, L"C:\\Root", ALL_CONTENTS), nullptr);
+	EXPECT_NE(Get(m_cache, L"C:\\Root\\Folder\\Subfolder", ALL_CONTENTS), nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, InvalidatePathCase)
+{
+	// Paths are compared case-insensitively and any trailing separator is ignored.
+	m_cache.InvalidateFolder(L"c:\\root\\folder\\");
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS), nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, InvalidateTree)
+{
+	m_cache.InvalidateTree(L"C:\\Root\\Folder");
+
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS), nullptr);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder\\Subfolder", ALL_CONTENTS), nullptr);
+
+	// A folder that shares a prefix with the invalidated folder isn't one of its descendants.
+	EXPECT_NE(Get(m_cache, L"C:\\Root\\Folder2", ALL_CONTENTS), nullptr);
+	EXPECT_NE(Get(m_cache, L"C:\\Root", ALL_CONTENTS), nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, InvalidateAll)
+{
+	auto generation = m_cache.GetGeneration();
+
+	m_cache.InvalidateAll();
+	EXPECT_EQ(m_cache.GetNumFolders(), 0U);
+	EXPECT_EQ(m_cache.GetMemoryUsage(), 0U);
+
+	Insert(m_cache, L"C:\\Other", ALL_CONTENTS, MakeItems(), generation);
+	EXPECT_EQ(Get(m_cache, L"C:\\Other", ALL_CONTENTS), nullptr);
+}
+
+TEST_F(FolderEnumerationCacheTest, InsertAfterInvalidation)
+{
+	auto generation = m_cache.GetGeneration();
+
+	m_cache.InvalidateTree(L"C:\\Root\\Folder");
+
+	// The folders were enumerated before the invalidation, so these results may be out of date.
+	Insert(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS, MakeItems(), generation);
+	Insert(m_cache, L"C:\\Root\\Folder\\Subfolder", ALL_CONTENTS, MakeItems(), generation);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS), nullptr);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder\\Subfolder", ALL_CONTENTS), nullptr);
+
+	m_cache.InvalidateFolder(L"C:\\Root\\Folder2");
+	Insert(m_cache, L"C:\\Root\\Folder2", ALL_CONTENTS, MakeItems(), generation);
+	EXPECT_EQ(Get(m_cache, L"C:\\Root\\Folder2", ALL_CONTENTS), nullptr);
+
+	// This folder isn't affected by either invalidation.
+	Insert(m_cache, L"C:\\Root\\Other", ALL_CONTENTS, MakeItems(), generation);
+	EXPECT_NE(Get(m_cache, L"C:\\Root\\Other", ALL_CONTENTS), nullptr);
+
+	// Results retrieved after the invalidation can be inserted.
+	Insert(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS, MakeItems(), m_cache.GetGeneration());
+	EXPECT_NE(Get(m_cache, L"C:\\Root\\Folder", ALL_CONTENTS), nullptr);
+}
+
+TEST(FolderEnumerationCacheMemoryTest, EvictLeastRecentlyUsed)
+{
+	FolderEnumerationCache sizingCache(1024 * 1024);
+	Insert(sizingCache, L"C:\\Folder1", ALL_CONTENTS, MakeItems(), sizingCache.GetGeneration());
+	size_t entryMemoryUsage = sizingCache.GetMemoryUsage();
+	ASSERT_GT(entryMemoryUsage, 0U);
+
+	// There's only enough space for two entries.
+	FolderEnumerationCache cache((entryMemoryUsage * 2) + (entryMemoryUsage / 2));
+	Insert(cache, L"C:\\Folder1", ALL_CONTENTS, MakeItems(), cache.GetGeneration());
+	Insert(cache, L"C:\\Folder2", ALL_CONTENTS, MakeItems(), cache.GetGeneration());
+
+	// This should make the second folder the least recently used.
+	EXPECT_NE(Get(cache, L"C:\\Folder1", ALL_CONTENTS), nullptr);
+
+	Insert(cache, L"C:\\Folder3", ALL_CONTENTS, MakeItems(), cache.GetGeneration());
+	EXPECT_EQ(cache.GetNumFolders(), 2U);
+	EXPECT_NE(Get(cache, L"C:\\Folder1", ALL_CONTENTS), nullptr);
+	EXPECT_EQ(Get(cache, L"C:\\Folder2", ALL_CONTENTS), nullptr);
+	EXPECT_NE(Get(cache, L"C:\\Folder3", ALL_CONTENTS), nullptr);
+	EXPECT_LE(cache.GetMemoryUsage(), (entryMemoryUsage * 2) + (entryMemoryUsage / 2));
+
+	// A folder that's too large to fit in the cache isn't added at all.
+	FolderEnumerationCache::ItemList largeFolder;
+
+	for (int i = 0; i < 100; i++)
+	{
+		largeFolder.push_back(MakeItem(L"file" + std::to_wstring(i), 0));
+	}
+
+	Insert(cache, L"C:\\Large", ALL_CONTENTS, std::move(largeFolder), cache.GetGeneration());
+	EXPECT_EQ(Get(cache, L"C:\\Large", ALL_CONTENTS), nullptr);
+	EXPECT_EQ(cache.GetNumFolders(), 2U);
+}
+
+TEST(FolderEnumerationCacheMemoryTest, SharedItems)
+{
+	FolderEnumerationCache cache(1024 * 1024);
+	Insert(cache, L"C:\\Folder", ALL_CONTENTS, MakeItems(), cache.GetGeneration());
+
+	auto items = Get(cache, L"C:\\Folder", ALL_CONTENTS);
+	ASSERT_NE(items, nullptr);
+
+	// Items that have been retrieved remain valid, even once the entry has been removed.
+	cache.InvalidateFolder(L"C:\\Folder");
+	EXPECT_EQ(Get(cache, L"C:\\Folder", ALL_CONTENTS), nullptr);
+	ASSERT_EQ(items->size(), 2U);
+	EXPECT_EQ((*items)[1].parsingName, L"file.txt");
+}
+
+TEST(FolderEnumerationCacheKeyTest, SharedPath)
+{
+	// Different folders can have the same parsing path, so each should have its own entry.
+	FolderEnumerationCache cache(1024 * 1024);
+	PidlAbsolute pidl1 = CreateSimplePidlForTest(L"C:\\Users\\User\\Desktop");
+	PidlAbsolute pidl2 = CreateSimplePidlForTest(L"C:\\Desktop");
+	const std::wstring path = L"C:\\Users\\User\\Desktop";
+
+	FolderEnumerationCache::ItemList items;
+	items.push_back(MakeItem(L"file.txt", 0));
+	cache.Insert(pidl1.Raw(), path, ALL_CONTENTS, std::move(items), cache.GetGeneration());
+	cache.Insert(pidl2.Raw(), path, ALL_CONTENTS, MakeItems(), cache.GetGeneration());
+	EXPECT_EQ(cache.GetNumFolders(), 2U);
+
+	auto items1 = cache.Get(pidl1.Raw(), path, ALL_CONTENTS);
+	ASSERT_NE(items1, nullptr);
+	EXPECT_EQ(items1->size(), 1U);
+
+	auto items2 = cache.Get(pidl2.Raw(), path, ALL_CONTENTS);
+	ASSERT_NE(items2, nullptr);
+	EXPECT_EQ(items2->size(), 2U);
+
+	// A change to the path affects both folders.
+	cache.InvalidateFolder(path);
+	EXPECT_EQ(cache.GetNumFolders(), 0U);
+}
@@ -0,0 +1,256 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/FolderSize.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+namespace
+{
+
+const FolderInfo FOLDER_INFO_1 = { 100, 1, 2 };
+const FolderInfo FOLDER_INFO_2 = { 200, 3, 4 };
+
+void WriteFile(const std::filesystem::path &path, size_t size)
+{
+	std::ofstream(path, std::ios::binary) << std::string(size, 'a');
+}
+
+}
+
+class FolderSizeCacheTest : public Test
+{
+protected:
+	FolderSizeCacheTest() : m_cache(100)
+	{
+		for (const auto *path : { L"C:\\Root", L"C:\\Root\\Folder", L"C:\\Root\\Folder\\Subfolder",
+				 L"C:\\Root\\Other", L"C:\\Root\\Folder2" })
+		{
+			m_cache.Insert(path, FOLDER_INFO_1, m_cache.GetGeneration());
+		}
+	}
+
+	FolderSizeCache m_cache;
+};
+
+TEST_F(FolderSizeCacheTest, Get)
+{
+	EXPECT_EQ(m_cache.GetSize(), 5U);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), FOLDER_INFO_1);
+
+	// Paths are compared case-insensitively and any trailing separator is ignored.
+	EXPECT_EQ(m_cache.Get(L"c:\\root\\folder\\"), FOLDER_INFO_1);
+
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Missing"), std::nullopt);
+}
+
+TEST_F(FolderSizeCacheTest, InvalidatePath)
+{
+	m_cache.InvalidatePath(L"C:\\Root\\Folder\\file.txt");
+
+	// Each of the ancestors includes the file, so their sizes are no longer valid.
+	EXPECT_EQ(m_cache.Get(L"C:\\Root"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), std::nullopt);
+
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder"), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Other"), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder2"), FOLDER_INFO_1);
+}
+
+TEST_F(FolderSizeCacheTest, InvalidateTree)
+{
+	m_cache.InvalidateTree(L"C:\\Root\\Folder");
+
+	EXPECT_EQ(m_cache.Get(L"C:\\Root"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder"), std::nullopt);
+
+	// A folder that shares a prefix with the invalidated folder isn't one of its descendants.
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder2"), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Other"), FOLDER_INFO_1);
+}
+
+TEST_F(FolderSizeCacheTest, MarkTreeStale)
+{
+	auto generation = m_cache.GetGeneration();
+
+	m_cache.MarkTreeStale(L"C:\\Root\\Folder");
+
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder", true), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder", true), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.GetSize(), 5U);
+
+	EXPECT_EQ(m_cache.Get(L"C:\\Root"), FOLDER_INFO_1);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder2"), FOLDER_INFO_1);
+
+	// A size that was being calculated when the entries were marked as stale is discarded.
+	m_cache.Insert(L"C:\\Root\\Folder", FOLDER_INFO_2, generation);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), std::nullopt);
+
+	// A newly calculated size replaces the stale entry.
+	m_cache.Insert(L"C:\\Root\\Folder", FOLDER_INFO_2, m_cache.GetGeneration());
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), FOLDER_INFO_2);
+
+	// Stale entries are still removed by an invalidation.
+	m_cache.InvalidateTree(L"C:\\Root\\Folder");
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder", true), std::nullopt);
+}
+
+TEST_F(FolderSizeCacheTest, InsertAfterInvalidation)
+{
+	auto generation = m_cache.GetGeneration();
+
+	m_cache.InvalidatePath(L"C:\\Root\\Folder\\Subfolder\\file.txt");
+
+	// The invalidation may have occurred after these sizes were calculated, so they're discarded.
+	m_cache.Insert(L"C:\\Root\\Folder", FOLDER_INFO_2, generation);
+	m_cache.Insert(L"C:\\Root\\Folder\\Subfolder", FOLDER_INFO_2, generation);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), std::nullopt);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder"), std::nullopt);
+
+	// These sizes aren't affected by the invalidation.
+	m_cache.Insert(L"C:\\Root\\Other", FOLDER_INFO_2, generation);
+	m_cache.Insert(L"C:\\Root\\Folder\\Subfolder\\Nested", FOLDER_INFO_2, generation);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Other"), FOLDER_INFO_2);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder\\Nested"), FOLDER_INFO_2);
+
+	// Sizes calculated after the invalidation can be cached.
+	m_cache.Insert(L"C:\\Root\\Folder", FOLDER_INFO_2, m_cache.GetGeneration());
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder"), FOLDER_INFO_2);
+}
+
+TEST_F(FolderSizeCacheTest, InsertAfterTreeInvalidation)
+{
+	auto generation = m_cache.GetGeneration();
+
+	m_cache.InvalidateTree(L"C:\\Root\\Folder");
+
+	m_cache.Insert(L"C:\\Root\\Folder\\Subfolder", FOLDER_INFO_2, generation);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Folder\\Subfolder"), std::nullopt);
+}
+
+TEST_F(FolderSizeCacheTest, InsertAfterManyInvalidations)
+{
+	auto generation = m_cache.GetGeneration();
+
+	for (int i = 0; i < 2000; i++)
+	{
+		m_cache.InvalidatePath(L"D:\\Unrelated\\" + std::to_wstring(i));
+	}
+
+	// Too many invalidations have been made for them to all have been recorded, so it's not
+	// possible to say whether the size is still valid.
+	m_cache.Insert(L"C:\\Root\\Other", FOLDER_INFO_2, generation);
+	EXPECT_EQ(m_cache.Get(L"C:\\Root\\Other"), FOLDER_INFO_1);
+}
+
+TEST(FolderSizeCacheEvictionTest, Eviction)
+{
+	FolderSizeCache cache(2);
+	cache.Insert(L"C:\\Folder1", FOLDER_INFO_1, cache.GetGeneration());
+	cache.Insert(L"C:\\Folder2", FOLDER_INFO_1, cache.GetGeneration());
+
+	// Folder1 is now the most recently used entry.
+	EXPECT_TRUE(cache.Get(L"C:\\Folder1"));
+
+	cache.Insert(L"C:\\Folder3", FOLDER_INFO_1, cache.GetGeneration());
+	EXPECT_EQ(cache.GetSize(), 2U);
+	EXPECT_TRUE(cache.Get(L"C:\\Folder1"));
+	EXPECT_FALSE(cache.Get(L"C:\\Folder2"));
+	EXPECT_TRUE(cache.Get(L"C:\\Folder3"));
+}
+
+class CalculateFolderInfoTest : public Test
+{
+protected:
+	CalculateFolderInfoTest() :
+		m_rootDirectory(L"CalculateFolderInfoTest"),
+		m_rootPath(m_rootDirectory.GetPath()),
+		m_executor(4)
+	{
+		std::filesystem::create_directories(m_rootPath / L"Folder1" / L"Subfolder" / L"Nested");
+		std::filesystem::create_directories(m_rootPath / L"Folder2");
+		WriteFile(m_rootPath / L"file1", 10);
+		WriteFile(m_rootPath / L"Folder1" / L"file2", 20);
+		WriteFile(m_rootPath / L"Folder1" / L"Subfolder" / L"file3", 30);
+		WriteFile(m_rootPath / L"Folder1" / L"Subfolder" / L"Nested" / L"file4", 40);
+		WriteFile(m_rootPath / L"Folder2" / L"file5", 50);
+	}
+
+	std::wstring GetPath(const std::filesystem::path &relativePath = {}) const
+	{
+		return (m_rootPath / relativePath).make_preferred().wstring();
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_rootPath;
+	WorkStealingExecutor m_executor;
+};
+
+TEST_F(CalculateFolderInfoTest, Calculate)
+{
+	auto folderInfo = CalculateFolderInfo(GetPath(), &m_executor, nullptr);
+	EXPECT_EQ(folderInfo, (FolderInfo{ 150, 4, 5 }));
+
+	folderInfo = CalculateFolderInfo(GetPath(L"Folder1"), &m_executor, nullptr);
+	EXPECT_EQ(folderInfo, (FolderInfo{ 90, 2, 3 }));
+
+	folderInfo = CalculateFolderInfo(GetPath(L"Missing"), &m_executor, nullptr);
+	EXPECT_EQ(folderInfo, FolderInfo{});
+}
+
+TEST_F(CalculateFolderInfoTest, Cache)
+{
+	FolderSizeCache cache(100);
+
+	auto folderInfo = CalculateFolderInfo(GetPath(), &m_executor, &cache);
+	EXPECT_EQ(folderInfo, (FolderInfo{ 150, 4, 5 }));
+
+	// The sizes of the subfolders are cached as well.
+	EXPECT_EQ(cache.Get(GetPath()), (FolderInfo{ 150, 4, 5 }));
+	EXPECT_EQ(cache.Get(GetPath(L"Folder1")), (FolderInfo{ 90, 2, 3 }));
+	EXPECT_EQ(cache.Get(GetPath(L"Folder1/Subfolder")), (FolderInfo{ 70, 1, 2 }));
+	EXPECT_EQ(cache.Get(GetPath(L"Folder2")), (FolderInfo{ 50, 0, 1 }));
+
+	// Until it's invalidated, the cached size is used.
+	WriteFile(m_rootPath / L"Folder1" / L"file2", 120);
+	folderInfo = CalculateFolderInfo(GetPath(), &m_executor, &cache);
+	EXPECT_EQ(folderInfo, (FolderInfo{ 150, 4, 5 }));
+
+	cache.InvalidatePath(GetPath(L"Folder1/file2"));
+	EXPECT_EQ(cache.Get(GetPath(L"Folder1")), std::nullopt);
+
+	// Only Folder1 needs to be enumerated again. The other sizes come from the cache.
+	WriteFile(m_rootPath / L"Folder2" / L"file5", 150);
+	folderInfo = CalculateFolderInfo(GetPath(), &m_executor, &cache);
+	EXPECT_EQ(folderInfo, (FolderInfo{ 250, 4, 5 }));
+}
+
+TEST_F(CalculateFolderInfoTest, Progress)
+{
+	std::vector<FolderInfo> partialResults;
+	auto folderInfo = CalculateFolderInfo(GetPath(), &m_executor, nullptr, nullptr,
+		[&partialResults](const FolderInfo &partialFolderInfo)
+		{ partialResults.push_back(partialFolderInfo); });
+	EXPECT_EQ(folderInfo, (FolderInfo{ 150, 4, 5 }));
+
+	// There's a result for each level of the tree, other than the last.
+	ASSERT_EQ(partialResults.size(), 3U);
+	EXPECT_EQ(partialResults[0], (FolderInfo{ 10, 2, 1 }));
+	EXPECT_EQ(partialResults[1], (FolderInfo{ 80, 3, 3 }));
+	EXPECT_EQ(partialResults[2], (FolderInfo{ 110, 4, 4 }));
+}
+
+TEST_F(CalculateFolderInfoTest, Stop)
+{
+	std::atomic<bool> stop = true;
+	EXPECT_EQ(CalculateFolderInfo(GetPath(), &m_executor, nullptr, &stop), std::nullopt);
+}
@@ -0,0 +1,225 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ItemLookupIndex.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace testing;
+
+namespace
+{
+
+struct TestItem
+{
+	std::string id;
+	std::wstring parsingName;
+};
+
+class ItemLookupIndexTest : public Test
+{
+protected:
+	void AddItem(int internalIndex, const std::string &id, const std::wstring &parsingName)
+	{
+		m_items[internalIndex] = { id, parsingName };
+		m_index.AddOrUpdateItem(internalIndex, id, parsingName);
+	}
+
+	void RemoveItem(int internalIndex)
+	{
+		m_items.erase(internalIndex);
+		m_index.RemoveItem(internalIndex);
+	}
+
+	std::optional<int> FindById(const std::string &id) const
+	{
+		return m_index.FindItemById(id,
+			[this, &id](int internalIndex) { return m_items.at(internalIndex).id == id; });
+	}
+
+	std::optional<int> FindByParsingName(const std::wstring &parsingName) const
+	{
+		return m_index.FindItemByParsingName(parsingName,
+			[this, &parsingName](int internalIndex)
+			{ return m_items.at(internalIndex).parsingName == parsingName; });
+	}
+
+	ItemLookupIndex m_index;
+	std::unordered_map<int, TestItem> m_items;
+};
+
+}
+
+TEST_F(ItemLookupIndexTest, FindItem)
+{
+	AddItem(0, "id0", L"C:\\Folder\\file0.txt");
+	AddItem(1, "id1", L"C:\\Folder\\file1.txt");
+	EXPECT_EQ(m_index.GetNumItems(), 2u);
+
+	EXPECT_EQ(FindById("id0"), 0);
+	EXPECT_EQ(FindById("id1"), 1);
+	EXPECT_EQ(FindById("id2"), std::nullopt);
+
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file0.txt"), 0);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file1.txt"), 1);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file2.txt"), std::nullopt);
+}
+
+TEST_F(ItemLookupIndexTest, RemoveItem)
+{
+	AddItem(0, "id0", L"C:\\Folder\\file0.txt");
+	AddItem(1, "id1", L"C:\\Folder\\file1.txt");
+
+	RemoveItem(0);
+	EXPECT_EQ(m_index.GetNumItems(), 1u);
+	EXPECT_EQ(FindById("id0"), std::nullopt);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file0.txt"), std::nullopt);
+	EXPECT_EQ(FindById("id1"), 1);
+
+	// Removing an item that isn't in the index should have no effect.
+	m_index.RemoveItem(0);
+	m_index.RemoveItem(10);
+	EXPECT_EQ(m_index.GetNumItems(), 1u);
+
+	m_index.Clear();
+	EXPECT_EQ(m_index.GetNumItems(), 0u);
+	EXPECT_EQ(FindById("id1"), std::nullopt);
+}
+
+TEST_F(ItemLookupIndexTest, RenameItem)
+{
+	AddItem(0, "id0", L"C:\\Folder\\file0.txt");
+	AddItem(0, "renamed", L"C:\\Folder\\renamed.txt");
+
+	EXPECT_EQ(m_index.GetNumItems(), 1u);
+	EXPECT_EQ(FindById("id0"), std::nullopt);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file0.txt"), std::nullopt);
+	EXPECT_EQ(FindById("renamed"), 0);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\renamed.txt"), 0);
+}
+
+TEST_F(ItemLookupIndexTest, SharedKeys)
+{
+	// Parsing names are folded, so these items share a key. The match function is then used to
+	// determine which item is being referred to.
+	AddItem(0, "id0", L"C:\\Folder\\file.txt");
+	AddItem(1, "id1", L"C:\\Folder\\FILE.txt");
+
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\file.txt"), 0);
+	EXPECT_EQ(FindByParsingName(L"C:\\Folder\\FILE.txt"), 1);
+
+	auto matchAny = [](int internalIndex)
+	{
+		UNREFERENCED_PARAMETER(internalIndex);
+		return true;
+	};
+
+	auto internalIndex = m_index.FindItemByParsingName(L"c:\\folder\\File.TXT", matchAny);
+	ASSERT_TRUE(internalIndex.has_value());
+	EXPECT_TRUE(*internalIndex == 0 || *internalIndex == 1);
+
+	RemoveItem(0);
+	EXPECT_EQ(m_index.FindItemByParsingName(L"c:\\folder\\File.TXT", matchAny), 1);
+}
+
+// Replays a burst of change notifications (of the kind that would be generated by, for example,
+// an archive being extracted over an existing folder) against a large folder, comparing the cost
+// of looking up each item with the index to the cost of scanning every item.
+TEST(ItemLookupIndexBenchmark, DISABLED_ChangeBurst)
+{
+	const int NUM_ITEMS = 100000;
+	const int NUM_CHANGES = 10000;
+
+	std::unordered_map<int, TestItem> items;
+	ItemLookupIndex index;
+
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		TestItem item = { std::format("item-id-{}", i), std::format(L"C:\\Folder\\file{}.txt", i) };
+		index.AddOrUpdateItem(i, item.id, item.parsingName);
+		items[i] = std::move(item);
+	}
+
+	// Each change is either a modification, rename or removal of a random item.
+	std::vector<int> changedItems(NUM_ITEMS);
+	std::iota(changedItems.begin(), changedItems.end(), 0);
+	std::shuffle(changedItems.begin(), changedItems.end(), std::mt19937(0));
+	changedItems.resize(NUM_CHANGES);
+
+	auto replayChanges = [&changedItems](std::unordered_map<int, TestItem> changedItemsMap,
+							 auto findItem, auto onRemoved, auto onRenamed)
+	{
+		int numFound = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < changedItems.size(); i++)
+		{
+			const auto parsingName = changedItemsMap.at(changedItems[i]).parsingName;
+			auto internalIndex = findItem(changedItemsMap, parsingName);
+
+			if (!internalIndex)
+			{
+				continue;
+			}
+
+			numFound++;
+
+			if (i % 3 == 1)
+			{
+				changedItemsMap.erase(*internalIndex);
+				onRemoved(*internalIndex);
+			}
+			else if (i % 3 == 2)
+			{
+				auto &item = changedItemsMap.at(*internalIndex);
+				item.parsingName += L".renamed";
+				onRenamed(*internalIndex, item);
+			}
+		}
+
+		EXPECT_EQ(numFound, static_cast<int>(changedItems.size()));
+
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start);
+	};
+
+	auto scanDuration = replayChanges(
+		items,
+		[](const auto &itemsMap, const std::wstring &parsingName) -> std::optional<int>
+		{
+			auto itr = std::find_if(itemsMap.begin(), itemsMap.end(),
+				[&parsingName](const auto &pair) { return pair.second.parsingName == parsingName; });
+
+			if (itr == itemsMap.end())
+			{
+				return std::nullopt;
+			}
+
+			return itr->first;
+		},
+		[](int) {}, [](int, const TestItem &) {});
+
+	auto indexDuration = replayChanges(
+		items,
+		[&index](const auto &itemsMap, const std::wstring &parsingName)
+		{
+			return index.FindItemByParsingName(parsingName,
+				[&itemsMap, &parsingName](int internalIndex)
+				{ return itemsMap.at(internalIndex).parsingName == parsingName; });
+		},
+		[&index](int internalIndex) { index.RemoveItem(internalIndex); },
+		[&index](int internalIndex, const TestItem &item)
+		{ index.AddOrUpdateItem(internalIndex, item.id, item.parsingName); });
+
+	std::wcout << std::format(L"{} changes in a folder of {} items: scan {} ms, index {} ms\n",
+		NUM_CHANGES, NUM_ITEMS, scanDuration.count(), indexDuration.count());
+}
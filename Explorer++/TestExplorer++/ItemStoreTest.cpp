@@ -0,0 +1,157 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "ShellBrowser/ItemStore.h"
+#include <gtest/gtest.h>
+
+TEST(ItemStoreTest, AddItems)
+{
+	ItemStore store;
+
+	auto index1 = store.Add({ .name = L"file1.txt",
+		.size = 100,
+		.dateCreated = 1,
+		.dateModified = 2,
+		.dateAccessed = 3,
+		.attributes = FILE_ATTRIBUTE_NORMAL });
+	auto index2 = store.Add({ .name = L"folder", .attributes = FILE_ATTRIBUTE_DIRECTORY });
+
+	EXPECT_NE(index1, index2);
+	EXPECT_EQ(store.GetNumItems(), 2U);
+	EXPECT_EQ(store.GetIndexCount(), 2U);
+
+	EXPECT_EQ(store.GetName(index1), L"file1.txt");
+	EXPECT_STREQ(store.GetName(index1).data(), L"file1.txt");
+	EXPECT_EQ(store.GetSize(index1), 100U);
+	EXPECT_EQ(store.GetDateCreated(index1), 1U);
+	EXPECT_EQ(store.GetDateModified(index1), 2U);
+	EXPECT_EQ(store.GetDateAccessed(index1), 3U);
+	EXPECT_EQ(store.GetAttributes(index1), static_cast<uint32_t>(FILE_ATTRIBUTE_NORMAL));
+
+	EXPECT_EQ(store.GetName(index2), L"folder");
+	EXPECT_EQ(store.GetAttributes(index2), static_cast<uint32_t>(FILE_ATTRIBUTE_DIRECTORY));
+}
+
+TEST(ItemStoreTest, UpdateItem)
+{
+	ItemStore store;
+
+	auto index = store.Add({ .name = L"old name", .size = 1 });
+	auto otherIndex = store.Add({ .name = L"other" });
+
+	store.Update(index, { .name = L"a considerably longer new name", .size = 2 });
+
+	EXPECT_EQ(store.GetName(index), L"a considerably longer new name");
+	EXPECT_EQ(store.GetSize(index), 2U);
+	EXPECT_EQ(store.GetName(otherIndex), L"other");
+	EXPECT_EQ(store.GetUnusedNameBufferSize(), std::wstring_view(L"old name").size() + 1);
+}
+
+TEST(ItemStoreTest, FileName)
+{
+	ItemStore store;
+
+	auto index1 = store.Add({ .name = L"file.txt", .fileName = L"file.txt" });
+	auto index2 = store.Add({ .name = L"Documents", .fileName = L"docs" });
+	auto index3 = store.Add({ .name = L"Recycle Bin" });
+
+	EXPECT_EQ(store.GetFileName(index1), L"file.txt");
+	EXPECT_EQ(store.GetFileName(index2), L"docs");
+	EXPECT_STREQ(store.GetFileName(index2).data(), L"docs");
+	EXPECT_EQ(store.GetFileName(index3), L"Recycle Bin");
+
+	store.Update(index2, { .name = L"Documents" });
+	EXPECT_EQ(store.GetFileName(index2), L"Documents");
+}
+
+TEST(ItemStoreTest, UpdateName)
+{
+	ItemStore store;
+
+	auto index = store.Add({ .name = L"Local Disk (C:)", .fileName = L"C:" });
+
+	store.UpdateName(index, L"System (C:)");
+	EXPECT_EQ(store.GetName(index), L"System (C:)");
+	EXPECT_EQ(store.GetFileName(index), L"C:");
+
+	auto otherIndex = store.Add({ .name = L"file" });
+
+	store.UpdateName(otherIndex, L"renamed");
+	EXPECT_EQ(store.GetName(otherIndex), L"renamed");
+	EXPECT_EQ(store.GetFileName(otherIndex), L"file");
+}
+
+TEST(ItemStoreTest, FindDataValid)
+{
+	ItemStore store;
+
+	auto index1 = store.Add({ .name = L"file", .isFindDataValid = true, .size = 10 });
+	auto index2 = store.Add({ .name = L"virtual item" });
+
+	EXPECT_TRUE(store.IsFindDataValid(index1));
+	EXPECT_FALSE(store.IsFindDataValid(index2));
+
+	store.Update(index1, { .name = L"file" });
+	EXPECT_FALSE(store.IsFindDataValid(index1));
+}
+
+TEST(ItemStoreTest, RemoveItem)
+{
+	ItemStore store;
+
+	auto index1 = store.Add({ .name = L"file1" });
+	auto index2 = store.Add({ .name = L"file2" });
+
+	store.Remove(index1);
+
+	EXPECT_FALSE(store.IsValid(index1));
+	EXPECT_TRUE(store.IsValid(index2));
+	EXPECT_EQ(store.GetNumItems(), 1U);
+
+	// Indexes aren't reused, so the next item should receive a new index.
+	auto index3 = store.Add({ .name = L"file3" });
+	EXPECT_NE(index3, index1);
+	EXPECT_EQ(store.GetIndexCount(), 3U);
+	EXPECT_EQ(store.GetName(index2), L"file2");
+	EXPECT_EQ(store.GetName(index3), L"file3");
+}
+
+TEST(ItemStoreTest, NamesPreservedAfterCompaction)
+{
+	ItemStore store;
+
+	std::vector<ItemStore::Index> indexes;
+	std::wstring longName(1000, 'a');
+
+	for (int i = 0; i < 200; i++)
+	{
+		indexes.push_back(store.Add({ .name = longName + std::to_wstring(i) }));
+	}
+
+	// Removing most of the items should result in the name buffer being compacted.
+	for (int i = 0; i < 190; i++)
+	{
+		store.Remove(indexes[i]);
+	}
+
+	EXPECT_LT(store.GetUnusedNameBufferSize(), 190U * longName.size());
+
+	for (int i = 190; i < 200; i++)
+	{
+		EXPECT_EQ(store.GetName(indexes[i]), longName + std::to_wstring(i));
+	}
+}
+
+TEST(ItemStoreTest, Clear)
+{
+	ItemStore store;
+
+	auto index = store.Add({ .name = L"file" });
+	store.Clear();
+
+	EXPECT_FALSE(store.IsValid(index));
+	EXPECT_EQ(store.GetNumItems(), 0U);
+	EXPECT_EQ(store.GetIndexCount(), 0U);
+}
@@ -0,0 +1,71 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/LruCache.h"
+#include <gtest/gtest.h>
+
+TEST(LruCacheTest, InsertAndGet)
+{
+	LruCache<int, std::wstring> cache(2);
+
+	cache.Insert(1, L"one");
+	cache.Insert(2, L"two");
+
+	ASSERT_NE(cache.Get(1), nullptr);
+	EXPECT_EQ(*cache.Get(1), L"one");
+	ASSERT_NE(cache.Get(2), nullptr);
+	EXPECT_EQ(*cache.Get(2), L"two");
+	EXPECT_EQ(cache.Get(3), nullptr);
+	EXPECT_EQ(cache.GetSize(), 2U);
+}
+
+TEST(LruCacheTest, ReplaceValue)
+{
+	LruCache<int, std::wstring> cache(2);
+
+	cache.Insert(1, L"one");
+	cache.Insert(1, L"updated");
+
+	ASSERT_NE(cache.Get(1), nullptr);
+	EXPECT_EQ(*cache.Get(1), L"updated");
+	EXPECT_EQ(cache.GetSize(), 1U);
+}
+
+TEST(LruCacheTest, EvictLeastRecentlyUsed)
+{
+	LruCache<int, std::wstring> cache(2);
+
+	cache.Insert(1, L"one");
+	cache.Insert(2, L"two");
+
+	// Retrieving the first entry makes the second entry the least recently used.
+	cache.Get(1);
+
+	cache.Insert(3, L"three");
+
+	EXPECT_TRUE(cache.Contains(1));
+	EXPECT_FALSE(cache.Contains(2));
+	EXPECT_TRUE(cache.Contains(3));
+	EXPECT_EQ(cache.GetSize(), 2U);
+}
+
+TEST(LruCacheTest, Remove)
+{
+	LruCache<int, std::wstring> cache(3);
+
+	cache.Insert(1, L"one");
+	cache.Insert(2, L"two");
+	cache.Insert(3, L"three");
+
+	cache.Remove(2);
+	EXPECT_FALSE(cache.Contains(2));
+
+	cache.RemoveIf([](int key, const std::wstring &value) { return key == 1 || value == L"three"; });
+	EXPECT_EQ(cache.GetSize(), 0U);
+
+	cache.Insert(4, L"four");
+	cache.Clear();
+	EXPECT_FALSE(cache.Contains(4));
+}
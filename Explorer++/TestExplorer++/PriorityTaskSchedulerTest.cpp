@@ -0,0 +1,245 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+using namespace testing;
+
+class PriorityTaskSchedulerTest : public Test
+{
+protected:
+	PriorityTaskSchedulerTest() : m_executor(2), m_scheduler(&m_executor, 1)
+	{
+	}
+
+	// Occupies the scheduler's single concurrent task slot until the returned promise is fulfilled, so that the
+	// order in which subsequently queued tasks run can be checked.
+	std::promise<void> BlockWorker()
+	{
+		std::promise<void> unblock;
+		auto started = std::make_shared<std::promise<void>>();
+		auto startedFuture = started->get_future();
+
+		m_scheduler.QueueTask(&m_blockOwner, 0, 0,
+			[unblockFuture = unblock.get_future().share(), started]()
+			{
+				started->set_value();
+				unblockFuture.wait();
+			});
+
+		startedFuture.wait();
+
+		return unblock;
+	}
+
+	void QueueRecordingTask(uint64_t id, PriorityTaskScheduler::Priority priority)
+	{
+		auto future = m_scheduler.QueueTask(&m_owner, id, priority,
+			[this, id]()
+			{
+				std::scoped_lock lock(m_mutex);
+				m_executionOrder.push_back(id);
+			});
+
+		if (future)
+		{
+			m_futures.push_back(std::move(*future));
+		}
+	}
+
+	void WaitForTasks()
+	{
+		for (auto &future : m_futures)
+		{
+			future.wait();
+		}
+	}
+
+	int m_owner = 0;
+	int m_blockOwner = 0;
+	std::vector<std::future<void>> m_futures;
+	std::mutex m_mutex;
+	std::vector<uint64_t> m_executionOrder;
+
+	// These are declared last, so that any running tasks finish before the members above are
+	// destroyed.
+	WorkStealingExecutor m_executor;
+	PriorityTaskScheduler m_scheduler;
+};
+
+TEST_F(PriorityTaskSchedulerTest, RunsInPriorityOrder)
+{
+	auto unblock = BlockWorker();
+
+	QueueRecordingTask(1, 10);
+	QueueRecordingTask(2, 5);
+	QueueRecordingTask(3, 10);
+	QueueRecordingTask(4, 0);
+
+	unblock.set_value();
+	WaitForTasks();
+
+	EXPECT_EQ(m_executionOrder, (std::vector<uint64_t>{ 4, 2, 1, 3 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, Deduplication)
+{
+	auto unblock = BlockWorker();
+
+	QueueRecordingTask(1, 10);
+	QueueRecordingTask(2, 5);
+
+	// This is identical to the first task, so it shouldn't be queued. However, the priority of the
+	// existing task should be raised.
+	auto duplicate = m_scheduler.QueueTask(&m_owner, 1, 0, []() {});
+	EXPECT_FALSE(duplicate);
+
+	// A task with the same ID, but a different owner, is a separate task.
+	auto otherOwner = m_scheduler.QueueTask(&m_blockOwner, 1, 20, []() {});
+	EXPECT_TRUE(otherOwner);
+
+	unblock.set_value();
+	WaitForTasks();
+	otherOwner->wait();
+
+	EXPECT_EQ(m_executionOrder, (std::vector<uint64_t>{ 1, 2 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, UpdatePriorities)
+{
+	auto unblock = BlockWorker();
+
+	QueueRecordingTask(1, 0);
+	QueueRecordingTask(2, 1);
+	QueueRecordingTask(3, 2);
+	QueueRecordingTask(4, 3);
+
+	auto cancelledIds = m_scheduler.UpdatePriorities(&m_owner,
+		[](uint64_t id, PriorityTaskScheduler::Priority currentPriority)
+			-> std::optional<PriorityTaskScheduler::Priority>
+		{
+			if (id == 2)
+			{
+				return std::nullopt;
+			}
+
+			// Reverses the order of the remaining tasks.
+			return -currentPriority;
+		});
+
+	EXPECT_EQ(cancelledIds, (std::vector<uint64_t>{ 2 }));
+
+	unblock.set_value();
+
+	// Waiting on the future for a cancelled task would throw, so only the futures for the
+	// remaining tasks are checked.
+	m_futures.erase(m_futures.begin() + 1);
+	WaitForTasks();
+
+	EXPECT_EQ(m_executionOrder, (std::vector<uint64_t>{ 4, 3, 1 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, CancelTasks)
+{
+	auto unblock = BlockWorker();
+
+	QueueRecordingTask(1, 0);
+	QueueRecordingTask(2, 0);
+
+	m_scheduler.CancelTasks(&m_owner);
+
+	// A task that was cancelled can be queued again.
+	QueueRecordingTask(2, 0);
+
+	unblock.set_value();
+	m_futures.back().wait();
+
+	EXPECT_EQ(m_executionOrder, (std::vector<uint64_t>{ 2 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, TaskDestroyedBeforeCompletion)
+{
+	auto capture = std::make_shared<int>(0);
+	std::weak_ptr<int> weakCapture = capture;
+
+	auto future = m_scheduler.QueueTask(&m_owner, 1, 0, [capture = std::move(capture)]() {});
+	ASSERT_TRUE(future);
+	future->wait();
+
+	// Anything the task captured should have been destroyed by the time its result is available.
+	EXPECT_TRUE(weakCapture.expired());
+}
+
+TEST(PriorityTaskSchedulerWaitTest, CancelTasksWaitsForRunningTasks)
+{
+	WorkStealingExecutor executor(4);
+	PriorityTaskScheduler scheduler(&executor, 4);
+	int owner = 0;
+	std::atomic<int> numFinished = 0;
+	std::atomic<int> numStarted = 0;
+
+	for (uint64_t i = 0; i < 4; i++)
+	{
+		scheduler.QueueTask(&owner, i, 0,
+			[&numFinished, &numStarted]()
+			{
+				numStarted++;
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				numFinished++;
+			});
+	}
+
+	while (numStarted < 4)
+	{
+		std::this_thread::yield();
+	}
+
+	scheduler.CancelTasks(&owner, true);
+	EXPECT_EQ(numFinished, 4);
+}
+
+TEST(PriorityTaskSchedulerWaitTest, MaxConcurrentTasks)
+{
+	WorkStealingExecutor executor(4);
+	PriorityTaskScheduler scheduler(&executor, 2);
+	EXPECT_EQ(scheduler.GetMaxConcurrentTasks(), 2);
+
+	int owner = 0;
+	std::mutex mutex;
+	int numRunning = 0;
+	int maxRunning = 0;
+	std::vector<std::future<void>> futures;
+
+	for (uint64_t i = 0; i < 8; i++)
+	{
+		auto future = scheduler.QueueTask(&owner, i, 0,
+			[&mutex, &numRunning, &maxRunning]()
+			{
+				{
+					std::scoped_lock lock(mutex);
+					numRunning++;
+					maxRunning = std::max(maxRunning, numRunning);
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				std::scoped_lock lock(mutex);
+				numRunning--;
+			});
+		futures.push_back(std::move(*future));
+	}
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_LE(maxRunning, 2);
+}
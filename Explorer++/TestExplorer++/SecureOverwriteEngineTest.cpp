@@ -0,0 +1,202 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/SecureOverwriteEngine.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace testing;
+
+namespace
+{
+
+const DWORD BLOCK_SIZE = 4096;
+const size_t FILE_SIZE = (BLOCK_SIZE * 3) + 123;
+
+}
+
+class SecureOverwriteEngineTest : public Test
+{
+protected:
+	SecureOverwriteEngineTest() :
+		m_rootDirectory(L"SecureOverwriteEngineTest"),
+		m_rootPath(m_rootDirectory.GetPath()),
+		m_data(GenerateData(FILE_SIZE)),
+		m_executor(3)
+	{
+	}
+
+	std::wstring CreateTestFile(const std::wstring &name) const
+	{
+		auto path = m_rootPath / name;
+		std::ofstream(path, std::ios::binary) << m_data;
+		return path.wstring();
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_rootPath;
+	const std::string m_data;
+	WorkStealingExecutor m_executor;
+};
+
+TEST_F(SecureOverwriteEngineTest, OverwriteFile)
+{
+	std::wstring path = CreateTestFile(L"file");
+
+	uint64_t overwriteSize;
+	ASSERT_HRESULT_SUCCEEDED(SecureOverwriteEngine::GetOverwriteSize(path, overwriteSize));
+	EXPECT_GE(overwriteSize, FILE_SIZE);
+
+	SecureOverwriteEngine engine(nullptr, BLOCK_SIZE);
+
+	// The file should be extended to the end of its last cluster and every byte, up to that point,
+	// should be overwritten.
+	HRESULT hr = engine.OverwriteFile(path, { SecureOverwriteEngine::Pattern::Ones }, nullptr);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(ReadFileContents(path), std::string(static_cast<size_t>(overwriteSize), '\xFF'));
+
+	hr = engine.OverwriteFile(path, { SecureOverwriteEngine::Pattern::Zeros }, nullptr);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	EXPECT_EQ(ReadFileContents(path), std::string(static_cast<size_t>(overwriteSize), '\0'));
+
+	hr = engine.OverwriteFile(path, { SecureOverwriteEngine::Pattern::Random }, nullptr);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	// Each block should be filled with different data.
+	std::string contents = ReadFileContents(path);
+	ASSERT_EQ(contents.size(), overwriteSize);
+	EXPECT_NE(contents.substr(0, BLOCK_SIZE), contents.substr(BLOCK_SIZE, BLOCK_SIZE));
+	EXPECT_NE(contents.substr(0, BLOCK_SIZE), std::string(BLOCK_SIZE, '\0'));
+}
+
+TEST_F(SecureOverwriteEngineTest, DestroyFiles)
+{
+	std::vector<std::wstring> paths;
+
+	for (int i = 0; i < 5; i++)
+	{
+		paths.push_back(CreateTestFile(L"file" + std::to_wstring(i)));
+	}
+
+	// Folders should be left as they are.
+	std::filesystem::create_directory(m_rootPath / L"folder");
+	paths.push_back((m_rootPath / L"folder").wstring());
+
+	// The budget allows for two files to be written at once.
+	SecureOverwriteEngine engine(&m_executor, BLOCK_SIZE, BLOCK_SIZE * 2);
+
+	std::atomic<bool> stop = false;
+	SecureOverwriteEngine::Progress finalProgress = {};
+	HRESULT hr = engine.DestroyFiles(paths,
+		{ SecureOverwriteEngine::Pattern::Zeros, SecureOverwriteEngine::Pattern::Ones,
+			SecureOverwriteEngine::Pattern::Random },
+		stop,
+		[&finalProgress](const SecureOverwriteEngine::Progress &progress)
+		{ finalProgress = progress; });
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	for (int i = 0; i < 5; i++)
+	{
+		EXPECT_FALSE(std::filesystem::exists(paths[i]));
+	}
+
+	EXPECT_TRUE(std::filesystem::exists(m_rootPath / L"folder"));
+
+	EXPECT_EQ(finalProgress.filesDestroyed, 5U);
+	EXPECT_EQ(finalProgress.totalFiles, 6U);
+	EXPECT_EQ(finalProgress.bytesOverwritten, finalProgress.totalBytes);
+	EXPECT_GE(finalProgress.totalBytes, FILE_SIZE * 5 * 3);
+}
+
+TEST_F(SecureOverwriteEngineTest, MissingFile)
+{
+	std::wstring path = CreateTestFile(L"file");
+
+	SecureOverwriteEngine engine(&m_executor, BLOCK_SIZE);
+
+	// The file that does exist should still be destroyed.
+	std::atomic<bool> stop = false;
+	HRESULT hr = engine.DestroyFiles({ (m_rootPath / L"missing").wstring(), path },
+		{ SecureOverwriteEngine::Pattern::Zeros }, stop, nullptr);
+	EXPECT_HRESULT_FAILED(hr);
+	EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST_F(SecureOverwriteEngineTest, Stop)
+{
+	std::wstring path = CreateTestFile(L"file");
+
+	SecureOverwriteEngine engine(nullptr, BLOCK_SIZE);
+
+	std::atomic<bool> stop = false;
+	HRESULT hr = engine.DestroyFiles({ path }, { SecureOverwriteEngine::Pattern::Zeros }, stop,
+		[&stop](const SecureOverwriteEngine::Progress &progress)
+		{
+			if (progress.bytesOverwritten >= BLOCK_SIZE)
+			{
+				stop = true;
+			}
+		});
+	EXPECT_EQ(hr, E_ABORT);
+
+	// A file that's only been partially overwritten shouldn't be deleted.
+	std::string contents = ReadFileContents(path);
+	ASSERT_GE(contents.size(), FILE_SIZE);
+	EXPECT_EQ(contents.substr(0, BLOCK_SIZE), std::string(BLOCK_SIZE, '\0'));
+	EXPECT_EQ(contents.substr(BLOCK_SIZE, FILE_SIZE - BLOCK_SIZE), m_data.substr(BLOCK_SIZE));
+}
+
+// Measures the throughput of each type of pass. This is disabled by default, since it writes a
+// large file to the temporary directory. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=SecureOverwriteEngineBenchmark.*
+TEST(SecureOverwriteEngineBenchmark, DISABLED_Throughput)
+{
+	const uint64_t benchmarkFileSize = 256 * 1024 * 1024;
+
+	auto path = std::filesystem::temp_directory_path() / L"SecureOverwriteEngineBenchmark";
+
+	{
+		std::ofstream stream(path, std::ios::binary);
+		std::string block(SecureOverwriteEngine::DEFAULT_BLOCK_SIZE, 'a');
+
+		for (uint64_t written = 0; written < benchmarkFileSize; written += block.size())
+		{
+			stream << block;
+		}
+	}
+
+	SecureOverwriteEngine engine;
+
+	const std::pair<SecureOverwriteEngine::Pattern, const char *> patterns[] = {
+		{ SecureOverwriteEngine::Pattern::Zeros, "Zeros" },
+		{ SecureOverwriteEngine::Pattern::Ones, "Ones" },
+		{ SecureOverwriteEngine::Pattern::Random, "Random" }
+	};
+
+	for (const auto &[pattern, name] : patterns)
+	{
+		uint64_t bytesOverwritten = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		HRESULT hr = engine.OverwriteFile(path.wstring(), { pattern },
+			[&bytesOverwritten](uint64_t bytesOverwrittenSoFar)
+			{
+				bytesOverwritten = bytesOverwrittenSoFar;
+				return true;
+			});
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+		ASSERT_HRESULT_SUCCEEDED(hr);
+
+		double megabytesPerSecond =
+			(static_cast<double>(bytesOverwritten) / (1024 * 1024)) / elapsed.count();
+		std::cout << name << ": " << megabytesPerSecond << " MB/s" << std::endl;
+	}
+
+	std::filesystem::remove(path);
+}
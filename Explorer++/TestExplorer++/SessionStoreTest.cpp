@@ -0,0 +1,231 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/SessionStore.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class SessionStoreTest : public Test
+{
+protected:
+	SessionStoreTest() :
+		m_rootDirectory(L"SessionStoreTest"),
+		m_filePath(m_rootDirectory.GetPath() / L"SessionStoreTest.dat"),
+		m_journalPath(m_rootDirectory.GetPath() / L"SessionStoreTest.dat.journal")
+	{
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_filePath;
+	const std::filesystem::path m_journalPath;
+};
+
+TEST_F(SessionStoreTest, SetAndGet)
+{
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	EXPECT_EQ(store->GetSection(1), nullptr);
+
+	store->SetSection(1, "tabs");
+	store->SetSection(2, std::string("bookmarks\0data", 14));
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), "tabs");
+	ASSERT_NE(store->GetSection(2), nullptr);
+	EXPECT_EQ(*store->GetSection(2), std::string("bookmarks\0data", 14));
+}
+
+TEST_F(SessionStoreTest, Reopen)
+{
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		store->SetSection(1, "tabs");
+		store->SetSection(2, "bookmarks");
+		EXPECT_TRUE(store->Commit());
+
+		store->SetSection(1, "updated tabs");
+		EXPECT_TRUE(store->Commit());
+
+		// The store is opened exclusively.
+		EXPECT_EQ(SessionStore::Open(m_filePath.wstring()), nullptr);
+	}
+
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), "updated tabs");
+	ASSERT_NE(store->GetSection(2), nullptr);
+	EXPECT_EQ(*store->GetSection(2), "bookmarks");
+}
+
+TEST_F(SessionStoreTest, OnlyChangedSectionsWritten)
+{
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	store->SetSection(1, std::string(1000, 'a'));
+	store->SetSection(2, std::string(1000, 'b'));
+	EXPECT_TRUE(store->Commit());
+
+	auto journalSize = store->GetJournalSize();
+
+	// Neither section has changed, so nothing should be written.
+	store->SetSection(1, std::string(1000, 'a'));
+	store->SetSection(2, std::string(1000, 'b'));
+	EXPECT_TRUE(store->Commit());
+	EXPECT_EQ(store->GetJournalSize(), journalSize);
+
+	// Only the second section should be appended to the journal.
+	store->SetSection(2, "b");
+	EXPECT_TRUE(store->Commit());
+	EXPECT_GT(store->GetJournalSize(), journalSize);
+	EXPECT_LT(store->GetJournalSize(), journalSize + 100);
+}
+
+TEST_F(SessionStoreTest, IncompleteRecordDiscarded)
+{
+	uintmax_t journalSize;
+
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		store->SetSection(1, "tabs");
+		EXPECT_TRUE(store->Commit());
+
+		journalSize = store->GetJournalSize();
+
+		store->SetSection(1, std::string(100, 'x'));
+		EXPECT_TRUE(store->Commit());
+	}
+
+	// Simulates the application being terminated part way through writing the second record.
+	std::filesystem::resize_file(m_journalPath, journalSize + 50);
+
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), "tabs");
+	EXPECT_EQ(store->GetJournalSize(), journalSize);
+}
+
+TEST_F(SessionStoreTest, CorruptRecordDiscarded)
+{
+	uintmax_t journalSize;
+
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		store->SetSection(1, "tabs");
+		EXPECT_TRUE(store->Commit());
+
+		journalSize = store->GetJournalSize();
+
+		store->SetSection(1, "more tabs");
+		EXPECT_TRUE(store->Commit());
+	}
+
+	{
+		std::fstream journal(m_journalPath, std::ios::in | std::ios::out | std::ios::binary);
+		journal.seekp(-1, std::ios::end);
+		journal.put('?');
+	}
+
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), "tabs");
+	EXPECT_EQ(store->GetJournalSize(), journalSize);
+}
+
+TEST_F(SessionStoreTest, Compaction)
+{
+	const size_t SECTION_SIZE = 256 * 1024;
+
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		store->SetSection(1, "bookmarks");
+
+		// Each of these commits appends to the journal. Eventually, the journal should be compacted
+		// into the snapshot.
+		for (char c = 'a'; c <= 'j'; c++)
+		{
+			store->SetSection(2, std::string(SECTION_SIZE, c));
+			EXPECT_TRUE(store->Commit());
+		}
+
+		EXPECT_LT(store->GetJournalSize(), 1024U * 1024U);
+		EXPECT_TRUE(std::filesystem::exists(m_filePath));
+	}
+
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), "bookmarks");
+	ASSERT_NE(store->GetSection(2), nullptr);
+	EXPECT_EQ(*store->GetSection(2), std::string(SECTION_SIZE, 'j'));
+}
+
+TEST_F(SessionStoreTest, StaleJournalIgnored)
+{
+	uintmax_t journalSize;
+
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		store->SetSection(1, "tabs");
+		EXPECT_TRUE(store->Commit());
+
+		journalSize = store->GetJournalSize();
+	}
+
+	auto journalCopyPath = m_journalPath;
+	journalCopyPath += L".copy";
+	std::filesystem::copy_file(m_journalPath, journalCopyPath,
+		std::filesystem::copy_options::overwrite_existing);
+
+	{
+		auto store = SessionStore::Open(m_filePath.wstring());
+		ASSERT_NE(store, nullptr);
+
+		// The second commit will cause a new snapshot to be written.
+		store->SetSection(1, std::string(512 * 1024, 'a'));
+		EXPECT_TRUE(store->Commit());
+		store->SetSection(1, std::string(512 * 1024, 'b'));
+		EXPECT_TRUE(store->Commit());
+
+		EXPECT_TRUE(std::filesystem::exists(m_filePath));
+	}
+
+	// Simulates the application being terminated after the new snapshot was written, but before
+	// the journal was emptied. The journal applies to the previous snapshot, so it should be
+	// ignored.
+	std::filesystem::copy_file(journalCopyPath, m_journalPath,
+		std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::remove(journalCopyPath);
+
+	EXPECT_EQ(std::filesystem::file_size(m_journalPath), journalSize);
+
+	auto store = SessionStore::Open(m_filePath.wstring());
+	ASSERT_NE(store, nullptr);
+
+	ASSERT_NE(store->GetSection(1), nullptr);
+	EXPECT_EQ(*store->GetSection(1), std::string(512 * 1024, 'b'));
+}
@@ -0,0 +1,90 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "ShellBrowser/ItemData.h"
+#include "ShellBrowser/SortHelper.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+BasicItemInfo_t BuildItemInfo(const std::wstring &name, uint64_t size, bool isFindDataValid = true)
+{
+	BasicItemInfo_t itemInfo;
+	itemInfo.wfd = {};
+	itemInfo.wfd.nFileSizeLow = static_cast<DWORD>(size);
+	itemInfo.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+	itemInfo.wfd.ftLastWriteTime.dwLowDateTime = static_cast<DWORD>(size);
+	itemInfo.isFindDataValid = isFindDataValid;
+	StringCchCopy(itemInfo.szDisplayName, std::size(itemInfo.szDisplayName), name.c_str());
+	itemInfo.isRoot = false;
+	return itemInfo;
+}
+
+}
+
+TEST(SortHelperTest, SizeKeys)
+{
+	GlobalFolderSettings globalFolderSettings;
+
+	auto key1 =
+		GetSortKey(BuildItemInfo(L"small", 10), SortMode::Size, globalFolderSettings, nullptr);
+	auto key2 = GetSortKey(BuildItemInfo(L"large", 0x100000000), SortMode::Size,
+		globalFolderSettings, nullptr);
+
+	EXPECT_EQ(key1.number, 10U);
+	EXPECT_EQ(key2.number, 0x100000000U);
+	EXPECT_EQ(key1.displayName, L"small");
+	EXPECT_FALSE(key1.isFolder);
+
+	EXPECT_LT(CompareSortKeyValues(key1, key2), 0);
+	EXPECT_GT(CompareSortKeyValues(key2, key1), 0);
+	EXPECT_EQ(CompareSortKeyValues(key1, key1), 0);
+}
+
+TEST(SortHelperTest, InvalidFindDataSortedFirst)
+{
+	GlobalFolderSettings globalFolderSettings;
+
+	auto invalidKey = GetSortKey(BuildItemInfo(L"item1", 100, false), SortMode::DateModified,
+		globalFolderSettings, nullptr);
+	auto validKey = GetSortKey(BuildItemInfo(L"item2", 1), SortMode::DateModified,
+		globalFolderSettings, nullptr);
+
+	EXPECT_LT(CompareSortKeyValues(invalidKey, validKey), 0);
+	EXPECT_GT(CompareSortKeyValues(validKey, invalidKey), 0);
+}
+
+TEST(SortHelperTest, TextKeys)
+{
+	SortKey key1;
+	key1.text = L"file2";
+
+	SortKey key2;
+	key2.text = L"file10";
+
+	// Natural comparison compares the numbers by value.
+	EXPECT_LT(CompareSortKeyValues(key1, key2), 0);
+
+	key1.textComparison = SortKeyTextComparison::CaseInsensitive;
+	key2.textComparison = SortKeyTextComparison::CaseInsensitive;
+	EXPECT_GT(CompareSortKeyValues(key1, key2), 0);
+
+	key2.text = L"FILE2";
+	EXPECT_EQ(CompareSortKeyValues(key1, key2), 0);
+}
+
+TEST(SortHelperTest, RankComparedFirst)
+{
+	SortKey key1;
+	key1.rank = 0;
+	key1.number = 100;
+
+	SortKey key2;
+	key2.rank = 1;
+	key2.number = 1;
+
+	EXPECT_LT(CompareSortKeyValues(key1, key2), 0);
+}
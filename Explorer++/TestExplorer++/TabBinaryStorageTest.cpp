@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "TabBinaryStorage.h"
+#include "ShellTestHelper.h"
+#include "TabStorage.h"
+#include "TabStorageTestHelper.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+class TabBinaryStorageTest : public Test
+{
+protected:
+	std::vector<TabStorageData> BuildReferenceTabs()
+	{
+		std::vector<TabStorageData> referenceTabs;
+		BuildTabStorageLoadSaveReference(referenceTabs);
+
+		// Unlike the config file and the registry, the binary store also contains the history of
+		// each tab.
+		auto &tab = referenceTabs.at(0);
+		tab.history.push_back({ CreateSimplePidlForTest(L"C:\\Windows"), L"Windows",
+			L"C:\\Windows" });
+		tab.history.push_back({ CreateSimplePidlForTest(L"C:\\Windows\\System32"), L"System32",
+			L"C:\\Windows\\System32" });
+		tab.history.push_back({ tab.pidl, L"C:", L"C:\\" });
+		tab.currentHistoryEntry = 1;
+
+		return referenceTabs;
+	}
+};
+
+TEST_F(TabBinaryStorageTest, SaveLoad)
+{
+	auto referenceTabs = BuildReferenceTabs();
+
+	auto data = TabBinaryStorage::Save(referenceTabs);
+	auto loadedTabs = TabBinaryStorage::Load(data);
+
+	ASSERT_TRUE(loadedTabs.has_value());
+	EXPECT_EQ(*loadedTabs, referenceTabs);
+}
+
+TEST_F(TabBinaryStorageTest, InvalidData)
+{
+	auto data = TabBinaryStorage::Save(BuildReferenceTabs());
+
+	// If any part of the data is invalid, none of the tabs should be loaded.
+	EXPECT_FALSE(TabBinaryStorage::Load(data.substr(0, data.size() - 1)).has_value());
+	EXPECT_FALSE(TabBinaryStorage::Load("").has_value());
+}
@@ -21,7 +21,9 @@ bool operator==(const TabStorageData &first, const TabStorageData &second)
 	}
 
 	return areDirectoriesEquivalent && first.tabSettings == second.tabSettings
-		&& first.folderSettings == second.folderSettings && first.columns == second.columns;
+		&& first.folderSettings == second.folderSettings && first.columns == second.columns
+		&& first.history == second.history
+		&& (first.history.empty() || first.currentHistoryEntry == second.currentHistoryEntry);
 }
 
 void BuildTabStorageLoadSaveReference(std::vector<TabStorageData> &outputTabs)
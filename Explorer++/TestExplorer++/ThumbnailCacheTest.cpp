@@ -0,0 +1,241 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "FileTestHelper.h"
+#include "../Helper/ThumbnailCache.h"
+#include "../Helper/ThumbnailStore.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+
+using namespace testing;
+
+namespace
+{
+
+const uint64_t LAST_WRITE_TIME = 100;
+
+ThumbnailBitmap MakeBitmap(uint32_t width, uint32_t height, uint32_t pixel = 0xFF102030)
+{
+	ThumbnailBitmap bitmap;
+	bitmap.width = width;
+	bitmap.height = height;
+	bitmap.pixels.assign(static_cast<size_t>(width) * height, pixel);
+	return bitmap;
+}
+
+}
+
+TEST(ThumbnailCacheTest, GetFromMemory)
+{
+	ThumbnailCache cache(1024 * 1024, nullptr);
+	cache.Insert(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 32));
+
+	auto bitmap = cache.GetFromMemory(L"c:\\folder\\IMAGE.PNG", LAST_WRITE_TIME, 64);
+	ASSERT_NE(bitmap, nullptr);
+	EXPECT_EQ(bitmap->width, 64U);
+	EXPECT_EQ(bitmap->height, 32U);
+
+	// The item has been modified since the thumbnail was extracted.
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\Folder\\image.png", LAST_WRITE_TIME + 1, 64), nullptr);
+
+	// Only a thumbnail of exactly the requested size should be returned.
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 32), nullptr);
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128), nullptr);
+}
+
+TEST(ThumbnailCacheTest, GetDownscalesLargerThumbnail)
+{
+	ThumbnailCache cache(1024 * 1024, nullptr);
+	cache.Insert(L"C:\\image.png", LAST_WRITE_TIME, 256, MakeBitmap(256, 128));
+
+	auto bitmap = cache.Get(L"C:\\image.png", LAST_WRITE_TIME, 64);
+	ASSERT_NE(bitmap, nullptr);
+	EXPECT_EQ(bitmap->width, 64U);
+	EXPECT_EQ(bitmap->height, 32U);
+
+	// The downscaled thumbnail should now be cached as well.
+	EXPECT_EQ(cache.GetNumThumbnails(), 2U);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\image.png", LAST_WRITE_TIME, 64), nullptr);
+
+	// A smaller thumbnail can't be used to produce a larger one.
+	EXPECT_EQ(cache.Get(L"C:\\image.png", LAST_WRITE_TIME, 512), nullptr);
+}
+
+TEST(ThumbnailCacheTest, InsertRemovesOtherVersions)
+{
+	ThumbnailCache cache(1024 * 1024, nullptr);
+	cache.Insert(L"C:\\image.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 64));
+	cache.Insert(L"C:\\image.png", LAST_WRITE_TIME, 128, MakeBitmap(128, 128));
+	cache.Insert(L"C:\\other.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 64));
+	EXPECT_EQ(cache.GetNumThumbnails(), 3U);
+
+	cache.Insert(L"C:\\image.png", LAST_WRITE_TIME + 1, 64, MakeBitmap(64, 64));
+	EXPECT_EQ(cache.GetNumThumbnails(), 2U);
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\image.png", LAST_WRITE_TIME, 128), nullptr);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\image.png", LAST_WRITE_TIME + 1, 64), nullptr);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\other.png", LAST_WRITE_TIME, 64), nullptr);
+}
+
+TEST(ThumbnailCacheTest, Eviction)
+{
+	// Enough room for roughly two thumbnails.
+	ThumbnailCache cache(2 * 64 * 64 * sizeof(uint32_t) + 1024, nullptr);
+	cache.Insert(L"C:\\image1.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 64));
+	cache.Insert(L"C:\\image2.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 64));
+
+	// This marks the first thumbnail as the most recently used.
+	EXPECT_NE(cache.GetFromMemory(L"C:\\image1.png", LAST_WRITE_TIME, 64), nullptr);
+
+	cache.Insert(L"C:\\image3.png", LAST_WRITE_TIME, 64, MakeBitmap(64, 64));
+	EXPECT_EQ(cache.GetNumThumbnails(), 2U);
+	EXPECT_LE(cache.GetMemoryUsage(), 2 * 64 * 64 * sizeof(uint32_t) + 1024);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\image1.png", LAST_WRITE_TIME, 64), nullptr);
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\image2.png", LAST_WRITE_TIME, 64), nullptr);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\image3.png", LAST_WRITE_TIME, 64), nullptr);
+}
+
+TEST(ThumbnailCacheTest, Downscale)
+{
+	ThumbnailBitmap bitmap;
+	bitmap.width = 4;
+	bitmap.height = 2;
+	bitmap.pixels = { 0xFF000000, 0xFF0000FF, 0x00000000, 0x80404040, 0xFF000000, 0xFF0000FF,
+		0x00000000, 0x80404040 };
+
+	auto scaledBitmap = ThumbnailCache::Downscale(bitmap, 2);
+	EXPECT_EQ(scaledBitmap.width, 2U);
+	EXPECT_EQ(scaledBitmap.height, 1U);
+	EXPECT_EQ(scaledBitmap.pixels, (std::vector<uint32_t>{ 0xFF000080, 0x40202020 }));
+
+	// A bitmap that's already small enough shouldn't be changed.
+	auto unchangedBitmap = ThumbnailCache::Downscale(bitmap, 4);
+	EXPECT_EQ(unchangedBitmap.width, 4U);
+	EXPECT_EQ(unchangedBitmap.height, 2U);
+	EXPECT_EQ(unchangedBitmap.pixels, bitmap.pixels);
+}
+
+class ThumbnailStoreTest : public Test
+{
+protected:
+	ThumbnailStoreTest() :
+		m_rootDirectory(L"ThumbnailStoreTest"),
+		m_filePath(m_rootDirectory.GetPath() / L"ThumbnailStoreTest.dat")
+	{
+	}
+
+	const TemporaryDirectory m_rootDirectory;
+	const std::filesystem::path m_filePath;
+};
+
+TEST_F(ThumbnailStoreTest, WriteAndRead)
+{
+	auto store = ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024);
+	ASSERT_NE(store, nullptr);
+
+	EXPECT_TRUE(store->Write(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 64, MakeBitmap(64, 32)));
+	EXPECT_TRUE(store->Write(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 256, MakeBitmap(256, 128)));
+	EXPECT_EQ(store->GetNumThumbnails(), 2U);
+
+	auto thumbnail = store->Read(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 64);
+	ASSERT_TRUE(thumbnail);
+	EXPECT_EQ(thumbnail->size, 64U);
+	EXPECT_EQ(thumbnail->bitmap.width, 64U);
+	EXPECT_EQ(thumbnail->bitmap.height, 32U);
+	EXPECT_EQ(thumbnail->bitmap.pixels, MakeBitmap(64, 32).pixels);
+
+	// The closest larger thumbnail should be returned.
+	thumbnail = store->Read(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 128);
+	ASSERT_TRUE(thumbnail);
+	EXPECT_EQ(thumbnail->size, 256U);
+
+	EXPECT_FALSE(store->Read(L"C:\\IMAGE.PNG", LAST_WRITE_TIME + 1, 64));
+	EXPECT_FALSE(store->Read(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 512));
+
+	// Writing a thumbnail for a new version of the item should replace the existing thumbnails.
+	EXPECT_TRUE(store->Write(L"C:\\IMAGE.PNG", LAST_WRITE_TIME + 1, 64, MakeBitmap(64, 32)));
+	EXPECT_EQ(store->GetNumThumbnails(), 1U);
+	EXPECT_FALSE(store->Read(L"C:\\IMAGE.PNG", LAST_WRITE_TIME, 256));
+}
+
+TEST_F(ThumbnailStoreTest, Reopen)
+{
+	{
+		auto store = ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024);
+		ASSERT_NE(store, nullptr);
+		EXPECT_TRUE(store->Write(L"C:\\IMAGE1.PNG", LAST_WRITE_TIME, 64, MakeBitmap(64, 64)));
+		EXPECT_TRUE(store->Write(L"C:\\IMAGE2.PNG", LAST_WRITE_TIME, 64, MakeBitmap(48, 64)));
+
+		// The file is opened exclusively.
+		EXPECT_EQ(ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024), nullptr);
+	}
+
+	auto store = ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024);
+	ASSERT_NE(store, nullptr);
+	EXPECT_EQ(store->GetNumThumbnails(), 2U);
+
+	auto thumbnail = store->Read(L"C:\\IMAGE2.PNG", LAST_WRITE_TIME, 64);
+	ASSERT_TRUE(thumbnail);
+	EXPECT_EQ(thumbnail->bitmap.width, 48U);
+	EXPECT_EQ(thumbnail->bitmap.height, 64U);
+}
+
+TEST_F(ThumbnailStoreTest, ResetWhenFull)
+{
+	// Only has room for three 64x64 thumbnails.
+	auto store = ThumbnailStore::Open(m_filePath.wstring(), 3 * (64 * 64 * sizeof(uint32_t) + 100));
+	ASSERT_NE(store, nullptr);
+
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_TRUE(store->Write(L"C:\\IMAGE" + std::to_wstring(i) + L".PNG", LAST_WRITE_TIME, 64,
+			MakeBitmap(64, 64)));
+	}
+
+	EXPECT_EQ(store->GetNumThumbnails(), 3U);
+
+	EXPECT_TRUE(store->Write(L"C:\\IMAGE3.PNG", LAST_WRITE_TIME, 64, MakeBitmap(64, 64)));
+	EXPECT_EQ(store->GetNumThumbnails(), 1U);
+	EXPECT_FALSE(store->Read(L"C:\\IMAGE0.PNG", LAST_WRITE_TIME, 64));
+	EXPECT_TRUE(store->Read(L"C:\\IMAGE3.PNG", LAST_WRITE_TIME, 64));
+}
+
+TEST_F(ThumbnailStoreTest, CacheUsesStore)
+{
+	{
+		ThumbnailCache cache(1024 * 1024,
+			ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024));
+		cache.Insert(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128, MakeBitmap(128, 128));
+	}
+
+	ThumbnailCache cache(1024 * 1024, ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024));
+
+	// The store is only checked by Get().
+	EXPECT_EQ(cache.GetFromMemory(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128), nullptr);
+
+	auto bitmap = cache.Get(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128);
+	ASSERT_NE(bitmap, nullptr);
+	EXPECT_EQ(bitmap->width, 128U);
+	EXPECT_NE(cache.GetFromMemory(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128), nullptr);
+
+	bitmap = cache.Get(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 64);
+	ASSERT_NE(bitmap, nullptr);
+	EXPECT_EQ(bitmap->width, 64U);
+}
+
+TEST_F(ThumbnailStoreTest, SetStore)
+{
+	{
+		ThumbnailCache cache(1024 * 1024,
+			ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024));
+		cache.Insert(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128, MakeBitmap(128, 128));
+	}
+
+	// Until the store has been provided, only the in-memory cache is used.
+	ThumbnailCache cache(1024 * 1024, nullptr);
+	EXPECT_EQ(cache.Get(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128), nullptr);
+
+	cache.SetStore(ThumbnailStore::Open(m_filePath.wstring(), 1024 * 1024));
+	EXPECT_NE(cache.Get(L"C:\\Folder\\image.png", LAST_WRITE_TIME, 128), nullptr);
+}
@@ -0,0 +1,252 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/WildcardPattern.h"
+#include "../Helper/StringHelper.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <format>
+#include <iostream>
+
+namespace
+{
+
+std::vector<std::wstring> BuildFileNames(int numFileNames)
+{
+	const std::vector<std::wstring> stems = { L"Document", L"IMG_", L"report-final", L"setup",
+		L"ReadMe", L"build.log", L"Presentation (copy)", L"archive" };
+	const std::vector<std::wstring> extensions = { L".txt", L".JPG", L".docx", L".exe", L".md",
+		L".cpp", L".h", L".tar.gz" };
+
+	std::vector<std::wstring> fileNames;
+
+	for (int i = 0; i < numFileNames; i++)
+	{
+		fileNames.push_back(stems[i % stems.size()] + std::to_wstring(i)
+			+ extensions[(i / stems.size()) % extensions.size()]);
+	}
+
+	return fileNames;
+}
+
+}
+
+TEST(WildcardPatternTest, ExactMatch)
+{
+	WildcardPattern pattern(L"file.txt", true);
+	EXPECT_TRUE(pattern.Matches(L"file.txt"));
+	EXPECT_FALSE(pattern.Matches(L"file.txt2"));
+	EXPECT_FALSE(pattern.Matches(L"file.tx"));
+	EXPECT_FALSE(pattern.Matches(L"File.txt"));
+}
+
+TEST(WildcardPatternTest, Prefix)
+{
+	WildcardPattern pattern(L"file*", true);
+	EXPECT_TRUE(pattern.Matches(L"file"));
+	EXPECT_TRUE(pattern.Matches(L"file.txt"));
+	EXPECT_FALSE(pattern.Matches(L"fil"));
+	EXPECT_FALSE(pattern.Matches(L"afile"));
+}
+
+TEST(WildcardPatternTest, Suffix)
+{
+	WildcardPattern pattern(L"*.txt", true);
+	EXPECT_TRUE(pattern.Matches(L".txt"));
+	EXPECT_TRUE(pattern.Matches(L"Test.txt"));
+	EXPECT_FALSE(pattern.Matches(L"Test.txt.bak"));
+	EXPECT_FALSE(pattern.Matches(L"txt"));
+}
+
+TEST(WildcardPatternTest, SingleCharacter)
+{
+	WildcardPattern pattern(L"?.tx?", true);
+	EXPECT_TRUE(pattern.Matches(L"1.txt"));
+	EXPECT_TRUE(pattern.Matches(L"a.txa"));
+	EXPECT_FALSE(pattern.Matches(L".txt"));
+	EXPECT_FALSE(pattern.Matches(L"1.tx"));
+}
+
+TEST(WildcardPatternTest, MultipleWildcards)
+{
+	WildcardPattern pattern(L"?ab*cd*.tx?", true);
+	EXPECT_TRUE(pattern.Matches(L"1abefghcd.txt"));
+	EXPECT_TRUE(pattern.Matches(L"1abcd.txt"));
+	EXPECT_TRUE(pattern.Matches(L"1abcdcd-cd.txt"));
+	EXPECT_FALSE(pattern.Matches(L"1abc.txt"));
+
+	EXPECT_TRUE(WildcardPattern(L"*", true).Matches(L""));
+	EXPECT_TRUE(WildcardPattern(L"**", true).Matches(L"abc"));
+	EXPECT_TRUE(WildcardPattern(L"a*a", true).Matches(L"aa"));
+	EXPECT_FALSE(WildcardPattern(L"a*a", true).Matches(L"a"));
+}
+
+TEST(WildcardPatternTest, MultiplePatterns)
+{
+	WildcardPattern pattern(L"*.h: *.cpp ::readme", true);
+	EXPECT_TRUE(pattern.Matches(L"file.h"));
+	EXPECT_TRUE(pattern.Matches(L"file.cpp"));
+	EXPECT_TRUE(pattern.Matches(L"readme"));
+	EXPECT_FALSE(pattern.Matches(L"file.txt"));
+	EXPECT_FALSE(pattern.Matches(L" readme"));
+}
+
+TEST(WildcardPatternTest, CaseInsensitive)
+{
+	WildcardPattern pattern(L"Test*.TXT", false);
+	EXPECT_TRUE(pattern.Matches(L"test.txt"));
+	EXPECT_TRUE(pattern.Matches(L"TEST123.Txt"));
+	EXPECT_FALSE(pattern.Matches(L"test.doc"));
+
+#pragma warning(push)
+#pragma warning(disable : 4566)
+
+	EXPECT_TRUE(WildcardPattern(L"привет", false).Matches(L"Привет"));
+	EXPECT_FALSE(WildcardPattern(L"привет", true).Matches(L"Привет"));
+
+#pragma warning(pop)
+}
+
+TEST(WildcardPatternTest, EmptyPattern)
+{
+	WildcardPattern pattern(L"", true);
+	EXPECT_TRUE(pattern.Matches(L""));
+	EXPECT_FALSE(pattern.Matches(L"file"));
+}
+
+TEST(WildcardPatternTest, MatchesCheckWildcardMatch)
+{
+	const std::vector<std::wstring> patterns = { L"*", L"*.txt", L"IMG_*.jpg", L"*1*", L"*e?o*",
+		L"report*final*", L"*.h: *.cpp", L"?????", L"*a*b*c*", L"Document1*.txt", L"setup*.exe" };
+	auto fileNames = BuildFileNames(500);
+
+	for (const auto &patternText : patterns)
+	{
+		for (bool caseSensitive : { true, false })
+		{
+			WildcardPattern pattern(patternText, caseSensitive);
+
+			for (const auto &fileName : fileNames)
+			{
+				EXPECT_EQ(pattern.Matches(fileName),
+					CheckWildcardMatch(patternText.c_str(), fileName.c_str(), caseSensitive) == TRUE)
+					<< "Pattern: " << patternText << ", file name: " << fileName;
+			}
+		}
+	}
+}
+
+TEST(WildcardPatternTest, IsRefinementOf)
+{
+	auto isRefinement = [](const std::wstring &pattern, const std::wstring &otherPattern)
+	{ return WildcardPattern(pattern, true).IsRefinementOf(WildcardPattern(otherPattern, true)); };
+
+	EXPECT_TRUE(isRefinement(L"*.tx*", L"*.t*"));
+	EXPECT_TRUE(isRefinement(L"*.txt", L"*.t*"));
+	EXPECT_TRUE(isRefinement(L"*.txt", L"*"));
+	EXPECT_TRUE(isRefinement(L"ab*", L"a*"));
+	EXPECT_TRUE(isRefinement(L"abc", L"a*c"));
+	EXPECT_TRUE(isRefinement(L"abc", L"a?c"));
+	EXPECT_TRUE(isRefinement(L"a?c", L"a*"));
+	EXPECT_TRUE(isRefinement(L"*a*b*c*", L"*a*c*"));
+	EXPECT_TRUE(isRefinement(L"*.h", L"*.h: *.cpp"));
+	EXPECT_TRUE(isRefinement(L"abc", L"abc"));
+
+	EXPECT_FALSE(isRefinement(L"*.t*", L"*.txt"));
+	EXPECT_FALSE(isRefinement(L"abc", L"ab"));
+	EXPECT_FALSE(isRefinement(L"a?c", L"abc"));
+	EXPECT_FALSE(isRefinement(L"aba", L"ab*ba"));
+	EXPECT_FALSE(isRefinement(L"*a*c*", L"*a*b*c*"));
+	EXPECT_FALSE(isRefinement(L"*.h: *.cpp", L"*.h"));
+
+	EXPECT_TRUE(WildcardPattern(L"*.TXT", false).IsRefinementOf(WildcardPattern(L"*.t*", false)));
+	EXPECT_FALSE(WildcardPattern(L"*.txt", true).IsRefinementOf(WildcardPattern(L"*.t*", false)));
+}
+
+// Whenever one pattern is reported as being a refinement of another, every file name matching the
+// first pattern should also match the second.
+TEST(WildcardPatternTest, IsRefinementOfConsistentWithMatches)
+{
+	const std::vector<std::wstring> patterns = { L"*", L"*.t*", L"*.txt", L"*.tx?", L"IMG_*",
+		L"IMG_*.jpg", L"*1*", L"*12*", L"*1*2*", L"*e?o*", L"report*final*", L"*.h: *.cpp", L"*.h",
+		L"?????", L"*a*b*c*", L"*a*c*", L"Document1*.txt", L"Document1?.txt" };
+	auto fileNames = BuildFileNames(500);
+
+	for (const auto &patternText : patterns)
+	{
+		for (const auto &otherPatternText : patterns)
+		{
+			for (bool caseSensitive : { true, false })
+			{
+				WildcardPattern pattern(patternText, caseSensitive);
+				WildcardPattern otherPattern(otherPatternText, caseSensitive);
+
+				if (!pattern.IsRefinementOf(otherPattern))
+				{
+					continue;
+				}
+
+				for (const auto &fileName : fileNames)
+				{
+					EXPECT_TRUE(!pattern.Matches(fileName) || otherPattern.Matches(fileName))
+						<< "Pattern: " << patternText << ", other pattern: " << otherPatternText
+						<< ", file name: " << fileName;
+				}
+			}
+		}
+	}
+}
+
+// Compares the performance of WildcardPattern against CheckWildcardMatch(). This is disabled by
+// default and can be run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*.
+TEST(WildcardPatternTest, DISABLED_Benchmark)
+{
+	const std::vector<std::wstring> patterns = { L"*.txt", L"*report*final*", L"IMG_*.jpg",
+		L"*.h: *.cpp: *.md" };
+	auto fileNames = BuildFileNames(100000);
+
+	for (const auto &patternText : patterns)
+	{
+		for (bool caseSensitive : { true, false })
+		{
+			int numUncompiledMatches = 0;
+			auto start = std::chrono::steady_clock::now();
+
+			for (const auto &fileName : fileNames)
+			{
+				if (CheckWildcardMatch(patternText.c_str(), fileName.c_str(), caseSensitive))
+				{
+					numUncompiledMatches++;
+				}
+			}
+
+			auto uncompiledDuration = std::chrono::steady_clock::now() - start;
+
+			int numCompiledMatches = 0;
+			start = std::chrono::steady_clock::now();
+
+			WildcardPattern pattern(patternText, caseSensitive);
+
+			for (const auto &fileName : fileNames)
+			{
+				if (pattern.Matches(fileName))
+				{
+					numCompiledMatches++;
+				}
+			}
+
+			auto compiledDuration = std::chrono::steady_clock::now() - start;
+
+			EXPECT_EQ(numCompiledMatches, numUncompiledMatches);
+
+			std::wcout << std::format(L"{} (case sensitive: {}): CheckWildcardMatch {} ms, "
+										L"WildcardPattern {} ms, {} matches\n",
+				patternText, caseSensitive,
+				std::chrono::duration_cast<std::chrono::milliseconds>(uncompiledDuration).count(),
+				std::chrono::duration_cast<std::chrono::milliseconds>(compiledDuration).count(),
+				numCompiledMatches);
+		}
+	}
+}
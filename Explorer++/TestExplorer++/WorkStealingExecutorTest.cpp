@@ -0,0 +1,353 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+// Note that the executor only depends on the standard library (and boost), so these tests can also
+// be built on other platforms. For example:
+//
+// g++ -std=c++20 -O2 -I. -include stdafx.h WorkStealingExecutorTest.cpp WorkStealingExecutor.cpp
+//     -lgtest -lgtest_main -pthread
+//
+// where pch.h is empty and stdafx.h only needs to define UNREFERENCED_PARAMETER. The throughput
+// benchmark is disabled by default and can be run by passing --gtest_also_run_disabled_tests.
+
+#include "pch.h"
+#include "../Helper/WorkStealingExecutor.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+using namespace testing;
+
+namespace
+{
+
+// Recursively submits tasks from within the executor, in the same way a directory search would.
+void SubmitTree(WorkStealingExecutor::TaskGroup &group, int depth, int branchingFactor,
+	std::atomic<int> &numRun)
+{
+	numRun++;
+
+	if (depth == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < branchingFactor; i++)
+	{
+		group.Submit([&group, depth, branchingFactor, &numRun]()
+			{ SubmitTree(group, depth - 1, branchingFactor, numRun); });
+	}
+}
+
+int GetTreeSize(int depth, int branchingFactor)
+{
+	int size = 1;
+	int levelSize = 1;
+
+	for (int i = 0; i < depth; i++)
+	{
+		levelSize *= branchingFactor;
+		size += levelSize;
+	}
+
+	return size;
+}
+
+void WaitForCount(const std::atomic<int> &count, int expected)
+{
+	while (count < expected)
+	{
+		std::this_thread::yield();
+	}
+}
+
+}
+
+TEST(WorkStealingExecutorTest, ReturnsResults)
+{
+	WorkStealingExecutor executor(2);
+	WorkStealingExecutor::TaskGroup group(&executor);
+
+	auto future = group.Submit([]() { return 42; });
+	EXPECT_EQ(future.get(), 42);
+}
+
+TEST(WorkStealingExecutorTest, NestedSubmissions)
+{
+	WorkStealingExecutor executor(4);
+	std::atomic<int> numRun = 0;
+
+	{
+		WorkStealingExecutor::TaskGroup group(&executor);
+		group.Submit([&group, &numRun]() { SubmitTree(group, 6, 4, numRun); });
+
+		WaitForCount(numRun, GetTreeSize(6, 4));
+	}
+
+	EXPECT_EQ(numRun, GetTreeSize(6, 4));
+}
+
+TEST(WorkStealingExecutorTest, SubmitFromManyThreads)
+{
+	const int NUM_SUBMITTING_THREADS = 8;
+	const int NUM_TASKS_PER_THREAD = 5000;
+
+	WorkStealingExecutor executor(4);
+	std::atomic<int> numRun = 0;
+
+	{
+		WorkStealingExecutor::TaskGroup group(&executor);
+		std::vector<std::thread> submittingThreads;
+
+		for (int i = 0; i < NUM_SUBMITTING_THREADS; i++)
+		{
+			submittingThreads.emplace_back(
+				[&group, &numRun]()
+				{
+					for (int j = 0; j < NUM_TASKS_PER_THREAD; j++)
+					{
+						// Every tenth task also submits a small nested tree, so that both the
+						// shared queue and the per-worker deques are exercised.
+						if (j % 10 == 0)
+						{
+							group.Submit([&group, &numRun]() { SubmitTree(group, 2, 3, numRun); });
+						}
+						else
+						{
+							group.Submit([&numRun]() { numRun++; });
+						}
+					}
+				});
+		}
+
+		for (auto &thread : submittingThreads)
+		{
+			thread.join();
+		}
+
+		int numTreeTasks = NUM_TASKS_PER_THREAD / 10;
+		int expected = NUM_SUBMITTING_THREADS
+			* ((NUM_TASKS_PER_THREAD - numTreeTasks) + numTreeTasks * GetTreeSize(2, 3));
+		WaitForCount(numRun, expected);
+	}
+}
+
+TEST(WorkStealingExecutorTest, Cancel)
+{
+	WorkStealingExecutor executor(1);
+	WorkStealingExecutor::TaskGroup group(&executor);
+
+	std::promise<void> unblock;
+	std::promise<void> started;
+	group.Submit(
+		[unblockFuture = unblock.get_future(), &started]()
+		{
+			started.set_value();
+			unblockFuture.wait();
+		});
+	started.get_future().wait();
+
+	std::atomic<int> numRun = 0;
+	std::vector<std::future<void>> cancelledFutures;
+
+	for (int i = 0; i < 10; i++)
+	{
+		cancelledFutures.push_back(group.Submit([&numRun]() { numRun++; }));
+	}
+
+	group.Cancel();
+
+	// Tasks submitted after the group was cancelled should still run.
+	auto future = group.Submit([&numRun]() { numRun++; });
+
+	unblock.set_value();
+	future.wait();
+
+	EXPECT_EQ(numRun, 1);
+
+	for (auto &cancelledFuture : cancelledFutures)
+	{
+		EXPECT_THROW(cancelledFuture.get(), std::future_error);
+	}
+}
+
+TEST(WorkStealingExecutorTest, CancelOnlyAffectsGroup)
+{
+	WorkStealingExecutor executor(1);
+	WorkStealingExecutor::TaskGroup group1(&executor);
+	WorkStealingExecutor::TaskGroup group2(&executor);
+
+	std::promise<void> unblock;
+	std::promise<void> started;
+	group1.Submit(
+		[unblockFuture = unblock.get_future(), &started]()
+		{
+			started.set_value();
+			unblockFuture.wait();
+		});
+	started.get_future().wait();
+
+	std::atomic<int> numRun1 = 0;
+	std::atomic<int> numRun2 = 0;
+	group1.Submit([&numRun1]() { numRun1++; });
+	auto future = group2.Submit([&numRun2]() { numRun2++; });
+
+	group1.Cancel();
+
+	unblock.set_value();
+	future.wait();
+
+	EXPECT_EQ(numRun1, 0);
+	EXPECT_EQ(numRun2, 1);
+}
+
+TEST(WorkStealingExecutorTest, DestroyingGroupWaitsForRunningTasks)
+{
+	WorkStealingExecutor executor(4);
+	std::atomic<int> numStarted = 0;
+	std::atomic<int> numFinished = 0;
+
+	{
+		WorkStealingExecutor::TaskGroup group(&executor);
+
+		for (int i = 0; i < 4; i++)
+		{
+			group.Submit(
+				[&numStarted, &numFinished]()
+				{
+					numStarted++;
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					numFinished++;
+				});
+		}
+
+		WaitForCount(numStarted, 4);
+	}
+
+	EXPECT_EQ(numFinished, 4);
+}
+
+TEST(WorkStealingExecutorTest, ApartmentInitialization)
+{
+	std::atomic<int> numInitialized = 0;
+	std::atomic<int> numUninitialized = 0;
+
+	{
+		WorkStealingExecutor executor(
+			3, [&numInitialized]() { numInitialized++; },
+			[&numUninitialized]() { numUninitialized++; });
+		EXPECT_EQ(executor.GetNumThreads(), 3);
+
+		WorkStealingExecutor::TaskGroup group(&executor);
+
+		// The hook is only run for tasks that need it.
+		group.Submit([]() {}).wait();
+		EXPECT_EQ(numInitialized, 0);
+
+		// Each worker is initialized at most once, regardless of how many tasks it runs.
+		std::vector<std::future<void>> futures;
+
+		for (int i = 0; i < 100; i++)
+		{
+			futures.push_back(group.Submit([]() {}, WorkStealingExecutor::Apartment::Required));
+		}
+
+		for (auto &future : futures)
+		{
+			future.wait();
+		}
+
+		EXPECT_GE(numInitialized, 1);
+		EXPECT_LE(numInitialized, 3);
+	}
+
+	EXPECT_EQ(numUninitialized, numInitialized);
+}
+
+TEST(WorkStealingExecutorTest, ParallelFor)
+{
+	WorkStealingExecutor executor(4);
+	std::vector<std::atomic<int>> counts(10000);
+
+	executor.ParallelFor(counts.size(), [&counts](size_t index) { counts[index]++; });
+
+	for (const auto &count : counts)
+	{
+		EXPECT_EQ(count, 1);
+	}
+
+	executor.ParallelFor(0, [](size_t) { FAIL(); });
+}
+
+TEST(WorkStealingExecutorTest, ParallelForWithBusyWorkers)
+{
+	WorkStealingExecutor executor(1);
+	WorkStealingExecutor::TaskGroup group(&executor);
+
+	std::promise<void> unblock;
+	std::promise<void> started;
+	group.Submit(
+		[unblockFuture = unblock.get_future(), &started]()
+		{
+			started.set_value();
+			unblockFuture.wait();
+		});
+	started.get_future().wait();
+
+	// The only worker is blocked, so all the work has to be done on this thread.
+	int numCalls = 0;
+	executor.ParallelFor(100, [&numCalls](size_t) { numCalls++; });
+	EXPECT_EQ(numCalls, 100);
+
+	unblock.set_value();
+}
+
+TEST(WorkStealingExecutorTest, DISABLED_Throughput)
+{
+	const int NUM_TASKS = 1000000;
+	const int TREE_DEPTH = 9;
+	const int TREE_BRANCHING_FACTOR = 4;
+
+	int numThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	WorkStealingExecutor executor(numThreads);
+
+	auto report = [numThreads](const char *name, int numTasks, auto start)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << name << ": " << numTasks << " tasks on " << numThreads << " threads in "
+				  << elapsed.count() << "s (" << static_cast<int64_t>(numTasks / elapsed.count())
+				  << " tasks/s)\n";
+	};
+
+	{
+		std::atomic<int> numRun = 0;
+		WorkStealingExecutor::TaskGroup group(&executor);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < NUM_TASKS; i++)
+		{
+			group.Submit([&numRun]() { numRun++; });
+		}
+
+		WaitForCount(numRun, NUM_TASKS);
+		report("External submissions", NUM_TASKS, start);
+	}
+
+	{
+		std::atomic<int> numRun = 0;
+		WorkStealingExecutor::TaskGroup group(&executor);
+		int treeSize = GetTreeSize(TREE_DEPTH, TREE_BRANCHING_FACTOR);
+
+		auto start = std::chrono::steady_clock::now();
+
+		group.Submit([&group, &numRun]()
+			{ SubmitTree(group, TREE_DEPTH, TREE_BRANCHING_FACTOR, numRun); });
+
+		WaitForCount(numRun, treeSize);
+		report("Nested submissions", treeSize, start);
+	}
+}